@@ -37,6 +37,7 @@
 
 #include <algo/blast/core/blast_stat.h>
 #include <algo/blast/api/blast_aux.hpp>
+#include <algo/blast/api/blast_search_stats.hpp>
 
 /** @addtogroup AlgoBlast
  *
@@ -448,6 +449,18 @@ public:
     /// @param rid RID to set [in]
     void SetRID(const string& rid);
 
+    /// Sets the hit counts and stage times of the search that produced
+    /// these results
+    /// @param stats Statistics of the search [in]
+    void SetSearchStats(CRef<CBlastSearchStats> stats) {
+        m_SearchStats = stats;
+    }
+    /// Retrieves the hit counts and stage times of the search, or an empty
+    /// reference if they are not available (e.g. for remote searches)
+    CConstRef<CBlastSearchStats> GetSearchStats() const {
+        return CConstRef<CBlastSearchStats>(m_SearchStats.GetPointerOrNull());
+    }
+
 private:    
     /// Initialize the result set.
     void x_Init(TQueryIdVector& queries,
@@ -471,6 +484,9 @@ private:
 
     /// Stores the masked query regions, for convenience and usage in CBl2Seq
     TSeqLocInfoVector m_QueryMasks;
+
+    /// Hit counts and stage times of the search
+    CRef<CBlastSearchStats> m_SearchStats;
 };
 
 END_SCOPE(blast)
@@ -0,0 +1,192 @@
+#ifndef ALGO_BLAST_API___BLAST_SEARCH_STATS__HPP
+#define ALGO_BLAST_API___BLAST_SEARCH_STATS__HPP
+
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/// @file blast_search_stats.hpp
+/// Hit counts and time spent in each stage of BLAST searches.
+
+#include <corelib/ncbiobj.hpp>
+#include <algo/blast/core/blast_diagnostics.h>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+BEGIN_NCBI_SCOPE
+BEGIN_SCOPE(blast)
+
+/// Hit counts and time spent in each stage (see EBlastTimedStage) of one or
+/// more BLAST searches, in total and by thread.
+///
+/// The stages are timed with the clock of Blast_StageClock, at the
+/// granularity of subject chunks in the preliminary stage and of whole
+/// threads in the traceback, so that the timing costs little; it is still
+/// disabled unless SetStageTimesEnabled is called before the searches are
+/// set up.
+class NCBI_XBLAST_EXPORT CBlastSearchStats : public CObject
+{
+public:
+    /// Thread index of the stages that do not run in the worker threads of
+    /// a search, such as the setup or the formatting: their time is only
+    /// added to the totals
+    static const int kNoThread = -1;
+
+    /// Enable or disable the timing of the stages of the searches set up
+    /// from now on in this process
+    /// @param enabled Should the stages be timed? [in]
+    static void SetStageTimesEnabled(bool enabled);
+
+    /// Are the stages of the searches timed?
+    static bool GetStageTimesEnabled();
+
+    /// Enable the stage timing in a diagnostics structure if it is enabled
+    /// for the process
+    /// @param diagnostics Diagnostics of a search [in|out]
+    static void InitDiagnostics(BlastDiagnostics* diagnostics);
+
+    /// Length of a tick of Blast_StageClock, measured against the wall
+    /// clock the first time it is needed
+    /// @return ticks per second
+    static double GetTicksPerSecond();
+
+    /// Name of a stage, as used in the JSON output
+    /// @param stage The stage [in]
+    static const char* GetStageName(EBlastTimedStage stage);
+
+    /// Create empty statistics
+    CBlastSearchStats();
+
+    /// Copy the statistics of a search
+    /// @param diagnostics Diagnostics of the search [in]
+    explicit CBlastSearchStats(const BlastDiagnostics* diagnostics);
+
+    /// Add the statistics of another search, e.g. of another query batch
+    /// @param other Statistics to add [in]
+    void Add(const CBlastSearchStats& other);
+
+    /// Add the time a thread spent in a stage
+    /// @param stage The stage [in]
+    /// @param ticks Clock ticks spent in the stage [in]
+    /// @param thread_index Index of the worker thread, or kNoThread [in]
+    void AddStageTicks(EBlastTimedStage stage, Int8 ticks, int thread_index);
+
+    /// Were the stages timed?
+    bool HasStageTimes() const { return m_HasStageTimes; }
+
+    /// Clock ticks spent in a stage by all threads
+    /// @param stage The stage [in]
+    Int8 GetStageTicks(EBlastTimedStage stage) const {
+        return m_StageTimes.ticks[stage];
+    }
+
+    /// Seconds spent in a stage by all threads
+    /// @param stage The stage [in]
+    double GetStageSeconds(EBlastTimedStage stage) const {
+        return m_StageTimes.ticks[stage] / GetTicksPerSecond();
+    }
+
+    /// Time spent in each stage by each thread, ordered by thread index
+    const vector<BlastStageTimes>& GetThreadStageTimes() const {
+        return m_ThreadStageTimes;
+    }
+
+    /// Hit counts of the ungapped stage
+    const BlastUngappedStats& GetUngappedStats() const {
+        return m_UngappedStats;
+    }
+
+    /// Hit counts of the gapped stage
+    const BlastGappedStats& GetGappedStats() const {
+        return m_GappedStats;
+    }
+
+    /// Number of searches whose statistics were added
+    int GetNumSearches() const { return m_NumSearches; }
+
+    /// Write the statistics as a JSON object
+    /// @param out Stream to write to [in]
+    void WriteJson(CNcbiOstream& out) const;
+
+private:
+    /// Add times to the entry of their thread
+    /// @param stage_times Times to add [in]
+    void x_AddThreadStageTimes(const BlastStageTimes& stage_times);
+
+    /// Is the stage timing enabled for the process?
+    static bool sm_StageTimesEnabled;
+
+    bool m_HasStageTimes;               ///< Were the stages timed?
+    int m_NumSearches;                  ///< Number of searches added
+    BlastStageTimes m_StageTimes;       ///< Time spent by all threads
+    vector<BlastStageTimes> m_ThreadStageTimes; ///< Time by thread
+    BlastUngappedStats m_UngappedStats; ///< Ungapped hit counts
+    BlastGappedStats m_GappedStats;     ///< Gapped hit counts
+};
+
+/// Adds the time spent in a scope to a stage of the search using a
+/// diagnostics structure; does nothing if the stage timing is not enabled
+/// in it
+class NCBI_XBLAST_EXPORT CBlastStageTimer
+{
+public:
+    /// Start timing
+    /// @param diagnostics Diagnostics of the search [in]
+    /// @param stage Stage to add the time to [in]
+    /// @param thread_index Index of the worker thread, or
+    /// CBlastSearchStats::kNoThread [in]
+    CBlastStageTimer(BlastDiagnostics* diagnostics, EBlastTimedStage stage,
+                     int thread_index)
+        : m_Diagnostics(diagnostics && diagnostics->stage_times
+                        ? diagnostics : NULL),
+          m_Stage(stage), m_ThreadIndex(thread_index),
+          m_Start(m_Diagnostics ? Blast_StageClock() : 0)
+    {}
+
+    /// Add the time spent since construction to the stage
+    ~CBlastStageTimer();
+
+private:
+    BlastDiagnostics* m_Diagnostics;    ///< Diagnostics to update
+    EBlastTimedStage m_Stage;           ///< Stage timed
+    int m_ThreadIndex;                  ///< Index of the thread
+    Int8 m_Start;                       ///< Clock at construction
+
+    /// Prohibit copy constructor
+    CBlastStageTimer(const CBlastStageTimer&);
+    /// Prohibit assignment operator
+    CBlastStageTimer& operator=(const CBlastStageTimer&);
+};
+
+END_SCOPE(blast)
+END_NCBI_SCOPE
+
+/* @} */
+
+#endif /* ALGO_BLAST_API___BLAST_SEARCH_STATS__HPP */
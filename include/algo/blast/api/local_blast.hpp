@@ -37,6 +37,7 @@
 #include <algo/blast/api/prelim_stage.hpp>
 #include <algo/blast/api/traceback_stage.hpp>
 #include <algo/blast/api/blast_seqinfosrc.hpp>
+#include <algo/blast/api/blast_search_stats.hpp>
 
 /** @addtogroup AlgoBlast
  *
@@ -109,6 +110,12 @@ public:
     /// Retrieve the number of extensions performed during the search
     Int4 GetNumExtensions();
 
+    /// Retrieve the hit counts of the search and, if enabled with
+    /// CBlastSearchStats::SetStageTimesEnabled, the time spent in each of
+    /// its stages; the same statistics are attached to the results returned
+    /// by Run
+    CRef<CBlastSearchStats> GetSearchStats();
+
 private:
     /// Query factory from which to obtain the query sequence data
     CRef<IQueryFactory> m_QueryFactory;
@@ -69,14 +69,13 @@ public:
 	 * 					 directory)
 	 * options			Blast Options
 	 * num_of_threads	0, program determines the num of
-	 * 									 threads if the input database support
-	 * 								     threadable search
+	 * 									 threads, one per database volume
 	 * 					1 = Force non-threaded search
-	 * 					Note: If the input num of threads > max number of threads
-	 * 					      supported by a particaular database, the num of threads
-	 * 						  is kept to the max num supported by the database.
-	 * 						  If the target database does not support threaded search,
-	 * 						  value of the num of threads is ignored.
+	 * 					Note: The threads search separate batches of the queries
+	 * 						  against the whole database, sharing one mapping of
+	 * 						  its files. The num of threads is kept to the num of
+	 * 						  queries, so a single-volume database is searched
+	 * 						  with as many threads as requested explicitly.
 	 */
     CLocalRPSBlast(CRef<CBlastQueryVector> query_vector,
               	  	  const string & db,
@@ -195,9 +195,31 @@ public:
     /// @param rps_dbname Name of the RPS-BLAST database [in]
     /// @param options BLAST options (matrix name and gap costs will be
     /// modified with data read from the RPS-BLAST auxiliary file) [in|out]
+    /// @note While the RPS-BLAST database is shared by a call to
+    /// AcquireSharedRpsStructures, the shared data structures are returned
+    /// instead of mapping the database files again
     static CRef<CBlastRPSInfo> 
     CreateRpsStructures(const string& rps_dbname, CRef<CBlastOptions> options);
 
+    /// Map the files of an RPS-BLAST database once and share them with all
+    /// subsequent calls to CreateRpsStructures for that database, e.g.: by
+    /// threads searching different queries against the same database. Calls
+    /// can be nested; the database is shared until the matching number of
+    /// calls to ReleaseSharedRpsStructures
+    /// @param rps_dbname Name of the RPS-BLAST database [in]
+    /// @param options BLAST options (matrix name and gap costs will be
+    /// modified with data read from the RPS-BLAST auxiliary file) [in|out]
+    static void
+    AcquireSharedRpsStructures(const string& rps_dbname,
+                               CRef<CBlastOptions> options);
+
+    /// Stop sharing the RPS-BLAST data structures of a database
+    /// @param rps_dbname Name of the RPS-BLAST database [in]
+    /// @param options BLAST options used to acquire the database [in]
+    static void
+    ReleaseSharedRpsStructures(const string& rps_dbname,
+                               CRef<CBlastOptions> options);
+
     /// Initializes the BlastScoreBlk. Caller owns the return value.
     /// @param opts_memento Memento options object [in]
     /// @param query_data source of query sequence data [in]
@@ -235,6 +257,12 @@ public:
     /// CreateRpsStructures [in]
     /// @param seqsrc BlastSeqSrc structure, only needed when performing
     /// megablast indexed-database searches [in]
+    /// @note If the environment variable BLAST_LOOKUP_TABLE_CACHE names a
+    /// directory, nucleotide and protein lookup tables are saved there as
+    /// images named after a fingerprint of the queries and options; later
+    /// searches with the same queries and options, in this or any other
+    /// process, memory-map the image read-only instead of building the
+    /// table again.
     static LookupTableWrap*
     CreateLookupTable(CRef<ILocalQueryData> query_data,
                       const CBlastOptionsMemento* opts_memento,
@@ -260,6 +288,13 @@ public:
                     size_t number_of_queries,
                     BlastHSPWriter *writer);
 
+    /// Limit the memory of the HSP lists saved by the preliminary stage
+    /// to the size given by the BLAST_HSP_STREAM_MEMORY_LIMIT environment
+    /// variable (e.g. "4GB"); beyond it the stream saves them to a temporary
+    /// file. Does nothing if the variable is not set.
+    /// @param hsp_stream stream not yet written to [in]
+    static void SetHspStreamMemoryLimit(BlastHSPStream* hsp_stream);
+
     /// Create a writer to be registered for use by stream
     /// @param opts_memento Memento options object [in]
     /// @param query_info Information about queries [in]
@@ -52,7 +52,7 @@ BEGIN_SCOPE(blast)
 // Forward declaration
 class IBlastSeqInfoSrc;
 
-class NCBI_XBLAST_EXPORT CBlastTracebackSearch : public CObject
+class NCBI_XBLAST_EXPORT CBlastTracebackSearch : public CObject, public CThreadable
 {
 public:
     /// Create a BlastSeqSrc re-using an already created BlastSeqSrc
@@ -94,6 +94,12 @@ private:
                 CConstRef<objects::CPssmWithParameters> pssm,
                 const string        & dbname,
                 CRef<TBlastHSPStream> hsps);
+
+    /// Run the traceback with the subjects shared among
+    /// GetNumberOfThreads() threads
+    /// @param hsp_results Results of the traceback [out]
+    /// @return Status of the traceback (see BlastErrorCode2String)
+    int x_LaunchMultiThreadedTraceback(BlastHSPResults** hsp_results);
     
     /// Prohibit copy constructor
     CBlastTracebackSearch(CBlastTracebackSearch &);
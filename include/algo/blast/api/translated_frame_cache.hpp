@@ -0,0 +1,123 @@
+#ifndef ALGO_BLAST_API___TRANSLATED_FRAME_CACHE__HPP
+#define ALGO_BLAST_API___TRANSLATED_FRAME_CACHE__HPP
+
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/// @file translated_frame_cache.hpp
+/// Six-frame translations of the sequences of a nucleotide BLAST database,
+/// saved next to its volumes for tblastn and tblastx.
+
+#include <corelib/ncbiobj.hpp>
+#include <objtools/blast/seqdb_reader/seqdb.hpp>
+#include <algo/blast/core/blast_def.h>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+BEGIN_NCBI_SCOPE
+
+class CMemoryFile;
+
+BEGIN_SCOPE(blast)
+
+/// Translated frame cache of a nucleotide BLAST database.
+///
+/// The preliminary stage of tblastn and tblastx translates every subject
+/// sequence into six frames.  A translated frame cache holds these
+/// translations, made once with a given genetic code, in a file next to
+/// each database volume (the volume name with the kExtension suffix).
+/// When every volume of a database has one, the BlastSeqSrc of the
+/// database hands the memory-mapped frames to the engine, which then
+/// skips the translation for subjects with the same genetic code.
+class NCBI_XBLAST_EXPORT CTranslatedFrameCache : public CObject
+{
+public:
+    /// File name extension of the translated frame cache of a volume
+    static const char* kExtension;
+
+    /// Write the translated frame cache of a database volume.  The file
+    /// is written under a temporary name and renamed into place.
+    /// @param volume Base name of the volume, as returned by
+    /// CSeqDB::FindVolumePaths [in]
+    /// @param genetic_code Genetic code to translate with [in]
+    static void Write(const string& volume, int genetic_code);
+
+    /// Open the translated frame caches of all volumes of a database
+    /// @param db Nucleotide BLAST database [in]
+    /// @return the caches, or an empty reference if some volume has no
+    /// valid cache
+    static CRef<CTranslatedFrameCache> Open(const CSeqDB& db);
+
+    /// Destructor
+    ~CTranslatedFrameCache();
+
+    /// Point a subject sequence at its translated frames
+    /// @param oid Ordinal id of the sequence [in]
+    /// @param length Length of the nucleotide sequence [in]
+    /// @param seq Sequence block whose translation_buffer, frame_offsets and
+    /// translation_gen_code fields are set [in|out]
+    /// @return true if the cache holds the frames of the sequence
+    bool GetFrames(int oid, Int4 length, BLAST_SequenceBlk* seq) const;
+
+private:
+    /// Memory-mapped cache of a volume
+    struct SVolume {
+        int oid_start;              ///< First OID of the volume
+        CMemoryFile* file;          ///< The mapped file
+    };
+
+    /// Constructor, used by Open
+    CTranslatedFrameCache() {}
+
+    /// Map the cache of a volume
+    /// @param volume Base name of the volume [in]
+    /// @param oid_start First OID of the volume [in]
+    /// @param num_oids Number of OIDs in the volume [in]
+    /// @param gen_code Genetic code string of the caches already mapped, or
+    /// NULL [in]
+    /// @return true if the volume has a valid cache
+    bool x_AddVolume(const string& volume, int oid_start, int num_oids,
+                     const Uint1* gen_code);
+
+    /// Mapped volumes, in OID order
+    vector<SVolume> m_Volumes;
+
+    /// Prohibit copy constructor
+    CTranslatedFrameCache(const CTranslatedFrameCache&);
+    /// Prohibit assignment operator
+    CTranslatedFrameCache& operator=(const CTranslatedFrameCache&);
+};
+
+END_SCOPE(blast)
+END_NCBI_SCOPE
+
+/* @} */
+
+#endif /* ALGO_BLAST_API___TRANSLATED_FRAME_CACHE__HPP */
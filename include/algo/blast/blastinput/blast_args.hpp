@@ -953,9 +953,14 @@ class NCBI_BLASTINPUT_EXPORT CMTArgs : public IBlastCmdLineArgs
 {
 public:
     /// Default Constructor
-    CMTArgs(bool isRpsBlast = false) :
+    /// @param isRpsBlast Arguments for RPS-BLAST? [in]
+    /// @param supportsPipeline Can the application pipeline the processing
+    /// of query batches? [in]
+    CMTArgs(bool isRpsBlast = false, bool supportsPipeline = false) :
     	m_NumThreads(isRpsBlast? 0:CThreadable::kMinNumThreads),
-    	m_IsRpsBlast(isRpsBlast){}
+    	m_PipelineMemory(0),
+    	m_IsRpsBlast(isRpsBlast),
+    	m_SupportsPipeline(supportsPipeline){}
     /** Interface method, \sa IBlastCmdLineArgs::SetArgumentDescriptions */
     virtual void SetArgumentDescriptions(CArgDescriptions& arg_desc);
     /** Interface method, \sa IBlastCmdLineArgs::SetArgumentDescriptions */
@@ -964,9 +969,14 @@ public:
 
     /// Get the number of threads to spawn
     size_t GetNumThreads() const { return m_NumThreads; }
+    /// Get the memory budget in MB of the pipelined query batches, 0 if the
+    /// query batches are not pipelined
+    size_t GetPipelineMemory() const { return m_PipelineMemory; }
 private:
     size_t m_NumThreads;        ///< Number of threads to spawn
+    size_t m_PipelineMemory;    ///< Memory budget of pipelined batches (MB)
     bool m_IsRpsBlast;
+    bool m_SupportsPipeline;    ///< Is kArgPipelineMemory supported?
     static const int kDefaultRpsNumThreads = 1;
 
     void x_SetArgumentDescriptionsRpsBlast(CArgDescriptions& arg_desc);
@@ -999,7 +1009,11 @@ class NCBI_BLASTINPUT_EXPORT CDebugArgs : public IBlastCmdLineArgs
 {
 public:
     /// Default constructor
-    CDebugArgs() : m_DebugOutput(false), m_RmtDebugOutput(false) {}
+    /// @param supportsSearchStats Does the application write the hit counts
+    /// and stage times of its searches when asked to? [in]
+    CDebugArgs(bool supportsSearchStats = false)
+        : m_DebugOutput(false), m_RmtDebugOutput(false),
+          m_SupportsSearchStats(supportsSearchStats) {}
     /** Interface method, \sa IBlastCmdLineArgs::SetArgumentDescriptions */
     virtual void SetArgumentDescriptions(CArgDescriptions& arg_desc);
     /** Interface method, \sa IBlastCmdLineArgs::SetArgumentDescriptions */
@@ -1012,12 +1026,18 @@ public:
     /// Return whether debug (verbose) output should be produced
     /// (only available when compiled with _DEBUG)
     bool ProduceDebugOutput() const { return m_DebugOutput; }
+    /// Get the output stream for the hit counts and stage times of the
+    /// searches
+    /// @return NULL if they were not requested
+    CNcbiOstream* GetSearchStatsStream(const CArgs& args) const;
 private:
 
     /// Should debugging (verbose) output be printed
     bool m_DebugOutput;
     /// Should debugging (verbose) output be printed for remote BLAST
     bool m_RmtDebugOutput;
+    /// Does the application support the search statistics argument?
+    bool m_SupportsSearchStats;
 };
 
 /// Argument class to retrieve options for filtering HSPs (e.g.: culling
@@ -1111,6 +1131,12 @@ public:
         return m_MTArgs->GetNumThreads();
     }
 
+    /// Get the memory budget in MB of the pipelined query batches, 0 if the
+    /// query batches are not pipelined
+    size_t GetPipelineMemory() const {
+        return m_MTArgs->GetPipelineMemory();
+    }
+
     /// Get the input stream
     CNcbiIstream& GetInputStream() const {
         return m_StdCmdLineArgs->GetInputStream();
@@ -1153,6 +1179,12 @@ public:
         return m_DebugArgs->ProduceDebugOutput();
     }
 
+    /// Get the output stream for the hit counts and stage times of the
+    /// searches, NULL if they were not requested
+    CNcbiOstream* GetSearchStatsStream(const CArgs& args) const {
+        return m_DebugArgs->GetSearchStatsStream(args);
+    }
+
     /// Get the query batch size
     virtual int GetQueryBatchSize() const = 0;
 
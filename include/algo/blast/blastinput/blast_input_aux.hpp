@@ -244,10 +244,14 @@ ParseSequenceRangeOpenEnd(const string& range_str, const char* error_prefix = NU
  * @param program BLAST task [in]
  * @param is_ungapped true if ungapped BLAST search is requested [in]
  * @param remote true if remote BLAST search is requested [in]
+ * @param num_threads number of threads a local search splits each batch
+ * among; the batch size is scaled so that each thread gets a batch of the
+ * usual size [in]
  */
 NCBI_BLASTINPUT_EXPORT
 int
-GetQueryBatchSize(EProgram program, bool is_ungapped = false, bool remote = false);
+GetQueryBatchSize(EProgram program, bool is_ungapped = false, bool remote = false,
+                  int num_threads = 1);
 
 /** Read sequence input for BLAST 
  * @param in input stream from which to read [in]
@@ -93,6 +93,14 @@ NCBI_BLASTINPUT_EXPORT extern const string kArgRemote;
 /// Argument to determine the number of threads to use when running BLAST
 NCBI_BLASTINPUT_EXPORT extern const string kArgNumThreads;
 
+/// Argument to set the memory budget (in MB) of the query batches read ahead
+/// and awaiting formatting when the processing of query batches is pipelined
+NCBI_BLASTINPUT_EXPORT extern const string kArgPipelineMemory;
+
+/// Argument to write the hit counts and the time spent in each stage of the
+/// searches as JSON
+NCBI_BLASTINPUT_EXPORT extern const string kArgSearchStats;
+
 /// Argument for scoring matrix
 NCBI_BLASTINPUT_EXPORT extern const string kArgMatrixName;
 
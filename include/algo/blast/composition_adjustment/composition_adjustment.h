@@ -108,7 +108,38 @@ NCBI_XBLAST_EXPORT
 void Blast_MatrixInfoFree(Blast_MatrixInfo ** ss);
 
 
-/** Work arrays used to perform composition-based matrix adjustment */
+/** Number of adjusted matrices remembered by a Blast_CompositionWorkspace */
+#define COMPO_MATRIX_CACHE_SIZE 64
+
+/**
+ * A score matrix computed by Blast_CompositionMatrixAdj, together with
+ * everything the computation depends on.  Subjects with the same
+ * composition as one seen recently (e.g. redundant database entries)
+ * get their matrix from the cache rather than from the Newton solver. */
+typedef struct Blast_AdjustedMatrixCacheEntry {
+    int status;            /**< value returned by the adjustment: 0 if
+                                matrix holds the adjusted scores, 1 if the
+                                optimization did not converge; -1 if the
+                                entry is unused */
+    EMatrixAdjustRule matrix_adjust_rule;  /**< rule used to adjust */
+    int alphsize;          /**< size of the alphabet */
+    int length1;           /**< number of true amino acids in the first
+                                sequence */
+    int length2;           /**< number of true amino acids in the second
+                                sequence */
+    int pseudocounts;      /**< number of pseudocounts used */
+    double specifiedRE;    /**< relative entropy specified by the user */
+    const Blast_MatrixInfo * matrixInfo;   /**< the unadjusted matrix */
+    double row_probs[COMPO_LARGEST_ALPHABET];  /**< composition of the
+                                                    first sequence */
+    double col_probs[COMPO_LARGEST_ALPHABET];  /**< composition of the
+                                                    second sequence */
+    int ** matrix;         /**< the adjusted scores */
+} Blast_AdjustedMatrixCacheEntry;
+
+
+/** Work arrays used to perform composition-based matrix adjustment.  A
+ * workspace may be used by only one thread at a time. */
 typedef struct Blast_CompositionWorkspace {
     double ** mat_b;       /**< joint probabilities for the matrix in
                                 standard context */
@@ -118,6 +149,12 @@ typedef struct Blast_CompositionWorkspace {
                                            of the first sequence */
     double * second_standard_freq;    /**< background frequency vector of
                                            the second sequence */
+    Blast_AdjustedMatrixCacheEntry *
+        matrix_cache;      /**< recently adjusted matrices, indexed by a
+                                hash of the compositions; has
+                                COMPO_MATRIX_CACHE_SIZE entries */
+    int matrix_cache_lookups;   /**< number of matrices looked up */
+    int matrix_cache_hits;      /**< number of matrices found */
 } Blast_CompositionWorkspace;
 
 
@@ -128,7 +165,7 @@ Blast_CompositionWorkspace * Blast_CompositionWorkspaceNew(void);
 
 
 /** Initialize the fields of a Blast_CompositionWorkspace for a specific
- * underlying scoring matrix. */
+ * underlying scoring matrix; this also empties the matrix cache. */
 NCBI_XBLAST_EXPORT
 int Blast_CompositionWorkspaceInit(Blast_CompositionWorkspace * NRrecord,
                                    const char *matrixName);
@@ -229,7 +266,9 @@ Blast_CompositionBasedStats(int ** matrix, double * LambdaRatio,
  *                     of the optimization problem
  * @param NRrecord     a Blast_CompositionWorkspace that contains
  *                     fields used for the composition adjustment and
- *                     that will hold the output.
+ *                     that will hold the output; if the same
+ *                     adjustment was computed recently with this
+ *                     workspace, the matrix is taken from its cache.
  * @param matrixInfo   information about the underlying, non-adjusted,
  *                     scoring matrix.
  *
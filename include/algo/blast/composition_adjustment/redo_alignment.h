@@ -339,6 +339,8 @@ typedef struct Blast_RedoAlignParams {
     const Blast_RedoAlignCallbacks *
         callbacks;                     /**< callback functions used by
                                             the Blast_RedoAlign* functions */
+    EBlastSimdLevel vector_level; /**< highest vector instruction set the
+                                       Smith-Waterman routines may use */
 } Blast_RedoAlignParams;
 
 
@@ -33,6 +33,7 @@
 
 #include <algo/blast/core/blast_export.h>
 #include <algo/blast/core/ncbi_std.h>
+#include <algo/blast/core/blast_simd.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -119,6 +120,9 @@ void Blast_ForbiddenRangesRelease(Blast_ForbiddenRanges * self);
  * @param positionSpecific  determines whether matrix is position
  *                          specific or not
  * @param forbiddenRanges   ranges that must not be included in the alignment
+ * @param vectorLevel       highest vector instruction set that may be
+ *                          used; vector code is only used if there are
+ *                          no forbidden ranges
  *
  * @return 0 on success, -1 on out-of-memory
  */
@@ -137,7 +141,8 @@ int Blast_SmithWatermanFindStart(int * score_out,
                                  int score_in,
                                  int positionSpecific,
                                  const Blast_ForbiddenRanges *
-                                 forbiddenRanges);
+                                 forbiddenRanges,
+                                 EBlastSimdLevel vectorLevel);
     
 /**
  * Compute the score and right-hand endpoints of the locally optimal
@@ -159,6 +164,9 @@ int Blast_SmithWatermanFindStart(int * score_out,
  * @param forbiddenRanges   lists areas that should not be aligned [in]
  * @param positionSpecific  determines whether matrix is position
  *                          specific or not
+ * @param vectorLevel       highest vector instruction set that may be
+ *                          used; vector code is only used if there are
+ *                          no forbidden ranges
  * @return 0 on success; -1 on out-of-memory
  */
 NCBI_XBLAST_EXPORT
@@ -171,7 +179,106 @@ int Blast_SmithWatermanScoreOnly(int *score,
                                  int gapOpen, int gapExtend,
                                  int positionSpecific,
                                  const Blast_ForbiddenRanges *
-                                 forbiddenRanges);
+                                 forbiddenRanges,
+                                 EBlastSimdLevel vectorLevel);
+
+
+/**
+ * A query profile for the striped Smith-Waterman score computation of
+ * Blast_SwStripedScore, together with the scratch space that computation
+ * needs.  For every residue of the alphabet, the profile holds the score
+ * of aligning that residue to each query position, interleaved so that
+ * a single vector instruction processes query positions that are
+ * segLength16 (or segLength8) positions apart.  Scores are held in 16-bit
+ * and, if the score range allows, in biased 8-bit form.
+ */
+typedef struct Blast_SwStripedProfile {
+    const Uint1 * query;    /**< the query the profile was built for */
+    int queryLength;        /**< length of the query */
+    int ** matrix;          /**< the matrix the profile was built from */
+    int alphsize;           /**< number of residues in the profile */
+    int positionSpecific;   /**< true if matrix is position specific */
+    int bias;               /**< added to all 8-bit scores to make them
+                                 nonnegative, or -1 if there are no 8-bit
+                                 scores */
+    int segLength8;         /**< number of vectors per residue of the
+                                 8-bit profile */
+    int segLength16;        /**< number of vectors per residue of the
+                                 16-bit profile */
+    void * profile8;        /**< the 8-bit profile */
+    void * profile16;       /**< the 16-bit profile */
+    void * work;            /**< scratch space for one pass */
+    void * memory;          /**< the block holding all of the above */
+} Blast_SwStripedProfile;
+
+
+/**
+ * Create a query profile for Blast_SwStripedScore.
+ *
+ * @param query             the query sequence data
+ * @param queryLength       length of the query
+ * @param matrix            amino-acid scoring matrix, or a position
+ *                          specific matrix with queryLength rows
+ * @param alphsize          one more than the largest residue of any
+ *                          sequence that will be scored against the
+ *                          profile
+ * @param positionSpecific  determines whether matrix is position
+ *                          specific or not
+ * @param vectorLevel       highest vector instruction set that may be used
+ *
+ * @return the new profile, or NULL if vectorLevel does not allow a
+ *         striped computation, the scores do not fit in 16 bits, or
+ *         memory is exhausted
+ */
+NCBI_XBLAST_EXPORT
+Blast_SwStripedProfile *
+Blast_SwStripedProfileNew(const Uint1 * query, int queryLength,
+                          int **matrix, int alphsize,
+                          int positionSpecific,
+                          EBlastSimdLevel vectorLevel);
+
+
+/** Free a profile created by Blast_SwStripedProfileNew */
+NCBI_XBLAST_EXPORT
+void Blast_SwStripedProfileFree(Blast_SwStripedProfile * self);
+
+
+/**
+ * Compute the score and right-hand endpoints of the locally optimal
+ * Smith-Waterman alignment between the profile's query and a database
+ * sequence, using the striped vector algorithm of Farrar.  A pass with
+ * 8-bit scores is tried first and is redone with 16-bit scores if the
+ * alignment score is too large.  When several alignments have the
+ * optimal score, the endpoints are the same as those reported by
+ * Blast_SmithWatermanScoreOnly.
+ *
+ * If stopScore is reached, then *score and the endpoints describe the
+ * first cell (in the order in which Blast_SmithWatermanScoreOnly visits
+ * cells) whose score is at least stopScore, rather than the optimum.
+ *
+ * @param *score            the computed score
+ * @param *matchSeqEnd      the right-hand end of the alignment in the
+ *                          database sequence
+ * @param *queryEnd         the right-hand end of the alignment in the
+ *                          query sequence
+ * @param self              query profile and scratch space
+ * @param matchSeq          the database sequence data; all residues must
+ *                          be less than the alphsize of the profile
+ * @param matchSeqLength    length of matchSeq
+ * @param gapOpen           penalty for opening a gap, must be positive
+ * @param gapExtend         penalty for extending a gap by one amino acid
+ * @param stopScore         score at which to stop looking for a better
+ *                          alignment, or INT4_MAX to find the optimum
+ *
+ * @return 0 on success; 1 if the score does not fit in 16 bits or
+ *         the gap penalties are unsuitable, in which case the scalar
+ *         code must be used instead
+ */
+NCBI_XBLAST_EXPORT
+int Blast_SwStripedScore(int *score, int *matchSeqEnd, int *queryEnd,
+                         Blast_SwStripedProfile * self,
+                         const Uint1 * matchSeq, int matchSeqLength,
+                         int gapOpen, int gapExtend, int stopScore);
 
 #ifdef __cplusplus
 }
@@ -286,6 +286,20 @@ typedef struct BLAST_SequenceBlk {
 
    Uint1 bases_offset; /* Bases offset in first byte for SRA seq */
 
+   /* BEGIN: Data members for nucleotide subjects translated in advance */
+   const Uint1* translation_buffer; /**< Six-frame translation of the
+                                      sequence (tblast[nx]), laid out as by
+                                      BLAST_GetAllTranslations; NULL if the
+                                      BlastSeqSrc has none. This field is NOT
+                                      owned by this data structure. */
+   const Int4* frame_offsets; /**< Offsets of the frames in
+                                 translation_buffer (NUM_FRAMES+1 entries).
+                                 NOT owned by this data structure. */
+   const Uint1* translation_gen_code; /**< Genetic code string used to make
+                                         translation_buffer. NOT owned by
+                                         this data structure. */
+   /* END: Data members for nucleotide subjects translated in advance */
+
 } BLAST_SequenceBlk;
 
 /** Information about a single pattern occurence in the query. */
@@ -76,13 +76,63 @@ typedef struct BlastGappedStats {
                             gapped extension */
    Int4 num_seqs_passed; /**< Number of sequences with top HSP passing the
                             e-value threshold. */
+   Int4 simd_extensions; /**< Number of score-only nucleotide gapped
+                            extensions computed in part with vector code */
 } BlastGappedStats;
 
+/** Structure containing work counts of one thread of a multi-threaded
+ * preliminary search */
+typedef struct BlastThreadStats {
+   Int4 thread_index; /**< Index of the thread in the subject scheduler */
+   Int4 subjects; /**< Number of subject sequences taken from the sequence
+                     source */
+   Int4 split_subjects; /**< Number of subjects split into work units */
+   Int4 units; /**< Number of subject chunks searched as work units */
+   Int4 stolen_units; /**< Number of work units taken from the queues of
+                         other threads */
+   Int8 residues; /**< Number of subject residues searched */
+} BlastThreadStats;
+
+/** Stages of a BLAST search timed by the stage profiler */
+typedef enum EBlastTimedStage {
+   eBlastStageLookup = 0,   /**< Construction of the lookup table */
+   eBlastStageScan,         /**< Scanning of the subjects for word hits */
+   eBlastStageUngapped,     /**< Ungapped extension of the word hits */
+   eBlastStageGapped,       /**< Preliminary gapped extension */
+   eBlastStageCompAdjust,   /**< Composition-based score adjustment; the
+                               traceback of the searches that use it is
+                               done by the adjustment code and counted here */
+   eBlastStageTraceback,    /**< Gapped extension with traceback */
+   eBlastStageFormat,       /**< Formatting of the results, only counted by
+                               the applications */
+   eBlastStageMaxNum        /**< Number of stages, must be last */
+} EBlastTimedStage;
+
+/** Clock ticks (see Blast_StageClock) spent in each stage of a search, by
+ * one thread or by all of them */
+typedef struct BlastStageTimes {
+   Int4 thread_index; /**< Index of the thread, or -1 for the totals of all
+                         threads */
+   Int8 ticks[eBlastStageMaxNum]; /**< Ticks spent in each stage */
+} BlastStageTimes;
+
 /** Return statistics from the BLAST search */
 typedef struct BlastDiagnostics {
    BlastUngappedStats* ungapped_stat; /**< Ungapped extension counts */
    BlastGappedStats* gapped_stat; /**< Gapped extension counts */
    BlastRawCutoffs* cutoffs; /**< Various raw values for the cutoffs */
+   BlastThreadStats* thread_stats; /**< Work counts of each preliminary
+                                      search thread; only filled when the
+                                      subject scheduler is used */
+   Int4 num_thread_stats; /**< Number of elements in thread_stats */
+   BlastStageTimes* stage_times; /**< Time spent in each stage by all
+                                    threads; NULL unless enabled with
+                                    Blast_DiagnosticsEnableStageTimes */
+   BlastStageTimes* thread_stage_times; /**< Time spent in each stage by
+                                           each thread, in the order the
+                                           threads first reported */
+   Int4 num_thread_stage_times; /**< Number of elements in
+                                   thread_stage_times */
    MT_LOCK mt_lock; /**< Mutex for updating diagnostics data in a 
                        multi-threaded search. */
 } BlastDiagnostics;
@@ -106,8 +156,48 @@ void Blast_UngappedStatsUpdate(BlastUngappedStats* ungapped_stats,
                                Int4 total_hits, Int4 extended_hits,
                                Int4 saved_hits);
 
+/** Append the work counts of one thread to the diagnostics.
+ * @param diagnostics Diagnostics structure to update [in] [out]
+ * @param thread_stats Counts to append [in]
+ * @return 0 on success, BLASTERR_MEMORY if out of memory
+ */
+Int2 Blast_DiagnosticsAddThreadStats(BlastDiagnostics* diagnostics,
+                                     const BlastThreadStats* thread_stats);
+
+/** Read the clock used to time the stages of a search. This is the time
+ * stamp counter of the CPU where available, and a monotonic clock in
+ * nanoseconds otherwise; the length of a tick must be calibrated by the
+ * caller against a wall clock.
+ * @return current value of the clock, in ticks
+ */
+Int8 Blast_StageClock(void);
+
+/** Enable the timing of the stages of the searches using the diagnostics
+ * structure. It is disabled by default, and the engine then does not read
+ * the clock at all.
+ * @param diagnostics Diagnostics structure to update [in] [out]
+ * @return 0 on success, BLASTERR_MEMORY if out of memory
+ */
+Int2 Blast_DiagnosticsEnableStageTimes(BlastDiagnostics* diagnostics);
+
+/** Add the time one thread spent in the stages of a search to the
+ * diagnostics: to the totals, and to the entry of the thread with the same
+ * index, which is appended if there is none. Times with a negative thread
+ * index, e.g. the totals of other diagnostics, are only added to the
+ * totals. Nothing is done if stage timing is not enabled in the
+ * diagnostics. Locks the mutex of the diagnostics, if any.
+ * @param diagnostics Diagnostics structure to update [in] [out]
+ * @param stage_times Times to add [in]
+ * @return 0 on success, BLASTERR_MEMORY if out of memory
+ */
+Int2 Blast_DiagnosticsAddStageTimes(BlastDiagnostics* diagnostics,
+                                    const BlastStageTimes* stage_times);
+
 /** In a multi-threaded run, update global diagnostics data with the data
- * coming from one of the preliminary search threads.
+ * coming from one of the preliminary search threads. The thread counts of
+ * the local structure are appended to those of the global one, and its
+ * stage times are added as those of thread stage_times->thread_index, or
+ * to the totals only if that index is negative.
  * @param diag_global Diagnostics for the entire BLAST search [in] [out]
  * @param diag_local Diagnostics from one of the preliminary search threads [in]
  */
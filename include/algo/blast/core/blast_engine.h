@@ -46,6 +46,7 @@
 #include <algo/blast/core/blast_seqsrc.h>
 #include <algo/blast/core/blast_diagnostics.h>   
 #include <algo/blast/core/blast_hspstream.h>
+#include <algo/blast/core/blast_subject_sched.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -208,6 +209,47 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
    BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info);
 
+/** Same as above, for one of the threads of a multi-threaded search. Each
+ * thread registers with the subject scheduler shared by all of them, which
+ * lets the threads search the chunks of long subject sequences in
+ * parallel. The work counts of the thread are appended to the thread_stats
+ * of the diagnostics.
+ * @param program_number Type of BLAST program [in]
+ * @param query The query sequence [in]
+ * @param query_info Additional query information [in]
+ * @param seq_src Structure containing BLAST database [in]
+ * @param score_options Hit scoring options [in]
+ * @param sbp Scoring and statistical parameters [in]
+ * @param lookup_wrap The lookup table, constructed earlier [in] 
+ * @param word_options Options for processing initial word hits [in]
+ * @param ext_options Options and parameters for the gapped extension [in]
+ * @param hit_options Options for saving the HSPs [in]
+ * @param eff_len_options Options for setting effective lengths [in]
+ * @param psi_options Options specific to PSI-BLAST [in]
+ * @param db_options Options for handling BLAST database [in]
+ * @param hsp_stream Structure for streaming results [in] [out]
+ * @param diagnostics Return statistics containing numbers of hits on 
+ *                    different stages of the search [out]
+ * @param scheduler Subject scheduler shared by the threads of the search;
+ *                  if NULL, this is the same as
+ *                  Blast_RunPreliminarySearchWithInterrupt [in] [out]
+ * @param interrupt_search User defined function to interrupt search [in]
+ * @param progress_info User supplied data structure to aid interrupt [in]
+ */
+Int2 
+Blast_RunPreliminarySearchWithScheduler(EBlastProgramType program, 
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info, 
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   BlastScoreBlk* sbp, LookupTableWrap* lookup_wrap,
+   const BlastInitialWordOptions* word_options, 
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const PSIBlastOptions* psi_options, const BlastDatabaseOptions* db_options, 
+   BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
+   BlastSubjectScheduler* scheduler,
+   TInterruptFnPtr interrupt_search, SBlastProgress* progress_info);
+
 /** Gapped extension function pointer type */
 typedef Int2 (*BlastGetGappedScoreType) 
      (EBlastProgramType, /**< @todo comment function pointer types */
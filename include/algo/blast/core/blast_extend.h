@@ -109,6 +109,8 @@ typedef struct BLAST_DiagHash {
 typedef struct Blast_ExtendWord {
    BLAST_DiagTable* diag_table; /**< Diagonal array and related parameters */
    BLAST_DiagHash* hash_table; /**< Hash table and related parameters */ 
+   Int8* scan_ticks; /**< If not NULL, the clock ticks spent scanning the
+                        subjects for word hits are added here */
 } Blast_ExtendWord;
 
 /** Initializes the word extension structure
@@ -74,6 +74,10 @@ typedef struct BlastGapAlignStruct {
                                          gapped extension */
    BlastGapDP* dp_mem; /**< scratch structures for dynamic programming */
    Int4 dp_mem_alloc;  /**< current number of structures allocated */
+   struct Blast_SwStripedProfile* sw_profile; /**< query profile of the
+                                          vectorized Smith-Waterman score
+                                          computation, kept between
+                                          subject sequences */
    BlastScoreBlk* sbp; /**< Pointer to the scoring information block */
    Int4 gap_x_dropoff; /**< X-dropoff parameter to use */
    Int4 query_start; /**< query start offset of current alignment */
@@ -85,6 +89,9 @@ typedef struct BlastGapAlignStruct {
    Int4 greedy_subject_seed_start;  /**< for greedy alignments, the subject
                                          offset of the gapped start point */
    Int4 score;   /**< Return value: alignment score */
+   Int8 simd_blocks; /**< Number of blocks of cells of the score-only
+                        nucleotide dynamic programming computed with
+                        vector code by this structure */
 } BlastGapAlignStruct;
 
 /** Initializes the BlastGapAlignStruct structure 
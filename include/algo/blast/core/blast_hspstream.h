@@ -86,6 +86,10 @@ BlastHSPStreamResultBatch * Blast_HSPStreamResultBatchFree(
 NCBI_XBLAST_EXPORT
 void Blast_HSPStreamResultBatchReset(BlastHSPStreamResultBatch *batch);
 
+/** HSP lists saved by a BlastHSPStream in temporary files; defined in
+ * blast_hspstream.c */
+struct BlastHSPStreamSpill;
+
 /** Default implementation of BlastHSPStream */
 typedef struct BlastHSPStream {
    EBlastProgramType program;           /**< BLAST program type */
@@ -109,6 +113,9 @@ typedef struct BlastHSPStream {
    BlastHSPPipe *pre_pipe;         /**< registered preliminary pipeline (unused
                                     for now) */
    BlastHSPPipe *tback_pipe;       /**< registered traceback pipeline */
+   struct BlastHSPStreamSpill* spill; /**< HSP lists saved in temporary files
+                                        if the stream has a memory limit,
+                                        NULL otherwise */
 } BlastHSPStream;
 
 /*****************************************************************************/
@@ -128,6 +135,22 @@ BlastHSPStream* BlastHSPStreamNew(EBlastProgramType program,
                              Int4 num_queries,
                              BlastHSPWriter* writer);
 
+/** Limit the memory used by the HSP lists saved in the stream. Whenever the
+ * saved HSP lists take more than the limit, they are sorted in the order in
+ * which the stream is read and written to a temporary file. When the stream
+ * is closed, the best HSP lists of each query are selected among all those
+ * saved, and the temporary files are merged as the stream is read, so that
+ * the stream returns the same HSP lists in the same order as without a
+ * limit. The limit only bounds the HSP lists the writer saves in the
+ * results; writers keeping HSP lists of their own until they are finalized
+ * are not affected. Streams with a memory limit cannot be merged.
+ * @param hsp_stream The stream, before anything is written to it [in] [out]
+ * @param max_bytes Approximate memory limit in bytes; 0 for no limit [in]
+ * @return 0 on success, -1 if the stream cannot have a memory limit
+ */
+NCBI_XBLAST_EXPORT
+int BlastHSPStreamSetMemoryLimit(BlastHSPStream* hsp_stream, Int8 max_bytes);
+
 /** Frees the BlastHSPStream structure by invoking the destructor function set
  * by the user-defined constructor function when the structure is initialized
  * (indirectly, by BlastHSPStreamNew). If the destructor function pointer is not
@@ -41,6 +41,7 @@
 #include <algo/blast/core/blast_stat.h>
 #include <algo/blast/core/blast_hits.h>
 #include <algo/blast/core/blast_hspstream.h>
+#include <connect/ncbi_core.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -91,6 +92,86 @@ Blast_RedoAlignmentCore(EBlastProgramType program_number,
                   const PSIBlastOptions* psiOptions,
                   BlastHSPResults* results);
 
+/** Work shared by the threads that recompute the alignments of a
+ * database search in parallel. The matches are read from the HSP stream
+ * up front; each thread redoes whole matches with its own copy of the
+ * scoring matrix and its own composition workspace, and the redone
+ * matches are saved in the order Blast_RedoAlignmentCore would save them,
+ * so that the results do not depend on the number of threads.
+ */
+typedef struct BlastRedoAlignmentWork BlastRedoAlignmentWork;
+
+/** Set up the recomputation of the alignments of a database search by
+ * several threads. The scoring system of the search is rescaled until
+ * the work is finished or freed.
+ * @param program_number the type of blast search being performed [in]
+ * @param queryBlk query sequence [in]
+ * @param query_info query information [in]
+ * @param sbp (Karlin-Altschul) information for search [in]
+ * @param seqSrc used to fetch database/match sequences [in]
+ * @param db_genetic_code Genetic code to use if database sequences are
+ *                        translated [in]
+ * @param hsp_stream hits for further processing, all of which are read
+ *                   by this function [in]
+ * @param scoringParams parameters used for scoring (matrix, gap costs etc.) [in]
+ * @param extendParams parameters used for extension [in]
+ * @param hitParams parameters used for saving hits [in]
+ * @param psiOptions options related to psi-blast [in]
+ * @param num_threads number of threads that will call
+ *                    Blast_RedoAlignmentThread [in]
+ * @param lock mutex used to synchronize the threads; the work takes
+ *             ownership of it [in]
+ * @param work the new work, or NULL on failure [out]
+ * @return 0 on success, otherwise failure.
+ */
+NCBI_XBLAST_EXPORT
+Int2
+Blast_RedoAlignmentWorkNew(EBlastProgramType program_number,
+                           BLAST_SequenceBlk* queryBlk,
+                           BlastQueryInfo* query_info,
+                           BlastScoreBlk* sbp,
+                           const BlastSeqSrc* seqSrc,
+                           Int4 db_genetic_code,
+                           BlastHSPStream* hsp_stream,
+                           BlastScoringParameters* scoringParams,
+                           const BlastExtensionParameters* extendParams,
+                           const BlastHitSavingParameters* hitParams,
+                           const PSIBlastOptions* psiOptions,
+                           Int4 num_threads, MT_LOCK lock,
+                           BlastRedoAlignmentWork** work);
+
+/** Recompute alignments until no match is left; called once by each of
+ * the threads the work was created for.
+ * @param work work shared by the threads [in] [out]
+ * @param seqSrc used to fetch database sequences; a copy owned by the
+ *               calling thread [in]
+ * @return 0 on success, otherwise failure.
+ */
+NCBI_XBLAST_EXPORT
+Int2
+Blast_RedoAlignmentThread(BlastRedoAlignmentWork* work,
+                          const BlastSeqSrc* seqSrc);
+
+/** Save the recomputed alignments in the results and restore the scoring
+ * system of the search; called after all threads have returned.
+ * @param work work shared by the threads [in] [out]
+ * @param results results of the search [out]
+ * @return 0 on success, otherwise the first failure of any thread.
+ */
+NCBI_XBLAST_EXPORT
+Int2
+Blast_RedoAlignmentWorkFinish(BlastRedoAlignmentWork* work,
+                              BlastHSPResults* results);
+
+/** Free the work; restores the scoring system of the search if
+ * Blast_RedoAlignmentWorkFinish was not called.
+ * @param work work to free [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+BlastRedoAlignmentWork*
+Blast_RedoAlignmentWorkFree(BlastRedoAlignmentWork* work);
+
 #ifdef __cplusplus
 
 }
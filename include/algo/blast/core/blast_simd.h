@@ -0,0 +1,89 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_simd.h
+ * Runtime selection of vectorized code paths in the BLAST engine.
+ *
+ * Vectorized kernels are compiled with per-function target attributes, so
+ * the library as a whole is still built for the baseline instruction set;
+ * a kernel is only installed (e.g. as a scansub_callback) after
+ * BlastSimd_GetLevel() confirms that the running CPU supports it.
+ */
+
+#ifndef ALGO_BLAST_CORE__BLAST_SIMD__H
+#define ALGO_BLAST_CORE__BLAST_SIMD__H
+
+#include <algo/blast/core/ncbi_std.h>
+#include <algo/blast/core/blast_export.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Vector kernels need per-function target attributes and
+   __builtin_cpu_supports, i.e. gcc 4.9+ or clang on x86 */
+#if !defined(BLAST_DISABLE_SIMD) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+/** Defined if x86 vector kernels are compiled in */
+#define BLAST_SIMD_X86 1
+/** Attribute compiling one function for SSE4.1 */
+#define BLAST_TARGET_SSE41 __attribute__((target("sse4.1")))
+/** Attribute compiling one function for AVX2 */
+#define BLAST_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/** Instruction set levels for which the engine has vectorized code paths,
+ * in increasing order of capability */
+typedef enum EBlastSimdLevel {
+    eBlastSimdNone = 0,   /**< scalar code only */
+    eBlastSimdSSE41 = 1,  /**< SSE2 through SSE4.1 */
+    eBlastSimdAVX2 = 2    /**< AVX2 (256-bit integer vectors and gathers) */
+} EBlastSimdLevel;
+
+/** Return the highest vector instruction set usable by the engine. This is
+ * the capability of the running CPU, capped by the BLAST_SIMD environment
+ * variable ("none", "sse4.1" or "avx2") and by BlastSimd_SetMaxLevel()
+ * @return the usable level
+ */
+NCBI_XBLAST_EXPORT
+EBlastSimdLevel BlastSimd_GetLevel(void);
+
+/** Cap the vector instruction set used by kernels selected from now on.
+ * Intended for benchmarks and for tests that compare vector and scalar
+ * results; it is not synchronized with concurrent searches.
+ * @param level maximum level to use [in]
+ */
+NCBI_XBLAST_EXPORT
+void BlastSimd_SetMaxLevel(EBlastSimdLevel level);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !ALGO_BLAST_CORE__BLAST_SIMD__H */
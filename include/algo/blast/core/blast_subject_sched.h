@@ -0,0 +1,149 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_subject_sched.h
+ * Work-stealing scheduler for the subject chunks searched by the threads
+ * of a multi-threaded preliminary search.
+ *
+ * The threads still take whole subject sequences from the BlastSeqSrc
+ * iterator. A subject long enough to be searched in several chunks (see
+ * MAX_DBSEQ_LEN) is instead published as one work unit per chunk on the
+ * queue of the thread that fetched it. That thread works through its own
+ * queue first; threads that run out of subjects take units from the
+ * fullest queue of another thread, so the last few chromosomes of a genome
+ * database no longer leave most of the threads idle.
+ */
+
+#ifndef ALGO_BLAST_CORE__BLAST_SUBJECT_SCHED__H
+#define ALGO_BLAST_CORE__BLAST_SUBJECT_SCHED__H
+
+#include <algo/blast/core/ncbi_std.h>
+#include <algo/blast/core/blast_export.h>
+#include <algo/blast/core/blast_diagnostics.h>
+#include <connect/ncbi_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** One chunk of a split subject sequence */
+typedef struct BlastSubjectWorkUnit {
+    void* job;      /**< Engine data describing the split subject */
+    Int4 chunk;     /**< Index of the subject chunk to search */
+} BlastSubjectWorkUnit;
+
+/** Queue of work units owned by one search thread */
+typedef struct BlastSubjectWorkQueue {
+    BlastSubjectWorkUnit* units; /**< Queued units; live in [first, last) */
+    Int4 first;     /**< Next unit to be stolen by other threads */
+    Int4 last;      /**< One past the next unit taken by the owner */
+    Int4 allocated; /**< Number of units allocated */
+} BlastSubjectWorkQueue;
+
+/** Scheduler shared by the threads of a preliminary search */
+typedef struct BlastSubjectScheduler {
+    Int4 num_threads;              /**< Number of queues */
+    Int4 num_registered;           /**< Number of threads registered */
+    BlastSubjectWorkQueue* queues; /**< Work queue of each thread */
+    BlastThreadStats* stats;       /**< Work counts of each thread */
+    MT_LOCK lock;                  /**< Protects everything above */
+} BlastSubjectScheduler;
+
+/** Allocate a scheduler.
+ * @param num_threads Number of threads that will register [in]
+ * @param lock Mutex used to protect the queues; the scheduler takes
+ *             ownership of it [in]
+ * @return New scheduler or NULL if out of memory
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectScheduler* BlastSubjectSchedulerNew(Int4 num_threads,
+                                                MT_LOCK lock);
+
+/** Deallocate a scheduler; all queues must be empty.
+ * @param sched Scheduler to free [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectScheduler* BlastSubjectSchedulerFree(BlastSubjectScheduler* sched);
+
+/** Assign a queue to the calling thread.
+ * @param sched Scheduler [in] [out]
+ * @return Index of the thread's queue, or -1 if all queues are taken
+ */
+NCBI_XBLAST_EXPORT
+Int4 BlastSubjectSchedulerRegisterThread(BlastSubjectScheduler* sched);
+
+/** Queue one work unit for each chunk of a split subject.
+ * @param sched Scheduler [in] [out]
+ * @param thread_index Queue of the calling thread [in]
+ * @param job Engine data for the subject [in]
+ * @param num_chunks Number of chunks of the subject [in]
+ * @return 0 on success, BLASTERR_MEMORY if out of memory
+ */
+NCBI_XBLAST_EXPORT
+Int2 BlastSubjectSchedulerPush(BlastSubjectScheduler* sched,
+                               Int4 thread_index, void* job,
+                               Int4 num_chunks);
+
+/** Take the next work unit for the calling thread: the most recently queued
+ * unit of its own queue or, if that is empty and stealing is allowed, the
+ * oldest unit of the fullest queue of another thread.
+ * @param sched Scheduler [in] [out]
+ * @param thread_index Queue of the calling thread [in]
+ * @param steal Take units from other threads' queues? [in]
+ * @param unit The unit taken [out]
+ * @return TRUE if a unit was taken, FALSE if there was none to take
+ */
+NCBI_XBLAST_EXPORT
+Boolean BlastSubjectSchedulerPop(BlastSubjectScheduler* sched,
+                                 Int4 thread_index, Boolean steal,
+                                 BlastSubjectWorkUnit* unit);
+
+/** Account for one finished work unit of a split subject.
+ * @param sched Scheduler [in]
+ * @param units_left Number of units of the subject not yet finished;
+ *                   decremented under the scheduler's lock [in] [out]
+ * @return TRUE if this was the last unit of the subject
+ */
+NCBI_XBLAST_EXPORT
+Boolean BlastSubjectSchedulerUnitDone(BlastSubjectScheduler* sched,
+                                      Int4* units_left);
+
+/** Work counts of one thread. Each thread updates only its own entry, so
+ * no locking is needed.
+ * @param sched Scheduler [in]
+ * @param thread_index Queue of the calling thread [in]
+ * @return Counts for the thread
+ */
+NCBI_XBLAST_EXPORT
+BlastThreadStats* BlastSubjectSchedulerGetStats(BlastSubjectScheduler* sched,
+                                                Int4 thread_index);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !ALGO_BLAST_CORE__BLAST_SUBJECT_SCHED__H */
@@ -46,6 +46,8 @@
 #include <algo/blast/core/blast_gapalign.h>
 #include <algo/blast/core/blast_hspstream.h>
 #include <algo/blast/core/pattern.h>
+#include <algo/blast/core/blast_kappa.h>
+#include <connect/ncbi_core.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -213,6 +215,122 @@ Blast_RunTracebackSearchWithInterrupt(EBlastProgramType program,
    SPHIPatternSearchBlk* pattern_blk, BlastHSPResults** results,
    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info);
 
+/** HSP lists of a multi-threaded traceback, shared by its threads. The
+ * threads take whole subjects, so that each subject sequence is fetched by
+ * one thread only. When the alignments are recomputed with
+ * composition-based statistics, the HSP lists are instead read by the
+ * first thread into redo_work, which the threads share.
+ */
+typedef struct BlastTracebackWork {
+    BlastHSPList** hsplist_array; /**< HSP lists of all subjects, in the
+                                       order they are read from the stream */
+    Int4* subject_starts;   /**< Index in hsplist_array of the first list of
+                                 each subject; num_subjects + 1 entries */
+    Int4 num_subjects;      /**< Number of subjects with hits */
+    Int4 next_subject;      /**< Next subject to be taken by a thread */
+    Int4 threads_left;      /**< Number of threads not yet finished */
+    Int2 status;            /**< First nonzero status of any thread */
+    BlastHSPStream* hsp_stream; /**< Stream the lists were read from */
+    BlastHSPResults* results;   /**< Results, set by the last thread */
+    Boolean redo_alignments; /**< Are the alignments recomputed with
+                                  composition-based statistics? */
+    Boolean set_up;         /**< Have the parameters below and redo_work
+                                 been set up (or failed to be)? */
+    Int4 num_threads;       /**< Number of threads running the traceback */
+    BlastRedoAlignmentWork* redo_work; /**< Work of the threads recomputing
+                                            the alignments */
+    BlastScoringParameters* score_params; /**< Scoring parameters, rescaled
+                                               while redo_work exists */
+    BlastExtensionParameters* ext_params; /**< Gapped extension
+                                               parameters */
+    BlastHitSavingParameters* hit_params; /**< Hit saving parameters */
+    BlastEffectiveLengthsParameters* eff_len_params; /**< Effective length
+                                                          parameters */
+    MT_LOCK lock;           /**< Protects the subject and thread counts,
+                                 the status and the set up of the
+                                 parameters and redo_work */
+} BlastTracebackWork;
+
+/** Can the traceback stage of a search be split among several threads?
+ * The standard traceback of database searches and the recomputation of
+ * their alignments with composition-based statistics are supported.
+ * @param program BLAST program type [in]
+ * @param ext_options Gapped extension options [in]
+ * @param seq_src Source of subject sequences [in]
+ * @return TRUE if Blast_RunTracebackSearchThread can be used
+ */
+NCBI_XBLAST_EXPORT
+Boolean
+Blast_TracebackSupportsThreads(EBlastProgramType program,
+                               const BlastExtensionOptions* ext_options,
+                               const BlastSeqSrc* seq_src);
+
+/** Close an HSP stream and take all its HSP lists for a multi-threaded
+ * traceback. If the alignments are to be recomputed with composition-based
+ * statistics, the lists are left in the stream for the first thread.
+ * @param program BLAST program type [in]
+ * @param ext_options Gapped extension options [in]
+ * @param hsp_stream Source of HSP lists [in] [out]
+ * @param num_threads Number of threads that will run the traceback [in]
+ * @param lock Mutex shared by the threads; the structure takes ownership
+ *             of it [in]
+ * @return New structure or NULL if out of memory
+ */
+NCBI_XBLAST_EXPORT
+BlastTracebackWork*
+BlastTracebackWorkNew(EBlastProgramType program,
+                      const BlastExtensionOptions* ext_options,
+                      BlastHSPStream* hsp_stream, Int4 num_threads,
+                      MT_LOCK lock);
+
+/** Free the work of a multi-threaded traceback, along with any HSP lists and
+ * results it still owns.
+ * @param work Structure to free [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+BlastTracebackWork*
+BlastTracebackWorkFree(BlastTracebackWork* work);
+
+/** Entry point for one thread of a multi-threaded traceback. The first
+ * thread sets up the parameters in work; each thread then copies them,
+ * creates its own gapped alignment structure, and performs
+ * the traceback for the subjects it takes from the shared work. The last
+ * thread to finish saves the HSP lists of all subjects in work->results in
+ * the order of the single-threaded traceback, so the results are the same.
+ * @param program BLAST program type [in]
+ * @param query Query sequence(s) structure [in]
+ * @param query_info Additional query information [in]
+ * @param seq_src Source of subject sequences, owned by the thread [in]
+ * @param score_options Scoring options [in]
+ * @param ext_options Word extension options [in]
+ * @param hit_options Hit saving options [in]
+ * @param eff_len_options Options for calculating effective lengths [in]
+ * @param db_options Database options (database genetic code) [in]
+ * @param psi_options PSI-BLAST options, used to recompute alignments with
+ *                    composition-based statistics [in]
+ * @param sbp Scoring block with statistical parameters and matrix, shared
+ *            by all threads [in]
+ * @param work Work shared by the threads [in] [out]
+ * @param interrupt_search User specified function to interrupt search [in]
+ * @param progress_info User supplied data structure to aid interrupt; one
+ *                      per thread [in]
+ * @return Status of the calling thread; work->status holds the status of
+ *         the whole traceback
+ */
+NCBI_XBLAST_EXPORT
+Int2
+Blast_RunTracebackSearchThread(EBlastProgramType program,
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const BlastDatabaseOptions* db_options,
+   const PSIBlastOptions* psi_options, BlastScoreBlk* sbp,
+   BlastTracebackWork* work, TInterruptFnPtr interrupt_search,
+   SBlastProgress* progress_info);
+
 #ifdef __cplusplus
 }
 #endif
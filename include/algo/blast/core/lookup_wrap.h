@@ -58,8 +58,18 @@ typedef struct LookupTableWrap {
                                       search */
    void* lookup_callback;    /**< function used to look up an
                                   index->q_off pair */
+   const void* image;   /**< read-only image holding the arrays of the
+                             lookup table (see LookupTableWrapImageAttach),
+                             or NULL if the arrays were allocated */
+   void* image_owner;   /**< passed to image_release */
+   void* image_release; /**< function of type T_LookupTableImageRelease
+                             called with image_owner when the lookup table
+                             is freed; may be NULL */
 } LookupTableWrap;
 
+/** Function pointer type to release the image of a lookup table */
+typedef void (*T_LookupTableImageRelease)(void *);
+
 /** Function pointer type to check the presence of index->q_off pair */
 typedef Boolean (*T_Lookup_Callback)(const LookupTableWrap *, Int4, Int4);
 
@@ -86,6 +96,72 @@ Int2 LookupTableWrapInit(BLAST_SequenceBlk* query,
 NCBI_XBLAST_EXPORT
 LookupTableWrap* LookupTableWrapFree(LookupTableWrap* lookup);
 
+/** Current version of the lookup table image format */
+#define LOOKUP_TABLE_IMAGE_VERSION 1
+
+/** Compute a fingerprint of everything LookupTableWrapInit builds a lookup
+ * table from, so that an image of the table (see LookupTableWrapImageWrite)
+ * is only reused for the same query and options. The parameters are those
+ * of LookupTableWrapInit.
+ * @param query The query sequence [in]
+ * @param lookup_options What kind of lookup table to build? [in]
+ * @param query_options options for query setup [in]
+ * @param lookup_segments Locations on query to be used for lookup table
+ *                        construction [in]
+ * @param sbp Scoring block containing matrix [in]
+ * @return the fingerprint
+ */
+NCBI_XBLAST_EXPORT
+Uint8 LookupTableWrapFingerprint(const BLAST_SequenceBlk* query,
+        const LookupTableOptions* lookup_options,
+        const QuerySetUpOptions* query_options,
+        const BlastSeqLoc* lookup_segments, const BlastScoreBlk* sbp);
+
+/** Size of the image of a lookup table. Only the standard, small and
+ * megablast nucleotide tables and the (uncompressed) protein table can be
+ * saved in an image.
+ * @param lookup The lookup table [in]
+ * @param query The query the table was built for [in]
+ * @return the size in bytes, or 0 if the table cannot be saved
+ */
+NCBI_XBLAST_EXPORT
+size_t LookupTableWrapImageSize(const LookupTableWrap* lookup,
+                                const BLAST_SequenceBlk* query);
+
+/** Save a lookup table in an image that can be written to a file and
+ * memory-mapped by other processes.
+ * @param lookup The lookup table [in]
+ * @param query The query the table was built for [in]
+ * @param fingerprint Fingerprint of the table, from
+ *                    LookupTableWrapFingerprint [in]
+ * @param image Buffer for the image, aligned at least to 8 bytes [out]
+ * @param image_size Size of the buffer, from LookupTableWrapImageSize [in]
+ * @return 0 on success, -1 if the table cannot be saved
+ */
+NCBI_XBLAST_EXPORT
+Int2 LookupTableWrapImageWrite(const LookupTableWrap* lookup,
+                               const BLAST_SequenceBlk* query,
+                               Uint8 fingerprint, void* image,
+                               size_t image_size);
+
+/** Create a lookup table whose arrays are those of an image saved by
+ * LookupTableWrapImageWrite, without copying them. The image must remain
+ * valid, and is not modified, until the lookup table is freed; set
+ * image_owner and image_release of the table to release it then.
+ * @param image The image [in]
+ * @param image_size Size of the image [in]
+ * @param fingerprint Fingerprint expected in the image [in]
+ * @param query The query the table is for, prepared as LookupTableWrapInit
+ *              would prepare it [in] [out]
+ * @param lookup_wrap_ptr The lookup table [out]
+ * @return 0 on success, -1 if the image is not a valid image of a table
+ *         with this fingerprint built by this version of the library
+ */
+NCBI_XBLAST_EXPORT
+Int2 LookupTableWrapImageAttach(const void* image, size_t image_size,
+                                Uint8 fingerprint, BLAST_SequenceBlk* query,
+                                LookupTableWrap** lookup_wrap_ptr);
+
 /** Default size of offset arrays filled in a single ScanSubject call. */
 #define OFFSET_ARRAY_SIZE 4096
 
@@ -637,8 +637,15 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
           */
         struct SSearchOptions
         {
+            /** Object constructor; a single search thread is used
+                by default.
+            */
+            SSearchOptions() : word_size( 0 ), two_hits( 0 ), n_threads( 1 )
+            {}
+
             unsigned long word_size;            /**< Target seed length. */
             unsigned long two_hits;             /**< Window for two-hit method (see megablast docs). */
+            unsigned long n_threads;            /**< Number of threads searching the index. */
         };
 
         /** Create an index object.
@@ -756,6 +763,12 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
 
         /** Search the index.
 
+          If search_options.n_threads is greater than 1, the search is run
+          by that many threads of a pool shared by all index searches. The
+          threads scan separate parts of the query, then compute the seeds
+          of separate ranges of logical subjects. The seeds found are the
+          same as those of a single threaded search.
+
           @param query          [I]     the query sequence in BLASTNA format
           @param locs           [I]     which parts of the query to search
           @param search_options [I]     search parameters
@@ -60,11 +60,13 @@ class NCBI_XBLAST_EXPORT CSequenceIStreamBlastDB : public CSequenceIStream
             @param dbname         [I]     name of the BLAST database
             @param use_filter     [I]     use/not use subject masking
             @param filter_algo_id [I]     filtering algorithm
+            @param start_oid      [I]     OID of the first sequence to read
         */
         CSequenceIStreamBlastDB( 
                 const string & dbname, 
                 bool use_filter, 
-                int filter_algo_id = 0 );
+                int filter_algo_id = 0,
+                CSeqDB::TOID start_oid = 0 );
 
         /** Object destructor. */
         virtual ~CSequenceIStreamBlastDB() {}
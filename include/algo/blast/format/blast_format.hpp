@@ -294,6 +294,8 @@ private:
     bool m_DisableKAStats;
     /// The custom output format specification
     string m_CustomOutputFormatSpec;
+    /// Subject information shared by the tabular reports of all queries
+    CRef<align_format::CBlastTabularSubjectCache> m_TabularSubjectCache;
 
     /// Flag indicating a non-Blast DB source of subject sequences.
     bool m_IsNonBlastDB;
@@ -95,9 +95,31 @@ public:
     /// and delete it correspondingly.
     static void Delete(const CObject* object);
 
+    /// statistics, e.g. to tune the chunk size for a kind of data
+
+    /// Get number of memory blocks allocated from the pool chunks.
+    size_t GetAllocatedCount(void) const;
+
+    /// Get number of bytes allocated from the pool chunks,
+    /// including block headers and alignment.
+    size_t GetAllocatedSize(void) const;
+
+    /// Get number of chunks allocated from system heap.
+    /// Chunks are freed when all blocks allocated from them are deallocated,
+    /// so they may outlive the pool.
+    size_t GetChunkCount(void) const;
+
+    /// Get number of blocks refused because they are bigger than
+    /// the malloc threshold; the callers allocate them from system heap.
+    size_t GetMallocCount(void) const;
+
 private:
     size_t m_ChunkSize;
     size_t m_MallocThreshold;
+    size_t m_AllocatedCount;
+    size_t m_AllocatedSize;
+    size_t m_ChunkCount;
+    size_t m_MallocCount;
     CRef<CObjectMemoryPoolChunk> m_CurrentChunk;
 
 private:
@@ -124,6 +146,34 @@ size_t CObjectMemoryPool::GetMallocThreshold(void) const
 }
 
 
+inline
+size_t CObjectMemoryPool::GetAllocatedCount(void) const
+{
+    return m_AllocatedCount;
+}
+
+
+inline
+size_t CObjectMemoryPool::GetAllocatedSize(void) const
+{
+    return m_AllocatedSize;
+}
+
+
+inline
+size_t CObjectMemoryPool::GetChunkCount(void) const
+{
+    return m_ChunkCount;
+}
+
+
+inline
+size_t CObjectMemoryPool::GetMallocCount(void) const
+{
+    return m_MallocCount;
+}
+
+
 END_NCBI_SCOPE
 
 /* @} */
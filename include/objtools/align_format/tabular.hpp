@@ -42,6 +42,7 @@
 #include <objtools/blast/seqdb_reader/seqdb.hpp>
 #include <algo/blast/igblast/igblast.hpp>
 #include <objects/blastdb/Blast_def_line_set.hpp>
+#include <objmgr/seq_id_handle.hpp>
 
 #include <algorithm>
 
@@ -49,6 +50,65 @@ BEGIN_NCBI_SCOPE
 BEGIN_SCOPE(align_format)
 
 
+/// Subject sequence information looked up while formatting tabular output,
+/// kept across alignments and result sets so that the Bioseq and the
+/// Blast-def-line-set of each subject are retrieved, and its Seq-id strings
+/// built, only once. Entries depend on the fields requested, so an instance
+/// must only be shared by CBlastTabularInfo objects with the same format;
+/// it is not thread safe.
+class NCBI_ALIGN_FORMAT_EXPORT CBlastTabularSubjectCache : public CObject
+{
+public:
+    /// Information about one subject sequence
+    struct SSubjectInfo : public CObject {
+        SSubjectInfo() : m_IsNa(false), m_Length(0), m_HasTaxInfo(false) {}
+
+        /// Seq-ids of all redundant sequences
+        vector<list<CRef<objects::CSeq_id> > > m_Ids;
+        bool m_IsNa;                ///< Is the subject a nucleotide?
+        TSeqPos m_Length;           ///< Length of the subject
+        CRef<objects::CBlast_def_line_set> m_Defline;  ///< May be empty
+        bool m_HasTaxInfo;          ///< Are the fields below set?
+        set<int> m_TaxIds;
+        vector<string> m_SciNames;
+        vector<string> m_CommonNames;
+        set<string> m_BlastNames;
+        set<string> m_SuperKingdoms;
+        /// Strings of the first Seq-id list, indexed by
+        /// CBlastTabularInfo::ESeqIdType; built when first printed
+        map<int, string> m_IdStrings;
+    };
+
+    /// Default maximum number of subjects cached
+    static const size_t kDefaultMaxSubjects = 50000;
+
+    /// Constructor
+    /// @param max_subjects The cache is emptied when it holds more subjects
+    /// than this [in]
+    CBlastTabularSubjectCache(size_t max_subjects = kDefaultMaxSubjects)
+        : m_MaxSubjects(max_subjects) {}
+
+    /// Find the information about a subject
+    /// @param id Seq-id of the subject in the alignment [in]
+    /// @return the information or NULL if the subject is not cached
+    CRef<SSubjectInfo> Find(const objects::CSeq_id& id) const;
+
+    /// Add the information about a subject
+    /// @param id Seq-id of the subject in the alignment [in]
+    /// @param info Information to cache [in]
+    void Add(const objects::CSeq_id& id, CRef<SSubjectInfo> info);
+
+    /// Remove all subjects
+    void Clear() { m_Subjects.clear(); }
+
+private:
+    typedef map<objects::CSeq_id_Handle, CRef<SSubjectInfo> > TSubjects;
+
+    size_t m_MaxSubjects;       ///< Maximum number of subjects cached
+    TSubjects m_Subjects;       ///< The cached subjects
+};
+
+
 /// Class containing information needed for tabular formatting of BLAST 
 /// results.
 class NCBI_ALIGN_FORMAT_EXPORT CBlastTabularInfo : public CObject 
@@ -169,6 +229,13 @@ public:
     /// Avoid fetch of sequence if true returned
     bool GetNoFetch();
 
+    /// Look up the subject information in, and add it to, a cache shared
+    /// with other objects formatting the same fields
+    /// @param cache Subject cache, NULL to disable caching [in]
+    void SetSubjectCache(CRef<CBlastTabularSubjectCache> cache) {
+        m_SubjectCache = cache;
+    }
+
 protected:
     bool x_IsFieldRequested(ETabularField field);
     /// Add a field to the list of fields to show, if it is not yet present in
@@ -280,6 +347,12 @@ protected:
     void x_SetSubjectId(const objects::CBioseq_Handle& bh, const CRef<objects::CBlast_def_line_set> & bdlRef);
     void x_SetQueryCovSubject(const objects::CSeq_align & align);
     void x_SetQueryCovSeqalign(const CSeq_align & align, int query_len);
+    bool x_SetSubjectFromCache(const objects::CSeq_id& id, bool set_tax_info,
+                               bool set_title);
+    void x_AddSubjectToCache(const objects::CSeq_id& id, bool is_na,
+                             const CRef<objects::CBlast_def_line_set>& bdlRef,
+                             bool set_tax_info);
+    string x_GetSubjectIdString(ESeqIdType id_type);
 
     CNcbiOstream& m_Ostream; ///< Stream to write output to
     char m_FieldDelimiter;   ///< Delimiter character for fields to print.
@@ -326,6 +399,11 @@ private:
     string m_SubjectStrand;
     pair<string, int>  m_QueryCovSubject;
     int m_QueryCovSeqalign;
+
+    /// Subject information shared with other objects, may be NULL
+    CRef<CBlastTabularSubjectCache> m_SubjectCache;
+    /// Cached information about the current subject, may be NULL
+    CRef<CBlastTabularSubjectCache::SSubjectInfo> m_SubjectInfo;
 };
 
 
@@ -351,6 +351,30 @@ public:
     ///   Returns true if the mapping succeeded.
     bool MapMmap(CSeqDBAtlas * atlas);
     
+    /// Choose the file range to memory map
+    /// 
+    /// This is the part of MapMmap() that needs the atlas: the range
+    /// is widened to the whole file or rounded up to the nearest slice
+    /// boundary, and the atlas may collect garbage to make room for
+    /// it.  The atlas lock must be held.
+    /// 
+    /// @param atlas
+    ///   Pointer to the atlas.
+    /// @param file_length
+    ///   The length of the file.
+    void RoundupMmap(CSeqDBAtlas * atlas, TIndx file_length);
+    
+    /// Memory map the range chosen by RoundupMmap()
+    /// 
+    /// This does not use the atlas, so it can be called without the
+    /// atlas lock for a region that the atlas does not know yet.
+    /// 
+    /// @param mode
+    ///   How the atlas maps files.
+    /// @return
+    ///   Returns true if the mapping succeeded.
+    bool MapMmapRange(ESeqDBMapMode mode);
+    
     /// Read a region of a file into memory
     /// 
     /// This uses CNcbiIfstream to read the file region associated
@@ -636,6 +660,14 @@ public:
 private:
     CLASS_MARKER_FIELD("REGM")
     
+    /// Memory map the range of the file held by this object.
+    /// 
+    /// Errors are reported by exceptions.
+    /// 
+    /// @param mode
+    ///   How the atlas maps files.
+    void x_MapRange(ESeqDBMapMode mode);
+    
     /// Compute the penalty and the expanded offset range.
     /// 
     /// The files are normally divided into "slices".  When a mapping
@@ -1748,6 +1780,72 @@ public:
     ///
     /// @param bytes Number of bytes to use as the global memory bound.
     static void SetDefaultMemoryBound(Uint8 bytes);
+    
+    /// Set the global default mapping mode.
+    ///
+    /// The atlas is shared by all SeqDB objects, so this only affects
+    /// atlas objects constructed after it is called.
+    ///
+    /// @param mode How the files of database volumes are mapped.
+    static void SetDefaultMapMode(ESeqDBMapMode mode);
+    
+    /// Get the mapping mode of this atlas.
+    ESeqDBMapMode GetMapMode() const
+    {
+        return m_MapMode;
+    }
+    
+    /// Map a file region ahead of use and ask the kernel to read it.
+    ///
+    /// This is a hint; errors are ignored and nothing is done unless
+    /// memory mapping is enabled.  In slice mode the region is limited
+    /// to one slice.
+    ///
+    /// @param fname
+    ///   The name of the file.
+    /// @param begin
+    ///   The start offset of the region.
+    /// @param end
+    ///   The end offset of the region.
+    /// @param locked
+    ///   The lock holder object for this thread.
+    void Prefetch(const string   & fname,
+                  TIndx            begin,
+                  TIndx            end,
+                  CSeqDBLockHold & locked);
+    
+    /// Map a whole file and keep it mapped.
+    ///
+    /// This only works in the whole-file mapping modes, where a file
+    /// is mapped by one region.  The region gets a reference that
+    /// keeps it from being collected, so the returned pointer can be
+    /// read without holding the atlas lock.  The reference must be
+    /// released by passing the pointer to RetRegion().
+    ///
+    /// @param fname
+    ///   The name of the file.
+    /// @param length
+    ///   The returned length of the file.
+    /// @param locked
+    ///   The lock holder object for this thread.
+    /// @return
+    ///   A pointer to the first byte of the file, or NULL if the file
+    ///   is empty or the atlas maps files in slices.
+    const char * PinFile(const string   & fname,
+                         TIndx          & length,
+                         CSeqDBLockHold & locked);
+    
+    /// Get the mapping counters.
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread.
+    /// @return
+    ///   The counts accumulated since the atlas was constructed.
+    SSeqDBAtlasStats GetStats(CSeqDBLockHold & locked)
+    {
+        Lock(locked);
+        return m_Stats;
+    }
 
     /// Get BlastDB search path.
     const string GetSearchPath() const 
@@ -1849,6 +1947,16 @@ private:
                              const char    ** start,
                              CRegionMap    ** rmap);
     
+    /// Add a newly mapped region to the atlas.
+    /// 
+    /// The region is added to the lookup tables and counted in the
+    /// memory in use and the statistics.  The lock is assumed to be
+    /// already held.
+    /// 
+    /// @param nregion
+    ///   The mapped region; the atlas takes ownership of it.
+    void x_AddRegion(CRegionMap * nregion);
+    
     /// Try to find the region and free it.
     /// 
     /// This method looks for the region in the memory pool (m_Pool),
@@ -2058,6 +2166,18 @@ private:
 
     /// BlastDB search path.
     const string m_SearchPath;
+    
+    /// How the files are mapped.
+    ESeqDBMapMode m_MapMode;
+    
+    /// Mapping counters.
+    SSeqDBAtlasStats m_Stats;
+    
+    /// Files with regions released by garbage collection, by fid.
+    set<int> m_CollectedFids;
+    
+    /// Mapping mode of new atlas objects.
+    static ESeqDBMapMode m_DefaultMapMode;
 };
 
 // Assumes lock is held.
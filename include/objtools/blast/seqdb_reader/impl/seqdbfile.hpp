@@ -324,6 +324,35 @@ public:
         m_Lease.Clear();
     }
     
+    /// Map part of the file ahead of use and start reading it.
+    ///
+    /// @param start
+    ///   The starting offset for the first byte of the region.
+    /// @param end
+    ///   The offset for the first byte after the region.
+    /// @param locked
+    ///   The lock holder object for this thread.
+    void Prefetch(TIndx start, TIndx end, CSeqDBLockHold & locked) const
+    {
+        m_Atlas.Prefetch(m_FileName, start, end, locked);
+    }
+    
+    /// Map the whole file and keep it mapped.
+    ///
+    /// The returned data stays valid without the atlas lock until it
+    /// is released with CSeqDBAtlas::RetRegion().
+    ///
+    /// @param length
+    ///   The returned length of the file.
+    /// @param locked
+    ///   The lock holder object for this thread.
+    /// @return
+    ///   The file data, or NULL if the atlas maps files in slices.
+    const char * PinWholeFile(TIndx & length, CSeqDBLockHold & locked) const
+    {
+        return m_Atlas.PinFile(m_FileName, length, locked);
+    }
+    
 protected:
     /// Get a region of the file
     ///
@@ -638,6 +667,22 @@ public:
         return m_MinLen;
     }
     
+    /// Get the file offsets of the sequence and ambiguity offset tables.
+    ///
+    /// These let a caller holding a mapping of the whole index file
+    /// read the tables directly.  The ambiguity table offset is zero
+    /// for protein volumes.
+    ///
+    /// @param seq_table
+    ///   The returned offset of the sequence offset table.
+    /// @param amb_table
+    ///   The returned offset of the ambiguity offset table.
+    void GetOffsetTables(TIndx & seq_table, TIndx & amb_table) const
+    {
+        seq_table = m_OffSeq;
+        amb_table = m_OffAmb;
+    }
+    
     /// Release any memory leases temporarily held here.
     void UnLease()
     {
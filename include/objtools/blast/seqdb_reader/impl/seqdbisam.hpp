@@ -113,6 +113,29 @@ s_SetTranslation(CSeqDBGiList & gis,
         ++gi_index;
     }
 }
+
+// collect the translation (if we have it) for those GIs, or apply it
+// if there is nowhere to collect it.
+template <class T> static inline void
+s_SetTranslation(CSeqDBGiList               & gis,
+                 int                        & gi_index,
+                 int                          gis_size,
+                 const T                    & key,
+                 int                          value,
+                 vector< pair<int, int> >   * found)
+{
+    if (! found) {
+        s_SetTranslation<T>(gis, gi_index, gis_size, key, value);
+        return;
+    }
+    
+    while( (gi_index < gis_size) 
+       &&  (gis.GetKey<T>(gi_index) == key)) {
+
+        found->push_back(make_pair(gi_index, value));
+        ++gi_index;
+    }
+}
     
 /// CSeqDBIsam
 /// 
@@ -249,6 +272,48 @@ public:
                    CSeqDBGiList   & ids,
                    CSeqDBLockHold & locked);
     
+    /// Translations found by a batch lookup.
+    ///
+    /// Each element holds the index of an ID in the ID list and the
+    /// OID found for it.
+    typedef vector< pair<int, int> > TBatchResult;
+    
+    /// Prepare a batch translation of an ID list.
+    ///
+    /// The whole index and data files are mapped and held until
+    /// EndBatch() is called, so that BatchIdsToOids() can run without
+    /// the atlas lock, for example in parallel with batch lookups in
+    /// the ISAM files of other volumes.
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread. [in|out]
+    /// @return
+    ///   False if this file can only be searched under the lock.
+    bool BeginBatch(CSeqDBLockHold & locked);
+    
+    /// Find the OIDs of the untranslated IDs of a list.
+    ///
+    /// This does the same merge of the sorted ID list with the data
+    /// pages as IdsToOids(), but reads the data held by BeginBatch()
+    /// and does not modify the ID list, which must already be sorted.
+    /// The atlas lock is not needed.
+    ///
+    /// @param vol_start
+    ///   The starting OID of this volume. [in]
+    /// @param ids
+    ///   The sorted set of ID-OID pairs. [in]
+    /// @param found
+    ///   The translations found. [out]
+    void BatchIdsToOids(int              vol_start,
+                        CSeqDBGiList   & ids,
+                        TBatchResult   & found);
+    
+    /// Release the data held by BeginBatch().
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread. [in|out]
+    void EndBatch(CSeqDBLockHold & locked);
+    
     /// Compute list of included OIDs based on a negative ID list.
     ///
     /// This method iterates over a vector of Gis or Tis, along with
@@ -564,18 +629,86 @@ private:
 
         vector<T> sample_keys;
         vector<TIndx> page_offs;
-        vector<T> keys;
-        vector<int> vals;
 
         sample_keys.reserve(m_NumSamples);
         page_offs.reserve(m_NumSamples + 1);
-        keys.reserve(m_PageSize);
-        vals.reserve(m_PageSize);
         
         m_Atlas.GetRegion(lease, m_IndexFname, 0, m_IndexFileLength);
         x_LoadIndex(lease, sample_keys, page_offs);
         m_Atlas.RetRegion(lease);
 
+        x_SweepGiList<T>(vol_start, gis, sample_keys, page_offs,
+                         NULL, NULL);
+    }
+    
+    /// Batch GiList Translation
+    /// 
+    /// Given a sorted GI list, this routine finds the OID for each ID
+    /// in the list not already having a translation, reading the
+    /// files held by BeginBatch().
+    /// 
+    /// @param vol_start
+    ///   The starting OID for this ISAM file's database volume.
+    /// @param gis
+    ///   The GI list to translate.
+    /// @param found
+    ///   The translations found.
+    template <class T>
+    void x_BatchTranslateGiList(int            vol_start,
+                                CSeqDBGiList & gis,
+                                TBatchResult & found)
+    {
+        if (! gis.GetSize<T>()) return;
+
+        vector<T> sample_keys;
+        vector<TIndx> page_offs;
+
+        sample_keys.reserve(m_NumSamples);
+        page_offs.reserve(m_NumSamples + 1);
+        
+        x_LoadIndex(m_BatchIndexLease, sample_keys, page_offs);
+        
+        x_SweepGiList<T>(vol_start, gis, sample_keys, page_offs,
+                         & m_BatchDataLease, & found);
+    }
+    
+    /// Merge a sorted GI list with the data pages
+    /// 
+    /// The data pages holding the untranslated IDs of the list are
+    /// read in file order.  If data_lease is specified, it holds the
+    /// whole data file and no atlas calls are made; otherwise each
+    /// page is mapped in turn, which assumes the atlas lock is held.
+    /// 
+    /// @param vol_start
+    ///   The starting OID for this ISAM file's database volume.
+    /// @param gis
+    ///   The sorted GI list to translate.
+    /// @param sample_keys
+    ///   The keys sampled in the index file.
+    /// @param page_offs
+    ///   The data file offsets of the pages.
+    /// @param data_lease
+    ///   A lease on the whole data file, or NULL.
+    /// @param found
+    ///   Where to put the translations, or NULL to store them in gis.
+    template <class T>
+    void x_SweepGiList(int                   vol_start,
+                       CSeqDBGiList        & gis,
+                       const vector<T>     & sample_keys,
+                       const vector<TIndx> & page_offs,
+                       CSeqDBMemLease      * data_lease,
+                       TBatchResult        * found)
+    {
+        int gilist_size = gis.GetSize<T>();
+        
+        CSeqDBMemLease lease(m_Atlas);
+        
+        vector<T> keys;
+        vector<int> vals;
+
+        keys.reserve(m_PageSize);
+        vals.reserve(m_PageSize);
+        
         int gilist_index = 0;
         int sample_index = 0;
 
@@ -598,12 +731,18 @@ private:
                 num_keys = m_NumTerms - sample_index * m_PageSize;
             }
 
-            m_Atlas.GetRegion(lease, 
-                              m_DataFname,
-                              page_offs[sample_index],
-                              page_offs[sample_index + 1]);
-            x_LoadData(lease, keys, vals, num_keys, page_offs[sample_index]);
-            m_Atlas.RetRegion(lease);
+            if (data_lease) {
+                x_LoadData(*data_lease, keys, vals, num_keys,
+                           page_offs[sample_index]);
+            } else {
+                m_Atlas.GetRegion(lease, 
+                                  m_DataFname,
+                                  page_offs[sample_index],
+                                  page_offs[sample_index + 1]);
+                x_LoadData(lease, keys, vals, num_keys,
+                           page_offs[sample_index]);
+                m_Atlas.RetRegion(lease);
+            }
 
             int index = 0;
 
@@ -613,7 +752,8 @@ private:
                                     gis.GetKey<T>(gilist_index));
 
                 s_SetTranslation<T>(gis, gilist_index, gilist_size,
-                                    keys[index], vals[index] + vol_start);
+                                    keys[index], vals[index] + vol_start,
+                                    found);
 
                 ++index;
                 if (index >= num_keys) break;
@@ -621,7 +761,8 @@ private:
                 s_AdvanceGiList<T>(gis, gilist_index, gilist_size, keys[index]); 
 
                 s_SetTranslation<T>(gis, gilist_index, gilist_size,
-                                    keys[index], vals[index] + vol_start);
+                                    keys[index], vals[index] + vol_start,
+                                    found);
 
             }
                                      
@@ -1174,6 +1315,12 @@ private:
     /// A persistent lease on the ISAM data file.
     CSeqDBMemLease m_DataLease;
     
+    /// A lease on the whole index file, held during a batch lookup.
+    CSeqDBMemLease m_BatchIndexLease;
+    
+    /// A lease on the whole data file, held during a batch lookup.
+    CSeqDBMemLease m_BatchDataLease;
+    
     /// The format type of database files found (eNumeric or eString).
     int m_Type;
     
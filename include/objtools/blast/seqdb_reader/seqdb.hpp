@@ -928,6 +928,18 @@ public:
     /// Translate a GI to an OID.
     bool GiToOid(int gi, int & oid) const;
     
+    /// Translate the GIs, TIs and Seq-ids of a list to OIDs.
+    ///
+    /// This is much faster than looking up each ID separately: the
+    /// list is sorted and merged with the ISAM files of each volume
+    /// in one pass, and long lists search several volumes at once.
+    /// Each ID that is not already translated gets the OID of the
+    /// first volume containing it, as with GiToOid(); IDs not found
+    /// keep an OID of -1.  The OID mask is not applied.
+    ///
+    /// @param ids The list of IDs to translate. [in|out]
+    void IdsToOids(CSeqDBGiList & ids) const;
+    
     /// Translate a GI to a PIG.
     bool GiToPig(int gi, int & pig) const;
     
@@ -1035,6 +1047,22 @@ public:
     ///   If true, the search will traverse the full alias node tree
     void FindVolumePaths(vector<string> & paths, bool recursive=true) const;
     
+    /// Get the volumes in OID order
+    ///
+    /// This returns the base names of the volumes searched by this
+    /// object together with the first OID of each volume.  Unlike
+    /// FindVolumePaths(), the volumes are listed in the order of
+    /// their OID ranges; the OIDs of volume i run from oid_starts[i]
+    /// up to the start of the next volume, or GetNumOIDs() for the
+    /// last one.
+    ///
+    /// @param paths
+    ///   The returned volume base names
+    /// @param oid_starts
+    ///   The returned first OID of each volume
+    void GetVolumeOidStarts(vector<string> & paths,
+                            vector<int>    & oid_starts) const;
+    
     /// Set Iteration Range
     ///
     /// This method sets the iteration range as a pair of OIDs.
@@ -1118,6 +1146,46 @@ public:
     /// will be selected based on system information.
     static void SetDefaultMemoryBound(Uint8 bytes);
     
+    /// Set global default mapping mode for SeqDB.
+    ///
+    /// All SeqDB objects share one memory management layer, which is
+    /// created with the first of them and picks up this value.  Call
+    /// this before any SeqDB object is constructed.  Mapping whole
+    /// files avoids the remapping done to stay within the memory bound
+    /// and should only be used with enough memory for the database.
+    ///
+    /// @param mode How the files of database volumes are mapped.
+    static void SetDefaultMapMode(ESeqDBMapMode mode);
+    
+    /// Start reading the data of a range of OIDs.
+    ///
+    /// The sequence and header data of the OIDs is mapped ahead of use
+    /// and the operating system is asked to read it in, so that a scan
+    /// can overlap the reading of its next chunk of OIDs with the work
+    /// on the current one.  This is only a hint; it does not wait for
+    /// the data and ignores errors.
+    ///
+    /// @param first_oid The first OID of the range. [in]
+    /// @param end_oid The OID after the range. [in]
+    void PrefetchOidRange(int first_oid, int end_oid) const;
+    
+    /// Get the mapping counters of the memory management layer.
+    ///
+    /// The counters are shared by all SeqDB objects.
+    ///
+    /// @return The counts since the layer was created.
+    SSeqDBAtlasStats GetAtlasStats() const;
+    
+    /// Check whether sequences are retrieved without locking.
+    ///
+    /// If the files were mapped whole (see SetDefaultMapMode) and
+    /// every volume could be kept mapped, GetSequence, RetSequence and
+    /// GetSeqLength find the data without taking the lock shared by
+    /// all SeqDB objects, so they scale with the number of threads.
+    ///
+    /// @return True if the lock-free retrieval path is used.
+    bool IsLockFree() const;
+    
     /// Get a sequence in a given encoding.
     ///
     /// This method gets the sequence data for the given OID, converts
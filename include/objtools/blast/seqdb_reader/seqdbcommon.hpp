@@ -1401,6 +1401,71 @@ struct SSeqDBTaxInfo {
 };
 
 
+/// ESeqDBMapMode
+///
+/// How the memory management layer maps the files of a database
+/// volume.
+
+enum ESeqDBMapMode {
+    /// Map slices of the files, remapping them to stay within the
+    /// memory bound (the default).
+    eSeqDBMapSlices,
+    
+    /// Map each file whole, once, and ask the kernel to read it ahead.
+    /// Only the number of open mappings is bounded, which suits 64 bit
+    /// hosts with enough memory for the whole database.
+    eSeqDBMapWholeFiles,
+    
+    /// As eSeqDBMapWholeFiles, and also ask for transparent huge pages
+    /// where the operating system supports them.
+    eSeqDBMapWholeFilesHugePages
+};
+
+
+/// SSeqDBAtlasStats
+///
+/// Counts of the mapping activity of the memory management layer, for
+/// tuning the memory bound and the mapping mode.
+
+struct SSeqDBAtlasStats {
+    /// Default constructor
+    SSeqDBAtlasStats()
+        : maps(0), unmaps(0), remaps(0), bytes_mapped(0),
+          prefetches(0), bytes_prefetched(0)
+    {
+    }
+    
+    /// Number of file regions mapped (or read, without mmap).
+    Uint8 maps;
+    
+    /// Number of file regions released by garbage collection.
+    Uint8 unmaps;
+    
+    /// Number of regions mapped from a file after an earlier region
+    /// of the same file was released.
+    Uint8 remaps;
+    
+    /// Total size of the regions mapped.
+    Uint8 bytes_mapped;
+    
+    /// Number of prefetch requests for a file region.
+    Uint8 prefetches;
+    
+    /// Total size of the file data prefetched.
+    Uint8 bytes_prefetched;
+    
+    friend ostream& operator<<(ostream& out, const SSeqDBAtlasStats& rhs) {
+        out << "Maps=" << rhs.maps
+            << "\tUnmaps=" << rhs.unmaps
+            << "\tRemaps=" << rhs.remaps
+            << "\tBytesMapped=" << rhs.bytes_mapped
+            << "\tPrefetches=" << rhs.prefetches
+            << "\tBytesPrefetched=" << rhs.bytes_prefetched;
+        return out;
+    }
+};
+
+
 /// Resolve a file path using SeqDB's path algorithms.
 ///
 /// This finds a file using the same algorithm used by SeqDB to find
@@ -324,6 +324,22 @@ public:
     /// @param erase Will erase all files created if true.
     bool EndBuild(bool erase = false);
     
+    /// Close the volumes of a new database.
+    ///
+    /// The volumes and alias file are written, so the database can be
+    /// read, but the build is not finished: files derived from the
+    /// volumes can be added with AddExtraFile() before EndBuild() is
+    /// called.
+    /// @return True if at least one volume was created.
+    bool CloseVolumes();
+    
+    /// Add a file created alongside the new database.
+    ///
+    /// EndBuild() lists the file with those of the database, and
+    /// erases it with them if requested.
+    /// @param fname Name of the file.
+    void AddExtraFile(const string & fname);
+    
     /// Specify whether to use remote fetching for locally absent IDs.
     ///
     /// If identifiers in the list provided to Build or to AddIds is
@@ -373,6 +389,13 @@ public:
     /// @param max_file_size Maximum file size in bytes.
     void SetMaxFileSize(Uint8 max_file_size);
     
+    /// Set the number of threads used to write the database.
+    ///
+    /// The database files are the same for any number of threads.
+    ///
+    /// @param num_threads Number of threads to use.
+    void SetNumThreads(int num_threads);
+    
     /// Define a masking algorithm.
     ///
     /// The returned integer ID will be defined as corresponding to the
@@ -602,6 +625,9 @@ private:
     /// masking locations (via SetMaskDataSource). Used to display a warning in
     /// case this didn't happen
     bool m_FoundMatchingMasks;
+    
+    /// Files created alongside the database (see AddExtraFile).
+    vector<string> m_ExtraFiles;
 };
 
 END_NCBI_SCOPE
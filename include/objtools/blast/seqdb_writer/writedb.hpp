@@ -337,6 +337,16 @@ public:
     /// @param letters Maximum letters to pack in one volume. [in]
     void SetMaxVolumeLetters(Uint8 letters);
     
+    /// Set the number of threads used to build the database.
+    ///
+    /// With more than one thread, ISAM indices are sorted in parallel
+    /// and each full volume is finished in the background while the
+    /// next one is filled.  The database files are the same for any
+    /// number of threads.  The default is one thread.
+    ///
+    /// @param num_threads Number of threads to use. [in]
+    void SetNumThreads(int num_threads);
+    
     /// Extract Deflines From Bioseq.
     /// 
     /// Deflines are extracted from the CBioseq and returned to the
@@ -395,7 +395,13 @@ public:
     void Insert(const char * x, int L);
     
     /// Sort all contained data.
-    void Sort();
+    ///
+    /// The strings sharing each prefix are sorted separately, so the
+    /// work is shared among several threads if requested; the result
+    /// does not depend on the number of threads.
+    ///
+    /// @param num_threads Number of threads to sort with. [in]
+    void Sort(int num_threads = 1);
     
     /// Return the number of contained entries.
     int Size() const
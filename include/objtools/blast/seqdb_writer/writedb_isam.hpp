@@ -152,6 +152,29 @@ public:
     /// @return True if no sequences were added.
     bool Empty() const;
     
+    /// Set the number of threads used to sort the index.
+    ///
+    /// The files written do not depend on the number of threads.
+    ///
+    /// @param num_threads Number of threads. [in]
+    void SetNumThreads(int num_threads)
+    {
+        m_NumThreads = num_threads;
+    }
+    
+    /// Set the smallest numeric table sorted with several threads.
+    ///
+    /// Smaller tables are sorted by one thread, as that is faster.
+    /// Lowering the limit lets tests use the threaded sort on small
+    /// databases.  This applies to all indices.
+    ///
+    /// @param size Smallest number of table entries. [in]
+    static void SetMinParallelSortSize(size_t size);
+    
+    /// Get the smallest numeric table sorted with several threads.
+    /// @return Smallest number of table entries.
+    static size_t GetMinParallelSortSize();
+    
 private:
     enum {
         eKeyOffset       = 9*4,  ///< Offset of the key offset table.
@@ -166,6 +189,9 @@ private:
     /// Flush index data for a numeric ISAM file.
     void x_FlushNumericIndex();
     
+    /// Sort the numeric table, with m_NumThreads threads.
+    void x_SortNumberTable();
+    
     /// Flush index data for a string ISAM file.
     void x_FlushStringIndex();
     
@@ -314,6 +340,7 @@ private:
     int       m_PageSize;     ///< Ratio of samples to data records.
     int       m_BytesPerElem; ///< Byte (over)estimate per Seq-id.
     Uint8     m_DataFileSize; ///< Accumulated size of data file.
+    int       m_NumThreads;   ///< Threads used to sort the index.
     
     // Table data
     
@@ -483,6 +510,10 @@ public:
     /// @return Returns true if the IDs can fit into the volume.
     bool CanFit(int num);
     
+    /// Set the number of threads used to sort the index.
+    /// @param num_threads Number of threads. [in]
+    void SetNumThreads(int num_threads);
+    
     /// List Filenames
     ///
     /// Returns a list of the files constructed by this class; the
@@ -0,0 +1,243 @@
+#ifndef ASNINDEX__HPP
+#define ASNINDEX__HPP
+
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Index of the elements of a container in ASN binary data, for reading
+*   single elements without reading the data preceding them
+*/
+
+#include <corelib/ncbistd.hpp>
+#include <corelib/ncbiobj.hpp>
+#include <serial/objectinfo.hpp>
+#include <map>
+
+
+/** @addtogroup ObjStreamSupport
+ *
+ * @{
+ */
+
+
+BEGIN_NCBI_SCOPE
+
+class CObjectIStream;
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CAsnBinaryIndex --
+///
+/// Offsets of the elements of one container member (SET OF, SEQUENCE OF)
+/// of the root object of ASN binary data, and the keys identifying them
+/// (e.g. the Seq-ids of the Seq-entry elements of a Bioseq-set).
+///
+/// The index is built by CAsnBinaryIndexer, usually saved in a file next
+/// to the data file, and used by CAsnBinaryIndexedReader.
+class NCBI_XSERIAL_EXPORT CAsnBinaryIndex : public CObject
+{
+public:
+    typedef Int8 TOffset;
+
+    /// Position of an element in the data
+    struct SElement
+    {
+        TOffset m_Offset;   ///< Offset of the first byte of the element
+        TOffset m_Size;     ///< Number of bytes of the element
+    };
+    typedef vector<SElement> TElements;
+    /// Element index by key
+    typedef map<string, size_t> TKeys;
+
+    CAsnBinaryIndex(void);
+
+    /// Name of the type of the elements
+    const string& GetElementTypeName(void) const
+    {
+        return m_ElementTypeName;
+    }
+    void SetElementTypeName(const string& name)
+    {
+        m_ElementTypeName = name;
+    }
+
+    /// Add an element after the last one
+    ///
+    /// @return
+    ///   the index of the element
+    size_t AddElement(TOffset offset, TOffset size);
+    /// Add a key of an element; a key of several elements finds the first
+    /// one. Keys cannot be empty nor contain tabs or line breaks, which
+    /// separate them in the index file.
+    void AddKey(size_t index, const string& key);
+
+    size_t GetElementCount(void) const
+    {
+        return m_Elements.size();
+    }
+    const SElement& GetElement(size_t index) const;
+    const TKeys& GetKeys(void) const
+    {
+        return m_Keys;
+    }
+
+    /// Find the element with the key
+    ///
+    /// @return
+    ///   the index of the element, or NPOS if no element has the key
+    size_t FindElement(const string& key) const;
+
+    /// Save the index as text, one line per element
+    void Write(CNcbiOstream& out) const;
+    /// Load the index saved by Write, replacing the current contents
+    void Read(CNcbiIstream& in);
+
+private:
+    string m_ElementTypeName;
+    TElements m_Elements;
+    TKeys m_Keys;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CAsnBinaryIndexer --
+///
+/// Build the index of the elements of a container member of the root object
+/// of ASN binary input.
+///
+/// The root object is read as usual, except for the elements of the
+/// container member, which are not added to the container. Unless keys are
+/// wanted, the elements are skipped rather than decoded.
+///
+/// Usage:
+///    CObjectIStream* is = CObjectIStream::Open(eSerial_AsnBinary, ...);
+///    CAsnBinaryIndexer indexer(CBioseq_set::GetTypeInfo(), "seq-set",
+///                              &seq_id_keys);
+///    CRef<CAsnBinaryIndex> index = indexer.Index(*is);
+class NCBI_XSERIAL_EXPORT CAsnBinaryIndexer
+{
+public:
+    /// Provider of the keys of the elements
+    class NCBI_XSERIAL_EXPORT IKeySource
+    {
+    public:
+        virtual ~IKeySource(void);
+        /// Add the keys of a decoded element
+        virtual void GetKeys(const CConstObjectInfo& element,
+                             vector<string>& keys) = 0;
+    };
+
+    /// @param root
+    ///   Type of the root object; must be a class
+    /// @param container_member
+    ///   Name of the container member of the root class whose elements are
+    ///   indexed
+    /// @param keys
+    ///   Provider of the keys of the elements, or 0 for no keys; with keys
+    ///   the elements must be CObject-derived
+    CAsnBinaryIndexer(const CObjectTypeInfo& root,
+                      const string& container_member,
+                      IKeySource* keys = 0);
+
+    /// Index the elements of the root object read from the input
+    CRef<CAsnBinaryIndex> Index(CObjectIStream& in);
+
+private:
+    friend class CAsnBinaryIndexElementHook;
+
+    /// Add the element at the current position of the input
+    void x_AddElement(CObjectIStream& in);
+
+    CObjectTypeInfo m_Root;
+    string m_ContainerMember;
+    TTypeInfo m_ElementType;
+    IKeySource* m_Keys;
+    CRef<CAsnBinaryIndex> m_Index;  ///< Index being built
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CAsnBinaryIndexedReader --
+///
+/// Read single elements of a container in ASN binary input by seeking to
+/// their offsets in its index.
+///
+/// Usage:
+///    CAsnBinaryIndex index;
+///    index.Read(index_file);
+///    CObjectIStream* is = CObjectIStream::Open("data.asb",
+///                                              eSerial_AsnBinary);
+///    CAsnBinaryIndexedReader reader(*is, index);
+///    size_t i = reader.FindElement(key);
+///    if ( i != NPOS ) {
+///        CSeq_entry entry;
+///        reader.ReadElement(i, ObjectInfo(entry));
+///    }
+class NCBI_XSERIAL_EXPORT CAsnBinaryIndexedReader
+{
+public:
+    /// @param in
+    ///   ASN binary input stream; its underlying stream must be seekable
+    /// @param index
+    ///   Index of the input, must outlive the reader
+    /// @param element_type
+    ///   Type of the elements, or 0 to find it by the name in the index
+    CAsnBinaryIndexedReader(CObjectIStream& in,
+                            const CAsnBinaryIndex& index,
+                            TTypeInfo element_type = 0);
+
+    size_t GetElementCount(void) const
+    {
+        return m_Index.GetElementCount();
+    }
+    /// Find the element with the key
+    ///
+    /// @return
+    ///   the index of the element, or NPOS if no element has the key
+    size_t FindElement(const string& key) const
+    {
+        return m_Index.FindElement(key);
+    }
+
+    /// Read an element into an existing object
+    void ReadElement(size_t index, const CObjectInfo& element);
+    /// Read an element into a new object
+    CObjectInfo ReadElement(size_t index);
+
+private:
+    CObjectIStream& m_In;
+    const CAsnBinaryIndex& m_Index;
+    TTypeInfo m_ElementType;
+};
+
+
+/* @} */
+
+END_NCBI_SCOPE
+
+#endif  /* ASNINDEX__HPP */
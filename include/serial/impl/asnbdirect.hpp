@@ -0,0 +1,171 @@
+#ifndef ASNBDIRECT__HPP
+#define ASNBDIRECT__HPP
+
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Type-specific ASN.1 binary I/O of class members, used by the code
+*   generated by datatool for modules with "_asn_binary_io = yes" in their
+*   definition file
+*/
+
+#include <corelib/ncbistd.hpp>
+#include <serial/impl/classinfo.hpp>
+#include <serial/impl/member.hpp>
+#include <serial/objistrasnb.hpp>
+#include <serial/objostrasnb.hpp>
+
+
+/** @addtogroup ObjStreamSupport
+ *
+ * @{
+ */
+
+
+BEGIN_NCBI_SCOPE
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CAsnBinaryMemberReader --
+///
+/// Reads the members of a SEQUENCE class from ASN.1 binary input for its
+/// generated read function (see CClassTypeInfo::SetAsnBinaryFunctions).
+/// The generated function reads each member in order, the members of
+/// standard types (numbers, strings) directly into the object, and the
+/// others through their member information.
+/// A member with hooks on it or on its type is always read through its
+/// member information, so the hooks are called as usual.
+class NCBI_XSERIAL_EXPORT CAsnBinaryMemberReader
+{
+public:
+    CAsnBinaryMemberReader(CObjectIStreamAsnBinary& in,
+                           const CClassTypeInfo* classType,
+                           TObjectPtr classPtr)
+        : m_In(in), m_ClassType(classType), m_ClassPtr(classPtr),
+          m_HaveTag(false), m_End(false), m_Tag(0)
+        {
+        }
+
+    /// Read a member of a standard type
+    template<typename T>
+    void ReadStd(TMemberIndex index, T& data)
+        {
+            const CMemberInfo* memberInfo = m_ClassType->GetMemberInfo(index);
+            if ( !x_BeginMember(index, memberInfo) ) {
+                memberInfo->ReadMissingMember(m_In, m_ClassPtr);
+                return;
+            }
+            if ( memberInfo->HaveReadHooks() ||
+                 memberInfo->GetTypeInfo()->HaveReadHooks() ) {
+                memberInfo->ReadMember(m_In, m_ClassPtr);
+            }
+            else {
+                memberInfo->UpdateSetFlagYes(m_ClassPtr);
+                m_In.ReadStd(data);
+            }
+            m_In.ExpectEndOfContent();
+        }
+
+    /// Read any other member
+    void Read(TMemberIndex index);
+
+private:
+    friend class CObjectIStreamAsnBinary;
+
+    /// Peek the tag of the next member, if not peeked yet
+    void x_PeekTag(void);
+    /// Start reading the member if it is the next one in the input
+    bool x_BeginMember(TMemberIndex index, const CMemberInfo* memberInfo);
+    /// Check that no member is left after the last one
+    void x_End(void);
+
+    CObjectIStreamAsnBinary& m_In;
+    const CClassTypeInfo* m_ClassType;
+    TObjectPtr m_ClassPtr;
+    bool m_HaveTag;     ///< Has the tag of the next member been peeked?
+    bool m_End;         ///< Is the next tag the end of the class?
+    CObjectIStreamAsnBinary::TLongTag m_Tag;    ///< Next member tag
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CAsnBinaryMemberWriter --
+///
+/// Writes the members of a SEQUENCE class in ASN.1 binary format for its
+/// generated write function; the counterpart of CAsnBinaryMemberReader.
+/// A member of a standard type is written directly if it is set and no
+/// hooks are set on it or on its type; otherwise it is written through
+/// its member information.
+class NCBI_XSERIAL_EXPORT CAsnBinaryMemberWriter
+{
+public:
+    CAsnBinaryMemberWriter(CObjectOStreamAsnBinary& out,
+                           const CClassTypeInfo* classType,
+                           TConstObjectPtr classPtr)
+        : m_Out(out), m_ClassType(classType), m_ClassPtr(classPtr)
+        {
+        }
+
+    /// Write a member of a standard type
+    template<typename T>
+    void WriteStd(TMemberIndex index, const T& data)
+        {
+            const CMemberInfo* memberInfo = m_ClassType->GetMemberInfo(index);
+            if ( !memberInfo->HaveSetFlag() ||
+                 !memberInfo->GetSetFlagYes(m_ClassPtr) ||
+                 memberInfo->HaveWriteHooks() ||
+                 memberInfo->GetTypeInfo()->HaveWriteHooks() ) {
+                memberInfo->WriteMember(m_Out, m_ClassPtr);
+                return;
+            }
+            BEGIN_OBJECT_FRAME_OF2(m_Out, eFrameClassMember,
+                                   memberInfo->GetId());
+            m_Out.WriteTag(CAsnBinaryDefs::eContextSpecific,
+                           CAsnBinaryDefs::eConstructed,
+                           memberInfo->GetId().GetTag());
+            m_Out.WriteIndefiniteLength();
+            m_Out.WriteStd(data);
+            m_Out.WriteEndOfContent();
+            END_OBJECT_FRAME_OF(m_Out);
+        }
+
+    /// Write any other member
+    void Write(TMemberIndex index);
+
+private:
+    CObjectOStreamAsnBinary& m_Out;
+    const CClassTypeInfo* m_ClassType;
+    TConstObjectPtr m_ClassPtr;
+};
+
+
+/* @} */
+
+
+END_NCBI_SCOPE
+
+#endif  /* ASNBDIRECT__HPP */
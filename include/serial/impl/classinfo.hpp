@@ -54,6 +54,8 @@ class CMemberInfo;
 class CClassInfoHelperBase;
 class CObjectInfoMI;
 class CReadClassMemberHook;
+class CAsnBinaryMemberReader;
+class CAsnBinaryMemberWriter;
 
 class NCBI_XSERIAL_EXPORT CClassTypeInfo : public CClassTypeInfoBase
 {
@@ -116,6 +118,19 @@ public:
     void SetGlobalHook(const CTempString& member_names,
                        CReadClassMemberHook* hook);
 
+    // type-specific ASN.1 binary I/O of the members, generated by datatool
+    // (see serial/impl/asnbdirect.hpp); used by ASN.1 binary streams
+    // instead of the member information when set
+    typedef void (*TAsnBinaryReadFunction)(CAsnBinaryMemberReader& reader,
+                                           TObjectPtr classPtr);
+    typedef void (*TAsnBinaryWriteFunction)(CAsnBinaryMemberWriter& writer,
+                                            TConstObjectPtr classPtr);
+
+    void SetAsnBinaryFunctions(TAsnBinaryReadFunction readFunc,
+                               TAsnBinaryWriteFunction writeFunc);
+    TAsnBinaryReadFunction GetAsnBinaryReadFunction(void) const;
+    TAsnBinaryWriteFunction GetAsnBinaryWriteFunction(void) const;
+
 public:
 
     // iterators interface
@@ -142,6 +157,9 @@ private:
 
     TGetTypeIdFunction m_GetTypeIdFunction;
 
+    TAsnBinaryReadFunction m_AsnBinaryReadFunction;
+    TAsnBinaryWriteFunction m_AsnBinaryWriteFunction;
+
     const CMemberInfo* GetImplicitMember(void) const;
 
 private:
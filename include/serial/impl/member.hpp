@@ -175,6 +175,10 @@ public:
     void SetPathCopyHook(CObjectStreamCopier* copier, const string& path,
                          CCopyClassMemberHook* hook);
 
+    // are any hooks (global, local or context-specific) set?
+    bool HaveReadHooks(void) const;
+    bool HaveWriteHooks(void) const;
+
     // default I/O (without hooks)
     void DefaultReadMember(CObjectIStream& in,
                            TObjectPtr classPtr) const;
@@ -62,6 +62,18 @@ bool CMemberInfo::HaveSetFlag(void) const
     return m_SetFlagOffset != eNoOffset;
 }
 
+inline
+bool CMemberInfo::HaveReadHooks(void) const
+{
+    return m_ReadHookData.HaveHooks();
+}
+
+inline
+bool CMemberInfo::HaveWriteHooks(void) const
+{
+    return m_WriteHookData.HaveHooks();
+}
+
 inline
 bool CMemberInfo::CanBeDelayed(void) const
 {
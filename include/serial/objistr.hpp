@@ -781,8 +781,13 @@ public:
         {
             return m_MemoryPool;
         }
-    // create and set new memory pool
-    void UseMemoryPool(void);
+    // create and set new memory pool;
+    // CObjects read from now on, including the CRef'ed members and container
+    // elements, are placed in chunks of the pool, and the memory of a chunk
+    // is released at once when all its objects are deleted.
+    // Bigger chunks (e.g. 64K) suit big object graphs like GenBank
+    // Seq-entries, as they also hold bigger objects; 0 for the default size.
+    void UseMemoryPool(size_t chunk_size = 0);
 
     // internal reader
     void ReadExternalObject(TObjectPtr object, TTypeInfo typeInfo);
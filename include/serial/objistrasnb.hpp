@@ -47,6 +47,7 @@
 BEGIN_NCBI_SCOPE
 
 class CObjectOStreamAsnBinary;
+class CAsnBinaryMemberReader;
 
 /////////////////////////////////////////////////////////////////////////////
 ///
@@ -312,6 +313,7 @@ private:
     void GetTagPattern(vector<int>& pattern, size_t max_length);
 
     friend class CObjectOStreamAsnBinary;
+    friend class CAsnBinaryMemberReader;
 };
 
 
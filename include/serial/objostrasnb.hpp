@@ -47,6 +47,7 @@
 BEGIN_NCBI_SCOPE
 
 class CObjectIStreamAsnBinary;
+class CAsnBinaryMemberWriter;
 
 /////////////////////////////////////////////////////////////////////////////
 ///
@@ -202,6 +203,7 @@ protected:
 #if HAVE_NCBI_C
     friend class CObjectOStream::AsnIo;
 #endif
+    friend class CAsnBinaryMemberWriter;
 
 private:
     void WriteNumberValue(Int4 data);
@@ -0,0 +1,202 @@
+#ifndef PARALLELREAD__HPP
+#define PARALLELREAD__HPP
+
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Decode the elements of a container in ASN binary input on several
+*   threads
+* Please note:
+*   This API requires multi-threading
+*/
+
+#include <corelib/ncbistd.hpp>
+#include <corelib/ncbiobj.hpp>
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <serial/objectinfo.hpp>
+#include <util/bytesrc.hpp>
+#include <deque>
+
+
+/** @addtogroup ObjStreamSupport
+ *
+ * @{
+ */
+
+
+BEGIN_NCBI_SCOPE
+
+// IMPORTANT: the following API requires multi-threading
+#if defined(NCBI_THREADS)
+
+class CObjectIStream;
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CAsnBinaryParallelReader --
+///
+/// Read an object from ASN binary input, decoding the elements of one of its
+/// container members (SET OF, SEQUENCE OF) on several threads.
+///
+/// A splitting thread reads the root object. A read hook on the container
+/// member finds the end of each element from the lengths of the encoding,
+/// without decoding it, and hands its bytes to a pool of decoding threads.
+/// The decoded elements are returned by ReadNext in the order of the input.
+/// The elements split and not yet returned are bounded, so that the memory
+/// used does not depend on the size of the input.
+///
+/// The elements must be CObject-derived (e.g. the Seq-entry elements of the
+/// seq-set of a Bioseq-set) and are not added to the container. The other
+/// members of the root object are read as usual and may be used once
+/// ReadNext has returned all elements. If the input stream uses a memory
+/// pool (CObjectIStream::UseMemoryPool), each element is decoded into a pool
+/// of its own with the same chunk size.
+///
+/// Usage:
+///    CObjectIStream* is = CObjectIStream::Open(eSerial_AsnBinary, ...);
+///    CBioseq_set bss;
+///    CAsnBinaryParallelReader reader(*is, ObjectInfo(bss), "seq-set");
+///    for (CRef<CSeq_entry> entry; reader.ReadNext(entry); ) {
+///        ...
+///    }
+/// IMPORTANT:
+///     This API requires multi-threading!
+class NCBI_XSERIAL_EXPORT CAsnBinaryParallelReader : public CObject
+{
+public:
+    /// Start reading.
+    ///
+    /// @param in
+    ///   ASN binary input stream, only used by the splitting thread until
+    ///   the end of the root object or the destruction of the reader
+    /// @param root
+    ///   Object to read from the stream; must be a class
+    /// @param container_member
+    ///   Name of the container member of the root class whose elements are
+    ///   decoded in parallel
+    /// @param num_threads
+    ///   Number of decoding threads; 0 for the number of CPUs
+    /// @param max_queued
+    ///   Maximal number of elements split and not yet returned; 0 for four
+    ///   per decoding thread
+    CAsnBinaryParallelReader(CObjectIStream& in,
+                             const CObjectInfo& root,
+                             const string& container_member,
+                             unsigned int num_threads = 0,
+                             size_t max_queued = 0);
+
+    /// Stop the threads, abandoning the rest of the input if not all
+    /// elements were returned
+    ~CAsnBinaryParallelReader(void);
+
+    /// Get the next element, waiting for it to be decoded.
+    ///
+    /// Errors in the input or in the decoding of an element are rethrown
+    /// here, after all elements preceding the error were returned.
+    /// @return
+    ///   the element, or an empty reference after the last element, when
+    ///   the root object has been read
+    CRef<CObject> ReadNextObject(void);
+
+    /// Get the next element, waiting for it to be decoded.
+    ///
+    /// @param element
+    ///   the element, or an empty reference after the last one
+    /// @return
+    ///   false after the last element
+    template<typename TElement>
+    bool ReadNext(CRef<TElement>& element)
+    {
+        CRef<CObject> object = ReadNextObject();
+        element.Reset(object ? &dynamic_cast<TElement&>(*object) : 0);
+        return element.NotEmpty();
+    }
+
+    /// Number of decoding threads
+    unsigned int GetNumThreads(void) const
+    {
+        return (unsigned int) m_Decoders.size();
+    }
+
+private:
+    /// Element of the container, from its splitting to its return
+    class CElement : public CObject
+    {
+    public:
+        CElement(CByteSource& data) : m_Data(&data), m_Done(false) {}
+
+        CRef<CByteSource> m_Data;       ///< Encoded element
+        CRef<CObject> m_Object;         ///< Decoded element
+        auto_ptr<CException> m_Error;   ///< Wraps the decoding error
+        bool m_Done;                    ///< Has decoding finished?
+    };
+    typedef deque< CRef<CElement> > TElements;
+
+    friend class CAsnBinaryParallelReaderThread;
+    friend class CAsnBinaryElementSplitter;
+
+    /// Main loop of the splitting thread
+    void x_Split(void);
+    /// Main loop of the decoding threads
+    void x_Decode(void);
+    /// Queue the encoded bytes of an element for decoding; called by the
+    /// read hook on the splitting thread
+    void x_AddElement(CByteSource& data);
+    /// Stop and join the threads
+    void x_StopThreads(void);
+
+    CObjectIStream& m_In;
+    CObjectInfo m_Root;
+    string m_ContainerMember;
+    TTypeInfo m_ElementType;    ///< Type of the decoded elements
+    size_t m_MaxQueued;
+
+    CFastMutex m_Lock;          ///< Protects all fields below
+    CConditionVariable m_Changed;   ///< Signalled on any change below
+    TElements m_Queued;         ///< Elements split and not yet returned
+    TElements m_ToDecode;       ///< Elements waiting for a decoding thread
+    bool m_InputDone;           ///< Has the splitting thread finished?
+    bool m_Stop;                ///< Should the threads stop?
+    auto_ptr<CException> m_Error;   ///< Wraps the error of the splitting
+
+    CRef<CThread> m_Splitter;   ///< Reads the root and splits the elements
+    vector< CRef<CThread> > m_Decoders; ///< Decode the elements
+
+    /// Prohibit copy constructor
+    CAsnBinaryParallelReader(const CAsnBinaryParallelReader&);
+    /// Prohibit assignment operator
+    CAsnBinaryParallelReader& operator=(const CAsnBinaryParallelReader&);
+};
+
+#endif // NCBI_THREADS
+
+
+/* @} */
+
+END_NCBI_SCOPE
+
+#endif  /* PARALLELREAD__HPP */
@@ -225,6 +225,11 @@ public:
     void SetPathCopyHook(CObjectStreamCopier* copier, const string& path,
                          CCopyObjectHook* hook);
 
+    /// Are any read hooks (global, local or context-specific) set?
+    bool HaveReadHooks(void) const;
+    /// Are any write hooks (global, local or context-specific) set?
+    bool HaveWriteHooks(void) const;
+
     // default methods without checking hook
     void DefaultReadData(CObjectIStream& in, TObjectPtr object) const;
     void DefaultWriteData(CObjectOStream& out, TConstObjectPtr object) const;
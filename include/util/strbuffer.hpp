@@ -122,6 +122,24 @@ public:
     size_t PeekFindChar(char c, size_t limit)
         THROWS1((CIOException));
 
+    // action: extract chars already in buffer up to (not including)
+    //         the first control char (< ' '), 'stop1' or 'stop2' and,
+    //         if 'ascii_only' is true, the first non-ASCII char;
+    //         append them to 'str'; the buffer is not refilled
+    // return: number of chars appended
+    size_t GetPlainChars(string& str, char stop1, char stop2,
+                         bool ascii_only = false) THROWS1_NONE;
+    // return: relative offset (not less than 'offset') of the first char
+    //         in buffer which is not an ASCII letter, digit, '_', '.' or '-',
+    //         or of the end of data in buffer; the buffer is not refilled
+    size_t PeekNameChars(size_t offset) const THROWS1_NONE;
+
+    // Enable or disable SIMD scanning in SkipSpaces(), GetPlainChars() and
+    // PeekNameChars() for all buffers created afterwards (on by default,
+    // can be also disabled by UTIL_STREAM_BUFFER_VECTOR_SCAN=0)
+    static void SetVectorScan(bool enable);
+    static bool GetVectorScan(void);
+
     const char* GetCurrentPos(void) const THROWS1_NONE;
     // returns true if succeeded
     bool TrySetCurrentPos(const char* pos);
@@ -209,6 +227,7 @@ private:
 
     CConstIRef<ICanceled> m_CanceledCallback;
     size_t m_BufferLockSize;
+    bool m_VectorScan;        // use SIMD in scanning methods
 };
 
 class NCBI_XUTIL_EXPORT COStreamBuffer
@@ -42,6 +42,7 @@ static char const rcsid[] =
 #include <algo/blast/api/blast_mtlock.hpp>
 #include <algo/blast/api/seqinfosrc_seqdb.hpp>
 #include <algo/blast/api/blast_exception.hpp>
+#include <algo/blast/api/blast_search_stats.hpp>
 #include "psiblast_aux_priv.hpp"
 #include "blast_memento_priv.hpp"
 
@@ -195,8 +196,17 @@ BlastSetupPreliminarySearchEx(CRef<IQueryFactory> qf,
         SetUpDbIndexCallbacks();
     }
 
-    // 5. Create the lookup table
+    // 5. Create diagnostics
+    BlastDiagnostics* diags = is_multi_threaded
+        ? CSetupFactory::CreateDiagnosticsStructureMT()
+        : CSetupFactory::CreateDiagnosticsStructure();
+    retval->m_InternalData->m_Diagnostics.Reset
+        (new TBlastDiagnostics(diags, Blast_DiagnosticsFree));
+
+    // 6. Create the lookup table
     if ( !retval->m_QuerySplitter->IsQuerySplit() ) {
+        CBlastStageTimer timer(diags, eBlastStageLookup,
+                               CBlastSearchStats::kNoThread);
         LookupTableWrap* lut =
             CSetupFactory::CreateLookupTable(query_data, opts_memento.get(),
                                              sbp, lookup_segments_wrap,
@@ -206,13 +216,6 @@ BlastSetupPreliminarySearchEx(CRef<IQueryFactory> qf,
             (new TLookupTableWrap(lut, LookupTableWrapFree));
     }
 
-    // 6. Create diagnostics
-    BlastDiagnostics* diags = is_multi_threaded
-        ? CSetupFactory::CreateDiagnosticsStructureMT()
-        : CSetupFactory::CreateDiagnosticsStructure();
-    retval->m_InternalData->m_Diagnostics.Reset
-        (new TBlastDiagnostics(diags, Blast_DiagnosticsFree));
-
     // 7. Create the HSP stream
     BlastHSPStream* hsp_stream = 
         CSetupFactory::CreateHspStream(opts_memento.get(),
@@ -146,15 +146,37 @@ class CIndexedDb : public CObject
 protected:
 
     CRef< CBlastSeqLocWrap > locs_wrap_; /**< Current set of unmasked query locations. */
+    size_t n_search_threads_;            /**< Number of threads used to search
+                                              an index volume. */
 
 public:
 
     static CRef< CIndexedDb > Index_Set_Instance; /**< Shared representation of 
                                                         currently loaded index volumes. */
 
+    /** Object constructor. */
+    CIndexedDb() : n_search_threads_( 1 ) {}
+
     /** Object destructor. */
     virtual ~CIndexedDb();
 
+    /** Set the concurrency status.
+
+        @param multiple_threads 'true' if concurrent search is being performed;
+                                'false' otherwise
+    */
+    virtual void SetMultipleThreads( bool multiple_threads )
+    { if( !multiple_threads ) n_search_threads_ = 1; }
+
+    /** Set the number of threads used for concurrent search.
+
+        The index volumes are searched with the same number of threads.
+
+        @param n_threads number of search threads.
+    */
+    virtual void SetNumThreads( size_t n_threads )
+    { n_search_threads_ = n_threads; }
+
     /** Check whether any results were reported for a given subject sequence.
 
         @param oid The subject sequence id
@@ -540,25 +562,31 @@ public:
 
     /** Set the concurrency status.
 
+        @note Overrides CIndexedDb::SetMultipleThreads().
+
         @param multiple_threads 'true' if concurrent search is being performed;
                                 'false' otherwise
     */
-    void SetMultipleThreads( bool multiple_threads )
+    virtual void SetMultipleThreads( bool multiple_threads )
     { 
         IDX_TRACE( "setting multiple threads to " << 
                    (multiple_threads ? "true" : "false") );
+        CIndexedDb::SetMultipleThreads( multiple_threads );
         multiple_threads_ = multiple_threads;
         if( multiple_threads_ ) n_threads_ = 0;
     }
 
     /** Set the number of threads used for concurrent search.
 
+        @note Overrides CIndexedDb::SetNumThreads().
+
         @param n_threads number of search threads.
     */
-    void SetNumThreads( size_t n_threads )
+    virtual void SetNumThreads( size_t n_threads )
     {
         ASSERT( n_threads > 1 );
         IDX_TRACE( "setting number of search threads to " << n_threads );
+        CIndexedDb::SetNumThreads( n_threads );
         n_threads_ = n_threads;
     }
 };
@@ -589,10 +617,7 @@ static void IndexedDbSetUsingThreads( bool multiple_threads )
 {
     CIndexedDb * idb( CIndexedDb::Index_Set_Instance.GetPointerOrNull() );
     if( idb == 0 ) return;
-    CIndexedDb_New * idbn( dynamic_cast< CIndexedDb_New * >( idb ) );
-    if ( idbn == 0 ) return;
-    ASSERT( idbn != 0 );
-    idbn->SetMultipleThreads( multiple_threads );
+    idb->SetMultipleThreads( multiple_threads );
 }
 
 //------------------------------------------------------------------------------
@@ -602,10 +627,7 @@ static void IndexedDbSetNumThreads( size_t n_threads )
 {
     CIndexedDb * idb( CIndexedDb::Index_Set_Instance.GetPointerOrNull() );
     if( idb == 0 ) return;
-    CIndexedDb_New * idbn( dynamic_cast< CIndexedDb_New * >( idb ) );
-    if ( idbn == 0 ) return;
-    ASSERT( idbn != 0 );
-    idbn->SetNumThreads( n_threads );
+    idb->SetNumThreads( n_threads );
 }
 
 //------------------------------------------------------------------------------
@@ -837,8 +859,13 @@ void CIndexedDb_New::UpdateIndex( Int4 oid, Int4 * vol_idx_p )
             NCBI_THROW( CIndexedDbException, eIndexInitError, os.str() );
         }
 
+        // The other search threads wait for these results, so the volume
+        // is searched with all of them.
+        //
         IDX_TRACE( "searching volume " << vi->name );
-        res.res = index->Search( queries_, locs_wrap_->getLocs(), sopt_ );
+        CDbIndex::SSearchOptions sopt( sopt_ );
+        sopt.n_threads = n_search_threads_;
+        res.res = index->Search( queries_, locs_wrap_->getLocs(), sopt );
         IDX_TRACE( "results loaded for " << vi->name );
     }
 
@@ -1021,6 +1048,7 @@ void CIndexedDb_Old::PreSearch(
     CDbIndex::SSearchOptions sopt;
     sopt.word_size = lut_options->word_size;
     sopt.two_hits = word_options->window_size;
+    sopt.n_threads = n_search_threads_;
 
     for( vector< string >::size_type v = 0; 
             v < index_names_.size(); v += 1 ) {
@@ -0,0 +1,304 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/// @file blast_search_stats.cpp
+/// Implementation of the hit counts and stage times of BLAST searches.
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbitime.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <algo/blast/api/blast_search_stats.hpp>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+BEGIN_NCBI_SCOPE
+BEGIN_SCOPE(blast)
+
+bool CBlastSearchStats::sm_StageTimesEnabled = false;
+
+/// Protects the calibration of the stage clock
+DEFINE_STATIC_FAST_MUTEX(s_CalibrationMutex);
+
+/// Wall clock time over which the stage clock is calibrated
+static const double kCalibrationSeconds = 0.02;
+
+void
+CBlastSearchStats::SetStageTimesEnabled(bool enabled)
+{
+    sm_StageTimesEnabled = enabled;
+    if (enabled) {
+        // Calibrate now rather than while a search is timed
+        GetTicksPerSecond();
+    }
+}
+
+bool
+CBlastSearchStats::GetStageTimesEnabled()
+{
+    return sm_StageTimesEnabled;
+}
+
+void
+CBlastSearchStats::InitDiagnostics(BlastDiagnostics* diagnostics)
+{
+    if (sm_StageTimesEnabled &&
+        Blast_DiagnosticsEnableStageTimes(diagnostics) != 0) {
+        ERR_POST(Warning << "Out of memory: BLAST stages are not timed");
+    }
+}
+
+double
+CBlastSearchStats::GetTicksPerSecond()
+{
+    static double s_TicksPerSecond = 0.0;
+
+    CFastMutexGuard LOCK(s_CalibrationMutex);
+    if (s_TicksPerSecond == 0.0) {
+        CStopWatch sw(CStopWatch::eStart);
+        const Int8 kStart = Blast_StageClock();
+        double elapsed = 0.0;
+        while ((elapsed = sw.Elapsed()) < kCalibrationSeconds) {
+            continue;
+        }
+        const Int8 kTicks = Blast_StageClock() - kStart;
+        s_TicksPerSecond = kTicks > 0 ? kTicks / elapsed : 1.0;
+    }
+    return s_TicksPerSecond;
+}
+
+const char*
+CBlastSearchStats::GetStageName(EBlastTimedStage stage)
+{
+    switch (stage) {
+    case eBlastStageLookup:     return "lookup";
+    case eBlastStageScan:       return "scan";
+    case eBlastStageUngapped:   return "ungapped";
+    case eBlastStageGapped:     return "gapped";
+    case eBlastStageCompAdjust: return "composition_adjustment";
+    case eBlastStageTraceback:  return "traceback";
+    case eBlastStageFormat:     return "formatting";
+    default:                    break;
+    }
+    return "unknown";
+}
+
+CBlastSearchStats::CBlastSearchStats()
+    : m_HasStageTimes(false), m_NumSearches(0)
+{
+    memset(&m_StageTimes, 0, sizeof(m_StageTimes));
+    m_StageTimes.thread_index = -1;
+    memset(&m_UngappedStats, 0, sizeof(m_UngappedStats));
+    memset(&m_GappedStats, 0, sizeof(m_GappedStats));
+}
+
+CBlastSearchStats::CBlastSearchStats(const BlastDiagnostics* diagnostics)
+    : m_HasStageTimes(false), m_NumSearches(1)
+{
+    memset(&m_StageTimes, 0, sizeof(m_StageTimes));
+    m_StageTimes.thread_index = -1;
+    memset(&m_UngappedStats, 0, sizeof(m_UngappedStats));
+    memset(&m_GappedStats, 0, sizeof(m_GappedStats));
+    if ( !diagnostics ) {
+        return;
+    }
+
+    if (diagnostics->ungapped_stat) {
+        m_UngappedStats = *diagnostics->ungapped_stat;
+    }
+    if (diagnostics->gapped_stat) {
+        m_GappedStats = *diagnostics->gapped_stat;
+    }
+    if (diagnostics->stage_times) {
+        m_HasStageTimes = true;
+        memcpy(m_StageTimes.ticks, diagnostics->stage_times->ticks,
+               sizeof(m_StageTimes.ticks));
+        for (Int4 i = 0; i < diagnostics->num_thread_stage_times; i++) {
+            x_AddThreadStageTimes(diagnostics->thread_stage_times[i]);
+        }
+    }
+}
+
+void
+CBlastSearchStats::x_AddThreadStageTimes(const BlastStageTimes& stage_times)
+{
+    vector<BlastStageTimes>::iterator it = m_ThreadStageTimes.begin();
+    while (it != m_ThreadStageTimes.end() &&
+           it->thread_index < stage_times.thread_index) {
+        ++it;
+    }
+    if (it == m_ThreadStageTimes.end() ||
+        it->thread_index != stage_times.thread_index) {
+        BlastStageTimes empty;
+        memset(&empty, 0, sizeof(empty));
+        empty.thread_index = stage_times.thread_index;
+        it = m_ThreadStageTimes.insert(it, empty);
+    }
+    for (int i = 0; i < eBlastStageMaxNum; i++) {
+        it->ticks[i] += stage_times.ticks[i];
+    }
+}
+
+void
+CBlastSearchStats::Add(const CBlastSearchStats& other)
+{
+    m_NumSearches += other.m_NumSearches;
+
+    m_UngappedStats.lookup_hits += other.m_UngappedStats.lookup_hits;
+    m_UngappedStats.num_seqs_lookup_hits +=
+        other.m_UngappedStats.num_seqs_lookup_hits;
+    m_UngappedStats.init_extends += other.m_UngappedStats.init_extends;
+    m_UngappedStats.good_init_extends +=
+        other.m_UngappedStats.good_init_extends;
+    m_UngappedStats.num_seqs_passed += other.m_UngappedStats.num_seqs_passed;
+
+    m_GappedStats.seqs_ungapped_passed +=
+        other.m_GappedStats.seqs_ungapped_passed;
+    m_GappedStats.extensions += other.m_GappedStats.extensions;
+    m_GappedStats.good_extensions += other.m_GappedStats.good_extensions;
+    m_GappedStats.num_seqs_passed += other.m_GappedStats.num_seqs_passed;
+    m_GappedStats.simd_extensions += other.m_GappedStats.simd_extensions;
+
+    if (other.m_HasStageTimes) {
+        m_HasStageTimes = true;
+        for (int i = 0; i < eBlastStageMaxNum; i++) {
+            m_StageTimes.ticks[i] += other.m_StageTimes.ticks[i];
+        }
+        ITERATE(vector<BlastStageTimes>, it, other.m_ThreadStageTimes) {
+            x_AddThreadStageTimes(*it);
+        }
+    }
+}
+
+void
+CBlastSearchStats::AddStageTicks(EBlastTimedStage stage, Int8 ticks,
+                                 int thread_index)
+{
+    BlastStageTimes stage_times;
+    memset(&stage_times, 0, sizeof(stage_times));
+    stage_times.thread_index = thread_index;
+    stage_times.ticks[stage] = ticks;
+
+    m_HasStageTimes = true;
+    m_StageTimes.ticks[stage] += ticks;
+    if (thread_index != kNoThread) {
+        x_AddThreadStageTimes(stage_times);
+    }
+}
+
+/// Write the ticks and seconds spent in each stage as JSON object members
+/// @param out Stream to write to [in]
+/// @param stage_times Times to write [in]
+/// @param indent Indentation of the members [in]
+static void
+s_WriteStageTimesJson(CNcbiOstream& out, const BlastStageTimes& stage_times,
+                      const string& indent)
+{
+    const double kTicksPerSecond = CBlastSearchStats::GetTicksPerSecond();
+    for (int i = 0; i < eBlastStageMaxNum; i++) {
+        const EBlastTimedStage kStage = (EBlastTimedStage) i;
+        out << indent << "\"" << CBlastSearchStats::GetStageName(kStage)
+            << "\": { \"ticks\": " << stage_times.ticks[i]
+            << ", \"seconds\": "
+            << NStr::DoubleToString(stage_times.ticks[i] / kTicksPerSecond,
+                                    6, NStr::fDoubleFixed)
+            << " }" << (i + 1 < eBlastStageMaxNum ? "," : "") << "\n";
+    }
+}
+
+void
+CBlastSearchStats::WriteJson(CNcbiOstream& out) const
+{
+    out << "{\n"
+        << "  \"searches\": " << m_NumSearches << ",\n"
+        << "  \"counts\": {\n"
+        << "    \"lookup_hits\": " << m_UngappedStats.lookup_hits << ",\n"
+        << "    \"seqs_with_lookup_hits\": "
+        << m_UngappedStats.num_seqs_lookup_hits << ",\n"
+        << "    \"ungapped_extensions\": "
+        << m_UngappedStats.init_extends << ",\n"
+        << "    \"good_ungapped_extensions\": "
+        << m_UngappedStats.good_init_extends << ",\n"
+        << "    \"seqs_with_ungapped_hsps\": "
+        << m_UngappedStats.num_seqs_passed << ",\n"
+        << "    \"seqs_passing_ungapped_evalue\": "
+        << m_GappedStats.seqs_ungapped_passed << ",\n"
+        << "    \"gapped_extensions\": " << m_GappedStats.extensions << ",\n"
+        << "    \"good_gapped_extensions\": "
+        << m_GappedStats.good_extensions << ",\n"
+        << "    \"seqs_with_gapped_hsps\": "
+        << m_GappedStats.num_seqs_passed << ",\n"
+        << "    \"vector_gapped_extensions\": "
+        << m_GappedStats.simd_extensions << "\n"
+        << "  }";
+
+    if (m_HasStageTimes) {
+        out << ",\n"
+            << "  \"ticks_per_second\": "
+            << NStr::DoubleToString(GetTicksPerSecond(), 0,
+                                    NStr::fDoubleFixed) << ",\n"
+            << "  \"stages\": {\n";
+        s_WriteStageTimesJson(out, m_StageTimes, "    ");
+        out << "  },\n"
+            << "  \"threads\": [";
+        for (size_t i = 0; i < m_ThreadStageTimes.size(); i++) {
+            out << (i == 0 ? "\n" : ",\n")
+                << "    {\n"
+                << "      \"thread\": " << m_ThreadStageTimes[i].thread_index
+                << ",\n"
+                << "      \"stages\": {\n";
+            s_WriteStageTimesJson(out, m_ThreadStageTimes[i], "        ");
+            out << "      }\n"
+                << "    }";
+        }
+        out << (m_ThreadStageTimes.empty() ? "]" : "\n  ]");
+    }
+    out << "\n}\n";
+}
+
+CBlastStageTimer::~CBlastStageTimer()
+{
+    if (m_Diagnostics) {
+        BlastStageTimes stage_times;
+        memset(&stage_times, 0, sizeof(stage_times));
+        stage_times.thread_index = m_ThreadIndex;
+        stage_times.ticks[m_Stage] = Blast_StageClock() - m_Start;
+        Blast_DiagnosticsAddStageTimes(m_Diagnostics, &stage_times);
+    }
+}
+
+END_SCOPE(blast)
+END_NCBI_SCOPE
+
+/* @} */
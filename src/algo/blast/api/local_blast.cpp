@@ -246,8 +246,10 @@ CLocalBlast::Run()
     if (m_LocalDbAdapter.NotEmpty() && !m_LocalDbAdapter->IsBlastDb()) {
         m_TbackSearch->SetResultType(eSequenceComparison);
     }
+    m_TbackSearch->SetNumberOfThreads(GetNumberOfThreads());
     CRef<CSearchResultSet> retval = m_TbackSearch->Run();
     retval->SetFilteredQueryRegions(m_PrelimSearch->GetFilteredQueryRegions());
+    retval->SetSearchStats(GetSearchStats());
     m_Messages = m_TbackSearch->GetSearchMessages();
 
     return retval;
@@ -265,6 +267,15 @@ Int4 CLocalBlast::GetNumExtensions()
     return retv;
 }
 
+CRef<CBlastSearchStats> CLocalBlast::GetSearchStats()
+{
+    const BlastDiagnostics* diag = NULL;
+    if (m_InternalData && m_InternalData->m_Diagnostics.NotEmpty()) {
+        diag = m_InternalData->m_Diagnostics->GetPointer();
+    }
+    return CRef<CBlastSearchStats>(new CBlastSearchStats(diag));
+}
+
 END_SCOPE(blast)
 END_NCBI_SCOPE
 
@@ -55,8 +55,10 @@ class CPrelimSearchRunner : public CObject
 {
 public:
     CPrelimSearchRunner(SInternalData& internal_data,
-                        const CBlastOptionsMemento* opts_memento)
-        : m_InternalData(internal_data), m_OptsMemento(opts_memento)
+                        const CBlastOptionsMemento* opts_memento,
+                        BlastSubjectScheduler* scheduler = NULL)
+        : m_InternalData(internal_data), m_OptsMemento(opts_memento),
+          m_Scheduler(scheduler)
     {}
     ~CPrelimSearchRunner() {}
     int operator()() {
@@ -68,7 +70,7 @@ public:
         _ASSERT(m_InternalData.m_LookupTable);
         _ASSERT(m_InternalData.m_HspStream);
         SBlastProgressReset(m_InternalData.m_ProgressMonitor->Get());
-        Int2 retval = Blast_RunPreliminarySearchWithInterrupt(m_OptsMemento->m_ProgramType,
+        Int2 retval = Blast_RunPreliminarySearchWithScheduler(m_OptsMemento->m_ProgramType,
                                  m_InternalData.m_Queries,
                                  m_InternalData.m_QueryInfo,
                                  m_InternalData.m_SeqSrc->GetPointer(),
@@ -83,6 +85,7 @@ public:
                                  m_OptsMemento->m_DbOpts,
                                  m_InternalData.m_HspStream->GetPointer(),
                                  m_InternalData.m_Diagnostics->GetPointer(),
+                                 m_Scheduler,
                                  m_InternalData.m_FnInterrupt,
                                  m_InternalData.m_ProgressMonitor->Get());
 
@@ -97,6 +100,8 @@ private:
     /// Pointer to memento which this class doesn't own
     const CBlastOptionsMemento* m_OptsMemento;
 
+    /// Scheduler shared with the other search threads, if any (not owned)
+    BlastSubjectScheduler* m_Scheduler;
 
     /// Prohibit copy constructor
     CPrelimSearchRunner(const CPrelimSearchRunner& rhs);
@@ -109,8 +114,10 @@ class CPrelimSearchThread : public CThread
 {
 public:
     CPrelimSearchThread(SInternalData& internal_data,
-                        const CBlastOptionsMemento* opts_memento)
-        : m_InternalData(internal_data), m_OptsMemento(opts_memento)
+                        const CBlastOptionsMemento* opts_memento,
+                        BlastSubjectScheduler* scheduler = NULL)
+        : m_InternalData(internal_data), m_OptsMemento(opts_memento),
+          m_Scheduler(scheduler)
     {
         // The following fields need to be copied to ensure MT-safety
         BlastSeqSrc* seqsrc = 
@@ -130,12 +137,14 @@ protected:
 
     virtual void* Main(void) {
         return (void*) 
-            ((intptr_t) CPrelimSearchRunner(m_InternalData, m_OptsMemento)());
+            ((intptr_t) CPrelimSearchRunner(m_InternalData, m_OptsMemento,
+                                            m_Scheduler)());
     }
 
 private:
     SInternalData m_InternalData;
     const CBlastOptionsMemento* m_OptsMemento;
+    BlastSubjectScheduler* m_Scheduler;
 };
 
 END_SCOPE(blast)
@@ -107,6 +107,12 @@ CBlastPrelimSearch::SetNumberOfThreads(size_t nthreads)
         BlastDiagnostics* diags = IsMultiThreaded()
             ? CSetupFactory::CreateDiagnosticsStructureMT()
             : CSetupFactory::CreateDiagnosticsStructure();
+        // keep the time spent setting up the search; the totals have no
+        // thread index, so they are not reported as a thread
+        if (m_InternalData->m_Diagnostics.NotEmpty()) {
+            Blast_DiagnosticsUpdate(diags,
+                m_InternalData->m_Diagnostics->GetPointer());
+        }
         m_InternalData->m_Diagnostics.Reset
             (new TBlastDiagnostics(diags, Blast_DiagnosticsFree));
 
@@ -130,6 +136,10 @@ CBlastPrelimSearch::x_Init(CRef<IQueryFactory> query_factory,
         BlastSetupPreliminarySearchEx(query_factory, options, pssm, seqsrc,
                                       IsMultiThreaded());
     m_InternalData = setup_data->m_InternalData;
+    // Only the stream read by the traceback may spill to disk: the streams
+    // of query chunks are merged in memory
+    CSetupFactory::SetHspStreamMemoryLimit
+        (m_InternalData->m_HspStream->GetPointer());
     copy(setup_data->m_Masks.begin(), setup_data->m_Masks.end(),
          back_inserter(m_MasksForAllQueries));
     m_Messages = setup_data->m_Messages;
@@ -150,10 +160,22 @@ CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
     BlastSeqSrcSetNumberOfThreads(m_InternalData->m_SeqSrc->GetPointer(), 
                                   GetNumberOfThreads());
 
+    // Chunks of long subjects are shared among the threads through this
+    // scheduler, so that idle threads can help finish them
+    CRef< CStructWrapper<BlastSubjectScheduler> > scheduler
+        (WrapStruct(BlastSubjectSchedulerNew(GetNumberOfThreads(),
+                                             Blast_CMT_LOCKInit()),
+                    BlastSubjectSchedulerFree));
+    if (scheduler->GetPointer() == NULL) {
+        NCBI_THROW(CBlastSystemException, eOutOfMemory,
+                   "Failed to create subject scheduler");
+    }
+
     // Create the threads ...
     NON_CONST_ITERATE(TBlastThreads, thread, the_threads) {
         thread->Reset(new CPrelimSearchThread(internal_data,
-                                              opts_memento.get()));
+                                              opts_memento.get(),
+                                              scheduler->GetPointer()));
         if (thread->Empty()) {
             NCBI_THROW(CBlastSystemException, eOutOfMemory,
                        "Failed to create preliminary search thread");
@@ -237,6 +259,9 @@ CBlastPrelimSearch::Run()
                 BLAST_SequenceBlk * chunk_queries = 
                     query_data->GetSequenceBlk();
                 GetDbIndexSetUsingThreadsFn()( IsMultiThreaded() );
+                if (IsMultiThreaded()) {
+                    GetDbIndexSetNumThreadsFn()( GetNumberOfThreads() );
+                }
                 GetDbIndexRunSearchFn()( 
                         chunk_queries, lut_options, word_options );
 
@@ -252,6 +277,16 @@ CBlastPrelimSearch::Run()
                 }
 
 
+                // only the stage times of the chunks are reported
+                BlastDiagnostics* chunk_diags =
+                    chunk_data->m_Diagnostics->GetPointer();
+                for (Int4 t = 0; t < chunk_diags->num_thread_stage_times;
+                     t++) {
+                    Blast_DiagnosticsAddStageTimes(
+                        m_InternalData->m_Diagnostics->GetPointer(),
+                        &chunk_diags->thread_stage_times[t]);
+                }
+
                 _ASSERT(chunk_data->m_HspStream->GetPointer());
                 BlastHSPStreamMerge(split_query_blk->GetCStruct(), i,
                                 chunk_data->m_HspStream->GetPointer(),
@@ -291,6 +326,9 @@ CBlastPrelimSearch::Run()
     } else {
 
         GetDbIndexSetUsingThreadsFn()( IsMultiThreaded() );
+        if (IsMultiThreaded()) {
+            GetDbIndexSetNumThreadsFn()( GetNumberOfThreads() );
+        }
         GetDbIndexRunSearchFn()( queries, lut_options, word_options );
 
         if (IsMultiThreaded()) {
@@ -44,6 +44,7 @@ static char const rcsid[] =
 #include <corelib/ncbitime.hpp>
 #include <corelib/ncbimtx.hpp>
 #include <corelib/ncbiexpt.hpp>
+#include <objmgr/util/sequence.hpp>
 #include <algo/blast/api/rpsblast_local.hpp>
 #include <objtools/blast/seqdb_reader/seqdb.hpp>
 #include <algo/blast/api/blast_rps_options.hpp>
@@ -51,24 +52,45 @@ static char const rcsid[] =
 BEGIN_NCBI_SCOPE
 BEGIN_SCOPE(blast)
 
-static string delimiter="#rps#";
+// Number of query batches each thread searches on average, so that threads
+// finishing early can take over the remaining batches
+static const unsigned int kBatchesPerThread = 4;
 
-
-static void s_ConvertConcatStringToVectorOfString(const string & s, vector<string> & v)
+// Shares the mapping of the RPS database files among the search threads for
+// as long as it is in scope, even if the search throws
+class CSharedRpsStructuresGuard
 {
-	int pos_start = 0;
-	while(1)
+public:
+	CSharedRpsStructuresGuard(const vector<string> & dbs, CRef<CBlastOptions> options)
+		: m_dbs(dbs), m_options(options), m_num_acquired(0)
 	{
-		size_t pos_find = s.find(delimiter, pos_start);
-		if(pos_find == string::npos)
-			break;
-		TSeqPos length = pos_find - pos_start;
-		v.push_back(s.substr(pos_start, length));
-		pos_start = pos_find + delimiter.size();
+		for(; m_num_acquired < m_dbs.size(); m_num_acquired++)
+		{
+			CSetupFactory::AcquireSharedRpsStructures(m_dbs[m_num_acquired], m_options);
+		}
 	}
 
-	v.push_back(s.substr(pos_start, s.size() - pos_start ));
-}
+	~CSharedRpsStructuresGuard()
+	{
+		for(size_t i=0; i < m_num_acquired; i++)
+		{
+			try {
+				CSetupFactory::ReleaseSharedRpsStructures(m_dbs[i], m_options);
+			}
+			catch(const CException & e) {
+				ERR_POST(Warning << e.GetMsg());
+			}
+		}
+	}
+
+private:
+	const vector<string> &	m_dbs;
+	CRef<CBlastOptions>		m_options;
+	size_t					m_num_acquired;
+
+	CSharedRpsStructuresGuard(const CSharedRpsStructuresGuard &);
+	CSharedRpsStructuresGuard & operator=(const CSharedRpsStructuresGuard &);
+};
 
 static void s_MergeAlignSet(CSeq_align_set & final_set, const CSeq_align_set & input_set)
 {
@@ -140,57 +162,53 @@ static void s_MergeAlignSet(CSeq_align_set & final_set, const CSeq_align_set & i
 	}
 }
 
-static CRef<CSearchResultSet>  s_CombineSearchSets(vector<CRef<CSearchResultSet> > & t, unsigned int num_of_threads)
+
+// Combine the results of searching the same queries against each volume of
+// an RPS database. Every search reports its queries in the same order, so
+// the results of a query are found by position rather than by Seq-id.
+static CRef<CSearchResultSet> s_CombineVolumeResults(const vector<CRef<CSearchResultSet> > & t)
 {
 	CRef<CSearchResultSet>   aggregate_search_result_set (new CSearchResultSet());
-	aggregate_search_result_set->clear();
+	const CSearchResultSet & first_set = *(t[0]);
 
-	for(unsigned int i=0; i < t[0]->GetNumQueries(); i++)
+	for(unsigned int i=0; i < first_set.GetNumResults(); i++)
 	{
-		vector< CRef<CSearchResults> >  thread_results;
-		thread_results.push_back (CRef<CSearchResults> (&((*(t[0]))[i])));
-		const CSeq_id & id = *(thread_results[0]->GetSeqId());
-
-		for(unsigned int d=1; d < num_of_threads; d++)
-		{
-			thread_results.push_back ((*(t[d]))[id]);
-		}
-
+		const CSearchResults & first_results = first_set[i];
 		CRef<CSeq_align_set>  align_set(new CSeq_align_set);
 		TQueryMessages aggregate_messages;
-		for(unsigned int d=0; d< num_of_threads; d++)
+		for(unsigned int d=0; d < t.size(); d++)
 		{
-			if(thread_results[d]->HasAlignments())
+			const CSearchResults & vol_results = (*(t[d]))[i];
+			_ASSERT(vol_results.GetSeqId()->Match(*first_results.GetSeqId()));
+			if(vol_results.HasAlignments())
 			{
-				CConstRef<CSeq_align_set>  thread_align_set = thread_results[d]->GetSeqAlign();
+				CConstRef<CSeq_align_set>  vol_align_set = vol_results.GetSeqAlign();
 				if(align_set->IsEmpty())
 				{
 					align_set->Set().insert(align_set->Set().begin(),
-										thread_align_set->Get().begin(),
-										thread_align_set->Get().end());
+										vol_align_set->Get().begin(),
+										vol_align_set->Get().end());
 				}
 				else
 				{
-					s_MergeAlignSet(*align_set, *thread_align_set);
+					s_MergeAlignSet(*align_set, *vol_align_set);
 				}
 			}
-			aggregate_messages.Combine(thread_results[d]->GetErrors());
+			aggregate_messages.Combine(vol_results.GetErrors());
 		}
 
 		TMaskedQueryRegions  query_mask;
-		thread_results[0]->GetMaskedQueryRegions(query_mask);
-		CRef<CSearchResults> aggregate_search_results (new CSearchResults(thread_results[0]->GetSeqId(),
-														   	   	   	   	  align_set,
-														   	   	   	   	  aggregate_messages,
-														   	   	   	   	  thread_results[0]->GetAncillaryData(),
-														   	   	   	   	  &query_mask,
-														   	   	   	   	  thread_results[0]->GetRID()));
+		first_results.GetMaskedQueryRegions(query_mask);
+		CRef<CSearchResults> aggregate_search_results (new CSearchResults(first_results.GetSeqId(),
+																		  align_set,
+																		  aggregate_messages,
+																		  first_results.GetAncillaryData(),
+																		  &query_mask,
+																		  first_results.GetRID()));
 		aggregate_search_result_set->push_back(aggregate_search_results);
-
 	}
 
 	return aggregate_search_result_set;
-
 }
 
 static void s_ModifyVolumePaths(vector<string> & rps_database)
@@ -203,132 +221,158 @@ static void s_ModifyVolumePaths(vector<string> & rps_database)
 	}
 }
 
-static bool s_SortDbSize(const pair<string, Int8> & a, const pair<string, Int8>  & b)
+
+CRef<CSearchResultSet> s_RunLocalRpsSearch(const string & db,
+										   CBlastQueryVector  & query_vector,
+										   CRef<CBlastOptionsHandle> opt_handle)
 {
-	return(a.second > b.second);
+	CSearchDatabase			search_db(db, CSearchDatabase::eBlastDbIsProtein);
+	CRef<CLocalDbAdapter> 	db_adapter(new CLocalDbAdapter(search_db));
+	CRef<IQueryFactory> 	queries(new CObjMgr_QueryFactory(query_vector));
+
+    CLocalBlast lcl_blast(queries, opt_handle, db_adapter);
+    CRef<CSearchResultSet> results = lcl_blast.Run();
+
+    return results;
 }
 
-static void s_MapDbToThread(vector<string> & db, unsigned int num_of_threads)
+// Search the queries against each volume of the RPS database in turn
+static CRef<CSearchResultSet> s_RunRpsSearch(const vector<string> & db,
+											 CBlastQueryVector  & query_vector,
+											 CRef<CBlastOptionsHandle> opt_handle)
 {
-	unsigned int db_size = db.size();
-	vector <pair <string, Int8> > 	 p;
-
-	for(unsigned int i=0; i < db_size; i++)
+	if(db.size() == 1)
 	{
-		vector<string>	path;
-		CSeqDB::FindVolumePaths(db[i], CSeqDB::eProtein, path, NULL, true);
-		_ASSERT(path.size() == 1);
-		CFile f(path[0]+".loo");
-		Int8 length = f.GetLength();
-		_ASSERT(length > 0 );
-		//Scale down, just in case
-		p.push_back(make_pair(db[i], length/1000));
+		return s_RunLocalRpsSearch(db[0], query_vector, opt_handle);
 	}
 
-	sort(p.begin(), p.end(),s_SortDbSize);
-
-	db.resize(num_of_threads);
-	vector<Int8> acc_size(num_of_threads, 0);
+	vector<CRef<CSearchResultSet> >   results;
+	for(unsigned int i=0; i < db.size(); i++)
+	{
+		results.push_back(s_RunLocalRpsSearch(db[i], query_vector, opt_handle));
+	}
+	return s_CombineVolumeResults(results);
+}
 
-	for(unsigned char i=0; i < num_of_threads; i++)
+// Split the queries into contiguous batches of about the same total length
+static void s_SplitQueries(const CBlastQueryVector & query_vector,
+						   unsigned int num_of_batches,
+						   vector<CRef<CBlastQueryVector> > & batches)
+{
+	unsigned int num_of_queries = query_vector.Size();
+	vector<Int8> lengths(num_of_queries, 1);
+	Int8 total_length = 0;
+	for(unsigned int i=0; i < num_of_queries; i++)
 	{
-		db[i] = p[i].first;
-		acc_size[i] = p[i].second;
+		try {
+			lengths[i] = sequence::GetLength(*query_vector.GetQuerySeqLoc(i),
+											 query_vector.GetScope(i).GetPointer());
+		} catch (const CException &) {
+			// Unknown lengths only make the batches less even
+		}
+		total_length += lengths[i];
 	}
 
-	for(unsigned int i= num_of_threads; i < db_size; i++)
+	Int8 acc_length = 0;
+	unsigned int q = 0;
+	for(unsigned int b=0; b < num_of_batches && q < num_of_queries; b++)
 	{
-		unsigned int min_index = 0;
-		for(unsigned int j=1; j<num_of_threads; j++)
+		CRef<CBlastQueryVector> batch(new CBlastQueryVector);
+		Int8 batch_end = total_length * (b + 1) / num_of_batches;
+		// Each batch takes at least one query and leaves one for each of
+		// the remaining batches
+		do
 		{
-			if(acc_size[j] < acc_size[min_index])
-				min_index = j;
+			acc_length += lengths[q];
+			batch->AddQuery(query_vector.GetBlastSearchQuery(q));
+			q++;
 		}
-
-		acc_size[min_index] += p[i].second;
-		db[min_index] = db[min_index] + delimiter + p[i].first;
+		while(q < num_of_queries &&
+			  num_of_queries - q > num_of_batches - b - 1 &&
+			  acc_length + lengths[q] / 2 <= batch_end);
+		batches.push_back(batch);
 	}
-
-}
-
-CRef<CSearchResultSet> s_RunLocalRpsSearch(const string & db,
-										   CBlastQueryVector  & query_vector,
-										   CRef<CBlastOptionsHandle> opt_handle)
-{
-	CSearchDatabase			search_db(db, CSearchDatabase::eBlastDbIsProtein);
-	CRef<CLocalDbAdapter> 	db_adapter(new CLocalDbAdapter(search_db));
-	CRef<IQueryFactory> 	queries(new CObjMgr_QueryFactory(query_vector));
-
-    CLocalBlast lcl_blast(queries, opt_handle, db_adapter);
-    CRef<CSearchResultSet> results = lcl_blast.Run();
-
-    return results;
 }
 
 
+// Threads take the query batches in turn and search each of them against
+// the whole RPS database; the results go to the slot of the batch
 class CRPSThread : public CThread
 {
 public:
-	CRPSThread(CRef<CBlastQueryVector> query_vector,
-			   const string & db,
+	CRPSThread(const vector<CRef<CBlastQueryVector> > & batches,
+			   vector<CRef<CSearchResultSet> > & results,
+			   unsigned int & next_batch,
+			   CFastMutex & batch_mutex,
+			   const vector<string> & db,
 	           CRef<CBlastOptions> options);
 
 	void * Main(void);
 
-private:
-	CRef<CSearchResultSet>  RunTandemSearches(void);
+	// Error that stopped the thread, empty if none
+	const string & GetError(void) const { return m_error; }
 
+private:
 	CRPSThread(const CRPSThread &);
 	CRPSThread & operator=(const CRPSThread &);
 
-    vector<string> 				m_db;
-    CRef<CBlastOptionsHandle>	m_opt_handle;
-    CRef<CBlastQueryVector>		m_query_vector;
+	const vector<CRef<CBlastQueryVector> > & m_batches;
+	vector<CRef<CSearchResultSet> > & 		 m_results;
+	unsigned int &							 m_next_batch;
+	CFastMutex &							 m_batch_mutex;
+    const vector<string> & 					 m_db;
+    CRef<CBlastOptionsHandle>				 m_opt_handle;
+    string									 m_error;
 };
 
 /* CRPSThread */
 
-CRPSThread::CRPSThread(CRef<CBlastQueryVector>  query_vector,
-		   	   	       const string & db,
+CRPSThread::CRPSThread(const vector<CRef<CBlastQueryVector> > & batches,
+					   vector<CRef<CSearchResultSet> > & results,
+					   unsigned int & next_batch,
+					   CFastMutex & batch_mutex,
+		   	   	       const vector<string> & db,
 		   	   	       CRef<CBlastOptions>  options):
-		   	   	       m_query_vector(query_vector)
-
+		   	   	       m_batches(batches),
+		   	   	       m_results(results),
+		   	   	       m_next_batch(next_batch),
+		   	   	       m_batch_mutex(batch_mutex),
+		   	   	       m_db(db)
 {
 	m_opt_handle.Reset(new CBlastRPSOptionsHandle(options));
-
-    s_ConvertConcatStringToVectorOfString(db, m_db);
 }
 
 void* CRPSThread::Main(void)
 {
-	CRef<CSearchResultSet> * result = new (CRef<CSearchResultSet>);
-	if(m_db.size() == 1)
-	{
-		*result = s_RunLocalRpsSearch(m_db[0],
-				 	 	 	 	 	  *m_query_vector,
-				 	 	 	 	 	   m_opt_handle);
-	}
-	else
-	{
-		*result = RunTandemSearches();
-	}
-	return result;
-
-}
-
-CRef<CSearchResultSet> CRPSThread::RunTandemSearches(void)
-{
-	unsigned int num_of_db = m_db.size();
-	vector<CRef<CSearchResultSet> > results;
+	try {
+		while(1)
+		{
+			unsigned int b;
+			{{
+				CFastMutexGuard guard(m_batch_mutex);
+				b = m_next_batch++;
+			}}
+			if(b >= m_batches.size())
+				break;
 
-	for(unsigned int i=0; i < num_of_db; i++)
-	{
-		results.push_back(s_RunLocalRpsSearch(m_db[i],
-											  *m_query_vector,
-											   m_opt_handle));
+			// Each batch has its own slot, no locking needed
+			m_results[b] = s_RunRpsSearch(m_db, *m_batches[b], m_opt_handle);
+		}
+	} catch (const CException & e) {
+		m_error = e.GetMsg();
+	} catch (const exception & e) {
+		m_error = e.what();
+	} catch (...) {
+		m_error = "unknown error";
 	}
 
-	return s_CombineSearchSets(results, num_of_db);
+	{{
+		// Make the remaining threads stop too
+		CFastMutexGuard guard(m_batch_mutex);
+		if( !m_error.empty())
+			m_next_batch = m_batches.size();
+	}}
+	return NULL;
 }
 
 /* CThreadedRpsBlast */
@@ -345,6 +389,25 @@ CLocalRPSBlast::CLocalRPSBlast(CRef<CBlastQueryVector> query_vector,
 	CSeqDB::FindVolumePaths(db, CSeqDB::eProtein, m_rps_databases, NULL, false);
 	m_num_of_dbs = m_rps_databases.size();
 	if( 1 == m_num_of_dbs)
+	{
+		// Search the database by the name given
+		m_rps_databases[0] = m_db_name;
+	}
+	else
+	{
+		s_ModifyVolumePaths(m_rps_databases);
+	}
+
+	if(kAutoThreadedSearch == m_num_of_threads)
+	{
+		// One thread per database volume by default
+		m_num_of_threads = m_num_of_dbs;
+	}
+	if(m_num_of_threads > m_query_vector->Size())
+	{
+		m_num_of_threads = m_query_vector->Size();
+	}
+	if(m_num_of_threads < 1)
 	{
 		m_num_of_threads = kDisableThreadedSearch;
 	}
@@ -384,25 +447,7 @@ CRef<CSearchResultSet> CLocalRPSBlast::Run(void)
 
 	if(kDisableThreadedSearch == m_num_of_threads)
 	{
-		if(1 == m_num_of_dbs)
-		{
-			return s_RunLocalRpsSearch(m_db_name, *m_query_vector, m_opt_handle);
-		}
-		else
-		{
-		   	s_ModifyVolumePaths(m_rps_databases);
-
-			vector<CRef<CSearchResultSet> >   results;
-			for(unsigned int i=0; i < m_num_of_dbs; i++)
-			{
-				results.push_back(s_RunLocalRpsSearch(m_rps_databases[i],
-													  *m_query_vector,
-													   m_opt_handle));
-
-			}
-			return s_CombineSearchSets(results, m_num_of_dbs);
-		}
-
+		return s_RunRpsSearch(m_rps_databases, *m_query_vector, m_opt_handle);
 	}
 	else
 	{
@@ -412,46 +457,50 @@ CRef<CSearchResultSet> CLocalRPSBlast::Run(void)
 
 CRef<CSearchResultSet> CLocalRPSBlast::RunThreadedSearch(void)
 {
+	vector<CRef<CBlastQueryVector> >	batches;
+	s_SplitQueries(*m_query_vector, m_num_of_threads * kBatchesPerThread, batches);
+
+	// Map the RPS database files once for all threads
+	CRef<CBlastOptions> rps_options(&(m_opt_handle->SetOptions()));
+	CSharedRpsStructuresGuard shared_rps(m_rps_databases, rps_options);
 
-   	s_ModifyVolumePaths(m_rps_databases);
-
-   	if((kAutoThreadedSearch == m_num_of_threads) ||
-   	  (m_num_of_threads > m_rps_databases.size()))
-   	{
-   		//Default num of thread : a thread for each db
-   		m_num_of_threads = m_rps_databases.size();
-   	}
-   	else if(m_num_of_threads < m_rps_databases.size())
-   	{
-   		// Combine databases, modified the size of rps_database
-   		s_MapDbToThread(m_rps_databases, m_num_of_threads);
-   	}
-
-   	vector<CRef<CSearchResultSet> * > 	thread_results(m_num_of_threads, NULL);
-   	vector <CRPSThread* >				thread(m_num_of_threads, NULL);
-   	vector<CRef<CSearchResultSet> >   results;
-
-   	for(unsigned int t=0; t < m_num_of_threads; t++)
-   	{
-   		// CThread destructor is protected, all threads destory themselves when terminated
-   		thread[t] = (new CRPSThread(m_query_vector, m_rps_databases[t], m_opt_handle->SetOptions().Clone()));
-   		thread[t]->Run();
-   	}
-
-   	for(unsigned int t=0; t < m_num_of_threads; t++)
-   	{
-   		thread[t]->Join(reinterpret_cast<void**> (&thread_results[t]));
-   	}
-
-   	for(unsigned int t=0; t < m_num_of_threads; t++)
-   	{
-   		results.push_back(*(thread_results[t]));
-   	}
-
-   	CRef<CBlastRPSInfo>  rpsInfo = CSetupFactory::CreateRpsStructures(m_db_name,
-   	            												CRef<CBlastOptions> (&(m_opt_handle->SetOptions())));
-   	return s_CombineSearchSets(results, m_num_of_threads);
+	vector<CRef<CSearchResultSet> >		results(batches.size());
+	vector<CRef<CRPSThread> >			thread;
+	unsigned int						next_batch = 0;
+	CFastMutex							batch_mutex;
+
+	for(unsigned int t=0; t < m_num_of_threads; t++)
+	{
+		thread.push_back(CRef<CRPSThread>(new CRPSThread(batches, results, next_batch, batch_mutex,
+														 m_rps_databases, m_opt_handle->SetOptions().Clone())));
+		thread[t]->Run();
+	}
 
+	string error;
+	for(unsigned int t=0; t < m_num_of_threads; t++)
+	{
+		thread[t]->Join();
+		if(error.empty())
+			error = thread[t]->GetError();
+	}
+
+	if( !error.empty())
+	{
+		NCBI_THROW(CBlastException, eCoreBlastError, error);
+	}
+
+	// The batches are contiguous, so appending their results in batch order
+	// keeps the order of the queries
+	CRef<CSearchResultSet>   aggregate_search_result_set (new CSearchResultSet());
+	for(unsigned int b=0; b < results.size(); b++)
+	{
+		NON_CONST_ITERATE(CSearchResultSet, r, *(results[b]))
+		{
+			aggregate_search_result_set->push_back(*r);
+		}
+	}
+
+	return aggregate_search_result_set;
 }
 
 
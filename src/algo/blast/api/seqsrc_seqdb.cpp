@@ -33,6 +33,7 @@
 #include <ncbi_pch.hpp>
 #include <objects/seqloc/Seq_id.hpp>
 #include <algo/blast/api/seqsrc_seqdb.hpp>
+#include <algo/blast/api/translated_frame_cache.hpp>
 #include <algo/blast/core/blast_util.h>
 #include <algo/blast/core/blast_seqsrc_impl.h>
 #include <objtools/blast/seqdb_reader/seqdbexpert.hpp>
@@ -69,7 +70,10 @@ struct SSeqDB_SeqSrc_Data {
     /// Make a copy of this object, sharing the same SeqDB object.
     SSeqDB_SeqSrc_Data * clone()
     {
-        return new SSeqDB_SeqSrc_Data(&* seqdb, mask_algo_id, mask_type);
+        SSeqDB_SeqSrc_Data * retval =
+            new SSeqDB_SeqSrc_Data(&* seqdb, mask_algo_id, mask_type);
+        retval->translated_frames = translated_frames;
+        return retval;
     }
     
     /// Convenience to allow datap->method to use SeqDB methods.
@@ -94,6 +98,9 @@ struct SSeqDB_SeqSrc_Data {
     ESubjectMaskingType mask_type;
     bool copied;
     
+    /// Six-frame translations of the sequences, if the database has them.
+    CRef<CTranslatedFrameCache> translated_frames;
+    
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     /// Ranges of the sequence to include (for masking).
@@ -366,6 +373,12 @@ s_SeqDbGetSequence(void* seqdb_handle, BlastSeqSrcGetSeqArg* args)
     
     args->seq->oid = oid;
 
+    /* Pass on the translation made in advance for tblastn and tblastx */
+    if (datap->translated_frames.NotEmpty() && !datap->copied &&
+        args->encoding == eBlastEncodingNcbi2na) {
+        datap->translated_frames->GetFrames(oid, len, args->seq);
+    }
+
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     /* If masks have not been consumed (scanning phase), pass on to engine */
@@ -451,6 +464,9 @@ s_SeqDbGetNextChunk(void* seqdb_handle, BlastSeqSrcIterator* itr)
     if (chunk_type == CSeqDB::eOidRange) {
         itr->itr_type = eOidRange;
         itr->current_pos = itr->oid_range[0];
+        // start reading the chunk that will be handed out next
+        seqdb.PrefetchOidRange(itr->oid_range[1],
+                               2 * itr->oid_range[1] - itr->oid_range[0]);
     } else if (chunk_type == CSeqDB::eOidList) {
         Uint4 new_sz = (Uint4) oid_list.size();
         itr->itr_type = eOidList;
@@ -709,6 +725,9 @@ s_SeqDbSrcNew(BlastSeqSrc* retval, void* args)
             }
         }
 
+        datap->translated_frames =
+            CTranslatedFrameCache::Open(*datap->seqdb);
+
     } catch (const ncbi::CException& e) {
         _BlastSeqSrcImpl_SetInitErrorStr(retval, 
                         strdup(e.ReportThis(eDPF_ErrCodeExplanation).c_str()));
@@ -754,6 +773,7 @@ SeqDbBlastSeqSrcInit(CSeqDB * seqdb,
     BlastSeqSrc * seq_src = NULL;
 
     TSeqDBData data(seqdb, mask_algo_id, mask_type);
+    data.translated_frames = CTranslatedFrameCache::Open(*seqdb);
 
     bssn_info.constructor = & s_SeqDbSrcSharedNew;
     bssn_info.ctor_argument = (void*) & data;
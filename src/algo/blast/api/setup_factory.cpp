@@ -41,7 +41,9 @@ static char const rcsid[] =
 #include <algo/blast/api/blast_options.hpp>
 #include <algo/blast/api/seqsrc_seqdb.hpp>      // for SeqDbBlastSeqSrcInit
 #include <algo/blast/api/blast_mtlock.hpp>      // for Blast_DiagnosticsInitMT
+#include <algo/blast/api/blast_search_stats.hpp>
 #include <algo/blast/api/blast_dbindex.hpp>
+#include <corelib/ncbifile.hpp>
 
 #include "blast_aux_priv.hpp"
 #include "blast_memento_priv.hpp"
@@ -69,20 +71,98 @@ BEGIN_NCBI_SCOPE
 USING_SCOPE(objects);
 BEGIN_SCOPE(blast)
 
+/// RPS-BLAST data structures shared among searches, along with the number
+/// of AcquireSharedRpsStructures calls not yet released
+typedef map< pair<string, int>, pair<CRef<CBlastRPSInfo>, int> > TSharedRpsMap;
+
+/// RPS-BLAST data structures shared among searches, keyed by the path of the
+/// database volume and the files mapped
+static TSharedRpsMap s_SharedRpsInfo;
+
+/// Protects s_SharedRpsInfo
+DEFINE_STATIC_FAST_MUTEX(s_SharedRpsInfoMutex);
+
+/// Determine which files of an RPS-BLAST database a search needs
+static CBlastRPSInfo::EOpenFlags
+s_GetRpsOpenFlags(const CBlastOptions& options)
+{
+    return (options.GetCompositionBasedStats() == eNoCompositionBasedStats) 
+           ? CBlastRPSInfo::fRpsBlast : CBlastRPSInfo::fRpsBlastWithCBS;
+}
+
+/// Key of an RPS-BLAST database in s_SharedRpsInfo
+static pair<string, int>
+s_GetSharedRpsKey(const string& rps_dbname, CBlastRPSInfo::EOpenFlags mode)
+{
+    // Different names may refer to the same files, so use the path that
+    // CBlastRPSInfo maps
+    vector<string> paths;
+    CSeqDB::FindVolumePaths(rps_dbname, CSeqDB::eProtein, paths);
+    return make_pair(paths.empty() ? rps_dbname : paths.front(), (int)mode);
+}
+
 CRef<CBlastRPSInfo>
 CSetupFactory::CreateRpsStructures(const string& rps_dbname,
                                    CRef<CBlastOptions> options)
 {
-    CBlastRPSInfo::EOpenFlags mode = 
-             (options->GetCompositionBasedStats() == eNoCompositionBasedStats) 
-             ? CBlastRPSInfo::fRpsBlast : CBlastRPSInfo::fRpsBlastWithCBS;
-    CRef<CBlastRPSInfo> retval(new CBlastRPSInfo(rps_dbname, mode));
+    CBlastRPSInfo::EOpenFlags mode = s_GetRpsOpenFlags(*options);
+    CRef<CBlastRPSInfo> retval;
+    {{
+        CFastMutexGuard LOCK(s_SharedRpsInfoMutex);
+        if ( !s_SharedRpsInfo.empty() ) {
+            TSharedRpsMap::const_iterator it =
+                s_SharedRpsInfo.find(s_GetSharedRpsKey(rps_dbname, mode));
+            if (it != s_SharedRpsInfo.end()) {
+                retval = it->second.first;
+            }
+        }
+    }}
+    if (retval.Empty()) {
+        retval.Reset(new CBlastRPSInfo(rps_dbname, mode));
+    }
     options->SetMatrixName(retval->GetMatrixName());
     options->SetGapOpeningCost(retval->GetGapOpeningCost());
     options->SetGapExtensionCost(retval->GetGapExtensionCost());
     return retval;
 }
 
+void
+CSetupFactory::AcquireSharedRpsStructures(const string& rps_dbname,
+                                          CRef<CBlastOptions> options)
+{
+    CBlastRPSInfo::EOpenFlags mode = s_GetRpsOpenFlags(*options);
+    pair<string, int> key = s_GetSharedRpsKey(rps_dbname, mode);
+
+    CFastMutexGuard LOCK(s_SharedRpsInfoMutex);
+    TSharedRpsMap::iterator it = s_SharedRpsInfo.find(key);
+    if (it == s_SharedRpsInfo.end()) {
+        CRef<CBlastRPSInfo> rps_info(new CBlastRPSInfo(rps_dbname, mode));
+        it = s_SharedRpsInfo.insert
+            (TSharedRpsMap::value_type(key, make_pair(rps_info, 0))).first;
+    }
+    it->second.second++;
+
+    const CBlastRPSInfo& rps_info = *it->second.first;
+    options->SetMatrixName(rps_info.GetMatrixName());
+    options->SetGapOpeningCost(rps_info.GetGapOpeningCost());
+    options->SetGapExtensionCost(rps_info.GetGapExtensionCost());
+}
+
+void
+CSetupFactory::ReleaseSharedRpsStructures(const string& rps_dbname,
+                                          CRef<CBlastOptions> options)
+{
+    pair<string, int> key =
+        s_GetSharedRpsKey(rps_dbname, s_GetRpsOpenFlags(*options));
+
+    CFastMutexGuard LOCK(s_SharedRpsInfoMutex);
+    TSharedRpsMap::iterator it = s_SharedRpsInfo.find(key);
+    if (it != s_SharedRpsInfo.end() && --it->second.second == 0) {
+        // searches still running keep their own reference
+        s_SharedRpsInfo.erase(it);
+    }
+}
+
 /** 
  * @brief Auxiliary function to extract the Seq-ids from the ILocalQueryData
  * and bundle them in a Packed-seqint
@@ -183,6 +263,110 @@ CSetupFactory::CreateScoreBlock(const CBlastOptionsMemento* opts_memento,
     return retval;
 }
 
+/// Environment variable naming the directory where lookup table images are
+/// cached
+static const char* kLookupTableCacheEnv = "BLAST_LOOKUP_TABLE_CACHE";
+
+/// Get the directory where lookup table images are cached
+/// @param opts_memento Memento options object [in]
+/// @param rps_info RPS-BLAST data structures, if any [in]
+/// @return the directory, or an empty string if lookup tables of this
+/// search are not cached
+static string
+s_GetLookupTableCacheDir(const CBlastOptionsMemento* opts_memento,
+                         const CBlastRPSInfo* rps_info)
+{
+    // indexed megablast builds its own lookup structure
+    const ELookupTableType lut_type = opts_memento->m_LutOpts->lut_type;
+    if (rps_info || lut_type == eIndexedMBLookupTable ||
+        lut_type == eMixedMBLookupTable) {
+        return kEmptyStr;
+    }
+    const char* dir = getenv(kLookupTableCacheEnv);
+    if (dir == NULL || NStr::IsBlank(dir) || !CDir(dir).Exists()) {
+        return kEmptyStr;
+    }
+    return dir;
+}
+
+/// Release the memory map of a lookup table image; passed to the core
+/// library as T_LookupTableImageRelease
+/// @param owner the memory-mapped image [in]
+static void
+s_ReleaseLookupTableImage(void* owner)
+{
+    delete static_cast<CMemoryFile*>(owner);
+}
+
+/// Memory-map a saved lookup table image
+/// @param path name of the image file [in]
+/// @param fingerprint fingerprint of the lookup table wanted [in]
+/// @param queries query sequence, prepared for the lookup table [in|out]
+/// @return the lookup table, or NULL if there is no valid image
+static LookupTableWrap*
+s_AttachLookupTableImage(const string& path, Uint8 fingerprint,
+                         BLAST_SequenceBlk* queries)
+{
+    if ( !CFile(path).Exists() ) {
+        return NULL;
+    }
+    LookupTableWrap* retval(0);
+    try {
+        auto_ptr<CMemoryFile> image(new CMemoryFile(path));
+        if (image->GetPtr() &&
+            LookupTableWrapImageAttach(image->GetPtr(), image->GetSize(),
+                                       fingerprint, queries, &retval) == 0) {
+            retval->image_owner = image.release();
+            retval->image_release = (void*) s_ReleaseLookupTableImage;
+        }
+    } catch (const CException& e) {
+        ERR_POST(Warning << "Cannot map lookup table image " << path
+                 << ": " << e.GetMsg());
+        retval = LookupTableWrapFree(retval);
+    }
+    return retval;
+}
+
+/// Save a lookup table image, if the lookup table type supports it
+/// @param lookup the lookup table [in]
+/// @param queries query sequence the table was built for [in]
+/// @param fingerprint fingerprint of the lookup table [in]
+/// @param path name of the image file [in]
+static void
+s_SaveLookupTableImage(const LookupTableWrap* lookup,
+                       const BLAST_SequenceBlk* queries, Uint8 fingerprint,
+                       const string& path)
+{
+    const size_t kSize = LookupTableWrapImageSize(lookup, queries);
+    if (kSize == 0) {
+        return;
+    }
+    // The image is written under a unique name and renamed, so that other
+    // processes never map a partially written image
+    CDirEntry dir_entry(path);
+    CFile tmp_file(CFile::GetTmpNameEx(dir_entry.GetDir(), "lut_tmp_"));
+    try {
+        bool written = false;
+        {{
+            CMemoryFile image(tmp_file.GetPath(),
+                              CMemoryFile::eMMP_ReadWrite,
+                              CMemoryFile::eMMS_Shared, 0, kSize,
+                              CMemoryFile::eCreate, kSize);
+            written = image.GetPtr() &&
+                LookupTableWrapImageWrite(lookup, queries, fingerprint,
+                                          image.GetPtr(), kSize) == 0 &&
+                image.Flush();
+        }}
+        if (written && tmp_file.Rename(path, CDirEntry::fRF_Overwrite)) {
+            return;
+        }
+    } catch (const CException& e) {
+        ERR_POST(Warning << "Cannot save lookup table image " << path
+                 << ": " << e.GetMsg());
+    }
+    tmp_file.Remove();
+}
+
 LookupTableWrap*
 CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
                                  const CBlastOptionsMemento* opts_memento,
@@ -197,6 +381,25 @@ CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
 
     BlastSeqLoc * lookup_segments = lookup_segments_wrap->getLocs();
 
+    // Reuse the lookup table saved by an earlier search with the same
+    // queries and options
+    const string kCacheDir = s_GetLookupTableCacheDir(opts_memento, rps_info);
+    Uint8 fingerprint = 0;
+    string image_path;
+    if ( !kCacheDir.empty() ) {
+        fingerprint = LookupTableWrapFingerprint(queries,
+                                                 opts_memento->m_LutOpts,
+                                                 opts_memento->m_QueryOpts,
+                                                 lookup_segments,
+                                                 score_blk);
+        image_path = CDirEntry::MakePath(kCacheDir, "lut_" +
+                         NStr::UInt8ToString(fingerprint, 0, 16), "img");
+        retval = s_AttachLookupTableImage(image_path, fingerprint, queries);
+        if (retval) {
+            return retval;
+        }
+    }
+
     Int2 status = LookupTableWrapInit(queries,
                                       opts_memento->m_LutOpts,
                                       opts_memento->m_QueryOpts,
@@ -220,6 +423,10 @@ CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
          NCBI_THROW(CBlastException, eCoreBlastError, msg);
     }
 
+    if ( !kCacheDir.empty() ) {
+        s_SaveLookupTableImage(retval, queries, fingerprint, image_path);
+    }
+
     // For PHI BLAST, save information about pattern occurrences in query in
     // the BlastQueryInfo structure
     if (Blast_ProgramIsPhiBlast(opts_memento->m_ProgramType)) {
@@ -257,13 +464,17 @@ CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
 BlastDiagnostics*
 CSetupFactory::CreateDiagnosticsStructure()
 {
-    return Blast_DiagnosticsInit();
+    BlastDiagnostics* retval = Blast_DiagnosticsInit();
+    CBlastSearchStats::InitDiagnostics(retval);
+    return retval;
 }
 
 BlastDiagnostics*
 CSetupFactory::CreateDiagnosticsStructureMT()
 {
-    return Blast_DiagnosticsInitMT(Blast_CMT_LOCKInit());
+    BlastDiagnostics* retval = Blast_DiagnosticsInitMT(Blast_CMT_LOCKInit());
+    CBlastSearchStats::InitDiagnostics(retval);
+    return retval;
 }
 
 BlastHSPStream*
@@ -277,6 +488,34 @@ CSetupFactory::CreateHspStream(const CBlastOptionsMemento* opts_memento,
                              number_of_queries, writer);
 }
 
+/// Environment variable holding the memory limit of the HSP stream
+static const char* kHspStreamMemoryLimitEnv = "BLAST_HSP_STREAM_MEMORY_LIMIT";
+
+void
+CSetupFactory::SetHspStreamMemoryLimit(BlastHSPStream* hsp_stream)
+{
+    const char* limit = getenv(kHspStreamMemoryLimitEnv);
+    if (limit == NULL || NStr::IsBlank(limit)) {
+        return;
+    }
+
+    Uint8 max_bytes = 0;
+    try {
+        max_bytes = NStr::StringToUInt8_DataSize(limit);
+    } catch (const CStringException&) {
+        ERR_POST(Warning << "Invalid " << kHspStreamMemoryLimitEnv
+                 << " value ignored: " << limit);
+        return;
+    }
+    if (max_bytes > (Uint8) kMax_I8) {
+        max_bytes = kMax_I8;
+    }
+    if (BlastHSPStreamSetMemoryLimit(hsp_stream, (Int8) max_bytes) != 0) {
+        ERR_POST(Warning << kHspStreamMemoryLimitEnv
+                 << " is not supported for this search");
+    }
+}
+
 BlastHSPWriter*
 CSetupFactory::CreateHspWriter(const CBlastOptionsMemento* opts_memento,
                                BlastQueryInfo* query_info)
@@ -41,6 +41,9 @@ static char const rcsid[] =
 #include <algo/blast/api/seqinfosrc_seqdb.hpp>  // for CSeqDbSeqInfoSrc
 #include <objtools/blast/seqdb_reader/seqdb.hpp>     // for CSeqDb
 #include <algo/blast/api/subj_ranges_set.hpp>
+#include <algo/blast/api/blast_mtlock.hpp>
+#include <algo/blast/api/blast_search_stats.hpp>
+#include <corelib/ncbithr.hpp>                  // for CThread
 
 #include "blast_memento_priv.hpp"
 #include "blast_seqalign.hpp"
@@ -61,6 +64,84 @@ BEGIN_NCBI_SCOPE
 USING_SCOPE(objects);
 BEGIN_SCOPE(blast)
 
+/// Stage the time spent in the traceback is counted in: with
+/// composition-based statistics or Smith-Waterman traceback, the traceback
+/// is done by the code recomputing the alignments
+/// @param opts_memento Options of the search [in]
+static EBlastTimedStage
+s_GetTracebackStage(const CBlastOptionsMemento* opts_memento)
+{
+    const BlastExtensionOptions* ext_options = opts_memento->m_ExtnOpts;
+    return (ext_options->compositionBasedStats > 0 ||
+            ext_options->eTbackExt == eSmithWatermanTbck)
+        ? eBlastStageCompAdjust : eBlastStageTraceback;
+}
+
+/// Thread class to run part of the traceback stage of the BLAST search
+class CTracebackSearchThread : public CThread
+{
+public:
+    CTracebackSearchThread(const SInternalData& internal_data,
+                           const CBlastOptionsMemento* opts_memento,
+                           BlastTracebackWork* work)
+        : m_InternalData(internal_data), m_OptsMemento(opts_memento),
+          m_Work(work), m_Ticks(0),
+          m_TimeStages(internal_data.m_Diagnostics.NotEmpty() &&
+                       internal_data.m_Diagnostics->GetPointer()->stage_times)
+    {
+        // The following fields need to be copied to ensure MT-safety
+        BlastSeqSrc* seqsrc = 
+            BlastSeqSrcCopy(m_InternalData.m_SeqSrc->GetPointer());
+        m_InternalData.m_SeqSrc.Reset(new TBlastSeqSrc(seqsrc, 
+                                                       BlastSeqSrcFree));
+        // The progress field must be copied to ensure MT-safety
+        if (m_InternalData.m_ProgressMonitor->Get()) {
+            SBlastProgress* bp = 
+                SBlastProgressNew(m_InternalData.m_ProgressMonitor->Get()->user_data);
+            m_InternalData.m_ProgressMonitor.Reset(new CSBlastProgress(bp));
+        }
+    }
+
+    /// Clock ticks the thread spent in the traceback
+    Int8 GetTicks() const { return m_Ticks; }
+
+protected:
+    virtual ~CTracebackSearchThread(void) {}
+
+    virtual void* Main(void) {
+        const Int8 kStart = m_TimeStages ? Blast_StageClock() : 0;
+        Int2 retval =
+            Blast_RunTracebackSearchThread(m_OptsMemento->m_ProgramType,
+                                     m_InternalData.m_Queries,
+                                     m_InternalData.m_QueryInfo,
+                                     m_InternalData.m_SeqSrc->GetPointer(),
+                                     m_OptsMemento->m_ScoringOpts,
+                                     m_OptsMemento->m_ExtnOpts,
+                                     m_OptsMemento->m_HitSaveOpts,
+                                     m_OptsMemento->m_EffLenOpts,
+                                     m_OptsMemento->m_DbOpts,
+                                     m_OptsMemento->m_PSIBlastOpts,
+                                     m_InternalData.m_ScoreBlk->GetPointer(),
+                                     m_Work,
+                                     m_InternalData.m_FnInterrupt,
+                                     m_InternalData.m_ProgressMonitor->Get());
+        if (m_TimeStages) {
+            m_Ticks = Blast_StageClock() - kStart;
+        }
+        return (void*) ((intptr_t) retval);
+    }
+
+private:
+    SInternalData m_InternalData;
+    const CBlastOptionsMemento* m_OptsMemento;
+    /// Subjects and HSP lists shared with the other threads (not owned)
+    BlastTracebackWork* m_Work;
+    /// Clock ticks spent in the traceback
+    Int8 m_Ticks;
+    /// Is the time spent in the traceback measured?
+    bool m_TimeStages;
+};
+
 CBlastTracebackSearch::CBlastTracebackSearch(CRef<IQueryFactory>   qf,
                                              CRef<CBlastOptions>   opts,
                                              BlastSeqSrc         * seqsrc,
@@ -228,25 +309,37 @@ CBlastTracebackSearch::Run()
     }
     
     BlastHSPResults * hsp_results(0);
-    int status =
-        Blast_RunTracebackSearchWithInterrupt(m_OptsMemento->m_ProgramType,
-                                 m_InternalData->m_Queries,
-                                 m_InternalData->m_QueryInfo,
-                                 m_InternalData->m_SeqSrc->GetPointer(),
-                                 m_OptsMemento->m_ScoringOpts,
-                                 m_OptsMemento->m_ExtnOpts,
-                                 m_OptsMemento->m_HitSaveOpts,
-                                 m_OptsMemento->m_EffLenOpts,
-                                 m_OptsMemento->m_DbOpts,
-                                 m_OptsMemento->m_PSIBlastOpts,
-                                 m_InternalData->m_ScoreBlk->GetPointer(),
-                                 m_InternalData->m_HspStream->GetPointer(),
-                                 m_InternalData->m_RpsData ?
-                                 (*m_InternalData->m_RpsData)() : 0,
-                                 phi_lookup_table,
-                                 & hsp_results,
-                                 m_InternalData->m_FnInterrupt,
-                                 m_InternalData->m_ProgressMonitor->Get());
+    int status = 0;
+    if (IsMultiThreaded() &&
+        Blast_TracebackSupportsThreads(m_OptsMemento->m_ProgramType,
+                                m_OptsMemento->m_ExtnOpts,
+                                m_InternalData->m_SeqSrc->GetPointer())) {
+        status = x_LaunchMultiThreadedTraceback(&hsp_results);
+    } else {
+        CBlastStageTimer timer(m_InternalData->m_Diagnostics.NotEmpty()
+                               ? m_InternalData->m_Diagnostics->GetPointer()
+                               : NULL,
+                               s_GetTracebackStage(m_OptsMemento), 0);
+        status =
+            Blast_RunTracebackSearchWithInterrupt(m_OptsMemento->m_ProgramType,
+                                     m_InternalData->m_Queries,
+                                     m_InternalData->m_QueryInfo,
+                                     m_InternalData->m_SeqSrc->GetPointer(),
+                                     m_OptsMemento->m_ScoringOpts,
+                                     m_OptsMemento->m_ExtnOpts,
+                                     m_OptsMemento->m_HitSaveOpts,
+                                     m_OptsMemento->m_EffLenOpts,
+                                     m_OptsMemento->m_DbOpts,
+                                     m_OptsMemento->m_PSIBlastOpts,
+                                     m_InternalData->m_ScoreBlk->GetPointer(),
+                                     m_InternalData->m_HspStream->GetPointer(),
+                                     m_InternalData->m_RpsData ?
+                                     (*m_InternalData->m_RpsData)() : 0,
+                                     phi_lookup_table,
+                                     & hsp_results,
+                                     m_InternalData->m_FnInterrupt,
+                                     m_InternalData->m_ProgressMonitor->Get());
+    }
     if (status) {
         NCBI_THROW(CBlastException, eCoreBlastError, "Traceback failed"); 
     }
@@ -291,6 +384,69 @@ CBlastTracebackSearch::Run()
                                      m_ResultType);
 }
 
+int
+CBlastTracebackSearch::x_LaunchMultiThreadedTraceback(BlastHSPResults** hsp_results)
+{
+    typedef vector< CRef<CTracebackSearchThread> > TTracebackThreads;
+    TTracebackThreads the_threads(GetNumberOfThreads());
+
+    // Take all HSP lists from the stream; the threads process whole
+    // subjects (or, with composition-based statistics, whole matches) and
+    // the last one to finish saves the results in the order of the
+    // single-threaded traceback
+    CRef< CStructWrapper<BlastTracebackWork> > work
+        (WrapStruct(BlastTracebackWorkNew(
+                        m_OptsMemento->m_ProgramType,
+                        m_OptsMemento->m_ExtnOpts,
+                        m_InternalData->m_HspStream->GetPointer(),
+                        GetNumberOfThreads(), Blast_CMT_LOCKInit()),
+                    BlastTracebackWorkFree));
+    if (work->GetPointer() == NULL) {
+        NCBI_THROW(CBlastSystemException, eOutOfMemory,
+                   "Failed to allocate traceback work");
+    }
+
+    // Create the threads ...
+    NON_CONST_ITERATE(TTracebackThreads, thread, the_threads) {
+        thread->Reset(new CTracebackSearchThread(*m_InternalData,
+                                                 m_OptsMemento,
+                                                 work->GetPointer()));
+        if (thread->Empty()) {
+            NCBI_THROW(CBlastSystemException, eOutOfMemory,
+                       "Failed to create traceback thread");
+        }
+    }
+
+    // ... launch the threads ...
+    NON_CONST_ITERATE(TTracebackThreads, thread, the_threads) {
+        (*thread)->Run();
+    }
+
+    // ... and wait for the threads to finish
+    NON_CONST_ITERATE(TTracebackThreads, thread, the_threads) {
+        (*thread)->Join();
+    }
+
+    // The diagnostics may not be locked: the times of the threads are
+    // added once they are done
+    BlastDiagnostics* diags = m_InternalData->m_Diagnostics.NotEmpty()
+        ? m_InternalData->m_Diagnostics->GetPointer() : NULL;
+    if (diags && diags->stage_times) {
+        const EBlastTimedStage kStage = s_GetTracebackStage(m_OptsMemento);
+        for (size_t i = 0; i < the_threads.size(); i++) {
+            BlastStageTimes stage_times;
+            memset(&stage_times, 0, sizeof(stage_times));
+            stage_times.thread_index = (Int4) i;
+            stage_times.ticks[kStage] = the_threads[i]->GetTicks();
+            Blast_DiagnosticsAddStageTimes(diags, &stage_times);
+        }
+    }
+
+    *hsp_results = work->GetPointer()->results;
+    work->GetPointer()->results = NULL;
+    return work->GetPointer()->status;
+}
+
 END_SCOPE(blast)
 END_NCBI_SCOPE
 
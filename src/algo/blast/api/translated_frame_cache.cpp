@@ -0,0 +1,333 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/// @file translated_frame_cache.cpp
+/// Implementation of the translated frame cache of nucleotide BLAST
+/// databases.
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbifile.hpp>
+#include <algo/blast/api/translated_frame_cache.hpp>
+#include <algo/blast/api/blast_aux.hpp>         // for FindGeneticCode
+#include <algo/blast/api/blast_exception.hpp>
+#include <algo/blast/core/blast_util.h>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+BEGIN_NCBI_SCOPE
+BEGIN_SCOPE(blast)
+
+const char* CTranslatedFrameCache::kExtension = ".ntf";
+
+/// Identifies a translated frame cache file; a file written on a machine
+/// with a different byte order does not match it
+static const Uint4 kTranslatedFrameCacheMagic = 0x4e544631;
+/// Version of the translated frame cache file format
+static const Uint4 kTranslatedFrameCacheVersion = 1;
+
+/// Header of a translated frame cache file.  It is followed by num_oids+1
+/// file offsets (Uint8) of the records of the sequences of the volume, the
+/// last one being the size of the file.
+struct STranslatedFrameCacheHeader {
+    Uint4 magic;            ///< kTranslatedFrameCacheMagic
+    Uint4 version;          ///< kTranslatedFrameCacheVersion
+    Int4 num_oids;          ///< Number of sequences in the volume
+    Int4 genetic_code;      ///< Genetic code used for the translations
+    Uint1 gen_code_string[GENCODE_STRLEN]; ///< Its translation table
+};
+
+/// Record of a sequence in a translated frame cache file.  It is followed
+/// by the translation buffer made by BLAST_GetAllTranslations, including
+/// the sentinel bytes, and padded to a multiple of 8 bytes.
+struct STranslatedFrameRecord {
+    Int4 length;            ///< Length of the nucleotide sequence
+    Int4 frame_offsets[NUM_FRAMES + 1]; ///< Offsets of the frames
+};
+
+/// Alignment of the records in a translated frame cache file
+static const size_t kTranslatedFrameAlign = 8;
+
+void
+CTranslatedFrameCache::Write(const string& volume, int genetic_code)
+{
+    TAutoUint1ArrayPtr gen_code = FindGeneticCode(genetic_code);
+    if ( !gen_code.get() ) {
+        NCBI_THROW(CBlastException, eInvalidArgument,
+                   "Invalid genetic code: " + NStr::IntToString(genetic_code));
+    }
+
+    CSeqDB db(volume, CSeqDB::eNucleotide);
+    const int kNumOids = db.GetNumOIDs();
+
+    STranslatedFrameCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kTranslatedFrameCacheMagic;
+    header.version = kTranslatedFrameCacheVersion;
+    header.num_oids = kNumOids;
+    header.genetic_code = genetic_code;
+    memcpy(header.gen_code_string, gen_code.get(), GENCODE_STRLEN);
+
+    // The cache is written under a unique name and renamed, so that
+    // searches never map a partially written file
+    const string kPath(volume + kExtension);
+    CFile tmp_file(CFile::GetTmpNameEx(CDirEntry(kPath).GetDir(),
+                                       "ntf_tmp_"));
+    try {
+        CNcbiOfstream out(tmp_file.GetPath().c_str(),
+                          IOS_BASE::out | IOS_BASE::binary);
+
+        // The offsets are known after the records are written
+        vector<Uint8> offsets(kNumOids + 1, 0);
+        out.write((const char*) &header, sizeof(header));
+        out.write((const char*) &offsets[0], offsets.size() * sizeof(Uint8));
+        Uint8 offset = sizeof(header) + offsets.size() * sizeof(Uint8);
+
+        static const char kPadding[kTranslatedFrameAlign] = { 0 };
+        for (int oid = 0; oid < kNumOids && out; oid++) {
+            offsets[oid] = offset;
+
+            STranslatedFrameRecord record;
+            memset(&record, 0, sizeof(record));
+            Uint1* translation = NULL;
+            Int4* frame_offsets = NULL;
+
+            // Translate the sequence exactly as the preliminary stage of
+            // the search would
+            const char* seq = NULL;
+            record.length = db.GetSequence(oid, &seq);
+            if (record.length > 0 &&
+                BLAST_GetAllTranslations((const Uint1*) seq,
+                                         eBlastEncodingNcbi2na,
+                                         record.length, gen_code.get(),
+                                         &translation, &frame_offsets,
+                                         NULL) != 0) {
+                db.RetSequence(&seq);
+                NCBI_THROW(CBlastException, eCoreBlastError,
+                           "Cannot translate sequence " +
+                           NStr::IntToString(oid) + " of " + volume);
+            }
+            db.RetSequence(&seq);
+
+            size_t buffer_size = 1;
+            if (translation) {
+                memcpy(record.frame_offsets, frame_offsets,
+                       sizeof(record.frame_offsets));
+                buffer_size = frame_offsets[NUM_FRAMES] + 1;
+            }
+            const size_t kRecordSize = sizeof(record) + buffer_size;
+            const size_t kPaddingSize = (kTranslatedFrameAlign -
+                kRecordSize % kTranslatedFrameAlign) % kTranslatedFrameAlign;
+
+            out.write((const char*) &record, sizeof(record));
+            out.write(translation ? (const char*) translation : kPadding,
+                      buffer_size);
+            out.write(kPadding, kPaddingSize);
+            offset += kRecordSize + kPaddingSize;
+
+            sfree(translation);
+            sfree(frame_offsets);
+        }
+        offsets[kNumOids] = offset;
+
+        out.seekp(sizeof(header));
+        out.write((const char*) &offsets[0], offsets.size() * sizeof(Uint8));
+        out.close();
+        if ( !out ) {
+            NCBI_THROW(CBlastException, eCoreBlastError,
+                       "Cannot write translated frame cache " +
+                       tmp_file.GetPath());
+        }
+        if ( !tmp_file.Rename(kPath, CDirEntry::fRF_Overwrite) ) {
+            NCBI_THROW(CBlastException, eCoreBlastError,
+                       "Cannot rename translated frame cache to " + kPath);
+        }
+    } catch (...) {
+        tmp_file.Remove();
+        throw;
+    }
+}
+
+CRef<CTranslatedFrameCache>
+CTranslatedFrameCache::Open(const CSeqDB& db)
+{
+    CRef<CTranslatedFrameCache> retval;
+    if (db.GetSequenceType() != CSeqDB::eNucleotide) {
+        return retval;
+    }
+
+    vector<string> volumes;
+    vector<int> oid_starts;
+    db.GetVolumeOidStarts(volumes, oid_starts);
+
+    int num_cached = 0;
+    ITERATE(vector<string>, volume, volumes) {
+        if (CFile(*volume + kExtension).Exists()) {
+            num_cached++;
+        }
+    }
+    if (num_cached == 0) {
+        return retval;
+    }
+    if (num_cached < (int) volumes.size()) {
+        ERR_POST(Warning << "Translated frame cache not used: only "
+                 << num_cached << " of " << volumes.size()
+                 << " database volumes have one");
+        return retval;
+    }
+
+    CRef<CTranslatedFrameCache> cache(new CTranslatedFrameCache);
+    for (size_t i = 0; i < volumes.size(); i++) {
+        const int kOidEnd = (i + 1 < volumes.size()) ? oid_starts[i + 1]
+                                                     : db.GetNumOIDs();
+        const Uint1* gen_code = NULL;
+        if ( !cache->m_Volumes.empty() ) {
+            gen_code = ((const STranslatedFrameCacheHeader*)
+                cache->m_Volumes.front().file->GetPtr())->gen_code_string;
+        }
+        if ( !cache->x_AddVolume(volumes[i], oid_starts[i],
+                                 kOidEnd - oid_starts[i], gen_code) ) {
+            ERR_POST(Warning << "Translated frame cache not used: "
+                     << volumes[i] << kExtension
+                     << " is not valid for this database");
+            return retval;
+        }
+    }
+    retval = cache;
+    return retval;
+}
+
+CTranslatedFrameCache::~CTranslatedFrameCache()
+{
+    NON_CONST_ITERATE(vector<SVolume>, volume, m_Volumes) {
+        delete volume->file;
+    }
+}
+
+bool
+CTranslatedFrameCache::x_AddVolume(const string& volume, int oid_start,
+                                   int num_oids, const Uint1* gen_code)
+{
+    const string kPath(volume + kExtension);
+
+    // A cache older than the sequence data was made for another database
+    if (CFile(volume + ".nsq").IsNewer(kPath,
+                                       CDirEntry::fNoThisHasPath_NotNewer)) {
+        return false;
+    }
+
+    auto_ptr<CMemoryFile> file;
+    try {
+        file.reset(new CMemoryFile(kPath));
+    } catch (const CException& e) {
+        ERR_POST(Warning << "Cannot map translated frame cache " << kPath
+                 << ": " << e.GetMsg());
+        return false;
+    }
+
+    const size_t kSize = file->GetSize();
+    const STranslatedFrameCacheHeader* header =
+        (const STranslatedFrameCacheHeader*) file->GetPtr();
+    if ( !header || kSize < sizeof(*header) ||
+         header->magic != kTranslatedFrameCacheMagic ||
+         header->version != kTranslatedFrameCacheVersion ||
+         header->num_oids != num_oids ||
+         kSize < sizeof(*header) + (num_oids + 1) * sizeof(Uint8) ||
+         ((const Uint8*) (header + 1))[num_oids] != kSize ) {
+        return false;
+    }
+    if (gen_code &&
+        memcmp(gen_code, header->gen_code_string, GENCODE_STRLEN) != 0) {
+        return false;
+    }
+
+    SVolume vol;
+    vol.oid_start = oid_start;
+    vol.file = file.release();
+    m_Volumes.push_back(vol);
+    return true;
+}
+
+bool
+CTranslatedFrameCache::GetFrames(int oid, Int4 length,
+                                 BLAST_SequenceBlk* seq) const
+{
+    if (m_Volumes.empty() || oid < m_Volumes.front().oid_start) {
+        return false;
+    }
+
+    // Find the last volume starting at or before the OID
+    size_t lo = 0, hi = m_Volumes.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (m_Volumes[mid].oid_start <= oid) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    const SVolume& vol = m_Volumes[lo];
+    const Uint1* base = (const Uint1*) vol.file->GetPtr();
+    const STranslatedFrameCacheHeader* header =
+        (const STranslatedFrameCacheHeader*) base;
+    const int kVolOid = oid - vol.oid_start;
+    if (kVolOid >= header->num_oids) {
+        return false;
+    }
+
+    const Uint8* offsets = (const Uint8*) (header + 1);
+    const Uint8 kStart = offsets[kVolOid];
+    const Uint8 kEnd = offsets[kVolOid + 1];
+    if (kStart + sizeof(STranslatedFrameRecord) > kEnd ||
+        kEnd > vol.file->GetSize()) {
+        return false;
+    }
+    const STranslatedFrameRecord* record =
+        (const STranslatedFrameRecord*) (base + kStart);
+    if (record->length != length || length <= 0 ||
+        kStart + sizeof(*record) + record->frame_offsets[NUM_FRAMES] + 1
+            > kEnd) {
+        return false;
+    }
+
+    seq->translation_buffer = (const Uint1*) (record + 1);
+    seq->frame_offsets = record->frame_offsets;
+    seq->translation_gen_code = header->gen_code_string;
+    return true;
+}
+
+END_SCOPE(blast)
+END_NCBI_SCOPE
+
+/* @} */
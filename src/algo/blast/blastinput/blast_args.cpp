@@ -2048,6 +2048,21 @@ CMTArgs::SetArgumentDescriptions(CArgDescriptions& arg_desc)
     arg_desc.SetDependency(kArgNumThreads,
                            CArgDescriptions::eExcludes,
                            kArgRemote);
+
+    // memory budget of pipelined query batches
+    if (m_SupportsPipeline) {
+        arg_desc.AddDefaultKey(kArgPipelineMemory, "int_value",
+                               "Read the next query batches and format the "
+                               "results of the previous ones while searching, "
+                               "keeping at most this many MB of query batches "
+                               "in flight (0 disables pipelining)",
+                               CArgDescriptions::eInteger, "0");
+        arg_desc.SetConstraint(kArgPipelineMemory,
+                               new CArgAllowValuesGreaterThanOrEqual(0));
+        arg_desc.SetDependency(kArgPipelineMemory,
+                               CArgDescriptions::eExcludes,
+                               kArgRemote);
+    }
     /*
     arg_desc.SetDependency(kArgNumThreads,
                            CArgDescriptions::eExcludes,
@@ -2064,7 +2079,7 @@ CMTArgs::x_SetArgumentDescriptionsRpsBlast(CArgDescriptions& arg_desc)
     arg_desc.AddDefaultKey(kArgNumThreads, "int_value",
                            "Number of threads to use in RPS BLAST search:\n "
                            "0 (auto = num of databases)\n "
-                           "1 (disable)\n max number of threads = num of databases",
+                           "1 (disable)\n max number of threads = num of queries",
                            CArgDescriptions::eInteger,
                            NStr::IntToString(kDefaultRpsNumThreads));
     arg_desc.SetConstraint(kArgNumThreads,
@@ -2100,6 +2115,10 @@ CMTArgs::ExtractAlgorithmOptions(const CArgs& args, CBlastOptions& /* opts */)
                      << "ignored when '" << kArgSubject << "' is specified.");
         }
     }
+    if (args.Exist(kArgPipelineMemory) &&
+        args[kArgPipelineMemory].HasValue()) {
+        m_PipelineMemory = args[kArgPipelineMemory].AsInteger();
+    }
 }
 
 void
@@ -2132,6 +2151,17 @@ CRemoteArgs::ExtractAlgorithmOptions(const CArgs& args, CBlastOptions& /* opts *
 void
 CDebugArgs::SetArgumentDescriptions(CArgDescriptions& arg_desc)
 {
+    if (m_SupportsSearchStats) {
+        arg_desc.SetCurrentGroup("Miscellaneous options");
+        arg_desc.AddOptionalKey(kArgSearchStats, "filename",
+                                "Write hit counts and time spent in each "
+                                "search stage as JSON",
+                                CArgDescriptions::eOutputFile);
+        arg_desc.SetDependency(kArgSearchStats,
+                               CArgDescriptions::eExcludes,
+                               kArgRemote);
+        arg_desc.SetCurrentGroup("");
+    }
 #if _BLAST_DEBUG
     arg_desc.SetCurrentGroup("Miscellaneous options");
     arg_desc.AddFlag("verbose", "Produce verbose output (show BLAST options)",
@@ -2158,6 +2188,16 @@ CDebugArgs::ExtractAlgorithmOptions(const CArgs& args, CBlastOptions& /* opts */
 #endif /* _BLAST_DEBUG */
 }
 
+CNcbiOstream*
+CDebugArgs::GetSearchStatsStream(const CArgs& args) const
+{
+    CNcbiOstream* retval = NULL;
+    if (m_SupportsSearchStats && args[kArgSearchStats].HasValue()) {
+        retval = &args[kArgSearchStats].AsOutputFile();
+    }
+    return retval;
+}
+
 void
 CHspFilteringArgs::SetArgumentDescriptions(CArgDescriptions& arg_desc)
 {
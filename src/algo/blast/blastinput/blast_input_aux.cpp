@@ -63,7 +63,8 @@ CAutoOutputFileReset::GetStream()
 }
 
 int
-GetQueryBatchSize(EProgram program, bool is_ungapped /* = false */, bool is_remote /* = false */)
+GetQueryBatchSize(EProgram program, bool is_ungapped /* = false */, bool is_remote /* = false */,
+                  int num_threads /* = 1 */)
 {
     int retval = 0;
 
@@ -119,6 +120,10 @@ GetQueryBatchSize(EProgram program, bool is_ungapped /* = false */, bool is_remo
         break;
     }
 
+    if (num_threads > 1) {
+        retval *= num_threads;
+    }
+
     _TRACE("Using query batch size " << retval);
     return retval;
 }
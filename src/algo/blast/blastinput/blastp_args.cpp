@@ -99,7 +99,7 @@ CBlastpAppArgs::CBlastpAppArgs()
     arg.Reset(m_FormattingArgs);
     m_Args.push_back(arg);
 
-    m_MTArgs.Reset(new CMTArgs);
+    m_MTArgs.Reset(new CMTArgs(false, true));
     arg.Reset(m_MTArgs);
     m_Args.push_back(arg);
 
@@ -113,7 +113,7 @@ CBlastpAppArgs::CBlastpAppArgs()
     arg.Reset(new CCompositionBasedStatsArgs);
     m_Args.push_back(arg);
 
-    m_DebugArgs.Reset(new CDebugArgs);
+    m_DebugArgs.Reset(new CDebugArgs(true));
     arg.Reset(m_DebugArgs);
     m_Args.push_back(arg);
 }
@@ -73,6 +73,8 @@ const string kArgDbGeneticCode("db_gencode");
 
 const string kArgRemote("remote");
 const string kArgNumThreads("num_threads");
+const string kArgPipelineMemory("pipeline_memory");
+const string kArgSearchStats("stats");
 
 const string kArgMatrixName("matrix");
 
@@ -123,7 +123,8 @@ int
 CRPSBlastAppArgs::GetQueryBatchSize() const
 {
     bool is_remote = (m_RemoteArgs.NotEmpty() && m_RemoteArgs->ExecuteRemotely());
-    return blast::GetQueryBatchSize(eRPSBlast, m_IsUngapped, is_remote);
+    return blast::GetQueryBatchSize(eRPSBlast, m_IsUngapped, is_remote,
+                                    (int) GetNumThreads());
 }
 
 END_SCOPE(blast)
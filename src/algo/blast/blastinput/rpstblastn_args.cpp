@@ -119,7 +119,8 @@ int
 CRPSTBlastnAppArgs::GetQueryBatchSize() const
 {
     bool is_remote = (m_RemoteArgs.NotEmpty() && m_RemoteArgs->ExecuteRemotely());
-    return blast::GetQueryBatchSize(eRPSTblastn, m_IsUngapped, is_remote);
+    return blast::GetQueryBatchSize(eRPSTblastn, m_IsUngapped, is_remote,
+                                    (int) GetNumThreads());
 }
 
 END_SCOPE(blast)
@@ -126,7 +126,7 @@ CTblastnAppArgs::CTblastnAppArgs()
     arg.Reset(m_PsiBlastArgs);
     m_Args.push_back(arg);
 
-    m_DebugArgs.Reset(new CDebugArgs);
+    m_DebugArgs.Reset(new CDebugArgs(true));
     arg.Reset(m_DebugArgs);
     m_Args.push_back(arg);
 }
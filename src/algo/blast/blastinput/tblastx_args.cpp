@@ -110,7 +110,7 @@ CTblastxAppArgs::CTblastxAppArgs()
     arg.Reset(m_FormattingArgs);
     m_Args.push_back(arg);
 
-    m_MTArgs.Reset(new CMTArgs);
+    m_MTArgs.Reset(new CMTArgs(false, true));
     arg.Reset(m_MTArgs);
     m_Args.push_back(arg);
 
@@ -118,7 +118,7 @@ CTblastxAppArgs::CTblastxAppArgs()
     arg.Reset(m_RemoteArgs);
     m_Args.push_back(arg);
 
-    m_DebugArgs.Reset(new CDebugArgs);
+    m_DebugArgs.Reset(new CDebugArgs(true));
     arg.Reset(m_DebugArgs);
     m_Args.push_back(arg);
 }
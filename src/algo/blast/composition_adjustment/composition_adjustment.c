@@ -1251,6 +1251,13 @@ Blast_CompositionWorkspaceFree(Blast_CompositionWorkspace ** pNRrecord)
         Nlm_DenseMatrixFree(&NRrecord->mat_final);
         Nlm_DenseMatrixFree(&NRrecord->mat_b);
 
+        if (NRrecord->matrix_cache != NULL) {
+            int i;
+            for (i = 0;  i < COMPO_MATRIX_CACHE_SIZE;  i++) {
+                Nlm_Int4MatrixFree(&NRrecord->matrix_cache[i].matrix);
+            }
+            free(NRrecord->matrix_cache);
+        }
         free(NRrecord);
     }
     pNRrecord = NULL;
@@ -1272,6 +1279,9 @@ Blast_CompositionWorkspace * Blast_CompositionWorkspaceNew(void)
     NRrecord->second_standard_freq     = NULL;
     NRrecord->mat_final                = NULL;
     NRrecord->mat_b                    = NULL;
+    NRrecord->matrix_cache             = NULL;
+    NRrecord->matrix_cache_lookups     = 0;
+    NRrecord->matrix_cache_hits        = 0;
 
     NRrecord->first_standard_freq =
         (double *) malloc(COMPO_NUM_TRUE_AA * sizeof(double));
@@ -1289,6 +1299,15 @@ Blast_CompositionWorkspace * Blast_CompositionWorkspaceNew(void)
                                                COMPO_NUM_TRUE_AA);
     if (NRrecord->mat_b == NULL) goto error_return;
 
+    /* the matrices of the cache entries are allocated when first used */
+    NRrecord->matrix_cache = (Blast_AdjustedMatrixCacheEntry *)
+        calloc(COMPO_MATRIX_CACHE_SIZE,
+               sizeof(Blast_AdjustedMatrixCacheEntry));
+    if (NRrecord->matrix_cache == NULL) goto error_return;
+    for (i = 0;  i < COMPO_MATRIX_CACHE_SIZE;  i++) {
+        NRrecord->matrix_cache[i].status = -1;
+    }
+
     for (i = 0;  i < COMPO_NUM_TRUE_AA;  i++) {
         NRrecord->first_standard_freq[i] =
             NRrecord->second_standard_freq[i] = 0.0;
@@ -1307,6 +1326,11 @@ int
 Blast_CompositionWorkspaceInit(Blast_CompositionWorkspace * NRrecord,
                                const char *matrixName)
 {
+    int i;
+    /* matrices adjusted for another underlying matrix are of no use */
+    for (i = 0;  i < COMPO_MATRIX_CACHE_SIZE;  i++) {
+        NRrecord->matrix_cache[i].status = -1;
+    }
     if (0 == Blast_GetJointProbsForMatrix(NRrecord->mat_b,
                                           NRrecord->first_standard_freq,
                                           NRrecord->second_standard_freq,
@@ -1321,6 +1345,116 @@ Blast_CompositionWorkspaceInit(Blast_CompositionWorkspace * NRrecord,
 }
 
 
+/**
+ * Find the entry of the matrix cache of a workspace that holds, or would
+ * hold, the matrix adjusted with the given parameters.  The parameters
+ * are those of Blast_CompositionMatrixAdj.
+ *
+ * @param found     set to true if the entry holds the matrix [out]
+ * @return the entry
+ */
+static Blast_AdjustedMatrixCacheEntry *
+s_MatrixCacheFind(Blast_CompositionWorkspace * NRrecord,
+                  int alphsize,
+                  EMatrixAdjustRule matrix_adjust_rule,
+                  int length1,
+                  int length2,
+                  const double * stdaa_row_probs,
+                  const double * stdaa_col_probs,
+                  int pseudocounts,
+                  double specifiedRE,
+                  const Blast_MatrixInfo * matrixInfo,
+                  int * found)
+{
+    Blast_AdjustedMatrixCacheEntry * entry;
+    const size_t probs_size = alphsize * sizeof(double);
+    /* FNV-1a hash of the lengths and of the bytes of the compositions */
+    Uint4 hash = 2166136261U;
+    int keys[3];
+    const unsigned char * bytes;
+    size_t i;
+
+    keys[0] = (int) matrix_adjust_rule;
+    keys[1] = length1;
+    keys[2] = length2;
+    bytes = (const unsigned char *) keys;
+    for (i = 0;  i < sizeof(keys);  i++) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+    bytes = (const unsigned char *) stdaa_row_probs;
+    for (i = 0;  i < probs_size;  i++) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+    bytes = (const unsigned char *) stdaa_col_probs;
+    for (i = 0;  i < probs_size;  i++) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+    entry = &NRrecord->matrix_cache[hash % COMPO_MATRIX_CACHE_SIZE];
+
+    /* Only an exact match gives the matrix the solver would compute */
+    *found = entry->status >= 0 &&
+        entry->matrix_adjust_rule == matrix_adjust_rule &&
+        entry->alphsize == alphsize &&
+        entry->length1 == length1 && entry->length2 == length2 &&
+        entry->pseudocounts == pseudocounts &&
+        entry->specifiedRE == specifiedRE &&
+        entry->matrixInfo == matrixInfo &&
+        0 == memcmp(entry->row_probs, stdaa_row_probs, probs_size) &&
+        0 == memcmp(entry->col_probs, stdaa_col_probs, probs_size);
+    NRrecord->matrix_cache_lookups++;
+    if (*found) {
+        NRrecord->matrix_cache_hits++;
+    }
+    return entry;
+}
+
+
+/**
+ * Save the result of a matrix adjustment in an entry of the matrix
+ * cache.  The parameters following entry are those of
+ * Blast_CompositionMatrixAdj; status is the value it returns.
+ */
+static void
+s_MatrixCacheSave(Blast_AdjustedMatrixCacheEntry * entry,
+                  int status,
+                  int ** matrix,
+                  int alphsize,
+                  EMatrixAdjustRule matrix_adjust_rule,
+                  int length1,
+                  int length2,
+                  const double * stdaa_row_probs,
+                  const double * stdaa_col_probs,
+                  int pseudocounts,
+                  double specifiedRE,
+                  const Blast_MatrixInfo * matrixInfo)
+{
+    int i;
+    entry->status = -1;
+    if (status == 0) {
+        if (entry->matrix == NULL) {
+            entry->matrix = Nlm_Int4MatrixNew(COMPO_LARGEST_ALPHABET,
+                                              COMPO_LARGEST_ALPHABET);
+            if (entry->matrix == NULL) {
+                return;   /* the cache is only an optimization */
+            }
+        }
+        for (i = 0;  i < alphsize;  i++) {
+            memcpy(entry->matrix[i], matrix[i], alphsize * sizeof(int));
+        }
+    }
+    entry->matrix_adjust_rule = matrix_adjust_rule;
+    entry->alphsize = alphsize;
+    entry->length1 = length1;
+    entry->length2 = length2;
+    entry->pseudocounts = pseudocounts;
+    entry->specifiedRE = specifiedRE;
+    entry->matrixInfo = matrixInfo;
+    memcpy(entry->row_probs, stdaa_row_probs, alphsize * sizeof(double));
+    memcpy(entry->col_probs, stdaa_col_probs, alphsize * sizeof(double));
+    entry->status = status;
+}
+
+
 /* Documented in composition_adjustment.h. */
 int
 Blast_CompositionMatrixAdj(int ** matrix,
@@ -1340,7 +1474,26 @@ Blast_CompositionMatrixAdj(int ** matrix,
     /* Target RE when optimizing the matrix; zero if the relative
        entropy should not be constrained. */
     double dummy, desired_re = 0.0;
-
+    /* the cache entry for these compositions */
+    Blast_AdjustedMatrixCacheEntry * entry = NULL;
+
+    if (NRrecord->matrix_cache != NULL && alphsize <= COMPO_LARGEST_ALPHABET) {
+        int found;
+        entry = s_MatrixCacheFind(NRrecord, alphsize, matrix_adjust_rule,
+                                  length1, length2, stdaa_row_probs,
+                                  stdaa_col_probs, pseudocounts,
+                                  specifiedRE, matrixInfo, &found);
+        if (found) {
+            int i;
+            if (entry->status == 0) {
+                for (i = 0;  i < alphsize;  i++) {
+                    memcpy(matrix[i], entry->matrix[i],
+                           alphsize * sizeof(int));
+                }
+            }
+            return entry->status;
+        }
+    }
     s_GatherLetterProbs(row_probs, stdaa_row_probs, alphsize);
     s_GatherLetterProbs(col_probs, stdaa_col_probs, alphsize);
 
@@ -1388,14 +1541,20 @@ Blast_CompositionMatrixAdj(int ** matrix,
                                         kCompoAdjustErrTolerance,
                                         kCompoAdjustIterationLimit);
 
-    if (status != 0)            /* Did not compute the target freqs */
-        return status;
-
-    return
-        s_ScoresStdAlphabet(matrix, alphsize, NRrecord->mat_final,
-                            matrixInfo->startMatrix,
-                            row_probs, col_probs,
-                            matrixInfo->ungappedLambda);
+    if (status == 0) {          /* Computed the target freqs */
+        status =
+            s_ScoresStdAlphabet(matrix, alphsize, NRrecord->mat_final,
+                                matrixInfo->startMatrix,
+                                row_probs, col_probs,
+                                matrixInfo->ungappedLambda);
+    }
+    if (entry != NULL && status >= 0) {
+        s_MatrixCacheSave(entry, status, matrix, alphsize,
+                          matrix_adjust_rule, length1, length2,
+                          stdaa_row_probs, stdaa_col_probs, pseudocounts,
+                          specifiedRE, matrixInfo);
+    }
+    return status;
 }
 
 
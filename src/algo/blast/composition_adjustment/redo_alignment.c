@@ -965,6 +965,7 @@ Blast_RedoAlignParamsNew(Blast_MatrixInfo ** pmatrix_info,
         params->cutoff_e = cutoff_e;
         params->do_link_hsps = do_link_hsps;
         params->callbacks = callbacks;
+        params->vector_level = eBlastSimdNone;
     } else {
         free(*pmatrix_info); *pmatrix_info = NULL;
         free(*pgapping_params); *pgapping_params = NULL;
@@ -1290,7 +1291,8 @@ Blast_RedoOneMatchSmithWaterman(BlastCompo_Alignment ** alignments,
                                                  query.length, matrix,
                                                  gap_open, gap_extend,
                                                  positionBased,
-                                                 forbidden);
+                                                 forbidden,
+                                                 params->vector_level);
                 if (status != 0)
                     goto window_index_loop_cleanup;
 
@@ -1335,7 +1337,8 @@ Blast_RedoOneMatchSmithWaterman(BlastCompo_Alignment ** alignments,
                                                      queryEnd,
                                                      aSwScore,
                                                      positionBased,
-                                                     forbidden);
+                                                     forbidden,
+                                                     params->vector_level);
                     if (status != 0) {
                         goto window_index_loop_cleanup;
                     }
@@ -37,6 +37,10 @@ static char const rcsid[] =
 #include <algo/blast/composition_adjustment/composition_constants.h>
 #include <algo/blast/composition_adjustment/smith_waterman.h>
 
+#ifdef BLAST_SIMD_X86
+#include <immintrin.h>
+#endif
+
 /** A structure used internally by the Smith-Waterman algorithm to
  * represent gaps */
 typedef struct SwGapInfo {
@@ -545,6 +549,580 @@ Blast_ForbiddenRangesPush(Blast_ForbiddenRanges * self,
 }
 
 
+/** Number of 8-bit scores in one vector of the striped profile */
+#define SW_LANES8 16
+/** Number of 16-bit scores in one vector of the striped profile */
+#define SW_LANES16 8
+/** Bias of the 8-bit profile. Because the bias is at least as large as
+ * any score that survives an 8-bit pass, clamping a score to -SW_BIAS8
+ * never changes the result, and padding past the end of the query
+ * (scored -SW_BIAS8) can never start or extend an alignment. */
+#define SW_BIAS8 127
+
+
+/* Documented in smith_waterman.h. */
+Blast_SwStripedProfile *
+Blast_SwStripedProfileNew(const Uint1 * query, int queryLength,
+                          int **matrix, int alphsize,
+                          int positionSpecific,
+                          EBlastSimdLevel vectorLevel)
+{
+#ifdef BLAST_SIMD_X86
+    Blast_SwStripedProfile * self;
+    int maxScore = 0;            /* largest score in the profile */
+    int numVectors8, numVectors16;  /* sizes of the two profiles */
+    int queryPos, c;             /* position in query, residue */
+    Int1 * profile8;             /* the byte profile, as scalars */
+    Int2 * profile16;            /* the 16-bit profile, as scalars */
+    const int vsize = 16;        /* bytes per vector */
+
+    if (vectorLevel < eBlastSimdSSE41 || queryLength <= 0 || alphsize <= 0)
+        return NULL;
+
+    for (queryPos = 0;  queryPos < queryLength;  queryPos++) {
+        int *matrixRow = positionSpecific ? matrix[queryPos] :
+                                            matrix[query[queryPos]];
+        for (c = 0;  c < alphsize;  c++) {
+            if (matrixRow[c] > maxScore)
+                maxScore = matrixRow[c];
+        }
+    }
+    if (maxScore >= INT2_MAX)
+        return NULL;
+
+    self = (Blast_SwStripedProfile *) malloc(sizeof(Blast_SwStripedProfile));
+    if (self == NULL)
+        return NULL;
+    self->query = query;
+    self->queryLength = queryLength;
+    self->matrix = matrix;
+    self->alphsize = alphsize;
+    self->positionSpecific = positionSpecific;
+    self->bias = (maxScore + SW_BIAS8 <= 255) ? SW_BIAS8 : -1;
+    self->segLength8 = (queryLength + SW_LANES8 - 1) / SW_LANES8;
+    self->segLength16 = (queryLength + SW_LANES16 - 1) / SW_LANES16;
+
+    numVectors8 = (self->bias >= 0) ? alphsize * self->segLength8 : 0;
+    numVectors16 = alphsize * self->segLength16;
+    /* the scratch space holds three rows of 16-bit vectors, which is
+       more than three rows of 8-bit vectors */
+    self->memory = malloc((numVectors8 + numVectors16 +
+                           3 * self->segLength16) * vsize + vsize - 1);
+    if (self->memory == NULL) {
+        free(self);
+        return NULL;
+    }
+    self->profile16 = (void *) (((size_t) self->memory + vsize - 1) &
+                                ~(size_t) (vsize - 1));
+    self->profile8 = (char *) self->profile16 + numVectors16 * vsize;
+    self->work = (char *) self->profile8 + numVectors8 * vsize;
+
+    /* positions past the end of the query get the most negative score */
+    profile8 = (Int1 *) self->profile8;
+    profile16 = (Int2 *) self->profile16;
+    memset(profile8, 0, numVectors8 * vsize);
+    for (c = 0;  c < numVectors16 * SW_LANES16;  c++)
+        profile16[c] = INT2_MIN;
+
+    for (queryPos = 0;  queryPos < queryLength;  queryPos++) {
+        int *matrixRow = positionSpecific ? matrix[queryPos] :
+                                            matrix[query[queryPos]];
+        /* offsets of queryPos within the vectors of residue 0 */
+        int offset8 = (queryPos % self->segLength8) * SW_LANES8 +
+                      queryPos / self->segLength8;
+        int offset16 = (queryPos % self->segLength16) * SW_LANES16 +
+                       queryPos / self->segLength16;
+
+        for (c = 0;  c < alphsize;  c++) {
+            int score = matrixRow[c];
+            profile16[c * self->segLength16 * SW_LANES16 + offset16] =
+                (Int2) MAX(score, INT2_MIN);
+            if (self->bias >= 0) {
+                profile8[c * self->segLength8 * SW_LANES8 + offset8] =
+                    (Int1) (Uint1) (MAX(score, -SW_BIAS8) + SW_BIAS8);
+            }
+        }
+    }
+    return self;
+#else
+    return NULL;
+#endif
+}
+
+
+/* Documented in smith_waterman.h. */
+void Blast_SwStripedProfileFree(Blast_SwStripedProfile * self)
+{
+    if (self) {
+        free(self->memory);
+        free(self);
+    }
+}
+
+
+#ifdef BLAST_SIMD_X86
+
+/** Return the largest of the 16-bit scores in a vector */
+static int BLAST_TARGET_SSE41
+s_SwMax16(__m128i v)
+{
+    v = _mm_max_epi16(v, _mm_srli_si128(v, 8));
+    v = _mm_max_epi16(v, _mm_srli_si128(v, 4));
+    v = _mm_max_epi16(v, _mm_srli_si128(v, 2));
+    return (Int2) _mm_extract_epi16(v, 0);
+}
+
+
+/** Return the largest of the 8-bit scores in a vector */
+static int BLAST_TARGET_SSE41
+s_SwMax8(__m128i v)
+{
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+    return _mm_extract_epi8(v, 0);
+}
+
+
+/**
+ * Find the first query position in a striped column of 16-bit scores
+ * whose score is at least cut.  The column must contain such a score.
+ * @param *value  the score at the returned position
+ * @param vH      the column
+ * @param segLength  number of vectors in the column
+ * @param cut     the score to look for
+ * @return the query position
+ */
+static int BLAST_TARGET_SSE41
+s_SwFirstAtLeast16(int *value, const __m128i * vH, int segLength, int cut)
+{
+    __m128i vCut = _mm_set1_epi16((short) (cut - 1));
+    Int2 scores[SW_LANES16];
+    int seg, lane;
+    int bestSeg = 0, bestLane = SW_LANES16;
+
+    /* query positions increase with the lane first, then the segment */
+    for (seg = 0;  seg < segLength;  seg++) {
+        int mask = _mm_movemask_epi8(_mm_cmpgt_epi16(vH[seg], vCut));
+        if (mask != 0) {
+            lane = __builtin_ctz(mask) / 2;
+            if (lane < bestLane) {
+                bestLane = lane;
+                bestSeg = seg;
+                if (lane == 0)
+                    break;
+            }
+        }
+    }
+    _mm_storeu_si128((__m128i *) scores, vH[bestSeg]);
+    *value = scores[bestLane];
+    return bestSeg + bestLane * segLength;
+}
+
+
+/**
+ * Find the first query position in a striped column of biased 8-bit
+ * scores whose score is at least cut.  The column must contain such a
+ * score.  Parameters are as for s_SwFirstAtLeast16.
+ */
+static int BLAST_TARGET_SSE41
+s_SwFirstAtLeast8(int *value, const __m128i * vH, int segLength, int cut)
+{
+    __m128i vCut = _mm_set1_epi8((char) cut);
+    Uint1 scores[SW_LANES8];
+    int seg, lane;
+    int bestSeg = 0, bestLane = SW_LANES8;
+
+    for (seg = 0;  seg < segLength;  seg++) {
+        int mask = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(vH[seg], vCut), vH[seg]));
+        if (mask != 0) {
+            lane = __builtin_ctz(mask);
+            if (lane < bestLane) {
+                bestLane = lane;
+                bestSeg = seg;
+                if (lane == 0)
+                    break;
+            }
+        }
+    }
+    _mm_storeu_si128((__m128i *) scores, vH[bestSeg]);
+    *value = scores[bestLane];
+    return bestSeg + bestLane * segLength;
+}
+
+
+/**
+ * Bookkeeping for the cell reported by a striped pass.  The passes
+ * visit the dynamic programming matrix a database position at a time,
+ * so the cell that the scalar code (which visits it a query position at
+ * a time) would report is the one with the smallest query position,
+ * and then the smallest database position, among the cells that score
+ * at least min(best score, stopScore).
+ */
+typedef struct SwStripedBest {
+    int best;          /**< best score in the columns seen so far */
+    int cut;           /**< min(best, stopScore) */
+    int stopScore;     /**< score at which the search may stop */
+    int score;         /**< score of the reported cell */
+    int queryPos;      /**< query position of the reported cell */
+    int matchSeqPos;   /**< database position of the reported cell */
+} SwStripedBest;
+
+
+/**
+ * The striped Smith-Waterman pass using biased 8-bit scores; the
+ * parameters are those of Blast_SwStripedScore.
+ * @return 0 on success; 1 if the score is too large for 8 bits
+ */
+static int BLAST_TARGET_SSE41
+s_SwStriped8(SwStripedBest * out, Blast_SwStripedProfile * self,
+             const Uint1 * matchSeq, int matchSeqLength,
+             int gapOpen, int gapExtend)
+{
+    const int segLength = self->segLength8;
+    const int overflow = 255 - SW_BIAS8;
+    const __m128i * profile = (const __m128i *) self->profile8;
+    __m128i * pvHLoad = (__m128i *) self->work;
+    __m128i * pvHStore = pvHLoad + segLength;
+    __m128i * pvE = pvHStore + segLength;
+    __m128i vGapOpenExtend =
+        _mm_set1_epi8((char) MIN(gapOpen + gapExtend, 255));
+    __m128i vGapExtend = _mm_set1_epi8((char) MIN(gapExtend, 255));
+    __m128i vBias = _mm_set1_epi8((char) SW_BIAS8);
+    __m128i vZero = _mm_setzero_si128();
+    int matchSeqPos, seg, pass;
+
+    memset(pvHLoad, 0, segLength * sizeof(__m128i));
+    memset(pvE, 0, segLength * sizeof(__m128i));
+
+    for (matchSeqPos = 0;  matchSeqPos < matchSeqLength;  matchSeqPos++) {
+        const __m128i * vP = profile + matchSeq[matchSeqPos] * segLength;
+        __m128i vF = vZero;      /* gap in the database sequence */
+        __m128i vMax = vZero;
+        __m128i vE, vH, *swap;
+        int colMax;
+
+        /* E, F and H are all kept nonnegative; a negative value can
+           never be chosen by the maximum that includes zero */
+        vH = _mm_slli_si128(pvHLoad[segLength - 1], 1);
+        for (seg = 0;  seg < segLength;  seg++) {
+            vH = _mm_adds_epu8(vH, vP[seg]);
+            vH = _mm_subs_epu8(vH, vBias);
+            vE = pvE[seg];
+            vH = _mm_max_epu8(vH, vE);
+            vH = _mm_max_epu8(vH, vF);
+            vMax = _mm_max_epu8(vMax, vH);
+            pvHStore[seg] = vH;
+
+            vH = _mm_subs_epu8(vH, vGapOpenExtend);
+            vE = _mm_subs_epu8(vE, vGapExtend);
+            pvE[seg] = _mm_max_epu8(vE, vH);
+            vF = _mm_subs_epu8(vF, vGapExtend);
+            vF = _mm_max_epu8(vF, vH);
+
+            vH = pvHLoad[seg];
+        }
+        /* carry gaps from the end of each lane into the next lane, for
+           as long as they still improve some score */
+        for (pass = 0;  pass < SW_LANES8;  pass++) {
+            vF = _mm_slli_si128(vF, 1);
+            for (seg = 0;  seg < segLength;  seg++) {
+                vH = _mm_max_epu8(pvHStore[seg], vF);
+                pvHStore[seg] = vH;
+                vMax = _mm_max_epu8(vMax, vH);
+                vH = _mm_subs_epu8(vH, vGapOpenExtend);
+                pvE[seg] = _mm_max_epu8(pvE[seg], vH);
+                vF = _mm_subs_epu8(vF, vGapExtend);
+                if (_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(_mm_subs_epu8(vF, vH), vZero))
+                    == 0xFFFF)
+                    goto lazy_f_done;
+            }
+        }
+lazy_f_done:
+        colMax = s_SwMax8(vMax);
+        if (colMax >= overflow)
+            return 1;
+
+        if (colMax > out->best && out->best < out->stopScore) {
+            out->cut = MIN(colMax, out->stopScore);
+            out->queryPos = s_SwFirstAtLeast8(&out->score, pvHStore,
+                                              segLength, out->cut);
+            out->matchSeqPos = matchSeqPos;
+        } else if (out->best > 0 && colMax >= out->cut) {
+            int score;
+            int queryPos = s_SwFirstAtLeast8(&score, pvHStore,
+                                             segLength, out->cut);
+            if (queryPos < out->queryPos) {
+                out->score = score;
+                out->queryPos = queryPos;
+                out->matchSeqPos = matchSeqPos;
+            }
+        }
+        if (colMax > out->best)
+            out->best = colMax;
+        if (out->best >= out->stopScore && out->queryPos == 0)
+            break;
+
+        swap = pvHLoad;  pvHLoad = pvHStore;  pvHStore = swap;
+    }
+    return 0;
+}
+
+
+/**
+ * The striped Smith-Waterman pass using 16-bit scores; the parameters
+ * are those of Blast_SwStripedScore.
+ * @return 0 on success; 1 if the score is too large for 16 bits
+ */
+static int BLAST_TARGET_SSE41
+s_SwStriped16(SwStripedBest * out, Blast_SwStripedProfile * self,
+              const Uint1 * matchSeq, int matchSeqLength,
+              int gapOpen, int gapExtend)
+{
+    const int segLength = self->segLength16;
+    const __m128i * profile = (const __m128i *) self->profile16;
+    __m128i * pvHLoad = (__m128i *) self->work;
+    __m128i * pvHStore = pvHLoad + segLength;
+    __m128i * pvE = pvHStore + segLength;
+    __m128i vGapOpenExtend =
+        _mm_set1_epi16((short) MIN(gapOpen + gapExtend, INT2_MAX));
+    __m128i vGapExtend = _mm_set1_epi16((short) MIN(gapExtend, INT2_MAX));
+    __m128i vZero = _mm_setzero_si128();
+    int matchSeqPos, seg, pass;
+
+    memset(pvHLoad, 0, segLength * sizeof(__m128i));
+    memset(pvE, 0, segLength * sizeof(__m128i));
+
+    for (matchSeqPos = 0;  matchSeqPos < matchSeqLength;  matchSeqPos++) {
+        const __m128i * vP = profile + matchSeq[matchSeqPos] * segLength;
+        __m128i vF = vZero;
+        __m128i vMax = vZero;
+        __m128i vE, vH, *swap;
+        int colMax;
+
+        /* as in s_SwStriped8, all scores are nonnegative, so the
+           unsigned saturating subtraction implements max(x - gap, 0) */
+        vH = _mm_slli_si128(pvHLoad[segLength - 1], 2);
+        for (seg = 0;  seg < segLength;  seg++) {
+            vH = _mm_adds_epi16(vH, vP[seg]);
+            vH = _mm_max_epi16(vH, vZero);
+            vE = pvE[seg];
+            vH = _mm_max_epi16(vH, vE);
+            vH = _mm_max_epi16(vH, vF);
+            vMax = _mm_max_epi16(vMax, vH);
+            pvHStore[seg] = vH;
+
+            vH = _mm_subs_epu16(vH, vGapOpenExtend);
+            vE = _mm_subs_epu16(vE, vGapExtend);
+            pvE[seg] = _mm_max_epi16(vE, vH);
+            vF = _mm_subs_epu16(vF, vGapExtend);
+            vF = _mm_max_epi16(vF, vH);
+
+            vH = pvHLoad[seg];
+        }
+        for (pass = 0;  pass < SW_LANES16;  pass++) {
+            vF = _mm_slli_si128(vF, 2);
+            for (seg = 0;  seg < segLength;  seg++) {
+                vH = _mm_max_epi16(pvHStore[seg], vF);
+                pvHStore[seg] = vH;
+                vMax = _mm_max_epi16(vMax, vH);
+                vH = _mm_subs_epu16(vH, vGapOpenExtend);
+                pvE[seg] = _mm_max_epi16(pvE[seg], vH);
+                vF = _mm_subs_epu16(vF, vGapExtend);
+                if (_mm_movemask_epi8(_mm_cmpgt_epi16(vF, vH)) == 0)
+                    goto lazy_f_done;
+            }
+        }
+lazy_f_done:
+        colMax = s_SwMax16(vMax);
+        if (colMax >= INT2_MAX)
+            return 1;
+
+        if (colMax > out->best && out->best < out->stopScore) {
+            out->cut = MIN(colMax, out->stopScore);
+            out->queryPos = s_SwFirstAtLeast16(&out->score, pvHStore,
+                                               segLength, out->cut);
+            out->matchSeqPos = matchSeqPos;
+        } else if (out->best > 0 && colMax >= out->cut) {
+            int score;
+            int queryPos = s_SwFirstAtLeast16(&score, pvHStore,
+                                              segLength, out->cut);
+            if (queryPos < out->queryPos) {
+                out->score = score;
+                out->queryPos = queryPos;
+                out->matchSeqPos = matchSeqPos;
+            }
+        }
+        if (colMax > out->best)
+            out->best = colMax;
+        if (out->best >= out->stopScore && out->queryPos == 0)
+            break;
+
+        swap = pvHLoad;  pvHLoad = pvHStore;  pvHStore = swap;
+    }
+    return 0;
+}
+
+#endif /* BLAST_SIMD_X86 */
+
+
+/* Documented in smith_waterman.h. */
+int
+Blast_SwStripedScore(int *score, int *matchSeqEnd, int *queryEnd,
+                     Blast_SwStripedProfile * self,
+                     const Uint1 * matchSeq, int matchSeqLength,
+                     int gapOpen, int gapExtend, int stopScore)
+{
+#ifdef BLAST_SIMD_X86
+    SwStripedBest best;
+    int status = 1;
+
+    /* with a zero gap opening penalty, the gap carrying loop could stop
+       before all scores are final */
+    if (gapOpen <= 0 || gapExtend < 0)
+        return 1;
+
+    best.best = 0;
+    best.cut = 0;
+    best.stopScore = MAX(stopScore, 1);
+    best.score = 0;
+    best.queryPos = 0;
+    best.matchSeqPos = 0;
+    if (self->bias >= 0) {
+        status = s_SwStriped8(&best, self, matchSeq, matchSeqLength,
+                              gapOpen, gapExtend);
+    }
+    if (status != 0) {
+        best.best = 0;
+        best.cut = 0;
+        best.score = 0;
+        best.queryPos = 0;
+        best.matchSeqPos = 0;
+        status = s_SwStriped16(&best, self, matchSeq, matchSeqLength,
+                               gapOpen, gapExtend);
+    }
+    if (status == 0) {
+        *score = best.score;
+        *matchSeqEnd = best.matchSeqPos;
+        *queryEnd = best.queryPos;
+    }
+    return status;
+#else
+    return 1;
+#endif
+}
+
+
+/**
+ * Compute the score and endpoints of the locally optimal Smith-Waterman
+ * alignment with the striped vector code, using a profile for this call
+ * only.  The parameters are those of Blast_SmithWatermanScoreOnly and
+ * Blast_SwStripedScore.
+ *
+ * @return 0 on success; 1 if the scalar code must be used instead
+ */
+static int
+s_StripedSmithWatermanScore(int *score, int *matchSeqEnd, int *queryEnd,
+                            const Uint1 * matchSeq, int matchSeqLength,
+                            const Uint1 * query, int queryLength,
+                            int **matrix, int gapOpen, int gapExtend,
+                            int positionSpecific, int stopScore,
+                            EBlastSimdLevel vectorLevel)
+{
+    int alphsize = 0;            /* one more than the largest residue */
+    int matchSeqPos;             /* position in matchSeq */
+    int status;
+    Blast_SwStripedProfile * profile;
+
+    if (vectorLevel == eBlastSimdNone)
+        return 1;
+    for (matchSeqPos = 0;  matchSeqPos < matchSeqLength;  matchSeqPos++) {
+        if (matchSeq[matchSeqPos] >= alphsize)
+            alphsize = matchSeq[matchSeqPos] + 1;
+    }
+    profile = Blast_SwStripedProfileNew(query, queryLength, matrix,
+                                        alphsize, positionSpecific,
+                                        vectorLevel);
+    if (profile == NULL)
+        return 1;
+    status = Blast_SwStripedScore(score, matchSeqEnd, queryEnd, profile,
+                                  matchSeq, matchSeqLength,
+                                  gapOpen, gapExtend, stopScore);
+    Blast_SwStripedProfileFree(profile);
+
+    return status;
+}
+
+
+/**
+ * Find the left-hand endpoints of the locally optimal Smith-Waterman
+ * alignment with the striped vector code, by aligning the reversed
+ * prefixes of the sequences that end at the right-hand endpoints.  The
+ * parameters are those of Blast_SmithWatermanFindStart.
+ *
+ * @return 0 on success; 1 if the scalar code must be used instead
+ */
+static int
+s_StripedSmithWatermanFindStart(int *score_out,
+                                int *matchSeqStart, int *queryStart,
+                                const Uint1 * matchSeq,
+                                const Uint1 * query,
+                                int **matrix, int gapOpen, int gapExtend,
+                                int matchSeqEnd, int queryEnd, int score_in,
+                                int positionSpecific,
+                                EBlastSimdLevel vectorLevel)
+{
+    Uint1 *revMatchSeq, *revQuery;  /* the reversed prefixes */
+    int **revMatrix = NULL;         /* reversed rows of a PSSM */
+    int revMatchSeqEnd, revQueryEnd, score;
+    int pos;
+    int status = 1;
+
+    if (vectorLevel == eBlastSimdNone)
+        return 1;
+    revMatchSeq = (Uint1 *) malloc(matchSeqEnd + 1);
+    revQuery = (Uint1 *) malloc(queryEnd + 1);
+    if (positionSpecific)
+        revMatrix = (int **) malloc((queryEnd + 1) * sizeof(int *));
+    if (revMatchSeq != NULL && revQuery != NULL &&
+        (revMatrix != NULL || !positionSpecific)) {
+        for (pos = 0;  pos <= matchSeqEnd;  pos++)
+            revMatchSeq[pos] = matchSeq[matchSeqEnd - pos];
+        for (pos = 0;  pos <= queryEnd;  pos++) {
+            revQuery[pos] = query[queryEnd - pos];
+            if (positionSpecific)
+                revMatrix[pos] = matrix[queryEnd - pos];
+        }
+        status =
+            s_StripedSmithWatermanScore(&score, &revMatchSeqEnd,
+                                        &revQueryEnd, revMatchSeq,
+                                        matchSeqEnd + 1, revQuery,
+                                        queryEnd + 1,
+                                        positionSpecific ? revMatrix : matrix,
+                                        gapOpen, gapExtend, positionSpecific,
+                                        score_in, vectorLevel);
+    }
+    if (status == 0) {
+        *score_out = score;
+        if (score > 0) {
+            *matchSeqStart = matchSeqEnd - revMatchSeqEnd;
+            *queryStart = queryEnd - revQueryEnd;
+        } else {
+            *matchSeqStart = 0;
+            *queryStart = 0;
+        }
+    }
+    free(revMatrix);
+    free(revQuery);
+    free(revMatchSeq);
+
+    return status;
+}
+
+
 /* Documented in smith_waterman.h. */
 int
 Blast_SmithWatermanScoreOnly(int *score,
@@ -555,9 +1133,18 @@ Blast_SmithWatermanScoreOnly(int *score,
                              int gapOpen,
                              int gapExtend,
                              int positionSpecific,
-                             const Blast_ForbiddenRanges * forbiddenRanges )
+                             const Blast_ForbiddenRanges * forbiddenRanges,
+                             EBlastSimdLevel vectorLevel)
 {
     if (forbiddenRanges->isEmpty) {
+        int status =
+            s_StripedSmithWatermanScore(score, matchSeqEnd, queryEnd,
+                                        subject_data, subject_length,
+                                        query_data, query_length, matrix,
+                                        gapOpen, gapExtend, positionSpecific,
+                                        INT4_MAX, vectorLevel);
+        if (status != 1)
+            return status;
         return BLbasicSmithWatermanScoreOnly(score, matchSeqEnd,
                                              queryEnd, subject_data,
                                              subject_length,
@@ -593,9 +1180,19 @@ Blast_SmithWatermanFindStart(int * score_out,
                              int queryEnd,
                              int score_in,
                              int positionSpecific,
-                             const Blast_ForbiddenRanges * forbiddenRanges)
+                             const Blast_ForbiddenRanges * forbiddenRanges,
+                             EBlastSimdLevel vectorLevel)
 {
     if (forbiddenRanges->isEmpty) {
+        int status =
+            s_StripedSmithWatermanFindStart(score_out, matchSeqStart,
+                                            queryStart, subject_data,
+                                            query_data, matrix, gapOpen,
+                                            gapExtend, matchSeqEnd, queryEnd,
+                                            score_in, positionSpecific,
+                                            vectorLevel);
+        if (status != 1)
+            return status;
         return BLSmithWatermanFindStart(score_out, matchSeqStart,
                                         queryStart, subject_data,
                                         subject_length, query_data,
@@ -37,6 +37,11 @@ static char const rcsid[] =
 #include <algo/blast/core/blast_aalookup.h>
 #include <algo/blast/core/blast_aascan.h>
 #include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/blast_simd.h>
+
+#ifdef BLAST_SIMD_X86
+#include <immintrin.h>
+#endif
 
 /** Scan a subject sequence for word hits and trigger two-hit extensions.
  *
@@ -331,8 +336,12 @@ s_BlastRPSWordFinder_TwoHit(const BLAST_SequenceBlk * subject,
     last_offset = subject->length - wordsize;
 
     while (first_offset <= last_offset) {
+        Int8 scan_start = ewp->scan_ticks ? Blast_StageClock() : 0;
+
         /* scan the subject sequence for hits */
         hits = BlastRPSScanSubject(lookup_wrap, subject, &first_offset);
+        if (ewp->scan_ticks)
+            *ewp->scan_ticks += Blast_StageClock() - scan_start;
 
         totalhits += hits;
         /* for each region of the concatenated database */
@@ -505,9 +514,13 @@ s_BlastAaWordFinder_TwoHit(const BLAST_SequenceBlk * subject,
         scan_range[2] = scan_range[1];
 
     while (scan_range[1] <= scan_range[2]) {
+        Int8 scan_start = ewp->scan_ticks ? Blast_StageClock() : 0;
+
         /* scan the subject sequence for hits */
         hits = scansub(lookup_wrap, subject, 
                                   offset_pairs, array_size, scan_range);
+        if (ewp->scan_ticks)
+            *ewp->scan_ticks += Blast_StageClock() - scan_start;
 
         totalhits += hits;
         /* for each hit, */
@@ -648,8 +661,12 @@ s_BlastRPSWordFinder_OneHit(const BLAST_SequenceBlk * subject,
     last_offset = subject->length - wordsize;
 
     while (first_offset <= last_offset) {
+        Int8 scan_start = ewp->scan_ticks ? Blast_StageClock() : 0;
+
         /* scan the subject sequence for hits */
         hits = BlastRPSScanSubject(lookup_wrap, subject, &first_offset);
+        if (ewp->scan_ticks)
+            *ewp->scan_ticks += Blast_StageClock() - scan_start;
 
         totalhits += hits;
         for (i = 0; i < lookup->num_buckets; i++) {
@@ -755,9 +772,13 @@ s_BlastAaWordFinder_OneHit(const BLAST_SequenceBlk * subject,
     scan_range[2] = subject->seq_ranges[0].right - wordsize;
 
     while (scan_range[1] <= scan_range[2]) {
+        Int8 scan_start = ewp->scan_ticks ? Blast_StageClock() : 0;
+
         /* scan the subject sequence for hits */
         hits = scansub(lookup_wrap, subject,
                        offset_pairs, array_size, scan_range);
+        if (ewp->scan_ticks)
+            *ewp->scan_ticks += Blast_StageClock() - scan_start;
 
         totalhits += hits;
         /* for each hit, */
@@ -802,6 +823,180 @@ s_BlastAaWordFinder_OneHit(const BLAST_SequenceBlk * subject,
     return 0;
 }
 
+#ifdef BLAST_SIMD_X86
+
+/** Number of residues examined by one step of the vectorized X-drop scan */
+#define AA_XDROP_BLOCK 16
+
+/** Substitution score of the position k steps away from the start of a
+ * block, from the profile if there is one and otherwise from the matrix */
+#define AA_XDROP_SCORE(k) \
+    (profile ? profile[(k) * step][s[(k) * step]] \
+             : matrix[q[(k) * step]][s[(k) * step]])
+
+/**
+ * Examine AA_XDROP_BLOCK consecutive positions of an ungapped extension,
+ * four at a time. The running scores of the block are computed as prefix
+ * sums and the best scores so far as prefix maxima; if no position of the
+ * block satisfies the termination test of the scalar extension loop, the
+ * running state is advanced past the block.
+ *
+ * @param profile score rows indexed by query position, i.e. a PSSM,
+ *                starting at the first position of the block, or NULL to
+ *                use matrix and q [in]
+ * @param matrix the substitution matrix [in]
+ * @param q query sequence at the first position of the block [in]
+ * @param s subject sequence at the first position of the block [in]
+ * @param step 1 to extend to the right, -1 to extend to the left [in]
+ * @param dropoff the X dropoff parameter [in]
+ * @param stop_if_nonpositive also stop at a running score <= 0 [in]
+ * @param score the running score before/after the block [in][out]
+ * @param maxscore the best running score before/after the block [in][out]
+ * @param best index within the block of the first position reaching the
+ *             new best score, or -1 if the best score did not change [out]
+ * @return TRUE if the extension continues past the block; FALSE if it
+ *         stops inside it, in which case nothing is modified and the caller
+ *         must examine the block with the scalar code
+ */
+static Boolean BLAST_TARGET_SSE41
+s_AaXDropBlockSSE41(Int4 ** profile, Int4 ** matrix,
+                    const Uint1 * q, const Uint1 * s, Int4 step,
+                    Int4 dropoff, Boolean stop_if_nonpositive,
+                    Int4 * score, Int4 * maxscore, Int4 * best)
+{
+    const __m128i kMinScore = _mm_set1_epi32(INT4_MIN);
+    const __m128i kOne = _mm_set1_epi32(1);
+    const __m128i kDrop = _mm_set1_epi32(dropoff - 1);
+    __m128i vScore = _mm_set1_epi32(*score);
+    __m128i vMax = _mm_set1_epi32(*maxscore);
+    __m128i vSums[AA_XDROP_BLOCK / 4];
+    Int4 i;
+
+    for (i = 0; i < AA_XDROP_BLOCK / 4; i++) {
+        __m128i vSum, vBest, vStop;
+
+        /* the scores go straight to a register; storing them in an array
+           first would stall on the vector load */
+        vSum = _mm_set_epi32(AA_XDROP_SCORE(4 * i + 3),
+                             AA_XDROP_SCORE(4 * i + 2),
+                             AA_XDROP_SCORE(4 * i + 1),
+                             AA_XDROP_SCORE(4 * i));
+        vSum = _mm_add_epi32(vSum, _mm_slli_si128(vSum, 4));
+        vSum = _mm_add_epi32(vSum, _mm_slli_si128(vSum, 8));
+        vSum = _mm_add_epi32(vSum, vScore);
+
+        vBest = _mm_max_epi32(vSum, _mm_alignr_epi8(vSum, kMinScore, 12));
+        vBest = _mm_max_epi32(vBest, _mm_alignr_epi8(vBest, kMinScore, 8));
+        vBest = _mm_max_epi32(vBest, vMax);
+
+        /* maxscore - score >= dropoff, or score <= 0 */
+        vStop = _mm_cmpgt_epi32(_mm_sub_epi32(vBest, vSum), kDrop);
+        if (stop_if_nonpositive)
+            vStop = _mm_or_si128(vStop, _mm_cmplt_epi32(vSum, kOne));
+        if (!_mm_testz_si128(vStop, vStop))
+            return FALSE;
+
+        vSums[i] = vSum;
+        vScore = _mm_shuffle_epi32(vSum, 0xFF);
+        vMax = _mm_shuffle_epi32(vBest, 0xFF);
+    }
+
+    *best = -1;
+    if (_mm_cvtsi128_si32(vMax) > *maxscore) {
+        /* the scalar loop records the first position reaching the maximum */
+        for (i = 0; i < AA_XDROP_BLOCK / 4; i++) {
+            int mask = _mm_movemask_ps(
+                          _mm_castsi128_ps(_mm_cmpeq_epi32(vSums[i], vMax)));
+            if (mask) {
+                *best = 4 * i + __builtin_ctz(mask);
+                break;
+            }
+        }
+    }
+    *score = _mm_cvtsi128_si32(vScore);
+    *maxscore = _mm_cvtsi128_si32(vMax);
+    return TRUE;
+}
+
+#undef AA_XDROP_SCORE
+
+/**
+ * Vectorized part of an extension to the right: examine whole blocks of
+ * positions while the extension is certain to continue past them.
+ *
+ * @param profile score rows indexed by query position, i.e. a PSSM, or
+ *                NULL to use matrix and q [in]
+ * @param matrix the substitution matrix [in]
+ * @param q query sequence at the first position [in]
+ * @param s subject sequence at the first position [in]
+ * @param n number of positions available [in]
+ * @param dropoff the X dropoff parameter [in]
+ * @param score the running score [in][out]
+ * @param maxscore the best running score [in][out]
+ * @param best_i position of the best running score [in][out]
+ * @return number of positions examined
+ */
+static Int4 s_AaXDropRightSIMD(Int4 ** profile, Int4 ** matrix,
+                               const Uint1 * q, const Uint1 * s, Int4 n,
+                               Int4 dropoff, Int4 * score, Int4 * maxscore,
+                               Int4 * best_i)
+{
+    Int4 i, best;
+
+    if (n < AA_XDROP_BLOCK || BlastSimd_GetLevel() < eBlastSimdSSE41)
+        return 0;
+
+    for (i = 0; i + AA_XDROP_BLOCK <= n; i += AA_XDROP_BLOCK) {
+        if (!s_AaXDropBlockSSE41(profile ? profile + i : NULL, matrix,
+                                 q ? q + i : NULL, s + i, 1, dropoff, TRUE,
+                                 score, maxscore, &best))
+            break;
+        if (best >= 0)
+            *best_i = i + best;
+    }
+    return i;
+}
+
+/**
+ * Vectorized part of an extension to the left: examine whole blocks of
+ * positions, starting at position n and moving toward position 0, while
+ * the extension is certain to continue past them.
+ *
+ * @param profile score rows indexed by query position, i.e. a PSSM, or
+ *                NULL to use matrix and q [in]
+ * @param matrix the substitution matrix [in]
+ * @param q query sequence at position 0 [in]
+ * @param s subject sequence at position 0 [in]
+ * @param n the first position examined [in]
+ * @param dropoff the X dropoff parameter [in]
+ * @param score the running score [in][out]
+ * @param maxscore the best running score [in][out]
+ * @param best_i position of the best running score [in][out]
+ * @return number of positions examined
+ */
+static Int4 s_AaXDropLeftSIMD(Int4 ** profile, Int4 ** matrix,
+                              const Uint1 * q, const Uint1 * s, Int4 n,
+                              Int4 dropoff, Int4 * score, Int4 * maxscore,
+                              Int4 * best_i)
+{
+    Int4 i, best;
+
+    if (n + 1 < AA_XDROP_BLOCK || BlastSimd_GetLevel() < eBlastSimdSSE41)
+        return 0;
+
+    for (i = 0; i + AA_XDROP_BLOCK <= n + 1; i += AA_XDROP_BLOCK) {
+        if (!s_AaXDropBlockSSE41(profile ? profile + n - i : NULL, matrix,
+                                 q ? q + n - i : NULL, s + n - i, -1,
+                                 dropoff, FALSE, score, maxscore, &best))
+            break;
+        if (best >= 0)
+            *best_i = n - i - best;
+    }
+    return i;
+}
+
+#endif /* BLAST_SIMD_X86 */
+
 /**
  * Beginning at s_off and q_off in the subject and query, respectively,
  * extend to the right until the cumulative score becomes negative or
@@ -834,7 +1029,12 @@ static Int4 s_BlastAaExtendRight(Int4 ** matrix,
     s = subject->sequence + s_off;
     q = query->sequence + q_off;
 
-    for (i = 0; i < n; i++) {
+    i = 0;
+#ifdef BLAST_SIMD_X86
+    i = s_AaXDropRightSIMD(NULL, matrix, q, s, n, dropoff,
+                           &score, &maxscore, &best_i);
+#endif
+    for (; i < n; i++) {
         score += matrix[q[i]][s[i]];
 
         if (score > maxscore) {
@@ -891,7 +1091,12 @@ static Int4 s_BlastAaExtendLeft(Int4 ** matrix,
     s = subject->sequence + s_off - n;
     q = query->sequence + q_off - n;
 
-    for (i = n; i >= 0; i--) {
+    i = n;
+#ifdef BLAST_SIMD_X86
+    i -= s_AaXDropLeftSIMD(NULL, matrix, q, s, n, dropoff,
+                           &score, &maxscore, &best_i);
+#endif
+    for (; i >= 0; i--) {
         score += matrix[q[i]][s[i]];
 
         if (score > maxscore) {
@@ -939,7 +1144,12 @@ static Int4 s_BlastPSSMExtendRight(Int4 ** matrix,
     n = MIN(subject->length - s_off, query_size - q_off);
     s = subject->sequence + s_off;
 
-    for (i = 0; i < n; i++) {
+    i = 0;
+#ifdef BLAST_SIMD_X86
+    i = s_AaXDropRightSIMD(matrix + q_off, matrix, NULL, s, n, dropoff,
+                           &score, &maxscore, &best_i);
+#endif
+    for (; i < n; i++) {
         score += matrix[q_off + i][s[i]];
 
         if (score > maxscore) {
@@ -987,7 +1197,12 @@ static Int4 s_BlastPSSMExtendLeft(Int4 ** matrix,
     best_i = n + 1;
     s = subject->sequence + s_off - n;
 
-    for (i = n; i >= 0; i--) {
+    i = n;
+#ifdef BLAST_SIMD_X86
+    i -= s_AaXDropLeftSIMD(matrix + q_off - n, matrix, NULL, s, n, dropoff,
+                           &score, &maxscore, &best_i);
+#endif
+    for (; i >= 0; i--) {
         score += matrix[q_off - n + i][s[i]];
 
         if (score > maxscore) {
@@ -39,6 +39,18 @@ static char const rcsid[] =
 
 #include <algo/blast/core/blast_diagnostics.h>
 #include <algo/blast/core/blast_def.h>
+#include <algo/blast/core/blast_message.h>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+/** Defined if the stage clock is the time stamp counter */
+#define BLAST_STAGE_CLOCK_TSC 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BLAST_STAGE_CLOCK_TSC 1
+#else
+#include <time.h>
+#endif
 
 BlastDiagnostics* Blast_DiagnosticsFree(BlastDiagnostics* diagnostics)
 {
@@ -46,6 +58,9 @@ BlastDiagnostics* Blast_DiagnosticsFree(BlastDiagnostics* diagnostics)
       sfree(diagnostics->ungapped_stat);
       sfree(diagnostics->gapped_stat);
       sfree(diagnostics->cutoffs);
+      sfree(diagnostics->thread_stats);
+      sfree(diagnostics->stage_times);
+      sfree(diagnostics->thread_stage_times);
       if (diagnostics->mt_lock)
          diagnostics->mt_lock = MT_LOCK_Delete(diagnostics->mt_lock);
       sfree(diagnostics);
@@ -78,6 +93,27 @@ BlastDiagnostics* Blast_DiagnosticsCopy(const BlastDiagnostics* diagnostics)
     } else {
       sfree(diagnostics->cutoffs);
     }
+    if (diagnostics->num_thread_stats > 0) {
+        retval->thread_stats = (BlastThreadStats*)
+            BlastMemDup(diagnostics->thread_stats,
+                        diagnostics->num_thread_stats *
+                        sizeof(BlastThreadStats));
+        if (retval->thread_stats)
+            retval->num_thread_stats = diagnostics->num_thread_stats;
+    }
+    if (diagnostics->stage_times) {
+        retval->stage_times = (BlastStageTimes*)
+            BlastMemDup(diagnostics->stage_times, sizeof(BlastStageTimes));
+    }
+    if (diagnostics->num_thread_stage_times > 0) {
+        retval->thread_stage_times = (BlastStageTimes*)
+            BlastMemDup(diagnostics->thread_stage_times,
+                        diagnostics->num_thread_stage_times *
+                        sizeof(BlastStageTimes));
+        if (retval->thread_stage_times)
+            retval->num_thread_stage_times =
+                diagnostics->num_thread_stage_times;
+    }
     return retval;
 }
 
@@ -119,9 +155,116 @@ void Blast_UngappedStatsUpdate(BlastUngappedStats* ungapped_stats,
       ++ungapped_stats->num_seqs_passed;
 }
 
+Int2 Blast_DiagnosticsAddThreadStats(BlastDiagnostics* diagnostics,
+                                     const BlastThreadStats* thread_stats)
+{
+   BlastThreadStats* new_stats;
+
+   if (!diagnostics || !thread_stats)
+      return 0;
+
+   new_stats = (BlastThreadStats*) realloc(diagnostics->thread_stats,
+                   (diagnostics->num_thread_stats + 1) *
+                   sizeof(BlastThreadStats));
+   if (!new_stats)
+      return BLASTERR_MEMORY;
+
+   new_stats[diagnostics->num_thread_stats++] = *thread_stats;
+   diagnostics->thread_stats = new_stats;
+   return 0;
+}
+
+Int8 Blast_StageClock(void)
+{
+#if defined(BLAST_STAGE_CLOCK_TSC)
+   return (Int8) __rdtsc();
+#elif defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (Int8) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+   return (Int8) clock();
+#endif
+}
+
+Int2 Blast_DiagnosticsEnableStageTimes(BlastDiagnostics* diagnostics)
+{
+   if (!diagnostics || diagnostics->stage_times)
+      return 0;
+
+   diagnostics->stage_times =
+      (BlastStageTimes*) calloc(1, sizeof(BlastStageTimes));
+   if (!diagnostics->stage_times)
+      return BLASTERR_MEMORY;
+   diagnostics->stage_times->thread_index = -1;
+   return 0;
+}
+
+/** Add the stage times of one thread, or totals not attributed to any
+ * thread, to the diagnostics, see Blast_DiagnosticsAddStageTimes; the
+ * caller holds the mutex
+ * @param diagnostics Diagnostics structure to update [in] [out]
+ * @param stage_times Times to add [in]
+ * @return 0 on success, BLASTERR_MEMORY if out of memory
+ */
+static Int2
+s_DiagnosticsAddStageTimes(BlastDiagnostics* diagnostics,
+                           const BlastStageTimes* stage_times)
+{
+   BlastStageTimes* thread_times = NULL;
+   Int4 i;
+
+   for (i = 0; i < eBlastStageMaxNum; i++)
+      diagnostics->stage_times->ticks[i] += stage_times->ticks[i];
+
+   if (stage_times->thread_index < 0)
+      return 0;
+
+   for (i = 0; i < diagnostics->num_thread_stage_times; i++) {
+      if (diagnostics->thread_stage_times[i].thread_index ==
+          stage_times->thread_index) {
+         thread_times = &diagnostics->thread_stage_times[i];
+         break;
+      }
+   }
+   if (!thread_times) {
+      BlastStageTimes* new_times = (BlastStageTimes*)
+         realloc(diagnostics->thread_stage_times,
+                 (diagnostics->num_thread_stage_times + 1) *
+                 sizeof(BlastStageTimes));
+      if (!new_times)
+         return BLASTERR_MEMORY;
+      diagnostics->thread_stage_times = new_times;
+      thread_times = &new_times[diagnostics->num_thread_stage_times++];
+      memset(thread_times, 0, sizeof(BlastStageTimes));
+      thread_times->thread_index = stage_times->thread_index;
+   }
+   for (i = 0; i < eBlastStageMaxNum; i++)
+      thread_times->ticks[i] += stage_times->ticks[i];
+   return 0;
+}
+
+Int2 Blast_DiagnosticsAddStageTimes(BlastDiagnostics* diagnostics,
+                                    const BlastStageTimes* stage_times)
+{
+   Int2 status;
+
+   if (!diagnostics || !diagnostics->stage_times || !stage_times)
+      return 0;
+
+   if (diagnostics->mt_lock)
+      MT_LOCK_Do(diagnostics->mt_lock, eMT_Lock);
+   status = s_DiagnosticsAddStageTimes(diagnostics, stage_times);
+   if (diagnostics->mt_lock)
+      MT_LOCK_Do(diagnostics->mt_lock, eMT_Unlock);
+   return status;
+}
+
 void 
 Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
 {
+   Int4 i;
+
     if (!local)
         return;
 
@@ -150,6 +293,8 @@ Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
          local->gapped_stat->good_extensions;
       global->gapped_stat->num_seqs_passed += 
          local->gapped_stat->num_seqs_passed;
+      global->gapped_stat->simd_extensions += 
+         local->gapped_stat->simd_extensions;
    }
 
    if (global->cutoffs && local->cutoffs) {
@@ -160,6 +305,12 @@ Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
       global->cutoffs->cutoff_score = local->cutoffs->cutoff_score;
    }
 
+   for (i = 0; i < local->num_thread_stats; i++)
+      Blast_DiagnosticsAddThreadStats(global, &local->thread_stats[i]);
+
+   if (global->stage_times && local->stage_times)
+      s_DiagnosticsAddStageTimes(global, local->stage_times);
+
    if (global->mt_lock) 
       MT_LOCK_Do(global->mt_lock, eMT_Unlock);
 }
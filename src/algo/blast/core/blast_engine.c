@@ -386,12 +386,23 @@ s_RPSOffsetArrayToContextOffsets(BlastQueryInfo    * info,
     OffsetArrayToContextOffsets(info, new_offsets, kProgram);
 }
 
-/** Searches only one context of a database sequence, but does all chunks if it is split.
+/** Returns the size of the region shared by the current chunk of a split
+ * subject and the previous one, as needed by Blast_HSPListsMerge.
+ * @param backup Subject split structure, after s_GetNextSubjectChunk [in]
+ */
+static Int4 s_GetSubjectChunkOverlap(const SubjectSplitStruct* backup)
+{
+    return (backup->offset == backup->hard_ranges[backup->hm_index].left) ?
+           0 : DBSEQ_CHUNK_OVERLAP;
+}
+
+/** Searches the current chunk of one context of a database sequence.
  * @param program_number BLAST program type [in]
  * @param query Query sequence structure [in]
  * @param query_info Query information [in]
- * @param subject Subject sequence structure [in]
+ * @param subject Subject sequence structure, set to the chunk [in]
  * @param orig_length original length of query before translation [in]
+ * @param offset Offset of the chunk in the subject sequence [in]
  * @param lookup Lookup table [in]
  * @param gap_align Structure for gapped alignment information [in]
  * @param score_params Scoring parameters [in]
@@ -402,17 +413,14 @@ s_RPSOffsetArrayToContextOffsets(BlastQueryInfo    * info,
  * @param diagnostics Hit counts and other diagnostics [in] [out]
  * @param aux_struct Structure containing different auxiliary data and memory
  *                   for the preliminary stage of the BLAST search [in]
- * @param hsp_list_out_ptr List of HSPs found for a given subject sequence [out]
- * @param interrupt_search function callback to allow interruption of BLAST
- *                   search [in, optional]
- * @param progress_info contains information about the progress of the current
- *                   BLAST search [in|out]
+ * @param hsp_list_ptr HSPs found in the chunk, in chunk coordinates; NULL
+ *                   if there were no initial hits [out]
  */
-
 static Int2
-s_BlastSearchEngineOneContext(EBlastProgramType program_number, 
+s_BlastSearchEngineOneChunk(EBlastProgramType program_number, 
         BLAST_SequenceBlk* query, BlastQueryInfo* query_info, 
-        BLAST_SequenceBlk* subject, Int4 orig_length, LookupTableWrap* lookup, 
+        BLAST_SequenceBlk* subject, Int4 orig_length, Int4 offset,
+        LookupTableWrap* lookup, 
         BlastGapAlignStruct* gap_align, 
         const BlastScoringParameters* score_params, 
         const BlastInitialWordParameters* word_params, 
@@ -420,68 +428,73 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         const BlastHitSavingParameters* hit_params, 
         BlastDiagnostics* diagnostics,
         BlastCoreAuxStruct* aux_struct,
-        BlastHSPList** hsp_list_out_ptr,
-        TInterruptFnPtr interrupt_search, 
-        SBlastProgress* progress_info)
+        BlastHSPList** hsp_list_ptr)
 {
     Int2 status = 0; /* return value */
-    BlastHSPList* combined_hsp_list = NULL;
     BlastHSPList* hsp_list = NULL;
     BlastInitHitList* init_hitlist = aux_struct->init_hitlist;
     BlastScoringOptions* score_options = score_params->options;
     BlastUngappedStats* ungapped_stats = NULL;
     BlastGappedStats* gapped_stats = NULL;
+    BlastStageTimes* stage_times = NULL;
+    Int8 start_ticks = 0;
     Int4 **matrix = (gap_align->positionBased) ?
                      gap_align->sbp->psi_matrix->pssm->data :
                      gap_align->sbp->matrix->data;
     const Boolean kTranslatedSubject = 
        (Blast_SubjectIsTranslated(program_number) || program_number == eBlastTypeRpsTblastn);
-    const Boolean kNucleotide = (program_number == eBlastTypeBlastn ||
-       program_number == eBlastTypePhiBlastn);
-    const int kHspNumMax = BlastHspNumMax(score_options->gapped_calculation, hit_params->options);
     const int kScanSubjectOffsetArraySize = GetOffsetArraySize(lookup);
-    Int4 overlap;
 
-    SubjectSplitStruct backup; 
-    backup.sequence = NULL;
+    *hsp_list_ptr = NULL;
 
     if (diagnostics) {
         ungapped_stats = diagnostics->ungapped_stat;
         gapped_stats = diagnostics->gapped_stat;
+        stage_times = diagnostics->stage_times;
     }
 
-    s_BackupSubject(subject, &backup);
-
-    while (TRUE) {
-        status = s_GetNextSubjectChunk(subject, &backup, kNucleotide);
-        if (status == SUBJECT_SPLIT_DONE) break;
-        if (status == SUBJECT_SPLIT_NO_RANGE) continue;
-        ASSERT(status == SUBJECT_SPLIT_OK);
-        ASSERT(subject->num_seq_ranges >= 1);
-        ASSERT(subject->seq_ranges);
+    BlastInitHitListReset(init_hitlist);
 
-        /* Delete if not done in last loop iteration to prevent memory leak. */
-        hsp_list = Blast_HSPListFree(hsp_list);
+    if (aux_struct->WordFinder) {
+        Int8 scan_ticks = 0;
 
-        BlastInitHitListReset(init_hitlist);
-
-        if (aux_struct->WordFinder) {
-            aux_struct->WordFinder(subject, query, query_info, lookup, matrix, 
-                                   word_params, aux_struct->ewp, 
-                                   aux_struct->offset_pairs, 
-                                   kScanSubjectOffsetArraySize,
-                                   init_hitlist, ungapped_stats);
+        /* The word finders interleave scanning and ungapped extension; they
+           time the scanning, and the rest is counted as extension */
+        if (aux_struct->ewp) {
+            aux_struct->ewp->scan_ticks = stage_times ?
+                &stage_times->ticks[eBlastStageScan] : NULL;
+        }
+        if (stage_times) {
+            scan_ticks = stage_times->ticks[eBlastStageScan];
+            start_ticks = Blast_StageClock();
+        }
 
-            if (init_hitlist->total == 0) continue;
+        aux_struct->WordFinder(subject, query, query_info, lookup, matrix, 
+                               word_params, aux_struct->ewp, 
+                               aux_struct->offset_pairs, 
+                               kScanSubjectOffsetArraySize,
+                               init_hitlist, ungapped_stats);
+
+        if (stage_times) {
+            Int8 end_ticks = Blast_StageClock();
+            stage_times->ticks[eBlastStageUngapped] += end_ticks -
+                start_ticks - (stage_times->ticks[eBlastStageScan] -
+                               scan_ticks);
+            start_ticks = end_ticks;
         }
 
-        if (score_options->gapped_calculation) {
-            Int4 prot_length = 0;
-            if (score_options->is_ooframe) {
-                /* Convert query offsets in all HSPs into the mixed-frame  
-                   coordinates */
-                s_TranslateHSPsToDNAPCoord(program_number, init_hitlist, 
-                       query_info, subject->frame, orig_length, backup.offset);
+        if (init_hitlist->total == 0) return 0;
+    } else if (stage_times) {
+        start_ticks = Blast_StageClock();
+    }
+
+    if (score_options->gapped_calculation) {
+        Int4 prot_length = 0;
+        if (score_options->is_ooframe) {
+            /* Convert query offsets in all HSPs into the mixed-frame  
+               coordinates */
+            s_TranslateHSPsToDNAPCoord(program_number, init_hitlist, 
+                   query_info, subject->frame, orig_length, offset);
             if (kTranslatedSubject) {
                 prot_length = subject->length;
                 subject->length = orig_length;
@@ -497,7 +510,10 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         status = aux_struct->GetGappedScore(program_number, query, query_info, 
                     subject, gap_align, score_params, ext_params, hit_params, 
                     init_hitlist, &hsp_list, gapped_stats, NULL);
-        if (status) break;
+        if (status) {
+            Blast_HSPListFree(hsp_list);
+            return status;
+        }
 
         /* Removes redundant HSPs. */
         Blast_HSPListPurgeHSPsWithCommonEndpoints(program_number, hsp_list, TRUE);
@@ -510,12 +526,93 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
 
         if (score_options->is_ooframe && kTranslatedSubject)
             subject->length = prot_length;
-        } else {
-            BLAST_GetUngappedHSPList(init_hitlist, query_info, subject, 
-                    hit_params->options, &hsp_list);
-        }
 
-        if (hsp_list->hspcnt == 0) continue;
+        if (stage_times)
+            stage_times->ticks[eBlastStageGapped] +=
+                Blast_StageClock() - start_ticks;
+    } else {
+        BLAST_GetUngappedHSPList(init_hitlist, query_info, subject, 
+                hit_params->options, &hsp_list);
+
+        if (stage_times)
+            stage_times->ticks[eBlastStageUngapped] +=
+                Blast_StageClock() - start_ticks;
+    }
+
+    *hsp_list_ptr = hsp_list;
+    return status;
+}
+
+/** Searches only one context of a database sequence, but does all chunks if it is split.
+ * @param program_number BLAST program type [in]
+ * @param query Query sequence structure [in]
+ * @param query_info Query information [in]
+ * @param subject Subject sequence structure [in]
+ * @param orig_length original length of query before translation [in]
+ * @param lookup Lookup table [in]
+ * @param gap_align Structure for gapped alignment information [in]
+ * @param score_params Scoring parameters [in]
+ * @param word_params Initial word finding and ungapped extension 
+ *                    parameters [in]
+ * @param ext_params Gapped extension parameters [in]
+ * @param hit_params Hit saving parameters [in]
+ * @param diagnostics Hit counts and other diagnostics [in] [out]
+ * @param aux_struct Structure containing different auxiliary data and memory
+ *                   for the preliminary stage of the BLAST search [in]
+ * @param hsp_list_out_ptr List of HSPs found for a given subject sequence [out]
+ * @param interrupt_search function callback to allow interruption of BLAST
+ *                   search [in, optional]
+ * @param progress_info contains information about the progress of the current
+ *                   BLAST search [in|out]
+ */
+
+static Int2
+s_BlastSearchEngineOneContext(EBlastProgramType program_number, 
+        BLAST_SequenceBlk* query, BlastQueryInfo* query_info, 
+        BLAST_SequenceBlk* subject, Int4 orig_length, LookupTableWrap* lookup, 
+        BlastGapAlignStruct* gap_align, 
+        const BlastScoringParameters* score_params, 
+        const BlastInitialWordParameters* word_params, 
+        const BlastExtensionParameters* ext_params, 
+        const BlastHitSavingParameters* hit_params, 
+        BlastDiagnostics* diagnostics,
+        BlastCoreAuxStruct* aux_struct,
+        BlastHSPList** hsp_list_out_ptr,
+        TInterruptFnPtr interrupt_search, 
+        SBlastProgress* progress_info)
+{
+    Int2 status = 0; /* return value */
+    BlastHSPList* combined_hsp_list = NULL;
+    BlastHSPList* hsp_list = NULL;
+    BlastInitHitList* init_hitlist = aux_struct->init_hitlist;
+    BlastScoringOptions* score_options = score_params->options;
+    const Boolean kNucleotide = (program_number == eBlastTypeBlastn ||
+       program_number == eBlastTypePhiBlastn);
+    const int kHspNumMax = BlastHspNumMax(score_options->gapped_calculation, hit_params->options);
+
+    SubjectSplitStruct backup; 
+    backup.sequence = NULL;
+
+    s_BackupSubject(subject, &backup);
+
+    while (TRUE) {
+        status = s_GetNextSubjectChunk(subject, &backup, kNucleotide);
+        if (status == SUBJECT_SPLIT_DONE) break;
+        if (status == SUBJECT_SPLIT_NO_RANGE) continue;
+        ASSERT(status == SUBJECT_SPLIT_OK);
+        ASSERT(subject->num_seq_ranges >= 1);
+        ASSERT(subject->seq_ranges);
+
+        /* Delete if not done in last loop iteration to prevent memory leak. */
+        hsp_list = Blast_HSPListFree(hsp_list);
+
+        status = s_BlastSearchEngineOneChunk(program_number, query, 
+                    query_info, subject, orig_length, backup.offset, lookup, 
+                    gap_align, score_params, word_params, ext_params, 
+                    hit_params, diagnostics, aux_struct, &hsp_list);
+        if (status) break;
+
+        if (!hsp_list || hsp_list->hspcnt == 0) continue;
 
         /* The subject ordinal id is not yet filled in this HSP list */
         hsp_list->oid = subject->oid;
@@ -529,11 +626,10 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         }
 
         Blast_HSPListAdjustOffsets(hsp_list, backup.offset);
-        overlap = (backup.offset == backup.hard_ranges[backup.hm_index].left) ?
-                  0 : DBSEQ_CHUNK_OVERLAP;
         status = Blast_HSPListsMerge(&hsp_list, &combined_hsp_list,  
                      kHspNumMax, &(backup.offset), INT4_MIN,
-                     overlap, score_options->gapped_calculation);
+                     s_GetSubjectChunkOverlap(&backup),
+                     score_options->gapped_calculation);
     } /* End loop on chunks of subject sequence */
 
     s_RestoreSubject(subject, &backup);
@@ -579,6 +675,95 @@ s_BlastSearchEngineCoreCleanUp(EBlastProgramType program_number,
     }
 }
 
+/** Check whether the BlastSeqSrc supplied a six-frame translation of the
+ * subject made in advance with the genetic code of this search.
+ * @param subject Subject sequence [in]
+ * @return TRUE if subject->translation_buffer can be used
+ */
+static Boolean
+s_HasTranslatedFrames(const BLAST_SequenceBlk* subject)
+{
+    return subject->translation_buffer && subject->frame_offsets &&
+        subject->translation_gen_code && subject->gen_code_string &&
+        memcmp(subject->translation_gen_code, subject->gen_code_string,
+               GENCODE_STRLEN) == 0;
+}
+
+/** Computes the e-values of the HSPs found in all contexts and chunks of a
+ * subject sequence and discards the HSPs that do not pass the cutoffs.
+ * @param program_number BLAST program type [in]
+ * @param query_info Query information [in]
+ * @param subject_length Length of the subject sequence [in]
+ * @param stat_length Subject length used in the statistics [in]
+ * @param gap_align Structure for gapped alignment information [in]
+ * @param score_params Scoring parameters [in]
+ * @param hit_params Hit saving parameters [in]
+ * @param diagnostics Hit counts and other diagnostics [in] [out]
+ * @param hsp_list_ptr HSPs of the subject; freed and set to NULL if none
+ *                     are left [in] [out]
+ */
+static Int2
+s_BlastSearchEngineCoreFinish(EBlastProgramType program_number,
+        BlastQueryInfo* query_info,
+        Int4 subject_length,
+        Int4 stat_length,
+        BlastGapAlignStruct* gap_align,
+        const BlastScoringParameters* score_params,
+        const BlastHitSavingParameters* hit_params,
+        BlastDiagnostics* diagnostics,
+        BlastHSPList** hsp_list_ptr)
+{
+    BlastHSPList* hsp_list_out = *hsp_list_ptr;
+    BlastHitSavingOptions* hit_options = hit_params->options;
+    BlastScoringOptions* score_options = score_params->options;
+    BlastScoreBlk* sbp = gap_align->sbp;
+    Int2 status = 0;
+
+    if (hit_params->link_hsp_params) {
+        status = BLAST_LinkHsps(program_number, hsp_list_out, query_info,
+                  subject_length, gap_align->sbp, hit_params->link_hsp_params, 
+                  score_options->gapped_calculation);
+    } else if (!Blast_ProgramIsPhiBlast(program_number)
+           && !(Blast_ProgramIsRpsBlast(program_number) && !sbp->gbp) ){
+        /* Calculate e-values for all HSPs. Skip this step
+           for PHI or RPS with old FSC, since calculating the E values 
+           requires precomputation that has not been done yet */
+        Boolean isRPS = FALSE;
+        double scale_factor = 1.0;
+        if (Blast_ProgramIsRpsBlast(program_number)) {
+            isRPS = TRUE;
+            scale_factor = score_params->scale_factor;
+        }
+        status = Blast_HSPListGetEvalues(program_number, query_info,
+                                         stat_length, hsp_list_out, 
+                                         score_options->gapped_calculation, 
+                                         isRPS, gap_align->sbp, 0, scale_factor);
+    }
+    
+   /* Use score threshold rather than evalue if 
+    * matrix_only_scoring is used.  -RMH- 
+    */
+    if ( sbp->matrix_only_scoring )
+    {
+        status = Blast_HSPListReapByRawScore(hsp_list_out, hit_options);
+    }else {
+       /* Discard HSPs that don't pass the e-value test. */
+        status = Blast_HSPListReapByEvalue(hsp_list_out, hit_options);
+    }
+
+    /* If there are no HSPs left, destroy the HSP list too. */
+    if (hsp_list_out && hsp_list_out->hspcnt == 0)
+        *hsp_list_ptr = hsp_list_out = Blast_HSPListFree(hsp_list_out);
+
+    if (diagnostics && diagnostics->gapped_stat && hsp_list_out && hsp_list_out->hspcnt > 0) {
+        BlastGappedStats* gapped_stats = diagnostics->gapped_stat;
+        ++gapped_stats->num_seqs_passed;
+        gapped_stats->good_extensions += hsp_list_out->hspcnt;
+    }
+
+    return status;
+}
+
 /** The core of the BLAST search: comparison between the (concatenated)
  * query against one subject sequence. Translation of the subject sequence
  * into 6 frames is done inside, if necessary. If subject sequence is 
@@ -626,6 +811,7 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
     Uint1* translation_buffer = NULL;
     Int4* frame_offsets   = NULL;
     Int4* frame_offsets_a = NULL; /* Will be freed if non-null */
+    Boolean translated_frames = FALSE; /* translation_buffer not owned */
     BlastHitSavingOptions* hit_options = hit_params->options;
     BlastScoringOptions* score_options = score_params->options;
     Int2 status = 0;
@@ -633,8 +819,6 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
     BlastQueryInfo* query_info = query_info_in;
     Int4 orig_length = subject->length;
     Int4 stat_length = subject->length;
-    // To support rmblastn -RMH-
-    BlastScoreBlk* sbp = gap_align->sbp;
 
     const Boolean kTranslatedSubject = 
         (Blast_SubjectIsTranslated(program_number) || program_number == eBlastTypeRpsTblastn);
@@ -672,11 +856,19 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
             translation_buffer = backup.sequence - 1;
             frame_offsets_a = frame_offsets = ContextOffsetsToOffsetArray(query_info_in);
         } else {
-            BLAST_GetAllTranslations(backup.sequence, eBlastEncodingNcbi2na,
-                                     backup.full_range.right, 
-                                     subject->gen_code_string, &translation_buffer,
-                                     &frame_offsets, NULL);
-            frame_offsets_a = frame_offsets;
+            if (s_HasTranslatedFrames(subject)) {
+                /* The frames were translated in advance, e.g. read from the
+                   translated frame cache of a BLAST database volume. */
+                translated_frames = TRUE;
+                translation_buffer = (Uint1*) subject->translation_buffer;
+                frame_offsets = (Int4*) subject->frame_offsets;
+            } else {
+                BLAST_GetAllTranslations(backup.sequence, eBlastEncodingNcbi2na,
+                                         backup.full_range.right, 
+                                         subject->gen_code_string, &translation_buffer,
+                                         &frame_offsets, NULL);
+                frame_offsets_a = frame_offsets;
+            }
             /* The following limits the search to plus or minus strand if desired. */
             if (subject->subject_strand == 1) {
                 first_context = 0;
@@ -765,55 +957,19 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
     if (status) {
         hsp_list_out = Blast_HSPListFree(hsp_list_out);
         s_BlastSearchEngineCoreCleanUp(program_number, query_info, 
-                                       query_info_in, translation_buffer, 
+                                       query_info_in, 
+                                       translated_frames ? NULL : translation_buffer, 
                                        frame_offsets_a);
         return status;
     }
 
-    if (hit_params->link_hsp_params) {
-        status = BLAST_LinkHsps(program_number, hsp_list_out, query_info,
-                  subject->length, gap_align->sbp, hit_params->link_hsp_params, 
-                  score_options->gapped_calculation);
-    } else if (!Blast_ProgramIsPhiBlast(program_number)
-           && !(Blast_ProgramIsRpsBlast(program_number) && !sbp->gbp) ){
-        /* Calculate e-values for all HSPs. Skip this step
-           for PHI or RPS with old FSC, since calculating the E values 
-           requires precomputation that has not been done yet */
-        Boolean isRPS = FALSE;
-        double scale_factor = 1.0;
-        if (Blast_ProgramIsRpsBlast(program_number)) {
-            isRPS = TRUE;
-            scale_factor = score_params->scale_factor;
-        }
-        status = Blast_HSPListGetEvalues(program_number, query_info,
-                                         stat_length, hsp_list_out, 
-                                         score_options->gapped_calculation, 
-                                         isRPS, gap_align->sbp, 0, scale_factor);
-    }
-    
-   /* Use score threshold rather than evalue if 
-    * matrix_only_scoring is used.  -RMH- 
-    */
-    if ( sbp->matrix_only_scoring )
-    {
-        status = Blast_HSPListReapByRawScore(hsp_list_out, hit_options);
-    }else {
-       /* Discard HSPs that don't pass the e-value test. */
-        status = Blast_HSPListReapByEvalue(hsp_list_out, hit_options);
-    }
-
-    /* If there are no HSPs left, destroy the HSP list too. */
-    if (hsp_list_out && hsp_list_out->hspcnt == 0)
-        *hsp_list_out_ptr = hsp_list_out = Blast_HSPListFree(hsp_list_out);
-
-    if (diagnostics && diagnostics->gapped_stat && hsp_list_out && hsp_list_out->hspcnt > 0) {
-        BlastGappedStats* gapped_stats = diagnostics->gapped_stat;
-        ++gapped_stats->num_seqs_passed;
-        gapped_stats->good_extensions += hsp_list_out->hspcnt;
-    }
+    status = s_BlastSearchEngineCoreFinish(program_number, query_info,
+                subject->length, stat_length, gap_align, score_params,
+                hit_params, diagnostics, &hsp_list_out);
 
     s_BlastSearchEngineCoreCleanUp(program_number, query_info, query_info_in,
-                                   translation_buffer, frame_offsets_a);
+                                   translated_frames ? NULL : translation_buffer,
+                                   frame_offsets_a);
     
     *hsp_list_out_ptr = hsp_list_out;
 
@@ -1110,8 +1266,335 @@ s_AdjustSubjectForSraSearch(BlastHSPList* hsp_list, Uint1 offset )
 	}
 }
 
-Int4 
-BLAST_PreliminarySearchEngine(EBlastProgramType program_number, 
+/** Saves the HSPs found for one subject sequence in the HSP stream, and
+ * raises the low scores used for culling to follow the results saved.
+ * @param hsp_stream Structure for saving the results [in] [out]
+ * @param hit_params Hit saving parameters [in] [out]
+ * @param hsp_list_ptr HSPs to save; taken over by the stream [in] [out]
+ */
+static Int2
+s_SaveSubjectHSPList(BlastHSPStream* hsp_stream,
+                     BlastHitSavingParameters* hit_params,
+                     BlastHSPList** hsp_list_ptr)
+{
+    int query_index=0; /* Used to loop over queries below. */
+    Int2 status = BlastHSPStreamWrite(hsp_stream, hsp_list_ptr);
+
+    if (status != 0)
+        return status;
+
+    if (hit_params->low_score)
+    {
+        for (query_index=0; query_index<hsp_stream->results->num_queries; query_index++)
+          if (hsp_stream->results->hitlist_array[query_index] && hsp_stream->results->hitlist_array[query_index]->heapified)
+               hit_params->low_score[query_index] = 
+                    MAX(hit_params->low_score[query_index], 
+                       hit_params->options->low_score_perc*(hsp_stream->results->hitlist_array[query_index]->low_score));
+    }
+    return status;
+}
+
+/** A long subject sequence whose chunks are searched as separate work units
+ * of a BlastSubjectScheduler. Each unit stores the HSPs of its chunk; the
+ * thread that completes the last unit merges them in chunk order, exactly
+ * as s_BlastSearchEngineOneContext would have, saves the result and frees
+ * the structure. */
+typedef struct BlastSubjectJob {
+    BlastSeqSrcGetSeqArg seq_arg; /**< The subject; owned by the job */
+    Int4 num_chunks;              /**< Number of chunks of the subject */
+    Int4 units_left;              /**< Number of chunks not yet searched */
+    BlastHSPList** chunk_hsp_lists; /**< HSPs of each chunk, in subject
+                                       coordinates */
+    Int4* chunk_offsets;          /**< Start of each chunk in the subject */
+    Int4* chunk_overlaps;         /**< Overlap of each chunk with the
+                                     previous one */
+    Int2* chunk_status;           /**< Search status of each chunk */
+} BlastSubjectJob;
+
+/** Deallocates a split subject, including the subject sequence block; the
+ * sequence data must have been released already.
+ * @param job Structure to free [in]
+ * @return NULL
+ */
+static BlastSubjectJob*
+s_BlastSubjectJobFree(BlastSubjectJob* job)
+{
+    Int4 i;
+
+    if (job == NULL)
+        return NULL;
+
+    if (job->chunk_hsp_lists) {
+        for (i = 0; i < job->num_chunks; i++)
+            Blast_HSPListFree(job->chunk_hsp_lists[i]);
+        sfree(job->chunk_hsp_lists);
+    }
+    sfree(job->chunk_offsets);
+    sfree(job->chunk_overlaps);
+    sfree(job->chunk_status);
+    BlastSequenceBlkFree(job->seq_arg.seq);
+    sfree(job);
+    return NULL;
+}
+
+/** Allocates the structure for a split subject.
+ * @param seq_arg Retrieval arguments holding the subject [in]
+ * @param num_chunks Number of chunks of the subject [in]
+ * @return New structure, or NULL if out of memory
+ */
+static BlastSubjectJob*
+s_BlastSubjectJobNew(const BlastSeqSrcGetSeqArg* seq_arg, Int4 num_chunks)
+{
+    BlastSubjectJob* job = (BlastSubjectJob*) calloc(1, sizeof(BlastSubjectJob));
+
+    if (job == NULL)
+        return NULL;
+
+    job->num_chunks = job->units_left = num_chunks;
+    job->chunk_hsp_lists = 
+        (BlastHSPList**) calloc(num_chunks, sizeof(BlastHSPList*));
+    job->chunk_offsets = (Int4*) calloc(num_chunks, sizeof(Int4));
+    job->chunk_overlaps = (Int4*) calloc(num_chunks, sizeof(Int4));
+    job->chunk_status = (Int2*) calloc(num_chunks, sizeof(Int2));
+    if (!job->chunk_hsp_lists || !job->chunk_offsets ||
+        !job->chunk_overlaps || !job->chunk_status)
+        return s_BlastSubjectJobFree(job);
+
+    job->seq_arg = *seq_arg;
+    return job;
+}
+
+/** Counts the chunks s_GetNextSubjectChunk splits a subject sequence into.
+ * @param subject Subject sequence structure [in]
+ * @param is_nucleotide Is the subject a nucleotide sequence? [in]
+ */
+static Int4
+s_CountSubjectChunks(const BLAST_SequenceBlk* subject, Boolean is_nucleotide)
+{
+    BLAST_SequenceBlk chunk = *subject;
+    SubjectSplitStruct backup;
+
+    backup.sequence = NULL;
+    s_BackupSubject(&chunk, &backup);
+    while (s_GetNextSubjectChunk(&chunk, &backup, is_nucleotide) 
+           != SUBJECT_SPLIT_DONE)
+        continue;
+    s_RestoreSubject(&chunk, &backup);
+
+    return chunk.chunk + 1;
+}
+
+/** Queues the chunks of a long subject sequence as work units of the
+ * scheduler. Only called for programs where the subject is searched in a
+ * single context, without sum statistics recalculated per subject; never
+ * for RPS BLAST, whose subjects are the queries.
+ * @param program_number BLAST program type [in]
+ * @param scheduler Subject scheduler [in] [out]
+ * @param thread_index Queue of the calling thread [in]
+ * @param seq_arg Retrieval arguments holding the subject; if the subject
+ *                is split, the sequence block is taken over by the work
+ *                units and seq_arg->seq is set to NULL [in] [out]
+ * @return TRUE if the subject was split
+ */
+static Boolean
+s_SplitSubject(EBlastProgramType program_number,
+               BlastSubjectScheduler* scheduler, Int4 thread_index,
+               BlastSeqSrcGetSeqArg* seq_arg)
+{
+    const Boolean kNucleotide = (program_number == eBlastTypeBlastn ||
+                                program_number == eBlastTypePhiBlastn);
+    BLAST_SequenceBlk* subject = seq_arg->seq;
+    BlastSubjectJob* job = NULL;
+    Int4 num_chunks = 0;
+
+    ASSERT( !Blast_ProgramIsRpsBlast(program_number) );
+    if (Blast_ProgramIsRpsBlast(program_number))
+        return FALSE;
+
+    if (subject->length <= MAX_DBSEQ_LEN)
+        return FALSE;
+
+    /* the only context searched, see s_BlastSearchEngineCore */
+    subject->frame = kNucleotide ? 1 : 0;
+
+    num_chunks = s_CountSubjectChunks(subject, kNucleotide);
+    if (num_chunks < 2)
+        return FALSE;
+
+    /* The mask ranges may live in a buffer of the sequence source that the
+       next subject retrieved by this thread overwrites */
+    if (subject->seq_ranges && !subject->seq_ranges_allocated &&
+        BlastSeqBlkSetSeqRanges(subject, subject->seq_ranges, 
+                                subject->num_seq_ranges, TRUE, 
+                                subject->mask_type) != 0)
+        return FALSE;
+
+    if ((job = s_BlastSubjectJobNew(seq_arg, num_chunks)) == NULL)
+        return FALSE;
+
+    if (BlastSubjectSchedulerPush(scheduler, thread_index, job, num_chunks)) {
+        job->seq_arg.seq = NULL;  /* still owned by the caller */
+        s_BlastSubjectJobFree(job);
+        return FALSE;
+    }
+
+    seq_arg->seq = NULL;
+    return TRUE;
+}
+
+/** Merges the HSPs of all chunks of a split subject, computes their
+ * e-values, saves them and frees the split subject.
+ * @param program_number BLAST program type [in]
+ * @param query_info Query information [in]
+ * @param seq_src Source of the subject sequence, used to release it [in]
+ * @param gap_align Structure for gapped alignment information [in]
+ * @param score_params Scoring parameters [in]
+ * @param hit_params Hit saving parameters [in] [out]
+ * @param hsp_stream Structure for saving the results [in] [out]
+ * @param diagnostics Hit counts and other diagnostics [in] [out]
+ * @param job The split subject; freed here [in]
+ */
+static Int2
+s_FinishSubjectJob(EBlastProgramType program_number,
+        BlastQueryInfo* query_info,
+        const BlastSeqSrc* seq_src,
+        BlastGapAlignStruct* gap_align,
+        const BlastScoringParameters* score_params,
+        BlastHitSavingParameters* hit_params,
+        BlastHSPStream* hsp_stream,
+        BlastDiagnostics* diagnostics,
+        BlastSubjectJob* job)
+{
+    const Boolean kGapped = score_params->options->gapped_calculation;
+    const int kHspNumMax = BlastHspNumMax(kGapped, hit_params->options);
+    BlastHSPList* hsp_list = NULL;
+    Int2 status = 0;
+    Int4 i;
+
+    /* If a chunk could not be searched, the thread that searched it has
+       already reported the error; just discard the subject */
+    for (i = 0; i < job->num_chunks; i++) {
+        if (job->chunk_status[i] != 0)
+            break;
+    }
+
+    if (i == job->num_chunks) {
+        for (i = 0; i < job->num_chunks && status == 0; i++) {
+            status = Blast_HSPListsMerge(&job->chunk_hsp_lists[i], &hsp_list,
+                         kHspNumMax, &job->chunk_offsets[i], INT4_MIN,
+                         job->chunk_overlaps[i], kGapped);
+        }
+        if (status == 0) {
+            status = s_BlastSearchEngineCoreFinish(program_number, 
+                        query_info, job->seq_arg.seq->length, 
+                        job->seq_arg.seq->length, gap_align, score_params, 
+                        hit_params, diagnostics, &hsp_list);
+        }
+        if (status == 0 && hsp_list && hsp_list->hspcnt > 0)
+            status = s_SaveSubjectHSPList(hsp_stream, hit_params, &hsp_list);
+    }
+
+    Blast_HSPListFree(hsp_list);
+    BlastSeqSrcReleaseSequence(seq_src, &job->seq_arg);
+    s_BlastSubjectJobFree(job);
+    return status;
+}
+
+/** Searches one chunk of a split subject and, if it was the last chunk
+ * left, completes the search of the subject with s_FinishSubjectJob.
+ * @param cancel_status If not 0, the chunk is not searched and the
+ *                      subject is discarded with this status [in]
+ * @param thread_stats Work counts of the calling thread [in] [out]
+ * See s_BlastSearchEngineOneChunk and s_FinishSubjectJob for the other
+ * arguments.
+ */
+static Int2
+s_RunSubjectWorkUnit(EBlastProgramType program_number, 
+        BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+        const BlastSeqSrc* seq_src, LookupTableWrap* lookup,
+        BlastGapAlignStruct* gap_align,
+        const BlastScoringParameters* score_params,
+        const BlastInitialWordParameters* word_params,
+        const BlastExtensionParameters* ext_params,
+        BlastHitSavingParameters* hit_params,
+        BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
+        BlastCoreAuxStruct* aux_struct,
+        BlastSubjectScheduler* scheduler,
+        const BlastSubjectWorkUnit* unit, Int2 cancel_status,
+        BlastThreadStats* thread_stats,
+        TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+{
+    BlastSubjectJob* job = (BlastSubjectJob*) unit->job;
+    Int2 status = cancel_status;
+
+    if (status == 0) {
+        const Boolean kNucleotide = (program_number == eBlastTypeBlastn ||
+                                    program_number == eBlastTypePhiBlastn);
+        /* the sequence block is shared with other threads, so chunk a
+           copy of it */
+        BLAST_SequenceBlk subject = *job->seq_arg.seq;
+        BlastHSPList* hsp_list = NULL;
+        SubjectSplitStruct backup;
+        Int2 split_status;
+
+        backup.sequence = NULL;
+        s_BackupSubject(&subject, &backup);
+        do {
+            split_status = s_GetNextSubjectChunk(&subject, &backup, kNucleotide);
+        } while (split_status != SUBJECT_SPLIT_DONE && 
+                 subject.chunk < unit->chunk);
+        ASSERT(subject.chunk == unit->chunk);
+
+        if (split_status == SUBJECT_SPLIT_OK) {
+            thread_stats->residues += subject.length;
+            status = s_BlastSearchEngineOneChunk(program_number, query, 
+                        query_info, &subject, job->seq_arg.seq->length, 
+                        backup.offset, lookup, gap_align, score_params, 
+                        word_params, ext_params, hit_params, diagnostics, 
+                        aux_struct, &hsp_list);
+        }
+
+        if (status == 0 && hsp_list && hsp_list->hspcnt > 0) {
+            /* The subject ordinal id is not yet filled in this HSP list */
+            hsp_list->oid = subject.oid;
+
+            if (interrupt_search && (*interrupt_search)(progress_info) == TRUE) {
+                status = BLASTERR_INTERRUPTED;
+            } else {
+                Blast_HSPListAdjustOffsets(hsp_list, backup.offset);
+                job->chunk_offsets[unit->chunk] = backup.offset;
+                job->chunk_overlaps[unit->chunk] = 
+                    s_GetSubjectChunkOverlap(&backup);
+                job->chunk_hsp_lists[unit->chunk] = hsp_list;
+                hsp_list = NULL;
+            }
+        }
+
+        Blast_HSPListFree(hsp_list);
+        s_RestoreSubject(&subject, &backup);
+        thread_stats->units++;
+    }
+    job->chunk_status[unit->chunk] = status;
+
+    if (BlastSubjectSchedulerUnitDone(scheduler, &job->units_left)) {
+        Int2 finish_status = 
+            s_FinishSubjectJob(program_number, query_info, seq_src, 
+                               gap_align, score_params, hit_params, 
+                               hsp_stream, diagnostics, job);
+        if (status == 0)
+            status = finish_status;
+    }
+    return status;
+}
+
+/** Implementation of BLAST_PreliminarySearchEngine.
+ * @param scheduler Scheduler for the chunks of long subjects, shared by
+ *                  all threads of the search [in] [out] [optional]
+ * @param thread_index Queue of the calling thread in the scheduler [in]
+ * See BLAST_PreliminarySearchEngine for the other arguments.
+ */
+static Int4 
+s_BlastPreliminarySearchEngine(EBlastProgramType program_number, 
     BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
     const BlastSeqSrc* seq_src, BlastGapAlignStruct* gap_align,
     BlastScoringParameters* score_params, 
@@ -1123,6 +1606,7 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
     const PSIBlastOptions* psi_options, 
     const BlastDatabaseOptions* db_options,
     BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
+    BlastSubjectScheduler* scheduler, Int4 thread_index,
     TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
 {
     BlastCoreAuxStruct* aux_struct = NULL;
@@ -1143,6 +1627,11 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
     T_MB_IdbCheckOid check_index_oid = 
         (T_MB_IdbCheckOid)lookup_wrap->check_index_oid;
     Int4 last_vol_idx = LAST_VOL_IDX_INIT;
+    BlastThreadStats local_stats;
+    BlastThreadStats* thread_stats = scheduler ?
+        BlastSubjectSchedulerGetStats(scheduler, thread_index) : &local_stats;
+    Boolean seq_src_done = FALSE;
+    Boolean split_subjects = FALSE;
 
     BlastInitialWordParametersNew(program_number, word_options, 
       hit_params, lookup_wrap, sbp, query_info, 
@@ -1183,10 +1672,47 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
 
     itr = BlastSeqSrcIteratorNewEx(MAX(BlastSeqSrcGetNumSeqs(seq_src)/100,1));
 
-    /* iterate over all subject sequences */
-    while ( (seq_arg.oid = BlastSeqSrcIteratorNext(seq_src, itr)) 
-           != BLAST_SEQSRC_EOF) {
+    /* Long subjects are searched chunk by chunk by all threads when the
+       chunk results can be merged independently of the rest of the
+       search: subjects searched in one context, and no parameters
+       recalculated for each subject.  RPS BLAST searches the query
+       against the concatenated database and never gets here, but is
+       excluded all the same: its subjects are the queries */
+    memset((void*) &local_stats, 0, sizeof(local_stats));
+    split_subjects = (scheduler != NULL && db_length > 0 && 
+                      gapped_calculation && check_index_oid == 0 &&
+                      !Blast_SubjectIsTranslated(program_number) &&
+                      !Blast_ProgramIsPhiBlast(program_number) &&
+                      !Blast_ProgramIsRpsBlast(program_number));
+
+    /* iterate over all subject sequences, and over the chunks of the long
+       subjects split by this thread or, once the sequence source is 
+       exhausted, by the other threads */
+    while (TRUE) {
        Int4 stat_length;
+       BlastSubjectWorkUnit unit;
+
+       if (scheduler && 
+           BlastSubjectSchedulerPop(scheduler, thread_index, seq_src_done, 
+                                    &unit)) {
+           status = 
+              s_RunSubjectWorkUnit(program_number, query, query_info, 
+                 seq_src, lookup_wrap, gap_align, score_params, word_params, 
+                 ext_params, hit_params, hsp_stream, diagnostics, aux_struct,
+                 scheduler, &unit, 0, thread_stats, interrupt_search, 
+                 progress_info);
+           if (status)
+               break;
+           continue;
+       }
+       if (seq_src_done)
+           break;
+
+       seq_arg.oid = BlastSeqSrcIteratorNext(seq_src, itr);
+       if (seq_arg.oid == BLAST_SEQSRC_EOF) {
+           seq_src_done = TRUE;
+           continue;
+       }
        if (seq_arg.oid == BLAST_SEQSRC_ERROR)
            break;
 
@@ -1198,6 +1724,15 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
        if (BlastSeqSrcGetSequence(seq_src, &seq_arg) < 0)
            continue;
 
+       ++thread_stats->subjects;
+       if (split_subjects && seq_arg.seq->bases_offset == 0 &&
+           s_SplitSubject(program_number, scheduler, thread_index, 
+                          &seq_arg)) {
+           ++thread_stats->split_subjects;
+           continue;
+       }
+       thread_stats->residues += seq_arg.seq->length;
+
        if (db_length == 0) {
            /* This is not a database search, hence need to recalculate and save
             the effective search spaces and length adjustments for all 
@@ -1243,7 +1778,6 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
       }
 
       if (hsp_list && hsp_list->hspcnt > 0) {
-         int query_index=0; /* Used to loop over queries below. */
          if (!gapped_calculation) {
             /* The following must be performed for any ungapped 
                search with a nucleotide database. */
@@ -1306,18 +1840,9 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
          }
 
          /* Save the results. */
-         status = BlastHSPStreamWrite(hsp_stream, &hsp_list);
+         status = s_SaveSubjectHSPList(hsp_stream, hit_params, &hsp_list);
          if (status != 0)
             break;
-
-         if (hit_params->low_score)
-         {
- 	    for (query_index=0; query_index<hsp_stream->results->num_queries; query_index++)
-              if (hsp_stream->results->hitlist_array[query_index] && hsp_stream->results->hitlist_array[query_index]->heapified)
-                   hit_params->low_score[query_index] = 
-			MAX(hit_params->low_score[query_index], 
-                           hit_params->options->low_score_perc*(hsp_stream->results->hitlist_array[query_index]->low_score));
-         }
       }
       
       BlastSeqSrcReleaseSequence(seq_src, &seq_arg);
@@ -1329,6 +1854,19 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
       }
     }
     
+    /* After an error, the chunks left in this thread's queue are not
+       searched, but the subjects they belong to must still be freed */
+    if (scheduler && status) {
+        BlastSubjectWorkUnit unit;
+        while (BlastSubjectSchedulerPop(scheduler, thread_index, FALSE, 
+                                        &unit)) {
+            s_RunSubjectWorkUnit(program_number, query, query_info, seq_src,
+                lookup_wrap, gap_align, score_params, word_params, ext_params,
+                hit_params, hsp_stream, diagnostics, aux_struct, scheduler,
+                &unit, status, thread_stats, interrupt_search, progress_info);
+        }
+    }
+
     /* Tell the indexing library that this thread is done with
        preliminary search.
     */
@@ -1352,6 +1890,28 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
     return status;
 }
 
+Int4 
+BLAST_PreliminarySearchEngine(EBlastProgramType program_number, 
+    BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+    const BlastSeqSrc* seq_src, BlastGapAlignStruct* gap_align,
+    BlastScoringParameters* score_params, 
+    LookupTableWrap* lookup_wrap,
+    const BlastInitialWordOptions* word_options, 
+    BlastExtensionParameters* ext_params, 
+    BlastHitSavingParameters* hit_params,
+    BlastEffectiveLengthsParameters* eff_len_params,
+    const PSIBlastOptions* psi_options, 
+    const BlastDatabaseOptions* db_options,
+    BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
+    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+{
+    return s_BlastPreliminarySearchEngine(program_number, query, query_info,
+              seq_src, gap_align, score_params, lookup_wrap, word_options,
+              ext_params, hit_params, eff_len_params, psi_options, 
+              db_options, hsp_stream, diagnostics, NULL, -1, 
+              interrupt_search, progress_info);
+}
+
 Int2
 Blast_RunPreliminarySearch(EBlastProgramType program, 
     BLAST_SequenceBlk* query, 
@@ -1392,8 +1952,35 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
     BlastHSPStream* hsp_stream, 
     BlastDiagnostics* diagnostics,
     TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+{
+    return Blast_RunPreliminarySearchWithScheduler(program,
+           query, query_info, seq_src, score_options, sbp, lookup_wrap,
+           word_options, ext_options, hit_options, eff_len_options,
+           psi_options, db_options, hsp_stream, diagnostics, NULL,
+           interrupt_search, progress_info);
+}
+
+Int2 
+Blast_RunPreliminarySearchWithScheduler(EBlastProgramType program, 
+    BLAST_SequenceBlk* query, 
+    BlastQueryInfo* query_info, 
+    const BlastSeqSrc* seq_src, 
+    const BlastScoringOptions* score_options,
+    BlastScoreBlk* sbp, 
+    LookupTableWrap* lookup_wrap,
+    const BlastInitialWordOptions* word_options, 
+    const BlastExtensionOptions* ext_options,
+    const BlastHitSavingOptions* hit_options,
+    const BlastEffectiveLengthsOptions* eff_len_options,
+    const PSIBlastOptions* psi_options, 
+    const BlastDatabaseOptions* db_options, 
+    BlastHSPStream* hsp_stream, 
+    BlastDiagnostics* diagnostics,
+    BlastSubjectScheduler* scheduler,
+    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
 {
     Int2 status = 0;
+    Int4 thread_index = -1;
     BlastScoringParameters* score_params = NULL;/**< Scoring parameters */
     BlastExtensionParameters* ext_params = NULL;/**< Gapped extension 
                                                     parameters */
@@ -1407,6 +1994,10 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
       it to the engine and have a lot of mutex contention. */
     BlastDiagnostics* local_diagnostics = Blast_DiagnosticsInit();
 
+    /* The stages are timed by this thread only if they are timed at all */
+    if (diagnostics && diagnostics->stage_times)
+        Blast_DiagnosticsEnableStageTimes(local_diagnostics);
+
     if ((status = 
         BLAST_GapAlignSetUp(program, seq_src, score_options, 
                             eff_len_options, ext_options, hit_options, 
@@ -1414,13 +2005,18 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
                             &hit_params, &eff_len_params, &gap_align)) != 0)
       return status;
     
+    if (scheduler && 
+        (thread_index = BlastSubjectSchedulerRegisterThread(scheduler)) < 0)
+      scheduler = NULL;
+
     if ((status=
-        BLAST_PreliminarySearchEngine(program, query, query_info, 
+        s_BlastPreliminarySearchEngine(program, query, query_info, 
                                       seq_src, gap_align, score_params, 
                                       lookup_wrap, word_options, 
                                       ext_params, hit_params, eff_len_params,
                                       psi_options, db_options, hsp_stream, 
-                                      local_diagnostics, interrupt_search, 
+                                      local_diagnostics, scheduler,
+                                      thread_index, interrupt_search, 
                                       progress_info)) != 0) 
       return status;
 
@@ -1434,6 +2030,12 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
     eff_len_params = BlastEffectiveLengthsParametersFree(eff_len_params);
     
     /* Now update the input diagonistics structure. */
+    if (scheduler) {
+        Blast_DiagnosticsAddThreadStats(local_diagnostics, 
+            BlastSubjectSchedulerGetStats(scheduler, thread_index));
+    }
+    if (local_diagnostics->stage_times)
+        local_diagnostics->stage_times->thread_index = MAX(thread_index, 0);
     Blast_DiagnosticsUpdate(diagnostics, local_diagnostics);
     Blast_DiagnosticsFree(local_diagnostics);
 
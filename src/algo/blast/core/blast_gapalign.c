@@ -39,17 +39,19 @@ static char const rcsid[] =
 #include <algo/blast/core/blast_gapalign.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE macros */
 #include <algo/blast/core/greedy_align.h>
+#include <algo/blast/composition_adjustment/smith_waterman.h>
 #include "blast_gapalign_priv.h"
 #include "blast_hits_priv.h"
 #include "blast_itree.h"
+#include <algo/blast/core/blast_simd.h>
+
+#ifdef BLAST_SIMD_X86
+#include <immintrin.h>
+#endif
 
 static Int2 s_BlastDynProgNtGappedAlignment(BLAST_SequenceBlk* query_blk, 
    BLAST_SequenceBlk* subject_blk, BlastGapAlignStruct* gap_align, 
    const BlastScoringParameters* score_params, BlastInitHSP* init_hsp);
-static Int4 s_BlastAlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M, 
-   Int4* pej, Int4* pei, BlastGapAlignStruct* gap_align,
-   const BlastScoringParameters* score_params, Boolean reverse_sequence);
-
 static Int2 s_BlastProtGappedAlignment(EBlastProgramType program, 
    BLAST_SequenceBlk* query_in, BLAST_SequenceBlk* subject_in,
    BlastGapAlignStruct* gap_align,
@@ -281,6 +283,7 @@ BLAST_GapAlignStructFree(BlastGapAlignStruct* gap_align)
       s_BlastGreedyAlignsFree(gap_align->greedy_align_mem);
    GapStateFree(gap_align->state_struct);
    sfree(gap_align->dp_mem);
+   Blast_SwStripedProfileFree(gap_align->sw_profile);
 
    sfree(gap_align);
    return NULL;
@@ -2810,7 +2813,7 @@ s_BlastDynProgNtGappedAlignment(BLAST_SequenceBlk* query_blk,
    Uint1* subject = subject_blk->sequence;
 
    /* If subject offset is not at the start of a full byte, 
-      s_BlastAlignPackedNucl won't work, so shift the alignment start
+      Blast_AlignPackedNucl won't work, so shift the alignment start
       to the next multiple of 4 subject letters. Note that the 
       shift amount is always nonzero, so a left extension always happens 
       (and has a few presumed exact matches to start with). In the case 
@@ -2831,7 +2834,7 @@ s_BlastDynProgNtGappedAlignment(BLAST_SequenceBlk* query_blk,
    }
 
    /* perform extension to left */
-   score_left = s_BlastAlignPackedNucl(query, subject, q_length, s_length, 
+   score_left = Blast_AlignPackedNucl(query, subject, q_length, s_length, 
                       &private_q_start, &private_s_start, gap_align, 
                       score_params, TRUE);
    if (score_left < 0) 
@@ -2843,7 +2846,7 @@ s_BlastDynProgNtGappedAlignment(BLAST_SequenceBlk* query_blk,
    if (q_length < query_blk->length && 
        s_length < subject_blk->length)
    {
-      score_right = s_BlastAlignPackedNucl(query+q_length-1, 
+      score_right = Blast_AlignPackedNucl(query+q_length-1, 
          subject+(s_length+3)/COMPRESSION_RATIO - 1, 
          query_blk->length-q_length, 
          subject_blk->length-s_length, &(gap_align->query_stop),
@@ -2863,22 +2866,226 @@ s_BlastDynProgNtGappedAlignment(BLAST_SequenceBlk* query_blk,
    return 0;
 }
 
-/** Aligns two nucleotide sequences, one (A) should be packed in the
- * same way as the BLAST databases, the other (B) should contain one
- * basepair/byte. Traceback is not done in this function.
- * @param B The query sequence [in]
- * @param A The subject sequence [in]
- * @param N Maximal extension length in query [in]
- * @param M Maximal extension length in subject [in]
- * @param b_offset Resulting starting offset in query [out]
- * @param a_offset Resulting starting offset in subject [out]
- * @param gap_align The auxiliary structure for gapped alignment [in]
- * @param score_params Parameters related to scoring [in]
- * @param reverse_sequence Reverse the sequence.
- * @return The best alignment score found.
-*/
-static Int4 
-s_BlastAlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M, 
+#ifdef BLAST_SIMD_X86
+
+/** Number of query letters examined by one step of the vectorized
+ * nucleotide gapped extension */
+#define NA_GAPPED_BLOCK 4
+
+/** Profile entry of a score that does not fit in a byte, such as that of
+ * the gap sentinel letter */
+#define NA_GAPPED_NO_SCORE INT1_MIN
+
+/**
+ * Vectorized inner loop of Blast_AlignPackedNucl: examine the cells of one
+ * row of the dynamic programming from a cell past the first one of the row
+ * to the end of the row, NA_GAPPED_BLOCK cells at a time.
+ *
+ * Within a row, the cells depend on each other only through the score of
+ * the gap in the query (score_gap_row) and through the best score so far.
+ * While the cells pass the X dropoff test, the gap score entering each
+ * cell is a prefix maximum of the scores of the earlier cells, less the
+ * cost of the gap, and so is the best score so far; both are computed
+ * with vector prefix maxima. A cell failing the X dropoff test does not
+ * extend the gap, so a block where a cell other than the last one fails
+ * it is examined with the scalar code, as are the cells past the last
+ * whole block and the blocks with a query letter whose score does not fit
+ * in a byte (NA_GAPPED_NO_SCORE in the profile); the results are those of
+ * the scalar loop.
+ *
+ * @param score_array the dynamic programming cells of the row [in][out]
+ * @param b_ptr query letter of the cell preceding b_index [in]
+ * @param b_increment 1 or -1, the direction in which the query is read [in]
+ * @param b_index first cell to examine; must not be the first cell of the
+ *                row [in]
+ * @param b_size end of the row [in]
+ * @param matrix_row scores of the subject letter of the row [in]
+ * @param row_profile the same scores as bytes, for the 16 query
+ *                    letters [in]
+ * @param x_dropoff the X dropoff parameter [in]
+ * @param gap_open_extend the cost of a gap of length one [in]
+ * @param gap_extend the cost of extending a gap [in]
+ * @param a_index the row [in]
+ * @param score the score of the diagonal move into cell b_index [in]
+ * @param score_gap_row the score of the gap in the query before/after the
+ *                      cells [in][out]
+ * @param best_score the best score before/after the cells [in][out]
+ * @param a_offset row of the best score [in][out]
+ * @param b_offset cell of the best score [in][out]
+ * @param last_b_index the last cell passing the X dropoff test [in][out]
+ * @return the number of blocks examined with vector code
+ */
+static Int4 BLAST_TARGET_SSE41
+s_NaGappedRowSSE41(BlastGapDP* score_array, const Uint1* b_ptr,
+                   Int4 b_increment, Int4 b_index, Int4 b_size,
+                   const Int4* matrix_row, const Int1* row_profile,
+                   Int4 x_dropoff, Int4 gap_open_extend, Int4 gap_extend,
+                   Int4 a_index, Int4 score, Int4* score_gap_row,
+                   Int4* best_score, Int4* a_offset, Int4* b_offset,
+                   Int4* last_b_index)
+{
+    const __m128i kMinScore = _mm_set1_epi32(INT4_MIN);
+    const __m128i kDead = _mm_set1_epi32(MININT);
+    const __m128i kGapExtend = _mm_set1_epi32(gap_extend);
+    const __m128i kGapOpenExtend = _mm_set1_epi32(gap_open_extend);
+    const __m128i kDropoff = _mm_set1_epi32(x_dropoff);
+    const __m128i kProfile = _mm_loadu_si128((const __m128i*)row_profile);
+    const __m128i kNoScore = _mm_set1_epi8(NA_GAPPED_NO_SCORE);
+    /* extensions of the row gap from the first cell of a block */
+    const __m128i kSteps = _mm_mullo_epi32(kGapExtend,
+                                           _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i kOpenSteps = _mm_sub_epi32(_mm_add_epi32(kSteps,
+                                                           kGapExtend),
+                                             kGapOpenExtend);
+    Int4 gap_row = *score_gap_row;
+    Int4 best = *best_score;
+    Int4 score_gap_col, next_score;
+    Int4 num_blocks = 0;
+
+    while (b_index < b_size) {
+        if (b_index + NA_GAPPED_BLOCK <= b_size) {
+            __m128i vLo, vHi, vBest, vGap, vNext, vScore, vMax, vBefore;
+            __m128i vGapRow, vNewGap, vDead;
+            Uint4 letters;
+            int dead, no_score;
+
+            /* split the {best, best_gap} pairs of the block */
+            vLo = _mm_loadu_si128((const __m128i*)(score_array + b_index));
+            vHi = _mm_loadu_si128((const __m128i*)(score_array + b_index
+                                                   + 2));
+            vBest = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(vLo),
+                                                    _mm_castsi128_ps(vHi),
+                                                    _MM_SHUFFLE(2, 0, 2, 0)));
+            vGap = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(vLo),
+                                                   _mm_castsi128_ps(vHi),
+                                                   _MM_SHUFFLE(3, 1, 3, 1)));
+
+            /* the query letters of the cells in the order they are
+               visited; the profile lookup is a shuffle of the 16 bytes */
+            if (b_increment > 0) {
+                memcpy(&letters, b_ptr + 1, sizeof(letters));
+            } else {
+                memcpy(&letters, b_ptr - NA_GAPPED_BLOCK, sizeof(letters));
+                letters = __builtin_bswap32(letters);
+            }
+            vNext = _mm_shuffle_epi8(kProfile,
+                                     _mm_cvtsi32_si128((int)letters));
+            no_score = _mm_movemask_epi8(_mm_cmpeq_epi8(vNext, kNoScore))
+                       & 0xF;
+            vNext = _mm_cvtepi8_epi32(vNext);
+
+            /* vNext holds the diagonal scores into the cells after each
+               cell; without the row gap, the scores of the cells are those
+               of the diagonal and of the column gap */
+            vNext = _mm_add_epi32(vBest, vNext);
+            vScore = _mm_alignr_epi8(vNext, _mm_set1_epi32(score), 12);
+            vScore = _mm_max_epi32(vScore, vGap);
+
+            /* the row gap entering cell k is the larger of the gap
+               entering the block and of those opened in cells m < k and
+               extended k-m-1 times; opening one in a cell whose score comes
+               from the row gap never beats extending it, so the scores
+               without the row gap suffice */
+            vGapRow = _mm_add_epi32(vScore, kOpenSteps);
+            vGapRow = _mm_max_epi32(vGapRow,
+                                    _mm_alignr_epi8(vGapRow, kMinScore, 12));
+            vGapRow = _mm_max_epi32(vGapRow,
+                                    _mm_alignr_epi8(vGapRow, kMinScore, 8));
+            vGapRow = _mm_max_epi32(_mm_alignr_epi8(vGapRow, kMinScore, 12),
+                                    _mm_set1_epi32(gap_row));
+            vGapRow = _mm_sub_epi32(vGapRow, kSteps);
+            vScore = _mm_max_epi32(vScore, vGapRow);
+
+            /* best score before each cell */
+            vMax = _mm_max_epi32(vScore,
+                                 _mm_alignr_epi8(vScore, kMinScore, 12));
+            vMax = _mm_max_epi32(vMax, _mm_alignr_epi8(vMax, kMinScore, 8));
+            vBefore = _mm_max_epi32(_mm_alignr_epi8(vMax, kMinScore, 12),
+                                    _mm_set1_epi32(best));
+            vDead = _mm_cmpgt_epi32(_mm_sub_epi32(vBefore, vScore),
+                                    kDropoff);
+            dead = _mm_movemask_ps(_mm_castsi128_ps(vDead));
+
+            if ((dead & 0x7) == 0 && no_score == 0) {
+                /* a cell failing the X dropoff test keeps its gap score */
+                vNewGap = _mm_max_epi32(_mm_sub_epi32(vScore,
+                                                      kGapOpenExtend),
+                                        _mm_sub_epi32(vGap, kGapExtend));
+                vNewGap = _mm_blendv_epi8(vNewGap, vGap, vDead);
+                vBest = _mm_blendv_epi8(vScore, kDead, vDead);
+                _mm_storeu_si128((__m128i*)(score_array + b_index),
+                                 _mm_unpacklo_epi32(vBest, vNewGap));
+                _mm_storeu_si128((__m128i*)(score_array + b_index + 2),
+                                 _mm_unpackhi_epi32(vBest, vNewGap));
+
+                if (_mm_extract_epi32(vMax, 3) > best) {
+                    /* the scalar loop records the first cell reaching the
+                       maximum */
+                    vMax = _mm_shuffle_epi32(vMax, 0xFF);
+                    best = _mm_cvtsi128_si32(vMax);
+                    *a_offset = a_index;
+                    *b_offset = b_index + __builtin_ctz(_mm_movemask_ps(
+                        _mm_castsi128_ps(_mm_cmpeq_epi32(vScore, vMax))));
+                }
+                if (dead) {
+                    *last_b_index = b_index + NA_GAPPED_BLOCK - 2;
+                    gap_row = _mm_extract_epi32(vGapRow, 3);
+                } else {
+                    *last_b_index = b_index + NA_GAPPED_BLOCK - 1;
+                    gap_row = MAX(_mm_extract_epi32(vScore, 3)
+                                  - gap_open_extend,
+                                  _mm_extract_epi32(vGapRow, 3)
+                                  - gap_extend);
+                }
+                score = _mm_extract_epi32(vNext, 3);
+                b_ptr += NA_GAPPED_BLOCK * b_increment;
+                b_index += NA_GAPPED_BLOCK;
+                num_blocks++;
+                continue;
+            }
+        }
+
+        /* one cell as in Blast_AlignPackedNucl */
+        b_ptr += b_increment;
+        score_gap_col = score_array[b_index].best_gap;
+        next_score = score_array[b_index].best + matrix_row[ *b_ptr ];
+
+        if (score < score_gap_col)
+            score = score_gap_col;
+
+        if (score < gap_row)
+            score = gap_row;
+
+        if (best - score > x_dropoff) {
+            score_array[b_index].best = MININT;
+        }
+        else {
+            *last_b_index = b_index;
+            if (score > best) {
+                best = score;
+                *a_offset = a_index;
+                *b_offset = b_index;
+            }
+            gap_row -= gap_extend;
+            score_gap_col -= gap_extend;
+            score_array[b_index].best_gap = MAX(score - gap_open_extend,
+                                                score_gap_col);
+            gap_row = MAX(score - gap_open_extend, gap_row);
+            score_array[b_index].best = score;
+        }
+        score = next_score;
+        b_index++;
+    }
+
+    *score_gap_row = gap_row;
+    *best_score = best;
+    return num_blocks;
+}
+
+#endif /* BLAST_SIMD_X86 */
+
+Int4 
+Blast_AlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M, 
 	Int4* b_offset, Int4* a_offset, 
         BlastGapAlignStruct* gap_align,
         const BlastScoringParameters* score_params, 
@@ -2905,6 +3112,12 @@ s_BlastAlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M,
     Int4 score_gap_col;
     Int4 next_score;
     Int4 best_score;
+#ifdef BLAST_SIMD_X86
+    /* rows of the matrix for the 4 subject letters, as bytes */
+    Int1 profile[NCBI2NA_MASK + 1][BLASTNA_SIZE];
+    Int1* row_profile = NULL;
+    Boolean use_simd = FALSE;
+#endif
   
     /* do initialization and sanity-checking */
 
@@ -2921,6 +3134,28 @@ s_BlastAlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M,
   
     if(N <= 0 || M <= 0) 
         return 0;
+
+#ifdef BLAST_SIMD_X86
+    if (N >= NA_GAPPED_BLOCK && BlastSimd_GetLevel() >= eBlastSimdSSE41) {
+        Int4 j;
+        /* the scores of the letters without a byte score, always those of
+           the gap sentinel, are marked for the scalar code; the vector
+           code is worthwhile if the four bases have byte scores */
+        use_simd = TRUE;
+        for (i = 0; i <= NCBI2NA_MASK; i++) {
+            for (j = 0; j < BLASTNA_SIZE; j++) {
+                if (matrix[i][j] > NA_GAPPED_NO_SCORE &&
+                    matrix[i][j] <= INT1_MAX) {
+                    profile[i][j] = (Int1)matrix[i][j];
+                } else {
+                    profile[i][j] = NA_GAPPED_NO_SCORE;
+                    if (j <= NCBI2NA_MASK)
+                        use_simd = FALSE;
+                }
+            }
+        }
+    }
+#endif
   
     /* Allocate and fill in the auxiliary bookeeping structures.
        Since A and B could be very large, maintain a window
@@ -2981,6 +3216,9 @@ s_BlastAlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M,
                                                (3-((a_index-1)%4)));
             matrix_row = matrix[a_base_pair];
         }
+#ifdef BLAST_SIMD_X86
+        row_profile = profile[a_base_pair];
+#endif
 
         if(reverse_sequence)
             b_ptr = &B[N - first_b_index];
@@ -2994,6 +3232,21 @@ s_BlastAlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M,
 
         for (b_index = first_b_index; b_index < b_size; b_index++) {
 
+#ifdef BLAST_SIMD_X86
+            /* past the first cell of the row, whose X dropoff failure
+               moves first_b_index instead of clearing the cell */
+            if (use_simd && b_index > first_b_index) {
+                gap_align->simd_blocks +=
+                    s_NaGappedRowSSE41(score_array, b_ptr, b_increment,
+                                       b_index, b_size, matrix_row,
+                                       row_profile, x_dropoff,
+                                       gap_open_extend, gap_extend,
+                                       a_index, score, &score_gap_row,
+                                       &best_score, a_offset, b_offset,
+                                       &last_b_index);
+                break;
+            }
+#endif
             b_ptr += b_increment;
             score_gap_col = score_array[b_index].best_gap;
             next_score = score_array[b_index].best + matrix_row[ *b_ptr ];
@@ -3522,6 +3775,7 @@ Int2 BLAST_GetGappedScore (EBlastProgramType program_number,
             init_hsp->offsets.qs_offsets.s_off =
                                 gap_align->greedy_subject_seed_start;
          } else {
+            Int8 simd_blocks = gap_align->simd_blocks;
             /*  Assuming the ungapped alignment is long enough to
                 contain an 8-letter seed of exact matches, start 
                 the gapped alignment inside the first byte of the 
@@ -3536,6 +3790,8 @@ Int2 BLAST_GetGappedScore (EBlastProgramType program_number,
             }
             status = s_BlastDynProgNtGappedAlignment(&query_tmp, subject, 
                          gap_align, score_params, init_hsp);
+            if (gapped_stats && gap_align->simd_blocks != simd_blocks)
+               ++gapped_stats->simd_extensions;
          }
 
          if (status) {
@@ -101,6 +101,28 @@ Blast_SemiGappedAlign(const Uint1* A, const Uint1* B, Int4 M, Int4 N,
                   Int4 query_offset, Boolean reversed, Boolean reverse_sequence,
                   Boolean * fence_hit);
 
+/** Aligns two nucleotide sequences, one (A) should be packed in the
+ * same way as the BLAST databases, the other (B) should contain one
+ * basepair/byte. Traceback is not done in this function.
+ * @param B The query sequence [in]
+ * @param A The subject sequence [in]
+ * @param N Maximal extension length in query [in]
+ * @param M Maximal extension length in subject [in]
+ * @param b_offset Resulting starting offset in query [out]
+ * @param a_offset Resulting starting offset in subject [out]
+ * @param gap_align The auxiliary structure for gapped alignment [in]
+ * @param score_params Parameters related to scoring [in]
+ * @param reverse_sequence Reverse the sequence.
+ * @return The best alignment score found.
+*/
+NCBI_XBLAST_EXPORT
+Int4 
+Blast_AlignPackedNucl(Uint1* B, Uint1* A, Int4 N, Int4 M, 
+                      Int4* b_offset, Int4* a_offset, 
+                      BlastGapAlignStruct* gap_align,
+                      const BlastScoringParameters* score_params, 
+                      Boolean reverse_sequence);
+
 /** Convert the initial list of traceback actions from a non-OOF
  *  gapped alignment into a blast edit script. Note that this routine
  *  assumes the input edit blocks have not been reversed or rearranged
@@ -41,6 +41,849 @@ static char const rcsid[] =
 #include <algo/blast/core/blast_hspstream.h>
 #include <algo/blast/core/blast_util.h>
 
+/** Spilling of saved HSP lists to a temporary file.
+ *
+ * A stream with a memory limit estimates the memory of the HSP lists it
+ * saves. When the limit is exceeded, all the HSP lists saved so far are
+ * sorted in the order in which the stream is read, encoded compactly and
+ * appended to a temporary file as a run, and only a small index entry is
+ * kept in memory for each of them. When the stream is closed, the best HSP
+ * lists of each query are selected on the index, as the collector would
+ * have done, and reading merges the runs.
+ */
+
+/** Index entry of an HSP list saved in a temporary file */
+typedef struct SSpilledHSPList {
+    Int4 query_index;       /**< Query of the HSP list */
+    Int4 oid;               /**< Subject of the HSP list */
+    double best_evalue;     /**< Best e-value of the HSP list */
+    Int4 best_score;        /**< Score of the first HSP of the list */
+    Int8 offset;            /**< Offset of the encoded HSP list in the
+                                 temporary file */
+    Int4 size;              /**< Size of the encoded HSP list, in bytes */
+    Boolean keep;           /**< Is the HSP list among the best ones of its
+                                 query? */
+    BlastHSPList* hsp_list; /**< The HSP list, while its run is written */
+} SSpilledHSPList;
+
+/** HSP lists of a stream saved in a temporary file */
+struct BlastHSPStreamSpill {
+    Int8 max_bytes;           /**< Memory limit for the saved HSP lists */
+    Int8 bytes;               /**< Estimated memory of the saved HSP lists */
+    Boolean by_score;         /**< Are HSP lists read by query and score, as
+                                   opposed to by subject OID? */
+    Boolean failed;           /**< Did writing or reading a run fail? */
+    Boolean writing;          /**< Is a thread writing a run without holding
+                                   the lock of the stream? */
+    FILE* file;               /**< Temporary file holding the runs */
+    Int8 file_size;           /**< Size of the temporary file */
+    Int4 num_runs;            /**< Number of runs in the file */
+    SSpilledHSPList* lists;   /**< Index of the saved HSP lists, by run and
+                                 in the order of the run */
+    Int4 num_lists;           /**< Number of entries in lists */
+    Int4 num_lists_alloc;     /**< Number of allocated entries in lists */
+    Int4* run_next;           /**< Entry of the next HSP list of each run */
+    Int4* run_end;            /**< Entry after the last HSP list of each run */
+    Int4* heap;               /**< Runs with HSP lists left to read, as a heap
+                                 ordered by their next HSP list */
+    Int4 heap_size;           /**< Number of runs in heap */
+    Uint1* buffer;            /**< Buffer for encoding and decoding */
+    Int4 buffer_size;         /**< Allocated size of buffer */
+};
+
+/** Relative precision of e-value comparisons, as in blast_hits.c */
+#define SPILL_FUZZY_EVALUE_FACTOR 1e-6
+
+/** Rank two saved HSP lists of a query the way the collector ranks HSP lists
+ * of a hit list: by best e-value, then by best score, then by decreasing
+ * OID.
+ * @param a First HSP list [in]
+ * @param b Second HSP list [in]
+ * @return negative if a is better than b, positive if it is worse
+ */
+static int
+s_SpilledHSPListRank(const SSpilledHSPList* a, const SSpilledHSPList* b)
+{
+    if (a->best_evalue < (1-SPILL_FUZZY_EVALUE_FACTOR)*b->best_evalue)
+        return -1;
+    if (a->best_evalue > (1+SPILL_FUZZY_EVALUE_FACTOR)*b->best_evalue)
+        return 1;
+    if (a->best_score != b->best_score)
+        return BLAST_CMP(b->best_score, a->best_score);
+    return BLAST_CMP(b->oid, a->oid);
+}
+
+/** Compare two saved HSP lists in the order the stream is read.
+ * @param a First HSP list [in]
+ * @param b Second HSP list [in]
+ * @param by_score TRUE if the stream is read by query and score, FALSE if
+ * it is read by subject OID [in]
+ * @return compare result
+ */
+static int
+s_SpilledHSPListCompare(const SSpilledHSPList* a, const SSpilledHSPList* b,
+                        Boolean by_score)
+{
+    if (by_score) {
+        if (a->query_index != b->query_index)
+            return BLAST_CMP(a->query_index, b->query_index);
+        return s_SpilledHSPListRank(a, b);
+    }
+    if (a->oid != b->oid)
+        return BLAST_CMP(a->oid, b->oid);
+    return BLAST_CMP(a->query_index, b->query_index);
+}
+
+/** qsort callback putting the HSP lists of a run in subject OID order */
+static int s_SortSpilledByOid(const void* x, const void* y)
+{
+    return s_SpilledHSPListCompare((const SSpilledHSPList*)x,
+                                   (const SSpilledHSPList*)y, FALSE);
+}
+
+/** qsort callback putting the HSP lists of a run in query and score order */
+static int s_SortSpilledByScore(const void* x, const void* y)
+{
+    return s_SpilledHSPListCompare((const SSpilledHSPList*)x,
+                                   (const SSpilledHSPList*)y, TRUE);
+}
+
+/** qsort callback sorting pointers to saved HSP lists by query and score */
+static int s_SortSpilledPtrByScore(const void* x, const void* y)
+{
+    return s_SpilledHSPListCompare(*(const SSpilledHSPList**)x,
+                                   *(const SSpilledHSPList**)y, TRUE);
+}
+
+/** Estimate the memory used by an HSP list.
+ * @param hsp_list The HSP list [in]
+ * @return size in bytes
+ */
+static Int8 s_HSPListMemory(const BlastHSPList* hsp_list)
+{
+    Int4 i;
+    Int8 bytes;
+
+    if (!hsp_list)
+        return 0;
+
+    bytes = sizeof(BlastHSPList) + hsp_list->allocated * sizeof(BlastHSP*);
+    for (i = 0; i < hsp_list->hspcnt; i++) {
+        const BlastHSP* hsp = hsp_list->hsp_array[i];
+        if (!hsp)
+            continue;
+        bytes += sizeof(BlastHSP);
+        if (hsp->gap_info) {
+            bytes += sizeof(GapEditScript) + hsp->gap_info->size *
+                     (sizeof(EGapAlignOpType) + sizeof(Int4));
+        }
+        if (hsp->pat_info)
+            bytes += sizeof(SPHIHspInfo);
+    }
+    return bytes;
+}
+
+/** Memory used by the HSP lists saved in a results structure.
+ * @param results The results [in]
+ * @return size in bytes
+ */
+static Int8 s_HSPResultsMemory(const BlastHSPResults* results)
+{
+    Int4 i, j;
+    Int8 bytes = 0;
+
+    for (i = 0; i < results->num_queries; i++) {
+        const BlastHitList* hitlist = results->hitlist_array[i];
+        if (!hitlist)
+            continue;
+        for (j = 0; j < hitlist->hsplist_count; j++)
+            bytes += s_HSPListMemory(hitlist->hsplist_array[j]);
+    }
+    return bytes;
+}
+
+/** Make the encoding buffer of a spill at least a given size.
+ * @param spill The spill [in] [out]
+ * @param size Size needed [in]
+ * @return 0 on success, -1 if out of memory
+ */
+static int s_SpillReserve(struct BlastHSPStreamSpill* spill, Int4 size)
+{
+    if (size > spill->buffer_size) {
+        Uint1* buffer = (Uint1*) realloc(spill->buffer, size);
+        if (!buffer)
+            return -1;
+        spill->buffer = buffer;
+        spill->buffer_size = size;
+    }
+    return 0;
+}
+
+/** Encode an unsigned integer, 7 bits per byte, low bits first
+ * @param p Where to encode [in]
+ * @param value The integer [in]
+ * @return pointer past the encoded integer
+ */
+static Uint1* s_PutUint(Uint1* p, Uint4 value)
+{
+    while (value >= 0x80) {
+        *p++ = (Uint1) (value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (Uint1) value;
+    return p;
+}
+
+/** Encode a signed integer, with small absolute values in few bytes
+ * @param p Where to encode [in]
+ * @param value The integer [in]
+ * @return pointer past the encoded integer
+ */
+static Uint1* s_PutInt(Uint1* p, Int4 value)
+{
+    return s_PutUint(p, ((Uint4) value << 1) ^ (Uint4) (value >> 31));
+}
+
+/** Encode a double
+ * @param p Where to encode [in]
+ * @param value The double [in]
+ * @return pointer past the encoded double
+ */
+static Uint1* s_PutDouble(Uint1* p, double value)
+{
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+/** Decode an unsigned integer encoded by s_PutUint
+ * @param p Where to decode; advanced past the integer [in] [out]
+ * @return the integer
+ */
+static Uint4 s_GetUint(const Uint1** p)
+{
+    Uint4 value = 0;
+    int shift = 0;
+    const Uint1* q = *p;
+
+    while (*q & 0x80) {
+        value |= (Uint4) (*q++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= (Uint4) *q++ << shift;
+    *p = q;
+    return value;
+}
+
+/** Decode a signed integer encoded by s_PutInt
+ * @param p Where to decode; advanced past the integer [in] [out]
+ * @return the integer
+ */
+static Int4 s_GetInt(const Uint1** p)
+{
+    Uint4 value = s_GetUint(p);
+    return (Int4) (value >> 1) ^ -(Int4) (value & 1);
+}
+
+/** Decode a double encoded by s_PutDouble
+ * @param p Where to decode; advanced past the double [in] [out]
+ * @return the double
+ */
+static double s_GetDouble(const Uint1** p)
+{
+    double value;
+    memcpy(&value, *p, sizeof(value));
+    *p += sizeof(value);
+    return value;
+}
+
+/** Largest number of bytes of an encoded integer */
+#define SPILL_MAX_INT_SIZE 5
+
+/** Encode a segment of an HSP
+ * @param p Where to encode [in]
+ * @param seg The segment [in]
+ * @return pointer past the encoded segment
+ */
+static Uint1* s_PutSeg(Uint1* p, const BlastSeg* seg)
+{
+    p = s_PutInt(p, seg->frame);
+    p = s_PutInt(p, seg->offset);
+    p = s_PutInt(p, seg->end - seg->offset);
+    return s_PutInt(p, seg->gapped_start - seg->offset);
+}
+
+/** Decode a segment of an HSP encoded by s_PutSeg
+ * @param p Where to decode; advanced past the segment [in] [out]
+ * @param seg The segment [out]
+ */
+static void s_GetSeg(const Uint1** p, BlastSeg* seg)
+{
+    seg->frame = (Int2) s_GetInt(p);
+    seg->offset = s_GetInt(p);
+    seg->end = seg->offset + s_GetInt(p);
+    seg->gapped_start = seg->offset + s_GetInt(p);
+}
+
+/** Encode an HSP list in the buffer of a spill
+ * @param spill The spill [in] [out]
+ * @param hsp_list The HSP list [in]
+ * @return size of the encoded HSP list, or -1 if out of memory
+ */
+static Int4 s_EncodeHSPList(struct BlastHSPStreamSpill* spill,
+                            const BlastHSPList* hsp_list)
+{
+    Int4 i, j;
+    Int4 size = 6 * SPILL_MAX_INT_SIZE + sizeof(double);
+    Uint1* p;
+
+    /* compute the largest size the encoding can take */
+    for (i = 0; i < hsp_list->hspcnt; i++) {
+        const BlastHSP* hsp = hsp_list->hsp_array[i];
+        size += 17 * SPILL_MAX_INT_SIZE + 2 * sizeof(double);
+        if (hsp->gap_info)
+            size += 2 * hsp->gap_info->size * SPILL_MAX_INT_SIZE;
+    }
+    if (s_SpillReserve(spill, size) != 0)
+        return -1;
+
+    p = spill->buffer;
+    p = s_PutUint(p, hsp_list->hspcnt);
+    p = s_PutInt(p, hsp_list->oid);
+    p = s_PutInt(p, hsp_list->query_index);
+    p = s_PutInt(p, hsp_list->hsp_max);
+    p = s_PutUint(p, hsp_list->do_not_reallocate);
+    p = s_PutDouble(p, hsp_list->best_evalue);
+
+    for (i = 0; i < hsp_list->hspcnt; i++) {
+        const BlastHSP* hsp = hsp_list->hsp_array[i];
+        p = s_PutInt(p, hsp->score);
+        p = s_PutInt(p, hsp->num_ident);
+        p = s_PutDouble(p, hsp->bit_score);
+        p = s_PutDouble(p, hsp->evalue);
+        p = s_PutSeg(p, &hsp->query);
+        p = s_PutSeg(p, &hsp->subject);
+        p = s_PutInt(p, hsp->context);
+        p = s_PutInt(p, hsp->num);
+        p = s_PutInt(p, hsp->comp_adjustment_method);
+        p = s_PutInt(p, hsp->num_positives);
+        p = s_PutUint(p, (hsp->gap_info ? 1 : 0) | (hsp->pat_info ? 2 : 0));
+        if (hsp->gap_info) {
+            p = s_PutUint(p, hsp->gap_info->size);
+            for (j = 0; j < hsp->gap_info->size; j++) {
+                p = s_PutUint(p, hsp->gap_info->op_type[j]);
+                p = s_PutInt(p, hsp->gap_info->num[j]);
+            }
+        }
+        if (hsp->pat_info) {
+            p = s_PutInt(p, hsp->pat_info->index);
+            p = s_PutInt(p, hsp->pat_info->length);
+        }
+    }
+    return (Int4) (p - spill->buffer);
+}
+
+/** Decode an HSP list encoded by s_EncodeHSPList
+ * @param buffer The encoded HSP list [in]
+ * @return the HSP list, or NULL if out of memory
+ */
+static BlastHSPList* s_DecodeHSPList(const Uint1* buffer)
+{
+    const Uint1* p = buffer;
+    Int4 i, j;
+    Int4 hspcnt = (Int4) s_GetUint(&p);
+    BlastHSPList* hsp_list = Blast_HSPListNew(0);
+
+    if (!hsp_list)
+        return NULL;
+
+    hsp_list->oid = s_GetInt(&p);
+    hsp_list->query_index = s_GetInt(&p);
+    hsp_list->hsp_max = s_GetInt(&p);
+    hsp_list->do_not_reallocate = (Boolean) s_GetUint(&p);
+    hsp_list->best_evalue = s_GetDouble(&p);
+
+    if (hspcnt > hsp_list->allocated) {
+        BlastHSP** hsp_array = (BlastHSP**)
+            realloc(hsp_list->hsp_array, hspcnt * sizeof(BlastHSP*));
+        if (!hsp_array)
+            return Blast_HSPListFree(hsp_list);
+        hsp_list->hsp_array = hsp_array;
+        hsp_list->allocated = hspcnt;
+    }
+
+    /* the HSPs are stored as they were, so that their order is kept */
+    for (i = 0; i < hspcnt; i++) {
+        Uint4 flags;
+        BlastHSP* hsp = Blast_HSPNew();
+        if (!hsp)
+            return Blast_HSPListFree(hsp_list);
+        hsp_list->hsp_array[hsp_list->hspcnt++] = hsp;
+
+        hsp->score = s_GetInt(&p);
+        hsp->num_ident = s_GetInt(&p);
+        hsp->bit_score = s_GetDouble(&p);
+        hsp->evalue = s_GetDouble(&p);
+        s_GetSeg(&p, &hsp->query);
+        s_GetSeg(&p, &hsp->subject);
+        hsp->context = s_GetInt(&p);
+        hsp->num = s_GetInt(&p);
+        hsp->comp_adjustment_method = (Int2) s_GetInt(&p);
+        hsp->num_positives = s_GetInt(&p);
+        flags = s_GetUint(&p);
+        if (flags & 1) {
+            Int4 size = (Int4) s_GetUint(&p);
+            hsp->gap_info = GapEditScriptNew(size);
+            if (!hsp->gap_info)
+                return Blast_HSPListFree(hsp_list);
+            for (j = 0; j < size; j++) {
+                hsp->gap_info->op_type[j] = (EGapAlignOpType) s_GetUint(&p);
+                hsp->gap_info->num[j] = s_GetInt(&p);
+            }
+        }
+        if (flags & 2) {
+            hsp->pat_info = (SPHIHspInfo*) malloc(sizeof(SPHIHspInfo));
+            if (!hsp->pat_info)
+                return Blast_HSPListFree(hsp_list);
+            hsp->pat_info->index = s_GetInt(&p);
+            hsp->pat_info->length = s_GetInt(&p);
+        }
+    }
+    return hsp_list;
+}
+
+/** Take all the HSP lists saved in the results of a stream for a new run,
+ * and empty the hit lists of the results. Called with the lock of the stream
+ * held.
+ * @param hsp_stream The stream [in] [out]
+ * @param run_lists_out Index entries of the HSP lists taken, to be freed by
+ *                      the caller [out]
+ * @param num_lists_out Number of HSP lists taken [out]
+ * @return 0 on success, -1 on error
+ */
+static int s_SpillTake(BlastHSPStream* hsp_stream,
+                       SSpilledHSPList** run_lists_out, Int4* num_lists_out)
+{
+    struct BlastHSPStreamSpill* spill = hsp_stream->spill;
+    BlastHSPResults* results = hsp_stream->results;
+    SSpilledHSPList* run_lists;
+    Int4 i, j, num_lists = 0;
+
+    *run_lists_out = NULL;
+    *num_lists_out = 0;
+    for (i = 0; i < results->num_queries; i++) {
+        if (results->hitlist_array[i])
+            num_lists += results->hitlist_array[i]->hsplist_count;
+    }
+    spill->bytes = 0;
+    if (num_lists == 0)
+        return 0;
+
+    run_lists = (SSpilledHSPList*) malloc(num_lists * sizeof(SSpilledHSPList));
+    if (!run_lists)
+        return -1;
+
+    /* move the HSP lists out of the hit lists; empty lists are dropped */
+    num_lists = 0;
+    for (i = 0; i < results->num_queries; i++) {
+        BlastHitList* hitlist = results->hitlist_array[i];
+        if (!hitlist)
+            continue;
+
+        for (j = 0; j < hitlist->hsplist_count; j++) {
+            BlastHSPList* hsp_list = hitlist->hsplist_array[j];
+            SSpilledHSPList* entry = run_lists + num_lists;
+
+            if (!hsp_list)
+                continue;
+            if (hsp_list->hspcnt == 0) {
+                Blast_HSPListFree(hsp_list);
+                continue;
+            }
+            hsp_list->query_index = i;
+            entry->query_index = i;
+            entry->oid = hsp_list->oid;
+            entry->size = 0;
+            entry->keep = TRUE;
+            entry->hsp_list = hsp_list;
+            num_lists++;
+        }
+
+        /* the hit list starts over as if it were new */
+        hitlist->hsplist_count = 0;
+        hitlist->heapified = FALSE;
+        hitlist->worst_evalue = 0;
+        hitlist->low_score = INT4_MAX;
+    }
+
+    if (num_lists == 0) {
+        sfree(run_lists);
+        return 0;
+    }
+    *run_lists_out = run_lists;
+    *num_lists_out = num_lists;
+    return 0;
+}
+
+/** Sort the HSP lists taken for a run and append them to the temporary file
+ * of a stream, freeing them. Only one thread writes a run at a time, and it
+ * does not need to hold the lock of the stream.
+ * @param spill The spill of the stream [in] [out]
+ * @param run_lists Index entries of the HSP lists of the run [in] [out]
+ * @param num_lists Number of HSP lists in the run [in]
+ * @return 0 on success, -1 on error
+ */
+static int s_SpillWrite(struct BlastHSPStreamSpill* spill,
+                        SSpilledHSPList* run_lists, Int4 num_lists)
+{
+    Int4 i;
+
+    for (i = 0; i < num_lists; i++) {
+        SSpilledHSPList* entry = run_lists + i;
+        /* the collector sorts the HSPs of a list by e-value once the
+           hit list is full, and ranks lists by their first HSP */
+        Blast_HSPListSortByEvalue(entry->hsp_list);
+        entry->best_evalue = entry->hsp_list->best_evalue;
+        entry->best_score = entry->hsp_list->hsp_array[0]->score;
+    }
+    qsort(run_lists, num_lists, sizeof(SSpilledHSPList),
+          spill->by_score ? s_SortSpilledByScore : s_SortSpilledByOid);
+
+    /* the file is only written to while the stream is open for writing,
+       so its position stays at its end */
+    if (!spill->file)
+        spill->file = tmpfile();
+    for (i = 0; i < num_lists; i++) {
+        SSpilledHSPList* entry = run_lists + i;
+        Int4 size = spill->file ? s_EncodeHSPList(spill, entry->hsp_list) : -1;
+        if (size < 0 ||
+            fwrite(spill->buffer, 1, size, spill->file) != (size_t)size) {
+            spill->failed = TRUE;
+        }
+        entry->offset = spill->file_size;
+        entry->size = size;
+        spill->file_size += size;
+        entry->hsp_list = Blast_HSPListFree(entry->hsp_list);
+    }
+    if (spill->failed || fflush(spill->file) != 0) {
+        spill->failed = TRUE;
+        return -1;
+    }
+    return 0;
+}
+
+/** Add the index entries of a run written to the temporary file to the index
+ * of a stream. Called with the lock of the stream held.
+ * @param spill The spill of the stream [in] [out]
+ * @param run_lists Index entries of the HSP lists of the run [in]
+ * @param num_lists Number of HSP lists in the run [in]
+ * @return 0 on success, -1 on error
+ */
+static int s_SpillPublish(struct BlastHSPStreamSpill* spill,
+                          const SSpilledHSPList* run_lists, Int4 num_lists)
+{
+    if (spill->num_lists + num_lists > spill->num_lists_alloc) {
+        Int4 alloc = MAX(spill->num_lists + num_lists,
+                         2 * spill->num_lists_alloc);
+        SSpilledHSPList* lists = (SSpilledHSPList*)
+            realloc(spill->lists, alloc * sizeof(SSpilledHSPList));
+        if (!lists) {
+            spill->failed = TRUE;
+            return -1;
+        }
+        spill->lists = lists;
+        spill->num_lists_alloc = alloc;
+    }
+    if ((spill->num_runs & (spill->num_runs - 1)) == 0) {
+        /* grow the array of runs when its size is a power of 2 */
+        Int4 alloc = 2 * MAX(spill->num_runs, 1);
+        Int4* run_end = (Int4*)
+            realloc(spill->run_end, alloc * sizeof(Int4));
+        if (!run_end) {
+            spill->failed = TRUE;
+            return -1;
+        }
+        spill->run_end = run_end;
+    }
+
+    memcpy(spill->lists + spill->num_lists, run_lists,
+           num_lists * sizeof(SSpilledHSPList));
+    spill->num_lists += num_lists;
+    spill->run_end[spill->num_runs++] = spill->num_lists;
+    return 0;
+}
+
+/** Write all the HSP lists saved in the results of a stream to a new run,
+ * and empty the hit lists of the results. Used once no other thread writes
+ * to the stream.
+ * @param hsp_stream The stream [in] [out]
+ * @return 0 on success, -1 on error
+ */
+static int s_SpillRun(BlastHSPStream* hsp_stream)
+{
+    SSpilledHSPList* run_lists = NULL;
+    Int4 num_lists = 0;
+    int status;
+
+    status = s_SpillTake(hsp_stream, &run_lists, &num_lists);
+    if (status == 0 && num_lists > 0) {
+        status = s_SpillWrite(hsp_stream->spill, run_lists, num_lists);
+        if (status == 0)
+            status = s_SpillPublish(hsp_stream->spill, run_lists, num_lists);
+    }
+    sfree(run_lists);
+    return status;
+}
+
+/** Account for an HSP list written to a stream with a memory limit, and
+ * take the saved HSP lists for a new run if the limit is exceeded. Called
+ * with the lock of the stream held; the caller writes the run with
+ * s_SpillWrite after releasing the lock, then publishes it with
+ * s_SpillPublish.
+ * @param hsp_stream The stream [in] [out]
+ * @param bytes Estimated memory of the HSP list written [in]
+ * @param run_lists_out Index entries of the HSP lists taken [out]
+ * @param num_lists_out Number of HSP lists taken [out]
+ * @return 0 on success, -1 on error
+ */
+static int s_SpillUpdate(BlastHSPStream* hsp_stream, Int8 bytes,
+                         SSpilledHSPList** run_lists_out,
+                         Int4* num_lists_out)
+{
+    struct BlastHSPStreamSpill* spill = hsp_stream->spill;
+    int status;
+
+    *run_lists_out = NULL;
+    *num_lists_out = 0;
+    spill->bytes += bytes;
+    if (spill->bytes <= spill->max_bytes)
+        return 0;
+
+    /* Another thread is writing a run; the HSP lists saved meanwhile go
+       to the next one */
+    if (spill->writing)
+        return 0;
+
+    /* The estimate only grows, while the collector frees the HSP lists it
+       discards; spill only when the lists actually saved are large enough
+       to make the run worthwhile */
+    spill->bytes = s_HSPResultsMemory(hsp_stream->results);
+    if (spill->bytes <= spill->max_bytes / 2)
+        return 0;
+    status = s_SpillTake(hsp_stream, run_lists_out, num_lists_out);
+    if (*num_lists_out > 0)
+        spill->writing = TRUE;
+    return status;
+}
+
+/** Has a stream written HSP lists to temporary files?
+ * @param hsp_stream The stream [in]
+ * @return TRUE if the stream is read from its temporary files
+ */
+static Boolean s_IsSpilled(const BlastHSPStream* hsp_stream)
+{
+    return (hsp_stream->spill && hsp_stream->spill->num_runs > 0) ?
+           TRUE : FALSE;
+}
+
+/** Compare the next HSP lists of two runs
+ * @param spill The spill [in]
+ * @param run1 First run [in]
+ * @param run2 Second run [in]
+ * @return TRUE if the next HSP list of run1 is read first
+ */
+static Boolean s_SpillRunLess(const struct BlastHSPStreamSpill* spill,
+                              Int4 run1, Int4 run2)
+{
+    int retval = s_SpilledHSPListCompare(spill->lists + spill->run_next[run1],
+                                         spill->lists + spill->run_next[run2],
+                                         spill->by_score);
+    return (retval < 0 || (retval == 0 && run1 < run2)) ? TRUE : FALSE;
+}
+
+/** Restore the heap of runs after its first element changed
+ * @param spill The spill [in] [out]
+ */
+static void s_SpillHeapDown(struct BlastHSPStreamSpill* spill)
+{
+    Int4* heap = spill->heap;
+    Int4 i = 0;
+
+    for (;;) {
+        Int4 child = 2 * i + 1, tmp;
+        if (child >= spill->heap_size)
+            break;
+        if (child + 1 < spill->heap_size &&
+            s_SpillRunLess(spill, heap[child + 1], heap[child]))
+            child++;
+        if (!s_SpillRunLess(spill, heap[child], heap[i]))
+            break;
+        tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
+        i = child;
+    }
+}
+
+/** Move past the next HSP list of the first run of the heap
+ * @param spill The spill [in] [out]
+ */
+static void s_SpillAdvance(struct BlastHSPStreamSpill* spill)
+{
+    Int4 run = spill->heap[0];
+
+    if (++spill->run_next[run] == spill->run_end[run])
+        spill->heap[0] = spill->heap[--spill->heap_size];
+    s_SpillHeapDown(spill);
+}
+
+/** Find the next HSP list to read, skipping the discarded ones
+ * @param spill The spill [in] [out]
+ * @return index of the HSP list in spill->lists, -1 if none are left
+ */
+static Int4 s_SpillPeek(struct BlastHSPStreamSpill* spill)
+{
+    while (spill->heap_size > 0) {
+        Int4 index = spill->run_next[spill->heap[0]];
+        if (spill->lists[index].keep)
+            return index;
+        s_SpillAdvance(spill);
+    }
+    return -1;
+}
+
+/** Position a temporary file, with offsets beyond 2 GB where the platform
+ * supports them
+ * @param file The file [in]
+ * @param offset Offset from the start of the file [in]
+ * @return 0 on success
+ */
+static int s_SpillSeek(FILE* file, Int8 offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, offset, SEEK_SET);
+#elif defined(HAVE_FSEEKO)
+    return fseeko(file, (off_t) offset, SEEK_SET);
+#else
+    return fseek(file, (long) offset, SEEK_SET);
+#endif
+}
+
+/** Read the next HSP list of a spilled stream
+ * @param hsp_stream The stream [in] [out]
+ * @param hsp_list_out The HSP list read [out]
+ * @return Success, error, or end of reading, when nothing left to read.
+ */
+static int s_SpillRead(BlastHSPStream* hsp_stream,
+                       BlastHSPList** hsp_list_out)
+{
+    struct BlastHSPStreamSpill* spill = hsp_stream->spill;
+    Int4 index = s_SpillPeek(spill);
+    Int4 size;
+
+    if (spill->failed)
+        return kBlastHSPStream_Error;
+    if (index < 0)
+        return kBlastHSPStream_Eof;
+
+    size = spill->lists[index].size;
+    if (s_SpillReserve(spill, size) != 0 ||
+        s_SpillSeek(spill->file, spill->lists[index].offset) != 0 ||
+        fread(spill->buffer, 1, size, spill->file) != (size_t)size ||
+        (*hsp_list_out = s_DecodeHSPList(spill->buffer)) == NULL) {
+        spill->failed = TRUE;
+        return kBlastHSPStream_Error;
+    }
+    s_SpillAdvance(spill);
+    --hsp_stream->num_hsplists;
+    return kBlastHSPStream_Success;
+}
+
+/** Write the HSP lists left in memory to a last run, select the best HSP
+ * lists of each query and prepare the runs for reading.
+ * @param hsp_stream The stream [in] [out]
+ */
+static void s_SpillClose(BlastHSPStream* hsp_stream)
+{
+    struct BlastHSPStreamSpill* spill = hsp_stream->spill;
+    BlastHSPResults* results = hsp_stream->results;
+    SSpilledHSPList** ranked = NULL;
+    Int4 i, run, num_kept = 0;
+
+    hsp_stream->num_hsplists = 0;
+    if (s_SpillRun(hsp_stream) != 0 || spill->failed)
+        return;
+
+    /* Keep as many HSP lists per query as its hit list allows, choosing
+       them as Blast_HitListUpdate would have if they had all been in
+       memory */
+    ranked = (SSpilledHSPList**)
+        malloc(MAX(spill->num_lists, 1) * sizeof(SSpilledHSPList*));
+    spill->run_next = (Int4*) calloc(spill->num_runs, sizeof(Int4));
+    spill->heap = (Int4*) calloc(spill->num_runs, sizeof(Int4));
+    if (!ranked || !spill->run_next || !spill->heap) {
+        sfree(ranked);
+        spill->failed = TRUE;
+        return;
+    }
+    for (i = 0; i < spill->num_lists; i++)
+        ranked[i] = spill->lists + i;
+    qsort(ranked, spill->num_lists, sizeof(SSpilledHSPList*),
+          s_SortSpilledPtrByScore);
+    for (i = 0; i < spill->num_lists; ) {
+        Int4 query_index = ranked[i]->query_index;
+        const BlastHitList* hitlist = results->hitlist_array[query_index];
+        Int4 hsplist_max = hitlist ? hitlist->hsplist_max : INT4_MAX;
+        Int4 count;
+
+        for (count = 0; i < spill->num_lists &&
+                        ranked[i]->query_index == query_index; i++, count++) {
+            ranked[i]->keep = (count < hsplist_max) ? TRUE : FALSE;
+            if (ranked[i]->keep)
+                num_kept++;
+        }
+    }
+    sfree(ranked);
+
+    /* The runs are merged through a heap ordered by their next HSP list */
+    for (run = 0; run < spill->num_runs; run++) {
+        Int4 child = spill->heap_size++;
+        spill->run_next[run] = run ? spill->run_end[run - 1] : 0;
+        /* sift the run up the heap */
+        spill->heap[child] = run;
+        while (child > 0) {
+            Int4 parent = (child - 1) / 2;
+            if (!s_SpillRunLess(spill, spill->heap[child],
+                                spill->heap[parent]))
+                break;
+            spill->heap[child] = spill->heap[parent];
+            spill->heap[parent] = run;
+            child = parent;
+        }
+    }
+    hsp_stream->num_hsplists = num_kept;
+}
+
+/** Free the temporary files of a stream and their index
+ * @param spill The spill to free [in]
+ * @return NULL
+ */
+static struct BlastHSPStreamSpill*
+s_SpillFree(struct BlastHSPStreamSpill* spill)
+{
+    if (!spill)
+        return NULL;
+
+    if (spill->file)
+        fclose(spill->file);
+    sfree(spill->lists);
+    sfree(spill->run_next);
+    sfree(spill->run_end);
+    sfree(spill->heap);
+    sfree(spill->buffer);
+    sfree(spill);
+    return NULL;
+}
+
 /** Default hit saving stream methods */
 
 /** Free the BlastHSPStream with its HSP list collector data structure.
@@ -58,11 +901,14 @@ BlastHSPStream* BlastHSPStreamFree(BlastHSPStream* hsp_stream)
 
    hsp_stream->x_lock = MT_LOCK_Delete(hsp_stream->x_lock);
    Blast_HSPResultsFree(hsp_stream->results);
-   for (index=0; index < hsp_stream->num_hsplists; index++)
+   /* HSP lists of a spilled stream are in its temporary files */
+   for (index=0; !s_IsSpilled(hsp_stream) && index < hsp_stream->num_hsplists;
+        index++)
    {
         hsp_stream->sorted_hsplists[index] =
             Blast_HSPListFree(hsp_stream->sorted_hsplists[index]);
    }
+   hsp_stream->spill = s_SpillFree(hsp_stream->spill);
    sfree(hsp_stream->sort_by_score);
    sfree(hsp_stream->sorted_hsplists);
    
@@ -145,6 +991,13 @@ void BlastHSPStreamClose(BlastHSPStream* hsp_stream)
 
    s_FinalizeWriter(hsp_stream);
 
+   if (s_IsSpilled(hsp_stream)) {
+       s_SpillClose(hsp_stream);
+       hsp_stream->results_sorted = TRUE;
+       hsp_stream->x_lock = MT_LOCK_Delete(hsp_stream->x_lock);
+       return;
+   }
+
    if (hsp_stream->sort_by_score) {
        if (hsp_stream->sort_by_score->sort_on_read) {
            Blast_HSPResultsReverseSort(hsp_stream->results);
@@ -263,6 +1116,9 @@ int BlastHSPStreamRead(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list_out)
    if (!hsp_stream->results_sorted)
        BlastHSPStreamClose(hsp_stream);
 
+   if (s_IsSpilled(hsp_stream))
+       return s_SpillRead(hsp_stream, hsp_list_out);
+
    if (hsp_stream->sort_by_score) {
        Int4 last_hsplist_index = -1, index = 0;
        BlastHitList* hit_list = NULL;
@@ -316,6 +1172,9 @@ int BlastHSPStreamRead(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list_out)
 int BlastHSPStreamWrite(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list)
 {
    Int2 status = 0;
+   Int8 bytes = 0;
+   SSpilledHSPList* run_lists = NULL;
+   Int4 num_lists = 0;
 
    if (!hsp_stream) 
       return kBlastHSPStream_Error;
@@ -333,6 +1192,10 @@ int BlastHSPStreamWrite(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list)
       return kBlastHSPStream_Error;
    }
 
+   /* the writer may free the HSP list, so its memory is estimated first */
+   if (hsp_stream->spill)
+      bytes = s_HSPListMemory(*hsp_list);
+
    if (hsp_stream->writer) { 
        /** if writer has not been initialized, initialize it first */
       if (!(hsp_stream->writer_initialized)) {
@@ -358,9 +1221,33 @@ int BlastHSPStreamWrite(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list)
    /* Free the caller from this pointer's ownership. */
    *hsp_list = NULL;
 
+   /* Take the HSP lists out to save them to a temporary file if they take
+      too much memory */
+   if (hsp_stream->spill &&
+       s_SpillUpdate(hsp_stream, bytes, &run_lists, &num_lists) != 0) {
+      MT_LOCK_Do(hsp_stream->x_lock, eMT_Unlock);
+      return kBlastHSPStream_Error;
+   }
+
    /** Unlock the mutex */
    MT_LOCK_Do(hsp_stream->x_lock, eMT_Unlock);
 
+   /* Writing the run does not hold up the other threads writing to the
+      stream */
+   if (num_lists > 0) {
+      status = s_SpillWrite(hsp_stream->spill, run_lists, num_lists);
+
+      MT_LOCK_Do(hsp_stream->x_lock, eMT_Lock);
+      if (status == 0)
+         status = s_SpillPublish(hsp_stream->spill, run_lists, num_lists);
+      hsp_stream->spill->writing = FALSE;
+      MT_LOCK_Do(hsp_stream->x_lock, eMT_Unlock);
+
+      sfree(run_lists);
+      if (status != 0)
+         return kBlastHSPStream_Error;
+   }
+
    return kBlastHSPStream_Success;
 }
 
@@ -394,6 +1281,10 @@ int BlastHSPStreamMerge(SSplitQueryBlk *squery_blk,
    if (!stream1 || !stream2) 
        return kBlastHSPStream_Error;
 
+   /* merging works on HSP lists in memory */
+   if (s_IsSpilled(stream1) || s_IsSpilled(stream2))
+       return kBlastHSPStream_Error;
+
    s_FinalizeWriter(stream1);
    s_FinalizeWriter(stream2);
 
@@ -572,6 +1463,31 @@ int BlastHSPStreamBatchRead(BlastHSPStream* hsp_stream,
    if (!hsp_stream->results)
       return kBlastHSPStream_Eof;
 
+   if (s_IsSpilled(hsp_stream)) {
+      struct BlastHSPStreamSpill* spill = hsp_stream->spill;
+      int status = s_SpillRead(hsp_stream, &hsplist);
+      Int4 index;
+
+      if (status != kBlastHSPStream_Success)
+         return status;
+
+      /* the runs are merged in OID order, so the HSP lists of a subject
+         are read one after another */
+      batch->hsplist_array[batch->num_hsplists++] = hsplist;
+      target_oid = hsplist->oid;
+      while ((index = s_SpillPeek(spill)) >= 0 &&
+             spill->lists[index].oid == target_oid) {
+         if (s_SpillRead(hsp_stream, &hsplist) != kBlastHSPStream_Success)
+            break;
+         batch->hsplist_array[batch->num_hsplists++] = hsplist;
+      }
+      if (spill->failed) {
+         Blast_HSPStreamResultBatchReset(batch);
+         return kBlastHSPStream_Error;
+      }
+      return kBlastHSPStream_Success;
+   }
+
    /* return all the HSPlists with the same subject OID as the
       last HSPList in the collection stored. We assume there is
       at most one HSPList per query sequence */
@@ -666,10 +1582,38 @@ BlastHSPStreamNew(EBlastProgramType program,
     hsp_stream->writer_finalized = FALSE;
     hsp_stream->pre_pipe = NULL;
     hsp_stream->tback_pipe = NULL;
+    hsp_stream->spill = NULL;
 
     return hsp_stream;
 }
 
+int BlastHSPStreamSetMemoryLimit(BlastHSPStream* hsp_stream, Int8 max_bytes)
+{
+    struct BlastHSPStreamSpill* spill;
+
+    /* the limit must be set before anything is written; HSP lists read in
+       the order they were written cannot be sorted into runs */
+    if (!hsp_stream || hsp_stream->writer_initialized ||
+        hsp_stream->results_sorted ||
+        (hsp_stream->sort_by_score &&
+         !hsp_stream->sort_by_score->sort_on_read)) {
+        return -1;
+    }
+
+    hsp_stream->spill = s_SpillFree(hsp_stream->spill);
+    if (max_bytes <= 0)
+        return 0;
+
+    spill = (struct BlastHSPStreamSpill*)
+        calloc(1, sizeof(struct BlastHSPStreamSpill));
+    if (!spill)
+        return -1;
+    spill->max_bytes = max_bytes;
+    spill->by_score = hsp_stream->sort_by_score ? TRUE : FALSE;
+    hsp_stream->spill = spill;
+    return 0;
+}
+
 int BlastHSPStreamRegisterMTLock(BlastHSPStream* hsp_stream,
                                  MT_LOCK lock)
 {
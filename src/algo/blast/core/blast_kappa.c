@@ -47,6 +47,7 @@ static char const rcsid[] =
 #include <algo/blast/core/blast_traceback.h>
 #include <algo/blast/core/link_hsps.h>
 #include <algo/blast/core/gencode_singleton.h>
+#include <algo/blast/core/blast_simd.h>
 #include "blast_psi_priv.h"
 #include "blast_gapalign_priv.h"
 #include "blast_hits_priv.h"
@@ -1891,14 +1892,18 @@ redo_align_callbacks = {
 /** 
  * Read the parameters required for the Blast_RedoOneMatch* functions from
  * the corresponding parameters in standard BLAST datatypes.  Return a new
- * object representing these parameters.
+ * object representing these parameters.  If shared_matrix_info is not
+ * NULL, the new object refers to it instead of computing its own; the
+ * caller must then set the matrix_info field of the object to NULL
+ * before freeing it.
  */
 static Blast_RedoAlignParams *
 s_GetAlignParams(BlastKappa_GappingParamsContext * context,
                  BLAST_SequenceBlk * queryBlk,
                  BlastQueryInfo* queryInfo,
                  const BlastHitSavingParameters* hitParams,
-                 const BlastExtensionParameters* extendParams)
+                 const BlastExtensionParameters* extendParams,
+                 Blast_MatrixInfo * shared_matrix_info)
 {
     int status = 0;    /* status code */
     int rows;          /* number of rows in the scoring matrix */
@@ -1928,26 +1933,34 @@ s_GetAlignParams(BlastKappa_GappingParamsContext * context,
         cutoff_s = 1;
     }
     cutoff_e = hitParams->options->expect_value;
-    rows = positionBased ? queryInfo->max_length : BLASTAA_SIZE;
-    scaledMatrixInfo = Blast_MatrixInfoNew(rows, BLASTAA_SIZE, positionBased);
-    status = s_MatrixInfoInit(scaledMatrixInfo, queryBlk, context->sbp,
-                              context->localScalingFactor,
-                              context->scoringParams->options->matrix);
-    if (status != 0) {
-        return NULL;
+    if (shared_matrix_info != NULL) {
+        scaledMatrixInfo = shared_matrix_info;
+    } else {
+        rows = positionBased ? queryInfo->max_length : BLASTAA_SIZE;
+        scaledMatrixInfo =
+            Blast_MatrixInfoNew(rows, BLASTAA_SIZE, positionBased);
+        status = s_MatrixInfoInit(scaledMatrixInfo, queryBlk, context->sbp,
+                                  context->localScalingFactor,
+                                  context->scoringParams->options->matrix);
+        if (status != 0) {
+            return NULL;
+        }
     }
     gapping_params = s_GappingParamsNew(context, extendParams,
                                         queryInfo->last_context + 1);
     if (gapping_params == NULL) {
         return NULL;
     } else {
-        return
+        Blast_RedoAlignParams * params =
             Blast_RedoAlignParamsNew(&scaledMatrixInfo, &gapping_params,
                                      compo_adjust_mode, positionBased,
                                      query_is_translated,
                                      subject_is_translated,
                                      queryInfo->max_length, cutoff_s, cutoff_e,
                                      do_link_hsps, &redo_align_callbacks);
+        if (params != NULL)
+            params->vector_level = BlastSimd_GetLevel();
+        return params;
     }
 }
 
@@ -1995,89 +2008,123 @@ static void s_ClearHeap(BlastCompo_Heap * self)
     }
 }
 
+
 extern void
 BLAST_SetupPartialFetching(EBlastProgramType program_number,
                            BlastSeqSrc* seq_src, 
                            const BlastHSPList** hsp_list,
                            Int4 num_hsplists);
 
+
 /**
- *  Recompute alignments for each match found by the gapped BLAST
- *  algorithm.
+ * The parameters of a search whose alignments are redone by
+ * Blast_RedoAlignmentCore, set up once and shared by every thread that
+ * redoes alignments for the search.
  */
-Int2
-Blast_RedoAlignmentCore(EBlastProgramType program_number,
-                        BLAST_SequenceBlk * queryBlk,
-                        BlastQueryInfo* queryInfo,
-                        BlastScoreBlk* sbp,
-                        BLAST_SequenceBlk * subjectBlk,
-                        const BlastSeqSrc* seqSrc,
-                        Int4 default_db_genetic_code,
-                        BlastHSPList * thisMatch,
-                        BlastHSPStream* hsp_stream,
-                        BlastScoringParameters* scoringParams,
-                        const BlastExtensionParameters* extendParams,
-                        const BlastHitSavingParameters* hitParams,
-                        const PSIBlastOptions* psiOptions,
-                        BlastHSPResults* results)
-{
-    int status_code = 0;                    /* return value code */
-    /* the factor by which to scale the scoring system in order to
-     * obtain greater precision */
-    double localScalingFactor;
-    /* the values of the search parameters that will be recorded, altered
-     * in the search structure in this routine, and then restored before
-     * the routine exits. */
-    BlastKappa_SavedParameters *savedParams = NULL;
-    /* forbidden ranges for each database position (used in
-     * Smith-Waterman alignments) */
-    Blast_ForbiddenRanges forbidden = {0,};
-    /* a collection of alignments for each query sequence with
+typedef struct BlastKappa_RedoSearch {
+    EBlastProgramType program_number;   /**< the type of search */
+    BLAST_SequenceBlk * queryBlk;       /**< the query sequence */
+    BlastQueryInfo * queryInfo;         /**< information about the query */
+    BlastScoreBlk * sbp;                /**< score block of the search */
+    BlastScoringParameters * scoringParams;  /**< scoring parameters */
+    const BlastExtensionParameters * extendParams; /**< extension
+                                                        parameters */
+    const BlastHitSavingParameters * hitParams;  /**< hit saving
+                                                      parameters */
+    Uint1 * genetic_code_string;   /**< genetic code of the database */
+    double localScalingFactor;     /**< the factor by which the scoring
+                                        system is scaled in order to obtain
+                                        greater precision */
+    ECompoAdjustModes compo_adjust_mode;  /**< composition adjustment mode */
+    Boolean positionBased;         /**< is the search position-based */
+    Boolean smithWaterman;         /**< are Smith-Waterman alignments
+                                        computed */
+    int compositionTestIndex;      /**< which test function is used to see
+                                        if a composition-adjusted p-value
+                                        is desired */
+    int numQueries;                /**< number of queries in the
+                                        concatenated query */
+    int numContexts;               /**< number of contexts in the
+                                        concatenated query */
+    int numFrames;                 /**< number of contexts per query */
+    /** the values of the search parameters that are altered in sbp and
+     * scoringParams, to be restored when the search is done; NULL if
+     * nothing has been altered */
+    BlastKappa_SavedParameters * savedParams;
+    /** a collection of alignments for each query sequence with
      * sequences from the database */
-    BlastCompo_Heap * redoneMatches = NULL;
-    /* stores all fields needed for computing a compositionally
+    BlastCompo_Heap * redoneMatches;
+} BlastKappa_RedoSearch;
+
+
+/**
+ * The scoring matrix, alignment structures and work arrays used by one
+ * thread to redo alignments.
+ */
+typedef struct BlastKappa_RedoThread {
+    /** score block whose matrix is adjusted for each match; either the
+     * score block of the search or a copy (see s_ScoreBlkThreadCopy) */
+    BlastScoreBlk * sbp;
+    Boolean owns_sbp;              /**< was sbp copied for this thread */
+    Int4 ** matrix;                /**< the matrix of sbp */
+    BlastGapAlignStruct * gapAlign;  /**< gapped alignment structure */
+    /** context of the callbacks that compute gapped alignments */
+    BlastKappa_GappingParamsContext gapping_params_context;
+    Blast_RedoAlignParams * redo_align_params; /**< parameters of the
+                                                    Blast_RedoOneMatch*
+                                                    routines */
+    Boolean shares_matrix_info;    /**< does redo_align_params refer to the
+                                        matrix information of another
+                                        thread */
+    BlastCompo_QueryInfo * query_info;  /**< information about the
+                                             queries */
+    /** stores all fields needed for computing a compositionally
      * adjusted score matrix using Newton's method */
-    Blast_CompositionWorkspace *NRrecord = NULL;
-    /* loop index */
-    int query_index;
-    /* context number */
-    int context_index;
-    /* frame number */
-    int frame_index;
-    /* number of queries in the concatenated query */
-    int numQueries = queryInfo->num_queries;
-    /* number of contexts in the concatenated query */
-    int numContexts = queryInfo->last_context + 1;
-    /* number of contexts within a query */
-    int numFrames = (program_number == eBlastTypeBlastx) ? 6:1;
-    /* keeps track of gapped alignment params */
-    BlastGapAlignStruct* gapAlign = NULL;
+    Blast_CompositionWorkspace * NRrecord;
+    /** forbidden ranges for each database position (used in
+     * Smith-Waterman alignments) */
+    Blast_ForbiddenRanges forbidden;
+    /** array of lists of alignments for each query to this subject */
+    BlastCompo_Alignment ** alignments;
+    /** existing alignments for a match, for each frame */
+    BlastCompo_Alignment ** incoming_align_set;
+    /** p-value for the last match for composition; -1 == no adjustment */
+    double pvalueForThisPair;
+    double LambdaRatio;            /**< lambda ratio of the last match */
+} BlastKappa_RedoThread;
+
+
+/**
+ * Check the parameters of a search whose alignments are to be redone,
+ * and rescale the scoring system of the search.  The parameters
+ * following search are those of Blast_RedoAlignmentCore.
+ *
+ * @param search     the search to set up; must be zero-filled [out]
+ * @return 0 on success, -1 on failure
+ */
+static int
+s_RedoSearchInit(BlastKappa_RedoSearch * search,
+                 EBlastProgramType program_number,
+                 BLAST_SequenceBlk * queryBlk,
+                 BlastQueryInfo* queryInfo,
+                 BlastScoreBlk* sbp,
+                 Int4 default_db_genetic_code,
+                 BlastScoringParameters* scoringParams,
+                 const BlastExtensionParameters* extendParams,
+                 const BlastHitSavingParameters* hitParams,
+                 const PSIBlastOptions* psiOptions)
+{
+    int status_code = 0;        /* return value code */
+    int query_index;            /* loop index */
+    Int4 ** matrix;             /* score matrix */
     /* All alignments above this value will be reported, no matter how
      * many. */
     double inclusion_ethresh;
-    /* array of lists of alignments for each query to this subject */
-    BlastCompo_Alignment ** alignments = NULL;
-
-    BlastCompo_QueryInfo * query_info = NULL;
-    Blast_RedoAlignParams * redo_align_params = NULL;
+    BlastKappa_SavedParameters * savedParams = NULL;
     Boolean positionBased = (Boolean) (sbp->psi_matrix != NULL);
     ECompoAdjustModes compo_adjust_mode =
         (ECompoAdjustModes) extendParams->options->compositionBasedStats;
-    Boolean smithWaterman =
-        (Boolean) (extendParams->options->eTbackExt == eSmithWatermanTbck);
-    /* existing alignments for a match */
-    BlastCompo_Alignment ** incoming_align_set = NULL;
-    BlastCompo_Alignment * incoming_aligns = NULL;
-    Int4      **matrix;                   /* score matrix */
-    BlastKappa_GappingParamsContext gapping_params_context;
-
-    double pvalueForThisPair = (-1); /* p-value for this match
-                                        for composition; -1 == no adjustment*/
-    double LambdaRatio; /*lambda ratio*/
-    /* which test function do we use to see if a composition-adjusted
-       p-value is desired; value needs to be passed in eventually*/
-    int compositionTestIndex = extendParams->options->unifiedP;
-    Uint1* genetic_code_string = GenCodeSingletonFind(default_db_genetic_code);
+    int numContexts = queryInfo->last_context + 1;
 
     ASSERT(program_number == eBlastTypeBlastp   ||
            program_number == eBlastTypeTblastn  ||
@@ -2120,104 +2167,596 @@ Blast_RedoAlignmentCore(EBlastProgramType program_number,
                          : PSI_INCLUSION_ETHRESH);
     ASSERT(inclusion_ethresh != 0.0);
 
+    search->program_number = program_number;
+    search->queryBlk = queryBlk;
+    search->queryInfo = queryInfo;
+    search->sbp = sbp;
+    search->scoringParams = scoringParams;
+    search->extendParams = extendParams;
+    search->hitParams = hitParams;
+    search->genetic_code_string =
+        GenCodeSingletonFind(default_db_genetic_code);
+    search->compo_adjust_mode = compo_adjust_mode;
+    search->positionBased = positionBased;
+    search->smithWaterman =
+        (Boolean) (extendParams->options->eTbackExt == eSmithWatermanTbck);
+    search->compositionTestIndex = extendParams->options->unifiedP;
+    search->numQueries = queryInfo->num_queries;
+    search->numContexts = numContexts;
+    search->numFrames = (program_number == eBlastTypeBlastx) ? 6:1;
+
     /* Initialize savedParams */
     savedParams =
         s_SavedParametersNew(queryInfo->max_length, numContexts,
                              compo_adjust_mode, positionBased);
     if (savedParams == NULL) {
-        status_code = -1;
-        goto function_cleanup;
+        return -1;
     }
     status_code =
         s_RecordInitialSearch(savedParams, sbp, scoringParams,
                               queryInfo->max_length, compo_adjust_mode,
                               positionBased);
     if (status_code != 0) {
-        goto function_cleanup;
+        s_SavedParametersFree(&savedParams);
+        return status_code;
     }
     if (compo_adjust_mode != eNoCompositionBasedStats) {
         if((0 == strcmp(scoringParams->options->matrix, "BLOSUM62_20"))) {
-            localScalingFactor = SCALING_FACTOR / 10;
+            search->localScalingFactor = SCALING_FACTOR / 10;
         } else {
-            localScalingFactor = SCALING_FACTOR;
+            search->localScalingFactor = SCALING_FACTOR;
         }
     } else {
-        localScalingFactor = 1.0;
-    }
-    s_RescaleSearch(sbp, scoringParams, numContexts, localScalingFactor);
-    status_code =
-        BLAST_GapAlignStructNew(scoringParams, extendParams,
-                                (seqSrc) ?  BlastSeqSrcGetMaxSeqLen(seqSrc) 
-                                         :  subjectBlk->length,
-                                sbp, &gapAlign);
-    if (status_code != 0) {
-        return (Int2) status_code;
-    }
-    gapping_params_context.gap_align = gapAlign;
-    gapping_params_context.scoringParams = scoringParams;
-    gapping_params_context.sbp = sbp;
-    gapping_params_context.localScalingFactor = localScalingFactor;
-    gapping_params_context.prog_number = program_number;
-    redo_align_params =
-        s_GetAlignParams(&gapping_params_context, queryBlk, queryInfo, 
-                         hitParams, extendParams);
-    if (redo_align_params == NULL) {
-        status_code = -1;
-        goto function_cleanup;
+        search->localScalingFactor = 1.0;
     }
+    s_RescaleSearch(sbp, scoringParams, numContexts,
+                    search->localScalingFactor);
+    search->savedParams = savedParams;
 
-    query_info = s_GetQueryInfo(queryBlk->sequence, queryInfo, 
-                                (program_number == eBlastTypeBlastx));
-    if (query_info == NULL) {
-        status_code = -1;
-        goto function_cleanup;
+    search->redoneMatches =
+        calloc(search->numQueries, sizeof(BlastCompo_Heap));
+    if (search->redoneMatches == NULL) {
+        return -1;
     }
-
-    if(smithWaterman) {
+    for (query_index = 0;  query_index < search->numQueries;  query_index++) {
         status_code =
-            Blast_ForbiddenRangesInitialize(&forbidden, queryInfo->max_length);
+            BlastCompo_HeapInitialize(&search->redoneMatches[query_index],
+                                      hitParams->options->hitlist_size,
+                                      inclusion_ethresh);
         if (status_code != 0) {
-            goto function_cleanup;
+            return status_code;
         }
     }
-    redoneMatches = calloc(numQueries, sizeof(BlastCompo_Heap));
-    if (redoneMatches == NULL) {
-        status_code = -1;
-        goto function_cleanup;
+    return 0;
+}
+
+
+/**
+ * Finish a search whose alignments have been redone: save the redone
+ * matches in the results, and restore the scoring system of the search.
+ *
+ * @param search     the search [in][out]
+ * @param results    the results of the search, or NULL if the search
+ *                   failed and the matches are to be discarded [out]
+ */
+static void
+s_RedoSearchFinish(BlastKappa_RedoSearch * search,
+                   BlastHSPResults * results)
+{
+    int query_index;   /* loop index */
+
+    if (search->redoneMatches != NULL) {
+        if (results != NULL) {
+            s_FillResultsFromCompoHeaps(results, search->redoneMatches,
+                                  search->hitParams->options->hitlist_size);
+        }
+        for (query_index = 0;  query_index < search->numQueries;
+             query_index++) {
+            s_ClearHeap(&search->redoneMatches[query_index]);
+            BlastCompo_HeapRelease(&search->redoneMatches[query_index]);
+        }
+        sfree(search->redoneMatches);
+    }
+    if (search->savedParams != NULL) {
+        s_RestoreSearch(search->sbp, search->scoringParams,
+                        search->savedParams, search->queryBlk->length,
+                        search->positionBased, search->compo_adjust_mode);
+        s_SavedParametersFree(&search->savedParams);
+    }
+}
+
+
+/**
+ * Make a copy of a score block for a thread that redoes alignments.  The
+ * scoring matrix, which is adjusted for every match, is copied; all other
+ * fields are shared with the original and only read by the thread.
+ *
+ * @param sbp     the score block of the search
+ * @param rows    number of rows of the scoring matrix
+ * @return the copy, or NULL if out of memory
+ */
+static BlastScoreBlk *
+s_ScoreBlkThreadCopy(const BlastScoreBlk * sbp, int rows)
+{
+    int i;                            /* loop index */
+    BlastScoreBlk * copy;             /* the new score block */
+    SBlastScoreMatrix * matrix;       /* the matrix being copied */
+    SBlastScoreMatrix * matrix_copy;  /* its copy */
+
+    copy = malloc(sizeof(BlastScoreBlk));
+    if (copy == NULL) {
+        return NULL;
+    }
+    *copy = *sbp;
+    copy->matrix = NULL;
+    copy->psi_matrix = NULL;
+    if (sbp->psi_matrix != NULL) {
+        copy->psi_matrix = malloc(sizeof(SPsiBlastScoreMatrix));
+        if (copy->psi_matrix == NULL) {
+            sfree(copy);
+            return NULL;
+        }
+        *copy->psi_matrix = *sbp->psi_matrix;
+        copy->psi_matrix->pssm = NULL;
+        matrix = sbp->psi_matrix->pssm;
+    } else {
+        matrix = sbp->matrix;
+    }
+    matrix_copy = calloc(1, sizeof(SBlastScoreMatrix));
+    if (matrix_copy != NULL) {
+        *matrix_copy = *matrix;
+        matrix_copy->freqs = NULL;
+        matrix_copy->data = Nlm_Int4MatrixNew(rows, BLASTAA_SIZE);
+        if (matrix_copy->data == NULL) {
+            sfree(matrix_copy);
+        }
+    }
+    if (matrix_copy == NULL) {
+        sfree(copy->psi_matrix);
+        sfree(copy);
+        return NULL;
+    }
+    for (i = 0;  i < rows;  i++) {
+        memcpy(matrix_copy->data[i], matrix->data[i],
+               BLASTAA_SIZE * sizeof(Int4));
+    }
+    if (copy->psi_matrix != NULL) {
+        copy->psi_matrix->pssm = matrix_copy;
+    } else {
+        copy->matrix = matrix_copy;
+    }
+    return copy;
+}
+
+
+/**
+ * Free a score block made by s_ScoreBlkThreadCopy.
+ * @param sbp     the score block to free [in][out]
+ */
+static void
+s_ScoreBlkThreadFree(BlastScoreBlk ** sbp)
+{
+    BlastScoreBlk * copy = *sbp;
+
+    if (copy != NULL) {
+        SBlastScoreMatrix * matrix =
+            copy->psi_matrix ? copy->psi_matrix->pssm : copy->matrix;
+        Nlm_Int4MatrixFree(&matrix->data);
+        sfree(matrix);
+        sfree(copy->psi_matrix);
+        sfree(copy);
     }
-    for (query_index = 0;  query_index < numQueries;  query_index++) {
+    *sbp = NULL;
+}
+
+
+/**
+ * Free the data of a thread that redoes alignments.
+ * @param pthread    the thread data [in][out]
+ */
+static void
+s_RedoThreadFree(BlastKappa_RedoThread ** pthread)
+{
+    BlastKappa_RedoThread * thread = *pthread;
+    int index;   /* loop index */
+
+    if (thread == NULL) {
+        return;
+    }
+    if (thread->incoming_align_set != NULL) {
+        /* frames of the last match, if redoing it failed */
+        for (index = 0;  index < 6;  index++) {
+            BlastCompo_AlignmentsFree(&thread->incoming_align_set[index],
+                                      NULL);
+        }
+        sfree(thread->incoming_align_set);
+    }
+    sfree(thread->alignments);
+    Blast_CompositionWorkspaceFree(&thread->NRrecord);
+    if (thread->forbidden.ranges != NULL) {
+        Blast_ForbiddenRangesRelease(&thread->forbidden);
+    }
+    free(thread->query_info);
+    if (thread->redo_align_params != NULL && thread->shares_matrix_info) {
+        /* Do not destruct the matrix information of another thread */
+        thread->redo_align_params->matrix_info = NULL;
+    }
+    Blast_RedoAlignParamsFree(&thread->redo_align_params);
+    if (thread->gapAlign != NULL) {
+        thread->gapAlign = BLAST_GapAlignStructFree(thread->gapAlign);
+    }
+    if (thread->owns_sbp) {
+        s_ScoreBlkThreadFree(&thread->sbp);
+    }
+    sfree(*pthread);
+}
+
+
+/**
+ * Create the data used by one thread to redo the alignments of a search.
+ *
+ * @param search         the search, set up by s_RedoSearchInit [in]
+ * @param copy_sbp       should the thread have its own copy of the
+ *                       scoring matrix of the search? [in]
+ * @param max_subject_length   length of the longest subject [in]
+ * @param shared_matrix_info   if not NULL, matrix information computed
+ *                       for another thread of the search [in]
+ * @param status_code    0 on success, -1 on failure [out]
+ * @return the new thread data, or NULL on failure
+ */
+static BlastKappa_RedoThread *
+s_RedoThreadNew(const BlastKappa_RedoSearch * search,
+                Boolean copy_sbp,
+                Uint4 max_subject_length,
+                Blast_MatrixInfo * shared_matrix_info,
+                int * status_code)
+{
+    BlastKappa_RedoThread * thread;
+    BlastKappa_GappingParamsContext * context;
+    const BlastScoringParameters * scoringParams = search->scoringParams;
+
+    *status_code = -1;
+    thread = calloc(1, sizeof(BlastKappa_RedoThread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->pvalueForThisPair = (-1);
+    if (copy_sbp) {
+        thread->sbp =
+            s_ScoreBlkThreadCopy(search->sbp,
+                                 search->positionBased ?
+                                 search->queryInfo->max_length :
+                                 BLASTAA_SIZE);
+        thread->owns_sbp = TRUE;
+        if (thread->sbp == NULL) {
+            goto error_return;
+        }
+    } else {
+        thread->sbp = search->sbp;
+    }
+    thread->matrix = search->positionBased ?
+        thread->sbp->psi_matrix->pssm->data : thread->sbp->matrix->data;
+
+    if (0 != BLAST_GapAlignStructNew(scoringParams, search->extendParams,
+                                     max_subject_length, thread->sbp,
+                                     &thread->gapAlign)) {
+        goto error_return;
+    }
+    context = &thread->gapping_params_context;
+    context->gap_align = thread->gapAlign;
+    context->scoringParams = search->scoringParams;
+    context->sbp = thread->sbp;
+    context->localScalingFactor = search->localScalingFactor;
+    context->prog_number = search->program_number;
+    thread->redo_align_params =
+        s_GetAlignParams(context, search->queryBlk, search->queryInfo, 
+                         search->hitParams, search->extendParams,
+                         shared_matrix_info);
+    if (thread->redo_align_params == NULL) {
+        goto error_return;
+    }
+    thread->shares_matrix_info = (Boolean) (shared_matrix_info != NULL);
+
+    thread->query_info =
+        s_GetQueryInfo(search->queryBlk->sequence, search->queryInfo, 
+                       (search->program_number == eBlastTypeBlastx));
+    if (thread->query_info == NULL) {
+        goto error_return;
+    }
+    if (search->smithWaterman) {
+        if (0 != Blast_ForbiddenRangesInitialize(&thread->forbidden,
+                                         search->queryInfo->max_length)) {
+            goto error_return;
+        }
+    }
+    if ((int) search->compo_adjust_mode > 1 && !search->positionBased) {
+        thread->NRrecord = Blast_CompositionWorkspaceNew();
+        if (thread->NRrecord == NULL ||
+            0 != Blast_CompositionWorkspaceInit(thread->NRrecord,
+                                        scoringParams->options->matrix)) {
+            goto error_return;
+        }
+    }
+    thread->alignments =
+        calloc(search->numContexts, sizeof(BlastCompo_Alignment *));
+    thread->incoming_align_set = calloc(6, sizeof(BlastCompo_Alignment *));
+    if (thread->alignments == NULL || thread->incoming_align_set == NULL) {
+        goto error_return;
+    }
+    *status_code = 0;
+    return thread;
+
+error_return:
+    s_RedoThreadFree(&thread);
+    return NULL;
+}
+
+
+/**
+ * Recompute the alignments of one match found by the gapped BLAST
+ * algorithm.
+ *
+ * @param pHspList       the new alignments, or NULL if the subject
+ *                       sequence could not be retrieved [out]
+ * @param pBestEvalue    the best evalue of the new alignments [out]
+ * @param pBestScore     the best score of the new alignments [out]
+ * @param thread         the data of the calling thread [in][out]
+ * @param search         the search [in]
+ * @param subjectBlk     subject sequence, if there is no seqSrc [in]
+ * @param seqSrc         used to fetch database sequences [in]
+ * @param default_db_genetic_code   genetic code of the database [in]
+ * @param thisMatch      the match [in]
+ * @return 0 on success, otherwise failure.
+ */
+static int
+s_RedoMatchingSequence(BlastHSPList ** pHspList,
+                       double * pBestEvalue,
+                       Int4 * pBestScore,
+                       BlastKappa_RedoThread * thread,
+                       const BlastKappa_RedoSearch * search,
+                       BLAST_SequenceBlk * subjectBlk,
+                       const BlastSeqSrc* seqSrc,
+                       Int4 default_db_genetic_code,
+                       BlastHSPList * thisMatch)
+{
+    int status_code = 0;                    /* return value code */
+    int numAligns[6];
+    /* loop index */
+    int query_index;
+    /* context number */
+    int context_index;
+    /* frame number */
+    int frame_index;
+    EBlastProgramType program_number = search->program_number;
+    BlastQueryInfo * queryInfo = search->queryInfo;
+    int numFrames = search->numFrames;
+    Blast_KarlinBlk * kbp = NULL;
+    BlastCompo_MatchingSequence matchingSeq = {0,};
+    BlastHSPList * hsp_list = Blast_HSPListNew(0);
+    /* existing alignments for a match */
+    BlastCompo_Alignment ** incoming_align_set = thread->incoming_align_set;
+    BlastCompo_Alignment * incoming_aligns = NULL;
+    /* array of lists of alignments for each query to this subject */
+    BlastCompo_Alignment ** alignments = thread->alignments;
+
+    *pBestEvalue = DBL_MAX;
+    *pBestScore = 0;
+
+    query_index = thisMatch->query_index;
+    context_index = query_index * numFrames;
+    /* Get the sequence for this match */
+    if (seqSrc && BlastSeqSrcGetSupportsPartialFetching(seqSrc)) {
+        BLAST_SetupPartialFetching(program_number, (BlastSeqSrc*)seqSrc, 
+                                   (const BlastHSPList**)&thisMatch, 1);
+    }
+
+    if (subjectBlk) {
+        matchingSeq.length = subjectBlk->length;
+        matchingSeq.index = -1;
+        matchingSeq.local_data = subjectBlk;
+    } else {
         status_code =
-            BlastCompo_HeapInitialize(&redoneMatches[query_index],
-                                      hitParams->options->hitlist_size,
-                                      inclusion_ethresh);
+            s_MatchingSequenceInitialize(&matchingSeq, program_number,
+                                     seqSrc, default_db_genetic_code,
+                                     thisMatch->oid);
         if (status_code != 0) {
-            goto function_cleanup;
+            /* some sequences may have been excluded by membit filtering 
+               so this is not really an exception */
+            status_code = 0;
+            hsp_list = Blast_HSPListFree(hsp_list);
+            goto match_loop_cleanup;
         }
     }
-    if( (int) compo_adjust_mode > 1 && !positionBased ) {
-        NRrecord = Blast_CompositionWorkspaceNew();
-        status_code =
-            Blast_CompositionWorkspaceInit(NRrecord,
-                                           scoringParams->options->matrix);
+    status_code =
+        s_ResultHspToDistinctAlign(incoming_align_set, numAligns,
+                                   thisMatch->hsp_array, 
+                                   thisMatch->hspcnt, context_index,
+                                   queryInfo, search->localScalingFactor);
+    if (status_code != 0) {
+        goto match_loop_cleanup;
+    }
+
+    for (frame_index=0; frame_index<numFrames; frame_index++, context_index++) {
+        incoming_aligns = incoming_align_set[frame_index];
+        if (!incoming_aligns) continue;
+        /* All alignments in thisMatch should be to the same query */
+        kbp = search->sbp->kbp_gap[context_index];
+        if (search->smithWaterman) {
+            status_code =
+                Blast_RedoOneMatchSmithWaterman(alignments,
+                                            thread->redo_align_params,
+                                            incoming_aligns,
+                                            numAligns[frame_index],
+                                            kbp->Lambda, kbp->logK,
+                                            &matchingSeq, thread->query_info,
+                                            search->numQueries,
+                                            thread->matrix, BLASTAA_SIZE,
+                                            thread->NRrecord,
+                                            &thread->forbidden,
+                                            search->redoneMatches,
+                                            &thread->pvalueForThisPair,
+                                            search->compositionTestIndex,
+                                            &thread->LambdaRatio);
+        } else {
+            status_code =
+                Blast_RedoOneMatch(alignments, thread->redo_align_params,
+                               incoming_aligns, numAligns[frame_index],
+                               kbp->Lambda, &matchingSeq,
+                               -1, thread->query_info,
+                               search->numContexts, thread->matrix,
+                               BLASTAA_SIZE, thread->NRrecord,
+                               &thread->pvalueForThisPair,
+                               search->compositionTestIndex,
+                               &thread->LambdaRatio);
+        }
+
         if (status_code != 0) {
-            goto function_cleanup;
+            goto match_loop_cleanup;
+        }
+
+        if (alignments[context_index] != NULL) {
+            Int2 qframe = frame_index;
+            if (program_number == eBlastTypeBlastx) {
+                if (qframe < 3) qframe++;
+                else qframe = 2-qframe;
+            }
+            status_code =             
+                s_HSPListFromDistinctAlignments(hsp_list,
+                                      &alignments[context_index],
+                                      matchingSeq.index,
+                                      queryInfo, qframe);
+            if (status_code) {
+                goto match_loop_cleanup;
+            }
         }
+        BlastCompo_AlignmentsFree(&incoming_aligns, NULL);
+        incoming_align_set[frame_index] = NULL;
     }
-    alignments = calloc(numContexts, sizeof(BlastCompo_Alignment *));
-    incoming_align_set = calloc(numFrames, sizeof(BlastCompo_Alignment *));
-    if (alignments == NULL || incoming_align_set == NULL) {
-        status_code = -1;
+
+    if (hsp_list->hspcnt > 1) {
+        s_HitlistReapContained(hsp_list->hsp_array,
+                               &hsp_list->hspcnt);
+    }
+    status_code =
+        s_HitlistEvaluateAndPurge(pBestScore, pBestEvalue,
+                                          hsp_list,
+                                          seqSrc,
+                                          matchingSeq.length,
+                                          program_number,
+                                          queryInfo, context_index,
+                                          search->sbp, search->hitParams,
+                                          thread->pvalueForThisPair,
+                                          thread->LambdaRatio,
+                                          matchingSeq.index);
+    if (status_code != 0) {
+        goto match_loop_cleanup;
+    }
+    if (*pBestEvalue <= search->hitParams->options->expect_value) {
+        /* The best alignment is significant */
+        s_HSPListNormalizeScores(hsp_list, kbp->Lambda, kbp->logK,
+                                         search->localScalingFactor);
+        s_ComputeNumIdentities(search->queryBlk, queryInfo, subjectBlk,
+                               seqSrc, hsp_list,
+                               search->scoringParams->options,
+                               search->genetic_code_string, thread->sbp);
+    }
+match_loop_cleanup:
+    if (status_code != 0) {
+        for (context_index = 0;  context_index < search->numContexts;
+             context_index++) {
+            BlastCompo_AlignmentsFree(&alignments[context_index],
+                                      s_FreeEditScript);
+        }
+        for (frame_index = 0;  frame_index < numFrames;  frame_index++) {
+            BlastCompo_AlignmentsFree(&incoming_align_set[frame_index],
+                                      NULL);
+        }
+    }
+    s_MatchingSequenceRelease(&matchingSeq);
+    *pHspList = hsp_list;
+    return status_code;
+}
+
+
+/**
+ * Save the redone alignments of a match among the best matches of its
+ * query, if they are good enough.
+ *
+ * @param heap          the best matches of the query [in][out]
+ * @param pHspList      the redone alignments; set to NULL if the heap
+ *                      takes possession of them [in][out]
+ * @param best_evalue   the best evalue of the alignments [in]
+ * @param best_score    the best score of the alignments [in]
+ * @param oid           the subject of the alignments [in]
+ * @return 0 on success, -1 if out of memory
+ */
+static int
+s_SaveRedoneMatch(BlastCompo_Heap * heap,
+                  BlastHSPList ** pHspList,
+                  double best_evalue,
+                  Int4 best_score,
+                  Int4 oid)
+{
+    int status_code = 0;
+    void * discarded_aligns = NULL;
+
+    if (BlastCompo_HeapWouldInsert(heap, best_evalue, best_score, oid)) {
+        status_code = BlastCompo_HeapInsert(heap, *pHspList, best_evalue,
+                                            best_score, oid,
+                                            &discarded_aligns);
+        if (status_code == 0) *pHspList = NULL;
+    }
+    if (discarded_aligns != NULL) {
+        Blast_HSPListFree(discarded_aligns);
+    }
+    return status_code;
+}
+
+
+/**
+ *  Recompute alignments for each match found by the gapped BLAST
+ *  algorithm.
+ */
+Int2
+Blast_RedoAlignmentCore(EBlastProgramType program_number,
+                        BLAST_SequenceBlk * queryBlk,
+                        BlastQueryInfo* queryInfo,
+                        BlastScoreBlk* sbp,
+                        BLAST_SequenceBlk * subjectBlk,
+                        const BlastSeqSrc* seqSrc,
+                        Int4 default_db_genetic_code,
+                        BlastHSPList * thisMatch,
+                        BlastHSPStream* hsp_stream,
+                        BlastScoringParameters* scoringParams,
+                        const BlastExtensionParameters* extendParams,
+                        const BlastHitSavingParameters* hitParams,
+                        const PSIBlastOptions* psiOptions,
+                        BlastHSPResults* results)
+{
+    int status_code = 0;                    /* return value code */
+    BlastKappa_RedoSearch search;
+    BlastKappa_RedoThread * thread = NULL;
+
+    memset(&search, 0, sizeof(search));
+    status_code =
+        s_RedoSearchInit(&search, program_number, queryBlk, queryInfo, sbp,
+                         default_db_genetic_code, scoringParams,
+                         extendParams, hitParams, psiOptions);
+    if (status_code == 0) {
+        /* the matrix of the search itself is adjusted for each match */
+        thread = s_RedoThreadNew(&search, FALSE,
+                                 (seqSrc) ? BlastSeqSrcGetMaxSeqLen(seqSrc)
+                                          : subjectBlk->length,
+                                 NULL, &status_code);
+    }
+    if (status_code != 0) {
         goto function_cleanup;
     }
-   
+
     while (1) {
-        int numAligns[6];
-        Blast_KarlinBlk * kbp = NULL;
-        BlastCompo_MatchingSequence matchingSeq = {0,};
-        BlastHSPList * hsp_list = Blast_HSPListNew(0);
+        BlastHSPList * hsp_list = NULL;
         double best_evalue;   
         Int4 best_score;
-        void * discarded_aligns = NULL;
      
         if (seqSrc
            && BlastHSPStreamRead(hsp_stream, &thisMatch) == kBlastHSPStream_Eof) 
@@ -2229,194 +2768,322 @@ Blast_RedoAlignmentCore(EBlastProgramType program_number,
         }
 
         if (BlastCompo_EarlyTermination(thisMatch->best_evalue,
-                                        redoneMatches, numQueries)) {
+                                        search.redoneMatches,
+                                        search.numQueries)) {
             Blast_HSPListFree(thisMatch);
             if (seqSrc) continue;
             break;
         }
 
-        query_index = thisMatch->query_index;
-        context_index = query_index * numFrames;
-        /* Get the sequence for this match */
-        if (seqSrc && BlastSeqSrcGetSupportsPartialFetching(seqSrc)) {
-            BLAST_SetupPartialFetching(program_number, (BlastSeqSrc*)seqSrc, 
-                                       (const BlastHSPList**)&thisMatch, 1);
-        }
-
-        if (subjectBlk) {
-            matchingSeq.length = subjectBlk->length;
-            matchingSeq.index = -1;
-            matchingSeq.local_data = subjectBlk;
-        } else {
-            status_code =
-                s_MatchingSequenceInitialize(&matchingSeq, program_number,
-                                         seqSrc, default_db_genetic_code,
-                                         thisMatch->oid);
-            if (status_code != 0) {
-                /* some sequences may have been excluded by membit filtering 
-                   so this is not really an exception */
-                status_code = 0;
-                goto match_loop_cleanup;
-            }
-        }
         status_code =
-            s_ResultHspToDistinctAlign(incoming_align_set, numAligns,
-                                       thisMatch->hsp_array, 
-                                       thisMatch->hspcnt, context_index,
-                                       queryInfo, localScalingFactor);
-        if (status_code != 0) {
-            goto match_loop_cleanup;
-        }
-
-        for (frame_index=0; frame_index<numFrames; frame_index++, context_index++) {
-            incoming_aligns = incoming_align_set[frame_index];
-            if (!incoming_aligns) continue;
-            /* All alignments in thisMatch should be to the same query */
-            kbp = sbp->kbp_gap[context_index];
-            if (smithWaterman) {
-                status_code =
-                    Blast_RedoOneMatchSmithWaterman(alignments,
-                                                redo_align_params,
-                                                incoming_aligns,
-                                                numAligns[frame_index],
-                                                kbp->Lambda, kbp->logK,
-                                                &matchingSeq, query_info,
-                                                numQueries,
-                                                matrix, BLASTAA_SIZE,
-                                                NRrecord, &forbidden,
-                                                redoneMatches,
-                                                &pvalueForThisPair,
-                                                compositionTestIndex,
-                                                &LambdaRatio);
-            } else {
+            s_RedoMatchingSequence(&hsp_list, &best_evalue, &best_score,
+                                   thread, &search, subjectBlk, seqSrc,
+                                   default_db_genetic_code, thisMatch);
+        if (seqSrc) {
+            if (status_code == 0 && hsp_list != NULL &&
+                best_evalue <= hitParams->options->expect_value) {
                 status_code =
-                    Blast_RedoOneMatch(alignments, redo_align_params,
-                                   incoming_aligns, numAligns[frame_index],
-                                   kbp->Lambda, &matchingSeq,
-                                   -1, query_info,
-                                   numContexts, matrix, BLASTAA_SIZE,
-                                   NRrecord, &pvalueForThisPair,
-                                   compositionTestIndex,
-                                   &LambdaRatio);
-            }
-
-            if (status_code != 0) {
-                goto match_loop_cleanup;
-            }
-
-            if (alignments[context_index] != NULL) {
-                Int2 qframe = frame_index;
-                if (program_number == eBlastTypeBlastx) {
-                    if (qframe < 3) qframe++;
-                    else qframe = 2-qframe;
-                }
-                status_code =             
-                    s_HSPListFromDistinctAlignments(hsp_list,
-                                          &alignments[context_index],
-                                          matchingSeq.index,
-                                          queryInfo, qframe);
-                if (status_code) {
-                    goto match_loop_cleanup;
-                }
+                    s_SaveRedoneMatch(&search.redoneMatches[thisMatch->
+                                                            query_index],
+                                      &hsp_list, best_evalue, best_score,
+                                      thisMatch->oid);
             }
-            BlastCompo_AlignmentsFree(&incoming_aligns, NULL);
-            incoming_align_set[frame_index] = NULL;
-        }
-
-        if (hsp_list->hspcnt > 1) {
-            s_HitlistReapContained(hsp_list->hsp_array,
-                                   &hsp_list->hspcnt);
-        }
-        status_code =
-            s_HitlistEvaluateAndPurge(&best_score, &best_evalue,
-                                              hsp_list,
-                                              seqSrc,
-                                              matchingSeq.length,
-                                              program_number,
-                                              queryInfo, context_index,
-                                              sbp, hitParams,
-                                              pvalueForThisPair, LambdaRatio,
-                                              matchingSeq.index);
-        if (status_code != 0) {
-            goto query_loop_cleanup;
-        }
-        if (best_evalue <= hitParams->options->expect_value) {
-            /* The best alignment is significant */
-            s_HSPListNormalizeScores(hsp_list, kbp->Lambda, kbp->logK,
-                                             localScalingFactor);
-            s_ComputeNumIdentities(queryBlk, queryInfo, subjectBlk, seqSrc,
-                                           hsp_list, scoringParams->options,
-                                           genetic_code_string, sbp);
-            if (!seqSrc) goto query_loop_cleanup;
-            if ( BlastCompo_HeapWouldInsert(&redoneMatches[query_index],
-                                               best_evalue, best_score,
-                                               thisMatch->oid)) {
-                status_code = BlastCompo_HeapInsert(&redoneMatches[query_index],
-                                              hsp_list, best_evalue,
-                                              best_score, thisMatch->oid,
-                                              &discarded_aligns);
-                if (status_code == 0) hsp_list = NULL;
-            } else {
-                hsp_list = Blast_HSPListFree(hsp_list);
-            }
-
-            if (status_code) goto query_loop_cleanup;
-            if (discarded_aligns != NULL) {
-                Blast_HSPListFree(discarded_aligns);
-            }
-        }
-query_loop_cleanup:
-match_loop_cleanup:
-        if (seqSrc) {
             thisMatch = Blast_HSPListFree(thisMatch);
-        } else {
+        } else if (hsp_list != NULL) {
             Blast_HSPListSwap(thisMatch, hsp_list);
             thisMatch->oid = hsp_list->oid;
         }
         hsp_list = Blast_HSPListFree(hsp_list);
 
-        if (status_code != 0) {
-            for (query_index = 0;  query_index < numContexts;  query_index++) {
-                BlastCompo_AlignmentsFree(&alignments[query_index],
-                                          s_FreeEditScript);
-            }
-        }
-        s_MatchingSequenceRelease(&matchingSeq);
-        BlastCompo_AlignmentsFree(&incoming_aligns, NULL);
         if (status_code != 0 || !seqSrc) {
-            goto function_cleanup;
+            break;
         }
     }
     /* end for all matching sequences */
 function_cleanup:
-    sfree(alignments);
-    sfree(incoming_align_set);
-    if (seqSrc && status_code == 0) {
-        s_FillResultsFromCompoHeaps(results, redoneMatches,
-                                    hitParams->options->hitlist_size);
-    } else {
-        if (redoneMatches != NULL) {
-            s_ClearHeap(&redoneMatches[0]);
+    s_RedoThreadFree(&thread);
+    s_RedoSearchFinish(&search,
+                       (seqSrc && status_code == 0) ? results : NULL);
+
+    return (Int2) status_code;
+}
+
+
+/** A match whose alignments are redone by a multi-threaded search */
+typedef struct BlastKappa_RedoneMatch {
+    BlastHSPList * thisMatch;  /**< the match found by the gapped BLAST
+                                    algorithm; NULL once redone */
+    BlastHSPList * hsp_list;   /**< the redone alignments, or NULL */
+    double prelim_evalue;      /**< best evalue of thisMatch */
+    double best_evalue;        /**< best evalue of hsp_list */
+    Int4 best_score;           /**< best score of hsp_list */
+    Int4 query_index;          /**< query of the match */
+    Int4 oid;                  /**< subject of the match */
+    Boolean done;              /**< have the alignments been redone */
+} BlastKappa_RedoneMatch;
+
+
+/** Documented in blast_kappa.h */
+struct BlastRedoAlignmentWork {
+    BlastKappa_RedoSearch search;    /**< the search */
+    Int4 default_db_genetic_code;    /**< genetic code of the database */
+    BlastKappa_RedoThread ** threads;  /**< data of each thread */
+    Int4 num_threads;                /**< number of elements of threads */
+    Int4 num_registered;             /**< number of threads started */
+    BlastKappa_RedoneMatch * matches;  /**< all matches, in the order they
+                                            were read from the stream */
+    Int4 num_matches;                /**< number of elements of matches */
+    Int4 next_match;                 /**< next match to be redone */
+    Int4 next_saved;                 /**< next match to be saved */
+    Int2 status;                     /**< first nonzero status of any
+                                          thread */
+    MT_LOCK lock;                    /**< protects the counts, the status
+                                          and the heaps of the search */
+};
+
+
+Int2
+Blast_RedoAlignmentWorkNew(EBlastProgramType program_number,
+                           BLAST_SequenceBlk* queryBlk,
+                           BlastQueryInfo* query_info,
+                           BlastScoreBlk* sbp,
+                           const BlastSeqSrc* seqSrc,
+                           Int4 db_genetic_code,
+                           BlastHSPStream* hsp_stream,
+                           BlastScoringParameters* scoringParams,
+                           const BlastExtensionParameters* extendParams,
+                           const BlastHitSavingParameters* hitParams,
+                           const PSIBlastOptions* psiOptions,
+                           Int4 num_threads, MT_LOCK lock,
+                           BlastRedoAlignmentWork** work_out)
+{
+    int status_code = 0;
+    Int4 i;
+    Int4 allocated = 0;
+    BlastHSPList * thisMatch = NULL;
+    BlastRedoAlignmentWork * work;
+
+    ASSERT(num_threads > 0);
+    *work_out = NULL;
+    work = calloc(1, sizeof(BlastRedoAlignmentWork));
+    if (work == NULL) {
+        MT_LOCK_Delete(lock);
+        return -1;
+    }
+    work->lock = lock;
+    work->default_db_genetic_code = db_genetic_code;
+
+    status_code =
+        s_RedoSearchInit(&work->search, program_number, queryBlk,
+                         query_info, sbp, db_genetic_code, scoringParams,
+                         extendParams, hitParams, psiOptions);
+    if (status_code != 0) {
+        goto error_return;
+    }
+    /* Smith-Waterman alignments consult the heaps of the search while
+       they are computed, which only the single-threaded search can do */
+    ASSERT( !work->search.smithWaterman );
+
+    /* Take all matches from the stream, in the order the single-threaded
+       loop would read them */
+    while (BlastHSPStreamRead(hsp_stream, &thisMatch)
+           != kBlastHSPStream_Eof) {
+        BlastKappa_RedoneMatch * match;
+        if (thisMatch->hsp_array == NULL) {
+            Blast_HSPListFree(thisMatch);
+            continue;
+        }
+        if (work->num_matches == allocated) {
+            BlastKappa_RedoneMatch * new_matches;
+            allocated = MAX(2 * allocated, 1024);
+            new_matches = realloc(work->matches,
+                                  allocated * sizeof(BlastKappa_RedoneMatch));
+            if (new_matches == NULL) {
+                Blast_HSPListFree(thisMatch);
+                status_code = -1;
+                goto error_return;
+            }
+            work->matches = new_matches;
         }
+        match = &work->matches[work->num_matches++];
+        memset(match, 0, sizeof(BlastKappa_RedoneMatch));
+        match->thisMatch = thisMatch;
+        match->prelim_evalue = thisMatch->best_evalue;
+        match->query_index = thisMatch->query_index;
+        match->oid = thisMatch->oid;
+    }
+
+    /* Each thread adjusts its own copy of the scoring matrix; the
+       information about the unadjusted matrix is computed once */
+    work->threads = calloc(num_threads, sizeof(BlastKappa_RedoThread *));
+    if (work->threads == NULL) {
+        status_code = -1;
+        goto error_return;
     }
-    free(query_info);
-    Blast_RedoAlignParamsFree(&redo_align_params);
-    if (redoneMatches != NULL) {
-        for (query_index = 0;  query_index < numQueries;  query_index++) {
-            BlastCompo_HeapRelease(&redoneMatches[query_index]);
+    work->num_threads = num_threads;
+    for (i = 0;  i < num_threads;  i++) {
+        work->threads[i] =
+            s_RedoThreadNew(&work->search, TRUE,
+                            BlastSeqSrcGetMaxSeqLen(seqSrc),
+                            i > 0 ? work->threads[0]->redo_align_params->
+                                    matrix_info : NULL,
+                            &status_code);
+        if (status_code != 0) {
+            goto error_return;
         }
-        sfree(redoneMatches); redoneMatches = NULL;
     }
-    if (smithWaterman) {
-        Blast_ForbiddenRangesRelease(&forbidden);
+    *work_out = work;
+    return 0;
+
+error_return:
+    Blast_RedoAlignmentWorkFree(work);
+    return (Int2) status_code;
+}
+
+
+/**
+ * Save the matches that have been redone, in the order of the
+ * single-threaded search, for as long as no earlier match is still being
+ * redone.  Called with the lock of the work held.
+ *
+ * @param work      work shared by the threads [in][out]
+ */
+static void
+s_RedoWorkSaveMatches(BlastRedoAlignmentWork * work)
+{
+    BlastKappa_RedoSearch * search = &work->search;
+
+    while (work->next_saved < work->num_matches &&
+           work->matches[work->next_saved].done) {
+        BlastKappa_RedoneMatch * match = &work->matches[work->next_saved++];
+        /* The heaps now hold exactly the matches the single-threaded
+           search holds when it reads this one */
+        if (work->status == 0 && match->hsp_list != NULL &&
+            match->best_evalue <=
+                search->hitParams->options->expect_value &&
+            !BlastCompo_EarlyTermination(match->prelim_evalue,
+                                         search->redoneMatches,
+                                         search->numQueries)) {
+            work->status = (Int2)
+                s_SaveRedoneMatch(&search->redoneMatches[match->query_index],
+                                  &match->hsp_list, match->best_evalue,
+                                  match->best_score, match->oid);
+        }
+        match->hsp_list = Blast_HSPListFree(match->hsp_list);
     }
-    if (gapAlign != NULL) {
-        gapAlign = BLAST_GapAlignStructFree(gapAlign);
+}
+
+
+/**
+ * Record that a match has been redone, and take the next match to redo.
+ *
+ * @param work      work shared by the threads [in][out]
+ * @param done      index of the match redone by the calling thread, or -1
+ * @param status    status of the calling thread, recorded in work if
+ *                  nonzero so that the other threads stop [in]
+ * @return index of the match to redo, or -1 if there is none
+ */
+static Int4
+s_RedoWorkNextMatch(BlastRedoAlignmentWork * work, Int4 done, Int2 status)
+{
+    Int4 next = -1;
+    BlastKappa_RedoSearch * search = &work->search;
+
+    MT_LOCK_Do(work->lock, eMT_Lock);
+    if (status != 0 && work->status == 0) {
+        work->status = status;
+    }
+    if (done >= 0) {
+        work->matches[done].done = TRUE;
+    }
+    while (work->status == 0 && work->next_match < work->num_matches) {
+        BlastKappa_RedoneMatch * match = &work->matches[work->next_match++];
+        /* The heaps only fill up as matches are saved, so a match that
+           would end the search early now is skipped by the
+           single-threaded search too */
+        if (BlastCompo_EarlyTermination(match->prelim_evalue,
+                                        search->redoneMatches,
+                                        search->numQueries)) {
+            match->thisMatch = Blast_HSPListFree(match->thisMatch);
+            match->done = TRUE;
+        } else {
+            next = work->next_match - 1;
+            break;
+        }
     }
-    s_RestoreSearch(sbp, scoringParams, savedParams, queryBlk->length,
-                    positionBased, compo_adjust_mode);
-    s_SavedParametersFree(&savedParams);
-    Blast_CompositionWorkspaceFree(&NRrecord);
+    s_RedoWorkSaveMatches(work);
+    MT_LOCK_Do(work->lock, eMT_Unlock);
+    return next;
+}
+
 
+Int2
+Blast_RedoAlignmentThread(BlastRedoAlignmentWork* work,
+                          const BlastSeqSrc* seqSrc)
+{
+    int status_code = 0;
+    Int4 index;
+    BlastKappa_RedoThread * thread = NULL;
+
+    MT_LOCK_Do(work->lock, eMT_Lock);
+    if (work->num_registered < work->num_threads) {
+        thread = work->threads[work->num_registered++];
+    }
+    MT_LOCK_Do(work->lock, eMT_Unlock);
+    if (thread == NULL) {
+        return -1;
+    }
+
+    index = s_RedoWorkNextMatch(work, -1, 0);
+    while (index >= 0) {
+        BlastKappa_RedoneMatch * match = &work->matches[index];
+        status_code =
+            s_RedoMatchingSequence(&match->hsp_list, &match->best_evalue,
+                                   &match->best_score, thread, &work->search,
+                                   NULL, seqSrc,
+                                   work->default_db_genetic_code,
+                                   match->thisMatch);
+        match->thisMatch = Blast_HSPListFree(match->thisMatch);
+        index = s_RedoWorkNextMatch(work, index, (Int2) status_code);
+    }
     return (Int2) status_code;
 }
+
+
+Int2
+Blast_RedoAlignmentWorkFinish(BlastRedoAlignmentWork* work,
+                              BlastHSPResults* results)
+{
+    Int2 status = work->status;
+
+    ASSERT(status != 0 || work->next_saved == work->num_matches);
+    s_RedoSearchFinish(&work->search, status == 0 ? results : NULL);
+    return status;
+}
+
+
+BlastRedoAlignmentWork*
+Blast_RedoAlignmentWorkFree(BlastRedoAlignmentWork* work)
+{
+    Int4 i;
+
+    if (work == NULL) {
+        return NULL;
+    }
+    /* threads sharing the matrix information of the first go first */
+    for (i = work->num_threads - 1;  i >= 0;  i--) {
+        s_RedoThreadFree(&work->threads[i]);
+    }
+    sfree(work->threads);
+    for (i = 0;  i < work->num_matches;  i++) {
+        Blast_HSPListFree(work->matches[i].thisMatch);
+        Blast_HSPListFree(work->matches[i].hsp_list);
+    }
+    sfree(work->matches);
+    /* restores the scoring system if Blast_RedoAlignmentWorkFinish was
+       not called */
+    s_RedoSearchFinish(&work->search, NULL);
+    work->lock = MT_LOCK_Delete(work->lock);
+    sfree(work);
+    return NULL;
+}
@@ -31,6 +31,11 @@
 #include <algo/blast/core/blast_nalookup.h>
 #include <algo/blast/core/blast_nascan.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE */
+#include <algo/blast/core/blast_simd.h>
+
+#ifdef BLAST_SIMD_X86
+#include <immintrin.h>
+#endif
 
 #ifndef SKIP_DOXYGEN_PROCESSING
 static char const rcsid[] =
@@ -86,6 +91,88 @@ static NCBI_INLINE void s_BlastLookupRetrieve(BlastNaLookupTable * lookup,
     return;
 }
 
+#ifdef BLAST_SIMD_X86
+
+/** Number of subject words examined by one pass of the AVX2 scanners */
+#define NA_SIMD_WORDS 8
+
+/** Compute lookup table indices for NA_SIMD_WORDS words of the
+ * compressed subject sequence. Each lane gathers the four bytes
+ * starting at the byte containing the first base of its word and
+ * shifts the word into the low-order bits, exactly as the scalar
+ * scanners do with s[0] << 24 | s[1] << 16 | s[2] << 8 | s[3]
+ * @param seq Start of the compressed subject sequence [in]
+ * @param pos Subject offset of the word in each lane [in]
+ * @param lut_word_length Number of bases in a lookup table word [in]
+ * @param mask Bits to keep from each word [in]
+ * @return the lookup table index of each word
+ */
+static NCBI_INLINE BLAST_TARGET_AVX2 __m256i
+s_AVX2NaWordIndex(const Uint1 *seq, __m256i pos,
+                  Int4 lut_word_length, Int4 mask)
+{
+    const __m256i kByteSwap = _mm256_setr_epi8(
+                        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m256i bytes, shift;
+
+    bytes = _mm256_i32gather_epi32((const int *)seq,
+                                   _mm256_srli_epi32(pos, 2), 1);
+    bytes = _mm256_shuffle_epi8(bytes, kByteSwap);
+
+    /* shift = 2 * (16 - (pos % COMPRESSION_RATIO + lut_word_length)) */
+    shift = _mm256_sub_epi32(
+                _mm256_set1_epi32(32 - 2 * lut_word_length),
+                _mm256_slli_epi32(_mm256_and_si256(pos, 
+                                      _mm256_set1_epi32(3)), 1));
+
+    return _mm256_and_si256(_mm256_srlv_epi32(bytes, shift),
+                            _mm256_set1_epi32(mask));
+}
+
+/** Test NA_SIMD_WORDS lookup table indices against a presence vector
+ * @param pv The presence vector [in]
+ * @param index Lookup table index in each lane [in]
+ * @param pv_bts Bits to shift from an index to its presence vector word [in]
+ * @return bitfield whose bit i is set if PV_TEST succeeds for lane i
+ */
+static NCBI_INLINE BLAST_TARGET_AVX2 Int4
+s_AVX2PvTest(const PV_ARRAY_TYPE *pv, __m256i index, Int4 pv_bts)
+{
+    __m256i words, bits;
+
+    words = _mm256_i32gather_epi32((const int *)pv,
+                   _mm256_srl_epi32(index, _mm_cvtsi32_si128(pv_bts)),
+                   PV_ARRAY_BYTES);
+    bits = _mm256_srlv_epi32(words, _mm256_and_si256(index,
+                                    _mm256_set1_epi32(PV_ARRAY_MASK)));
+    bits = _mm256_slli_epi32(bits, 31);
+    return _mm256_movemask_ps(_mm256_castsi256_ps(bits));
+}
+
+/** Compute the last starting offset from which NA_SIMD_WORDS words can be
+ * gathered without reading past the bytes that hold the last word of the
+ * scan range, and without the last word starting past the scan range
+ * @param scan_range The starting and ending pos to be scanned [in]
+ * @param lut_word_length Number of bases in a lookup table word [in]
+ * @param scan_step Number of bases between successive words [in]
+ * @return the last safe starting offset (may be less than scan_range[0])
+ */
+static NCBI_INLINE Int4 s_NaSimdScanLimit(const Int4 *scan_range,
+                                          Int4 lut_word_length,
+                                          Int4 scan_step)
+{
+    Int4 last_byte = (scan_range[1] + lut_word_length - 1) / 
+                                                COMPRESSION_RATIO;
+    Int4 byte_limit = COMPRESSION_RATIO * (last_byte - 3) + 3 - 
+                                (NA_SIMD_WORDS - 1) * scan_step;
+    Int4 range_limit = scan_range[1] - (NA_SIMD_WORDS - 1) * scan_step;
+
+    return MIN(byte_limit, range_limit);
+}
+
+#endif /* BLAST_SIMD_X86 */
+
 /** Scan the compressed subject sequence, returning 8-letter word hits
  * with stride 4. Assumes a standard nucleotide lookup table
  * @param lookup_wrap Pointer to the (wrapper to) lookup table [in]
@@ -284,6 +371,87 @@ static Int4 s_BlastNaScanSubject_Any(const LookupTableWrap * lookup_wrap,
     return total_hits;
 }
 
+#ifdef BLAST_SIMD_X86
+/** Scan the compressed subject sequence, returning 4-to-8 letter word hits
+ * at arbitrary stride, eight words at a time using AVX2 gathers. Words
+ * are tested against the presence vector in bulk and only the words that
+ * pass are looked up in the backbone; the last few words of the range
+ * are handled by s_BlastNaScanSubject_Any. Assumes a standard nucleotide
+ * lookup table
+ * @param lookup_wrap Pointer to the (wrapper to) lookup table [in]
+ * @param subject The (compressed) sequence to be scanned for words [in]
+ * @param offset_pairs Array of query and subject positions where words are 
+ *                found [out]
+ * @param max_hits The allocated size of the above array - how many offsets 
+ *        can be returned [in]
+ * @param scan_range The starting and ending pos to be scanned [in] 
+ *        on exit, scan_range[0] is updated to be the stopping pos [out]
+*/
+static BLAST_TARGET_AVX2 Int4 
+s_BlastNaScanSubject_AVX2(const LookupTableWrap * lookup_wrap,
+                          const BLAST_SequenceBlk * subject,
+                          BlastOffsetPair * NCBI_RESTRICT offset_pairs,
+                          Int4 max_hits, Int4 * scan_range)
+{
+    BlastNaLookupTable *lookup = (BlastNaLookupTable *) lookup_wrap->lut;
+    Uint1 *abs_start = subject->sequence;
+    Int4 lut_word_length = lookup->lut_word_length;
+    Int4 scan_step = lookup->scan_step;
+    Int4 mask = lookup->mask;
+    Int4 scan_limit = s_NaSimdScanLimit(scan_range, lut_word_length, 
+                                        scan_step);
+    Int4 total_hits = 0;
+    const __m256i kLaneOffsets = _mm256_mullo_epi32(
+                                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                    _mm256_set1_epi32(scan_step));
+    Int4 index[NA_SIMD_WORDS];
+
+    ASSERT(lookup_wrap->lut_type == eNaLookupTable);
+    ASSERT(scan_step > 0);
+
+    for (; scan_range[0] <= scan_limit; 
+                        scan_range[0] += NA_SIMD_WORDS * scan_step) {
+
+        __m256i pos = _mm256_add_epi32(_mm256_set1_epi32(scan_range[0]),
+                                       kLaneOffsets);
+        __m256i words = s_AVX2NaWordIndex(abs_start, pos, 
+                                          lut_word_length, mask);
+        Int4 found = s_AVX2PvTest(lookup->pv, words, PV_ARRAY_BTS);
+        Int4 i;
+
+        if (found == 0)
+            continue;
+
+        _mm256_storeu_si256((__m256i *)index, words);
+        for (i = 0; i < NA_SIMD_WORDS; i++) {
+            Int4 num_hits;
+
+            if ((found & (1 << i)) == 0)
+                continue;
+
+            num_hits = lookup->thick_backbone[index[i]].num_used;
+            if (num_hits > (max_hits - total_hits)) {
+                scan_range[0] += i * scan_step;
+                return total_hits;
+            }
+
+            s_BlastLookupRetrieve(lookup, index[i],
+                                  offset_pairs + total_hits,
+                                  scan_range[0] + i * scan_step);
+            total_hits += num_hits;
+        }
+    }
+
+    if (scan_range[0] <= scan_range[1]) {
+        total_hits += s_BlastNaScanSubject_Any(lookup_wrap, subject,
+                                               offset_pairs + total_hits,
+                                               max_hits - total_hits,
+                                               scan_range);
+    }
+    return total_hits;
+}
+#endif /* BLAST_SIMD_X86 */
+
 /** Choose the most appropriate function to scan through
  * subject sequences, assuming a standard blastn lookup table
  * @param lookup_wrap Structure containing lookup table [in][out]
@@ -294,6 +462,16 @@ static void s_NaChooseScanSubject(LookupTableWrap *lookup_wrap)
 
     ASSERT(lookup_wrap->lut_type == eNaLookupTable);
 
+#ifdef BLAST_SIMD_X86
+    /* for strides that are a multiple of 4 the scalar routines fetch
+       whole aligned bytes and are as fast as the vector scanner */
+    if (BlastSimd_GetLevel() >= eBlastSimdAVX2 && 
+        lookup->scan_step % COMPRESSION_RATIO != 0) {
+        lookup->scansub_callback = (void *)s_BlastNaScanSubject_AVX2;
+        return;
+    }
+#endif
+
     if (lookup->lut_word_length == 8 && lookup->scan_step == 4)
         lookup->scansub_callback = (void *)s_BlastNaScanSubject_8_4;
     else
@@ -2560,6 +2738,84 @@ base_3:
    return total_hits;
 }
 
+#ifdef BLAST_SIMD_X86
+/** Scan the compressed subject sequence, returning 9-to-12 letter word hits
+ * at arbitrary stride, eight words at a time using AVX2 gathers. Words
+ * are tested against the presence vector in bulk and only the words that
+ * pass are looked up in the hashtable; the last few words of the range
+ * are handled by s_MBScanSubject_Any. Assumes a contiguous megablast 
+ * lookup table
+ * @param lookup_wrap Pointer to the (wrapper to) lookup table [in]
+ * @param subject The (compressed) sequence to be scanned for words [in]
+ * @param offset_pairs Array of query and subject positions where words are 
+ *                found [out]
+ * @param max_hits The allocated size of the above array - how many offsets 
+ *        can be returned [in]
+ * @param scan_range The starting and ending pos to be scanned [in] 
+ *        on exit, scan_range[0] is updated to be the stopping pos [out]
+*/
+static BLAST_TARGET_AVX2 Int4 
+s_MBScanSubject_AVX2(const LookupTableWrap* lookup_wrap,
+       const BLAST_SequenceBlk* subject,
+       BlastOffsetPair* NCBI_RESTRICT offset_pairs, Int4 max_hits,  
+       Int4* scan_range)
+{
+    BlastMBLookupTable* mb_lt = (BlastMBLookupTable*) lookup_wrap->lut;
+    Uint1* abs_start = subject->sequence;
+    Int4 lut_word_length = mb_lt->lut_word_length;
+    Int4 scan_step = mb_lt->scan_step;
+    Int4 scan_limit = s_NaSimdScanLimit(scan_range, lut_word_length, 
+                                        scan_step);
+    Int4 total_hits = 0;
+    Int4 hit_limit = max_hits - mb_lt->longest_chain;
+    const __m256i kLaneOffsets = _mm256_mullo_epi32(
+                                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                    _mm256_set1_epi32(scan_step));
+    Int4 index[NA_SIMD_WORDS];
+
+    ASSERT(lookup_wrap->lut_type == eMBLookupTable);
+    ASSERT(!mb_lt->discontiguous);
+    ASSERT(scan_step > 0);
+
+    for (; scan_range[0] <= scan_limit; 
+                        scan_range[0] += NA_SIMD_WORDS * scan_step) {
+
+        __m256i pos = _mm256_add_epi32(_mm256_set1_epi32(scan_range[0]),
+                                       kLaneOffsets);
+        __m256i words = s_AVX2NaWordIndex(abs_start, pos, lut_word_length,
+                                          mb_lt->hashsize - 1);
+        Int4 found = s_AVX2PvTest(mb_lt->pv_array, words, 
+                                  mb_lt->pv_array_bts);
+        Int4 i;
+
+        if (found == 0)
+            continue;
+
+        _mm256_storeu_si256((__m256i *)index, words);
+        for (i = 0; i < NA_SIMD_WORDS; i++) {
+            if ((found & (1 << i)) == 0)
+                continue;
+
+            if (total_hits >= hit_limit) {
+                scan_range[0] += i * scan_step;
+                return total_hits;
+            }
+            total_hits += s_BlastMBLookupRetrieve(mb_lt, index[i],
+                                          offset_pairs + total_hits,
+                                          scan_range[0] + i * scan_step);
+        }
+    }
+
+    if (scan_range[0] <= scan_range[1]) {
+        total_hits += s_MBScanSubject_Any(lookup_wrap, subject,
+                                          offset_pairs + total_hits,
+                                          max_hits - total_hits,
+                                          scan_range);
+    }
+    return total_hits;
+}
+#endif /* BLAST_SIMD_X86 */
+
 /** Choose the most appropriate function to scan through
  * subject sequences, assuming a megablast lookup table
  * @param lookup_wrap Structure containing lookup table [in][out]
@@ -2590,6 +2846,13 @@ static void s_MBChooseScanSubject(LookupTableWrap *lookup_wrap)
         else
             mb_lt->scansub_callback = (void *)s_MB_DiscWordScanSubject_1;
     }
+#ifdef BLAST_SIMD_X86
+    else if (BlastSimd_GetLevel() >= eBlastSimdAVX2 && 
+             mb_lt->scan_step % COMPRESSION_RATIO != 0) {
+        /* as above, aligned strides gain nothing from vectorization */
+        mb_lt->scansub_callback = (void *)s_MBScanSubject_AVX2;
+    }
+#endif
     else {
         Int4 scan_step = mb_lt->scan_step;
 
@@ -2655,6 +2918,16 @@ void BlastChooseNucleotideScanSubject(LookupTableWrap *lookup_wrap)
 
 void * BlastChooseNucleotideScanSubjectAny(LookupTableWrap *lookup_wrap)
 {
+#ifdef BLAST_SIMD_X86
+    /* the vector scanners accept any starting offset */
+    if (BlastSimd_GetLevel() >= eBlastSimdAVX2) {
+        if (lookup_wrap->lut_type == eNaLookupTable)
+            return (void *)s_BlastNaScanSubject_AVX2;
+        if (!((BlastMBLookupTable *)lookup_wrap->lut)->discontiguous)
+            return (void *)s_MBScanSubject_AVX2;
+    }
+#endif
+
     if (lookup_wrap->lut_type == eNaLookupTable)
         return (void *)s_BlastNaScanSubject_Any;
 
@@ -0,0 +1,82 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_simd.c
+ * Detection of the vector instruction sets usable by the BLAST engine
+ */
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <algo/blast/core/blast_simd.h>
+
+/** Level supported by the CPU; negative until first computed */
+static int s_CpuLevel = -1;
+
+/** Upper bound set by BlastSimd_SetMaxLevel */
+static EBlastSimdLevel s_MaxLevel = eBlastSimdAVX2;
+
+/** Query the CPU and the BLAST_SIMD environment variable
+ * @return the usable level
+ */
+static EBlastSimdLevel s_DetectLevel(void)
+{
+    EBlastSimdLevel level = eBlastSimdNone;
+    const char* env = getenv("BLAST_SIMD");
+
+#ifdef BLAST_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1"))
+        level = eBlastSimdSSE41;
+    if (__builtin_cpu_supports("avx2"))
+        level = eBlastSimdAVX2;
+#endif
+
+    if (env != NULL) {
+        if (strcmp(env, "none") == 0)
+            level = eBlastSimdNone;
+        else if (strcmp(env, "sse4.1") == 0 && level > eBlastSimdSSE41)
+            level = eBlastSimdSSE41;
+    }
+    return level;
+}
+
+EBlastSimdLevel BlastSimd_GetLevel(void)
+{
+    /* concurrent first calls compute and store the same value */
+    if (s_CpuLevel < 0)
+        s_CpuLevel = (int)s_DetectLevel();
+
+    return (EBlastSimdLevel)MIN(s_CpuLevel, (int)s_MaxLevel);
+}
+
+void BlastSimd_SetMaxLevel(EBlastSimdLevel level)
+{
+    s_MaxLevel = level;
+}
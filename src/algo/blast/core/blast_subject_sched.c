@@ -0,0 +1,199 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_subject_sched.c
+ * Work-stealing scheduler for the chunks of long subject sequences.
+ *
+ * A work unit is a whole chunk of up to MAX_DBSEQ_LEN residues, which takes
+ * far longer to search than the queues take to update, so all queues share
+ * one mutex.
+ */
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <algo/blast/core/blast_subject_sched.h>
+#include <algo/blast/core/blast_def.h>
+#include <algo/blast/core/blast_message.h>
+
+BlastSubjectScheduler* BlastSubjectSchedulerNew(Int4 num_threads,
+                                                MT_LOCK lock)
+{
+    BlastSubjectScheduler* sched;
+
+    ASSERT(num_threads > 0);
+
+    sched = (BlastSubjectScheduler*) calloc(1, sizeof(BlastSubjectScheduler));
+    if (sched == NULL) {
+        MT_LOCK_Delete(lock);
+        return NULL;
+    }
+    sched->lock = lock;
+    sched->num_threads = num_threads;
+    sched->queues = (BlastSubjectWorkQueue*)
+        calloc(num_threads, sizeof(BlastSubjectWorkQueue));
+    sched->stats = (BlastThreadStats*)
+        calloc(num_threads, sizeof(BlastThreadStats));
+    if (sched->queues == NULL || sched->stats == NULL)
+        return BlastSubjectSchedulerFree(sched);
+
+    return sched;
+}
+
+BlastSubjectScheduler* BlastSubjectSchedulerFree(BlastSubjectScheduler* sched)
+{
+    Int4 i;
+
+    if (sched == NULL)
+        return NULL;
+
+    if (sched->queues) {
+        for (i = 0; i < sched->num_threads; i++) {
+            ASSERT(sched->queues[i].first == sched->queues[i].last);
+            sfree(sched->queues[i].units);
+        }
+        sfree(sched->queues);
+    }
+    sfree(sched->stats);
+    sched->lock = MT_LOCK_Delete(sched->lock);
+    sfree(sched);
+    return NULL;
+}
+
+Int4 BlastSubjectSchedulerRegisterThread(BlastSubjectScheduler* sched)
+{
+    Int4 retval = -1;
+
+    MT_LOCK_Do(sched->lock, eMT_Lock);
+    if (sched->num_registered < sched->num_threads) {
+        retval = sched->num_registered++;
+        sched->stats[retval].thread_index = retval;
+    }
+    MT_LOCK_Do(sched->lock, eMT_Unlock);
+    return retval;
+}
+
+Int2 BlastSubjectSchedulerPush(BlastSubjectScheduler* sched,
+                               Int4 thread_index, void* job,
+                               Int4 num_chunks)
+{
+    BlastSubjectWorkQueue* queue;
+    Int4 i, num_units;
+    Int2 status = 0;
+
+    ASSERT(thread_index >= 0 && thread_index < sched->num_threads);
+
+    MT_LOCK_Do(sched->lock, eMT_Lock);
+    queue = &sched->queues[thread_index];
+
+    /* compact the queue before growing it */
+    num_units = queue->last - queue->first;
+    if (queue->first > 0) {
+        memmove(queue->units, queue->units + queue->first,
+                num_units * sizeof(BlastSubjectWorkUnit));
+        queue->first = 0;
+        queue->last = num_units;
+    }
+    if (num_units + num_chunks > queue->allocated) {
+        Int4 new_size = MAX(2 * queue->allocated, num_units + num_chunks);
+        BlastSubjectWorkUnit* new_units = (BlastSubjectWorkUnit*)
+            realloc(queue->units, new_size * sizeof(BlastSubjectWorkUnit));
+        if (new_units == NULL) {
+            status = BLASTERR_MEMORY;
+        } else {
+            queue->units = new_units;
+            queue->allocated = new_size;
+        }
+    }
+
+    /* the owner takes units from the end of the queue, so queue the
+       chunks in reverse order to search them in sequence order */
+    if (status == 0) {
+        for (i = num_chunks - 1; i >= 0; i--) {
+            queue->units[queue->last].job = job;
+            queue->units[queue->last].chunk = i;
+            queue->last++;
+        }
+    }
+    MT_LOCK_Do(sched->lock, eMT_Unlock);
+    return status;
+}
+
+Boolean BlastSubjectSchedulerPop(BlastSubjectScheduler* sched,
+                                 Int4 thread_index, Boolean steal,
+                                 BlastSubjectWorkUnit* unit)
+{
+    BlastSubjectWorkQueue* queue = &sched->queues[thread_index];
+    Boolean found = TRUE;
+
+    MT_LOCK_Do(sched->lock, eMT_Lock);
+    if (queue->last > queue->first) {
+        *unit = queue->units[--queue->last];
+    } else if (steal) {
+        /* take from the queue with the most units left */
+        Int4 i, victim = -1, most_units = 0;
+        for (i = 0; i < sched->num_threads; i++) {
+            Int4 num_units = sched->queues[i].last - sched->queues[i].first;
+            if (num_units > most_units) {
+                most_units = num_units;
+                victim = i;
+            }
+        }
+        if (victim >= 0) {
+            queue = &sched->queues[victim];
+            *unit = queue->units[queue->first++];
+            sched->stats[thread_index].stolen_units++;
+        } else {
+            found = FALSE;
+        }
+    } else {
+        found = FALSE;
+    }
+    MT_LOCK_Do(sched->lock, eMT_Unlock);
+    return found;
+}
+
+Boolean BlastSubjectSchedulerUnitDone(BlastSubjectScheduler* sched,
+                                      Int4* units_left)
+{
+    Boolean last_unit;
+
+    MT_LOCK_Do(sched->lock, eMT_Lock);
+    ASSERT(*units_left > 0);
+    last_unit = (--(*units_left) == 0);
+    MT_LOCK_Do(sched->lock, eMT_Unlock);
+    return last_unit;
+}
+
+BlastThreadStats* BlastSubjectSchedulerGetStats(BlastSubjectScheduler* sched,
+                                                Int4 thread_index)
+{
+    ASSERT(thread_index >= 0 && thread_index < sched->num_threads);
+    return &sched->stats[thread_index];
+}
@@ -39,6 +39,8 @@ static char const rcsid[] =
 
 #include <algo/blast/core/blast_sw.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE */
+#include <algo/blast/core/blast_simd.h>
+#include <algo/blast/composition_adjustment/smith_waterman.h>
 
 /** swap (pointers to) a pair of sequences */
 #define SWAP_SEQS(A, B) {const Uint1 *tmp = (A); (A) = (B); (B) = tmp; }
@@ -46,6 +48,58 @@ static char const rcsid[] =
 /** swap two integers */
 #define SWAP_INT(A, B) {Int4 tmp = (A); (A) = (B); (B) = tmp; }
 
+/** Compute the score of the best local alignment between a query
+ *  and a subject sequence with the striped vector code, if the
+ *  running CPU allows it. The query profile is cached in gap_align,
+ *  so that it is only rebuilt when the query or matrix changes.
+ * @param score The score of the best local alignment [out]
+ * @param A The query sequence [in]
+ * @param a_size Length of the query [in]
+ * @param B The (unpacked) subject sequence [in]
+ * @param b_size Length of the subject [in]
+ * @param alphsize One more than the largest residue in B [in]
+ * @param gap_open Gap open penalty [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @param gap_align Auxiliary data for gapped alignment 
+ *             (used for score matrix info) [in]
+ * @return TRUE if the score was computed, FALSE if the scalar
+ *         code must be used instead
+ */
+static Boolean s_StripedScoreOnly(Int4 *score,
+                                  const Uint1 *A, Int4 a_size,
+                                  const Uint1 *B, Int4 b_size,
+                                  Int4 alphsize,
+                                  Int4 gap_open, Int4 gap_extend,
+                                  BlastGapAlignStruct *gap_align)
+{
+   EBlastSimdLevel level = BlastSimd_GetLevel();
+   Blast_SwStripedProfile *profile = gap_align->sw_profile;
+   Int4 **matrix;
+   int a_end, b_end;
+
+   if (level == eBlastSimdNone)
+      return FALSE;
+
+   if (gap_align->positionBased)
+      matrix = gap_align->sbp->psi_matrix->pssm->data;
+   else
+      matrix = gap_align->sbp->matrix->data;
+
+   if (profile == NULL || profile->query != A ||
+       profile->queryLength != a_size || profile->matrix != matrix ||
+       profile->alphsize != alphsize) {
+      Blast_SwStripedProfileFree(profile);
+      profile = gap_align->sw_profile =
+         Blast_SwStripedProfileNew(A, a_size, matrix, alphsize,
+                                   gap_align->positionBased, level);
+      if (profile == NULL)
+         return FALSE;
+   }
+
+   return Blast_SwStripedScore(score, &b_end, &a_end, profile, B, b_size,
+                               gap_open, gap_extend, INT4_MAX) == 0;
+}
+
 /** Compute the score of the best local alignment between
  *  two protein sequences. When using Smith-Waterman, the vast
  *  majority of the runtime is tied up in this routine.
@@ -77,6 +131,11 @@ static Int4 s_SmithWatermanScoreOnly(const Uint1 *A, Int4 a_size,
    Boolean is_pssm = gap_align->positionBased;
    Int4 gap_open_extend = gap_open + gap_extend;
 
+   /* A is the query; the striped code keeps a profile of it */
+   if (s_StripedScoreOnly(&final_best_score, A, a_size, B, b_size,
+                          BLASTAA_SIZE, gap_open, gap_extend, gap_align))
+      return final_best_score;
+
    /* choose the score matrix */
    if (is_pssm) {
       matrix = gap_align->sbp->psi_matrix->pssm->data;
@@ -182,6 +241,23 @@ static Int4 s_NuclSmithWaterman(const Uint1 *B, Int4 b_size,
    BlastGapDP *scores;
 
    Int4 gap_open_extend = gap_open + gap_extend;
+   Uint1 *unpacked_B = NULL;
+
+   /* the striped code needs B one base per byte; A is the query,
+      and the score matrix is symmetric */
+   if (BlastSimd_GetLevel() != eBlastSimdNone)
+      unpacked_B = (Uint1 *)malloc(MAX(b_size, 1));
+   if (unpacked_B != NULL) {
+      Boolean done;
+      for (i = 0; i < b_size; i++)
+         unpacked_B[i] = NCBI2NA_UNPACK_BASE(B[i/4], (3-(i%4)));
+      done = s_StripedScoreOnly(&final_best_score, A, a_size,
+                                unpacked_B, b_size, BLASTNA_SIZE,
+                                gap_open, gap_extend, gap_align);
+      sfree(unpacked_B);
+      if (done)
+         return final_best_score;
+   }
 
    /* position-specific scoring is not allowed, because
       the loops below assume the score matrix is symmetric */
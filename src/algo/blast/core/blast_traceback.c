@@ -1288,6 +1288,262 @@ BLAST_SetupPartialFetching(EBlastProgramType program_number,
     BlastSeqSrcSetRangesArgFree(arg);
 }
 
+/** Perform the traceback for all HSP lists with hits to one subject
+ * sequence, in the standard (not RPS, not composition-adjusted) path.
+ * HSP lists left without HSPs are freed and removed from the batch; the
+ * other lists stay in the batch, to be saved in the results by the caller.
+ * @param program_number Type of BLAST program [in]
+ * @param batch HSP lists for the subject, one per query at most [in] [out]
+ * @param query The query sequence [in]
+ * @param query_info Query information [in]
+ * @param seq_src Source of subject sequences [in]
+ * @param seq_arg Argument for fetching the subject; holds the sequence
+ *                buffer reused from one subject to the next [in] [out]
+ * @param gap_align Gapped alignment structure [in]
+ * @param score_params Scoring parameters [in]
+ * @param ext_params Gapped extension parameters [in]
+ * @param hit_params Hit saving parameters [in] [out]
+ * @param eff_len_params Effective lengths parameters [in] [out]
+ * @param default_db_genetic_code Genetic code of the subjects [in]
+ * @param pattern_blk PHI BLAST auxiliary data structure [in]
+ * @return zero on success; a nonzero value if the search must stop
+ */
+static Int2
+s_TracebackOneSubject(EBlastProgramType program_number,
+                      BlastHSPStreamResultBatch* batch,
+                      BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+                      const BlastSeqSrc* seq_src,
+                      BlastSeqSrcGetSeqArg* seq_arg,
+                      BlastGapAlignStruct* gap_align,
+                      BlastScoringParameters* score_params,
+                      const BlastExtensionParameters* ext_params,
+                      BlastHitSavingParameters* hit_params,
+                      BlastEffectiveLengthsParameters* eff_len_params,
+                      Int4 default_db_genetic_code,
+                      SPHIPatternSearchBlk* pattern_blk)
+{
+   Int2 status = 0;
+   Int4 i;
+   BlastHSPList* hsp_list = NULL;
+   BlastScoreBlk* sbp = gap_align->sbp;
+   Boolean perform_traceback = score_params->options->gapped_calculation;
+   const Boolean kPhiBlast = Blast_ProgramIsPhiBlast(program_number);
+
+   /* traceback will require fetching the subject sequence */
+
+   if (perform_traceback) {
+
+      /* set up partial fetching */
+      if (BlastSeqSrcGetSupportsPartialFetching(seq_src)) {
+         BLAST_SetupPartialFetching(program_number, 
+                                    (BlastSeqSrc*)seq_src,
+                                    (const BlastHSPList**)batch->hsplist_array,
+                                    batch->num_hsplists);
+      }
+
+      seq_arg->oid = batch->hsplist_array[0]->oid;
+      seq_arg->encoding = Blast_TracebackGetEncoding(program_number);
+      seq_arg->check_oid_exclusion = TRUE;
+      seq_arg->reset_ranges = FALSE;
+      
+      BlastSequenceBlkClean(seq_arg->seq);
+      if (BlastSeqSrcGetSequence(seq_src, seq_arg) < 0) {
+         Blast_HSPStreamResultBatchReset(batch);
+         return 0;
+      }
+
+      /* If the subject is translated and the BlastSeqSrc implementation
+       * doesn't provide a genetic code string, use the default genetic
+       * code for all subjects (as in the C toolkit) */
+      if (Blast_SubjectIsTranslated(program_number) && 
+          seq_arg->seq->gen_code_string == NULL) {
+         seq_arg->seq->gen_code_string = 
+            GenCodeSingletonFind(default_db_genetic_code);
+         ASSERT(seq_arg->seq->gen_code_string);
+      }
+      
+      if (BlastSeqSrcGetTotLen(seq_src) == 0) {
+         /* This is not a database search, so effective search spaces
+          * need to be recalculated based on this subject sequence 
+          * length.
+          * NB: The initial word parameters structure is not available 
+          * here, so the small gap cutoff score for linking of HSPs will 
+          * not be updated. Since by default linking is done with uneven 
+          * gap statistics, this can only influence a corner non-default 
+          * case, and is a tradeoff for a benefit of not having to deal 
+          * with ungapped extension parameters in the traceback stage.
+          */
+         if ((status = BLAST_OneSubjectUpdateParameters(program_number, 
+                          seq_arg->seq->length, score_params->options, 
+                          query_info, sbp, hit_params, 
+                          NULL, eff_len_params)) != 0) {
+            Blast_HSPStreamResultBatchReset(batch);
+            BlastSeqSrcReleaseSequence(seq_src, seq_arg);
+            return status;
+         }
+      }
+   }
+
+   /* process all the hits to this subject sequence, one
+      list at a time */
+
+   for (i = 0; i < batch->num_hsplists; i++) {
+
+      hsp_list = batch->hsplist_array[i];
+
+      if (perform_traceback) {
+         if (kPhiBlast) {
+            s_PHITracebackFromHSPList(program_number, hsp_list, query, 
+                                      seq_arg->seq, gap_align, sbp, 
+                                      score_params, hit_params, 
+                                      query_info, pattern_blk);
+         } else {
+            Boolean fence_hit = FALSE;
+            Blast_TracebackFromHSPList(program_number, hsp_list, query,
+                                       seq_arg->seq, query_info, 
+                                       gap_align, sbp, score_params,
+                                       ext_params->options, hit_params,
+                                       seq_arg->seq->gen_code_string,
+                                       &fence_hit);
+              
+            if (fence_hit) {
+               /* Disable range support and refetch the 
+                  (whole) subject sequence */
+                  
+               seq_arg->reset_ranges = TRUE;
+               BlastSeqSrcReleaseSequence(seq_src, seq_arg);
+               BlastSeqSrcGetSequence(seq_src, seq_arg);
+                  
+               /* The C toolkit will erase genetic_code, so do it again */
+               if (Blast_SubjectIsTranslated(program_number) && 
+                   seq_arg->seq->gen_code_string == NULL) {
+                   seq_arg->seq->gen_code_string = 
+                       GenCodeSingletonFind(default_db_genetic_code);
+                   ASSERT(seq_arg->seq->gen_code_string);
+               }
+      
+               /* Retry the alignment with fence_hit set*/
+               Blast_TracebackFromHSPList(program_number, hsp_list, 
+                                          query, seq_arg->seq, 
+                                          query_info, gap_align,
+                                          sbp, score_params, 
+                                          ext_params->options, 
+                                          hit_params, 
+                                          seq_arg->seq->gen_code_string,
+                                          &fence_hit);
+               ASSERT(fence_hit == FALSE);
+            } /* fence_hit */
+         }    /* !phi_blast */
+
+      } else {
+         /* traceback skipped; compute bit scores for searches 
+            where the traceback phase is seperated from the 
+            preliminary search. */
+       
+         Blast_HSPListGetBitScores(hsp_list, FALSE, sbp);
+      }
+   
+      /* Free HSP list if all HSPs have been deleted. */
+
+      if (hsp_list->hspcnt == 0) {
+         batch->hsplist_array[i] = Blast_HSPListFree(hsp_list);
+      }
+   }      /* loop over one HSPList batch */
+
+   if (perform_traceback) {
+      BlastSeqSrcReleaseSequence(seq_src, seq_arg);
+   }
+   return status;
+}
+
+/** Save the HSP lists left in a batch by s_TracebackOneSubject in the
+ * results, in the order of the batch, and empty the batch.
+ * @param batch HSP lists for one subject [in] [out]
+ * @param results Results of the traceback [in] [out]
+ * @param hitlist_size Maximal number of subjects to save per query [in]
+ */
+static void
+s_TracebackSaveSubject(BlastHSPStreamResultBatch* batch,
+                       BlastHSPResults* results, Int4 hitlist_size)
+{
+   Int4 i;
+
+   for (i = 0; i < batch->num_hsplists; i++) {
+      if (batch->hsplist_array[i]) {
+         Blast_HSPResultsInsertHSPList(results, batch->hsplist_array[i],
+                                       hitlist_size);
+         batch->hsplist_array[i] = NULL;
+      }
+   }
+}
+
+/** Final processing of the traceback results, shared by the single- and
+ * the multi-threaded traceback: masklevel filtering, sorting by e-value and
+ * pruning to the final hit list size.
+ * @param results Results of the traceback; freed if the search was
+ *                interrupted [in]
+ * @param status Status of the traceback [in]
+ * @param query The query sequence [in]
+ * @param query_info Query information [in]
+ * @param seq_src Source of subject sequences [in]
+ * @param hit_params Hit saving parameters [in]
+ * @param results_out Where to save the results [out]
+ */
+static void
+s_TracebackFinish(BlastHSPResults* results, Int2 status,
+                  BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+                  const BlastSeqSrc* seq_src,
+                  const BlastHitSavingParameters* hit_params,
+                  BlastHSPResults** results_out)
+{
+   // -RMH-: Apply masklevel filter
+   if ( results && hit_params->mask_level < 101 )
+   {
+     //printf("Masklevel being invoked at level: %d\n", hit_params->mask_level );
+                          
+     Int4 totalCnt = 0;   
+     Int4 rmIdx;          
+     Int4 hspIdx;         
+     for ( rmIdx = 0; rmIdx < results->num_queries; rmIdx++ )
+     {                    
+       if ( results->hitlist_array[rmIdx] == NULL )
+         continue;
+       for ( hspIdx = 0; hspIdx < results->hitlist_array[rmIdx]->hsplist_count; hspIdx++ )
+        totalCnt += results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->hspcnt;  
+     }
+     //printf("Before masklevel total = %d\n", totalCnt );
+   
+     Blast_HSPResultsApplyMasklevel( results, query_info,
+                                     hit_params->mask_level, query->length );
+
+     totalCnt = 0;
+     for ( rmIdx = 0; rmIdx < results->num_queries; rmIdx++ )
+     {
+       if ( results->hitlist_array[rmIdx] == NULL )
+         continue;
+       for ( hspIdx = 0; hspIdx < results->hitlist_array[rmIdx]->hsplist_count; hspIdx++ )
+        totalCnt += results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->hspcnt;
+     }
+     //printf("After masklevel total = %d\n", totalCnt );
+   }
+   // -RMH-: end of change
+
+   /* Re-sort the hit lists according to their best e-values, because
+      they could have changed. Only do this for a database search. */
+   if (BlastSeqSrcGetTotLen(seq_src) > 0)
+      Blast_HSPResultsSortByEvalue(results);
+
+   /* Eliminate extra hits from results, if preliminary hit list size is larger
+      than the final hit list size */
+    s_BlastPruneExtraHits(results, hit_params->options->hitlist_size);
+
+    if (status == BLASTERR_INTERRUPTED) {
+        results = Blast_HSPResultsFree(results);
+    }
+
+    *results_out = results;
+}
+
 Int2 
 BLAST_ComputeTraceback(EBlastProgramType program_number, 
                        BlastHSPStream* hsp_stream, BLAST_SequenceBlk* query, 
@@ -1307,7 +1563,6 @@ BLAST_ComputeTraceback(EBlastProgramType program_number,
 {
    Int2 status = 0;
    BlastHSPResults* results = NULL;
-   BlastHSPList* hsp_list = NULL;
    BlastScoreBlk* sbp;
    Int4 default_db_genetic_code = db_options->genetic_code;
  
@@ -1343,12 +1598,7 @@ BLAST_ComputeTraceback(EBlastProgramType program_number,
                                   NULL, hsp_stream, score_params, ext_params, 
                                   hit_params, psi_options, results);
    } else {
-      Int4 i;
       BlastSeqSrcGetSeqArg seq_arg;
-      EBlastEncoding encoding = Blast_TracebackGetEncoding(program_number);
-      Boolean perform_traceback = score_params->options->gapped_calculation;
-      Boolean perform_partial_fetch =  BlastSeqSrcGetSupportsPartialFetching(seq_src);
-      const Boolean kPhiBlast = Blast_ProgramIsPhiBlast(program_number);
       BlastHSPStreamResultBatch *batch = 
                       Blast_HSPStreamResultBatchInit(query_info->num_queries);
 
@@ -1366,135 +1616,16 @@ BLAST_ComputeTraceback(EBlastProgramType program_number,
              break;
          }
 
-         /* traceback will require fetching the subject sequence */
-
-         if (perform_traceback) {
-
-             /* set up partial fetching */
-             if (perform_partial_fetch) {
-                 BLAST_SetupPartialFetching(program_number, 
-                                            (BlastSeqSrc*)seq_src,
-                                            (const BlastHSPList**)batch->hsplist_array,
-                                            batch->num_hsplists);
-            }
-
-            seq_arg.oid = batch->hsplist_array[0]->oid;
-            seq_arg.encoding = encoding;
-            seq_arg.check_oid_exclusion = TRUE;
-            seq_arg.reset_ranges = FALSE;
-            
-            BlastSequenceBlkClean(seq_arg.seq);
-            if (BlastSeqSrcGetSequence(seq_src, &seq_arg) < 0) {
-               Blast_HSPStreamResultBatchReset(batch);
-               continue;
-            }
-
-            /* If the subject is translated and the BlastSeqSrc implementation
-             * doesn't provide a genetic code string, use the default genetic
-             * code for all subjects (as in the C toolkit) */
-            if (Blast_SubjectIsTranslated(program_number) && 
-                seq_arg.seq->gen_code_string == NULL) {
-                seq_arg.seq->gen_code_string = 
-                    GenCodeSingletonFind(default_db_genetic_code);
-                ASSERT(seq_arg.seq->gen_code_string);
-            }
-            
-            if (BlastSeqSrcGetTotLen(seq_src) == 0) {
-               /* This is not a database search, so effective search spaces
-                * need to be recalculated based on this subject sequence 
-                * length.
-                * NB: The initial word parameters structure is not available 
-                * here, so the small gap cutoff score for linking of HSPs will 
-                * not be updated. Since by default linking is done with uneven 
-                * gap statistics, this can only influence a corner non-default 
-                * case, and is a tradeoff for a benefit of not having to deal 
-                * with ungapped extension parameters in the traceback stage.
-                */
-               if ((status = BLAST_OneSubjectUpdateParameters(program_number, 
-                                seq_arg.seq->length, score_params->options, 
-                                query_info, sbp, hit_params, 
-                                NULL, eff_len_params)) != 0) {
-                  Blast_HSPStreamResultBatchReset(batch);
-                  break;
-               }
-            }
-         }
-
-         /* process all the hits to this subject sequence, one
-            list at a time */
-
-         for (i = 0; i < batch->num_hsplists; i++) {
-
-            hsp_list = batch->hsplist_array[i];
-
-            if (perform_traceback) {
-               if (kPhiBlast) {
-                  s_PHITracebackFromHSPList(program_number, hsp_list, query, 
-                                            seq_arg.seq, gap_align, sbp, 
-                                            score_params, hit_params, 
-                                            query_info, pattern_blk);
-               } else {
-                  Boolean fence_hit = FALSE;
-                  Blast_TracebackFromHSPList(program_number, hsp_list, query,
-                                             seq_arg.seq, query_info, 
-                                             gap_align, sbp, score_params,
-                                             ext_params->options, hit_params,
-                                             seq_arg.seq->gen_code_string,
-                                             &fence_hit);
-                    
-                  if (fence_hit) {
-                     /* Disable range support and refetch the 
-                        (whole) subject sequence */
-                        
-                     seq_arg.reset_ranges = TRUE;
-                     BlastSeqSrcReleaseSequence(seq_src, &seq_arg);
-                     BlastSeqSrcGetSequence(seq_src, &seq_arg);
-                        
-                     /* The C toolkit will erase genetic_code, so do it again */
-                     if (Blast_SubjectIsTranslated(program_number) && 
-                         seq_arg.seq->gen_code_string == NULL) {
-                         seq_arg.seq->gen_code_string = 
-                             GenCodeSingletonFind(default_db_genetic_code);
-                         ASSERT(seq_arg.seq->gen_code_string);
-                     }
-            
-                     /* Retry the alignment with fence_hit set*/
-                     Blast_TracebackFromHSPList(program_number, hsp_list, 
-                                                query, seq_arg.seq, 
-                                                query_info, gap_align,
-                                                sbp, score_params, 
-                                                ext_params->options, 
-                                                hit_params, 
-                                                seq_arg.seq->gen_code_string,
-                                                &fence_hit);
-                     ASSERT(fence_hit == FALSE);
-                  } /* fence_hit */
-               }    /* !phi_blast */
-
-            } else {
-               /* traceback skipped; compute bit scores for searches 
-                  where the traceback phase is seperated from the 
-                  preliminary search. */
-             
-               Blast_HSPListGetBitScores(hsp_list, FALSE, sbp);
-            }
-         
-            /* Free HSP list if all HSPs have been deleted. */
-
-            batch->hsplist_array[i] = NULL;
-            if (hsp_list->hspcnt == 0) {
-               hsp_list = Blast_HSPListFree(hsp_list);
-            }
-            else {
-               Blast_HSPResultsInsertHSPList(results, hsp_list, 
-                                          hit_params->options->hitlist_size);
-            }
-         }      /* loop over one HSPList batch */
-
-         if (perform_traceback) {
-            BlastSeqSrcReleaseSequence(seq_src, &seq_arg);
-         }
+         status = s_TracebackOneSubject(program_number, batch, query,
+                                        query_info, seq_src, &seq_arg,
+                                        gap_align, score_params, ext_params,
+                                        hit_params, eff_len_params,
+                                        default_db_genetic_code, pattern_blk);
+         if (status)
+            break;
 
+         s_TracebackSaveSubject(batch, results,
+                                hit_params->options->hitlist_size);
       }         /* loop over all batches */
 
       batch = Blast_HSPStreamResultBatchFree(batch);
@@ -1504,55 +1635,9 @@ BLAST_ComputeTraceback(EBlastProgramType program_number,
       BlastSequenceBlkFree(seq_arg.seq);
    }
 
-
-   // -RMH-: Apply masklevel filter
-   if ( results && hit_params->mask_level < 101 )
-   {
-     //printf("Masklevel being invoked at level: %d\n", hit_params->mask_level );
-                          
-     Int4 totalCnt = 0;   
-     Int4 rmIdx;          
-     Int4 hspIdx;         
-     for ( rmIdx = 0; rmIdx < results->num_queries; rmIdx++ )
-     {                    
-       if ( results->hitlist_array[rmIdx] == NULL )
-         continue;
-       for ( hspIdx = 0; hspIdx < results->hitlist_array[rmIdx]->hsplist_count; hspIdx++ )
-        totalCnt += results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->hspcnt;  
-     }
-     //printf("Before masklevel total = %d\n", totalCnt );
-   
-     Blast_HSPResultsApplyMasklevel( results, query_info,
-                                     hit_params->mask_level, query->length );
-
-     totalCnt = 0;
-     for ( rmIdx = 0; rmIdx < results->num_queries; rmIdx++ )
-     {
-       if ( results->hitlist_array[rmIdx] == NULL )
-         continue;
-       for ( hspIdx = 0; hspIdx < results->hitlist_array[rmIdx]->hsplist_count; hspIdx++ )
-        totalCnt += results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->hspcnt;
-     }
-     //printf("After masklevel total = %d\n", totalCnt );
-   }
-   // -RMH-: end of change
-
-   /* Re-sort the hit lists according to their best e-values, because
-      they could have changed. Only do this for a database search. */
-   if (BlastSeqSrcGetTotLen(seq_src) > 0)
-      Blast_HSPResultsSortByEvalue(results);
-
-   /* Eliminate extra hits from results, if preliminary hit list size is larger
-      than the final hit list size */
-    s_BlastPruneExtraHits(results, hit_params->options->hitlist_size);
-
-    if (status == BLASTERR_INTERRUPTED) {
-        results = Blast_HSPResultsFree(results);
-    }
-
-    *results_out = results;
-
-    return status;
+   s_TracebackFinish(results, status, query, query_info, seq_src,
+                     hit_params, results_out);
+   return status;
 }
 
 Int2 
@@ -1621,3 +1706,386 @@ Blast_RunTracebackSearchWithInterrupt(EBlastProgramType program,
    eff_len_params = BlastEffectiveLengthsParametersFree(eff_len_params);
    return status;
 }
+
+Boolean
+Blast_TracebackSupportsThreads(EBlastProgramType program,
+                               const BlastExtensionOptions* ext_options,
+                               const BlastSeqSrc* seq_src)
+{
+   /* Smith-Waterman alignments consult the best matches saved so far
+      while they are computed; bl2seq searches update the shared search
+      space for every subject */
+   return !Blast_ProgramIsRpsBlast(program) &&
+          !Blast_ProgramIsPhiBlast(program) &&
+          ext_options->eTbackExt != eSmithWatermanTbck &&
+          BlastSeqSrcGetTotLen(seq_src) > 0;
+}
+
+BlastTracebackWork*
+BlastTracebackWorkNew(EBlastProgramType program,
+                      const BlastExtensionOptions* ext_options,
+                      BlastHSPStream* hsp_stream, Int4 num_threads,
+                      MT_LOCK lock)
+{
+   BlastTracebackWork* work;
+   BlastHSPStreamResultBatch* batch = NULL;
+   Int4 num_hsplists;
+
+   ASSERT(num_threads > 0);
+
+   work = (BlastTracebackWork*) calloc(1, sizeof(BlastTracebackWork));
+   if (work == NULL) {
+      MT_LOCK_Delete(lock);
+      return NULL;
+   }
+   work->lock = lock;
+   work->hsp_stream = hsp_stream;
+   work->threads_left = num_threads;
+   work->num_threads = num_threads;
+   work->redo_alignments =
+      (Boolean) (!Blast_ProgramIsRpsBlast(program) &&
+                 (ext_options->compositionBasedStats > 0 ||
+                  ext_options->eTbackExt == eSmithWatermanTbck));
+
+   /* Prohibit any subsequent writing to the HSP stream; this also sorts
+      its HSP lists by subject */
+   BlastHSPStreamClose(hsp_stream);
+   /* Blast_RedoAlignmentWorkNew reads the lists itself */
+   if (work->redo_alignments ||
+       hsp_stream->results == NULL || hsp_stream->num_hsplists == 0)
+      return work;
+
+   num_hsplists = hsp_stream->num_hsplists;
+   work->hsplist_array = (BlastHSPList**)
+      malloc(num_hsplists * sizeof(BlastHSPList*));
+   work->subject_starts = (Int4*) malloc((num_hsplists + 1) * sizeof(Int4));
+   batch = Blast_HSPStreamResultBatchInit(hsp_stream->results->num_queries);
+   if (work->hsplist_array == NULL || work->subject_starts == NULL ||
+       batch == NULL) {
+      Blast_HSPStreamResultBatchFree(batch);
+      return BlastTracebackWorkFree(work);
+   }
+
+   /* Take all HSP lists from the stream, keeping the order in which the
+      single-threaded traceback would have read them */
+   num_hsplists = 0;
+   while (BlastHSPStreamBatchRead(hsp_stream, batch)
+          != kBlastHSPStream_Eof) {
+      work->subject_starts[work->num_subjects++] = num_hsplists;
+      memcpy(work->hsplist_array + num_hsplists, batch->hsplist_array,
+             batch->num_hsplists * sizeof(BlastHSPList*));
+      num_hsplists += batch->num_hsplists;
+   }
+   work->subject_starts[work->num_subjects] = num_hsplists;
+   Blast_HSPStreamResultBatchFree(batch);
+   return work;
+}
+
+BlastTracebackWork*
+BlastTracebackWorkFree(BlastTracebackWork* work)
+{
+   Int4 i;
+
+   if (work == NULL)
+      return NULL;
+
+   /* restores the scoring parameters before they are freed */
+   work->redo_work = Blast_RedoAlignmentWorkFree(work->redo_work);
+   work->score_params = BlastScoringParametersFree(work->score_params);
+   work->hit_params = BlastHitSavingParametersFree(work->hit_params);
+   work->ext_params = BlastExtensionParametersFree(work->ext_params);
+   work->eff_len_params =
+      BlastEffectiveLengthsParametersFree(work->eff_len_params);
+
+   if (work->hsplist_array) {
+      for (i = 0; i < work->subject_starts[work->num_subjects]; i++)
+         Blast_HSPListFree(work->hsplist_array[i]);
+      sfree(work->hsplist_array);
+   }
+   sfree(work->subject_starts);
+   Blast_HSPResultsFree(work->results);
+   work->lock = MT_LOCK_Delete(work->lock);
+   sfree(work);
+   return NULL;
+}
+
+/** Take the next subject whose HSP lists have not been traced back yet.
+ * @param work Shared traceback work [in] [out]
+ * @param status Status of the calling thread, recorded in work if nonzero
+ *               so that the other threads stop [in]
+ * @return Index of the subject, or -1 if the traceback is over
+ */
+static Int4
+s_TracebackWorkNextSubject(BlastTracebackWork* work, Int2 status)
+{
+   Int4 subject = -1;
+
+   MT_LOCK_Do(work->lock, eMT_Lock);
+   if (status != 0 && work->status == 0)
+      work->status = status;
+   if (work->status == 0 && work->next_subject < work->num_subjects)
+      subject = work->next_subject++;
+   MT_LOCK_Do(work->lock, eMT_Unlock);
+   return subject;
+}
+
+/** Record that a traceback thread is done. The last thread to finish saves
+ * all HSP lists in the results, in subject order, so that the results are
+ * identical to those of the single-threaded traceback.
+ * @return TRUE if the calling thread was the last one
+ */
+static Boolean
+s_TracebackWorkThreadDone(BlastTracebackWork* work, Int2 status)
+{
+   Boolean last_thread;
+
+   MT_LOCK_Do(work->lock, eMT_Lock);
+   if (status != 0 && work->status == 0)
+      work->status = status;
+   last_thread = (--work->threads_left == 0);
+   MT_LOCK_Do(work->lock, eMT_Unlock);
+   return last_thread;
+}
+
+/** Set up the parameters shared by the threads of a traceback the way
+ * Blast_RunTracebackSearch would, unless another thread already did. This
+ * computes the effective lengths in query_info and the database length in
+ * sbp, so it is done only once, with work->lock held.
+ * @return Status of the set up, or zero if it was done by another thread
+ */
+static Int2
+s_TracebackWorkSetUp(EBlastProgramType program,
+   BlastQueryInfo* query_info, const BlastSeqSrc* seq_src,
+   const BlastScoringOptions* score_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   BlastScoreBlk* sbp, BlastTracebackWork* work)
+{
+   Int2 status = 0;
+   BlastGapAlignStruct* gap_align = NULL;
+
+   if (work->set_up)
+      return 0;
+
+   work->set_up = TRUE;
+   status =
+      BLAST_GapAlignSetUp(program, seq_src, score_options,
+         eff_len_options, ext_options, hit_options, query_info, sbp,
+         &work->score_params, &work->ext_params, &work->hit_params,
+         &work->eff_len_params, &gap_align);
+   if (gap_align) {
+      /* Do not destruct score block here */
+      gap_align->sbp = NULL;
+      BLAST_GapAlignStructFree(gap_align);
+   }
+   if (status != 0 && work->status == 0)
+      work->status = status;
+   return status;
+}
+
+/** Copy hit saving parameters for one thread of a traceback, so that the
+ * thread may update its cutoffs. The lowest scores used by the preliminary
+ * stage are not copied.
+ * @param params Parameters to copy [in]
+ * @param query_info Query information, giving the number of contexts [in]
+ * @return The copy, or NULL if out of memory
+ */
+static BlastHitSavingParameters*
+s_HitSavingParametersCopy(const BlastHitSavingParameters* params,
+                          const BlastQueryInfo* query_info)
+{
+   BlastHitSavingParameters* copy;
+   Int4 num_contexts = query_info->last_context + 1;
+
+   copy = (BlastHitSavingParameters*) malloc(sizeof(*copy));
+   if (copy == NULL)
+      return NULL;
+   memcpy(copy, params, sizeof(*copy));
+   copy->low_score = NULL;
+   copy->cutoffs = NULL;
+   copy->link_hsp_params = NULL;
+
+   copy->cutoffs = (BlastGappedCutoffs*)
+      malloc(num_contexts * sizeof(BlastGappedCutoffs));
+   if (copy->cutoffs == NULL)
+      return BlastHitSavingParametersFree(copy);
+   memcpy(copy->cutoffs, params->cutoffs,
+          num_contexts * sizeof(BlastGappedCutoffs));
+
+   if (params->link_hsp_params) {
+      copy->link_hsp_params = (BlastLinkHSPParameters*)
+         malloc(sizeof(BlastLinkHSPParameters));
+      if (copy->link_hsp_params == NULL)
+         return BlastHitSavingParametersFree(copy);
+      memcpy(copy->link_hsp_params, params->link_hsp_params,
+             sizeof(BlastLinkHSPParameters));
+   }
+   return copy;
+}
+
+/** Thread of a multi-threaded traceback that recomputes the alignments with
+ * composition-based statistics, see Blast_RunTracebackSearchThread. The
+ * first thread sets up the parameters the way Blast_RunTracebackSearch
+ * would, and reads the HSP lists; the last thread saves the results.
+ */
+static Int2
+s_RedoAlignmentTracebackThread(EBlastProgramType program,
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const BlastDatabaseOptions* db_options,
+   const PSIBlastOptions* psi_options, BlastScoreBlk* sbp,
+   BlastTracebackWork* work, SBlastProgress* progress_info)
+{
+   Int2 status = 0;
+
+   MT_LOCK_Do(work->lock, eMT_Lock);
+   if ( !work->set_up ) {
+      status = s_TracebackWorkSetUp(program, query_info, seq_src,
+                                    score_options, ext_options, hit_options,
+                                    eff_len_options, sbp, work);
+      if (status == 0) {
+         status =
+            Blast_RedoAlignmentWorkNew(program, query, query_info, sbp,
+                                       seq_src, db_options->genetic_code,
+                                       work->hsp_stream, work->score_params,
+                                       work->ext_params, work->hit_params,
+                                       psi_options, work->num_threads,
+                                       MT_LOCK_AddRef(work->lock),
+                                       &work->redo_work);
+      }
+      if (status != 0 && work->status == 0)
+         work->status = status;
+   }
+   MT_LOCK_Do(work->lock, eMT_Unlock);
+
+   if (work->redo_work) {
+      if (progress_info)
+         progress_info->stage = eTracebackSearch;
+      status = Blast_RedoAlignmentThread(work->redo_work, seq_src);
+   }
+
+   /* As in the single-threaded traceback, the results are returned even if
+      recomputing the alignments failed */
+   if (s_TracebackWorkThreadDone(work, status) && work->hit_params) {
+      BlastHSPResults* results = Blast_HSPResultsNew(query_info->num_queries);
+      if (work->redo_work) {
+         status = Blast_RedoAlignmentWorkFinish(work->redo_work, results);
+         work->redo_work = Blast_RedoAlignmentWorkFree(work->redo_work);
+      }
+      s_TracebackFinish(results, work->status, query, query_info, seq_src,
+                        work->hit_params, &work->results);
+   }
+   return status;
+}
+
+Int2
+Blast_RunTracebackSearchThread(EBlastProgramType program,
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const BlastDatabaseOptions* db_options,
+   const PSIBlastOptions* psi_options, BlastScoreBlk* sbp,
+   BlastTracebackWork* work, TInterruptFnPtr interrupt_search,
+   SBlastProgress* progress_info)
+{
+   Int2 status = 0;
+   Int4 subject;
+   BlastScoringParameters score_params;
+   BlastExtensionParameters ext_params;
+   BlastHitSavingParameters* hit_params = NULL;
+   BlastEffectiveLengthsParameters eff_len_params;
+   BlastGapAlignStruct* gap_align = NULL;
+   BlastSeqSrcGetSeqArg seq_arg;
+   BlastHSPStreamResultBatch batch;
+
+   if (work->redo_alignments) {
+      return s_RedoAlignmentTracebackThread(program, query, query_info,
+                                            seq_src, score_options,
+                                            ext_options, hit_options,
+                                            eff_len_options, db_options,
+                                            psi_options, sbp, work,
+                                            progress_info);
+   }
+
+   memset((void*) &seq_arg, 0, sizeof(seq_arg));
+
+   /* The parameters are set up once for all threads; each thread then
+      works on its own copies of them and on its own gapped alignment
+      structure, while the score block is only read by the traceback */
+   MT_LOCK_Do(work->lock, eMT_Lock);
+   s_TracebackWorkSetUp(program, query_info, seq_src, score_options,
+                        ext_options, hit_options, eff_len_options, sbp,
+                        work);
+   status = work->status;
+   if (status == 0) {
+      score_params = *work->score_params;
+      ext_params = *work->ext_params;
+      eff_len_params = *work->eff_len_params;
+      hit_params = s_HitSavingParametersCopy(work->hit_params, query_info);
+      if (hit_params == NULL)
+         status = BLASTERR_MEMORY;
+   }
+   MT_LOCK_Do(work->lock, eMT_Unlock);
+
+   if (status == 0) {
+      status = BLAST_GapAlignStructNew(&score_params, &ext_params,
+                                       BlastSeqSrcGetMaxSeqLen(seq_src),
+                                       sbp, &gap_align);
+   }
+   if (status == 0) {
+      gap_align->gap_x_dropoff = ext_params.gap_x_dropoff_final;
+      if (progress_info)
+         progress_info->stage = eTracebackSearch;
+   }
+
+   while ((subject = s_TracebackWorkNextSubject(work, status)) >= 0) {
+      if (interrupt_search && (*interrupt_search)(progress_info) == TRUE) {
+         status = BLASTERR_INTERRUPTED;
+         continue;
+      }
+
+      /* the HSP lists of the subject are traced back in place */
+      batch.hsplist_array = work->hsplist_array + work->subject_starts[subject];
+      batch.num_hsplists = work->subject_starts[subject + 1] -
+                           work->subject_starts[subject];
+      status = s_TracebackOneSubject(program, &batch, query, query_info,
+                                     seq_src, &seq_arg, gap_align,
+                                     &score_params, &ext_params, hit_params,
+                                     &eff_len_params,
+                                     db_options->genetic_code, NULL);
+   }
+   BlastSequenceBlkFree(seq_arg.seq);
+
+   /* Nothing is saved if any thread failed or was interrupted, as the
+      single-threaded traceback would return no results either; in that
+      case hit_params may be NULL because the set up failed */
+   if (s_TracebackWorkThreadDone(work, status) && work->status == 0) {
+      Int4 i;
+      BlastHSPResults* results = Blast_HSPResultsNew(query_info->num_queries);
+      for (i = 0; i < work->num_subjects; i++) {
+         batch.hsplist_array = work->hsplist_array + work->subject_starts[i];
+         batch.num_hsplists = work->subject_starts[i + 1] -
+                              work->subject_starts[i];
+         s_TracebackSaveSubject(&batch, results,
+                                hit_params->options->hitlist_size);
+      }
+      /* post-traceback pipes */
+      BlastHSPStreamTBackClose(work->hsp_stream, results);
+      s_TracebackFinish(results, 0, query, query_info, seq_src,
+                        work->hit_params, &work->results);
+   }
+
+   if (gap_align) {
+      /* Do not destruct score block here */
+      gap_align->sbp = NULL;
+      BLAST_GapAlignStructFree(gap_align);
+   }
+   hit_params = BlastHitSavingParametersFree(hit_params);
+   return status;
+}
@@ -244,6 +244,10 @@ void BlastSequenceBlkClean(BLAST_SequenceBlk* seq_blk)
        seq_blk->nomask_allocated = FALSE;
    }
    s_BlastSequenceBlkFreeSeqRanges(seq_blk);
+   /* Translations made in advance belong to the BlastSeqSrc */
+   seq_blk->translation_buffer = NULL;
+   seq_blk->frame_offsets = NULL;
+   seq_blk->translation_gen_code = NULL;
    return;
 }
 
@@ -48,6 +48,7 @@ static char const rcsid[] =
 #include <algo/blast/core/lookup_util.h>
 #include <algo/blast/core/blast_rps.h>
 #include <algo/blast/core/blast_encoding.h>
+#include <algo/blast/core/blast_util.h>
 
 Int2 LookupTableWrapInit(BLAST_SequenceBlk* query, 
         const LookupTableOptions* lookup_options,	
@@ -173,11 +174,23 @@ Int2 LookupTableWrapInit(BLAST_SequenceBlk* query,
    return status;
 }
 
+/** Free a lookup table attached to an image by LookupTableWrapImageAttach.
+ * Only the table structure and its masked locations were allocated.
+ * @param lookup The lookup table [in]
+ */
+static void s_LookupTableImageDetach(LookupTableWrap* lookup);
+
 LookupTableWrap* LookupTableWrapFree(LookupTableWrap* lookup)
 {
    if (!lookup)
        return NULL;
 
+   if (lookup->image) {
+      s_LookupTableImageDetach(lookup);
+      sfree(lookup);
+      return NULL;
+   }
+
    switch(lookup->lut_type) {
    case eMBLookupTable:
       lookup->lut = (void*) 
@@ -257,3 +270,514 @@ Int4 GetOffsetArraySize(LookupTableWrap* lookup)
    }
    return offset_array_size;
 }
+
+/*--------------------- Lookup table images ------------------------*/
+
+/** Magic number at the start of a lookup table image ("BLUT" when read
+    on a little-endian machine) */
+#define LOOKUP_TABLE_IMAGE_MAGIC 0x54554c42
+/** Alignment of the arrays of a lookup table image */
+#define LOOKUP_TABLE_IMAGE_ALIGN 64
+/** Largest number of arrays of a lookup table saved in an image */
+#define LOOKUP_TABLE_IMAGE_MAX_ARRAYS 6
+
+/** Header of a lookup table image. The header is followed by a copy of the
+ * lookup table structure, with all its pointers set to NULL, the arrays of
+ * the table and the masked locations, each aligned to
+ * LOOKUP_TABLE_IMAGE_ALIGN bytes. The image is only valid for the library
+ * version, pointer size and byte order it was written with.
+ */
+typedef struct LookupTableImageHeader {
+   Uint4 magic;         /**< LOOKUP_TABLE_IMAGE_MAGIC */
+   Uint4 version;       /**< LOOKUP_TABLE_IMAGE_VERSION */
+   Uint4 pointer_size;  /**< sizeof(void*) of the writer */
+   Uint4 struct_size;   /**< size of the lookup table structure */
+   Uint8 fingerprint;   /**< from LookupTableWrapFingerprint */
+   Uint8 image_size;    /**< size of the whole image */
+   Int4 lut_type;       /**< type of the lookup table */
+   Int4 num_arrays;     /**< number of arrays of the table */
+   Int4 num_masked_locations; /**< number of masked locations */
+   Int4 reserved;       /**< padding, always 0 */
+   Uint8 struct_offset; /**< offset of the lookup table structure */
+   Uint8 masked_offset; /**< offset of the masked locations, stored as
+                             pairs of Int4 */
+   Uint8 array_offsets[LOOKUP_TABLE_IMAGE_MAX_ARRAYS]; /**< offset of each
+                                                            array */
+   Uint8 array_sizes[LOOKUP_TABLE_IMAGE_MAX_ARRAYS]; /**< size in bytes of
+                                                          each array */
+} LookupTableImageHeader;
+
+/** Round an offset in a lookup table image up to the alignment of its
+ * arrays */
+#define LOOKUP_TABLE_IMAGE_ROUND(x) \
+   (((x) + LOOKUP_TABLE_IMAGE_ALIGN - 1) & ~((Uint8)LOOKUP_TABLE_IMAGE_ALIGN - 1))
+
+/** Find the arrays of a lookup table that are saved in its image.
+ * @param lut_type Type of the lookup table [in]
+ * @param lut The lookup table [in]
+ * @param query_length Length of the query the table was built for [in]
+ * @param arrays Address of the pointer to each array in lut [out]
+ * @param sizes Size in bytes of each array [out]
+ * @param struct_size Size of the lookup table structure [out]
+ * @param masked Address of the masked locations of lut, or NULL if the
+ *               table has none [out]
+ * @return Number of arrays, or -1 if the table cannot be saved
+ */
+static Int4
+s_LookupTableImageArrays(ELookupTableType lut_type, void* lut,
+                         Int4 query_length, void** arrays[], Uint8 sizes[],
+                         size_t* struct_size, BlastSeqLoc*** masked)
+{
+   Int4 n = 0;
+
+   switch (lut_type) {
+   case eSmallNaLookupTable:
+      {
+         BlastSmallNaLookupTable* lookup = (BlastSmallNaLookupTable*) lut;
+         arrays[n] = (void**) &lookup->final_backbone;
+         sizes[n++] = (Uint8) lookup->backbone_size * sizeof(Int2);
+         arrays[n] = (void**) &lookup->overflow;
+         sizes[n++] = (Uint8) lookup->overflow_size * sizeof(Int2);
+         *struct_size = sizeof(BlastSmallNaLookupTable);
+         *masked = &lookup->masked_locations;
+      }
+      break;
+
+   case eNaLookupTable:
+      {
+         BlastNaLookupTable* lookup = (BlastNaLookupTable*) lut;
+         arrays[n] = (void**) &lookup->thick_backbone;
+         sizes[n++] = (Uint8) lookup->backbone_size *
+                      sizeof(NaLookupBackboneCell);
+         arrays[n] = (void**) &lookup->overflow;
+         sizes[n++] = (Uint8) lookup->overflow_size * sizeof(Int4);
+         arrays[n] = (void**) &lookup->pv;
+         sizes[n++] = (Uint8) ((lookup->backbone_size >> PV_ARRAY_BTS) + 1) *
+                      sizeof(PV_ARRAY_TYPE);
+         *struct_size = sizeof(BlastNaLookupTable);
+         *masked = &lookup->masked_locations;
+      }
+      break;
+
+   case eMBLookupTable:
+      {
+         BlastMBLookupTable* lookup = (BlastMBLookupTable*) lut;
+         arrays[n] = (void**) &lookup->hashtable;
+         sizes[n++] = (Uint8) lookup->hashsize * sizeof(Int4);
+         arrays[n] = (void**) &lookup->next_pos;
+         sizes[n++] = (Uint8) (query_length + 1) * sizeof(Int4);
+         if (lookup->two_templates) {
+            arrays[n] = (void**) &lookup->hashtable2;
+            sizes[n++] = (Uint8) lookup->hashsize * sizeof(Int4);
+            arrays[n] = (void**) &lookup->next_pos2;
+            sizes[n++] = (Uint8) (query_length + 1) * sizeof(Int4);
+         }
+         arrays[n] = (void**) &lookup->pv_array;
+         sizes[n++] = (Uint8) (lookup->hashsize >> lookup->pv_array_bts) *
+                      PV_ARRAY_BYTES;
+         *struct_size = sizeof(BlastMBLookupTable);
+         *masked = &lookup->masked_locations;
+      }
+      break;
+
+   case eAaLookupTable:
+      {
+         BlastAaLookupTable* lookup = (BlastAaLookupTable*) lut;
+         Boolean small_bone = (Boolean) (lookup->bone_type == eSmallbone);
+         if (lookup->thin_backbone != NULL)
+            return -1;      /* not finalized */
+         arrays[n] = (void**) &lookup->thick_backbone;
+         sizes[n++] = (Uint8) lookup->backbone_size *
+                      (small_bone ? sizeof(AaLookupSmallboneCell)
+                                  : sizeof(AaLookupBackboneCell));
+         arrays[n] = (void**) &lookup->overflow;
+         sizes[n++] = (Uint8) lookup->overflow_size *
+                      (small_bone ? sizeof(Uint2) : sizeof(Int4));
+         arrays[n] = (void**) &lookup->pv;
+         sizes[n++] = (Uint8) ((lookup->backbone_size >> PV_ARRAY_BTS) + 1) *
+                      sizeof(PV_ARRAY_TYPE);
+         *struct_size = sizeof(BlastAaLookupTable);
+         *masked = NULL;
+      }
+      break;
+
+   default:
+      return -1;
+   }
+   ASSERT(n <= LOOKUP_TABLE_IMAGE_MAX_ARRAYS);
+   return n;
+}
+
+/** Size of the structure of a lookup table that can be saved as an image.
+ * @param lut_type Type of the lookup table [in]
+ * @return sizeof the lookup table structure, or 0 if tables of this type
+ *         cannot be saved
+ */
+static size_t
+s_LookupTableImageStructSize(ELookupTableType lut_type)
+{
+   switch (lut_type) {
+   case eSmallNaLookupTable:
+      return sizeof(BlastSmallNaLookupTable);
+   case eNaLookupTable:
+      return sizeof(BlastNaLookupTable);
+   case eMBLookupTable:
+      return sizeof(BlastMBLookupTable);
+   case eAaLookupTable:
+      return sizeof(BlastAaLookupTable);
+   default:
+      return 0;
+   }
+}
+
+/** Clear the pointers of a lookup table that do not point to its arrays:
+ * the search callbacks, which are chosen again for every search, and the
+ * masked locations.
+ * @param lut_type Type of the lookup table [in]
+ * @param lut The lookup table [in] [out]
+ */
+static void
+s_LookupTableImageClearPointers(ELookupTableType lut_type, void* lut)
+{
+   switch (lut_type) {
+   case eSmallNaLookupTable:
+      ((BlastSmallNaLookupTable*) lut)->scansub_callback = NULL;
+      ((BlastSmallNaLookupTable*) lut)->extend_callback = NULL;
+      ((BlastSmallNaLookupTable*) lut)->masked_locations = NULL;
+      break;
+   case eNaLookupTable:
+      ((BlastNaLookupTable*) lut)->scansub_callback = NULL;
+      ((BlastNaLookupTable*) lut)->extend_callback = NULL;
+      ((BlastNaLookupTable*) lut)->masked_locations = NULL;
+      break;
+   case eMBLookupTable:
+      ((BlastMBLookupTable*) lut)->scansub_callback = NULL;
+      ((BlastMBLookupTable*) lut)->extend_callback = NULL;
+      ((BlastMBLookupTable*) lut)->masked_locations = NULL;
+      break;
+   case eAaLookupTable:
+      ((BlastAaLookupTable*) lut)->scansub_callback = NULL;
+      break;
+   default:
+      break;
+   }
+}
+
+/** Layout of the image of a lookup table.
+ * @param lookup The lookup table [in]
+ * @param query The query the table was built for [in]
+ * @param header Header of the image, with all sizes and offsets [out]
+ * @param arrays Address of the pointer to each array of the table [out]
+ * @return 0 on success, -1 if the table cannot be saved
+ */
+static Int2
+s_LookupTableImageLayout(const LookupTableWrap* lookup,
+                         const BLAST_SequenceBlk* query,
+                         LookupTableImageHeader* header, void** arrays[])
+{
+   Int4 i;
+   Int4 num_arrays;
+   size_t struct_size = 0;
+   BlastSeqLoc** masked = NULL;
+   BlastSeqLoc* loc;
+   Uint8 offset;
+
+   if (lookup == NULL || lookup->lut == NULL || lookup->image != NULL ||
+       query == NULL)
+      return -1;
+
+   memset(header, 0, sizeof(*header));
+   num_arrays = s_LookupTableImageArrays(lookup->lut_type, lookup->lut,
+                                         query->length, arrays,
+                                         header->array_sizes, &struct_size,
+                                         &masked);
+   if (num_arrays < 0)
+      return -1;
+
+   header->magic = LOOKUP_TABLE_IMAGE_MAGIC;
+   header->version = LOOKUP_TABLE_IMAGE_VERSION;
+   header->pointer_size = sizeof(void*);
+   header->struct_size = (Uint4) struct_size;
+   header->lut_type = lookup->lut_type;
+   header->num_arrays = num_arrays;
+   if (masked) {
+      for (loc = *masked; loc; loc = loc->next)
+         header->num_masked_locations++;
+   }
+
+   offset = LOOKUP_TABLE_IMAGE_ROUND(sizeof(LookupTableImageHeader));
+   header->struct_offset = offset;
+   offset = LOOKUP_TABLE_IMAGE_ROUND(offset + struct_size);
+   for (i = 0; i < num_arrays; i++) {
+      header->array_offsets[i] = offset;
+      offset = LOOKUP_TABLE_IMAGE_ROUND(offset + header->array_sizes[i]);
+   }
+   header->masked_offset = offset;
+   offset += (Uint8) header->num_masked_locations * 2 * sizeof(Int4);
+   header->image_size = offset;
+   return 0;
+}
+
+/** Mix data into an FNV-1a hash.
+ * @param hash The hash so far [in]
+ * @param data The data to mix in [in]
+ * @param size Size of the data in bytes [in]
+ * @return The new hash
+ */
+static Uint8
+s_FingerprintAdd(Uint8 hash, const void* data, size_t size)
+{
+   const Uint1* bytes = (const Uint1*) data;
+   size_t i;
+
+   for (i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ULL;
+   }
+   return hash;
+}
+
+Uint8 LookupTableWrapFingerprint(const BLAST_SequenceBlk* query,
+        const LookupTableOptions* lookup_options,
+        const QuerySetUpOptions* query_options,
+        const BlastSeqLoc* lookup_segments, const BlastScoreBlk* sbp)
+{
+   Uint8 hash = 0xcbf29ce484222325ULL;
+   Int4 version = LOOKUP_TABLE_IMAGE_VERSION;
+   Int4 value;
+   const BlastSeqLoc* loc;
+
+   hash = s_FingerprintAdd(hash, &version, sizeof(version));
+
+   /* options */
+   hash = s_FingerprintAdd(hash, &lookup_options->threshold,
+                           sizeof(lookup_options->threshold));
+   value = lookup_options->lut_type;
+   hash = s_FingerprintAdd(hash, &value, sizeof(value));
+   hash = s_FingerprintAdd(hash, &lookup_options->word_size,
+                           sizeof(lookup_options->word_size));
+   hash = s_FingerprintAdd(hash, &lookup_options->mb_template_length,
+                           sizeof(lookup_options->mb_template_length));
+   hash = s_FingerprintAdd(hash, &lookup_options->mb_template_type,
+                           sizeof(lookup_options->mb_template_type));
+   value = lookup_options->program_number;
+   hash = s_FingerprintAdd(hash, &value, sizeof(value));
+   /* masking at hash saves the masked locations in the table */
+   value = query_options &&
+           (SBlastFilterOptionsMaskAtHash(query_options->filtering_options) ||
+            (query_options->filter_string &&
+             strstr(query_options->filter_string, "m")));
+   hash = s_FingerprintAdd(hash, &value, sizeof(value));
+
+   /* query words */
+   if (query) {
+      hash = s_FingerprintAdd(hash, &query->length, sizeof(query->length));
+      if (query->sequence)
+         hash = s_FingerprintAdd(hash, query->sequence, query->length);
+   }
+   for (loc = lookup_segments; loc; loc = loc->next) {
+      hash = s_FingerprintAdd(hash, loc->ssr, sizeof(SSeqRange));
+   }
+
+   /* neighboring words of protein tables depend on the scores */
+   if (sbp && (lookup_options->lut_type == eAaLookupTable ||
+               lookup_options->lut_type == eCompressedAaLookupTable)) {
+      const SBlastScoreMatrix* matrix =
+         (sbp->psi_matrix && sbp->psi_matrix->pssm) ?
+            sbp->psi_matrix->pssm : sbp->matrix;
+      size_t i;
+      if (matrix && matrix->data) {
+         for (i = 0; i < matrix->ncols; i++) {
+            hash = s_FingerprintAdd(hash, matrix->data[i],
+                                    matrix->nrows * sizeof(int));
+         }
+      }
+   }
+   return hash;
+}
+
+size_t LookupTableWrapImageSize(const LookupTableWrap* lookup,
+                                const BLAST_SequenceBlk* query)
+{
+   LookupTableImageHeader header;
+   void** arrays[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+
+   if (s_LookupTableImageLayout(lookup, query, &header, arrays) != 0)
+      return 0;
+   return (size_t) header.image_size;
+}
+
+Int2 LookupTableWrapImageWrite(const LookupTableWrap* lookup,
+                               const BLAST_SequenceBlk* query,
+                               Uint8 fingerprint, void* image,
+                               size_t image_size)
+{
+   LookupTableImageHeader header;
+   void** arrays[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   void** image_arrays[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   Uint8 image_sizes[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   size_t struct_size;
+   BlastSeqLoc** masked = NULL;
+   BlastSeqLoc* loc;
+   Uint1* bytes = (Uint1*) image;
+   void* lut_copy;
+   Int4* pairs;
+   Int4 i;
+
+   if (s_LookupTableImageLayout(lookup, query, &header, arrays) != 0 ||
+       image == NULL || image_size < header.image_size)
+      return -1;
+
+   header.fingerprint = fingerprint;
+   memset(image, 0, (size_t) header.image_size);
+   memcpy(bytes, &header, sizeof(header));
+
+   for (i = 0; i < header.num_arrays; i++) {
+      if (header.array_sizes[i] > 0) {
+         memcpy(bytes + header.array_offsets[i], *arrays[i],
+                (size_t) header.array_sizes[i]);
+      }
+   }
+
+   s_LookupTableImageArrays(lookup->lut_type, lookup->lut, query->length,
+                            arrays, image_sizes, &struct_size, &masked);
+   pairs = (Int4*) (bytes + header.masked_offset);
+   if (masked) {
+      for (loc = *masked; loc; loc = loc->next) {
+         *pairs++ = loc->ssr->left;
+         *pairs++ = loc->ssr->right;
+      }
+   }
+
+   /* the copy of the table structure keeps no pointers of this process */
+   lut_copy = bytes + header.struct_offset;
+   memcpy(lut_copy, lookup->lut, struct_size);
+   s_LookupTableImageArrays(lookup->lut_type, lut_copy, query->length,
+                            image_arrays, image_sizes, &struct_size,
+                            &masked);
+   for (i = 0; i < header.num_arrays; i++)
+      *image_arrays[i] = NULL;
+   s_LookupTableImageClearPointers(lookup->lut_type, lut_copy);
+   return 0;
+}
+
+Int2 LookupTableWrapImageAttach(const void* image, size_t image_size,
+                                Uint8 fingerprint, BLAST_SequenceBlk* query,
+                                LookupTableWrap** lookup_wrap_ptr)
+{
+   LookupTableImageHeader header;
+   void** arrays[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   Uint8 sizes[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   size_t struct_size = 0;
+   BlastSeqLoc** masked = NULL;
+   const Uint1* bytes = (const Uint1*) image;
+   LookupTableWrap* lookup_wrap;
+   void* lut;
+   Int4 num_arrays;
+   Int4 i;
+
+   *lookup_wrap_ptr = NULL;
+   if (image == NULL || query == NULL || image_size < sizeof(header))
+      return -1;
+
+   memcpy(&header, image, sizeof(header));
+   if (header.magic != LOOKUP_TABLE_IMAGE_MAGIC ||
+       header.version != LOOKUP_TABLE_IMAGE_VERSION ||
+       header.pointer_size != sizeof(void*) ||
+       header.fingerprint != fingerprint ||
+       header.image_size != (Uint8) image_size ||
+       header.num_arrays < 0 ||
+       header.num_arrays > LOOKUP_TABLE_IMAGE_MAX_ARRAYS ||
+       header.num_masked_locations < 0)
+      return -1;
+
+   /* validate every region of the image before allocating or reading
+      anything; the comparisons are written so that they cannot overflow */
+   if (header.struct_size == 0 ||
+       header.struct_size != s_LookupTableImageStructSize(
+                                   (ELookupTableType) header.lut_type) ||
+       header.struct_offset > header.image_size ||
+       header.struct_size > header.image_size - header.struct_offset ||
+       header.masked_offset > header.image_size ||
+       (Uint8) header.num_masked_locations * 2 * sizeof(Int4) >
+          header.image_size - header.masked_offset)
+      return -1;
+   for (i = 0; i < header.num_arrays; i++) {
+      if (header.array_offsets[i] > header.image_size ||
+          header.array_sizes[i] >
+             header.image_size - header.array_offsets[i])
+         return -1;
+   }
+
+   lut = calloc(1, header.struct_size);
+   if (lut == NULL)
+      return -1;
+   memcpy(lut, bytes + header.struct_offset, header.struct_size);
+
+   /* the table must be the one saved by this version of the library */
+   num_arrays = s_LookupTableImageArrays((ELookupTableType) header.lut_type,
+                                         lut, query->length, arrays, sizes,
+                                         &struct_size, &masked);
+   if (num_arrays != header.num_arrays ||
+       struct_size != header.struct_size) {
+      sfree(lut);
+      return -1;
+   }
+   for (i = 0; i < num_arrays; i++) {
+      if (sizes[i] != header.array_sizes[i]) {
+         sfree(lut);
+         return -1;
+      }
+      *arrays[i] = (sizes[i] > 0) ?
+                   (void*) (bytes + header.array_offsets[i]) : NULL;
+   }
+
+   if (masked) {
+      const Int4* pairs = (const Int4*) (bytes + header.masked_offset);
+      BlastSeqLoc* tail = NULL;
+      for (i = 0; i < header.num_masked_locations; i++, pairs += 2) {
+         tail = BlastSeqLocNew(tail ? &tail : masked, pairs[0], pairs[1]);
+      }
+   }
+
+   *lookup_wrap_ptr = lookup_wrap =
+      (LookupTableWrap*) calloc(1, sizeof(LookupTableWrap));
+   if (lookup_wrap == NULL) {
+      if (masked)
+         *masked = BlastSeqLocFree(*masked);
+      sfree(lut);
+      return -1;
+   }
+   lookup_wrap->lut_type = (ELookupTableType) header.lut_type;
+   lookup_wrap->lut = lut;
+   lookup_wrap->image = image;
+
+   /* prepare the query as building the table would have, unless it was
+      already prepared for another table */
+   if (lookup_wrap->lut_type == eSmallNaLookupTable &&
+       query->compressed_nuc_seq_start == NULL)
+      BlastCompressBlastnaSequence(query);
+   return 0;
+}
+
+static void s_LookupTableImageDetach(LookupTableWrap* lookup)
+{
+   void** arrays[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   Uint8 sizes[LOOKUP_TABLE_IMAGE_MAX_ARRAYS];
+   size_t struct_size;
+   BlastSeqLoc** masked = NULL;
+
+   if (lookup->lut) {
+      s_LookupTableImageArrays(lookup->lut_type, lookup->lut, 0, arrays,
+                               sizes, &struct_size, &masked);
+      if (masked && *masked)
+         *masked = BlastSeqLocFree(*masked);
+      sfree(lookup->lut);
+   }
+   if (lookup->image_release) {
+      ((T_LookupTableImageRelease) lookup->image_release)
+                                                   (lookup->image_owner);
+   }
+   lookup->image = NULL;
+   lookup->image_owner = NULL;
+}
@@ -1633,8 +1633,11 @@ Int2 BlastNaWordFinder(BLAST_SequenceBlk * subject,
     ASSERT(extend);
 
     while(s_DetermineScanningOffsets(subject, word_length, lut_word_length, scan_range)) {
+        Int8 scan_start = ewp->scan_ticks ? Blast_StageClock() : 0;
 
         hitsfound = scansub(lookup_wrap, subject, offset_pairs, max_hits, &scan_range[1]);
+        if (ewp->scan_ticks)
+            *ewp->scan_ticks += Blast_StageClock() - scan_start;
 
         if (hitsfound == 0)
             continue;
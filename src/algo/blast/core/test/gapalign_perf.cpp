@@ -0,0 +1,333 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file gapalign_perf.cpp
+ * Command line tool to compare the scalar and vectorized score-only gapped
+ * extensions of nucleotide seeds on synthetic sequences.
+ */
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbitime.hpp>
+#include <util/random_gen.hpp>
+
+#include <algo/blast/core/blast_options.h>
+#include <algo/blast/core/blast_parameters.h>
+#include <algo/blast/core/blast_setup.h>
+#include <algo/blast/core/blast_gapalign.h>
+#include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/blast_simd.h>
+#include "../blast_gapalign_priv.h"
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+USING_NCBI_SCOPE;
+#endif
+
+/// A seed to extend: the query and subject sequences on both sides of it
+struct SGapAlignSeed {
+    vector<Uint1> query;        ///< Query, blastna, one letter per byte
+    vector<Uint1> subject;      ///< Subject, ncbi2na, four letters per byte
+    int length;                 ///< Length of both sides of the subject
+};
+
+/// The application class
+class CGapAlignPerfApp : public CNcbiApplication
+{
+public:
+    /** @inheritDoc */
+    CGapAlignPerfApp()
+        : m_ScoringOptions(NULL), m_ExtensionOptions(NULL), m_Sbp(NULL),
+          m_ScoreParams(NULL), m_GapAlign(NULL) {}
+private:
+    /** @inheritDoc */
+    virtual void Init();
+    /** @inheritDoc */
+    virtual int Run();
+    /** @inheritDoc */
+    virtual void Exit();
+
+    BlastScoringOptions* m_ScoringOptions;      ///< Scoring options
+    BlastExtensionOptions* m_ExtensionOptions;  ///< Extension options
+    BlastScoreBlk* m_Sbp;                       ///< Scoring matrix
+    BlastScoringParameters* m_ScoreParams;      ///< Gap costs
+    BlastGapAlignStruct* m_GapAlign;            ///< Extension memory
+
+    /// Set up the scoring and the gapped extension structures
+    void x_InitScoring();
+
+    /// Create seeds whose sides are copies of random query sequence with
+    /// substitutions, insertions and deletions
+    /// @param identity percentage of identical letters [in]
+    /// @param rng random number generator [in]
+    /// @param seeds seeds created [out]
+    void x_InitSeeds(int identity, CRandom& rng,
+                     vector<SGapAlignSeed>& seeds);
+
+    /// Extend all seeds in both directions with the extension currently
+    /// selected
+    /// @param seeds the seeds [in]
+    /// @param checksum set to a digest of the scores and end points [out]
+    /// @return the sum of the scores
+    Int8 x_Extend(vector<SGapAlignSeed>& seeds, Uint8& checksum);
+
+    /// Benchmark one identity
+    /// @param identity percentage of identical letters [in]
+    /// @param rng random number generator [in]
+    /// @return true if scalar and vector extensions agree and the vector
+    ///         code ran where the CPU supports it
+    bool x_RunIdentity(int identity, CRandom& rng);
+};
+
+void CGapAlignPerfApp::x_InitScoring()
+{
+    const CArgs& args = GetArgs();
+
+    BlastScoringOptionsNew(eBlastTypeBlastn, &m_ScoringOptions);
+    BLAST_FillScoringOptions(m_ScoringOptions, eBlastTypeBlastn, FALSE,
+                             args["penalty"].AsInteger(),
+                             args["reward"].AsInteger(), NULL,
+                             args["gapopen"].AsInteger(),
+                             args["gapextend"].AsInteger());
+    m_Sbp = BlastScoreBlkNew(BLASTNA_SEQ_CODE, 1);
+    Blast_ScoreBlkMatrixInit(eBlastTypeBlastn, m_ScoringOptions, m_Sbp, NULL);
+    BlastScoringParametersNew(m_ScoringOptions, m_Sbp, &m_ScoreParams);
+
+    BlastExtensionOptionsNew(eBlastTypeBlastn, &m_ExtensionOptions, TRUE);
+    m_ExtensionOptions->ePrelimGapExt = eDynProgScoreOnly;
+    BlastExtensionParameters ext_params;
+    memset(&ext_params, 0, sizeof(ext_params));
+    ext_params.options = m_ExtensionOptions;
+    ext_params.gap_x_dropoff = args["xdrop"].AsInteger();
+    BLAST_GapAlignStructNew(m_ScoreParams, &ext_params, 0, m_Sbp,
+                            &m_GapAlign);
+}
+
+void CGapAlignPerfApp::x_InitSeeds(int identity, CRandom& rng,
+                                   vector<SGapAlignSeed>& seeds)
+{
+    const CArgs& args = GetArgs();
+    // both sides are a whole number of packed bytes, as the subject is
+    // packed from the start of a database sequence
+    const int kLength = args["length"].AsInteger() / COMPRESSION_RATIO
+                        * COMPRESSION_RATIO;
+
+    seeds.resize(args["seeds"].AsInteger());
+    NON_CONST_ITERATE(vector<SGapAlignSeed>, seed, seeds) {
+        // the forward extension reads query[1..], the reverse extension
+        // query[..length-1]; one extra letter on each side, and room for
+        // the insertions of the subject
+        const int kQueryLength = 2 * kLength + 2;
+        seed->query.resize(kQueryLength);
+        for (int i = 0; i < kQueryLength; i++) {
+            seed->query[i] = (Uint1) rng.GetRand(0, 3);
+        }
+
+        // the subject byte before the first one is read by the forward
+        // extension only as padding
+        seed->length = kLength;
+        seed->subject.assign(kLength / COMPRESSION_RATIO + 1, 0);
+        int q = 1;
+        for (int i = 0; i < kLength; i++) {
+            int base;
+            const int kEvent = rng.GetRand(0, 999);
+            if (kEvent < 5) {
+                q += rng.GetRand(1, 3);             // deletion
+            }
+            if (kEvent >= 5 && kEvent < 10) {
+                base = rng.GetRand(0, 3);           // insertion
+            } else {
+                base = (q < kQueryLength && (int) rng.GetRand(0, 99) < identity)
+                       ? seed->query[q] : rng.GetRand(0, 3);
+                q++;
+            }
+            seed->subject[1 + i / COMPRESSION_RATIO] |=
+                base << (2 * (COMPRESSION_RATIO - 1 - i % COMPRESSION_RATIO));
+        }
+    }
+}
+
+Int8
+CGapAlignPerfApp::x_Extend(vector<SGapAlignSeed>& seeds, Uint8& checksum)
+{
+    Int8 total_score = 0;
+
+    checksum = 0;
+    NON_CONST_ITERATE(vector<SGapAlignSeed>, seed, seeds) {
+        const Int4 kQueryLength = seed->query.size() - 2;
+        for (int reverse = 0; reverse < 2; reverse++) {
+            Int4 a_offset = 0, b_offset = 0;
+            // the reverse extension reads the subject backwards from
+            // its end, which is a byte boundary
+            Uint1* subject = reverse ? &seed->subject[1] : &seed->subject[0];
+            Int4 score = Blast_AlignPackedNucl(&seed->query[0], subject,
+                                               kQueryLength, seed->length,
+                                               &b_offset, &a_offset,
+                                               m_GapAlign, m_ScoreParams,
+                                               reverse ? TRUE : FALSE);
+            checksum = checksum * 31 + score;
+            checksum = checksum * 31 + a_offset;
+            checksum = checksum * 31 + b_offset;
+            total_score += score;
+        }
+    }
+    return total_score;
+}
+
+bool CGapAlignPerfApp::x_RunIdentity(int identity, CRandom& rng)
+{
+    const int kIterations = GetArgs()["iterations"].AsInteger();
+    vector<SGapAlignSeed> seeds;
+    x_InitSeeds(identity, rng, seeds);
+
+    const EBlastSimdLevel kLevels[] = { eBlastSimdNone, eBlastSimdAVX2 };
+    Int8 score[2] = { 0, 0 };
+    Uint8 checksum[2] = { 0, 0 };
+    double rate[2] = { 0.0, 0.0 };
+    Int8 blocks[2] = { 0, 0 };
+
+    for (int i = 0; i < 2; i++) {
+        BlastSimd_SetMaxLevel(kLevels[i]);
+        Int8 start_blocks = m_GapAlign->simd_blocks;
+        CStopWatch sw(CStopWatch::eStart);
+        for (int j = 0; j < kIterations; j++) {
+            score[i] = x_Extend(seeds, checksum[i]);
+        }
+        rate[i] = 2.0 * seeds.size() * kIterations / sw.Elapsed();
+        blocks[i] = m_GapAlign->simd_blocks - start_blocks;
+    }
+    BlastSimd_SetMaxLevel(eBlastSimdAVX2);
+
+    cout << setw(9) << identity << setw(7) << seeds.size()
+         << setw(12) << score[0] / (2 * (Int8) seeds.size())
+         << setiosflags(ios::fixed) << setprecision(0)
+         << setw(13) << rate[0] << setw(13) << rate[1]
+         << setw(9) << setprecision(2) << rate[1] / rate[0]
+         << setw(14) << setprecision(0)
+         << blocks[1] / (2.0 * seeds.size() * kIterations) << endl;
+
+    if (blocks[0] != 0 ||
+        (BlastSimd_GetLevel() >= eBlastSimdSSE41 && blocks[1] == 0)) {
+        LOG_POST(Error << "Vector extension ran " << blocks[1]
+                 << " blocks with vector code enabled and " << blocks[0]
+                 << " with it disabled");
+        return false;
+    }
+    return score[0] == score[1] && checksum[0] == checksum[1];
+}
+
+void CGapAlignPerfApp::Init()
+{
+    HideStdArgs(fHideConffile | fHideFullVersion | fHideXmlHelp | fHideDryRun);
+
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                  "Nucleotide gapped extension performance testing client");
+
+    arg_desc->SetCurrentGroup("Seed options");
+    arg_desc->AddDefaultKey("identities", "list",
+                            "Comma-separated list of percent identities of "
+                            "the seed sets",
+                            CArgDescriptions::eString, "60,70,80,90,95,99");
+    arg_desc->AddDefaultKey("seeds", "num", "Number of seeds per set",
+                            CArgDescriptions::eInteger, "200");
+    arg_desc->AddDefaultKey("length", "length",
+                            "Length of the subject on each side of a seed",
+                            CArgDescriptions::eInteger, "2000");
+    arg_desc->AddDefaultKey("seed", "seed", "Random number generator seed",
+                            CArgDescriptions::eInteger, "1");
+
+    arg_desc->SetCurrentGroup("Scoring options");
+    arg_desc->AddDefaultKey("reward", "score", "Reward for a match",
+                            CArgDescriptions::eInteger, "2");
+    arg_desc->AddDefaultKey("penalty", "score", "Penalty for a mismatch",
+                            CArgDescriptions::eInteger, "-3");
+    arg_desc->AddDefaultKey("gapopen", "cost", "Cost to open a gap",
+                            CArgDescriptions::eInteger, "5");
+    arg_desc->AddDefaultKey("gapextend", "cost", "Cost to extend a gap",
+                            CArgDescriptions::eInteger, "2");
+    arg_desc->AddDefaultKey("xdrop", "score", "Raw X-dropoff of the "
+                            "extension", CArgDescriptions::eInteger, "30");
+
+    arg_desc->AddDefaultKey("iterations", "num",
+                            "Number of extensions of each seed per "
+                            "measurement", CArgDescriptions::eInteger, "5");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+int CGapAlignPerfApp::Run(void)
+{
+    const CArgs& args = GetArgs();
+    int status = 0;
+
+    cout << "Vector level supported: " << (int)BlastSimd_GetLevel() << endl;
+    if (BlastSimd_GetLevel() < eBlastSimdSSE41) {
+        cout << "Vector extension unavailable; both columns are scalar"
+             << endl;
+    }
+
+    x_InitScoring();
+    CRandom rng(args["seed"].AsInteger());
+
+    list<string> identities;
+    NStr::Split(args["identities"].AsString(), ",", identities);
+
+    cout << " identity  seeds  mean score  scalar ext/s  vector ext/s  "
+         << "speedup  vector blocks/ext" << endl;
+    ITERATE(list<string>, it, identities) {
+        int identity = NStr::StringToInt(*it);
+        if ( !x_RunIdentity(identity, rng) ) {
+            LOG_POST(Error << "Vector extension failed for "
+                     << identity << "% identity");
+            status = 1;
+        }
+    }
+    return status;
+}
+
+void CGapAlignPerfApp::Exit(void)
+{
+    m_GapAlign = BLAST_GapAlignStructFree(m_GapAlign);
+    m_ScoreParams = BlastScoringParametersFree(m_ScoreParams);
+    m_Sbp = BlastScoreBlkFree(m_Sbp);
+    m_ExtensionOptions = BlastExtensionOptionsFree(m_ExtensionOptions);
+    m_ScoringOptions = BlastScoringOptionsFree(m_ScoringOptions);
+}
+
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+int main(int argc, const char* argv[] /*, const char* envp[]*/)
+{
+    return CGapAlignPerfApp().AppMain(argc, argv, 0, eDS_Default, 0);
+}
+#endif /* SKIP_DOXYGEN_PROCESSING */
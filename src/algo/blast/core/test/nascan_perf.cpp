@@ -0,0 +1,320 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file nascan_perf.cpp
+ * Command line tool to compare the scalar and vectorized nucleotide subject
+ * scanners on synthetic sequences.
+ */
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbitime.hpp>
+#include <util/random_gen.hpp>
+
+#include <algo/blast/core/blast_options.h>
+#include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/blast_filter.h>
+#include <algo/blast/core/blast_nalookup.h>
+#include <algo/blast/core/blast_nascan.h>
+#include <algo/blast/core/lookup_wrap.h>
+#include <algo/blast/core/blast_simd.h>
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+USING_NCBI_SCOPE;
+#endif
+
+/// The application class
+class CNaScanPerfApp : public CNcbiApplication
+{
+public:
+    /** @inheritDoc */
+    CNaScanPerfApp() : m_Query(NULL), m_Subject(NULL) {}
+private:
+    /** @inheritDoc */
+    virtual void Init();
+    /** @inheritDoc */
+    virtual int Run();
+    /** @inheritDoc */
+    virtual void Exit();
+
+    /// Query sequence, in blastna with sentinels
+    BLAST_SequenceBlk* m_Query;
+    /// Subject sequence, in ncbi2na
+    BLAST_SequenceBlk* m_Subject;
+
+    /// Creates random query and subject sequences; copies of query
+    /// fragments are planted in the subject so that it contains hits
+    void x_InitSequences();
+
+    /// Scan the whole subject with the scanner currently selected for the
+    /// lookup table
+    /// @param lookup_wrap lookup table to use [in]
+    /// @param offset_pairs hit array [in]
+    /// @param checksum set to a digest of all hits found [out]
+    /// @return number of hits found
+    Int8 x_Scan(LookupTableWrap* lookup_wrap, BlastOffsetPair* offset_pairs,
+                Uint8& checksum);
+
+    /// Benchmark one word size
+    /// @param word_size the word size [in]
+    /// @param megablast true if a megablast lookup table is wanted [in]
+    /// @return true if scalar and vector scanners agree
+    bool x_RunWordSize(int word_size, bool megablast);
+};
+
+void CNaScanPerfApp::x_InitSequences()
+{
+    const CArgs& args = GetArgs();
+    const int kQueryLength = args["query_length"].AsInteger();
+    const int kSubjectLength = args["subject_length"].AsInteger();
+    const int kFragmentLength = 64;
+    CRandom rng(args["seed"].AsInteger());
+
+    Uint1* query = (Uint1*)malloc(kQueryLength + 2);
+    query[0] = query[kQueryLength + 1] = 0x0f;    // sentinels
+    for (int i = 1; i <= kQueryLength; i++) {
+        query[i] = (Uint1)rng.GetRand(0, 3);
+    }
+    BlastSeqBlkNew(&m_Query);
+    BlastSeqBlkSetSequence(m_Query, query, kQueryLength);
+
+    vector<Uint1> subject(kSubjectLength);
+    for (int i = 0; i < kSubjectLength; i++) {
+        subject[i] = (Uint1)rng.GetRand(0, 3);
+    }
+    for (int i = 0; i < kSubjectLength / 1000; i++) {
+        int len = min(kFragmentLength, kQueryLength);
+        int q = rng.GetRand(0, kQueryLength - len);
+        int s = rng.GetRand(0, kSubjectLength - len);
+        copy(query + 1 + q, query + 1 + q + len, subject.begin() + s);
+    }
+
+    Uint1* packed = (Uint1*)calloc(kSubjectLength / COMPRESSION_RATIO + 1, 1);
+    for (int i = 0; i < kSubjectLength; i++) {
+        packed[i / COMPRESSION_RATIO] |=
+            subject[i] << (2 * (COMPRESSION_RATIO - 1 - i % COMPRESSION_RATIO));
+    }
+    BlastSeqBlkNew(&m_Subject);
+    m_Subject->length = kSubjectLength;
+    BlastSeqBlkSetCompressedSequence(m_Subject, packed);
+}
+
+Int8
+CNaScanPerfApp::x_Scan(LookupTableWrap* lookup_wrap,
+                       BlastOffsetPair* offset_pairs, Uint8& checksum)
+{
+    void* callback = NULL;
+    Int4 lut_word_length = 0;
+
+    switch (lookup_wrap->lut_type) {
+    case eMBLookupTable: {
+        BlastMBLookupTable* lut = (BlastMBLookupTable*)lookup_wrap->lut;
+        callback = lut->scansub_callback;
+        lut_word_length = lut->lut_word_length;
+        break;
+    }
+    case eSmallNaLookupTable: {
+        BlastSmallNaLookupTable* lut =
+            (BlastSmallNaLookupTable*)lookup_wrap->lut;
+        callback = lut->scansub_callback;
+        lut_word_length = lut->lut_word_length;
+        break;
+    }
+    default: {
+        BlastNaLookupTable* lut = (BlastNaLookupTable*)lookup_wrap->lut;
+        callback = lut->scansub_callback;
+        lut_word_length = lut->lut_word_length;
+        break;
+    }
+    }
+
+    TNaScanSubjectFunction scansub = (TNaScanSubjectFunction)callback;
+    const Int4 kMaxHits = GetOffsetArraySize(lookup_wrap);
+    Int4 scan_range[2] = { 0, m_Subject->length - lut_word_length };
+    Int8 total_hits = 0;
+
+    checksum = 0;
+    while (scan_range[0] <= scan_range[1]) {
+        Int4 hits = scansub(lookup_wrap, m_Subject, offset_pairs, kMaxHits,
+                            scan_range);
+        for (Int4 i = 0; i < hits; i++) {
+            checksum = checksum * 31 + offset_pairs[i].qs_offsets.q_off;
+            checksum = checksum * 31 + offset_pairs[i].qs_offsets.s_off;
+        }
+        total_hits += hits;
+    }
+    return total_hits;
+}
+
+bool CNaScanPerfApp::x_RunWordSize(int word_size, bool megablast)
+{
+    const int kIterations = GetArgs()["iterations"].AsInteger();
+    LookupTableOptions* lookup_options = NULL;
+    LookupTableWrap* lookup_wrap = NULL;
+    BlastSeqLoc* lookup_segments = NULL;
+
+    LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+    BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                 megablast, 0, word_size);
+    BlastSeqLocNew(&lookup_segments, 0, m_Query->length - 1);
+    LookupTableWrapInit(m_Query, lookup_options, NULL, lookup_segments, NULL,
+                        &lookup_wrap, NULL, NULL);
+
+    Int4 lut_word_length = 0, scan_step = 0;
+    const char* table = NULL;
+    switch (lookup_wrap->lut_type) {
+    case eMBLookupTable:
+        table = "megablast";
+        lut_word_length =
+            ((BlastMBLookupTable*)lookup_wrap->lut)->lut_word_length;
+        scan_step = ((BlastMBLookupTable*)lookup_wrap->lut)->scan_step;
+        break;
+    case eSmallNaLookupTable:
+        table = "small";
+        lut_word_length =
+            ((BlastSmallNaLookupTable*)lookup_wrap->lut)->lut_word_length;
+        scan_step = ((BlastSmallNaLookupTable*)lookup_wrap->lut)->scan_step;
+        break;
+    default:
+        table = "standard";
+        lut_word_length =
+            ((BlastNaLookupTable*)lookup_wrap->lut)->lut_word_length;
+        scan_step = ((BlastNaLookupTable*)lookup_wrap->lut)->scan_step;
+        break;
+    }
+
+    vector<BlastOffsetPair> offset_pairs(GetOffsetArraySize(lookup_wrap));
+    const EBlastSimdLevel kLevels[] = { eBlastSimdNone, eBlastSimdAVX2 };
+    Int8 hits[2] = { 0, 0 };
+    Uint8 checksum[2] = { 0, 0 };
+    double rate[2] = { 0.0, 0.0 };
+
+    for (int i = 0; i < 2; i++) {
+        BlastSimd_SetMaxLevel(kLevels[i]);
+        BlastChooseNucleotideScanSubject(lookup_wrap);
+        CStopWatch sw(CStopWatch::eStart);
+        for (int j = 0; j < kIterations; j++) {
+            hits[i] = x_Scan(lookup_wrap, &offset_pairs[0], checksum[i]);
+        }
+        rate[i] = (double)m_Subject->length * kIterations / sw.Elapsed();
+    }
+    BlastSimd_SetMaxLevel(eBlastSimdAVX2);
+
+    cout << setw(5) << word_size << setw(11) << table
+         << setw(5) << lut_word_length << setw(6) << scan_step
+         << setw(11) << hits[0]
+         << setiosflags(ios::fixed) << setprecision(1)
+         << setw(12) << rate[0] / 1e6 << setw(12) << rate[1] / 1e6
+         << setw(9) << setprecision(2) << rate[1] / rate[0] << endl;
+
+    lookup_wrap = LookupTableWrapFree(lookup_wrap);
+    lookup_segments = BlastSeqLocFree(lookup_segments);
+    lookup_options = LookupTableOptionsFree(lookup_options);
+
+    return hits[0] == hits[1] && checksum[0] == checksum[1];
+}
+
+void CNaScanPerfApp::Init()
+{
+    HideStdArgs(fHideConffile | fHideFullVersion | fHideXmlHelp | fHideDryRun);
+
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                  "Nucleotide subject scanner performance testing client");
+
+    arg_desc->SetCurrentGroup("Sequence options");
+    arg_desc->AddDefaultKey("query_length", "length",
+                            "Length of the random query",
+                            CArgDescriptions::eInteger, "2000");
+    arg_desc->AddDefaultKey("subject_length", "length",
+                            "Length of the random subject",
+                            CArgDescriptions::eInteger, "20000000");
+    arg_desc->AddDefaultKey("seed", "seed", "Random number generator seed",
+                            CArgDescriptions::eInteger, "1");
+
+    arg_desc->SetCurrentGroup("Scan options");
+    arg_desc->AddDefaultKey("word_sizes", "list",
+                            "Comma-separated list of word sizes",
+                            CArgDescriptions::eString,
+                            "7,8,9,10,11,12,13,16,20,24,28");
+    arg_desc->AddFlag("megablast", "Use megablast lookup tables where "
+                      "the word size allows", true);
+    arg_desc->AddDefaultKey("iterations", "num",
+                            "Number of scans of the subject per measurement",
+                            CArgDescriptions::eInteger, "5");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+int CNaScanPerfApp::Run(void)
+{
+    const CArgs& args = GetArgs();
+    int status = 0;
+
+    cout << "Vector level supported: " << (int)BlastSimd_GetLevel() << endl;
+    if (BlastSimd_GetLevel() < eBlastSimdAVX2) {
+        cout << "Vector scanners unavailable; both columns are scalar"
+             << endl;
+    }
+
+    x_InitSequences();
+
+    list<string> word_sizes;
+    NStr::Split(args["word_sizes"].AsString(), ",", word_sizes);
+
+    cout << " word      table  lut  step       hits  scalar Mb/s  "
+         << "vector Mb/s  speedup" << endl;
+    ITERATE(list<string>, it, word_sizes) {
+        int word_size = NStr::StringToInt(*it);
+        if ( !x_RunWordSize(word_size, args["megablast"]) ) {
+            LOG_POST(Error << "Scalar and vector hits differ for word size "
+                     << word_size);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+void CNaScanPerfApp::Exit(void)
+{
+    m_Query = BlastSequenceBlkFree(m_Query);
+    m_Subject = BlastSequenceBlkFree(m_Subject);
+}
+
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+int main(int argc, const char* argv[] /*, const char* envp[]*/)
+{
+    return CNaScanPerfApp().AppMain(argc, argv, 0, eDS_Default, 0);
+}
+#endif /* SKIP_DOXYGEN_PROCESSING */
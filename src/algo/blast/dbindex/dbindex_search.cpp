@@ -36,6 +36,10 @@
 #include <algorithm>
 
 #include <corelib/ncbifile.hpp>
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbi_safe_static.hpp>
+#include <util/thread_pool.hpp>
+#include <util/thread_pool_ctrl.hpp>
 
 #include <algo/blast/core/blast_extend.h>
 #include <algo/blast/core/blast_gapalign.h>
@@ -192,6 +196,18 @@ struct SSeedRoot
     TSeqPos qstop_;     /**< 1 + end of the corresponding query interval. */
 };
 
+/** Part of a query location scanned for seed roots. */
+struct SQueryRange
+{
+    TSeqPos qstart_;    /**< Start of the query location. */
+    TSeqPos qstop_;     /**< 1 + end of the query location. */
+    TSeqPos start_;     /**< First query position of the part. */
+    TSeqPos stop_;      /**< 1 + last query position of the part. */
+};
+
+/** Parts of the query scanned for seed roots, in query order. */
+typedef std::vector< SQueryRange > TQueryRanges;
+
 /** SSeedRoot container for one subject. */
 struct SSubjRootsInfo
 {
@@ -871,16 +887,26 @@ class CSearch_Base
         /**@}*/
 
         /** Object constructor.
-            @param index_impl   [I]     the index implementation object
-            @param query        [I]     query data encoded in BLASTNA
-            @param locs         [I]     set of query locations to search
-            @param options      [I]     search options
+            @param index_impl    [I]     the index implementation object
+            @param query         [I]     query data encoded in BLASTNA
+            @param locs          [I]     set of query locations to search
+            @param options       [I]     search options
+            @param first_subject [I]     first logical subject to compute
+                                         the seeds for
+            @param end_subject   [I]     one past the last logical subject
+                                         to compute the seeds for
+            @param collect_roots [I]     whether the object collects
+                                         seed roots itself; roots are
+                                         collected for all subjects of
+                                         the index
         */
         CSearch_Base( 
                 const TIndex_Impl & index_impl,
                 const BLAST_SequenceBlk * query,
                 const BlastSeqLoc * locs,
-                const TSearchOptions & options );
+                const TSearchOptions & options,
+                TSeqNum first_subject, TSeqNum end_subject,
+                bool collect_roots = true );
 
         /** Performs the search.
             @return the set of seeds matching the query to the sequences
@@ -888,6 +914,42 @@ class CSearch_Base
         */
         CConstRef< CDbIndex::CSearchResults > operator()();
 
+        /** Search all query locations and compute the seeds for the
+            logical subjects handled by this object.
+        */
+        void Search();
+
+        /** Collect the seed roots of some parts of the query, without
+            computing the seeds. The roots are kept until ResetRoots()
+            is called.
+            @param ranges       [I]     parts of the query to scan
+        */
+        void CollectRoots( const TQueryRanges & ranges );
+
+        /** Get the seed roots collected by this object.
+            @return roots of all subjects of the index
+        */
+        const CSeedRoots & GetRoots() const { return roots_; }
+
+        /** Drop the seed roots collected by this object. */
+        void ResetRoots() { roots_.Reset(); }
+
+        /** Compute the seeds of the logical subjects handled by this
+            object from the roots collected by another object.
+            Roots collected by several objects must be processed in
+            query order.
+            @param roots        [I]     roots of all subjects of the index
+        */
+        void ComputeSeeds( const CSeedRoots & roots );
+
+        /** Move the seeds computed by Search() to a result set.
+            Only the entries of the logical subjects handled by this object
+            are set, so several objects searching disjoint subject ranges
+            can fill the same result set concurrently.
+            @param result       [I/O]   result set for the whole index
+        */
+        void SaveResults( CDbIndex::CSearchResults & result );
+
     protected:
 
         typedef STrackedSeed< NHITS > TTrackedSeed;     /**< Alias for convenience. */
@@ -899,8 +961,12 @@ class CSearch_Base
 
         /** Helper method to search a particular segment of the query. 
             The segment is taken from state of the search object.
+            Only the Nmers ending in [start, stop) are looked up.
+            @param start        [I]     first query position to search
+            @param stop         [I]     one past the last query position
+                                        to search
         */
-        void SearchInt();
+        void SearchInt( TSeqPos start, TSeqPos stop );
 
         /** Process a seed candidate that is close to the masked out
             or ambigous region of the subject.
@@ -940,7 +1006,7 @@ class CSearch_Base
                 TTrackedSeed & seed, TSeqPos nmax = ~(TSeqPos)0 ) const;
 
         /** Compute the seeds after all roots are collected. */
-        void ComputeSeeds();
+        void ComputeSeeds() { ComputeSeeds( roots_ ); }
 
         /** Process a single root.
             @param seeds        [I/O]   information on currently tracked seeds
@@ -953,6 +1019,8 @@ class CSearch_Base
         const BLAST_SequenceBlk * query_;       /**< The query sequence encoded in BLASTNA. */
         const BlastSeqLoc * locs_;              /**< Set of query locations to search. */
         TSearchOptions options_;                /**< Search options. */
+        TSeqNum first_subject_;  /**< First logical subject to compute the seeds for. */
+        TSeqNum end_subject_;    /**< One past the last logical subject to compute the seeds for. */
 
         TTrackedSeedsSet seeds_; /**< The set of currently tracked seeds. */
         TSeqNum subject_;        /**< Logical id of the subject sequence containing the offset
@@ -977,18 +1045,22 @@ CSearch_Base< LEGACY, NHITS, derived_t >::CSearch_Base(
         const TIndex_Impl & index_impl,
         const BLAST_SequenceBlk * query,
         const BlastSeqLoc * locs,
-        const TSearchOptions & options )
+        const TSearchOptions & options,
+        TSeqNum first_subject, TSeqNum end_subject,
+        bool collect_roots )
     : index_impl_( index_impl ), query_( query ), locs_( locs ),
-      options_( options ), subject_( 0 ), subj_end_off_( 0 ),
-      roots_( index_impl_.NumSubjects() ),
+      options_( options ), 
+      first_subject_( first_subject ), end_subject_( end_subject ),
+      subject_( 0 ), subj_end_off_( 0 ),
+      roots_( collect_roots ? index_impl.NumSubjects() : 1 ),
       code_bits_( GetCodeBits( index_impl.GetSubjectMap().GetStride() ) ),
       min_offset_( GetMinOffset( index_impl.GetSubjectMap().GetStride() ) )
 {
     seeds_.resize( 
-            index_impl_.NumSubjects() - 1, 
+            end_subject_ - first_subject_, 
             TTrackedSeeds( index_impl_.GetSubjectMap(), options ) );
     for( typename TTrackedSeedsSet::size_type i = 0; i < seeds_.size(); ++i ) {
-        seeds_[i].SetLId( (TSeqNum)i );
+        seeds_[i].SetLId( first_subject_ + (TSeqNum)i );
     }
 }
 
@@ -1146,7 +1218,7 @@ void CSearch_Base< LEGACY, NHITS, derived_t >::ProcessBoundaryOffset(
     TSeqPos nmaxright = (TSeqPos)(bounds&((1<<code_bits_) - 1));
     TTrackedSeed seed( 
             qoff_, (TSeqPos)offset, index_impl_.hkey_width(), qoff_ );
-    TTrackedSeeds & subj_seeds = seeds_[subject_];
+    TTrackedSeeds & subj_seeds = seeds_[subject_ - first_subject_];
     subj_seeds.EvalAndUpdate( seed );
 
     if( nmaxleft > 0 ) {
@@ -1178,7 +1250,7 @@ void CSearch_Base< LEGACY, NHITS, derived_t >::ProcessOffset( TWord offset )
 {
     TTrackedSeed seed(
         qoff_, (TSeqPos)offset, index_impl_.hkey_width(), qoff_ );
-    TTrackedSeeds & subj_seeds = seeds_[subject_];
+    TTrackedSeeds & subj_seeds = seeds_[subject_ - first_subject_];
 
     if( subj_seeds.EvalAndUpdate( seed ) ) {
         ExtendLeft( seed );
@@ -1221,31 +1293,30 @@ unsigned long CSearch_Base< LEGACY, NHITS, derived_t >::ProcessRoot(
 //-------------------------------------------------------------------------
 template< bool LEGACY, unsigned long NHITS, typename derived_t >
 INLINE
-void CSearch_Base< LEGACY, NHITS, derived_t >::ComputeSeeds()
+void CSearch_Base< LEGACY, NHITS, derived_t >::ComputeSeeds( 
+        const CSeedRoots & roots )
 {
-    TSeqNum num_subjects = index_impl_.NumSubjects() - 1;
-
-    for( subject_ = 0; subject_ < num_subjects; ++subject_ ) {
+    for( subject_ = first_subject_; subject_ < end_subject_; ++subject_ ) {
         TDerived * self = static_cast< TDerived * >( this );
         self->SetSubjInfo();
-        TTrackedSeeds & seeds = seeds_[subject_];
-        const SSubjRootsInfo & rinfo = roots_.GetSubjInfo( subject_ );
+        TTrackedSeeds & seeds = seeds_[subject_ - first_subject_];
+        const SSubjRootsInfo & rinfo = roots.GetSubjInfo( subject_ );
 
         if( rinfo.len_ > 0 ) {
-            const SSeedRoot * roots = roots_.GetSubjRoots( subject_ );
+            const SSeedRoot * subj_roots = roots.GetSubjRoots( subject_ );
             qoff_ = 0;
 
             for( unsigned long j = 0; j < rinfo.len_; ) {
-                j += ProcessRoot( seeds, roots + j );
+                j += ProcessRoot( seeds, subj_roots + j );
             }
 
             if( rinfo.extra_roots_ != 0 ) {
                 typedef SSubjRootsInfo::TRoots TRoots;
-                roots = &(*rinfo.extra_roots_)[0];
+                subj_roots = &(*rinfo.extra_roots_)[0];
 
                 for( TRoots::size_type j = 0; 
                         j < rinfo.extra_roots_->size(); ) {
-                    j += ProcessRoot( seeds, roots + j );
+                    j += ProcessRoot( seeds, subj_roots + j );
                 }
             }
         }
@@ -1257,10 +1328,16 @@ void CSearch_Base< LEGACY, NHITS, derived_t >::ComputeSeeds()
 //-------------------------------------------------------------------------
 template< bool LEGACY, unsigned long NHITS, typename derived_t >
 INLINE
-void CSearch_Base< LEGACY, NHITS, derived_t >::SearchInt()
+void CSearch_Base< LEGACY, NHITS, derived_t >::SearchInt( 
+        TSeqPos start, TSeqPos stop )
 {
+    // Start early enough for the first Nmer to end at start.
+    //
+    unsigned long hkey_width = index_impl_.hkey_width();
+    TSeqPos nmer_start = (start < qstart_ + hkey_width - 1) 
+        ? qstart_ : start - (TSeqPos)(hkey_width - 1);
     CNmerIterator nmer_it( 
-            index_impl_.hkey_width(), query_->sequence, qstart_, qstop_ );
+            hkey_width, query_->sequence, nmer_start, stop );
 
     while( nmer_it.Next() ) {
         typename TIndex_Impl::TOffsetIterator off_it( 
@@ -1291,7 +1368,10 @@ void CSearch_Base< LEGACY, NHITS, derived_t >::SearchInt()
             }
         }
 
-        if( roots_.Overflow() ) {
+        // Objects that only collect roots keep them all until the
+        // caller computes the seeds.
+        //
+        if( !seeds_.empty() && roots_.Overflow() ) {
             TSeqPos old_qstart = qstart_;
             TSeqPos old_qstop  = qstop_;
 
@@ -1306,8 +1386,7 @@ void CSearch_Base< LEGACY, NHITS, derived_t >::SearchInt()
 
 //-------------------------------------------------------------------------
 template< bool LEGACY, unsigned long NHITS, typename derived_t >
-CConstRef< CDbIndex::CSearchResults > 
-CSearch_Base< LEGACY, NHITS, derived_t >::operator()()
+void CSearch_Base< LEGACY, NHITS, derived_t >::Search()
 {
     const BlastSeqLoc * curloc = locs_;
 
@@ -1316,31 +1395,64 @@ CSearch_Base< LEGACY, NHITS, derived_t >::operator()()
             qstart_ = curloc->ssr->left;
             qstop_  = curloc->ssr->right + 1;
             // cerr << "SEGMENT: " << qstart_ << " - " << qstop_ << endl;
-            SearchInt();
+            SearchInt( qstart_, qstop_ );
         }
 
         curloc = curloc->next;
     }
 
     ComputeSeeds();
+}
+
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS, typename derived_t >
+void CSearch_Base< LEGACY, NHITS, derived_t >::CollectRoots( 
+        const TQueryRanges & ranges )
+{
+    ITERATE( TQueryRanges, it, ranges ) {
+        qstart_ = it->qstart_;
+        qstop_  = it->qstop_;
+        SearchInt( it->start_, it->stop_ );
+    }
+}
+
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS, typename derived_t >
+void CSearch_Base< LEGACY, NHITS, derived_t >::SaveResults( 
+        CDbIndex::CSearchResults & result )
+{
     const TSubjectMap & subject_map = index_impl_.GetSubjectMap();
-    CRef< CDbIndex::CSearchResults > result( 
-            new CDbIndex::CSearchResults( 
-                options_.word_size,
-                0, index_impl_.NumChunks(), subject_map.GetSubjectMap(), 
-                index_impl_.StopSeq() - index_impl_.StartSeq() ) );
+    TSeqNum k = 1;
 
-    for( typename TTrackedSeedsSet::size_type i = 0, k = 1; 
+    for( TSeqNum i = 0; i < first_subject_; ++i ) {
+        k += subject_map.GetNumChunks( i );
+    }
+
+    for( typename TTrackedSeedsSet::size_type i = 0; 
             i < seeds_.size(); ++i ) {
         seeds_[i].Finalize();
-        TSeqNum nchunks = subject_map.GetNumChunks( (TSeqNum)i );
+        TSeqNum nchunks = 
+            subject_map.GetNumChunks( first_subject_ + (TSeqNum)i );
 
         for( TSeqNum j = 0; j < nchunks; ++j ) {
-            result->SetResults( 
-                    (TSeqNum)(k++), seeds_[i].GetHitList( j ) );
+            result.SetResults( k++, seeds_[i].GetHitList( j ) );
         }
     }
+}
 
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS, typename derived_t >
+CConstRef< CDbIndex::CSearchResults > 
+CSearch_Base< LEGACY, NHITS, derived_t >::operator()()
+{
+    Search();
+    const TSubjectMap & subject_map = index_impl_.GetSubjectMap();
+    CRef< CDbIndex::CSearchResults > result( 
+            new CDbIndex::CSearchResults( 
+                options_.word_size,
+                0, index_impl_.NumChunks(), subject_map.GetSubjectMap(), 
+                index_impl_.StopSeq() - index_impl_.StartSeq() ) );
+    SaveResults( *result );
     return result;
 }
 
@@ -1368,13 +1480,22 @@ class CSearch
             @param query        [I]     query data encoded in BLASTNA
             @param locs         [I]     set of query locations to search
             @param options      [I]     search options
+            @param first_subject [I]    first logical subject to compute
+                                        the seeds for
+            @param end_subject  [I]     one past the last logical subject
+                                        to compute the seeds for
+            @param collect_roots [I]    whether the object collects seed
+                                        roots itself
         */
         CSearch( 
                 const TIndex_Impl & index_impl,
                 const BLAST_SequenceBlk * query,
                 const BlastSeqLoc * locs,
-                const TSearchOptions & options )
-            : TBase( index_impl, query, locs, options )
+                const TSearchOptions & options,
+                TSeqNum first_subject, TSeqNum end_subject,
+                bool collect_roots = true )
+            : TBase( index_impl, query, locs, options, 
+                     first_subject, end_subject, collect_roots )
         {}
 
 
@@ -1407,6 +1528,453 @@ class CSearch
         }
 };
 
+//-------------------------------------------------------------------------
+/** Pool of threads shared by all multi-threaded index searches.
+
+    The threads are started by the first multi-threaded search and reused
+    by the later ones, e.g. the searches of the other index volumes.
+*/
+class CSearchPool
+{
+    public:
+
+        /** Part of a search run by a pool thread. */
+        class CTask : public CThreadPool_Task
+        {
+            friend class CSearchPool;
+
+            public:
+
+                /** Object constructor. */
+                CTask() : done_( 0 ) {}
+
+                /** Get the error that stopped the task.
+                    @return error message, or an empty string if the
+                            task succeeded
+                */
+                const std::string & GetError() const { return error_; }
+
+            protected:
+
+                /** Do the work of the task. */
+                virtual void Run() = 0;
+
+            private:
+
+                /** Run the task and signal its completion.
+                    @return status of the task
+                */
+                virtual EStatus Execute();
+
+                CSemaphore * done_;     /**< Posted when the task is finished. */
+                std::string error_;     /**< Error that stopped the task. */
+        };
+
+        /** Alias for convenience. */
+        typedef std::vector< CRef< CTask > > TTasks;
+
+        /** Run a set of tasks in the pool threads and wait for all of
+            them to finish.
+            @param tasks        [I]     tasks to run
+            @param n_threads    [I]     the pool is grown to at least this
+                                        number of threads
+        */
+        void Run( TTasks & tasks, unsigned long n_threads );
+
+    private:
+
+        /** Max number of tasks waiting for a thread. */
+        static const unsigned int QUEUE_SIZE = 1024;
+
+        CFastMutex mutex_;                              /**< Guards creation and growth of the pool. */
+        CRef< CThreadPool_Controller > controller_;     /**< Number of threads in the pool. */
+        auto_ptr< CThreadPool > pool_;                  /**< The pool, created by the first search. */
+};
+
+//-------------------------------------------------------------------------
+CThreadPool_Task::EStatus CSearchPool::CTask::Execute()
+{
+    try { Run(); }
+    catch( std::exception & e ) { error_ = e.what(); }
+    catch( ... ) { error_ = "unknown error"; }
+
+    EStatus status = error_.empty() ? eCompleted : eFailed;
+    done_->Post();
+    return status;
+}
+
+//-------------------------------------------------------------------------
+void CSearchPool::Run( TTasks & tasks, unsigned long n_threads )
+{
+    if( tasks.empty() ) return;
+    CThreadPool * pool = 0;
+
+    {{
+        CFastMutexGuard guard( mutex_ );
+        unsigned int n = (unsigned int)n_threads;
+
+        if( pool_.get() == 0 ) {
+            controller_.Reset( new CThreadPool_Controller_PID( n, n ) );
+            pool_.reset( new CThreadPool(
+                        QUEUE_SIZE, controller_.GetPointer() ) );
+        }
+        else if( controller_->GetMaxThreads() < n ) {
+            controller_->SetMaxThreads( n );
+            controller_->SetMinThreads( n );
+        }
+
+        pool = pool_.get();
+    }}
+
+    CSemaphore done( 0, (unsigned int)tasks.size() );
+    TTasks::size_type n_added = 0;
+
+    try {
+        for( ; n_added < tasks.size(); ++n_added ) {
+            tasks[n_added]->done_ = &done;
+            pool->AddTask( tasks[n_added].GetPointer() );
+        }
+    }
+    catch( ... ) {
+        for( ; n_added > 0; --n_added ) done.Wait();
+        throw;
+    }
+
+    for( ; n_added > 0; --n_added ) done.Wait();
+
+    ITERATE( TTasks, it, tasks ) {
+        if( !(*it)->GetError().empty() ) {
+            NCBI_THROW( CException, eUnknown,
+                        "index search failed: " + (*it)->GetError() );
+        }
+    }
+}
+
+/** The threads used by multi-threaded index searches. */
+static CSafeStaticPtr< CSearchPool > s_SearchPool;
+
+//-------------------------------------------------------------------------
+/** Search of an index with several threads.
+
+    The search runs in rounds. In each round the threads first scan
+    consecutive parts of the query, each thread walking the offset lists
+    of the Nmers of its own part and collecting the seed roots for all
+    subjects. Then each thread computes the seeds of a range of logical
+    subjects of about the same total length from the roots of all parts,
+    in query order, so the seeds found are the same as those of a single
+    threaded search. The length of the query scanned in a round is
+    limited to bound the memory used by the roots.
+*/
+template< bool LEGACY, unsigned long NHITS >
+class CThreadedSearch
+{
+    /** @name Convenience declarations. */
+    /**@{*/
+    typedef CSearch< LEGACY, NHITS > TSearch;
+    typedef CDbIndex_Impl< LEGACY > TIndex_Impl;
+    typedef typename TIndex_Impl::TSubjectMap TSubjectMap;
+    typedef CDbIndex::SSearchOptions TSearchOptions;
+    typedef std::vector< TSearch * > TSearches;
+    /**@}*/
+
+    public:
+
+        /** Object constructor.
+            @param index_impl   [I]     the index implementation object
+            @param query        [I]     query data encoded in BLASTNA
+            @param locs         [I]     set of query locations to search
+            @param options      [I]     search options
+        */
+        CThreadedSearch(
+                const TIndex_Impl & index_impl,
+                const BLAST_SequenceBlk * query,
+                const BlastSeqLoc * locs,
+                const TSearchOptions & options );
+
+        /** Object destructor. */
+        ~CThreadedSearch() { CleanUp(); }
+
+        /** Performs the search.
+            @return the set of seeds matching the query to the sequences
+                    present in the index
+        */
+        CConstRef< CDbIndex::CSearchResults > operator()();
+
+    private:
+
+        /** Task collecting the seed roots of some parts of the query. */
+        class CRootsTask : public CSearchPool::CTask
+        {
+            public:
+
+                /** Object constructor.
+                    @param scanner      [I/O]   object collecting the roots
+                    @param ranges       [I]     parts of the query to scan
+                */
+                CRootsTask( TSearch & scanner, const TQueryRanges & ranges )
+                    : scanner_( scanner ), ranges_( ranges )
+                {}
+
+            protected:
+
+                /** Replace the roots of the previous round. */
+                virtual void Run()
+                {
+                    scanner_.ResetRoots();
+                    scanner_.CollectRoots( ranges_ );
+                }
+
+            private:
+
+                TSearch & scanner_;     /**< Object collecting the roots. */
+                TQueryRanges ranges_;   /**< Parts of the query to scan. */
+        };
+
+        /** Task computing the seeds of a range of subjects. */
+        class CSeedsTask : public CSearchPool::CTask
+        {
+            public:
+
+                /** Object constructor.
+                    @param searcher     [I/O]   object tracking the seeds
+                    @param scanners     [I]     objects holding the roots,
+                                                in query order
+                    @param result       [I/O]   if not NULL, the seeds are
+                                                saved to this result set
+                */
+                CSeedsTask(
+                        TSearch & searcher, const TSearches & scanners,
+                        CDbIndex::CSearchResults * result )
+                    : searcher_( searcher ), scanners_( scanners ),
+                      result_( result )
+                {}
+
+            protected:
+
+                /** Process the roots of all scanned parts. */
+                virtual void Run()
+                {
+                    ITERATE( typename TSearches, it, scanners_ ) {
+                        searcher_.ComputeSeeds( (*it)->GetRoots() );
+                    }
+
+                    if( result_ != 0 ) searcher_.SaveResults( *result_ );
+                }
+
+            private:
+
+                TSearch & searcher_;                /**< Object tracking the seeds. */
+                TSearches scanners_;                /**< Objects holding the roots. */
+                CDbIndex::CSearchResults * result_; /**< Result set for the whole index. */
+        };
+
+        /** Max length of the query scanned by one thread in a round. */
+        static const TSeqPos SCAN_CHUNK = 64*1024;
+
+        /** Get the next part of the query to scan.
+            @param max_len      [I]     max total length of the part
+            @param ranges       [O]     the part, possibly spanning
+                                        several query locations
+        */
+        void NextRanges( TSeqPos max_len, TQueryRanges & ranges );
+
+        /** Destroy the search objects. */
+        void CleanUp();
+
+        const TIndex_Impl & index_impl_;        /**< The index implementation object. */
+        const BLAST_SequenceBlk * query_;       /**< The query sequence encoded in BLASTNA. */
+        TSearchOptions options_;                /**< Search options. */
+        TQueryRanges locs_;                     /**< The query locations. */
+        TQueryRanges::size_type next_loc_;      /**< Location scanned next. */
+        TSeqPos next_pos_;                      /**< Position scanned next. */
+        TSeqPos chunk_;                         /**< Length of query scanned by a thread in a round. */
+        TSearches scanners_;                    /**< Objects collecting the roots. */
+        TSearches searchers_;                   /**< Objects tracking the seeds. */
+};
+
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS >
+CThreadedSearch< LEGACY, NHITS >::CThreadedSearch(
+        const TIndex_Impl & index_impl,
+        const BLAST_SequenceBlk * query,
+        const BlastSeqLoc * locs,
+        const TSearchOptions & options )
+    : index_impl_( index_impl ), query_( query ), options_( options ),
+      next_loc_( 0 ), next_pos_( 0 )
+{
+    Uint8 query_len = 0;
+
+    for( ; locs != 0; locs = locs->next ) {
+        if( locs->ssr != 0 ) {
+            SQueryRange r = {
+                (TSeqPos)locs->ssr->left, (TSeqPos)locs->ssr->right + 1,
+                (TSeqPos)locs->ssr->left, (TSeqPos)locs->ssr->right + 1 };
+            locs_.push_back( r );
+            query_len += r.stop_ - r.start_;
+        }
+    }
+
+    if( !locs_.empty() ) next_pos_ = locs_[0].start_;
+    unsigned long n_threads = options_.n_threads;
+    chunk_ = (TSeqPos)std::min(
+            (Uint8)SCAN_CHUNK, (query_len + n_threads - 1)/n_threads );
+    if( chunk_ == 0 ) chunk_ = 1;
+
+    try {
+        for( unsigned long i = 0; i < n_threads; ++i ) {
+            scanners_.push_back( 0 );
+            scanners_.back() = new TSearch(
+                    index_impl, query, 0, options, 0, 0 );
+        }
+
+        // Split the subjects into ranges of about the same total length.
+        //
+        const TSubjectMap & subject_map = index_impl.GetSubjectMap();
+        TSeqNum num_subjects = index_impl.NumSubjects() - 1;
+        TSeqNum n_ranges = (TSeqNum)std::min(
+                (unsigned long)num_subjects, n_threads );
+        TWord store_start, store_end, subj_start, subj_end;
+        subject_map.SetSubjInfo( 0, store_start, subj_end );
+        subject_map.SetSubjInfo( num_subjects - 1, subj_start, store_end );
+        Uint8 store_len = store_end - store_start;
+        TSeqNum first_subject = 0;
+
+        for( TSeqNum i = 0; i < n_ranges; ++i ) {
+            TSeqNum end_subject = first_subject + 1;
+
+            if( i == n_ranges - 1 ) end_subject = num_subjects;
+            else {
+                Uint8 target = store_start + store_len*(i + 1)/n_ranges;
+
+                for( ; end_subject < num_subjects - (n_ranges - i - 1);
+                        ++end_subject ) {
+                    subject_map.SetSubjInfo(
+                            end_subject - 1, subj_start, subj_end );
+                    if( subj_end >= target ) break;
+                }
+            }
+
+            searchers_.push_back( 0 );
+            searchers_.back() = new TSearch(
+                    index_impl, query, 0, options,
+                    first_subject, end_subject, false );
+            first_subject = end_subject;
+        }
+    }
+    catch( ... ) {
+        CleanUp();
+        throw;
+    }
+}
+
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS >
+void CThreadedSearch< LEGACY, NHITS >::CleanUp()
+{
+    ITERATE( typename TSearches, it, scanners_ ) delete *it;
+    ITERATE( typename TSearches, it, searchers_ ) delete *it;
+    scanners_.clear();
+    searchers_.clear();
+}
+
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS >
+void CThreadedSearch< LEGACY, NHITS >::NextRanges(
+        TSeqPos max_len, TQueryRanges & ranges )
+{
+    ranges.clear();
+
+    while( max_len > 0 && next_loc_ < locs_.size() ) {
+        SQueryRange r = locs_[next_loc_];
+        r.start_ = next_pos_;
+        r.stop_  = next_pos_ + std::min( max_len, r.qstop_ - next_pos_ );
+        ranges.push_back( r );
+        max_len -= r.stop_ - r.start_;
+        next_pos_ = r.stop_;
+
+        if( next_pos_ == r.qstop_ && ++next_loc_ < locs_.size() ) {
+            next_pos_ = locs_[next_loc_].start_;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+template< bool LEGACY, unsigned long NHITS >
+CConstRef< CDbIndex::CSearchResults >
+CThreadedSearch< LEGACY, NHITS >::operator()()
+{
+    const TSubjectMap & subject_map = index_impl_.GetSubjectMap();
+    CRef< CDbIndex::CSearchResults > result(
+            new CDbIndex::CSearchResults(
+                options_.word_size,
+                0, index_impl_.NumChunks(), subject_map.GetSubjectMap(),
+                index_impl_.StopSeq() - index_impl_.StartSeq() ) );
+    CSearchPool & pool = s_SearchPool.Get();
+    CSearchPool::TTasks tasks;
+    TQueryRanges ranges;
+    bool last_round = false;
+
+    while( !last_round ) {
+        TSearches scanners;
+        tasks.clear();
+
+        ITERATE( typename TSearches, it, scanners_ ) {
+            NextRanges( chunk_, ranges );
+            if( ranges.empty() ) break;
+            scanners.push_back( *it );
+            tasks.push_back(
+                    CRef< CSearchPool::CTask >(
+                        new CRootsTask( **it, ranges ) ) );
+        }
+
+        pool.Run( tasks, options_.n_threads );
+        last_round = (next_loc_ == locs_.size());
+        tasks.clear();
+
+        ITERATE( typename TSearches, it, searchers_ ) {
+            tasks.push_back(
+                    CRef< CSearchPool::CTask >(
+                        new CSeedsTask(
+                            **it, scanners,
+                            last_round ? result.GetPointer() : 0 ) ) );
+        }
+
+        pool.Run( tasks, options_.n_threads );
+    }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+/** Search an index, possibly with several threads.
+
+    @param index_impl   [I]     the index implementation object
+    @param query        [I]     query data encoded in BLASTNA
+    @param locs         [I]     set of query locations to search
+    @param options      [I]     search options
+    @return the set of seeds matching the query to the sequences
+            present in the index
+*/
+template< bool LEGACY, unsigned long NHITS >
+CConstRef< CDbIndex::CSearchResults > SearchSubjects(
+        const CDbIndex_Impl< LEGACY > & index_impl,
+        const BLAST_SequenceBlk * query,
+        const BlastSeqLoc * locs,
+        const CDbIndex::SSearchOptions & options )
+{
+    TSeqNum num_subjects = index_impl.NumSubjects() - 1;
+
+    if( options.n_threads <= 1 || num_subjects == 0 ) {
+        CSearch< LEGACY, NHITS > searcher(
+                index_impl, query, locs, options, 0, num_subjects );
+        return searcher();
+    }
+
+    CThreadedSearch< LEGACY, NHITS > searcher(
+            index_impl, query, locs, options );
+    return searcher();
+}
+
 //-------------------------------------------------------------------------
 CConstRef< CDbIndex::CSearchResults > CDbIndex::Search( 
         const BLAST_SequenceBlk * query, const BlastSeqLoc * locs, 
@@ -1414,25 +1982,25 @@ CConstRef< CDbIndex::CSearchResults > CDbIndex::Search(
 {
     if( search_options.two_hits == 0 )
         if( header_.legacy_ ) {
-            CSearch< true, ONE_HIT > searcher(
-                    dynamic_cast< CDbIndex_Impl< true > & >(*this), query, locs, search_options );
-            return searcher();
+            return SearchSubjects< true, ONE_HIT >( 
+                    dynamic_cast< CDbIndex_Impl< true > & >(*this), 
+                    query, locs, search_options );
         }
         else {
-            CSearch< false, ONE_HIT > searcher(
-                    dynamic_cast< CDbIndex_Impl< false > & >(*this), query, locs, search_options );
-            return searcher();
+            return SearchSubjects< false, ONE_HIT >( 
+                    dynamic_cast< CDbIndex_Impl< false > & >(*this), 
+                    query, locs, search_options );
         }
     else
         if( header_.legacy_ ) {
-            CSearch< true, TWO_HIT > searcher(
-                    dynamic_cast< CDbIndex_Impl< true > & >(*this), query, locs, search_options );
-            return searcher();
+            return SearchSubjects< true, TWO_HIT >( 
+                    dynamic_cast< CDbIndex_Impl< true > & >(*this), 
+                    query, locs, search_options );
         }
         else {
-            CSearch< false, TWO_HIT > searcher(
-                    dynamic_cast< CDbIndex_Impl< false > & >(*this), query, locs, search_options );
-            return searcher();
+            return SearchSubjects< false, TWO_HIT >( 
+                    dynamic_cast< CDbIndex_Impl< false > & >(*this), 
+                    query, locs, search_options );
         }
 }
 
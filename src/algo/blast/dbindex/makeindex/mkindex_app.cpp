@@ -32,6 +32,8 @@
 
 #include <ncbi_pch.hpp>
 
+#include <corelib/ncbifile.hpp>
+
 #include <memory>
 #include <string>
 #include <sstream>
@@ -57,6 +59,191 @@ using namespace std;
 USING_NCBI_SCOPE;
 USING_SCOPE( blastdbindex );
 
+//------------------------------------------------------------------------------
+namespace {
+
+/** State of the existing index of a BLAST database volume. */
+enum EIndexState
+{
+    eIndexRebuild,  ///< index is missing or inconsistent; create from scratch
+    eIndexAppend,   ///< index is consistent but does not cover all OIDs
+    eIndexUpToDate  ///< index covers all OIDs of the database volume
+};
+
+/** Compare a sequence stored in an index volume with the BLAST database.
+
+    The index stores sequences packed 4 bases per byte, with ambiguous
+    bases stored as A. The database sequence is packed the same way
+    before the comparison.
+
+    @param index        [I]     index volume containing the sequence
+    @param oid          [I]     ordinal id of the sequence
+    @param db           [I]     BLAST database volume
+    @return true if the sequence data is the same
+*/
+bool SameSequence( 
+        const CDbIndex & index, CDbIndex::TSeqNum oid, const CSeqDB & db )
+{
+    static const unsigned long CR = CDbIndex::CR;
+    TSeqPos len( index.GetSeqLen( oid ) );
+
+    if( len != (TSeqPos)db.GetSeqLength( oid ) ) return false;
+
+    const Uint1 * packed( index.GetSeqData( oid ) );
+    const char * seq( 0 );
+    db.GetAmbigSeq( oid, &seq, kSeqDBNuclBlastNA8 );
+    bool result( true );
+    Uint1 accum( 0 );
+
+    for( TSeqPos pos( 0 ); pos < len; ++pos ) {
+        Uint1 letter( (Uint1)seq[pos] );
+        accum = (Uint1)((accum << 2) + (letter < CR ? letter : 0));
+
+        if( pos%CR == CR - 1 || pos == len - 1 ) {
+            accum = (Uint1)(accum << (CR - 1 - pos%CR)*2);
+
+            if( accum != *packed++ ) {
+                result = false;
+                break;
+            }
+
+            accum = 0;
+        }
+    }
+
+    db.RetAmbigSeq( &seq );
+    return result;
+}
+
+/** Check the existing index of a BLAST database volume.
+
+    The index must have been created with the same index parameters,
+    its volumes must cover a contiguous range of OIDs starting at 0,
+    and the sequences stored in the index subject maps must agree with
+    the BLAST database, both in length and in contents.
+
+    @param dbv_name     [I]     BLAST database volume name
+    @param db           [I]     BLAST database volume
+    @param options      [I]     index creation options
+    @param num_seq      [O]     number of sequences in the existing index
+    @param num_vol      [O]     number of volumes in the existing index
+    @return state of the existing index
+*/
+EIndexState CheckVolumeIndex( 
+        const std::string & dbv_name, const CSeqDB & db,
+        const CDbIndex::SOptions & options, Uint4 & num_seq, Uint4 & num_vol )
+{
+    num_seq = num_vol = 0;
+    Uint4 shdr_num_seq( 0 ), shdr_num_vol( 0 );
+
+    try {
+        CRef< CIndexSuperHeader_Base > shdr( 
+                GetIndexSuperHeader( dbv_name + ".shd" ) );
+        shdr_num_seq = shdr->GetNumSeq();
+        shdr_num_vol = shdr->GetNumVol();
+    }
+    catch( CException & e ) {
+        ERR_POST( Info << "no usable index found for " << dbv_name << 
+                          ": " << e.GetMsg() );
+        return eIndexRebuild;
+    }
+
+    if( shdr_num_seq > (Uint4)db.GetNumOIDs() ) {
+        ERR_POST( Warning << "index of " << dbv_name << " has more "
+                             "sequences (" << shdr_num_seq << ") than the "
+                             "BLAST database volume (" << db.GetNumOIDs() << 
+                             "); rebuilding" );
+        return eIndexRebuild;
+    }
+
+    for( Uint4 vol( 0 ); vol < shdr_num_vol; ++vol ) {
+        std::string vol_name( 
+                CIndexSuperHeader_Base::GenerateIndexVolumeName( 
+                    dbv_name, vol ) );
+
+        try {
+            CRef< CDbIndex > index( CDbIndex::Load( vol_name ) );
+
+            if( index->isLegacy() != options.legacy ||
+                    ( !options.legacy && 
+                      ( index->getHKeyWidth() != options.hkey_width ||
+                        index->getStride() != options.stride ||
+                        index->getWSHint() != options.ws_hint ) ) ) {
+                ERR_POST( Warning << "index volume " << vol_name << 
+                                     " was created with different index "
+                                     "parameters; rebuilding" );
+                return eIndexRebuild;
+            }
+
+            if( index->StartSeq() != num_seq || 
+                    index->StopSeq() < index->StartSeq() ) {
+                ERR_POST( Warning << "index volume " << vol_name << 
+                                     " does not start at OID " << num_seq << 
+                                     "; rebuilding" );
+                return eIndexRebuild;
+            }
+
+            for( CDbIndex::TSeqNum oid( index->StartSeq() ); 
+                    oid < index->StopSeq(); ++oid ) {
+                if( !SameSequence( *index, oid, db ) ) {
+                    ERR_POST( Warning << "sequence of OID " << oid << 
+                                         " in index volume " << vol_name << 
+                                         " does not match the BLAST "
+                                         "database; rebuilding" );
+                    return eIndexRebuild;
+                }
+            }
+
+            num_seq = index->StopSeq();
+        }
+        catch( CException & e ) {
+            ERR_POST( Warning << "can not use index volume " << vol_name << 
+                                 ": " << e.GetMsg() << "; rebuilding" );
+            return eIndexRebuild;
+        }
+
+        ++num_vol;
+    }
+
+    if( num_seq != shdr_num_seq ) {
+        ERR_POST( Warning << "index volumes of " << dbv_name << " contain " <<
+                             num_seq << " sequences instead of " << 
+                             shdr_num_seq << "; rebuilding" );
+        num_seq = num_vol = 0;
+        return eIndexRebuild;
+    }
+
+    return num_seq == (Uint4)db.GetNumOIDs() ? eIndexUpToDate : eIndexAppend;
+}
+
+/** Save the index superheader of a BLAST database volume.
+
+    The superheader is written to a temporary file first which is then
+    renamed, so that searches never see a superheader that does not
+    correspond to the index volumes on disk.
+
+    @param dbv_name     [I]     BLAST database volume name
+    @param num_seq      [I]     number of sequences in the index
+    @param num_vol      [I]     number of volumes in the index
+*/
+void SaveSuperHeader( 
+        const std::string & dbv_name, Uint4 num_seq, Uint4 num_vol )
+{
+    std::string shdr_name( dbv_name + ".shd" );
+    std::string tmp_name( shdr_name + ".tmp" );
+    CIndexSuperHeader< 
+        CIndexSuperHeader_Base::INDEX_FORMAT_VERSION_1 > shdr( 
+                num_seq, num_vol );
+    shdr.Save( tmp_name );
+
+    if( !CFile( tmp_name ).Rename( shdr_name, CFile::fRF_Overwrite ) ) {
+        NCBI_THROW( CIndexSuperHeader_Exception, eFile,
+                    "can not rename " + tmp_name + " to " + shdr_name );
+    }
+}
+
+}
+
 //------------------------------------------------------------------------------
 const char * const CMkIndexApplication::USAGE_LINE = 
     "Create a BLAST database index.";
@@ -120,6 +307,11 @@ void CMkIndexApplication::Init()
             "old_style_index", "boolean",
             "Use old style index (deprecated)",
             CArgDescriptions::eBoolean, "true" );
+    arg_desc->AddFlag(
+            "incremental",
+            "only index the sequences of BLAST database volumes that are"
+            " not yet covered by an existing new style index",
+            true );
     arg_desc->SetConstraint( 
             "verbosity",
             &(*new CArgAllow_Strings, "quiet", "normal", "verbose") );
@@ -142,6 +334,8 @@ void CMkIndexApplication::Init()
             "show_filters", CArgDescriptions::eExcludes, "output" );
     arg_desc->SetDependency(
             "db_mask", CArgDescriptions::eRequires, "input" );
+    arg_desc->SetDependency(
+            "incremental", CArgDescriptions::eRequires, "input" );
     SetupArgDescriptions( arg_desc.release() );
 }
 
@@ -263,6 +457,13 @@ int CMkIndexApplication::Run()
         exit( 1 );
     }
 
+    bool incremental( GetArgs()["incremental"] );
+
+    if( incremental && old_style ) {
+        ERR_POST( Error << "-incremental requires -old_style_index false" );
+        exit( 1 );
+    }
+
     if( !old_style && iformat == "blastdb" ) {
         if( GetArgs()["output"] ) {
             ERR_POST( Warning << 
@@ -283,23 +484,46 @@ int CMkIndexApplication::Run()
         int filter( enable_mask ? GetArgs()["db_mask"].AsInteger() : 0 );
 
         ITERATE( TStrVec, dbvi, db_vols ) {
-            seqstream = 
-                new CSequenceIStreamBlastDB( *dbvi, enable_mask, filter );
             CDbIndex::TSeqNum start, orig_stop( kMax_UI4 ), stop = 0;
             Uint4 vol_num_seq( 0 );
-
-            {
-                CSeqDB db( *dbvi, CSeqDB::eNucleotide, 0, 0, false );
-                vol_num_seq = db.GetNumOIDs();
-            }
-
             Uint4 num_seq( 0 ), num_vol( 0 );
-            vol_num = 0;
             /*
             std::string dbv_name( 
                     CFile::ConcatPath( odir_name, CFile( *dbvi ).GetName() ) );
             */
             std::string dbv_name( *dbvi );
+
+            {
+                CSeqDB db( *dbvi, CSeqDB::eNucleotide, 0, 0, false );
+                vol_num_seq = db.GetNumOIDs();
+
+                if( incremental ) {
+                    EIndexState state( CheckVolumeIndex( 
+                                dbv_name, db, options, num_seq, num_vol ) );
+
+                    if( state == eIndexUpToDate ) {
+                        cerr << "index of " << dbv_name 
+                             << " is up to date" << endl;
+                        continue;
+                    }
+
+                    if( state == eIndexAppend ) {
+                        cerr << "appending OIDs " << num_seq << "--" 
+                             << vol_num_seq << " to the index of " 
+                             << dbv_name << endl;
+                    }
+                }
+            }
+
+            // Searches fall back to the BLAST database while an index
+            // is rebuilt from scratch; an appended index stays usable
+            // until its superheader is replaced.
+            if( num_vol == 0 ) CFile( dbv_name + ".shd" ).Remove();
+
+            seqstream = new CSequenceIStreamBlastDB( 
+                    *dbvi, enable_mask, filter, num_seq );
+            vol_num = num_vol;
+            stop = num_seq;
             
             do {
                 start = stop;
@@ -331,10 +555,7 @@ int CMkIndexApplication::Run()
                 return 1;
             }
 
-            CIndexSuperHeader< 
-                CIndexSuperHeader_Base::INDEX_FORMAT_VERSION_1 > shdr( 
-                        num_seq, num_vol );
-            shdr.Save( dbv_name + ".shd" );
+            SaveSuperHeader( dbv_name, num_seq, num_vol );
             ERR_POST( Info << 
                       "index generated for BLAST database volume " <<
                       dbv_name << " with " << num_seq << " sequences" );
@@ -44,8 +44,9 @@ BEGIN_SCOPE( blastdbindex )
 
 //------------------------------------------------------------------------------
 CSequenceIStreamBlastDB::CSequenceIStreamBlastDB( 
-        const string & dbname, bool use_filter, int filter_algo_id )
-    : seqdb_( new CSeqDB( dbname, CSeqDB::eNucleotide ) ), oid_( 0 ),
+        const string & dbname, bool use_filter, int filter_algo_id,
+        CSeqDB::TOID start_oid )
+    : seqdb_( new CSeqDB( dbname, CSeqDB::eNucleotide ) ), oid_( start_oid ),
       filter_algo_id_( filter_algo_id ), use_filter_( use_filter )
 {
     if( use_filter_ ) {
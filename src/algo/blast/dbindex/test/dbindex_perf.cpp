@@ -0,0 +1,415 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file dbindex_perf.cpp
+ * Command line tool to compare the seed rate of indexed and non-indexed
+ * megablast on a synthetic genome, and the scaling of the index search
+ * with the number of threads.
+ */
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbifile.hpp>
+#include <corelib/ncbitime.hpp>
+#include <corelib/ncbi_system.hpp>
+#include <util/random_gen.hpp>
+
+#include <algo/blast/core/blast_options.h>
+#include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/blast_filter.h>
+#include <algo/blast/core/blast_extend.h>
+#include <algo/blast/core/blast_nalookup.h>
+#include <algo/blast/core/blast_nascan.h>
+#include <algo/blast/core/lookup_wrap.h>
+#include <algo/blast/dbindex/dbindex.hpp>
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+USING_NCBI_SCOPE;
+USING_SCOPE(blastdbindex);
+#endif
+
+/// The application class
+class CDbIndexPerfApp : public CNcbiApplication
+{
+public:
+    /** @inheritDoc */
+    CDbIndexPerfApp() : m_Query(NULL), m_QueryLocs(NULL) {}
+private:
+    /** @inheritDoc */
+    virtual void Init();
+    /** @inheritDoc */
+    virtual int Run();
+    /** @inheritDoc */
+    virtual void Exit();
+
+    /// Chromosomes of the synthetic genome, one base (0-3) per byte
+    vector< vector<Uint1> > m_Genome;
+    /// Query sequence, in blastna with sentinels
+    BLAST_SequenceBlk* m_Query;
+    /// The whole query as a single location
+    BlastSeqLoc* m_QueryLocs;
+    /// Files to remove on exit
+    vector<string> m_TmpFiles;
+
+    /// Creates the random genome and a query made of mutated copies of
+    /// genome fragments
+    void x_InitSequences();
+
+    /// Writes the genome as FASTA and builds a megablast index for it
+    /// @return name of the index file
+    string x_MakeIndex();
+
+    /// Search the index, repeating the search and keeping the shortest
+    /// time
+    /// @param index the index to search [in]
+    /// @param num_threads number of search threads [in]
+    /// @param checksum set to a digest of all seeds found [out]
+    /// @param elapsed set to the search time in seconds [out]
+    /// @return number of seeds found
+    Int8 x_SearchIndex(CDbIndex& index, unsigned long num_threads,
+                       Uint8& checksum, double& elapsed);
+
+    /// Find the seeds with a megablast lookup table built on the query,
+    /// scanning every chromosome and extending the lookup table hits to
+    /// exact matches of at least the word size
+    /// @param elapsed set to the search time in seconds [out]
+    /// @return number of seeds found
+    Int8 x_ScanGenome(double& elapsed);
+};
+
+void CDbIndexPerfApp::x_InitSequences()
+{
+    const CArgs& args = GetArgs();
+    const int kNumChromosomes = args["chromosomes"].AsInteger();
+    const Int8 kGenomeLength = args["genome_length"].AsInt8();
+    const int kQueryLength = args["query_length"].AsInteger();
+    const int kFragmentLength = 1000;
+    const CRandom::TValue kMutationsPerMille = 20;
+    CRandom rng(args["seed"].AsInteger());
+
+    // chromosome lengths vary by up to 50% around the mean, so that
+    // the subjects do not split evenly among the search threads
+    const Int8 kMeanLength = kGenomeLength / kNumChromosomes;
+    m_Genome.resize(kNumChromosomes);
+    NON_CONST_ITERATE(vector< vector<Uint1> >, chr, m_Genome) {
+        Int8 len = kMeanLength / 2 +
+            kMeanLength * rng.GetRand(0, 1000) / 1000;
+        chr->resize((size_t)len);
+        NON_CONST_ITERATE(vector<Uint1>, base, *chr) {
+            *base = (Uint1)rng.GetRand(0, 3);
+        }
+    }
+
+    Uint1* query = (Uint1*)malloc(kQueryLength + 2);
+    query[0] = query[kQueryLength + 1] = 0x0f;    // sentinels
+    for (int q = 0; q < kQueryLength; q += kFragmentLength) {
+        const vector<Uint1>& chr =
+            m_Genome[rng.GetRand(0, kNumChromosomes - 1)];
+        int len = min(kFragmentLength, kQueryLength - q);
+        size_t s = rng.GetRand(0, (CRandom::TValue)(chr.size() - len));
+        for (int i = 0; i < len; i++) {
+            query[q + i + 1] = rng.GetRand(0, 999) < kMutationsPerMille
+                ? (Uint1)rng.GetRand(0, 3) : chr[s + i];
+        }
+    }
+    BlastSeqBlkNew(&m_Query);
+    BlastSeqBlkSetSequence(m_Query, query, kQueryLength);
+    BlastSeqLocNew(&m_QueryLocs, 0, kQueryLength - 1);
+}
+
+string CDbIndexPerfApp::x_MakeIndex()
+{
+    static const char kBases[] = "ACGT";
+    const string kBase = CDirEntry::GetTmpName(CDirEntry::eTmpFileCreate);
+    const string kFasta = kBase + ".fa";
+    const string kIndex = kBase + ".idx";
+    m_TmpFiles.push_back(kBase);
+    m_TmpFiles.push_back(kFasta);
+    m_TmpFiles.push_back(kIndex);
+    m_TmpFiles.push_back(kIndex + ".map");
+
+    {{
+        CNcbiOfstream fasta(kFasta.c_str());
+        for (size_t i = 0; i < m_Genome.size(); i++) {
+            fasta << ">chr" << i + 1 << "\n";
+            for (size_t j = 0; j < m_Genome[i].size(); j++) {
+                fasta << kBases[m_Genome[i][j]];
+                if (j % 80 == 79) {
+                    fasta << "\n";
+                }
+            }
+            fasta << "\n";
+        }
+    }}
+
+    CDbIndex::SOptions options = CDbIndex::DefaultSOptions();
+    options.report_level = REPORT_QUIET;
+    options.ws_hint = GetArgs()["word_size"].AsInteger();
+    CDbIndex::TSeqNum stop = 0;
+    CDbIndex::MakeIndex(kFasta, kIndex, 0, stop, options);
+    return kIndex;
+}
+
+Int8
+CDbIndexPerfApp::x_SearchIndex(CDbIndex& index, unsigned long num_threads,
+                               Uint8& checksum, double& elapsed)
+{
+    CDbIndex::SSearchOptions options;
+    options.word_size = GetArgs()["word_size"].AsInteger();
+    options.two_hits = 0;
+    options.n_threads = num_threads;
+
+    CConstRef<CDbIndex::CSearchResults> results;
+    const int kRepeats = GetArgs()["repeats"].AsInteger();
+    for (int i = 0; i < kRepeats; i++) {
+        CStopWatch sw(CStopWatch::eStart);
+        results = index.Search(m_Query, m_QueryLocs, options);
+        double t = sw.Elapsed();
+        if (i == 0 || t < elapsed) {
+            elapsed = t;
+        }
+    }
+
+    Int8 num_seeds = 0;
+    checksum = 0;
+    for (CDbIndex::TSeqNum seq = 1; seq <= results->NumSeq(); seq++) {
+        const BlastInitHitList* hits = results->GetResults(seq);
+        if (hits == NULL) {
+            continue;
+        }
+        for (Int4 i = 0; i < hits->total; i++) {
+            const BlastOffsetPair& off = hits->init_hsp_array[i].offsets;
+            checksum = checksum * 31 + seq;
+            checksum = checksum * 31 + off.qs_offsets.q_off;
+            checksum = checksum * 31 + off.qs_offsets.s_off;
+        }
+        num_seeds += hits->total;
+    }
+    return num_seeds;
+}
+
+Int8 CDbIndexPerfApp::x_ScanGenome(double& elapsed)
+{
+    const Int4 kWordSize = GetArgs()["word_size"].AsInteger();
+    LookupTableOptions* lookup_options = NULL;
+    LookupTableWrap* lookup_wrap = NULL;
+
+    CStopWatch sw(CStopWatch::eStart);
+    LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+    BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                 TRUE, 0, kWordSize);
+    LookupTableWrapInit(m_Query, lookup_options, NULL, m_QueryLocs, NULL,
+                        &lookup_wrap, NULL, NULL);
+    BlastChooseNucleotideScanSubject(lookup_wrap);
+
+    void* callback = NULL;
+    Int4 lut_word_length = 0;
+    if (lookup_wrap->lut_type == eMBLookupTable) {
+        BlastMBLookupTable* lut = (BlastMBLookupTable*)lookup_wrap->lut;
+        callback = lut->scansub_callback;
+        lut_word_length = lut->lut_word_length;
+    } else {
+        BlastNaLookupTable* lut = (BlastNaLookupTable*)lookup_wrap->lut;
+        callback = lut->scansub_callback;
+        lut_word_length = lut->lut_word_length;
+    }
+    TNaScanSubjectFunction scansub = (TNaScanSubjectFunction)callback;
+    const Int4 kMaxHits = GetOffsetArraySize(lookup_wrap);
+    vector<BlastOffsetPair> offset_pairs(kMaxHits);
+    const Uint1* query = m_Query->sequence;
+    const Int4 kQueryLength = m_Query->length;
+    Int8 num_seeds = 0;
+
+    ITERATE(vector< vector<Uint1> >, chr, m_Genome) {
+        const Int4 kLength = (Int4)chr->size();
+        Uint1* packed = (Uint1*)calloc(kLength / COMPRESSION_RATIO + 1, 1);
+        for (Int4 i = 0; i < kLength; i++) {
+            packed[i / COMPRESSION_RATIO] |= (*chr)[i] <<
+                (2 * (COMPRESSION_RATIO - 1 - i % COMPRESSION_RATIO));
+        }
+        BLAST_SequenceBlk* subject = NULL;
+        BlastSeqBlkNew(&subject);
+        subject->length = kLength;
+        BlastSeqBlkSetCompressedSequence(subject, packed);
+
+        // end of the last exact match reported on each diagonal
+        map<Int4, Int4> diag_end;
+        Int4 scan_range[2] = { 0, kLength - lut_word_length };
+        while (scan_range[0] <= scan_range[1]) {
+            Int4 hits = scansub(lookup_wrap, subject, &offset_pairs[0],
+                                kMaxHits, scan_range);
+            for (Int4 i = 0; i < hits; i++) {
+                Int4 q = offset_pairs[i].qs_offsets.q_off;
+                Int4 s = offset_pairs[i].qs_offsets.s_off;
+                map<Int4, Int4>::const_iterator prev = diag_end.find(s - q);
+                if (prev != diag_end.end() && s < prev->second) {
+                    continue;
+                }
+                Int4 left = 0, right = 0;
+                while (q > left && s > left &&
+                       query[q - left - 1] == (*chr)[s - left - 1]) {
+                    left++;
+                }
+                while (q + right < kQueryLength && s + right < kLength &&
+                       query[q + right] == (*chr)[s + right]) {
+                    right++;
+                }
+                diag_end[s - q] = s + right;
+                if (left + right >= kWordSize) {
+                    num_seeds++;
+                }
+            }
+        }
+        subject = BlastSequenceBlkFree(subject);
+    }
+    elapsed = sw.Elapsed();
+
+    lookup_wrap = LookupTableWrapFree(lookup_wrap);
+    lookup_options = LookupTableOptionsFree(lookup_options);
+    return num_seeds;
+}
+
+void CDbIndexPerfApp::Init()
+{
+    HideStdArgs(fHideConffile | fHideFullVersion | fHideXmlHelp | fHideDryRun);
+
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                  "Indexed megablast seed search performance testing client");
+
+    arg_desc->SetCurrentGroup("Sequence options");
+    arg_desc->AddDefaultKey("genome_length", "length",
+                            "Total length of the random genome",
+                            CArgDescriptions::eInt8, "50000000");
+    arg_desc->AddDefaultKey("chromosomes", "num",
+                            "Number of chromosomes of the genome",
+                            CArgDescriptions::eInteger, "24");
+    arg_desc->SetConstraint("chromosomes", new CArgAllow_Integers(1, 10000));
+    arg_desc->AddDefaultKey("query_length", "length",
+                            "Length of the query, made of mutated copies "
+                            "of genome fragments",
+                            CArgDescriptions::eInteger, "100000");
+    arg_desc->AddDefaultKey("seed", "seed", "Random number generator seed",
+                            CArgDescriptions::eInteger, "1");
+
+    arg_desc->SetCurrentGroup("Search options");
+    arg_desc->AddDefaultKey("word_size", "size", "Seed length",
+                            CArgDescriptions::eInteger, "28");
+    arg_desc->SetConstraint("word_size", new CArgAllow_Integers(16, 64));
+    arg_desc->AddDefaultKey("max_threads", "num_threads",
+                            "Largest number of index search threads; the "
+                            "thread count doubles from 1 up to this number",
+                            CArgDescriptions::eInteger, "8");
+    arg_desc->SetConstraint("max_threads", new CArgAllow_Integers(1, 1024));
+    arg_desc->AddDefaultKey("repeats", "num",
+                            "Number of times each index search is run; "
+                            "the shortest time is reported",
+                            CArgDescriptions::eInteger, "3");
+    arg_desc->SetConstraint("repeats", new CArgAllow_Integers(1, 100));
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+int CDbIndexPerfApp::Run(void)
+{
+    int status = 0;
+
+    x_InitSequences();
+    CRef<CDbIndex> index = CDbIndex::Load(x_MakeIndex());
+    Int8 genome_length = 0;
+    ITERATE(vector< vector<Uint1> >, chr, m_Genome) {
+        genome_length += chr->size();
+    }
+
+    cout << "   method  threads       seeds   seconds     seeds/s"
+         << "    Mb/s  speedup" << endl;
+    cout << setiosflags(ios::fixed);
+
+    double elapsed = 0.0;
+    Int8 seeds = x_ScanGenome(elapsed);
+    cout << setw(9) << "scan" << setw(9) << 1 << setw(12) << seeds
+         << setw(10) << setprecision(3) << elapsed
+         << setw(12) << setprecision(0) << seeds / elapsed
+         << setw(8) << setprecision(1) << genome_length / elapsed / 1e6
+         << setw(9) << "-" << endl;
+
+    Uint8 base_checksum = 0;
+    Int8 base_seeds = 0;
+    double base_elapsed = 0.0;
+    const unsigned long kMaxThreads = GetArgs()["max_threads"].AsInteger();
+    const unsigned long kNumCpus = GetCpuCount();
+    for (unsigned long num_threads = 1; num_threads <= kMaxThreads;
+         num_threads *= 2) {
+        Uint8 checksum = 0;
+        seeds = x_SearchIndex(*index, num_threads, checksum, elapsed);
+        if (num_threads == 1) {
+            base_checksum = checksum;
+            base_seeds = seeds;
+            base_elapsed = elapsed;
+        } else if (seeds != base_seeds || checksum != base_checksum) {
+            LOG_POST(Error << "Seeds found with " << num_threads
+                     << " threads differ from the single threaded search");
+            status = 1;
+        } else if (num_threads <= kNumCpus && elapsed >= base_elapsed) {
+            LOG_POST(Error << "Search with " << num_threads
+                     << " threads is not faster than the single threaded"
+                     " search");
+            status = 1;
+        }
+        cout << setw(9) << "index" << setw(9) << num_threads
+             << setw(12) << seeds
+             << setw(10) << setprecision(3) << elapsed
+             << setw(12) << setprecision(0) << seeds / elapsed
+             << setw(8) << setprecision(1) << genome_length / elapsed / 1e6
+             << setw(9) << setprecision(2) << base_elapsed / elapsed
+             << endl;
+    }
+    return status;
+}
+
+void CDbIndexPerfApp::Exit(void)
+{
+    m_Query = BlastSequenceBlkFree(m_Query);
+    m_QueryLocs = BlastSeqLocFree(m_QueryLocs);
+    ITERATE(vector<string>, it, m_TmpFiles) {
+        CFile(*it).Remove();
+    }
+}
+
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+int main(int argc, const char* argv[] /*, const char* envp[]*/)
+{
+    return CDbIndexPerfApp().AppMain(argc, argv, 0, eDS_Default, 0);
+}
+#endif /* SKIP_DOXYGEN_PROCESSING */
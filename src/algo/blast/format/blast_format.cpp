@@ -600,6 +600,11 @@ CBlastFormat::x_PrintTabularReport(const blast::CSearchResults& results,
         tabinfo.SetParseLocalIds(m_BelieveQuery);
         if (ncbi::NStr::ToLower(m_Program) == string("blastn"))
         	tabinfo.SetNoFetch(true);
+        // the same subjects are usually hit by many queries
+        if (m_TabularSubjectCache.Empty()) {
+            m_TabularSubjectCache.Reset(new CBlastTabularSubjectCache);
+        }
+        tabinfo.SetSubjectCache(m_TabularSubjectCache);
 
         if (m_FormatType == CFormattingArgs::eTabularWithComments) {
             string strProgVersion =
@@ -52,7 +52,9 @@
 #include <algo/blast/core/blast_setup.h>
 #include <algo/blast/core/blast_encoding.h>
 #include <algo/blast/core/blast_aalookup.h>
+#include <algo/blast/core/blast_aascan.h>
 #include <algo/blast/core/lookup_util.h>
+#include <algo/blast/core/lookup_wrap.h>
 
 #include "test_objmgr.hpp"
 
@@ -196,6 +198,91 @@ struct AalookupTestFixture {
                       NULL);
     lookup = (BlastAaLookupTable*) lookup_wrap_ptr->lut;
   }
+
+  // to find all words of the query, used as the subject, in a lookup table
+  vector< pair<Uint4, Uint4> > ScanAllHits(LookupTableWrap* lut_wrap){
+    vector< pair<Uint4, Uint4> > retval;
+    vector<BlastOffsetPair> offset_pairs(GetOffsetArraySize(lut_wrap));
+    if (query_blk->num_seq_ranges == 0) {
+      SSeqRange full_range;
+      full_range.left = 0;
+      full_range.right = query_blk->length;
+      BOOST_REQUIRE_EQUAL(0, (int)BlastSeqBlkSetSeqRanges(query_blk,
+                                     &full_range, 1, true, eNoSubjMasking));
+    }
+    BlastChooseProteinScanSubject(lut_wrap);
+    BlastAaLookupTable* lut = (BlastAaLookupTable*) lut_wrap->lut;
+    TAaScanSubjectFunction scansub =
+                    (TAaScanSubjectFunction)(lut->scansub_callback);
+    BOOST_REQUIRE(scansub != NULL);
+    Int4 scan_range[3];
+    scan_range[0] = 0;
+    scan_range[1] = 0;
+    scan_range[2] = query_blk->length - lut->word_length;
+    while (scan_range[1] <= scan_range[2]) {
+      Int4 hits = scansub(lut_wrap, query_blk, &offset_pairs[0],
+                          GetOffsetArraySize(lut_wrap), scan_range);
+      for (Int4 i = 0; i < hits; i++) {
+        retval.push_back(make_pair(offset_pairs[i].qs_offsets.q_off,
+                                   offset_pairs[i].qs_offsets.s_off));
+      }
+    }
+    return retval;
+  }
+
+  // to save the lookup table in an image and attach a new table to it;
+  // both tables must hold the same arrays and find the same words
+  void CheckImageRoundTrip(){
+    const Uint8 kFingerprint =
+      LookupTableWrapFingerprint(query_blk, lookup_options, NULL,
+                                 lookup_segments, sbp);
+    const size_t kSize = LookupTableWrapImageSize(lookup_wrap_ptr, query_blk);
+    BOOST_REQUIRE(kSize > 0);
+    // a vector of Uint8 keeps the image aligned
+    vector<Uint8> image(kSize / sizeof(Uint8) + 1, 0);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapImageWrite(lookup_wrap_ptr,
+                                 query_blk, kFingerprint, &image[0], kSize));
+    LookupTableWrap* attached = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapImageAttach(&image[0], kSize,
+                                 kFingerprint, query_blk, &attached));
+    BOOST_REQUIRE(attached != NULL);
+    BOOST_REQUIRE_EQUAL(eAaLookupTable, (ELookupTableType)attached->lut_type);
+
+    BlastAaLookupTable* copy = (BlastAaLookupTable*) attached->lut;
+    BOOST_REQUIRE_EQUAL(lookup->bone_type, copy->bone_type);
+    BOOST_REQUIRE_EQUAL(lookup->backbone_size, copy->backbone_size);
+    BOOST_REQUIRE_EQUAL(lookup->overflow_size, copy->overflow_size);
+    BOOST_REQUIRE_EQUAL(lookup->longest_chain, copy->longest_chain);
+    BOOST_REQUIRE_EQUAL(lookup->neighbor_matches, copy->neighbor_matches);
+    const bool kSmallbone = (lookup->bone_type == eSmallbone);
+    BOOST_REQUIRE(!memcmp(lookup->thick_backbone, copy->thick_backbone,
+                          lookup->backbone_size *
+                          (kSmallbone ? sizeof(AaLookupSmallboneCell)
+                                      : sizeof(AaLookupBackboneCell))));
+    BOOST_REQUIRE(!memcmp(lookup->overflow, copy->overflow,
+                          lookup->overflow_size *
+                          (kSmallbone ? sizeof(Uint2) : sizeof(Int4))));
+    BOOST_REQUIRE(!memcmp(lookup->pv, copy->pv,
+                          ((lookup->backbone_size >> PV_ARRAY_BTS) + 1) *
+                          sizeof(PV_ARRAY_TYPE)));
+
+    vector< pair<Uint4, Uint4> > built_hits = ScanAllHits(lookup_wrap_ptr);
+    vector< pair<Uint4, Uint4> > attached_hits = ScanAllHits(attached);
+    BOOST_REQUIRE(!built_hits.empty());
+    BOOST_REQUIRE(built_hits == attached_hits);
+
+    // an image of other options or of a different size is not attached
+    LookupTableWrap* rejected = NULL;
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&image[0], kSize,
+                                  kFingerprint ^ 1, query_blk, &rejected));
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&image[0],
+                                  kSize - 1, kFingerprint, query_blk,
+                                  &rejected));
+    BOOST_REQUIRE(rejected == NULL);
+
+    // the image must remain valid until the attached table is freed
+    attached = LookupTableWrapFree(attached);
+  }
 };
 
 BOOST_FIXTURE_TEST_SUITE(aalookup, AalookupTestFixture)
@@ -302,6 +389,42 @@ BOOST_AUTO_TEST_CASE(SmallboneSequenceTest) {
   BOOST_REQUIRE_EQUAL(offset, len-3);
 }
 
+BOOST_AUTO_TEST_CASE(SmallboneImageTest) {
+  GetSeqBlk("gi|129295");
+  FillLookupTable(true);
+  BOOST_REQUIRE_EQUAL( lookup->bone_type, eSmallbone );
+  CheckImageRoundTrip();
+}
+
+BOOST_AUTO_TEST_CASE(BackboneImageTest) {
+  // a sequence long enough for the large backbone, with varied words so
+  // that scanning it does not find every query offset at every position
+  Int4 len = 65534;
+  GetSeqBlk(len);
+  Uint4 seed = 1;
+  for (Int4 i = 0; i < len; i++) {
+    seed = seed * 1103515245 + 12345;
+    query_blk->sequence[i] = (Uint1) (1 + (seed >> 16) % (BLASTAA_SIZE - 1));
+  }
+  FillLookupTable();
+  BOOST_REQUIRE_EQUAL( lookup->bone_type, eBackbone );
+  CheckImageRoundTrip();
+}
+
+// The neighboring words depend on the scores, so a table built with
+// another matrix has another fingerprint
+BOOST_AUTO_TEST_CASE(ImageFingerprintMatrixTest) {
+  GetSeqBlk("gi|129295");
+  FillLookupTable(true);
+  const Uint8 kFingerprint =
+    LookupTableWrapFingerprint(query_blk, lookup_options, NULL,
+                               lookup_segments, sbp);
+  sbp->matrix->data[1][1]++;
+  BOOST_REQUIRE(kFingerprint !=
+                LookupTableWrapFingerprint(query_blk, lookup_options, NULL,
+                                           lookup_segments, sbp));
+  sbp->matrix->data[1][1]--;
+}
 
 #if 0
 
@@ -226,4 +226,97 @@ BOOST_AUTO_TEST_CASE(testMultiSeqHSPCollector) {
     Blast_HSPResultsFree(results);
     hit_options = BlastHitSavingOptionsFree(hit_options);
 }
+
+// Create a collector HSP stream for testMemoryLimitHSPStream
+static BlastHSPStream* s_CreateCollectorStream(int num_queries)
+{
+    const EBlastProgramType kProgram = eBlastTypeBlastp;
+
+    BlastExtensionOptions* ext_options = NULL;
+    BlastExtensionOptionsNew(kProgram, &ext_options, true);
+    BlastHitSavingOptions* hit_options = NULL;
+    BlastHitSavingOptionsNew(kProgram, &hit_options, true);
+
+    BlastHSPWriterInfo* writer_info = BlastHSPCollectorInfoNew(
+        BlastHSPCollectorParamsNew(hit_options,
+                                   ext_options->compositionBasedStats, true));
+    BlastHSPWriter* writer = BlastHSPWriterNew(&writer_info, NULL);
+    BlastHSPStream* hsp_stream = BlastHSPStreamNew(kProgram, ext_options,
+                                                   TRUE, num_queries, writer);
+
+    ext_options = BlastExtensionOptionsFree(ext_options);
+    hit_options = BlastHitSavingOptionsFree(hit_options);
+    return hsp_stream;
+}
+
+BOOST_AUTO_TEST_CASE(testMemoryLimitHSPStream) {
+    const int kNumQueries = 3;
+    const int kNumSubjects = 2000;
+
+    BlastHSPStream* hsp_stream = s_CreateCollectorStream(kNumQueries);
+    BlastHSPStream* spill_stream = s_CreateCollectorStream(kNumQueries);
+    // a limit this small spills the HSP lists many times
+    BOOST_REQUIRE_EQUAL(0, BlastHSPStreamSetMemoryLimit(spill_stream, 4096));
+
+    int index, status;
+    for (index = 0; index < kNumSubjects; ++index) {
+        // subjects are written out of order, so that their scores rank
+        // them differently than their OIDs
+        const int kOid = (index * 7919) % kNumSubjects;
+        const int kScore = index + 1;
+        BlastHSPList* hsp_list = setupHSPList(kScore, kNumQueries, kOid);
+        status = BlastHSPStreamWrite(hsp_stream, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+        hsp_list = setupHSPList(kScore, kNumQueries, kOid);
+        status = BlastHSPStreamWrite(spill_stream, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+    }
+    BlastHSPStreamClose(hsp_stream);
+    BlastHSPStreamClose(spill_stream);
+    BOOST_REQUIRE_EQUAL(hsp_stream->num_hsplists, spill_stream->num_hsplists);
+    BOOST_REQUIRE(spill_stream->num_hsplists > 0);
+
+    // Both streams return the same HSP lists, one subject at a time
+    BlastHSPStreamResultBatch* batch =
+        Blast_HSPStreamResultBatchInit(kNumQueries);
+    BlastHSPStreamResultBatch* spill_batch =
+        Blast_HSPStreamResultBatchInit(kNumQueries);
+    int num_hsplists = 0;
+    for (;;) {
+        status = BlastHSPStreamBatchRead(hsp_stream, batch);
+        BOOST_REQUIRE_EQUAL(status, 
+                            BlastHSPStreamBatchRead(spill_stream, spill_batch));
+        if (status == kBlastHSPStream_Eof)
+            break;
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+        BOOST_REQUIRE_EQUAL(batch->num_hsplists, spill_batch->num_hsplists);
+
+        vector< pair<int, int> > hits, spilled_hits;
+        for (index = 0; index < batch->num_hsplists; ++index) {
+            const BlastHSPList* hsp_list = batch->hsplist_array[index];
+            const BlastHSPList* spilled = spill_batch->hsplist_array[index];
+            BOOST_REQUIRE_EQUAL(hsp_list->oid, spilled->oid);
+            BOOST_REQUIRE_EQUAL(batch->hsplist_array[0]->oid, spilled->oid);
+            BOOST_REQUIRE_EQUAL(hsp_list->hspcnt, spilled->hspcnt);
+            hits.push_back(make_pair(hsp_list->query_index,
+                                     hsp_list->hsp_array[0]->score));
+            spilled_hits.push_back(make_pair(spilled->query_index,
+                                             spilled->hsp_array[0]->score));
+        }
+        sort(hits.begin(), hits.end());
+        sort(spilled_hits.begin(), spilled_hits.end());
+        BOOST_REQUIRE(hits == spilled_hits);
+        num_hsplists += batch->num_hsplists;
+
+        Blast_HSPStreamResultBatchReset(batch);
+        Blast_HSPStreamResultBatchReset(spill_batch);
+    }
+    BOOST_REQUIRE_EQUAL(0, spill_stream->num_hsplists);
+    BOOST_REQUIRE(num_hsplists > 0);
+
+    batch = Blast_HSPStreamResultBatchFree(batch);
+    spill_batch = Blast_HSPStreamResultBatchFree(spill_batch);
+    hsp_stream = BlastHSPStreamFree(hsp_stream);
+    spill_stream = BlastHSPStreamFree(spill_stream);
+}
 BOOST_AUTO_TEST_SUITE_END()
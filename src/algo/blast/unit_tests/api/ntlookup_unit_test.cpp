@@ -57,7 +57,9 @@
 #include <algo/blast/api/blast_nucl_options.hpp>
 #include <algo/blast/api/disc_nucl_options.hpp>
 #include <algo/blast/core/blast_nalookup.h>
+#include <algo/blast/core/blast_nascan.h>
 #include <algo/blast/core/lookup_util.h>
+#include <algo/blast/core/lookup_wrap.h>
 
 #include "test_objmgr.hpp"
 #include "blast_test_util.hpp"
@@ -75,15 +77,18 @@ using namespace TestUtil;
 struct NtlookupTestFixture {
 
 	BLAST_SequenceBlk *query_blk;
+	BLAST_SequenceBlk *subject_blk;
 	BlastSeqLoc* lookup_segments;
 
     NtlookupTestFixture() {
         query_blk = NULL;
+        subject_blk = NULL;
         lookup_segments = NULL;
     }
 
     ~NtlookupTestFixture() {
         query_blk = BlastSequenceBlkFree(query_blk);
+        subject_blk = BlastSequenceBlkFree(subject_blk);
         lookup_segments = BlastSeqLocFree(lookup_segments);
     }
 
@@ -168,6 +173,196 @@ struct NtlookupTestFixture {
         BlastSeqLocNew(&lookup_segments, 0, len-1);
 
     }
+
+    // Use the first length bases of the query as the subject, packed
+    // four bases to a byte as subject sequences are
+    void SetUpSubjectFromQuery(Int4 length) {
+        Uint1* sequence = (Uint1*) calloc(length / COMPRESSION_RATIO + 1, 1);
+        BOOST_REQUIRE(sequence != NULL);
+        for (Int4 i = 0; i < length; i++) {
+            sequence[i / COMPRESSION_RATIO] |= (query_blk->sequence[i] & 3)
+                        << (2 * (COMPRESSION_RATIO - 1 - i % COMPRESSION_RATIO));
+        }
+        subject_blk = NULL;
+        BOOST_REQUIRE_EQUAL(0, (int)BlastSeqBlkNew(&subject_blk));
+        subject_blk->length = length;
+        BOOST_REQUIRE_EQUAL(0,
+            (int)BlastSeqBlkSetCompressedSequence(subject_blk, sequence));
+    }
+
+    // Find all words of the subject in a lookup table
+    vector< pair<Uint4, Uint4> > ScanAllHits(LookupTableWrap* lookup_wrap_ptr)
+    {
+        vector< pair<Uint4, Uint4> > retval;
+        vector<BlastOffsetPair> offset_pairs(GetOffsetArraySize(lookup_wrap_ptr));
+        void *callback = NULL;
+        Int4 lut_word_length = 0;
+        Int4 scan_range[2];
+
+        BlastChooseNucleotideScanSubject(lookup_wrap_ptr);
+        if (lookup_wrap_ptr->lut_type == eMBLookupTable) {
+            BlastMBLookupTable *lut = (BlastMBLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            callback = lut->scansub_callback;
+            lut_word_length = lut->lut_word_length;
+        }
+        else if (lookup_wrap_ptr->lut_type == eSmallNaLookupTable) {
+            BlastSmallNaLookupTable *lut = (BlastSmallNaLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            callback = lut->scansub_callback;
+            lut_word_length = lut->lut_word_length;
+        }
+        else {
+            BlastNaLookupTable *lut = (BlastNaLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            callback = lut->scansub_callback;
+            lut_word_length = lut->lut_word_length;
+        }
+        BOOST_REQUIRE(callback != NULL);
+
+        scan_range[0] = 0;
+        scan_range[1] = subject_blk->length - lut_word_length;
+        while (scan_range[0] <= scan_range[1]) {
+            Int4 hits = ((TNaScanSubjectFunction)callback)(lookup_wrap_ptr,
+                                 subject_blk, &offset_pairs[0],
+                                 GetOffsetArraySize(lookup_wrap_ptr),
+                                 scan_range);
+            for (Int4 i = 0; i < hits; i++) {
+                retval.push_back(make_pair(offset_pairs[i].qs_offsets.q_off,
+                                           offset_pairs[i].qs_offsets.s_off));
+            }
+        }
+        return retval;
+    }
+
+    // Save a lookup table in an image held in image, and attach a new
+    // lookup table to the image
+    LookupTableWrap* ImageRoundTrip(const LookupTableWrap* lookup_wrap_ptr,
+                                    Uint8 fingerprint, vector<Uint8>& image)
+    {
+        const size_t kSize = LookupTableWrapImageSize(lookup_wrap_ptr,
+                                                      query_blk);
+        BOOST_REQUIRE(kSize > 0);
+        // a vector of Uint8 keeps the image aligned
+        image.assign(kSize / sizeof(Uint8) + 1, 0);
+        BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapImageWrite(lookup_wrap_ptr,
+                                     query_blk, fingerprint, &image[0], kSize));
+
+        LookupTableWrap* retval = NULL;
+        BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapImageAttach(&image[0], kSize,
+                                     fingerprint, query_blk, &retval));
+        BOOST_REQUIRE(retval != NULL);
+        BOOST_REQUIRE(retval->image == &image[0]);
+        BOOST_REQUIRE_EQUAL(lookup_wrap_ptr->lut_type, retval->lut_type);
+        return retval;
+    }
+
+    // Check that two lookup tables hold the same arrays
+    void CheckSameArrays(const LookupTableWrap* built,
+                         const LookupTableWrap* attached)
+    {
+        switch (built->lut_type) {
+        case eSmallNaLookupTable:
+        {
+            const BlastSmallNaLookupTable* a =
+                (const BlastSmallNaLookupTable*) built->lut;
+            const BlastSmallNaLookupTable* b =
+                (const BlastSmallNaLookupTable*) attached->lut;
+            BOOST_REQUIRE_EQUAL(a->backbone_size, b->backbone_size);
+            BOOST_REQUIRE_EQUAL(a->overflow_size, b->overflow_size);
+            BOOST_REQUIRE_EQUAL(a->longest_chain, b->longest_chain);
+            BOOST_REQUIRE_EQUAL(a->lut_word_length, b->lut_word_length);
+            BOOST_REQUIRE(!memcmp(a->final_backbone, b->final_backbone,
+                                  a->backbone_size * sizeof(Int2)));
+            BOOST_REQUIRE(!memcmp(a->overflow, b->overflow,
+                                  a->overflow_size * sizeof(Int2)));
+            break;
+        }
+        case eNaLookupTable:
+        {
+            const BlastNaLookupTable* a =
+                (const BlastNaLookupTable*) built->lut;
+            const BlastNaLookupTable* b =
+                (const BlastNaLookupTable*) attached->lut;
+            BOOST_REQUIRE_EQUAL(a->backbone_size, b->backbone_size);
+            BOOST_REQUIRE_EQUAL(a->overflow_size, b->overflow_size);
+            BOOST_REQUIRE_EQUAL(a->longest_chain, b->longest_chain);
+            BOOST_REQUIRE_EQUAL(a->lut_word_length, b->lut_word_length);
+            BOOST_REQUIRE(!memcmp(a->thick_backbone, b->thick_backbone,
+                          a->backbone_size * sizeof(NaLookupBackboneCell)));
+            BOOST_REQUIRE(!memcmp(a->overflow, b->overflow,
+                                  a->overflow_size * sizeof(Int4)));
+            BOOST_REQUIRE(!memcmp(a->pv, b->pv,
+                                  ((a->backbone_size >> PV_ARRAY_BTS) + 1) *
+                                  sizeof(PV_ARRAY_TYPE)));
+            break;
+        }
+        case eMBLookupTable:
+        {
+            const BlastMBLookupTable* a =
+                (const BlastMBLookupTable*) built->lut;
+            const BlastMBLookupTable* b =
+                (const BlastMBLookupTable*) attached->lut;
+            BOOST_REQUIRE_EQUAL(a->hashsize, b->hashsize);
+            BOOST_REQUIRE_EQUAL(a->two_templates, b->two_templates);
+            BOOST_REQUIRE_EQUAL(a->longest_chain, b->longest_chain);
+            BOOST_REQUIRE_EQUAL(a->pv_array_bts, b->pv_array_bts);
+            BOOST_REQUIRE(!memcmp(a->hashtable, b->hashtable,
+                                  a->hashsize * sizeof(Int4)));
+            BOOST_REQUIRE(!memcmp(a->next_pos, b->next_pos,
+                                  (query_blk->length + 1) * sizeof(Int4)));
+            if (a->two_templates) {
+                BOOST_REQUIRE(!memcmp(a->hashtable2, b->hashtable2,
+                                      a->hashsize * sizeof(Int4)));
+                BOOST_REQUIRE(!memcmp(a->next_pos2, b->next_pos2,
+                                      (query_blk->length + 1) * sizeof(Int4)));
+            }
+            BOOST_REQUIRE(!memcmp(a->pv_array, b->pv_array,
+                                  (a->hashsize >> a->pv_array_bts) *
+                                  PV_ARRAY_BYTES));
+            break;
+        }
+        default:
+            BOOST_FAIL("Lookup table type cannot be saved in an image");
+        }
+    }
+
+    // Build a lookup table, save it in an image and attach a new table to
+    // the image; both tables must hold the same arrays and find the same
+    // words in a subject made of the first subject_length query bases
+    void CheckImageRoundTrip(LookupTableOptions* lookup_options,
+                             ELookupTableType lut_type,
+                             Int4 subject_length)
+    {
+        QuerySetUpOptions* query_options = NULL;
+        BlastQuerySetUpOptionsNew(&query_options);
+        LookupTableWrap* lookup_wrap_ptr = NULL;
+        BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk,
+                                 lookup_options, query_options,
+                                 lookup_segments, 0, &lookup_wrap_ptr,
+                                 NULL, NULL), 0);
+        BOOST_REQUIRE_EQUAL(lut_type,
+                            (ELookupTableType)lookup_wrap_ptr->lut_type);
+        const Uint8 kFingerprint =
+            LookupTableWrapFingerprint(query_blk, lookup_options,
+                                       query_options, lookup_segments, NULL);
+        query_options = BlastQuerySetUpOptionsFree(query_options);
+
+        vector<Uint8> image;
+        LookupTableWrap* attached = ImageRoundTrip(lookup_wrap_ptr,
+                                                   kFingerprint, image);
+        CheckSameArrays(lookup_wrap_ptr, attached);
+
+        SetUpSubjectFromQuery(subject_length);
+        vector< pair<Uint4, Uint4> > built_hits = ScanAllHits(lookup_wrap_ptr);
+        vector< pair<Uint4, Uint4> > attached_hits = ScanAllHits(attached);
+        BOOST_REQUIRE(!built_hits.empty());
+        BOOST_REQUIRE(built_hits == attached_hits);
+
+        // the image must not be written to while it is attached
+        attached = LookupTableWrapFree(attached);
+        lookup_wrap_ptr = LookupTableWrapFree(lookup_wrap_ptr);
+    }
 };
 
 BOOST_FIXTURE_TEST_SUITE(ntlookup, NtlookupTestFixture)
@@ -648,6 +843,126 @@ BOOST_AUTO_TEST_CASE(testMegablastTableSmallUnmaskedRegion) {
 }
 
 
+BOOST_AUTO_TEST_CASE(testSmallNaLookupTableImage) {
+    SetUpQuery(SMALL_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                     FALSE, 0, 0);
+    CheckImageRoundTrip(lookup_options, eSmallNaLookupTable,
+                        (query_blk->length - 1) / 2);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
+
+BOOST_AUTO_TEST_CASE(testStdLookupTableImage) {
+	const int alphabet_size=4;
+	const int word_size=8;
+
+	debruijnInit(word_size, alphabet_size);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                     FALSE, 0, word_size);
+    CheckImageRoundTrip(lookup_options, eNaLookupTable, query_blk->length);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
+
+BOOST_AUTO_TEST_CASE(testMegablastLookupTableImage) {
+    SetUpQuery(LARGE_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                     TRUE, 0, 0);
+    CheckImageRoundTrip(lookup_options, eMBLookupTable,
+                        (query_blk->length - 1) / 2);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
+
+BOOST_AUTO_TEST_CASE(testDiscontiguousMBLookupTableTwoTemplatesImage) {
+    SetUpQuery(SMALL_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                     TRUE, 0, 11);
+	lookup_options->mb_template_length = 16;
+	lookup_options->mb_template_type = eMBWordTwoTemplates;
+    CheckImageRoundTrip(lookup_options, eMBLookupTable,
+                        (query_blk->length - 1) / 2);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
+
+// An image is only attached if it has the expected fingerprint and size
+BOOST_AUTO_TEST_CASE(testLookupTableImageRejected) {
+    SetUpQuery(SMALL_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn,
+                                     FALSE, 0, 0);
+    QuerySetUpOptions* query_options = NULL;
+    BlastQuerySetUpOptionsNew(&query_options);
+	LookupTableWrap* lookup_wrap_ptr = NULL;
+ 	BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             0, &lookup_wrap_ptr, NULL, NULL), 0);
+    const Uint8 kFingerprint =
+        LookupTableWrapFingerprint(query_blk, lookup_options, query_options,
+                                   lookup_segments, NULL);
+
+    // any change of the options changes the fingerprint
+    lookup_options->word_size++;
+    BOOST_REQUIRE(kFingerprint !=
+        LookupTableWrapFingerprint(query_blk, lookup_options, query_options,
+                                   lookup_segments, NULL));
+    lookup_options->word_size--;
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+
+    const size_t kSize = LookupTableWrapImageSize(lookup_wrap_ptr, query_blk);
+    BOOST_REQUIRE(kSize > 0);
+    vector<Uint8> image(kSize / sizeof(Uint8) + 2, 0);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapImageWrite(lookup_wrap_ptr,
+                                 query_blk, kFingerprint, &image[0], kSize));
+
+    LookupTableWrap* attached = NULL;
+    // fingerprint mismatch
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&image[0], kSize,
+                                  kFingerprint + 1, query_blk, &attached));
+    BOOST_REQUIRE(attached == NULL);
+    // size mismatch
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&image[0],
+                                  kSize + sizeof(Uint8), kFingerprint,
+                                  query_blk, &attached));
+    BOOST_REQUIRE(attached == NULL);
+    // truncated image, whether or not the header is complete
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&image[0],
+                                  kSize / 2, kFingerprint, query_blk,
+                                  &attached));
+    BOOST_REQUIRE(attached == NULL);
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&image[0],
+                                  sizeof(Uint8), kFingerprint, query_blk,
+                                  &attached));
+    BOOST_REQUIRE(attached == NULL);
+    // not an image
+    vector<Uint8> garbage(image.size(), 0);
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapImageAttach(&garbage[0],
+                                  kSize, kFingerprint, query_blk,
+                                  &attached));
+    BOOST_REQUIRE(attached == NULL);
+
+    // the intact image is accepted
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapImageAttach(&image[0], kSize,
+                                 kFingerprint, query_blk, &attached));
+    BOOST_REQUIRE(attached != NULL);
+
+    attached = LookupTableWrapFree(attached);
+	lookup_wrap_ptr = LookupTableWrapFree(lookup_wrap_ptr);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
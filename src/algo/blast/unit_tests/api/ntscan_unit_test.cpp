@@ -57,6 +57,7 @@
 #include <algo/blast/core/na_ungapped.h>
 #include <algo/blast/core/blast_stat.h>
 #include <algo/blast/core/lookup_util.h>
+#include <algo/blast/core/blast_simd.h>
 
 #include "test_objmgr.hpp"
 
@@ -719,6 +720,56 @@ struct TestFixture {
         }
     }
 
+    // Scan the whole subject with the scanner chosen for the current
+    // vector instruction set level, and return all hits found. If
+    // last_offset is not NULL, it is set to the last subject offset
+    // scanned
+    vector< pair<Uint4, Uint4> > ScanAllHits(Int4 *last_offset = NULL)
+    {
+        vector< pair<Uint4, Uint4> > retval;
+        void *callback = NULL;
+        Int4 lut_word_length = 0;
+        Int4 scan_range[2];
+
+        BlastChooseNucleotideScanSubject(lookup_wrap_ptr);
+        if (lookup_wrap_ptr->lut_type == eMBLookupTable) {
+            BlastMBLookupTable *lut = (BlastMBLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            callback = lut->scansub_callback;
+            lut_word_length = lut->lut_word_length;
+        }
+        else if (lookup_wrap_ptr->lut_type == eSmallNaLookupTable) {
+            BlastSmallNaLookupTable *lut = (BlastSmallNaLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            callback = lut->scansub_callback;
+            lut_word_length = lut->lut_word_length;
+        }
+        else {
+            BlastNaLookupTable *lut = (BlastNaLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            callback = lut->scansub_callback;
+            lut_word_length = lut->lut_word_length;
+        }
+        BOOST_REQUIRE(callback != NULL);
+
+        scan_range[0] = 0;
+        scan_range[1] = subject_blk->length - lut_word_length;
+        if (last_offset != NULL) {
+            *last_offset = scan_range[1];
+        }
+        while (scan_range[0] <= scan_range[1]) {
+            Int4 hits = ((TNaScanSubjectFunction)callback)(lookup_wrap_ptr,
+                                 subject_blk, offset_pairs, 
+                                 GetOffsetArraySize(lookup_wrap_ptr),
+                                 scan_range);
+            for (Int4 i = 0; i < hits; i++) {
+                retval.push_back(make_pair(offset_pairs[i].qs_offsets.q_off,
+                                           offset_pairs[i].qs_offsets.s_off));
+            }
+        }
+        return retval;
+    }
+
     // Called fourth
     void SkipMaskedRangesCore(void)
     {
@@ -834,6 +885,70 @@ BOOST_AUTO_TEST_CASE( DiscontigTwoSubjects )
     }
 }
 
+// The vectorized scanners, where the CPU supports them, must report
+// exactly the hits of the scalar scanners and in the same order
+BOOST_AUTO_TEST_CASE( VectorScanMatchesScalar )
+{
+    const Int4 kWordSizes[] = { 8, 9, 10, 11, 12, 13, 16, 20, 28 };
+    const size_t kNumWordSizes = sizeof(kWordSizes) / sizeof(*kWordSizes);
+
+    SetUpQuery(MED_GI, eNa_strand_plus);
+    SetUpSubject(SUBJECT_GI);
+
+    for (size_t i = 0; i < kNumWordSizes; i++) {
+        SetUpLookupTable(TRUE, eMBWordCoding, 0, kWordSizes[i]);
+
+        BlastSimd_SetMaxLevel(eBlastSimdNone);
+        vector< pair<Uint4, Uint4> > scalar_hits = ScanAllHits();
+        BlastSimd_SetMaxLevel(eBlastSimdAVX2);
+        vector< pair<Uint4, Uint4> > vector_hits = ScanAllHits();
+
+        BOOST_REQUIRE_EQUAL(scalar_hits.size(), vector_hits.size());
+        BOOST_REQUIRE(scalar_hits == vector_hits);
+        TearDownLookupTable();
+    }
+}
+
+// The vectorized scanners must not report words starting past the end
+// of the scan range, whatever the subject length modulo the compression
+// ratio. The subject is the query itself, so that every word of the
+// subject is a hit
+BOOST_AUTO_TEST_CASE( VectorScanSubjectEnds )
+{
+    const Int4 kWordSizes[] = { 8, 9, 10, 11, 12, 13, 16, 20, 28 };
+    const size_t kNumWordSizes = sizeof(kWordSizes) / sizeof(*kWordSizes);
+    const Boolean kMBLookup[] = { FALSE, TRUE };
+
+    SetUpQuery(MED_GI, eNa_strand_plus);
+    SetUpSubject(MED_GI);
+    const Int4 kLength = subject_blk->length;
+
+    for (size_t m = 0; m < 2; m++) {
+        for (size_t i = 0; i < kNumWordSizes; i++) {
+            SetUpLookupTable(kMBLookup[m], eMBWordCoding, 0, kWordSizes[i]);
+
+            for (Int4 trim = 0; trim < COMPRESSION_RATIO; trim++) {
+                Int4 last_offset = 0;
+                subject_blk->length = kLength - trim;
+
+                BlastSimd_SetMaxLevel(eBlastSimdNone);
+                vector< pair<Uint4, Uint4> > scalar_hits = ScanAllHits();
+                BlastSimd_SetMaxLevel(eBlastSimdAVX2);
+                vector< pair<Uint4, Uint4> > vector_hits =
+                                                ScanAllHits(&last_offset);
+
+                BOOST_REQUIRE(!scalar_hits.empty());
+                BOOST_REQUIRE(scalar_hits == vector_hits);
+                for (size_t h = 0; h < vector_hits.size(); h++) {
+                    BOOST_REQUIRE((Int4)vector_hits[h].second <= last_offset);
+                }
+            }
+            subject_blk->length = kLength;
+            TearDownLookupTable();
+        }
+    }
+}
+
 #define DECLARE_TEST(name, gi, d_size, d_type, wordsize)                    \
 BOOST_AUTO_TEST_CASE( name##ScanOffsetSize##wordsize ) {                    \
     SetUpQuerySubjectAndLUT(TRUE, gi, (EDiscWordType)d_type, d_size, wordsize);\
@@ -38,6 +38,8 @@
 #include <algo/blast/api/objmgr_query_data.hpp>
 #include <algo/blast/api/blast_options_handle.hpp>
 #include <algo/blast/api/seqsrc_seqdb.hpp>
+#include <algo/blast/api/blast_search_stats.hpp>
+#include <algo/blast/core/blast_simd.h>
 #include "blast_test_util.hpp"
 #include "test_objmgr.hpp"
 
@@ -74,8 +76,142 @@ void x_ValidateResultsForShortProteinSearch(CBlastPrelimSearch& blaster,
 
 }
 
+/// Run a preliminary search and list the HSPs it finds as
+/// (query, oid, score, query range, subject range), and optionally the
+/// number of gapped extensions computed with vector code
+static vector< vector<Int4> >
+s_ListPrelimHsps(CBlastPrelimSearch& prelim_search,
+                 Int4* simd_extensions = 0)
+{
+    CRef<SInternalData> results = prelim_search.Run();
+    BOOST_REQUIRE(results->m_HspStream != 0);
+    if (simd_extensions) {
+        const BlastDiagnostics* diags = results->m_Diagnostics->GetPointer();
+        BOOST_REQUIRE(diags && diags->gapped_stat);
+        *simd_extensions = diags->gapped_stat->simd_extensions;
+    }
+
+    CBlastHSPResults hsp_results
+        (prelim_search.ComputeBlastHSPResults
+             (results->m_HspStream->GetPointer()));
+
+    vector< vector<Int4> > retval;
+    for (int i = 0; i < hsp_results->num_queries; i++) {
+        BlastHitList* hitlist = hsp_results->hitlist_array[i];
+        for (int j = 0; hitlist && j < hitlist->hsplist_count; j++) {
+            BlastHSPList* hsp_list = hitlist->hsplist_array[j];
+            for (int k = 0; k < hsp_list->hspcnt; k++) {
+                const BlastHSP* hsp = hsp_list->hsp_array[k];
+                vector<Int4> v;
+                v.push_back(i);
+                v.push_back(hsp_list->oid);
+                v.push_back(hsp->score);
+                v.push_back(hsp->query.offset);
+                v.push_back(hsp->query.end);
+                v.push_back(hsp->subject.offset);
+                v.push_back(hsp->subject.end);
+                retval.push_back(v);
+            }
+        }
+    }
+    sort(retval.begin(), retval.end());
+    return retval;
+}
+
+/// Run a protein preliminary search and list the HSPs it finds
+static vector< vector<Int4> >
+s_GetPrelimHsps(bool one_hit)
+{
+    CSeq_id id(CSeq_id::e_Gi, 129295);
+    CBlastQueryVector q;
+    q.AddQuery(CTestObjMgr::Instance().CreateBlastSearchQuery(id));
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(q));
+
+    CRef<CBlastOptionsHandle> options_handle
+        (CBlastOptionsFactory::Create(eBlastp));
+    CRef<CBlastOptions> options(&options_handle->SetOptions());
+    options->SetSegFiltering(false);
+    options->SetGappedMode(false);
+    options->SetEvalueThreshold(100.0);
+    if (one_hit) {
+        options->SetWindowSize(0);
+    }
+
+    CSearchDatabase dbinfo("ecoli", CSearchDatabase::eBlastDbIsProtein);
+    CBlastPrelimSearch prelim_search(query_factory, options, dbinfo);
+    return s_ListPrelimHsps(prelim_search);
+}
+
+/// Run a blastn preliminary search with the score-only dynamic programming
+/// gapped extension and list the HSPs it finds
+static vector< vector<Int4> >
+s_GetNuclDynProgHsps(Int4* simd_extensions)
+{
+    CSeq_id q_id(CSeq_id::e_Gi, 41646578);
+    const TSeqRange kRange(0, 1500);
+    auto_ptr<SSeqLoc> q_ssl(CTestObjMgr::Instance().CreateSSeqLoc
+                            (q_id, kRange, eNa_strand_both));
+    TSeqLocVector q_tsl;
+    q_tsl.push_back(*q_ssl);
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(q_tsl));
+
+    CRef<CBlastOptionsHandle> options_handle
+        (CBlastOptionsFactory::Create(eBlastn));
+    CRef<CBlastOptions> options(&options_handle->SetOptions());
+    options->SetGapExtnAlgorithm(eDynProgScoreOnly);
+    options->SetDustFiltering(false);
+    options->SetEvalueThreshold(100.0);
+
+    CSearchDatabase dbinfo("data/nt.41646578",
+                           CSearchDatabase::eBlastDbIsNucleotide);
+    CBlastPrelimSearch prelim_search(query_factory, options, dbinfo);
+    return s_ListPrelimHsps(prelim_search, simd_extensions);
+}
+
+/// The vectorized ungapped extension, where the CPU supports it, must find
+/// exactly the HSPs of the scalar extension
+static void s_CompareVectorAndScalarExtension(bool one_hit)
+{
+    BlastSimd_SetMaxLevel(eBlastSimdNone);
+    vector< vector<Int4> > scalar_hsps = s_GetPrelimHsps(one_hit);
+    BlastSimd_SetMaxLevel(eBlastSimdAVX2);
+    vector< vector<Int4> > vector_hsps = s_GetPrelimHsps(one_hit);
+
+    BOOST_REQUIRE(!scalar_hsps.empty());
+    BOOST_REQUIRE_EQUAL(scalar_hsps.size(), vector_hsps.size());
+    BOOST_REQUIRE(scalar_hsps == vector_hsps);
+}
+
 BOOST_AUTO_TEST_SUITE(prelimsearch)
 
+BOOST_AUTO_TEST_CASE(VectorUngappedExtensionTwoHit) {
+    s_CompareVectorAndScalarExtension(false);
+}
+
+BOOST_AUTO_TEST_CASE(VectorUngappedExtensionOneHit) {
+    s_CompareVectorAndScalarExtension(true);
+}
+
+// The vectorized nucleotide gapped extension, where the CPU supports it,
+// must be used and find exactly the HSPs of the scalar extension
+BOOST_AUTO_TEST_CASE(VectorNuclGappedExtension) {
+    Int4 scalar_simd_extensions = -1, vector_simd_extensions = -1;
+    BlastSimd_SetMaxLevel(eBlastSimdNone);
+    vector< vector<Int4> > scalar_hsps =
+        s_GetNuclDynProgHsps(&scalar_simd_extensions);
+    BlastSimd_SetMaxLevel(eBlastSimdAVX2);
+    vector< vector<Int4> > vector_hsps =
+        s_GetNuclDynProgHsps(&vector_simd_extensions);
+
+    BOOST_CHECK_EQUAL(scalar_simd_extensions, 0);
+    if (BlastSimd_GetLevel() >= eBlastSimdSSE41) {
+        BOOST_CHECK(vector_simd_extensions > 0);
+    }
+    BOOST_REQUIRE(!scalar_hsps.empty());
+    BOOST_REQUIRE_EQUAL(scalar_hsps.size(), vector_hsps.size());
+    BOOST_REQUIRE(scalar_hsps == vector_hsps);
+}
+
 BOOST_AUTO_TEST_CASE(ShortProteinSearch) {
     CSeq_id id(CSeq_id::e_Gi, 1786182);
     CBlastQueryVector q;
@@ -135,6 +271,68 @@ BOOST_AUTO_TEST_CASE(ShortProteinSearchMT) {
         (prelim_search, results->m_HspStream->GetPointer(), options);
 }
 
+BOOST_AUTO_TEST_CASE(ShortProteinSearchStageTimesMT) {
+    CSeq_id id(CSeq_id::e_Gi, 1786182);
+    CBlastQueryVector q;
+    q.AddQuery(CTestObjMgr::Instance().CreateBlastSearchQuery(id));
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(q));
+
+    CRef<CBlastOptionsHandle> options_handle
+        (CBlastOptionsFactory::Create(eBlastp));
+    CRef<CBlastOptions> options(&options_handle->SetOptions());
+    options->SetSegFiltering(false);    // allow hits to be found
+
+    CSearchDatabase dbinfo("ecoli", CSearchDatabase::eBlastDbIsProtein);
+
+    CBlastSearchStats::SetStageTimesEnabled(true);
+    CBlastPrelimSearch prelim_search(query_factory, options, dbinfo);
+    prelim_search.SetNumberOfThreads(2);
+    CRef<SInternalData> results = prelim_search.Run();
+    CBlastSearchStats::SetStageTimesEnabled(false);
+
+    BOOST_REQUIRE(results->m_Diagnostics != 0);
+    CBlastSearchStats stats(results->m_Diagnostics->GetPointer());
+    BOOST_REQUIRE(stats.HasStageTimes());
+    BOOST_REQUIRE(stats.GetStageTicks(eBlastStageLookup) > 0);
+    BOOST_REQUIRE(stats.GetStageTicks(eBlastStageScan) > 0);
+    BOOST_REQUIRE(stats.GetStageTicks(eBlastStageGapped) > 0);
+    BOOST_REQUIRE(stats.GetUngappedStats().lookup_hits > 0);
+
+    // the times of the threads add up to the total, and the setup of the
+    // search is not reported as a thread
+    const vector<BlastStageTimes>& threads = stats.GetThreadStageTimes();
+    BOOST_REQUIRE(!threads.empty() && threads.size() <= 2);
+    Int8 scan_ticks = 0;
+    ITERATE(vector<BlastStageTimes>, it, threads) {
+        BOOST_REQUIRE(it->thread_index >= 0 && it->thread_index < 2);
+        scan_ticks += it->ticks[eBlastStageScan];
+    }
+    BOOST_REQUIRE_EQUAL(stats.GetStageTicks(eBlastStageScan), scan_ticks);
+
+    CBlastSearchStats total;
+    total.Add(stats);
+    total.Add(stats);
+    total.AddStageTicks(eBlastStageFormat, 10, 5);
+    BOOST_REQUIRE_EQUAL(2, total.GetNumSearches());
+    BOOST_REQUIRE_EQUAL(2 * stats.GetStageTicks(eBlastStageScan),
+                        total.GetStageTicks(eBlastStageScan));
+    BOOST_REQUIRE_EQUAL((Int8)10, total.GetStageTicks(eBlastStageFormat));
+    BOOST_REQUIRE_EQUAL(5, total.GetThreadStageTimes().back().thread_index);
+
+    // stages run outside the worker threads only count in the totals
+    const size_t kNumThreads = total.GetThreadStageTimes().size();
+    total.AddStageTicks(eBlastStageFormat, 10, CBlastSearchStats::kNoThread);
+    BOOST_REQUIRE_EQUAL((Int8)20, total.GetStageTicks(eBlastStageFormat));
+    BOOST_REQUIRE_EQUAL(kNumThreads, total.GetThreadStageTimes().size());
+
+    CNcbiOstrstream json;
+    total.WriteJson(json);
+    const string kJson = CNcbiOstrstreamToString(json);
+    BOOST_REQUIRE(kJson.find("\"formatting\": { \"ticks\": 20,")
+                  != NPOS);
+    BOOST_REQUIRE(kJson.find("\"thread\": -1") == NPOS);
+}
+
 // This tests a problem that occurred when a chunk consisted of only N's, so that
 // Karlin-Altschul statistics were not calculated.  This is a test for SB-546.
 BOOST_AUTO_TEST_CASE(SplitNucleotideQuery) {
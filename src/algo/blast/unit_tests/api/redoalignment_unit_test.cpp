@@ -57,6 +57,8 @@
 #include <algo/blast/core/blast_kappa.h>
 #include <algo/blast/core/blast_hspstream.h>
 #include <algo/blast/core/hspfilter_collector.h>
+#include <algo/blast/composition_adjustment/composition_adjustment.h>
+#include <algo/blast/composition_adjustment/nlm_linear_algebra.h>
 
 #include <algo/blast/api/blast_options_handle.hpp>
 #include <algo/blast/api/blast_prot_options.hpp>
@@ -944,6 +946,118 @@ BOOST_AUTO_TEST_CASE(testRedoAlignmentUseXdropEvalue) {
     ending_hsp_list = Blast_HSPListFree(ending_hsp_list);
 }
 
+// Composition of a sequence made of the true amino acids, in ncbistdaa,
+// repeated in a pattern that depends on step
+static void
+s_ReadTestComposition(Blast_AminoAcidComposition * composition, int step)
+{
+    const Uint1 kTrueAminoAcids[] = { 1, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                      13, 14, 15, 16, 17, 18, 19, 20, 22 };
+    const int kNumTrueAminoAcids = sizeof(kTrueAminoAcids) / sizeof(Uint1);
+    vector<Uint1> sequence;
+    for (int i = 0; i < 300; i++) {
+        sequence.push_back(kTrueAminoAcids[(i * i / step + i) %
+                                           kNumTrueAminoAcids]);
+    }
+    Blast_ReadAaComposition(composition, BLASTAA_SIZE, &sequence[0],
+                            (int) sequence.size());
+}
+
+// Adjust BLOSUM62 to the compositions of a query and a subject
+static int
+s_AdjustMatrix(int ** matrix, Blast_CompositionWorkspace * NRrecord,
+               const Blast_MatrixInfo * matrixInfo,
+               const Blast_AminoAcidComposition & query_composition,
+               const Blast_AminoAcidComposition & subject_composition)
+{
+    const int kPseudocounts = 20;
+    return Blast_CompositionMatrixAdj(matrix, BLASTAA_SIZE,
+                                      eRelEntropyOldMatrixNewContext,
+                                      query_composition.numTrueAminoAcids,
+                                      subject_composition.numTrueAminoAcids,
+                                      query_composition.prob,
+                                      subject_composition.prob,
+                                      kPseudocounts, 0.0, NRrecord,
+                                      matrixInfo);
+}
+
+// A matrix found in the cache of a composition workspace must be the
+// matrix a workspace with an empty cache computes
+BOOST_AUTO_TEST_CASE(testAdjustedMatrixCache) {
+    Blast_MatrixInfo * matrixInfo =
+        Blast_MatrixInfoNew(BLASTAA_SIZE, BLASTAA_SIZE, 0);
+    BOOST_REQUIRE(matrixInfo);
+    SFreqRatios * freq_ratios = _PSIMatrixFrequencyRatiosNew("BLOSUM62");
+    BOOST_REQUIRE(freq_ratios);
+    for (int i = 0; i < BLASTAA_SIZE; i++) {
+        for (int j = 0; j < BLASTAA_SIZE; j++) {
+            matrixInfo->startFreqRatios[i][j] = freq_ratios->data[i][j];
+        }
+    }
+    freq_ratios = _PSIMatrixFrequencyRatiosFree(freq_ratios);
+    // ungapped Lambda of BLOSUM62
+    matrixInfo->ungappedLambda = 0.3176;
+    Blast_Int4MatrixFromFreq(matrixInfo->startMatrix, BLASTAA_SIZE,
+                             matrixInfo->startFreqRatios,
+                             matrixInfo->ungappedLambda);
+
+    Blast_AminoAcidComposition query_composition, subject_composition,
+        other_composition;
+    s_ReadTestComposition(&query_composition, 7);
+    s_ReadTestComposition(&subject_composition, 3);
+    s_ReadTestComposition(&other_composition, 11);
+
+    Blast_CompositionWorkspace * cached = Blast_CompositionWorkspaceNew();
+    BOOST_REQUIRE(cached);
+    BOOST_REQUIRE_EQUAL(0, Blast_CompositionWorkspaceInit(cached,
+                                                          "BLOSUM62"));
+    int ** matrix = Nlm_Int4MatrixNew(BLASTAA_SIZE, BLASTAA_SIZE);
+    int ** fresh_matrix = Nlm_Int4MatrixNew(BLASTAA_SIZE, BLASTAA_SIZE);
+    BOOST_REQUIRE(matrix && fresh_matrix);
+
+    // The second and fourth adjustments are found in the cache
+    const Blast_AminoAcidComposition * subjects[] =
+        { &subject_composition, &subject_composition,
+          &other_composition, &other_composition };
+    const int kNumSubjects = sizeof(subjects) / sizeof(subjects[0]);
+    for (int k = 0; k < kNumSubjects; k++) {
+        for (int i = 0; i < BLASTAA_SIZE; i++) {
+            for (int j = 0; j < BLASTAA_SIZE; j++) {
+                matrix[i][j] = fresh_matrix[i][j] = INT4_MIN;
+            }
+        }
+        const int kHits = cached->matrix_cache_hits;
+        const int status = s_AdjustMatrix(matrix, cached, matrixInfo,
+                                          query_composition, *subjects[k]);
+        BOOST_REQUIRE_EQUAL(k % 2 == 1 ? kHits + 1 : kHits,
+                            cached->matrix_cache_hits);
+
+        Blast_CompositionWorkspace * fresh = Blast_CompositionWorkspaceNew();
+        BOOST_REQUIRE(fresh);
+        BOOST_REQUIRE_EQUAL(0, Blast_CompositionWorkspaceInit(fresh,
+                                                              "BLOSUM62"));
+        const int fresh_status =
+            s_AdjustMatrix(fresh_matrix, fresh, matrixInfo,
+                           query_composition, *subjects[k]);
+        BOOST_REQUIRE_EQUAL(0, fresh->matrix_cache_hits);
+        Blast_CompositionWorkspaceFree(&fresh);
+
+        BOOST_REQUIRE_EQUAL(0, fresh_status);
+        BOOST_REQUIRE_EQUAL(fresh_status, status);
+        for (int i = 0; i < BLASTAA_SIZE; i++) {
+            for (int j = 0; j < BLASTAA_SIZE; j++) {
+                BOOST_REQUIRE_EQUAL(fresh_matrix[i][j], matrix[i][j]);
+            }
+        }
+    }
+    BOOST_REQUIRE_EQUAL(kNumSubjects, cached->matrix_cache_lookups);
+
+    Nlm_Int4MatrixFree(&matrix);
+    Nlm_Int4MatrixFree(&fresh_matrix);
+    Blast_CompositionWorkspaceFree(&cached);
+    Blast_MatrixInfoFree(&matrixInfo);
+}
+
 // N.B.: the absence of a testPSIRedoAlignmentWithSW is due to the fact
 // that blastpgp reads frequency rations from a checkpoint file and scales
 // the PSSM and K parameter, which we cannot do unless we support reading
@@ -41,6 +41,7 @@
 #include <algo/blast/api/local_blast.hpp>
 #include <algo/blast/api/objmgr_query_data.hpp>
 #include <algo/blast/api/blast_rps_options.hpp>
+#include <algo/blast/api/rpsblast_local.hpp>
 #include <blast_seqalign.hpp>
 
 #include <algo/blast/core/lookup_wrap.h>
@@ -319,5 +320,43 @@ BOOST_AUTO_TEST_CASE(TestCBSFreqsNotFound)
                         CBlastException);
 }
 
+// the threads search batches of the queries, the results must be the same
+// and in the same order as those of a non-threaded search
+BOOST_AUTO_TEST_CASE(ThreadedSearchMatchesSerial)
+{
+    const char* kQueryIds[] = { "gi|129295", "gi|38092615", "gi|68737",
+                                "gi|129295", "gi|38092615", "gi|68737" };
+    const unsigned int kNumThreads = 3;
+
+    CRef<CBlastQueryVector> queries(new CBlastQueryVector);
+    for (size_t i = 0; i < ArraySize(kQueryIds); i++) {
+        CSeq_id id(kQueryIds[i]);
+        queries->AddQuery(CTestObjMgr::Instance().CreateBlastSearchQuery(id));
+    }
+
+    CRef<CBlastOptionsHandle> serial_opts
+        (CBlastOptionsFactory::Create(eRPSBlast));
+    CLocalRPSBlast serial(queries, m_DbName, serial_opts,
+                          kDisableThreadedSearch);
+    CRef<CSearchResultSet> serial_results = serial.Run();
+
+    CRef<CBlastOptionsHandle> threaded_opts
+        (CBlastOptionsFactory::Create(eRPSBlast));
+    CLocalRPSBlast threaded(queries, m_DbName, threaded_opts, kNumThreads);
+    CRef<CSearchResultSet> threaded_results = threaded.Run();
+
+    BOOST_REQUIRE_EQUAL(ArraySize(kQueryIds), serial_results->size());
+    BOOST_REQUIRE_EQUAL(serial_results->size(), threaded_results->size());
+    for (size_t i = 0; i < serial_results->size(); i++) {
+        const CSearchResults& s = (*serial_results)[i];
+        const CSearchResults& t = (*threaded_results)[i];
+        BOOST_REQUIRE(s.GetSeqId()->Match(*t.GetSeqId()));
+        BOOST_REQUIRE_EQUAL(s.HasAlignments(), t.HasAlignments());
+        if (s.HasAlignments()) {
+            BOOST_REQUIRE(s.GetSeqAlign()->Equals(*t.GetSeqAlign()));
+        }
+    }
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -42,6 +42,8 @@
 #include <objmgr/scope.hpp>
 #include <algo/blast/api/seqsrc_multiseq.hpp>
 #include <algo/blast/api/seqsrc_seqdb.hpp>
+#include <algo/blast/api/translated_frame_cache.hpp>
+#include <algo/blast/api/blast_aux.hpp>
 #include <algo/blast/core/blast_util.h>
 #include "blast_objmgr_priv.hpp"
 
@@ -54,6 +56,7 @@
 #include <objects/seqloc/Seq_id.hpp>
 
 #include <corelib/ncbithr.hpp>
+#include <corelib/ncbifile.hpp>
 
 #include "test_objmgr.hpp"
 
@@ -798,6 +801,68 @@ BOOST_AUTO_TEST_CASE(testSeqDbIterator_mixed_20)
 }
 #endif
 
+BOOST_AUTO_TEST_CASE(testSeqDBSrcTranslatedFrames)
+{
+    // The cache is written next to the volume, so work on a copy
+    CDir tmp_dir(CDirEntry::GetTmpName());
+    BOOST_REQUIRE(tmp_dir.Create());
+    const string kDbName = CDirEntry::MakePath(tmp_dir.GetPath(), "seqn");
+    const char* kExtensions[] = { ".nhr", ".nin", ".nsq" };
+    for (size_t i = 0; i < ArraySize(kExtensions); i++) {
+        BOOST_REQUIRE(CFile(string("data/seqn") + kExtensions[i])
+                      .Copy(kDbName + kExtensions[i]));
+    }
+
+    const int kGeneticCode = 11;
+    TAutoUint1ArrayPtr gen_code = FindGeneticCode(kGeneticCode);
+    CTranslatedFrameCache::Write(kDbName, kGeneticCode);
+    BOOST_REQUIRE(CFile(kDbName + CTranslatedFrameCache::kExtension).Exists());
+
+    BlastSeqSrc* seq_src = SeqDbBlastSeqSrcInit(kDbName, false);
+    BOOST_REQUIRE(BlastSeqSrcGetInitError(seq_src) == NULL);
+
+    BlastSeqSrcGetSeqArg seq_arg;
+    memset((void*) &seq_arg, 0, sizeof(seq_arg));
+    seq_arg.encoding = eBlastEncodingNcbi2na;
+    const int kNumSeqs = BlastSeqSrcGetNumSeqs(seq_src);
+    for (seq_arg.oid = 0; seq_arg.oid < kNumSeqs; seq_arg.oid += 10) {
+        BOOST_REQUIRE(BlastSeqSrcGetSequence(seq_src, &seq_arg) >= 0);
+        const BLAST_SequenceBlk* seq = seq_arg.seq;
+        BOOST_REQUIRE(seq->translation_buffer);
+        BOOST_REQUIRE(memcmp(seq->translation_gen_code, gen_code.get(),
+                             GENCODE_STRLEN) == 0);
+
+        // The frames must be those the engine would translate itself
+        Uint1* translation = NULL;
+        Int4* frame_offsets = NULL;
+        BOOST_REQUIRE_EQUAL(0,
+            BLAST_GetAllTranslations(seq->sequence, eBlastEncodingNcbi2na,
+                                     seq->length, gen_code.get(),
+                                     &translation, &frame_offsets, NULL));
+        for (int i = 0; i <= NUM_FRAMES; i++) {
+            BOOST_REQUIRE_EQUAL(frame_offsets[i], seq->frame_offsets[i]);
+        }
+        BOOST_REQUIRE(memcmp(translation, seq->translation_buffer,
+                             frame_offsets[NUM_FRAMES] + 1) == 0);
+        sfree(translation);
+        sfree(frame_offsets);
+        BlastSeqSrcReleaseSequence(seq_src, &seq_arg);
+    }
+    seq_arg.seq = BlastSequenceBlkFree(seq_arg.seq);
+    seq_src = BlastSeqSrcFree(seq_src);
+
+    // Without a cache, the sequences come untranslated
+    seq_src = SeqDbBlastSeqSrcInit("data/seqn", false);
+    seq_arg.oid = 0;
+    BOOST_REQUIRE(BlastSeqSrcGetSequence(seq_src, &seq_arg) >= 0);
+    BOOST_REQUIRE(seq_arg.seq->translation_buffer == NULL);
+    BlastSeqSrcReleaseSequence(seq_src, &seq_arg);
+    seq_arg.seq = BlastSequenceBlkFree(seq_arg.seq);
+    seq_src = BlastSeqSrcFree(seq_src);
+
+    tmp_dir.Remove();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
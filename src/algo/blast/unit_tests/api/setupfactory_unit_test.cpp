@@ -32,12 +32,16 @@
 */
 #include <ncbi_pch.hpp>
 #include <corelib/test_boost.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbifile.hpp>
 #include <algo/blast/api/sseqloc.hpp>
 #include <algo/blast/api/query_data.hpp>
 #include <algo/blast/api/objmgr_query_data.hpp>
 #include <algo/blast/api/blast_nucl_options.hpp>
 #include <algo/blast/api/blast_prot_options.hpp>
 #include <algo/blast/api/setup_factory.hpp>
+#include <algo/blast/api/bl2seq.hpp>
+#include <algo/blast/core/lookup_wrap.h>
 
 #include "blast_memento_priv.hpp"
 
@@ -47,6 +51,143 @@ USING_NCBI_SCOPE;
 USING_SCOPE(blast);
 USING_SCOPE(objects);
 
+/// Saves lookup table images in a new temporary directory, named by
+/// BLAST_LOOKUP_TABLE_CACHE, while the object exists
+class CLookupTableCache
+{
+public:
+    CLookupTableCache()
+        : m_Dir(CDirEntry::GetTmpName())
+    {
+        BOOST_REQUIRE(m_Dir.Create());
+        CNcbiApplication::Instance()->SetEnvironment()
+            .Set("BLAST_LOOKUP_TABLE_CACHE", m_Dir.GetPath());
+    }
+
+    ~CLookupTableCache()
+    {
+        CNcbiApplication::Instance()->SetEnvironment()
+            .Unset("BLAST_LOOKUP_TABLE_CACHE");
+        m_Dir.Remove();
+    }
+
+    /// Get the paths of the images in the cache
+    vector<string> GetImages() const
+    {
+        vector<string> retval;
+        CDir::TEntries entries = m_Dir.GetEntries("lut_*.img");
+        ITERATE(CDir::TEntries, it, entries) {
+            retval.push_back((*it)->GetPath());
+        }
+        return retval;
+    }
+
+private:
+    CDir m_Dir;     ///< Directory of the cache
+};
+
+/// Set up the queries of a search as it would, and create its lookup table
+static LookupTableWrap*
+s_CreateLookupTable(CRef<IQueryFactory> qf, CBlastOptionsHandle& opts_handle)
+{
+    CBlastOptions& opts = opts_handle.SetOptions();
+    CRef<ILocalQueryData> query_data(qf->MakeLocalQueryData(&opts));
+    auto_ptr<const CBlastOptionsMemento> opts_memento(opts.CreateSnapshot());
+
+    BlastSeqLoc* lookup_segments = NULL;
+    TSearchMessages search_messages;
+    BlastScoreBlk* sbp =
+        CSetupFactory::CreateScoreBlock(opts_memento.get(), query_data,
+                                        &lookup_segments, search_messages);
+    BOOST_REQUIRE(sbp != NULL);
+    CRef<CBlastSeqLocWrap> lookup_segments_wrap
+        (new CBlastSeqLocWrap(lookup_segments));
+
+    LookupTableWrap* retval =
+        CSetupFactory::CreateLookupTable(query_data, opts_memento.get(), sbp,
+                                         lookup_segments_wrap);
+    sbp = BlastScoreBlkFree(sbp);
+    BOOST_REQUIRE(retval != NULL);
+    return retval;
+}
+
+/// Create a query factory for a whole sequence
+static CRef<IQueryFactory>
+s_CreateQueryFactory(const string& id, ENa_strand strand)
+{
+    CSeq_id seq_id(id);
+    auto_ptr<SSeqLoc> ssloc(CTestObjMgr::Instance().CreateSSeqLoc(seq_id,
+                                                                  strand));
+    TSeqLocVector tslv;
+    tslv.push_back(*ssloc);
+    return CRef<IQueryFactory>(new CObjMgr_QueryFactory(tslv));
+}
+
+/// Check that two searches found the same alignments
+static void
+s_CheckSameResults(const TSeqAlignVector& expected,
+                   const TSeqAlignVector& actual)
+{
+    BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        BOOST_REQUIRE(expected[i]->Equals(*actual[i]));
+    }
+}
+
+/// Build a lookup table, save its image and attach a new table to the
+/// image; searches with the attached table must find the same alignments
+static void
+s_CheckLookupTableCache(EProgram program, ELookupTableType lut_type,
+                        const string& query_id, const string& subject_id,
+                        ENa_strand strand)
+{
+    CRef<CBlastOptionsHandle> opts(CBlastOptionsFactory::Create(program));
+    CRef<IQueryFactory> qf(s_CreateQueryFactory(query_id, strand));
+
+    CSeq_id qid(query_id), sid(subject_id);
+    auto_ptr<SSeqLoc> query(CTestObjMgr::Instance().CreateSSeqLoc(qid,
+                                                                  strand));
+    auto_ptr<SSeqLoc> subject(CTestObjMgr::Instance().CreateSSeqLoc(sid,
+                                                                    strand));
+    TSeqAlignVector expected = CBl2Seq(*query, *subject, *opts).Run();
+
+    CLookupTableCache cache;
+    LookupTableWrap* lookup = s_CreateLookupTable(qf, *opts);
+    BOOST_REQUIRE_EQUAL(lut_type, (ELookupTableType) lookup->lut_type);
+    BOOST_REQUIRE(lookup->image == NULL);
+    BOOST_REQUIRE_EQUAL(1U, cache.GetImages().size());
+    lookup = LookupTableWrapFree(lookup);
+
+    lookup = s_CreateLookupTable(qf, *opts);
+    BOOST_REQUIRE_EQUAL(lut_type, (ELookupTableType) lookup->lut_type);
+    BOOST_REQUIRE(lookup->image != NULL);
+    lookup = LookupTableWrapFree(lookup);
+
+    // searches that save or map the image of their lookup table
+    s_CheckSameResults(expected, CBl2Seq(*query, *subject, *opts).Run());
+    s_CheckSameResults(expected, CBl2Seq(*query, *subject, *opts).Run());
+}
+
+/// Read a whole file
+static string
+s_ReadFile(const string& path)
+{
+    CNcbiIfstream in(path.c_str(), IOS_BASE::in | IOS_BASE::binary);
+    CNcbiOstrstream buffer;
+    buffer << in.rdbuf();
+    return CNcbiOstrstreamToString(buffer);
+}
+
+/// Replace the contents of a file
+static void
+s_WriteFile(const string& path, const string& data)
+{
+    CNcbiOfstream out(path.c_str(), IOS_BASE::out | IOS_BASE::binary |
+                                    IOS_BASE::trunc);
+    out.write(data.data(), data.size());
+    BOOST_REQUIRE(out.good());
+}
+
 
 BOOST_AUTO_TEST_SUITE(setup_factory)
 
@@ -145,5 +286,81 @@ BOOST_AUTO_TEST_CASE(CreateScoreBlockOK)
      blast_seq_loc = BlastSeqLocFree(blast_seq_loc);
 }
 
+BOOST_AUTO_TEST_CASE(LookupTableCacheSmallNa)
+{
+    s_CheckLookupTableCache(eBlastn, eSmallNaLookupTable,
+                            "gi|1945390", "gi|1945388", eNa_strand_both);
+}
+
+BOOST_AUTO_TEST_CASE(LookupTableCacheMegablast)
+{
+    s_CheckLookupTableCache(eMegablast, eMBLookupTable,
+                            "gi|1945390", "gi|1945388", eNa_strand_both);
+}
+
+BOOST_AUTO_TEST_CASE(LookupTableCacheProtein)
+{
+    s_CheckLookupTableCache(eBlastp, eAaLookupTable,
+                            "gi|129295", "gi|129295", eNa_strand_unknown);
+}
+
+// An image that was truncated is rebuilt and saved again
+BOOST_AUTO_TEST_CASE(LookupTableCacheTruncatedImage)
+{
+    CRef<CBlastOptionsHandle> opts(CBlastOptionsFactory::Create(eMegablast));
+    CRef<IQueryFactory> qf(s_CreateQueryFactory("gi|1945390",
+                                                eNa_strand_both));
+    CLookupTableCache cache;
+
+    LookupTableWrap* lookup = s_CreateLookupTable(qf, *opts);
+    lookup = LookupTableWrapFree(lookup);
+    BOOST_REQUIRE_EQUAL(1U, cache.GetImages().size());
+    const string kPath = cache.GetImages().front();
+    const string kImage = s_ReadFile(kPath);
+    BOOST_REQUIRE(!kImage.empty());
+    s_WriteFile(kPath, kImage.substr(0, kImage.size() / 2));
+
+    lookup = s_CreateLookupTable(qf, *opts);
+    BOOST_REQUIRE(lookup->image == NULL);
+    lookup = LookupTableWrapFree(lookup);
+    BOOST_REQUIRE_EQUAL(kImage.size(), s_ReadFile(kPath).size());
+
+    lookup = s_CreateLookupTable(qf, *opts);
+    BOOST_REQUIRE(lookup->image != NULL);
+    lookup = LookupTableWrapFree(lookup);
+}
+
+// An image saved for other queries is not used, even under the name of
+// the image of these queries
+BOOST_AUTO_TEST_CASE(LookupTableCacheFingerprintMismatch)
+{
+    CRef<CBlastOptionsHandle> opts(CBlastOptionsFactory::Create(eBlastn));
+    CRef<IQueryFactory> qf1(s_CreateQueryFactory("gi|1945390",
+                                                 eNa_strand_both));
+    CRef<IQueryFactory> qf2(s_CreateQueryFactory("gi|555",
+                                                 eNa_strand_both));
+    CLookupTableCache cache;
+
+    LookupTableWrap* lookup = s_CreateLookupTable(qf1, *opts);
+    lookup = LookupTableWrapFree(lookup);
+    BOOST_REQUIRE_EQUAL(1U, cache.GetImages().size());
+    const string kPath1 = cache.GetImages().front();
+
+    lookup = s_CreateLookupTable(qf2, *opts);
+    lookup = LookupTableWrapFree(lookup);
+    vector<string> images = cache.GetImages();
+    BOOST_REQUIRE_EQUAL(2U, images.size());
+    const string kPath2 = (images[0] == kPath1) ? images[1] : images[0];
+
+    s_WriteFile(kPath2, s_ReadFile(kPath1));
+    lookup = s_CreateLookupTable(qf2, *opts);
+    BOOST_REQUIRE(lookup->image == NULL);
+    lookup = LookupTableWrapFree(lookup);
+
+    // the table was saved again under its own name
+    lookup = s_CreateLookupTable(qf2, *opts);
+    BOOST_REQUIRE(lookup->image != NULL);
+    lookup = LookupTableWrapFree(lookup);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,251 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Unit tests comparing the striped (vectorized) Smith-Waterman score
+*   computation with the scalar routines in smith_waterman.c
+*
+* ===========================================================================
+*/
+#include <ncbi_pch.hpp>
+#include <corelib/test_boost.hpp>
+#include <util/random_gen.hpp>
+#include <util/tables/raw_scoremat.h>
+
+#include <algo/blast/core/blast_encoding.h>
+#include <algo/blast/core/blast_simd.h>
+#include <algo/blast/composition_adjustment/smith_waterman.h>
+
+#include <vector>
+
+USING_NCBI_SCOPE;
+
+/// Residues in ncbistdaa order
+static const char kNcbistdaa[] = "-ABCDEFGHIKLMNPQRSTVWXYZU*OJ";
+
+struct SmithWatermanTestFixture {
+    CRandom m_Random;
+    vector< vector<int> > m_Rows;   ///< storage of the score matrix
+    vector<int*> m_Matrix;          ///< row pointers into m_Rows
+    Blast_ForbiddenRanges m_NoRanges;
+
+    SmithWatermanTestFixture() : m_Random(20090105) {
+        m_NoRanges.isEmpty = TRUE;
+        m_NoRanges.numForbidden = NULL;
+        m_NoRanges.ranges = NULL;
+        m_NoRanges.capacity = 0;
+    }
+
+    /// Load BLOSUM62
+    void SetBlosum62() {
+        m_Rows.assign(BLASTAA_SIZE, vector<int>(BLASTAA_SIZE));
+        for (int i = 0; i < BLASTAA_SIZE; i++) {
+            for (int j = 0; j < BLASTAA_SIZE; j++) {
+                m_Rows[i][j] = NCBISM_GetScore(&NCBISM_Blosum62,
+                                               kNcbistdaa[i], kNcbistdaa[j]);
+            }
+        }
+        x_SetRowPointers();
+    }
+
+    /// Load a random position-specific matrix favoring the query residues
+    void SetRandomPssm(const vector<Uint1>& query, int scale) {
+        m_Rows.assign(query.size(), vector<int>(BLASTAA_SIZE));
+        for (size_t i = 0; i < query.size(); i++) {
+            for (int j = 0; j < BLASTAA_SIZE; j++) {
+                m_Rows[i][j] = (m_Random.GetRand(0, 13) - 6) * scale;
+            }
+            m_Rows[i][query[i]] = 7 * scale;
+            // occasional entries as negative as BLAST_SCORE_MIN
+            if (m_Random.GetRand(0, 99) == 0) {
+                m_Rows[i][m_Random.GetRand(0, BLASTAA_SIZE - 1)] = INT2_MIN;
+            }
+        }
+        x_SetRowPointers();
+    }
+
+    /// Fill query and subject with random residues, and (half of the
+    /// time) plant a mutated copy of part of the query in the subject
+    void MakePair(vector<Uint1>& query, int query_length,
+                  vector<Uint1>& subject, int subject_length) {
+        query.resize(query_length);
+        subject.resize(subject_length);
+        for (int i = 0; i < query_length; i++)
+            query[i] = m_Random.GetRand(1, 24);
+        for (int i = 0; i < subject_length; i++)
+            subject[i] = m_Random.GetRand(1, 24);
+        if (m_Random.GetRand(0, 1) == 0)
+            return;
+
+        int length = m_Random.GetRand(1, min(query_length, subject_length));
+        int q = m_Random.GetRand(0, query_length - length);
+        int s = m_Random.GetRand(0, subject_length - length);
+        while (q < query_length && s < subject_length && length-- > 0) {
+            switch (m_Random.GetRand(0, 19)) {
+            case 0:  q++;  break;                          // deletion
+            case 1:  s++;  break;                          // insertion
+            case 2:  subject[s++] = m_Random.GetRand(1, 24);  q++;  break;
+            default: subject[s++] = query[q++];  break;
+            }
+        }
+    }
+
+    /// Compare scalar and vector results for both the score-only and the
+    /// find-start routines
+    void CompareWithScalar(const vector<Uint1>& query,
+                           const vector<Uint1>& subject,
+                           int gap_open, int gap_extend,
+                           bool position_specific) {
+        EBlastSimdLevel level = BlastSimd_GetLevel();
+        int score[2], subject_end[2], query_end[2];
+        int start_score[2], subject_start[2], query_start[2];
+
+        for (int k = 0; k < 2; k++) {
+            BOOST_REQUIRE_EQUAL(0,
+                Blast_SmithWatermanScoreOnly(&score[k], &subject_end[k],
+                    &query_end[k], &subject[0], subject.size(),
+                    &query[0], query.size(), &m_Matrix[0],
+                    gap_open, gap_extend, position_specific, &m_NoRanges,
+                    k == 0 ? eBlastSimdNone : level));
+        }
+        BOOST_REQUIRE_EQUAL(score[0], score[1]);
+        BOOST_REQUIRE_EQUAL(subject_end[0], subject_end[1]);
+        BOOST_REQUIRE_EQUAL(query_end[0], query_end[1]);
+        if (score[0] == 0)
+            return;
+
+        // stop at the optimal score, and at a score below it
+        const int kStopScores[2] = { score[0], score[0] / 2 + 1 };
+        for (int i = 0; i < 2; i++) {
+            for (int k = 0; k < 2; k++) {
+                BOOST_REQUIRE_EQUAL(0,
+                    Blast_SmithWatermanFindStart(&start_score[k],
+                        &subject_start[k], &query_start[k],
+                        &subject[0], subject.size(), &query[0],
+                        &m_Matrix[0], gap_open, gap_extend,
+                        subject_end[0], query_end[0], kStopScores[i],
+                        position_specific, &m_NoRanges,
+                        k == 0 ? eBlastSimdNone : level));
+            }
+            BOOST_REQUIRE_EQUAL(start_score[0], start_score[1]);
+            BOOST_REQUIRE_EQUAL(subject_start[0], subject_start[1]);
+            BOOST_REQUIRE_EQUAL(query_start[0], query_start[1]);
+        }
+    }
+
+private:
+    void x_SetRowPointers() {
+        m_Matrix.resize(m_Rows.size());
+        for (size_t i = 0; i < m_Rows.size(); i++)
+            m_Matrix[i] = &m_Rows[i][0];
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(smithwaterman, SmithWatermanTestFixture)
+
+BOOST_AUTO_TEST_CASE(StripedMatchesScalar)
+{
+    const int kGapCosts[][2] = { {11, 1}, {9, 2}, {5, 2}, {1, 1} };
+    vector<Uint1> query, subject;
+
+    SetBlosum62();
+    for (int trial = 0; trial < 400; trial++) {
+        const int* gap = kGapCosts[trial % 4];
+        MakePair(query, m_Random.GetRand(1, 400),
+                 subject, m_Random.GetRand(1, 600));
+        CompareWithScalar(query, subject, gap[0], gap[1], false);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(StripedMatchesScalarPssm)
+{
+    vector<Uint1> query, subject;
+
+    for (int trial = 0; trial < 200; trial++) {
+        MakePair(query, m_Random.GetRand(1, 300),
+                 subject, m_Random.GetRand(1, 500));
+        // large scales push the scores out of the 8-bit range
+        SetRandomPssm(query, trial % 3 == 0 ? 40 : 1);
+        CompareWithScalar(query, subject, 11, 1, true);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(StripedScoreOverflow)
+{
+    // scores beyond the 8-bit and the 16-bit range
+    vector<Uint1> query, subject;
+
+    SetBlosum62();
+    const int kLengths[] = { 30, 300, 9000 };
+    for (size_t i = 0; i < sizeof(kLengths) / sizeof(kLengths[0]); i++) {
+        MakePair(query, kLengths[i], subject, kLengths[i]);
+        subject = query;
+        CompareWithScalar(query, subject, 11, 1, false);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(StripedProfileReuse)
+{
+    vector<Uint1> query, subject;
+    Blast_SwStripedProfile* profile;
+
+    SetBlosum62();
+    MakePair(query, 250, subject, 10);
+    profile = Blast_SwStripedProfileNew(&query[0], query.size(),
+                                        &m_Matrix[0], BLASTAA_SIZE, FALSE,
+                                        BlastSimd_GetLevel());
+    if (profile == NULL) {
+        BOOST_REQUIRE_EQUAL((int)eBlastSimdNone, (int)BlastSimd_GetLevel());
+        return;
+    }
+
+    for (int trial = 0; trial < 50; trial++) {
+        int score, subject_end, query_end;
+        int expected_score, expected_subject_end, expected_query_end;
+        vector<Uint1> other_query;
+
+        MakePair(other_query, 1, subject, m_Random.GetRand(100, 800));
+        if (trial % 2) {
+            int offset = m_Random.GetRand(0, subject.size() - 100);
+            copy(query.begin() + 50, query.begin() + 150,
+                 subject.begin() + offset);
+        }
+        BOOST_REQUIRE_EQUAL(0,
+            Blast_SmithWatermanScoreOnly(&expected_score,
+                &expected_subject_end, &expected_query_end,
+                &subject[0], subject.size(), &query[0], query.size(),
+                &m_Matrix[0], 11, 1, FALSE, &m_NoRanges, eBlastSimdNone));
+        BOOST_REQUIRE_EQUAL(0,
+            Blast_SwStripedScore(&score, &subject_end, &query_end, profile,
+                                 &subject[0], subject.size(), 11, 1,
+                                 INT4_MAX));
+        BOOST_REQUIRE_EQUAL(expected_score, score);
+        BOOST_REQUIRE_EQUAL(expected_subject_end, subject_end);
+        BOOST_REQUIRE_EQUAL(expected_query_end, query_end);
+    }
+    Blast_SwStripedProfileFree(profile);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Unit tests for the scheduler sharing the chunks of long subject
+*   sequences among the threads of a preliminary search
+*
+* ===========================================================================
+*/
+#include <ncbi_pch.hpp>
+#include <corelib/test_boost.hpp>
+
+#include <algo/blast/core/blast_subject_sched.h>
+#include <algo/blast/api/blast_mtlock.hpp>
+
+using namespace ncbi;
+using namespace ncbi::blast;
+
+struct SubjectSchedulerTestFixture {
+    BlastSubjectScheduler* m_Sched;
+
+    SubjectSchedulerTestFixture() {
+        m_Sched = BlastSubjectSchedulerNew(3, Blast_CMT_LOCKInit());
+        BOOST_REQUIRE(m_Sched);
+    }
+    ~SubjectSchedulerTestFixture() {
+        m_Sched = BlastSubjectSchedulerFree(m_Sched);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(subjectsched, SubjectSchedulerTestFixture)
+
+BOOST_AUTO_TEST_CASE(RegisterThreads)
+{
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerRegisterThread(m_Sched));
+    BOOST_REQUIRE_EQUAL(1, BlastSubjectSchedulerRegisterThread(m_Sched));
+    BOOST_REQUIRE_EQUAL(2, BlastSubjectSchedulerRegisterThread(m_Sched));
+    BOOST_REQUIRE_EQUAL(-1, BlastSubjectSchedulerRegisterThread(m_Sched));
+    BOOST_REQUIRE_EQUAL(2, BlastSubjectSchedulerGetStats(m_Sched, 2)->thread_index);
+}
+
+BOOST_AUTO_TEST_CASE(OwnerTakesChunksInOrder)
+{
+    int job = 0;
+    BlastSubjectWorkUnit unit;
+
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerPush(m_Sched, 0, &job, 4));
+    for (int i = 0; i < 4; i++) {
+        BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 0, FALSE, &unit));
+        BOOST_REQUIRE_EQUAL((void*)&job, unit.job);
+        BOOST_REQUIRE_EQUAL(i, unit.chunk);
+    }
+    BOOST_REQUIRE(!BlastSubjectSchedulerPop(m_Sched, 0, TRUE, &unit));
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerGetStats(m_Sched, 0)->stolen_units);
+}
+
+BOOST_AUTO_TEST_CASE(IdleThreadStealsFromFullestQueue)
+{
+    int job1 = 0, job2 = 0;
+    BlastSubjectWorkUnit unit;
+
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerPush(m_Sched, 0, &job1, 2));
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerPush(m_Sched, 1, &job2, 3));
+
+    // nothing is taken from other queues unless stealing is allowed
+    BOOST_REQUIRE(!BlastSubjectSchedulerPop(m_Sched, 2, FALSE, &unit));
+
+    // thieves take the last chunks of the subject, the owner the first
+    BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 2, TRUE, &unit));
+    BOOST_REQUIRE_EQUAL((void*)&job2, unit.job);
+    BOOST_REQUIRE_EQUAL(2, unit.chunk);
+    BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 1, TRUE, &unit));
+    BOOST_REQUIRE_EQUAL((void*)&job2, unit.job);
+    BOOST_REQUIRE_EQUAL(0, unit.chunk);
+    BOOST_REQUIRE_EQUAL(1, BlastSubjectSchedulerGetStats(m_Sched, 2)->stolen_units);
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerGetStats(m_Sched, 1)->stolen_units);
+
+    // ties go to the lowest thread index
+    BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 2, TRUE, &unit));
+    BOOST_REQUIRE_EQUAL((void*)&job1, unit.job);
+    BOOST_REQUIRE_EQUAL(1, unit.chunk);
+
+    // drain the remaining units so that the scheduler can be freed
+    int units_left = 2;
+    while (BlastSubjectSchedulerPop(m_Sched, 2, TRUE, &unit)) {
+        BOOST_REQUIRE(units_left > 0);
+        BOOST_REQUIRE_EQUAL(units_left == 1,
+            (bool)BlastSubjectSchedulerUnitDone(m_Sched, &units_left));
+    }
+    BOOST_REQUIRE_EQUAL(0, units_left);
+}
+
+BOOST_AUTO_TEST_CASE(QueueGrowsAfterPartialSteal)
+{
+    int job1 = 0, job2 = 0;
+    BlastSubjectWorkUnit unit;
+
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerPush(m_Sched, 0, &job1, 3));
+    BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 1, TRUE, &unit));
+    BOOST_REQUIRE_EQUAL(2, unit.chunk);
+
+    BOOST_REQUIRE_EQUAL(0, BlastSubjectSchedulerPush(m_Sched, 0, &job2, 5));
+    for (int i = 0; i < 5; i++) {
+        BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 0, FALSE, &unit));
+        BOOST_REQUIRE_EQUAL((void*)&job2, unit.job);
+        BOOST_REQUIRE_EQUAL(i, unit.chunk);
+    }
+    for (int i = 0; i < 2; i++) {
+        BOOST_REQUIRE(BlastSubjectSchedulerPop(m_Sched, 0, FALSE, &unit));
+        BOOST_REQUIRE_EQUAL((void*)&job1, unit.job);
+        BOOST_REQUIRE_EQUAL(i, unit.chunk);
+    }
+    BOOST_REQUIRE(!BlastSubjectSchedulerPop(m_Sched, 0, TRUE, &unit));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -218,6 +218,110 @@ public:
         return hsps;
     }
 
+    /// Write an HSP list with a single HSP to an HSP stream
+    void x_WriteSingleHsp(BlastHSPStream * hsp_stream, int oid,
+                          int query_offset, int subject_offset, int length,
+                          int score, double evalue)
+    {
+        BlastHSPList* hsp_list = Blast_HSPListNew(1);
+        BlastHSP * h1 = (BlastHSP*) calloc(1, sizeof(BlastHSP));
+        
+        h1->query.offset = query_offset;
+        h1->query.end = query_offset + length;
+        h1->subject.offset = subject_offset;
+        h1->subject.end = subject_offset + length;
+        h1->score = score;
+        h1->evalue = evalue;
+        h1->query.gapped_start = query_offset + length / 2;
+        h1->subject.gapped_start = subject_offset + length / 2;
+        
+        hsp_list->oid = oid;
+        hsp_list->best_evalue = evalue;
+        BOOST_REQUIRE_EQUAL(0, (int)Blast_HSPListSaveHSP(hsp_list, h1));
+        BlastHSPStreamWrite(hsp_stream, &hsp_list);
+    }
+    
+    /// HSP stream with a self hit of the query, the best of the sample
+    /// HSPs and a weak diagonal HSP on each of up to kNumWeakSubjects other
+    /// subjects; the preliminary e-values of the weak HSPs grow with the
+    /// OID, so that the composition-based statistics traceback can stop
+    /// early once its hitlist is full.
+    CRef< CStructWrapper<BlastHSPStream> >
+    x_GetManySubjectsHspStream(CRef<CBlastOptions> opts, CSeqDB & db,
+                               CSeq_id & query)
+    {
+        const int kNumWeakSubjects = 40;
+        
+        vector<int> query_oids, sample_oids;
+        db.SeqidToOids(query, query_oids);
+        db.SeqidToOids(CSeq_id("gi|158292535"), sample_oids);
+        BOOST_REQUIRE(query_oids.size());
+        BOOST_REQUIRE(sample_oids.size());
+        
+        const int k_query_length = db.GetSeqLength(query_oids.front());
+        
+        BlastHSPWriterInfo * writer_info = BlastHSPCollectorInfoNew(
+                   BlastHSPCollectorParamsNew(
+                                    opts->GetHitSaveOpts(),
+                                    opts->GetExtnOpts()->compositionBasedStats,
+                                    opts->GetScoringOpts()->gapped_calculation));
+
+        BlastHSPWriter* writer = BlastHSPWriterNew(&writer_info, NULL);
+        BOOST_REQUIRE(writer_info == NULL);
+        
+        BlastHSPStream* hsp_stream = BlastHSPStreamNew(
+                                       opts->GetProgramType(),
+                                       opts->GetExtnOpts(),
+                                       FALSE, 1, writer);
+        
+        x_WriteSingleHsp(hsp_stream, query_oids.front(), 0, 0,
+                         k_query_length - 1, 2 * k_query_length, 1e-180);
+        // The best HSP of x_GetSampleHspStream
+        x_WriteSingleHsp(hsp_stream, sample_oids.front(), 0, 1, 307,
+                         370, 1e-50);
+        
+        int num_weak = 0;
+        for (int oid = 0;
+             oid < db.GetNumOIDs() && num_weak < kNumWeakSubjects; oid++) {
+            if (oid == query_oids.front() || oid == sample_oids.front()) {
+                continue;
+            }
+            const int k_length =
+                min(k_query_length, db.GetSeqLength(oid)) - 1;
+            if (k_length < 20) {
+                continue;
+            }
+            x_WriteSingleHsp(hsp_stream, oid, 0, 0, k_length, 40,
+                             0.01 * ++num_weak);
+        }
+        BOOST_REQUIRE_EQUAL(kNumWeakSubjects, num_weak);
+        
+        CRef< CStructWrapper<BlastHSPStream> >
+            hsps(WrapStruct(hsp_stream, BlastHSPStreamFree));
+        
+        return hsps;
+    }
+    
+    /// Scores and e-values of the HSPs in a set of alignments
+    void x_GetScores(const CSeq_align_set & aset,
+                     vector<int> & scores, vector<double> & evalues)
+    {
+        ITERATE(CSeq_align_set::Tdata, align, aset.Get()) {
+            if ((**align).GetSegs().IsDisc()) {
+                x_GetScores((**align).GetSegs().GetDisc(), scores, evalues);
+                continue;
+            }
+            int score = 0;
+            double evalue = 0.0;
+            BOOST_REQUIRE((**align).GetNamedScore(CSeq_align::eScore_Score,
+                                                  score));
+            BOOST_REQUIRE((**align).GetNamedScore(CSeq_align::eScore_EValue,
+                                                  evalue));
+            scores.push_back(score);
+            evalues.push_back(evalue);
+        }
+    }
+    
     void x_FindUsedGis(const CDense_seg & dseg, set<int> & used)
     {
         typedef vector< CRef< CScore > > TScoreList;
@@ -281,7 +385,11 @@ public:
         }
     }
     
-    CSearchResultSet x_Traceback(CSeqDBGiList * gi_list)
+    CSearchResultSet x_Traceback(CSeqDBGiList * gi_list,
+                                 size_t num_threads = 1,
+                                 bool composition_stats = true,
+                                 bool many_subjects = false,
+                                 int hitlist_size = 0)
     {
         // Build uniform search factory, get options
         CRef<ISearchFactory> sf(new CLocalSearchFactory);
@@ -311,10 +419,18 @@ public:
         
         CRef<CBlastOptions>
             opts(& const_cast<CBlastOptions&>(opth->GetOptions()));
+        if ( !composition_stats ) {
+            opts->SetCompositionBasedStats(eNoCompositionBasedStats);
+        }
+        if (hitlist_size > 0) {
+            opts->SetHitlistSize(hitlist_size);
+        }
         
         // Construct false HSPs.
         CRef< CStructWrapper<BlastHSPStream> >
-            hsps(x_GetSampleHspStream(opts, *subject_seqdb));
+            hsps(many_subjects
+                 ? x_GetManySubjectsHspStream(opts, *subject_seqdb, query)
+                 : x_GetSampleHspStream(opts, *subject_seqdb));
         
         // Now to do the traceback..
         
@@ -325,6 +441,7 @@ public:
         CBlastSeqSrc seq_src = SeqDbBlastSeqSrcInit(subject_seqdb);
         CRef<blast::IBlastSeqInfoSrc> seq_info_src(new blast::CSeqDbSeqInfoSrc(subject_seqdb));
         tbs.Reset(new CBlastTracebackSearch(qf, opts, seq_src.Get(), seq_info_src, hsps));
+        tbs->SetNumberOfThreads(num_threads);
         
         CSearchResultSet v = *tbs->Run();
         
@@ -346,6 +463,48 @@ BOOST_AUTO_TEST_CASE(Traceback) {
     BOOST_REQUIRE(use_these.empty());
 }
 
+BOOST_AUTO_TEST_CASE(TracebackMultiThreaded) {
+    // The threads take whole subjects, and the results must be saved in
+    // the same order as by the single-threaded traceback
+    CSearchResultSet rset1 = x_Traceback(0, 1, false);
+    CSearchResultSet rset4 = x_Traceback(0, 4, false);
+    
+    BOOST_REQUIRE( !rset1[0].GetSeqAlign()->Get().empty() );
+    BOOST_REQUIRE(rset1[0].GetSeqAlign()->Equals(*rset4[0].GetSeqAlign()));
+}
+
+BOOST_AUTO_TEST_CASE(TracebackCompositionStatsMultiThreaded) {
+    // The threads redo whole matches, and save them in the order the
+    // single-threaded traceback reads them; with a small hitlist, the
+    // search stops early at the same match whatever the number of threads
+    const int kHitlistSizes[] = { 0, 2 };
+    
+    for (size_t i = 0; i < sizeof(kHitlistSizes) / sizeof(int); i++) {
+        CSearchResultSet rset1 =
+            x_Traceback(0, 1, true, true, kHitlistSizes[i]);
+        CSearchResultSet rset4 =
+            x_Traceback(0, 4, true, true, kHitlistSizes[i]);
+        
+        const CSeq_align_set & aligns1 = *rset1[0].GetSeqAlign();
+        const CSeq_align_set & aligns4 = *rset4[0].GetSeqAlign();
+        
+        BOOST_REQUIRE( !aligns1.Get().empty() );
+        if (kHitlistSizes[i] > 0) {
+            BOOST_REQUIRE((int)aligns1.Get().size() <= kHitlistSizes[i]);
+        }
+        BOOST_REQUIRE_EQUAL(aligns1.Get().size(), aligns4.Get().size());
+        
+        vector<int> scores1, scores4;
+        vector<double> evalues1, evalues4;
+        x_GetScores(aligns1, scores1, evalues1);
+        x_GetScores(aligns4, scores4, evalues4);
+        
+        BOOST_REQUIRE(scores1 == scores4);
+        BOOST_REQUIRE(evalues1 == evalues4);
+        BOOST_REQUIRE(aligns1.Equals(aligns4));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TracebackWithPssm_AndWarning) {
     // read the pssm
     const string kPssmFile("data/pssm_zero_fratios.asn");
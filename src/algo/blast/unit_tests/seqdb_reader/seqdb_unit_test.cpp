@@ -38,6 +38,7 @@
 #include <serial/serialbase.hpp>
 #include <objects/seq/seq__.hpp>
 #include <corelib/ncbifile.hpp>
+#include <corelib/ncbithr.hpp>
 #include <util/sequtil/sequtil_convert.hpp>
 #include <objmgr/util/sequence.hpp>
 #include <math.h>
@@ -263,6 +264,110 @@ private:
     const char * m_Buffer;
 };
 
+/// Get the data of every OID of a database as strings that can be
+/// compared between SeqDB objects: the lengths and packed sequence,
+/// the sequence with ambiguities for nucleotide databases, and
+/// optionally the headers.  This does not use the Boost test macros,
+/// so it can run in several threads at once.
+static void s_GetContents(const CSeqDB   & db,
+                          bool             headers,
+                          vector<string> & contents)
+{
+    const bool is_nucl = (db.GetSequenceType() == CSeqDB::eNucleotide);
+    
+    contents.clear();
+    
+    for(int oid = 0; db.CheckOrFindOID(oid); oid++) {
+        const char * buffer = 0;
+        int length = db.GetSequence(oid, & buffer);
+        
+        string data = s_ToString(length, ",", db.GetSeqLength(oid), ":", "");
+        data.append(buffer, is_nucl ? length / 4 + 1 : length);
+        db.RetSequence(& buffer);
+        
+        if (is_nucl) {
+            length = db.GetAmbigSeq(oid, & buffer, kSeqDBNuclNcbiNA8);
+            data.append(buffer, length);
+            db.RetAmbigSeq(& buffer);
+        }
+        if (headers) {
+            data += s_Stringify(db.GetHdr(oid));
+        }
+        contents.push_back(data);
+    }
+}
+
+/// Thread getting the data of every OID of a database with s_GetContents.
+class CSeqDBContentsThread : public CThread {
+public:
+    CSeqDBContentsThread(const CSeqDB & db, bool headers)
+        : m_SeqDB(db), m_Headers(headers)
+    {
+    }
+    
+    const vector<string> & GetContents() const
+    {
+        return m_Contents;
+    }
+    
+protected:
+    virtual void * Main()
+    {
+        s_GetContents(m_SeqDB, m_Headers, m_Contents);
+        return NULL;
+    }
+    
+private:
+    const CSeqDB   & m_SeqDB;
+    bool             m_Headers;
+    vector<string>   m_Contents;
+};
+
+/// Get the data of every OID of a database from several threads at once,
+/// and check that each thread got the expected data.
+static void s_CheckContentsThreaded(const CSeqDB         & db,
+                                    bool                   headers,
+                                    const vector<string> & expected)
+{
+    const int kNumThreads = 4;
+    
+    vector< CRef<CSeqDBContentsThread> > threads;
+    for(int i = 0; i < kNumThreads; i++) {
+        threads.push_back(CRef<CSeqDBContentsThread>
+                          (new CSeqDBContentsThread(db, headers)));
+    }
+    NON_CONST_ITERATE(vector< CRef<CSeqDBContentsThread> >, thread, threads) {
+        (*thread)->Run();
+    }
+    NON_CONST_ITERATE(vector< CRef<CSeqDBContentsThread> >, thread, threads) {
+        (*thread)->Join();
+    }
+    ITERATE(vector< CRef<CSeqDBContentsThread> >, thread, threads) {
+        const vector<string> & contents = (*thread)->GetContents();
+        BOOST_REQUIRE_EQUAL(expected.size(), contents.size());
+        for(size_t oid = 0; oid < expected.size(); oid++) {
+            BOOST_REQUIRE_MESSAGE(expected[oid] == contents[oid],
+                                  "Data of OID " << oid << " differs");
+        }
+    }
+}
+
+/// RIAA class setting the mapping mode of the SeqDB objects created in
+/// its scope.  The mode is chosen when the first SeqDB object is opened,
+/// so no other SeqDB object may be open.
+class CSeqDBMapModeGuard {
+public:
+    CSeqDBMapModeGuard(ESeqDBMapMode mode)
+    {
+        CSeqDB::SetDefaultMapMode(mode);
+    }
+    
+    ~CSeqDBMapModeGuard()
+    {
+        CSeqDB::SetDefaultMapMode(eSeqDBMapSlices);
+    }
+};
+
 
 // Test Cases
 BOOST_AUTO_TEST_SUITE(seqdb)
@@ -2005,6 +2110,44 @@ BOOST_AUTO_TEST_CASE(SeqidToOid)
     }
 }
 
+BOOST_AUTO_TEST_CASE(IdsToOidsMultiVolume)
+{
+    // nrshort and nrshort.old share almost all of their GIs
+    CSeqDB db("data/nrshort data/seqp data/nrshort.old", CSeqDB::eProtein);
+    
+    vector<int> gis;
+    for(int oid = 0; db.CheckOrFindOID(oid); oid++) {
+        db.GetGis(oid, gis, true);
+    }
+    BOOST_REQUIRE(! gis.empty());
+    
+    // More than 10000 IDs, so that the volumes are searched in parallel,
+    // with each GI of the volumes listed several times and GIs that are
+    // in no volume.
+    CRef<CSeqDBGiList> ids(new CSeqDBGiList);
+    for(int i = 0; ids->GetNumGis() < 25000; i++) {
+        ids->AddGi(gis[i % gis.size()]);
+        ids->AddGi(2 * i + 1);
+    }
+    
+    db.IdsToOids(*ids);
+    
+    int found = 0, missing = 0;
+    for(int i = 0; i < ids->GetNumGis(); i++) {
+        const CSeqDBGiList::SGiOid & gi_oid = ids->GetGiOid(i);
+        int oid = -1;
+        if (db.GiToOid(gi_oid.gi, oid)) {
+            found++;
+        } else {
+            oid = -1;
+            missing++;
+        }
+        BOOST_REQUIRE_EQUAL(oid, gi_oid.oid);
+    }
+    BOOST_REQUIRE(found > 0);
+    BOOST_REQUIRE(missing > 0);
+}
+
 BOOST_AUTO_TEST_CASE(TestResetInternalChunkBookmark)
 {
         
@@ -4019,6 +4162,94 @@ BOOST_AUTO_TEST_CASE(TestSpaceInDbName)
     BOOST_REQUIRE_EQUAL((string) dbs_sum.CompareSelf(), "+A+B=C+a+b=c");
 }
 
+BOOST_AUTO_TEST_CASE(PinnedSequencesMatchLocked)
+{
+    const char * dbnames[] = { "data/seqn", "data/seqp" };
+    const CSeqDB::ESeqType seqtypes[] = { CSeqDB::eNucleotide,
+                                          CSeqDB::eProtein };
+    
+    for(int i = 0; i < 2; i++) {
+        // data/seqn has many sequences with ambiguities
+        vector<string> expected;
+        {
+            CSeqDB db(dbnames[i], seqtypes[i]);
+            BOOST_REQUIRE(! db.IsLockFree());
+            s_GetContents(db, false, expected);
+        }
+        BOOST_REQUIRE(! expected.empty());
+        
+        // The threads mix the lock-free GetSequence with the locked
+        // GetAmbigSeq on the same pinned volumes.
+        CSeqDBMapModeGuard guard(eSeqDBMapWholeFiles);
+        CSeqDB db(dbnames[i], seqtypes[i]);
+        BOOST_REQUIRE(db.IsLockFree());
+        s_CheckContentsThreaded(db, false, expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MapModesMatchDefault)
+{
+    const char * dbnames[] = { "data/seqn", "data/seqp" };
+    const CSeqDB::ESeqType seqtypes[] = { CSeqDB::eNucleotide,
+                                          CSeqDB::eProtein };
+    
+    for(int i = 0; i < 2; i++) {
+        vector<string> expected;
+        {
+            CSeqDB db(dbnames[i], seqtypes[i]);
+            s_GetContents(db, true, expected);
+        }
+        BOOST_REQUIRE(! expected.empty());
+        const int kNumOids = (int) expected.size();
+        
+        // Prefetching slices
+        {
+            CSeqDB db(dbnames[i], seqtypes[i]);
+            db.PrefetchOidRange(0, kNumOids);
+            BOOST_REQUIRE(db.GetAtlasStats().prefetches > 0);
+            
+            vector<string> contents;
+            s_GetContents(db, true, contents);
+            BOOST_REQUIRE(expected == contents);
+        }
+        
+        // Prefetching whole files
+        CSeqDBMapModeGuard guard(eSeqDBMapWholeFiles);
+        CSeqDB db(dbnames[i], seqtypes[i]);
+        db.PrefetchOidRange(0, kNumOids);
+        BOOST_REQUIRE(db.GetAtlasStats().prefetches > 0);
+        s_CheckContentsThreaded(db, true, expected);
+        
+        // The pinned sequence data stays mapped, at the same address,
+        // when the atlas collects the regions not in use.
+        vector<const char *> buffers;
+        for(int oid = 0; oid < kNumOids; oid++) {
+            const char * buffer = 0;
+            db.GetSequence(oid, & buffer);
+            buffers.push_back(buffer);
+            db.RetSequence(& buffer);
+        }
+        
+        db.GarbageCollect();
+        
+        const bool is_nucl = (seqtypes[i] == CSeqDB::eNucleotide);
+        for(int oid = 0; oid < kNumOids; oid++) {
+            const char * buffer = 0;
+            int length = db.GetSequence(oid, & buffer);
+            BOOST_REQUIRE(buffer == buffers[oid]);
+            db.RetSequence(& buffer);
+            
+            string data = s_ToString(length, ",", length, ":", "");
+            data.append(buffers[oid], is_nucl ? length / 4 + 1 : length);
+            BOOST_REQUIRE_EQUAL(data, expected[oid].substr(0, data.size()));
+        }
+        
+        vector<string> contents;
+        s_GetContents(db, true, contents);
+        BOOST_REQUIRE(expected == contents);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif /* SKIP_DOXYGEN_PROCESSING */
 
@@ -34,6 +34,8 @@
 #include <corelib/ncbienv.hpp>
 #include <corelib/ncbithr.hpp>
 #include <corelib/ncbimempool.hpp>
+#include <corelib/ncbi_system.hpp>
+#include <corelib/ncbitime.hpp>
 #include <objects/seqset/Seq_entry.hpp>
 #include <objects/seqset/Bioseq_set.hpp>
 #include <objects/seq/Seq_descr.hpp>
@@ -392,6 +394,11 @@ void CAsn2Asn::Init(void)
                       CArgDescriptions::eInteger);
     d->AddFlag("P",
                "Use memory pool for deserialization");
+    d->AddDefaultKey("Pchunk", "PoolChunkSize",
+                     "size of the memory pool chunks, 0 for the default",
+                     CArgDescriptions::eInteger, "0");
+    d->AddFlag("stat",
+               "Report time and memory used to read and free the data");
     d->AddOptionalKey("l", "logFile",
                       "log errors to <logFile>",
                       CArgDescriptions::eOutputFile);
@@ -871,6 +878,35 @@ END_SCOPE(merge_annot)
 
 DEFINE_STATIC_FAST_MUTEX(s_ArgsMutex);
 
+// Report the time spent reading an object, the memory used with the object
+// still in memory, and the usage of the memory pool if any
+static void s_ReportRead(const string& name, double seconds,
+                         CObjectIStream& in)
+{
+    NcbiCerr << "Read " << name << " in "
+             << NStr::DoubleToString(seconds, 3, NStr::fDoubleFixed) << " s";
+    size_t total = 0, resident = 0, shared = 0;
+    if ( GetMemoryUsage(&total, &resident, &shared) ) {
+        NcbiCerr << ", resident memory " << resident/(1024*1024) << " MB";
+    }
+    if ( const CObjectMemoryPool* pool = in.GetMemoryPool() ) {
+        NcbiCerr << ", memory pool: "
+                 << pool->GetAllocatedCount() << " objects, "
+                 << pool->GetAllocatedSize()/1024 << " KB in "
+                 << pool->GetChunkCount() << " chunks, "
+                 << pool->GetMallocCount() << " objects not pooled";
+    }
+    NcbiCerr << NcbiEndl;
+}
+
+// Report the time spent freeing an object
+static void s_ReportFree(const string& name, double seconds)
+{
+    NcbiCerr << "Freed " << name << " in "
+             << NStr::DoubleToString(seconds, 3, NStr::fDoubleFixed) << " s"
+             << NcbiEndl;
+}
+
 void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
 {
     CFastMutexGuard GUARD(s_ArgsMutex);
@@ -920,6 +956,8 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
     bool readHook = args["ih"];
     bool writeHook = args["oh"];
     bool usePool = args["P"];
+    size_t poolChunkSize = args["Pchunk"].AsInteger();
+    bool stat = args["stat"];
 
     bool quiet = args["q"];
     bool multi = args["m"];
@@ -935,7 +973,7 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
         auto_ptr<CObjectIStream> in(CObjectIStream::Open(inFormat, inFile,
                                                          eSerial_StdWhenAny));
         if ( usePool ) {
-            in->UseMemoryPool();
+            in->UseMemoryPool(poolChunkSize);
         }
         auto_ptr<CObjectOStream> out(!haveOutput? 0:
                                      CObjectOStream::Open(outFormat, outFile,
@@ -1008,6 +1046,7 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
                     // read in the CSerialObject, then
                     // extract the Seq-entry inside there for processing
                     CRef<CSeq_entry> pInnerSeqEntry;
+                    CStopWatch sw(CStopWatch::eStart);
                     if( eDataType == eDataType_SeqEntry ) {
                         CRef<CSeq_entry> pEntry( new CSeq_entry );
                         *in >> *pEntry;
@@ -1023,6 +1062,10 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
                             pInnerSeqEntry = pSeqSubmit->GetData().GetEntrys().front();
                         }
                     }
+                    if ( stat ) {
+                        s_ReportRead(objectTypeInfo.GetName(),
+                                     sw.Elapsed(), *in);
+                    }
 
                     /* do any processing */
                     if( pInnerSeqEntry ) {
@@ -1034,6 +1077,12 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
                             NcbiCerr << "Writing " << objectTypeInfo.GetName() << "..." << NcbiEndl;
                         *out << *pObjectFromIn;
                     }
+                    if ( stat ) {
+                        pInnerSeqEntry.Reset();
+                        sw.Restart();
+                        pObjectFromIn.Reset();
+                        s_ReportFree(objectTypeInfo.GetName(), sw.Elapsed());
+                    }
                 }
             }
             else {              /* read Seq-entry's from a Bioseq-set */
@@ -1054,6 +1103,7 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
                     if ( displayMessages )
                         NcbiCerr << "Reading Bioseq-set..." << NcbiEndl;
 
+                    CStopWatch sw(CStopWatch::eStart);
                     if ( readHook ) {
                         CObjectTypeInfo bioseqSetType = CType<CBioseq_set>();
                         bioseqSetType.FindMember("seq-set")
@@ -1068,6 +1118,9 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
                             SeqEntryProcess(**seqi);    /* do any processing */
                         }
                     }
+                    if ( stat ) {
+                        s_ReportRead("Bioseq-set", sw.Elapsed(), *in);
+                    }
                     if ( haveOutput ) {
                         if ( displayMessages )
                             NcbiCerr << "Writing Bioseq-set..." << NcbiEndl;
@@ -1087,6 +1140,11 @@ void CAsn2Asn::RunAsn2Asn(const string& outFileSuffix)
                             *out << *entries;
                         }
                     }
+                    if ( stat ) {
+                        sw.Restart();
+                        entries.Reset();
+                        s_ReportFree("Bioseq-set", sw.Elapsed());
+                    }
                 }
             }
             if ( !multi || in->EndOfData() )
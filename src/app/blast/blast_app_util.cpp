@@ -51,6 +51,7 @@ static char const rcsid[] =
 #include <algo/blast/blastinput/psiblast_args.hpp>
 #include <algo/blast/blastinput/tblastn_args.hpp>
 #include <algo/blast/blastinput/blast_scope_src.hpp>
+#include <algo/blast/format/blast_format.hpp>
 #include <objmgr/util/sequence.hpp>
 
 #include <objects/seq/Seq_ext.hpp>
@@ -85,6 +86,289 @@ Int4 CBatchSizeMixer::GetBatchSize(Int4 hits)
      return m_BatchSize;
 }
 
+/// Estimated memory used per query letter by a query batch in flight: the
+/// Bioseq in the scope, the BLAST_SequenceBlk of both strands and its
+/// unmasked copy
+static const Uint8 kBytesPerQueryLetter = 4;
+
+/// Number of searched batches whose results may wait to be formatted before
+/// the search thread blocks; their size is not known in advance, so it is
+/// not charged to the memory budget
+static const size_t kMaxQueuedResultSets = 2;
+
+/// Thread running one of the loops of CBlastQueryBatchPipeline
+class CBlastQueryBatchThread : public CThread
+{
+public:
+    typedef void (CBlastQueryBatchPipeline::*TLoop)();
+
+    CBlastQueryBatchThread(CBlastQueryBatchPipeline& pipeline, TLoop loop)
+        : m_Pipeline(pipeline), m_Loop(loop) {}
+
+protected:
+    virtual ~CBlastQueryBatchThread(void) {}
+
+    virtual void* Main(void) {
+        (m_Pipeline.*m_Loop)();
+        return NULL;
+    }
+
+private:
+    CBlastQueryBatchPipeline& m_Pipeline;
+    TLoop m_Loop;
+};
+
+CBlastQueryBatchPipeline::CBlastQueryBatchPipeline(CBlastInput& input,
+                                                   CRef<CScope> scope,
+                                                   CRef<CBlastOptionsHandle> opts_hndl,
+                                                   CBlastFormat& formatter,
+                                                   bool archive,
+                                                   Uint8 memory_budget,
+                                                   CBlastSearchStats* search_stats)
+    : m_Input(input), m_Scope(scope),
+      m_Options(opts_hndl->GetOptions().Clone()),
+      m_Formatter(formatter), m_Archive(archive), m_OptsHndl(opts_hndl),
+      m_MemoryBudget(memory_budget), m_SearchStats(search_stats),
+      m_BatchSize(input.GetBatchSize()),
+      m_SizeInFlight(0), m_InputDone(false), m_Loading(false),
+      m_ResetPending(false), m_SearchDone(false), m_Stop(false)
+{
+    m_Reader.Reset(new CBlastQueryBatchThread(*this,
+                       &CBlastQueryBatchPipeline::x_ReadBatches));
+    m_Writer.Reset(new CBlastQueryBatchThread(*this,
+                       &CBlastQueryBatchPipeline::x_FormatBatches));
+    m_Reader->Run();
+    m_Writer->Run();
+}
+
+CBlastQueryBatchPipeline::~CBlastQueryBatchPipeline()
+{
+    x_StopThreads();
+}
+
+void
+CBlastQueryBatchPipeline::x_StopThreads()
+{
+    {{
+        CFastMutexGuard guard(m_Lock);
+        m_Stop = true;
+        m_Changed.SignalAll();
+    }}
+    if (m_Reader.NotEmpty()) {
+        m_Reader->Join();
+        m_Reader.Reset();
+    }
+    if (m_Writer.NotEmpty()) {
+        m_Writer->Join();
+        m_Writer.Reset();
+    }
+}
+
+void
+CBlastQueryBatchPipeline::x_SetError(const CException& e)
+{
+    CFastMutexGuard guard(m_Lock);
+    if (m_Error.get() == NULL) {
+        m_Error.reset(new CException(DIAG_COMPILE_INFO, &e,
+                                     CException::eUnknown,
+                                     "Query batch pipeline failed"));
+    }
+    m_Stop = true;
+    m_Changed.SignalAll();
+}
+
+void
+CBlastQueryBatchPipeline::x_CheckError()
+{
+    if (m_Error.get()) {
+        // rethrow the original exception, preserving its type
+        m_Error->GetPredecessor()->Throw();
+    }
+}
+
+void
+CBlastQueryBatchPipeline::x_ReadBatches()
+{
+    try {
+        while (true) {
+            {{
+                CFastMutexGuard guard(m_Lock);
+                // read ahead only while the budget allows, but always keep
+                // at least one batch ready
+                while ( !m_Stop && !m_ReadBatches.empty() &&
+                        m_SizeInFlight >= m_MemoryBudget) {
+                    m_Changed.WaitForSignal(m_Lock);
+                }
+                if (m_Stop) {
+                    break;
+                }
+                m_Input.SetBatchSize(m_BatchSize);
+                // the formatting thread does not reset the scope history
+                // while the queries are loaded into the scope
+                m_Loading = true;
+            }}
+            if (m_Input.End()) {
+                break;
+            }
+
+            SBatch batch;
+            batch.m_QueryBatch = m_Input.GetNextSeqBatch(*m_Scope);
+            batch.m_Queries.Reset(new CObjMgr_QueryFactory(*batch.m_QueryBatch));
+
+            // set up the query data now rather than on the search thread
+            CRef<ILocalQueryData> query_data =
+                batch.m_Queries->MakeLocalQueryData(&*m_Options);
+            query_data->GetSequenceBlk();
+            query_data->GetQueryInfo();
+            batch.m_Size = kBytesPerQueryLetter *
+                query_data->GetSumOfSequenceLengths();
+
+            CFastMutexGuard guard(m_Lock);
+            m_Loading = false;
+            m_SizeInFlight += batch.m_Size;
+            m_ReadBatches.push_back(batch);
+            m_Changed.SignalAll();
+        }
+    } catch (const CException& e) {
+        x_SetError(e);
+    } catch (const exception& e) {
+        x_SetError(CException(DIAG_COMPILE_INFO, 0, CException::eUnknown,
+                              e.what()));
+    }
+
+    CFastMutexGuard guard(m_Lock);
+    m_InputDone = true;
+    m_Loading = false;
+    m_Changed.SignalAll();
+}
+
+void
+CBlastQueryBatchPipeline::x_ResetScopeHistory()
+{
+    CFastMutexGuard guard(m_Lock);
+    if (m_Loading && !m_ResetPending) {
+        // try again after the next batch rather than wait for the reader
+        m_ResetPending = true;
+        return;
+    }
+    while ( !m_Stop && m_Loading) {
+        m_Changed.WaitForSignal(m_Lock);
+    }
+    if (m_Loading) {
+        return;
+    }
+    // the reader cannot start loading the next batch while the lock is held
+    m_Formatter.ResetScopeHistory();
+    m_ResetPending = false;
+}
+
+void
+CBlastQueryBatchPipeline::x_FormatBatches()
+{
+    try {
+        while (true) {
+            SBatch batch;
+            {{
+                CFastMutexGuard guard(m_Lock);
+                while ( !m_Stop && !m_SearchDone && m_FormatBatches.empty()) {
+                    m_Changed.WaitForSignal(m_Lock);
+                }
+                if (m_Stop || m_FormatBatches.empty()) {
+                    break;
+                }
+                batch = m_FormatBatches.front();
+            }}
+
+            AddSearchStats(m_SearchStats, *batch.m_Results);
+            {{
+                CBlastFormatTimer timer(m_SearchStats);
+                if (m_Archive) {
+                    m_Formatter.WriteArchive(*batch.m_Queries, *m_OptsHndl,
+                                             *batch.m_Results);
+                } else {
+                    BlastFormatter_PreFetchSequenceData(*batch.m_Results,
+                                                        m_Scope);
+                    ITERATE(CSearchResultSet, result, *batch.m_Results) {
+                        m_Formatter.PrintOneResultSet(**result,
+                                                      batch.m_QueryBatch);
+                    }
+                }
+            }}
+            x_ResetScopeHistory();
+
+            CFastMutexGuard guard(m_Lock);
+            m_FormatBatches.pop_front();
+            m_SizeInFlight -= batch.m_Size;
+            m_Changed.SignalAll();
+        }
+    } catch (const CException& e) {
+        x_SetError(e);
+    } catch (const exception& e) {
+        x_SetError(CException(DIAG_COMPILE_INFO, 0, CException::eUnknown,
+                              e.what()));
+    }
+}
+
+bool
+CBlastQueryBatchPipeline::GetNextBatch(CRef<CBlastQueryVector>& query_batch,
+                                       CRef<IQueryFactory>& queries)
+{
+    CFastMutexGuard guard(m_Lock);
+    while ( !m_Stop && !m_InputDone && m_ReadBatches.empty()) {
+        m_Changed.WaitForSignal(m_Lock);
+    }
+    x_CheckError();
+    if (m_ReadBatches.empty()) {
+        return false;
+    }
+
+    m_SearchBatch = m_ReadBatches.front();
+    m_ReadBatches.pop_front();
+    m_Changed.SignalAll();
+    query_batch = m_SearchBatch.m_QueryBatch;
+    queries = m_SearchBatch.m_Queries;
+    return true;
+}
+
+void
+CBlastQueryBatchPipeline::SetBatchSize(TSeqPos batch_size)
+{
+    CFastMutexGuard guard(m_Lock);
+    m_BatchSize = batch_size;
+}
+
+void
+CBlastQueryBatchPipeline::FormatBatch(CRef<CSearchResultSet> results)
+{
+    CFastMutexGuard guard(m_Lock);
+    while ( !m_Stop && m_FormatBatches.size() >= kMaxQueuedResultSets) {
+        m_Changed.WaitForSignal(m_Lock);
+    }
+    x_CheckError();
+    _ASSERT(m_SearchBatch.m_Queries.NotEmpty());
+    m_SearchBatch.m_Results = results;
+    m_FormatBatches.push_back(m_SearchBatch);
+    m_SearchBatch = SBatch();
+    m_Changed.SignalAll();
+}
+
+void
+CBlastQueryBatchPipeline::Finish()
+{
+    {{
+        CFastMutexGuard guard(m_Lock);
+        m_SearchDone = true;
+        m_Changed.SignalAll();
+        while ( !m_Stop && !m_FormatBatches.empty()) {
+            m_Changed.WaitForSignal(m_Lock);
+        }
+    }}
+    x_StopThreads();
+
+    CFastMutexGuard guard(m_Lock);
+    x_CheckError();
+}
+
 CRef<blast::CRemoteBlast> 
 InitializeRemoteBlast(CRef<blast::IQueryFactory> queries,
                       CRef<blast::CBlastDatabaseArgs> db_args,
@@ -829,6 +1113,37 @@ CheckForFreqRatioFile(const string& rps_dbname, CRef<CBlastOptionsHandle>  & opt
     return;
 }
 
+CRef<CBlastSearchStats>
+InitSearchStats(const CArgs& args, CBlastAppArgs* cmdline_args)
+{
+    CRef<CBlastSearchStats> retval;
+    if (cmdline_args->GetSearchStatsStream(args)) {
+        CBlastSearchStats::SetStageTimesEnabled(true);
+        retval.Reset(new CBlastSearchStats);
+    }
+    return retval;
+}
+
+void
+AddSearchStats(CBlastSearchStats* search_stats,
+               const CSearchResultSet& results)
+{
+    if (search_stats && results.GetSearchStats().NotEmpty()) {
+        search_stats->Add(*results.GetSearchStats());
+    }
+}
+
+void
+WriteSearchStats(const CArgs& args, CBlastAppArgs* cmdline_args,
+                 const CBlastSearchStats* search_stats)
+{
+    CNcbiOstream* out = cmdline_args->GetSearchStatsStream(args);
+    if (out && search_stats) {
+        search_stats->WriteJson(*out);
+        out->flush();
+    }
+}
+
 bool
 IsIStreamEmpty(CNcbiIstream & in)
 {
@@ -47,6 +47,11 @@
 #include <objtools/blast/seqdb_writer/writedb_error.hpp>
 #include <algo/blast/format/blastfmtutil.hpp>   // for CBlastFormatUtil
 #include <algo/blast/blastinput/blast_scope_src.hpp>    // for SDataLoaderConfig
+#include <algo/blast/blastinput/blast_input.hpp>    // for CBlastInput
+#include <algo/blast/api/blast_search_stats.hpp>    // for CBlastSearchStats
+#include <corelib/ncbithr.hpp>                      // for CThread
+#include <corelib/ncbimtx.hpp>                      // for CConditionVariable
+#include <deque>
 
 BEGIN_NCBI_SCOPE
 
@@ -72,6 +77,141 @@ public:
     Int4 GetBatchSize(Int4 hits = -1); 
 };
 
+class CBlastFormat;
+
+/// Overlaps the processing of consecutive query batches in the command line
+/// applications: while one batch is searched on the calling thread, the
+/// next batches are read and their query data set up on a reader thread,
+/// and the results of the previous batches are formatted on a formatting
+/// thread. The batches that are in flight (read ahead, being searched or
+/// waiting to be formatted) are bounded by a memory budget, estimated from
+/// the number of query letters. Only for local searches.
+class CBlastQueryBatchPipeline
+{
+public:
+    /// Constructor; starts the reader and formatting threads
+    /// @param input Source of query batches, only used by the reader
+    /// thread from now on [in]
+    /// @param scope Scope the queries are read into [in]
+    /// @param opts_hndl Options of the search [in]
+    /// @param formatter Formatter, only used by the formatting thread until
+    /// Finish returns [in]
+    /// @param archive Write the results as an archive? [in]
+    /// @param memory_budget Memory for the batches in flight, in bytes [in]
+    /// @param search_stats Statistics to add those of the searches and the
+    /// formatting time to, on the formatting thread, or NULL [in]
+    CBlastQueryBatchPipeline(blast::CBlastInput& input,
+                             CRef<objects::CScope> scope,
+                             CRef<blast::CBlastOptionsHandle> opts_hndl,
+                             CBlastFormat& formatter,
+                             bool archive,
+                             Uint8 memory_budget,
+                             blast::CBlastSearchStats* search_stats = NULL);
+
+    /// Destructor; stops the threads if Finish was not called
+    ~CBlastQueryBatchPipeline();
+
+    /// Get the next query batch to search, waiting for it to be read
+    /// @param query_batch Queries of the batch [out]
+    /// @param queries Query factory with the query data already set up [out]
+    /// @return false if there are no more batches
+    bool GetNextBatch(CRef<blast::CBlastQueryVector>& query_batch,
+                      CRef<blast::IQueryFactory>& queries);
+
+    /// Set the size of the batches read from now on
+    void SetBatchSize(TSeqPos batch_size);
+
+    /// Queue the results of the batch last returned by GetNextBatch for
+    /// formatting; batches are formatted in the order they were read. Blocks
+    /// while the results of too many batches are waiting to be formatted.
+    void FormatBatch(CRef<blast::CSearchResultSet> results);
+
+    /// Wait for all results to be formatted and stop the threads. Errors
+    /// raised on either thread are rethrown here or by GetNextBatch and
+    /// FormatBatch.
+    void Finish();
+
+private:
+    /// Query batch and, once searched, its results
+    struct SBatch {
+        SBatch() : m_Size(0) {}
+        CRef<blast::CBlastQueryVector> m_QueryBatch;
+        CRef<blast::IQueryFactory> m_Queries;
+        CRef<blast::CSearchResultSet> m_Results;
+        Uint8 m_Size;           ///< Estimated memory used by the batch
+    };
+
+    /// Main loop of the reader thread
+    void x_ReadBatches();
+    /// Main loop of the formatting thread
+    void x_FormatBatches();
+    /// Reset the history of the scope once the reader thread is not loading
+    /// queries into it; skips the reset once if the reader is busy
+    void x_ResetScopeHistory();
+    /// Save an error raised on one of the threads and stop the pipeline
+    void x_SetError(const CException& e);
+    /// Rethrow an error saved by x_SetError; m_Lock must be held
+    void x_CheckError();
+    /// Stop and join the threads
+    void x_StopThreads();
+
+    friend class CBlastQueryBatchThread;
+
+    blast::CBlastInput& m_Input;
+    CRef<objects::CScope> m_Scope;
+    /// Copy of the options used to set up the query data, as the search
+    /// may modify the options of the search in progress
+    CRef<blast::CBlastOptions> m_Options;
+    CBlastFormat& m_Formatter;
+    bool m_Archive;
+    CRef<blast::CBlastOptionsHandle> m_OptsHndl;
+    Uint8 m_MemoryBudget;
+    /// Only used by the formatting thread until Finish returns
+    blast::CBlastSearchStats* m_SearchStats;
+
+    CFastMutex m_Lock;          ///< Protects all fields below
+    CConditionVariable m_Changed;   ///< Signalled on any change below
+    TSeqPos m_BatchSize;        ///< Size of the next batch to read
+    deque<SBatch> m_ReadBatches;    ///< Batches read and not yet searched
+    SBatch m_SearchBatch;       ///< Batch being searched
+    deque<SBatch> m_FormatBatches;  ///< Batches waiting to be formatted
+    Uint8 m_SizeInFlight;       ///< Total size of all batches above
+    bool m_InputDone;           ///< Has the reader thread finished?
+    bool m_Loading;             ///< Is the reader loading queries into the scope?
+    bool m_ResetPending;        ///< Was the last scope history reset skipped?
+    bool m_SearchDone;          ///< Have all batches been searched?
+    bool m_Stop;                ///< Should the threads stop?
+    auto_ptr<CException> m_Error;   ///< Wraps the first error raised
+
+    CRef<CThread> m_Reader;     ///< Reads the query batches
+    CRef<CThread> m_Writer;     ///< Formats the results
+};
+
+/// Adds the time spent formatting the results of a query batch to the
+/// statistics of the searches
+class CBlastFormatTimer
+{
+public:
+    /// Start timing
+    /// @param search_stats Statistics to add the time to, or NULL [in]
+    CBlastFormatTimer(blast::CBlastSearchStats* search_stats)
+        : m_SearchStats(search_stats),
+          m_Start(search_stats ? Blast_StageClock() : 0) {}
+
+    /// Add the time spent since construction
+    ~CBlastFormatTimer() {
+        if (m_SearchStats) {
+            m_SearchStats->AddStageTicks(eBlastStageFormat,
+                                         Blast_StageClock() - m_Start,
+                                         blast::CBlastSearchStats::kNoThread);
+        }
+    }
+
+private:
+    blast::CBlastSearchStats* m_SearchStats;
+    Int8 m_Start;
+};
+
 
 /** 
  * @brief Initializes a CRemoteBlast instance for usage by command line BLAST
@@ -254,6 +394,31 @@ ExtractPssmAncillaryData(const objects::CPssmWithParameters& pssm);
 void
 CheckForFreqRatioFile(const string& rps_dbname, CRef<blast::CBlastOptionsHandle>  & opt_handle, bool isRpsblast);
 
+/// Enable the timing of the search stages if the hit counts and stage times
+/// of the searches were requested on the command line; must be called before
+/// the searches are set up
+/// @param args the command line arguments provided by the application [in]
+/// @param cmdline_args command line arguments of the application [in]
+/// @return empty statistics to add those of the searches to, or NULL if they
+/// were not requested
+CRef<blast::CBlastSearchStats>
+InitSearchStats(const CArgs& args, blast::CBlastAppArgs* cmdline_args);
+
+/// Add the statistics of the search of a query batch
+/// @param search_stats Statistics to add to, or NULL [in|out]
+/// @param results Results of the search [in]
+void
+AddSearchStats(blast::CBlastSearchStats* search_stats,
+               const blast::CSearchResultSet& results);
+
+/// Write the statistics of the searches to the file given on the command line
+/// @param args the command line arguments provided by the application [in]
+/// @param cmdline_args command line arguments of the application [in]
+/// @param search_stats Statistics to write, or NULL [in]
+void
+WriteSearchStats(const CArgs& args, blast::CBlastAppArgs* cmdline_args,
+                 const blast::CBlastSearchStats* search_stats);
+
 //Check for empty input stream
 // Note that if true, error/eof is set for the stream
 bool
@@ -102,6 +102,8 @@ int CBlastxApp::Run(void)
            	opts_hndl.Reset(&*m_CmdLineArgs->SetOptions(args));
         }
         const CBlastOptions& opt = opts_hndl->GetOptions();
+        CRef<CBlastSearchStats> search_stats =
+            InitSearchStats(args, m_CmdLineArgs);
 
         /*** Initialize the database/subject ***/
         CRef<CBlastDatabaseArgs> db_args(m_CmdLineArgs->GetBlastDatabaseArgs());
@@ -149,38 +151,66 @@ int CBlastxApp::Run(void)
         formatter.PrintProlog();
 
         /*** Process the input ***/
-        for (; !input.End(); formatter.ResetScopeHistory()) {
+        if (m_CmdLineArgs->GetPipelineMemory() > 0 &&
+            !m_CmdLineArgs->ExecuteRemotely()) {
+            // read the next query batches and format the results of the
+            // previous ones while the current batch is searched
+            CBlastQueryBatchPipeline pipeline(input, scope, opts_hndl,
+                                   formatter,
+                                   fmt_args->ArchiveFormatRequested(args),
+                                   (Uint8)m_CmdLineArgs->GetPipelineMemory()
+                                   << 20,
+                                   search_stats.GetPointerOrNull());
+            CRef<CBlastQueryVector> query_batch;
+            CRef<IQueryFactory> queries;
+            while (pipeline.GetNextBatch(query_batch, queries)) {
+
+                SaveSearchStrategy(args, m_CmdLineArgs, queries, opts_hndl);
 
-            CRef<CBlastQueryVector> query_batch(input.GetNextSeqBatch(*scope));
-            CRef<IQueryFactory> queries(new CObjMgr_QueryFactory(*query_batch));
-
-            SaveSearchStrategy(args, m_CmdLineArgs, queries, opts_hndl);
-
-            CRef<CSearchResultSet> results;
-
-            if (m_CmdLineArgs->ExecuteRemotely()) {
-                CRef<CRemoteBlast> rmt_blast = 
-                    InitializeRemoteBlast(queries, db_args, opts_hndl,
-                          m_CmdLineArgs->ProduceDebugRemoteOutput(),
-                          m_CmdLineArgs->GetClientId());
-                results = rmt_blast->GetResultSet();
-            } else {
                 CLocalBlast lcl_blast(queries, opts_hndl, db_adapter);
                 lcl_blast.SetNumberOfThreads(m_CmdLineArgs->GetNumThreads());
-                results = lcl_blast.Run();
+                CRef<CSearchResultSet> results = lcl_blast.Run();
+                pipeline.FormatBatch(results);
             }
-
-            if (fmt_args->ArchiveFormatRequested(args)) {
-                formatter.WriteArchive(*queries, *opts_hndl, *results);
-            } else {
-                BlastFormatter_PreFetchSequenceData(*results, scope);
-            	ITERATE(CSearchResultSet, result, *results) {
-               	    formatter.PrintOneResultSet(**result, query_batch);
-            	}
+            pipeline.Finish();
+        } else {
+            for (; !input.End(); formatter.ResetScopeHistory()) {
+
+                CRef<CBlastQueryVector> query_batch(input.GetNextSeqBatch(*scope));
+                CRef<IQueryFactory> queries(new CObjMgr_QueryFactory(*query_batch));
+
+                SaveSearchStrategy(args, m_CmdLineArgs, queries, opts_hndl);
+
+                CRef<CSearchResultSet> results;
+
+                if (m_CmdLineArgs->ExecuteRemotely()) {
+                    CRef<CRemoteBlast> rmt_blast = 
+                        InitializeRemoteBlast(queries, db_args, opts_hndl,
+                              m_CmdLineArgs->ProduceDebugRemoteOutput(),
+                              m_CmdLineArgs->GetClientId());
+                    results = rmt_blast->GetResultSet();
+                } else {
+                    CLocalBlast lcl_blast(queries, opts_hndl, db_adapter);
+                    lcl_blast.SetNumberOfThreads(m_CmdLineArgs->GetNumThreads());
+                    results = lcl_blast.Run();
+                }
+
+                AddSearchStats(search_stats.GetPointerOrNull(), *results);
+                CBlastFormatTimer timer(search_stats.GetPointerOrNull());
+                if (fmt_args->ArchiveFormatRequested(args)) {
+                    formatter.WriteArchive(*queries, *opts_hndl, *results);
+                } else {
+                    BlastFormatter_PreFetchSequenceData(*results, scope);
+                	ITERATE(CSearchResultSet, result, *results) {
+                   	    formatter.PrintOneResultSet(**result, query_batch);
+                	}
+                }
             }
         }
 
         formatter.PrintEpilog(opt);
+        WriteSearchStats(args, m_CmdLineArgs,
+                         search_stats.GetPointerOrNull());
 
         if (m_CmdLineArgs->ProduceDebugOutput()) {
             opts_hndl->GetOptions().DebugDumpText(NcbiCerr, "BLAST options", 1);
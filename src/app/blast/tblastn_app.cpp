@@ -98,6 +98,8 @@ int CTblastnApp::Run(void)
         	opts_hndl.Reset(&*m_CmdLineArgs->SetOptions(args));
         }
         const CBlastOptions& opt = opts_hndl->GetOptions();
+        CRef<CBlastSearchStats> search_stats =
+            InitSearchStats(args, m_CmdLineArgs);
         CRef<CQueryOptionsArgs> query_opts = 
             m_CmdLineArgs->GetQueryOptionsArgs();
 
@@ -191,6 +193,8 @@ int CTblastnApp::Run(void)
                     results = lcl_blast.Run();
                 }
 
+                AddSearchStats(search_stats.GetPointerOrNull(), *results);
+                CBlastFormatTimer timer(search_stats.GetPointerOrNull());
                 if (fmt_args->ArchiveFormatRequested(args)) {
                     formatter.WriteArchive(*query_factory, *opts_hndl, *results);
                 } else {
@@ -225,6 +229,8 @@ int CTblastnApp::Run(void)
                 results = psiblast->Run(); 
             }
 
+            AddSearchStats(search_stats.GetPointerOrNull(), *results);
+            CBlastFormatTimer timer(search_stats.GetPointerOrNull());
             if (fmt_args->ArchiveFormatRequested(args)) {
                 formatter.WriteArchive(*query_factory, *opts_hndl, *results);
             } else {
@@ -236,6 +242,8 @@ int CTblastnApp::Run(void)
         }
 
         formatter.PrintEpilog(opt);
+        WriteSearchStats(args, m_CmdLineArgs,
+                         search_stats.GetPointerOrNull());
 
         if (m_CmdLineArgs->ProduceDebugOutput()) {
             opts_hndl->GetOptions().DebugDumpText(NcbiCerr, "BLAST options", 1);
@@ -0,0 +1,290 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Unit tests for the utilities of the BLAST command line applications
+ *
+ */
+
+#include <ncbi_pch.hpp>
+#include <objmgr/object_manager.hpp>
+#include <objmgr/scope.hpp>
+#include <objects/seq/Bioseq.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_data.hpp>
+#include <objects/seq/NCBIeaa.hpp>
+#include <objects/seqloc/Seq_loc.hpp>
+#include <objects/seqloc/Seq_id.hpp>
+#include <objects/seqalign/Seq_align_set.hpp>
+#include <algo/blast/api/blast_options_handle.hpp>
+#include <algo/blast/api/blast_results.hpp>
+#include <algo/blast/format/blast_format.hpp>
+#include "../blast_app_util.hpp"
+
+#undef NCBI_BOOST_NO_AUTO_TEST_MAIN
+#include <corelib/test_boost.hpp>
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+
+USING_NCBI_SCOPE;
+USING_SCOPE(blast);
+USING_SCOPE(objects);
+
+/// Source of protein queries lcl|query000, lcl|query001, ..., added to the
+/// scope as they are read; can fail when reading one of them
+class CTestQuerySource : public CBlastInputSource
+{
+public:
+    /// Constructor
+    /// @param num_queries Number of queries to read [in]
+    /// @param fail_at Index of the query whose reading throws, or -1 [in]
+    CTestQuerySource(int num_queries, int fail_at = -1)
+        : m_NumQueries(num_queries), m_FailAt(fail_at), m_Next(0) {}
+
+    /// Seq-id of a query
+    /// @param index Index of the query [in]
+    static string GetQueryId(int index) {
+        return "query" + NStr::IntToString(index / 100) +
+            NStr::IntToString(index / 10 % 10) + NStr::IntToString(index % 10);
+    }
+
+protected:
+    virtual SSeqLoc GetNextSSeqLoc(CScope& scope) {
+        CRef<CSeq_loc> loc = x_AddNextQuery(scope);
+        return SSeqLoc(*loc, scope);
+    }
+
+    virtual CRef<CBlastSearchQuery> GetNextSequence(CScope& scope) {
+        CRef<CSeq_loc> loc = x_AddNextQuery(scope);
+        return CRef<CBlastSearchQuery>(new CBlastSearchQuery(*loc, scope));
+    }
+
+    virtual bool End() { return m_Next >= m_NumQueries; }
+
+private:
+    CRef<CSeq_loc> x_AddNextQuery(CScope& scope) {
+        if (m_Next == m_FailAt) {
+            NCBI_THROW(CInputException, eInvalidInput,
+                       "Cannot read " + GetQueryId(m_Next));
+        }
+        const string kSequence("MKTAYIAKQRQISFVKSHFSRQLEERLGLIEVQ");
+        CRef<CSeq_id> id(new CSeq_id("lcl|" + GetQueryId(m_Next++)));
+
+        CRef<CBioseq> bioseq(new CBioseq);
+        bioseq->SetId().push_back(id);
+        bioseq->SetInst().SetRepr(CSeq_inst::eRepr_raw);
+        bioseq->SetInst().SetMol(CSeq_inst::eMol_aa);
+        bioseq->SetInst().SetLength(kSequence.size());
+        bioseq->SetInst().SetSeq_data().SetNcbieaa().Set(kSequence);
+        scope.AddBioseq(*bioseq);
+
+        CRef<CSeq_loc> loc(new CSeq_loc);
+        loc->SetWhole(*id);
+        return loc;
+    }
+
+    int m_NumQueries;
+    int m_FailAt;
+    int m_Next;
+};
+
+/// Results without hits for the queries of a batch
+/// @param query_batch Queries of the batch [in]
+/// @param bad_query Index of a query to replace with a Seq-id that is not in
+/// the scope, so that formatting it fails, or -1 [in]
+static CRef<CSearchResultSet>
+s_NoHitsResults(const CBlastQueryVector& query_batch, int bad_query = -1)
+{
+    CSearchResultSet::TQueryIdVector ids;
+    TSeqAlignVector aligns;
+    for (size_t i = 0; i < query_batch.Size(); i++) {
+        if ((int) i == bad_query) {
+            ids.push_back(CConstRef<CSeq_id>(new CSeq_id("lcl|not_in_scope")));
+        } else {
+            ids.push_back(CConstRef<CSeq_id>
+                          (&query_batch.GetQuerySeqLoc(i)->GetWhole()));
+        }
+        aligns.push_back(CRef<CSeq_align_set>(new CSeq_align_set));
+    }
+    TSearchMessages messages;
+    messages.resize(query_batch.Size());
+    return CRef<CSearchResultSet>(new CSearchResultSet(ids, aligns, messages));
+}
+
+/// Objects needed to run a CBlastQueryBatchPipeline formatting to a string
+struct SPipelineFixture
+{
+    SPipelineFixture(int num_queries, int fail_at = -1,
+                     CFormattingArgs::EOutputFormat format =
+                     CFormattingArgs::eTabularWithComments)
+        : m_Scope(new CScope(*CObjectManager::GetInstance())),
+          m_OptsHndl(CBlastOptionsFactory::Create(eBlastp)),
+          // about three queries per batch
+          m_Input(new CTestQuerySource(num_queries, fail_at), 80)
+    {
+        vector<CBlastFormatUtil::SDbInfo> dbinfo(1);
+        dbinfo.front().name = "testdb";
+        m_Formatter.reset(new CBlastFormat(m_OptsHndl->GetOptions(), dbinfo,
+                                           format, true, m_Output, 10, 10,
+                                           *m_Scope));
+    }
+
+    /// Positions of the queries in the output, in the order they were read
+    vector<SIZE_TYPE> GetQueryPositions(int num_queries) {
+        const string kOutput = CNcbiOstrstreamToString(m_Output);
+        vector<SIZE_TYPE> positions;
+        for (int i = 0; i < num_queries; i++) {
+            positions.push_back(NStr::Find(kOutput,
+                                           CTestQuerySource::GetQueryId(i)));
+        }
+        return positions;
+    }
+
+    CRef<CScope> m_Scope;
+    CRef<CBlastOptionsHandle> m_OptsHndl;
+    CBlastInput m_Input;
+    CNcbiOstrstream m_Output;
+    auto_ptr<CBlastFormat> m_Formatter;
+};
+
+BOOST_AUTO_TEST_SUITE(blast_app_util)
+
+BOOST_AUTO_TEST_CASE(QueryBatchPipelineKeepsOrder)
+{
+    const int kNumQueries = 20;
+
+    // a budget of one byte only lets one batch be read ahead at a time
+    const Uint8 kMemoryBudgets[] = { 1, 1024 * 1024 };
+    for (size_t b = 0; b < sizeof(kMemoryBudgets) / sizeof(Uint8); b++) {
+        SPipelineFixture fixture(kNumQueries);
+        int num_batches = 0;
+        int num_read = 0;
+        {{
+            CBlastQueryBatchPipeline pipeline(fixture.m_Input,
+                                              fixture.m_Scope,
+                                              fixture.m_OptsHndl,
+                                              *fixture.m_Formatter, false,
+                                              kMemoryBudgets[b]);
+            CRef<CBlastQueryVector> query_batch;
+            CRef<IQueryFactory> queries;
+            while (pipeline.GetNextBatch(query_batch, queries)) {
+                BOOST_REQUIRE(query_batch->Size() > 0);
+                BOOST_REQUIRE(queries.NotEmpty());
+                // the batches come in the order of the input
+                for (size_t i = 0; i < query_batch->Size(); i++) {
+                    BOOST_REQUIRE_EQUAL("lcl|" +
+                        CTestQuerySource::GetQueryId(num_read++),
+                        query_batch->GetQuerySeqLoc(i)->GetWhole()
+                        .AsFastaString());
+                }
+                pipeline.FormatBatch(s_NoHitsResults(*query_batch));
+                num_batches++;
+            }
+            pipeline.Finish();
+        }}
+        BOOST_REQUIRE_EQUAL(kNumQueries, num_read);
+        BOOST_REQUIRE(num_batches > 1);
+
+        // and their results are formatted in that order too
+        vector<SIZE_TYPE> positions = fixture.GetQueryPositions(kNumQueries);
+        for (int i = 0; i < kNumQueries; i++) {
+            BOOST_REQUIRE(positions[i] != NPOS);
+            BOOST_REQUIRE(i == 0 || positions[i - 1] < positions[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(QueryBatchPipelineReaderError)
+{
+    const int kNumQueries = 20;
+    const int kFailAt = 10;
+    SPipelineFixture fixture(kNumQueries, kFailAt);
+
+    int num_read = 0;
+    bool thrown = false;
+    {{
+        CBlastQueryBatchPipeline pipeline(fixture.m_Input, fixture.m_Scope,
+                                          fixture.m_OptsHndl,
+                                          *fixture.m_Formatter, false, 1);
+        try {
+            CRef<CBlastQueryVector> query_batch;
+            CRef<IQueryFactory> queries;
+            while (pipeline.GetNextBatch(query_batch, queries)) {
+                num_read += (int) query_batch->Size();
+                pipeline.FormatBatch(s_NoHitsResults(*query_batch));
+            }
+            pipeline.Finish();
+        } catch (const CInputException& e) {
+            // the error of the reader thread, with its type
+            BOOST_REQUIRE_EQUAL(CInputException::eInvalidInput,
+                                e.GetErrCode());
+            thrown = true;
+        }
+        // the destructor stops the threads
+    }}
+    BOOST_REQUIRE(thrown);
+    BOOST_REQUIRE(num_read < kFailAt);
+}
+
+BOOST_AUTO_TEST_CASE(QueryBatchPipelineFormatterError)
+{
+    const int kNumQueries = 20;
+    // the pairwise report throws for a query that is not in the scope
+    SPipelineFixture fixture(kNumQueries, -1, CFormattingArgs::eReport);
+
+    int num_batches = 0;
+    bool thrown = false;
+    {{
+        CBlastQueryBatchPipeline pipeline(fixture.m_Input, fixture.m_Scope,
+                                          fixture.m_OptsHndl,
+                                          *fixture.m_Formatter, false, 1);
+        try {
+            CRef<CBlastQueryVector> query_batch;
+            CRef<IQueryFactory> queries;
+            while (pipeline.GetNextBatch(query_batch, queries)) {
+                // the query of the first batch cannot be formatted
+                pipeline.FormatBatch(s_NoHitsResults(*query_batch,
+                                                     num_batches++ == 0
+                                                     ? 0 : -1));
+            }
+            pipeline.Finish();
+        } catch (const CException&) {
+            thrown = true;
+        }
+        // the destructor stops the threads
+    }}
+    BOOST_REQUIRE(thrown);
+    BOOST_REQUIRE(num_batches > 0);
+    // nothing after the failed query was formatted
+    const string kOutput = CNcbiOstrstreamToString(fixture.m_Output);
+    for (int i = 0; i < kNumQueries; i++) {
+        BOOST_REQUIRE_EQUAL(NPOS,
+            NStr::Find(kOutput, CTestQuerySource::GetQueryId(i)));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif /* SKIP_DOXYGEN_PROCESSING */
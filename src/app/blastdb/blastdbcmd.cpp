@@ -121,11 +121,28 @@ private:
     /// @param entry the user's query [in]
     void x_AddOid(CBlastDBCmdApp::TQueries& retval, const int oid, bool check=false) const;
 
+    /// Find the OIDs of the GIs of a batch of entries with one sorted
+    /// lookup, instead of one lookup per entry
+    /// @param gis the GIs of the user's queries, 0 for other IDs [in]
+    /// @param gi_oids the OIDs found, indexed by GI [out]
+    void x_BatchGiToOid(const vector<int>& gis,
+                        map<int, int>& gi_oids) const;
+
     /// Process batch entry with range, strand and filter id
     /// @param args program input args
     /// @param seq_fmt sequence formatter object
     /// @return 0 on sucess; 1 if some queries were not processed
     int x_ProcessBatchEntry(const CArgs& args, CSeqFormatter & seq_fmt);
+
+    /// Process a chunk of the lines of a batch entry, looking up its GIs
+    /// at once
+    /// @param batch the fields of each line [in]
+    /// @param gis the GI of each line, 0 for other IDs [in]
+    /// @param seq_fmt sequence formatter object
+    /// @return 0 on sucess; 1 if some queries were not processed
+    int x_ProcessBatchChunk(const vector< vector<string> >& batch,
+                            const vector<int>& gis,
+                            CSeqFormatter & seq_fmt);
 };
 
 int
@@ -410,10 +427,55 @@ CBlastDBCmdApp::x_ProcessSearchRequest()
     return errors_found ? 1 : 0;
 }
 
+void
+CBlastDBCmdApp::x_BatchGiToOid(const vector<int>& gis,
+                               map<int, int>& gi_oids) const
+{
+    // Only the default lookup of the first OID of an entry is batched;
+    // duplicates need all OIDs, and target_only needs no lookup at all
+    if (m_GetDuplicates || m_TargetOnly) {
+        return;
+    }
+
+    CRef<CSeqDBGiList> gi_list(new CSeqDBGiList);
+    ITERATE(vector<int>, gi, gis) {
+        if (*gi > 0) {
+            gi_list->AddGi(*gi);
+        }
+    }
+    if (gi_list->GetNumGis() == 0) {
+        return;
+    }
+
+    try {
+        m_BlastDb->IdsToOids(*gi_list);
+    } catch (const CSeqDBException&) {
+        // No GI index; each entry is looked up on its own
+        return;
+    }
+
+    for (int i = 0; i < gi_list->GetNumGis(); i++) {
+        const CSeqDBGiList::SGiOid& gi_oid = gi_list->GetGiOid(i);
+        int oid = gi_oid.oid;
+        // The OID must also pass the OID mask, as in AccessionToOids;
+        // entries failing this are left to x_AddSeqId
+        if (oid >= 0 && m_BlastDb->CheckOrFindOID(oid) &&
+            oid == gi_oid.oid) {
+            gi_oids[gi_oid.gi] = oid;
+        }
+    }
+}
+
 int CBlastDBCmdApp::x_ProcessBatchEntry(const CArgs& args, CSeqFormatter & seq_fmt)
 {
     CNcbiIstream& input = args["entry_batch"].AsInputFile();
     bool err_found = false;
+
+    // Read the batch in chunks: the GIs of a chunk are looked up at once,
+    // and the memory used does not grow with the size of the batch
+    static const size_t kChunkSize = 10000;
+    vector< vector<string> > batch;
+    vector<int> gis;
     while (input) {
         string line;
         NcbiGetlineEOL(input, line);
@@ -423,47 +485,86 @@ int CBlastDBCmdApp::x_ProcessBatchEntry(const CArgs& args, CSeqFormatter & seq_f
         	if(tmp.empty())
         		continue;
 
-        	TQueries queries;
-        	if(x_AddSeqId(queries, tmp[0]) > 0 )
-        			err_found = true;
-
-            if(queries.empty())
-            	continue;
-
-           	TSeqRange seq_range(TSeqRange::GetEmpty());
-            ENa_strand seq_strand = eNa_strand_plus;
-           	int seq_algo_id = -1;
-
-           	for(unsigned int i=1; i < tmp.size(); i++) {
-
-           		if(tmp[i].find('-')!= string::npos)
-            	{
-            		try {
-            			seq_range = ParseSequenceRangeOpenEnd(tmp[i]);
-            		} catch (...) {
-            			seq_range = TSeqRange::GetEmpty();
-            		}
-            	}
-            	else if (!m_DbIsProtein && NStr::EqualNocase(tmp[i].c_str(), "minus")) {
-            		seq_strand = eNa_strand_minus;
-            	}
-            	else {
-            		seq_algo_id = NStr::StringToNonNegativeInt(tmp[i]);
-            	}
+            Int8 num_id(-1);
+            string str_id;
+            bool simpler(false);
+            if (SeqDB_SimplifyAccession(tmp[0], num_id, str_id, simpler)
+                    != eGiId || num_id <= 0 || num_id > kMax_Int) {
+                num_id = 0;
             }
-
-           	seq_fmt.SetConfig(seq_range, seq_strand, seq_algo_id);
-            NON_CONST_ITERATE(TQueries, itr, queries) {
-            	try {
-            		seq_fmt.Write(**itr);
-            	} catch (const CException& e) {
-                     ERR_POST(Error << e.GetMsg());
-                     err_found = true;
-            	} catch (...) {
-                  	ERR_POST(Error << "Failed to retrieve requested item");
-                   	err_found = true;
-            	}
+            batch.push_back(tmp);
+            gis.push_back((int) num_id);
+        }
+        if (batch.size() == kChunkSize) {
+            if (x_ProcessBatchChunk(batch, gis, seq_fmt) > 0) {
+                err_found = true;
             }
+            batch.clear();
+            gis.clear();
+        }
+    }
+    if (!batch.empty() && x_ProcessBatchChunk(batch, gis, seq_fmt) > 0) {
+        err_found = true;
+    }
+    return err_found ? 1:0;
+}
+
+int
+CBlastDBCmdApp::x_ProcessBatchChunk(const vector< vector<string> >& batch,
+                                    const vector<int>& gis,
+                                    CSeqFormatter & seq_fmt)
+{
+    bool err_found = false;
+    map<int, int> gi_oids;
+    x_BatchGiToOid(gis, gi_oids);
+
+    for (size_t entry = 0; entry < batch.size(); entry++) {
+        const vector<string>& tmp = batch[entry];
+
+        TQueries queries;
+        map<int, int>::const_iterator gi_oid = gi_oids.find(gis[entry]);
+        if (gi_oid != gi_oids.end()) {
+            x_AddOid(queries, gi_oid->second, true);
+        } else if (x_AddSeqId(queries, tmp[0]) > 0) {
+            err_found = true;
+        }
+
+        if(queries.empty())
+        	continue;
+
+       	TSeqRange seq_range(TSeqRange::GetEmpty());
+        ENa_strand seq_strand = eNa_strand_plus;
+       	int seq_algo_id = -1;
+
+       	for(unsigned int i=1; i < tmp.size(); i++) {
+
+       		if(tmp[i].find('-')!= string::npos)
+        	{
+        		try {
+        			seq_range = ParseSequenceRangeOpenEnd(tmp[i]);
+        		} catch (...) {
+        			seq_range = TSeqRange::GetEmpty();
+        		}
+        	}
+        	else if (!m_DbIsProtein && NStr::EqualNocase(tmp[i].c_str(), "minus")) {
+        		seq_strand = eNa_strand_minus;
+        	}
+        	else {
+        		seq_algo_id = NStr::StringToNonNegativeInt(tmp[i]);
+        	}
+        }
+
+       	seq_fmt.SetConfig(seq_range, seq_strand, seq_algo_id);
+        NON_CONST_ITERATE(TQueries, itr, queries) {
+        	try {
+        		seq_fmt.Write(**itr);
+        	} catch (const CException& e) {
+                 ERR_POST(Error << e.GetMsg());
+                 err_found = true;
+        	} catch (...) {
+              	ERR_POST(Error << "Failed to retrieve requested item");
+               	err_found = true;
+        	}
         }
     }
     return err_found ? 1:0;
@@ -39,7 +39,9 @@ static char const rcsid[] =
 
 #include <ncbi_pch.hpp>
 #include <algo/blast/api/version.hpp>
+#include <algo/blast/api/translated_frame_cache.hpp>
 #include <algo/blast/blastinput/blast_input_aux.hpp>
+#include <algo/blast/blastinput/cmdline_flags.hpp>
 #include <corelib/ncbiapp.hpp>
 
 #include <serial/iterator.hpp>
@@ -113,6 +115,8 @@ private:
     
     void x_BuildDatabase();
     
+    void x_WriteTranslatedFrames(const string & dbname, int genetic_code);
+    
     void x_AddFasta(CNcbiIstream & data);
     
     void x_AddSeqEntries(CNcbiIstream & data, TFormat fmt);
@@ -233,6 +237,14 @@ void CMakeBlastDBApp::Init()
     arg_desc->AddFlag("hash_index",
                       "Create index of sequence hash values.",
                       true);
+
+    arg_desc->AddOptionalKey(kArgDbGeneticCode, "int_value",
+                             "Genetic code of the translated frame cache "
+                             "written next to each volume, which tblastn "
+                             "and tblastx searches with the same genetic "
+                             "code use instead of translating the "
+                             "sequences (nucleotide databases only)",
+                             CArgDescriptions::eInteger);
     
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
@@ -279,6 +291,13 @@ void CMakeBlastDBApp::Init()
     arg_desc->AddDefaultKey("max_file_sz", "number_of_bytes",
                             "Maximum file size for BLAST database files",
                             CArgDescriptions::eString, "1GB");
+    arg_desc->AddDefaultKey(kArgNumThreads, "int_value",
+                            "Number of threads used to sort the indices "
+                            "and finish the volumes (the database is the "
+                            "same for any number of threads)",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->SetConstraint(kArgNumThreads,
+                            new CArgAllowValuesGreaterThanOrEqual(1));
 #if _BLAST_DEBUG
     arg_desc->AddFlag("verbose", "Produce verbose output", true);
 #endif /* _BLAST_DEBUG */
@@ -1021,6 +1040,7 @@ void CMakeBlastDBApp::x_BuildDatabase()
                << Uint8ToString_DataSize(bytes) << endl;
     
     m_DB->SetMaxFileSize(bytes);
+    m_DB->SetNumThreads(args[kArgNumThreads].AsInteger());
 
     if (args["taxid"].HasValue()) {
         _ASSERT( !args["taxid_map"].HasValue() );
@@ -1038,7 +1058,35 @@ void CMakeBlastDBApp::x_BuildDatabase()
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     x_ProcessMaskData();
 #endif
+    if (args[kArgDbGeneticCode].HasValue() && is_protein) {
+        NCBI_THROW(CInvalidDataException, eInvalidInput, 
+            "-" + kArgDbGeneticCode + " requires a nucleotide database");
+    }
+
     x_ProcessInputData(args[kInput].AsString(), is_protein);
+
+    if (args[kArgDbGeneticCode].HasValue()) {
+        // The volumes must be complete before they are translated, and
+        // the build is finished once their translations are written
+        if (m_DB->CloseVolumes()) {
+            x_WriteTranslatedFrames(dbname,
+                                    args[kArgDbGeneticCode].AsInteger());
+        }
+        m_DB->EndBuild();
+    }
+}
+
+void CMakeBlastDBApp::x_WriteTranslatedFrames(const string & dbname,
+                                              int            genetic_code)
+{
+    CSeqDB db(dbname, CSeqDB::eNucleotide);
+    vector<string> volumes;
+    vector<int> oid_starts;
+    db.GetVolumeOidStarts(volumes, oid_starts);
+    ITERATE(vector<string>, volume, volumes) {
+        CTranslatedFrameCache::Write(*volume, genetic_code);
+        m_DB->AddExtraFile(*volume + CTranslatedFrameCache::kExtension);
+    }
 }
 
 int CMakeBlastDBApp::Run(void)
@@ -41,7 +41,9 @@
 #include <serial/objistr.hpp>
 #include <serial/objostr.hpp>
 #include <serial/serial.hpp>
+#include <serial/asnindex.hpp>
 
+#include <objects/seqloc/Seq_id.hpp>
 #include <objects/seqset/Seq_entry.hpp>
 #include <objects/seqset/gb_release_file.hpp>
 #include <objects/seqset/Bioseq_set.hpp>
@@ -121,6 +123,25 @@ void CObjExtractApp::Init(void)
                               "Seq-entry", "Bioseq", "Bioseq-set",
                               "Seq-annot", "Seq-align-set"));
 
+    arg_desc->AddOptionalKey("mkindex", "IndexFile",
+                             "Save the index of the Seq-entries of the "
+                             "Bioseq-set in the ASN.1 binary input "
+                             "by their Seq-ids",
+                             CArgDescriptions::eOutputFile);
+
+    arg_desc->AddOptionalKey("index", "IndexFile",
+                             "Index of the input made with -mkindex, "
+                             "used to extract the Seq-entry of -id",
+                             CArgDescriptions::eInputFile);
+
+    arg_desc->AddOptionalKey("id", "SeqId",
+                             "Seq-id of the Seq-entry to extract "
+                             "using -index",
+                             CArgDescriptions::eString);
+    arg_desc->SetDependency("index", CArgDescriptions::eRequires, "id");
+    arg_desc->SetDependency("id", CArgDescriptions::eRequires, "index");
+    arg_desc->SetDependency("mkindex", CArgDescriptions::eExcludes, "index");
+
     // Setup arg.descriptions for this application
     SetupArgDescriptions(arg_desc.release());
 }
@@ -178,6 +199,29 @@ private:
 };
 
 
+///
+/// keys of the Seq-entries of an index: the Seq-ids of their Bioseqs
+///
+class CSeqIdIndexKeys : public CAsnBinaryIndexer::IKeySource
+{
+public:
+    void GetKeys(const CConstObjectInfo& element,
+                 vector<string>& keys)
+    {
+        const CSeq_entry& entry =
+            *static_cast<const CSeq_entry*>(element.GetObjectPtr());
+        for (CTypeConstIterator<CBioseq> it(ConstBegin(entry));  it;  ++it) {
+            ITERATE (CBioseq::TId, id, it->GetId()) {
+                keys.push_back((*id)->AsFastaString());
+                string acc = (*id)->GetSeqIdString(true);
+                if (acc != keys.back()) {
+                    keys.push_back(acc);
+                }
+            }
+        }
+    }
+};
+
 
 int CObjExtractApp::Run(void)
 {
@@ -238,11 +282,68 @@ int CObjExtractApp::Run(void)
          }
      }}
 
+    if ((args["mkindex"]  ||  args["index"])  &&
+        (ifmt != eSerial_AsnBinary  ||  itype != CBioseq_set::GetTypeInfo())) {
+        ERR_POST(Error << "indexes are made of ASN.1 binary Bioseq-sets only");
+        return 1;
+    }
+    if (args["index"]  &&  args["i"].AsString() == "-") {
+        ERR_POST(Error << "-index needs an input file given with -i: "
+                 "the standard input cannot be searched");
+        return 1;
+    }
+
+    ///
+    /// index the input
+    ///
+    if (args["mkindex"]) {
+        auto_ptr<CObjectIStream> obj_istr(CObjectIStream::Open(ifmt, istr));
+        CSeqIdIndexKeys keys;
+        CAsnBinaryIndexer indexer(itype, "seq-set", &keys);
+        CRef<CAsnBinaryIndex> index = indexer.Index(*obj_istr);
+        index->Write(args["mkindex"].AsOutputFile());
+        LOG_POST(Error
+                 << "indexed " << index->GetElementCount() << " entries");
+        return 0;
+    }
+
+    auto_ptr<CObjectOStream> obj_ostr(CObjectOStream::Open(ofmt, ostr));
+
+    ///
+    /// extract one entry using the index
+    ///
+    if (args["index"]) {
+        CAsnBinaryIndex index;
+        index.Read(args["index"].AsInputFile());
+        // seek in the file itself, opened in binary mode
+        auto_ptr<CObjectIStream> obj_istr
+            (CObjectIStream::Open(args["i"].AsString(), eSerial_AsnBinary));
+        CAsnBinaryIndexedReader reader(*obj_istr, index,
+                                       CSeq_entry::GetTypeInfo());
+        string id_str = args["id"].AsString();
+        size_t element = reader.FindElement(id_str);
+        if (element == NPOS) {
+            try {
+                CSeq_id id(id_str);
+                element = reader.FindElement(id.AsFastaString());
+            }
+            catch (CException&) {
+            }
+        }
+        if (element == NPOS) {
+            ERR_POST(Error << "Seq-id not in the index: " << id_str);
+            return 1;
+        }
+        CSeq_entry entry;
+        reader.ReadElement(element, ObjectInfo(entry));
+        obj_ostr->Write(&entry, entry.GetThisTypeInfo());
+        return 0;
+    }
+
     ///
     /// now, process!
     ///
     auto_ptr<CObjectIStream> obj_istr(CObjectIStream::Open(ifmt, istr));
-    auto_ptr<CObjectOStream> obj_ostr(CObjectOStream::Open(ofmt, ostr));
 
 
     LOG_POST(Error
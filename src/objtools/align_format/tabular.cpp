@@ -61,6 +61,24 @@ BEGIN_SCOPE(align_format)
 
 static const string NA = "N/A";
 
+CRef<CBlastTabularSubjectCache::SSubjectInfo>
+CBlastTabularSubjectCache::Find(const CSeq_id& id) const
+{
+    TSubjects::const_iterator it =
+        m_Subjects.find(CSeq_id_Handle::GetHandle(id));
+    return it == m_Subjects.end() ? CRef<SSubjectInfo>() : it->second;
+}
+
+void CBlastTabularSubjectCache::Add(const CSeq_id& id,
+                                   CRef<SSubjectInfo> info)
+{
+    // subjects are hit in no particular order, so rather than tracking
+    // which ones were used last start over when the cache is full
+    if (m_Subjects.size() >= m_MaxSubjects)
+        m_Subjects.clear();
+    m_Subjects[CSeq_id_Handle::GetHandle(id)] = info;
+}
+
 void 
 CBlastTabularInfo::x_AddDefaultFieldsToShow()
 {
@@ -116,6 +134,7 @@ void CBlastTabularInfo::x_ResetFields()
     m_BTOP = NcbiEmptyString;
     m_SubjectStrand = NcbiEmptyString;
     m_QueryCovSeqalign = -1;
+    m_SubjectInfo.Reset();
 }
 
 void CBlastTabularInfo::x_SetFieldDelimiter(EFieldDelimiter delim)
@@ -200,9 +219,23 @@ void CBlastTabularInfo::x_PrintQueryAccessionVersion()
     m_Ostream << s_GetSeqIdListString(m_QueryId, eAccVersion);
 }
 
+string CBlastTabularInfo::x_GetSubjectIdString(ESeqIdType id_type)
+{
+    if (m_SubjectInfo.Empty())
+        return s_GetSeqIdListString(m_SubjectIds[0], id_type);
+
+    map<int, string>::const_iterator it =
+        m_SubjectInfo->m_IdStrings.find(id_type);
+    if (it != m_SubjectInfo->m_IdStrings.end())
+        return it->second;
+    string id_str = s_GetSeqIdListString(m_SubjectIds[0], id_type);
+    m_SubjectInfo->m_IdStrings[id_type] = id_str;
+    return id_str;
+}
+
 void CBlastTabularInfo::x_PrintSubjectSeqId()
 {
-    m_Ostream << s_GetSeqIdListString(m_SubjectIds[0], eFullId);
+    m_Ostream << x_GetSubjectIdString(eFullId);
 }
 
 void CBlastTabularInfo::x_PrintSubjectAllSeqIds(void)
@@ -216,7 +249,7 @@ void CBlastTabularInfo::x_PrintSubjectAllSeqIds(void)
 
 void CBlastTabularInfo::x_PrintSubjectGi(void)
 {
-    m_Ostream << s_GetSeqIdListString(m_SubjectIds[0], eGi);
+    m_Ostream << x_GetSubjectIdString(eGi);
 }
 
 void CBlastTabularInfo::x_PrintSubjectAllGis(void)
@@ -230,12 +263,12 @@ void CBlastTabularInfo::x_PrintSubjectAllGis(void)
 
 void CBlastTabularInfo::x_PrintSubjectAccession(void)
 {
-    m_Ostream << s_GetSeqIdListString(m_SubjectIds[0], eAccession);
+    m_Ostream << x_GetSubjectIdString(eAccession);
 }
 
 void CBlastTabularInfo::x_PrintSubjectAccessionVersion(void)
 {
-    m_Ostream << s_GetSeqIdListString(m_SubjectIds[0], eAccVersion);
+    m_Ostream << x_GetSubjectIdString(eAccVersion);
 }
 
 void CBlastTabularInfo::x_PrintSubjectAllAccessions(void)
@@ -457,6 +490,7 @@ void CBlastTabularInfo::SetSubjectId(const CBioseq_Handle& bh)
 void CBlastTabularInfo::x_SetSubjectId(const CBioseq_Handle& bh, const CRef<CBlast_def_line_set> & bdlRef)
 {
     m_SubjectIds.clear();
+    m_SubjectInfo.Reset();
 
     // Check if this Bioseq handle contains a Blast-def-line-set object.
     // If it does, retrieve Seq-ids from all redundant sequences, and
@@ -580,6 +614,59 @@ void CBlastTabularInfo::x_SetTaxInfo(const CBioseq_Handle & handle, const CRef<C
 	return;
 
 }
+
+bool CBlastTabularInfo::x_SetSubjectFromCache(const CSeq_id& id,
+                                              bool set_tax_info,
+                                              bool set_title)
+{
+    if (m_SubjectCache.Empty())
+        return false;
+
+    CRef<CBlastTabularSubjectCache::SSubjectInfo> info =
+        m_SubjectCache->Find(id);
+    if (info.Empty() || (set_tax_info && !info->m_HasTaxInfo))
+        return false;
+
+    m_SubjectIds = info->m_Ids;
+    m_SubjectLength = info->m_Length;
+    if (set_tax_info) {
+        m_SubjectTaxIds = info->m_TaxIds;
+        m_SubjectSciNames = info->m_SciNames;
+        m_SubjectCommonNames = info->m_CommonNames;
+        m_SubjectBlastNames = info->m_BlastNames;
+        m_SubjectSuperKingdoms = info->m_SuperKingdoms;
+    }
+    if (set_title)
+        m_SubjectDefline = info->m_Defline;
+    m_SubjectInfo = info;
+    return true;
+}
+
+void CBlastTabularInfo::x_AddSubjectToCache(const CSeq_id& id, bool is_na,
+                                const CRef<CBlast_def_line_set>& bdlRef,
+                                bool set_tax_info)
+{
+    if (m_SubjectCache.Empty())
+        return;
+
+    CRef<CBlastTabularSubjectCache::SSubjectInfo>
+        info(new CBlastTabularSubjectCache::SSubjectInfo);
+    info->m_Ids = m_SubjectIds;
+    info->m_IsNa = is_na;
+    info->m_Length = m_SubjectLength;
+    info->m_Defline = bdlRef;
+    info->m_HasTaxInfo = set_tax_info;
+    if (set_tax_info) {
+        info->m_TaxIds = m_SubjectTaxIds;
+        info->m_SciNames = m_SubjectSciNames;
+        info->m_CommonNames = m_SubjectCommonNames;
+        info->m_BlastNames = m_SubjectBlastNames;
+        info->m_SuperKingdoms = m_SubjectSuperKingdoms;
+    }
+    m_SubjectCache->Add(id, info);
+    m_SubjectInfo = info;
+}
+
 void CBlastTabularInfo::x_SetQueryCovSubject(const CSeq_align & align)
 {
 	int pct = -1;
@@ -682,7 +769,11 @@ int CBlastTabularInfo::SetFields(const CSeq_align& align,
     if(setSubjectIds || setSubjectTaxInfo || setSubjectTitle ||
        x_IsFieldRequested(eSubjectStrand))
     {
-        try {
+        const CSeq_id& subject_id = align.GetSeq_id(1);
+        if (x_SetSubjectFromCache(subject_id, setSubjectTaxInfo,
+                                  setSubjectTitle)) {
+            subject_is_na = m_SubjectInfo->m_IsNa;
+        } else try {
             const CBioseq_Handle& subject_bh = 
                 scope.GetBioseqHandle(align.GetSeq_id(1));
             CRef<CBlast_def_line_set> bdlRef =
@@ -698,6 +789,8 @@ int CBlastTabularInfo::SetFields(const CSeq_align& align,
             	if(bdlRef.NotEmpty())
             		m_SubjectDefline = bdlRef;
             }
+            x_AddSubjectToCache(subject_id, subject_is_na, bdlRef,
+                                setSubjectTaxInfo);
 
         } catch (const CException&) {
             list<CRef<CSeq_id> > subject_ids;
@@ -1146,6 +1239,7 @@ CBlastTabularInfo::SetQueryId(list<CRef<CSeq_id> >& id)
 void 
 CBlastTabularInfo::SetSubjectId(list<CRef<CSeq_id> >& id)
 {
+    m_SubjectInfo.Reset();
     m_SubjectIds.push_back(id);
 }
 
@@ -291,6 +291,53 @@ BOOST_AUTO_TEST_CASE(SubjectTitlesOutput) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(SubjectCacheOutput) {
+
+    const string seqAlignFileName_in = "data/blastn.vs.ecoli.asn";
+    CRef<CSeq_annot> san(new CSeq_annot);
+
+    ifstream in(seqAlignFileName_in.c_str());
+    in >> MSerial_AsnText >> *san;
+    in.close();
+
+    list<CRef<CSeq_align> > seqalign_list = san->GetData().GetAlign();
+
+    const string kDbName("ecoli");
+    const CBlastDbDataLoader::EDbType kDbType(CBlastDbDataLoader::eNucleotide);
+    TestUtil::CBlastOM tmp_data_loader(kDbName, kDbType, CBlastOM::eLocal);
+    CRef<CScope> scope = tmp_data_loader.NewScope();
+
+    const string kFormat("qseqid sseqid sacc sgi slen stitle bitscore");
+    ostrstream expected_stream;
+    {
+        CBlastTabularInfo ctab(expected_stream, kFormat);
+        ITERATE(list<CRef<CSeq_align> >, iter, seqalign_list)
+        {
+           ctab.SetFields(**iter, *scope);
+           ctab.Print();
+        }
+    }
+    string expected = CNcbiOstrstreamToString(expected_stream);
+
+    // format the alignments twice, as for two queries, sharing the cache;
+    // the second time all subjects are found in the cache
+    CRef<CBlastTabularSubjectCache> cache(new CBlastTabularSubjectCache);
+    for (int i = 0; i < 2; i++) {
+        ostrstream output_stream;
+        {
+            CBlastTabularInfo ctab(output_stream, kFormat);
+            ctab.SetSubjectCache(cache);
+            ITERATE(list<CRef<CSeq_align> >, iter, seqalign_list)
+            {
+               ctab.SetFields(**iter, *scope);
+               ctab.Print();
+            }
+        }
+        string output = CNcbiOstrstreamToString(output_stream);
+        BOOST_REQUIRE_EQUAL(expected, output);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
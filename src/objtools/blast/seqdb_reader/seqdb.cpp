@@ -665,6 +665,13 @@ bool CSeqDB::TiToOid(Int8 ti, int & oid) const
     return rv;
 }
 
+void CSeqDB::IdsToOids(CSeqDBGiList & ids) const
+{
+    m_Impl->Verify();
+    m_Impl->IdsToOids(ids);
+    m_Impl->Verify();
+}
+
 bool CSeqDB::GiToOid(int gi, int & oid) const
 {
     m_Impl->Verify();
@@ -921,6 +928,15 @@ CSeqDB::FindVolumePaths(vector<string> & paths, bool recursive) const
     m_Impl->Verify();
 }
 
+void
+CSeqDB::GetVolumeOidStarts(vector<string> & paths,
+                           vector<int>    & oid_starts) const
+{
+    m_Impl->Verify();
+    m_Impl->GetVolumeOidStarts(paths, oid_starts);
+    m_Impl->Verify();
+}
+
 void
 CSeqDB::GetGis(int oid, vector<int> & gis, bool append) const
 {
@@ -987,6 +1003,30 @@ void CSeqDB::SetDefaultMemoryBound(Uint8 bytes)
     CSeqDBImpl::SetDefaultMemoryBound(bytes);
 }
 
+void CSeqDB::SetDefaultMapMode(ESeqDBMapMode mode)
+{
+    CSeqDBImpl::SetDefaultMapMode(mode);
+}
+
+void CSeqDB::PrefetchOidRange(int first_oid, int end_oid) const
+{
+    m_Impl->Verify();
+    m_Impl->PrefetchOidRange(first_oid, end_oid);
+    m_Impl->Verify();
+}
+
+SSeqDBAtlasStats CSeqDB::GetAtlasStats() const
+{
+    m_Impl->Verify();
+    return m_Impl->GetAtlasStats();
+}
+
+bool CSeqDB::IsLockFree() const
+{
+    m_Impl->Verify();
+    return m_Impl->IsLockFree();
+}
+
 void CSeqDB::GetSequenceAsString(int      oid,
                                  string & output,
                                  TSeqRange range /* = TSeqRange() */) const
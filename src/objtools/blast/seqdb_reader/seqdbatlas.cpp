@@ -193,7 +193,8 @@ CSeqDBAtlas::CSeqDBAtlas(bool use_mmap)
       m_OpenRegionsTrigger(CSeqDBMapStrategy::eOpenRegionsWindow),
       m_MaxFileSize       (0),
       m_Strategy          (*this),
-      m_SearchPath        (GenerateSearchPath())
+      m_SearchPath        (GenerateSearchPath()),
+      m_MapMode           (m_DefaultMapMode)
 {
     for(int i = 0; i < eNumRecent; i++) {
         m_Recent[i] = 0;
@@ -424,6 +425,9 @@ void CSeqDBAtlas::x_GarbageCollect(Uint8 reduce_to)
             m_NameOffsetLookup.erase(mr);
             m_AddressLookup.erase(mr->Data());
             
+            m_Stats.unmaps++;
+            m_CollectedFids.insert(mr->Fid());
+            
             delete mr;
             
             if (Uint8(m_CurAlloc) < reduce_to) {
@@ -700,6 +704,9 @@ void CSeqDBAtlas::PossiblyGarbageCollect(Uint8 space_needed, bool returning)
         int maxopen = CSeqDBMapStrategy::eMaxOpenRegions;
         
         m_OpenRegionsTrigger = min(int(m_Regions.size() + window), maxopen);
+    } else if (m_UseMmap && m_MapMode != eSeqDBMapSlices) {
+        // Whole files are mapped once and kept; only a map failure
+        // (see x_GetRegion) reduces the memory in use.
     } else {
         // Use Int8 to avoid "unsigned rollunder"
         
@@ -858,23 +865,17 @@ CSeqDBAtlas::x_GetRegion(const string   & fname,
             newmap->AddRef();
         }
         
-        m_NameOffsetLookup.insert(nregion);
-        
         newmap->GetBoundaries(start, begin, end);
         
         if (retval == 0) {
             s_SeqDB_FileNotFound(fname);
         }
         
-        m_AddressLookup[nregion->Data()] = nregion;
-        
-        m_CurAlloc += (end-begin);
+        x_AddRegion(nregion);
         
         CRegionMap * nmp = newmap.release();
         
         _ASSERT(nmp);
-        
-        m_Regions.push_back(nmp);
     }
     catch(std::bad_alloc) {
         if (m_NameOffsetLookup.find(nregion) != m_NameOffsetLookup.end()) {
@@ -893,6 +894,24 @@ CSeqDBAtlas::x_GetRegion(const string   & fname,
     return retval;
 }
 
+void CSeqDBAtlas::x_AddRegion(CRegionMap * nregion)
+{
+    TIndx size = nregion->End() - nregion->Begin();
+    
+    m_NameOffsetLookup.insert(nregion);
+    m_AddressLookup[nregion->Data()] = nregion;
+    
+    m_CurAlloc += size;
+    
+    m_Stats.maps++;
+    m_Stats.bytes_mapped += size;
+    if (m_CollectedFids.find(nregion->Fid()) != m_CollectedFids.end()) {
+        m_Stats.remaps++;
+    }
+    
+    m_Regions.push_back(nregion);
+}
+
 const char * CSeqDBAtlas::GetRegion(const string   & fname,
                                     TIndx            begin,
                                     TIndx            end,
@@ -1139,6 +1158,48 @@ void CRegionMap::Show()
     }
 }
 
+/// Advise the kernel on the use of part of a mapping.
+///
+/// The range is extended to page boundaries.  Failures are ignored, as
+/// the advice only affects performance.
+///
+/// @param data The start of the range. [in]
+/// @param length The length of the range. [in]
+/// @param advise The advice. [in]
+
+static void s_SeqDB_Advise(const char * data, CRegionMap::TIndx length,
+                           EMemoryAdvise advise)
+{
+    size_t page = GetVirtualMemoryPageSize();
+    size_t skew = page ? ((size_t) data) % page : 0;
+    
+    MemoryAdvise((void*)(data - skew), (size_t) length + skew, advise);
+}
+
+/// Advise the kernel that a whole file mapping will be scanned.
+///
+/// This starts reading the file ahead of use, the equivalent of mapping
+/// it with MAP_POPULATE except that the mapping does not wait for the
+/// reads, and optionally asks for transparent huge pages.
+///
+/// @param data The start of the mapping. [in]
+/// @param length The length of the mapping. [in]
+/// @param huge_pages Ask for transparent huge pages. [in]
+
+static void s_SeqDB_AdviseWholeFile(const char      * data,
+                                    CRegionMap::TIndx length,
+                                    bool              huge_pages)
+{
+    s_SeqDB_Advise(data, length, eMADV_Sequential);
+    s_SeqDB_Advise(data, length, eMADV_WillNeed);
+    
+#if defined(NCBI_OS_LINUX) && defined(MADV_HUGEPAGE)
+    if (huge_pages) {
+        madvise((void*) data, (size_t) length, MADV_HUGEPAGE);
+    }
+#endif
+}
+
 CRegionMap::CRegionMap(const string * fname, int fid, TIndx begin, TIndx end)
     : m_Data     (0),
       m_MemFile  (0),
@@ -1170,6 +1231,60 @@ CRegionMap::~CRegionMap()
     BREAK_MARKER();
 }
 
+void CRegionMap::RoundupMmap(CSeqDBAtlas * atlas, TIndx file_length)
+{
+    CHECK_MARKER();
+    
+    if (atlas->GetMapMode() != eSeqDBMapSlices) {
+        m_Begin = 0;
+        m_End   = file_length;
+    } else if ((m_Begin != 0) || (m_End != file_length)) { 
+        x_Roundup(m_Begin, m_End, m_Penalty, file_length, true, atlas); 
+        atlas->PossiblyGarbageCollect(m_End - m_Begin, false);
+    }
+}
+
+void CRegionMap::x_MapRange(ESeqDBMapMode mode)
+{
+    m_MemFile = new CMemoryFileMap(*m_Fname, 
+                                   CMemoryFileMap::eMMP_Read, 
+                                   CMemoryFileMap::eMMS_Private);
+    
+    // new() should have thrown, but some old implementations are
+    // said to be non-compliant in this regard:
+    
+    if (! m_MemFile) {
+        throw std::bad_alloc();
+    }
+    
+    m_Data = (const char*) m_MemFile->Map(m_Begin, m_End - m_Begin);
+    
+    if (m_Data && mode != eSeqDBMapSlices) {
+        s_SeqDB_AdviseWholeFile(m_Data, m_End - m_Begin,
+                                mode == eSeqDBMapWholeFilesHugePages);
+    }
+}
+
+bool CRegionMap::MapMmapRange(ESeqDBMapMode mode)
+{
+    CHECK_MARKER();
+    
+    try {
+        x_MapRange(mode);
+    }
+    catch(...) {
+        m_Data = 0;
+    }
+    
+    if (! m_Data) {
+        delete m_MemFile;
+        m_MemFile = 0;
+        return false;
+    }
+    
+    return true;
+}
+
 bool CRegionMap::MapMmap(CSeqDBAtlas * atlas)
 {
     CHECK_MARKER();
@@ -1182,23 +1297,8 @@ bool CRegionMap::MapMmap(CSeqDBAtlas * atlas)
         string expt;
         
         try {
-            m_MemFile = new CMemoryFileMap(*m_Fname, 
-                                           CMemoryFileMap::eMMP_Read, 
-                                           CMemoryFileMap::eMMS_Private);
-            
-            // new() should have thrown, but some old implementations are
-            // said to be non-compliant in this regard:
-            
-            if (! m_MemFile) {
-                throw std::bad_alloc();
-            }
-            
-            if ((m_Begin != 0) || (m_End != flength)) { 
-                x_Roundup(m_Begin, m_End, m_Penalty, flength, true, atlas); 
-                atlas->PossiblyGarbageCollect(m_End - m_Begin, false);
-            }
-            
-            m_Data = (const char*) m_MemFile->Map(m_Begin, m_End - m_Begin);
+            RoundupMmap(atlas, flength);
+            x_MapRange(atlas->GetMapMode());
         }
         catch(std::bad_alloc) {
             expt = "\nstd::bad_alloc.";
@@ -1604,6 +1704,125 @@ void CSeqDBAtlas::SetDefaultMemoryBound(Uint8 bytes)
     CSeqDBMapStrategy::SetDefaultMemoryBound(bytes);
 }
 
+ESeqDBMapMode CSeqDBAtlas::m_DefaultMapMode = eSeqDBMapSlices;
+
+void CSeqDBAtlas::SetDefaultMapMode(ESeqDBMapMode mode)
+{
+    m_DefaultMapMode = mode;
+}
+
+void CSeqDBAtlas::Prefetch(const string   & fname,
+                           TIndx            begin,
+                           TIndx            end,
+                           CSeqDBLockHold & locked)
+{
+    if ((! m_UseMmap) || begin >= end) {
+        return;
+    }
+    
+    Lock(locked);
+    
+    TIndx length(0);
+    
+    if ((! GetFileSizeL(fname, length)) || end > length) {
+        return;
+    }
+    
+    if (m_MapMode == eSeqDBMapSlices) {
+        // Do not force out the slices in use to map the whole range.
+        end = min(end, begin + TIndx(GetSliceSize()));
+    }
+    
+    m_Stats.prefetches++;
+    m_Stats.bytes_prefetched += (end-begin);
+    
+    const string * strp = 0;
+    const char   * start = 0;
+    
+    int fid = x_LookupFile(fname, & strp);
+    
+    TIndx map_begin = begin;
+    TIndx map_end   = end;
+    
+    const char * data = x_FindRegion(fid, map_begin, map_end, & start, 0);
+    
+    if (data) {
+        s_SeqDB_Advise(data, end - begin, eMADV_WillNeed);
+        RetRegion(data);
+        return;
+    }
+    
+    // The range is chosen with the lock held, but mapped without it so
+    // that other threads can use the atlas meanwhile; the lock is only
+    // taken again to add the new region.  This is only a hint, so
+    // errors are ignored; the read will report them.
+    
+    auto_ptr<CRegionMap> region(new CRegionMap(strp, fid, begin, end));
+    region->RoundupMmap(this, length);
+    
+    ESeqDBMapMode mode = m_MapMode;
+    
+    Unlock(locked);
+    
+    bool mapped = region->MapMmapRange(mode);
+    
+    if (mapped) {
+        s_SeqDB_Advise(region->Data(begin, end), end - begin, eMADV_WillNeed);
+    }
+    
+    Lock(locked);
+    
+    if (! mapped) {
+        return;
+    }
+    
+    // Another thread may have mapped the range meanwhile.
+    
+    map_begin = begin;
+    map_end   = end;
+    
+    data = x_FindRegion(fid, map_begin, map_end, & start, 0);
+    
+    if (data) {
+        RetRegion(data);
+        
+        Unlock(locked);
+        region.reset();
+        Lock(locked);
+        return;
+    }
+    
+    x_AddRegion(region.release());
+    
+    PossiblyGarbageCollect(0, true);
+}
+
+const char * CSeqDBAtlas::PinFile(const string   & fname,
+                                  TIndx          & length,
+                                  CSeqDBLockHold & locked)
+{
+    length = 0;
+    
+    if ((! m_UseMmap) || m_MapMode == eSeqDBMapSlices) {
+        return 0;
+    }
+    
+    Lock(locked);
+    
+    if ((! GetFileSizeL(fname, length)) || length == 0) {
+        return 0;
+    }
+    
+    TIndx begin = 0;
+    TIndx end   = length;
+    
+    // In the whole-file modes the region found or created here covers
+    // the file, so the data pointer is the start of the file.  The
+    // reference taken by x_GetRegion() is the pin.
+    
+    return x_GetRegion(fname, begin, end, 0, 0);
+}
+
 void CSeqDBMapStrategy::SetDefaultMemoryBound(Uint8 bytes)
 {
     Uint8 app_space = CSeqDBMapStrategy::e_AppSpace;
@@ -37,11 +37,20 @@ static char const rcsid[] = "$Id: seqdbgilistset.cpp 255926 2011-03-01 13:20:37Z
 
 #include <ncbi_pch.hpp>
 #include "seqdbgilistset.hpp"
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbi_system.hpp>
 #include <algorithm>
 
 BEGIN_NCBI_SCOPE
 
 
+/// Smallest user ID list translated with one thread per volume.
+///
+/// Shorter lists are translated faster than the threads can be
+/// started.
+static const int kSeqDBMinBatchIds = 10000;
+
+
 /// Defines a pair of integers and a sort order.
 ///
 /// This struct stores a pair of integers, the volume index and the
@@ -181,15 +190,15 @@ CSeqDBGiListSet::CSeqDBGiListSet(CSeqDBAtlas            & atlas,
         
         std::sort(OidsPerVolume.begin(), OidsPerVolume.end());
         
+        vector<int> vol_order;
+        
         for(int i = 0; i < (int)OidsPerVolume.size(); i++) {
-            int vol_idx = OidsPerVolume[i].m_Index;
-            
-            const CSeqDBVolEntry * vol = volset.GetVolEntry(vol_idx);
-            
-            // Note: The implied ISAM lookups will sort by GI/TI.
-            
-            vol->Vol()->IdsToOids(*m_UserList, locked);
+            vol_order.push_back(OidsPerVolume[i].m_Index);
         }
+        
+        // Note: The implied ISAM lookups will sort by GI/TI.
+        
+        TranslateIds(m_Atlas, volset, vol_order, *m_UserList, locked);
     } else if (m_NegativeList.NotEmpty() && m_NegativeList->NotEmpty()) {
         // We don't bother to sort these since every ISAM mapping must
         // be examined for the negative ID list case.
@@ -204,6 +213,172 @@ CSeqDBGiListSet::CSeqDBGiListSet(CSeqDBAtlas            & atlas,
     }
 }
 
+/// Thread finding the translations of an ID list in one volume.
+
+class CSeqDBIdBatchThread : public CThread {
+public:
+    /// Constructor.
+    /// @param vol The volume to search. [in]
+    /// @param ids The sorted ID list. [in]
+    CSeqDBIdBatchThread(const CSeqDBVol & vol, CSeqDBGiList & ids)
+        : m_Vol(vol), m_Ids(ids)
+    {
+    }
+    
+    /// Get the translations found.
+    const CSeqDBVol::SIdBatchResult & GetResult() const
+    {
+        return m_Result;
+    }
+    
+    /// Get the message of the exception thrown by the search, if any.
+    const string & GetError() const
+    {
+        return m_Error;
+    }
+    
+protected:
+    /// Search the volume.
+    virtual void * Main()
+    {
+        try {
+            m_Vol.BatchIdsToOids(m_Ids, m_Result);
+        }
+        catch(CException & e) {
+            m_Error = e.GetMsg();
+        }
+        return NULL;
+    }
+    
+private:
+    /// The volume to search.
+    const CSeqDBVol & m_Vol;
+    
+    /// The sorted ID list.
+    CSeqDBGiList & m_Ids;
+    
+    /// The translations found.
+    CSeqDBVol::SIdBatchResult m_Result;
+    
+    /// Message of the exception thrown by the search.
+    string m_Error;
+};
+
+
+/// Apply the translations found in one volume.
+///
+/// IDs already translated, by the user or by an earlier volume, are
+/// not changed.
+///
+/// @param ids The ID list. [in|out]
+/// @param found The translations found. [in]
+template <class T> static void
+s_ApplyBatchResult(CSeqDBGiList                   & ids,
+                   const CSeqDBIsam::TBatchResult & found)
+{
+    ITERATE(CSeqDBIsam::TBatchResult, iter, found) {
+        if (! ids.IsValueSet<T>(iter->first)) {
+            ids.SetValue<T>(iter->first, iter->second);
+        }
+    }
+}
+
+
+void CSeqDBGiListSet::TranslateIds(CSeqDBAtlas        & atlas,
+                                   const CSeqDBVolSet & volset,
+                                   const vector<int>  & vol_order,
+                                   CSeqDBGiList       & ids,
+                                   CSeqDBLockHold     & locked)
+{
+    typedef CRef<CSeqDBIdBatchThread> TThreadRef;
+    
+    int num_ids = ids.GetNumGis() + ids.GetNumTis() + ids.GetNumSis();
+    
+#if defined(NCBI_THREADS)
+    bool batch = (vol_order.size() > 1 && num_ids >= kSeqDBMinBatchIds);
+#else
+    bool batch = false;
+#endif
+    
+    if (! batch) {
+        ITERATE(vector<int>, vol_idx, vol_order) {
+            volset.GetVol(*vol_idx)->IdsToOids(ids, locked);
+        }
+        return;
+    }
+    
+    // The threads only read the list, so it must be sorted first.
+    
+    ids.InsureOrder(CSeqDBGiList::eGi);
+    
+    int batch_size = max(1, (int) GetCpuCount());
+    
+    for(int first = 0; first < (int) vol_order.size(); first += batch_size) {
+        int last = min(first + batch_size, (int) vol_order.size());
+        
+        vector<TThreadRef> threads(last - first);
+        
+        try {
+            atlas.Lock(locked);
+            
+            for(int i = first; i < last; i++) {
+                const CSeqDBVol * vol = volset.GetVol(vol_order[i]);
+                
+                if (vol->BeginIdsToOidsBatch(ids, locked)) {
+                    threads[i - first].Reset(new CSeqDBIdBatchThread(*vol,
+                                                                     ids));
+                }
+            }
+            
+            atlas.Unlock(locked);
+            
+            NON_CONST_ITERATE(vector<TThreadRef>, thr, threads) {
+                if (thr->NotEmpty()) {
+                    (*thr)->Run();
+                }
+            }
+            NON_CONST_ITERATE(vector<TThreadRef>, thr, threads) {
+                if (thr->NotEmpty()) {
+                    (*thr)->Join();
+                }
+            }
+        }
+        catch(...) {
+            for(int i = first; i < last; i++) {
+                volset.GetVol(vol_order[i])->EndIdsToOidsBatch(locked);
+            }
+            throw;
+        }
+        
+        // Apply the translations in volume order; volumes that could
+        // not be searched in batch mode are translated in place.
+        
+        for(int i = first; i < last; i++) {
+            volset.GetVol(vol_order[i])->EndIdsToOidsBatch(locked);
+        }
+        
+        for(int i = first; i < last; i++) {
+            const CSeqDBVol * vol = volset.GetVol(vol_order[i]);
+            TThreadRef thr = threads[i - first];
+            
+            if (thr.Empty()) {
+                vol->IdsToOids(ids, locked);
+                continue;
+            }
+            
+            if (! thr->GetError().empty()) {
+                NCBI_THROW(CSeqDBException, eArgErr, thr->GetError());
+            }
+            
+            const CSeqDBVol::SIdBatchResult & result = thr->GetResult();
+            
+            s_ApplyBatchResult<int>   (ids, result.gis);
+            s_ApplyBatchResult<Int8>  (ids, result.tis);
+            s_ApplyBatchResult<string>(ids, result.sis);
+        }
+    }
+}
+
 CRef<CSeqDBGiList>
 CSeqDBGiListSet::GetNodeIdList(const CSeqDB_Path & filename,
                                const CSeqDBVol   * volp,
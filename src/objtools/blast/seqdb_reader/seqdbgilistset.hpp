@@ -122,6 +122,27 @@ public:
                            EGiListType         list_type,
                            CSeqDBLockHold    & locked);
     
+    /// Translate the IDs of a list to OIDs.
+    ///
+    /// The volumes are searched in the specified order, and an ID
+    /// found in several volumes gets the OID of the first of them.
+    /// Long lists are searched with one thread per volume: the ISAM
+    /// lookups of up to one volume per CPU run in parallel without
+    /// the atlas lock, then the translations found are applied in
+    /// volume order, so the result is the same as with a sequential
+    /// search.  IDs that are already translated are not changed.
+    ///
+    /// @param atlas The memory management layer object.
+    /// @param volset The set of database volumes.
+    /// @param vol_order Indices of the volumes, in search order.
+    /// @param ids The list of GIs, TIs and Seq-ids. [in|out]
+    /// @param locked The lock holder object for this thread.
+    static void TranslateIds(CSeqDBAtlas        & atlas,
+                             const CSeqDBVolSet & volset,
+                             const vector<int>  & vol_order,
+                             CSeqDBGiList       & ids,
+                             CSeqDBLockHold     & locked);
+    
 private:
     /// Translate a volume gilist from the user gilist.
     ///
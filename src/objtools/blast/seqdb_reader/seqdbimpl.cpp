@@ -81,7 +81,8 @@ CSeqDBImpl::CSeqDBImpl(const string       & db_name_list,
       m_NeedTotalsScan  (false),
       m_UseGiMask       (m_Aliases.HasGiMask()),
       m_MaskDataColumn  (kUnknownTitle),
-      m_NumThreads      (0)
+      m_NumThreads      (0),
+      m_LockFree        (false)
 {
     INIT_CLASS_MARK();
     
@@ -163,6 +164,11 @@ CSeqDBImpl::CSeqDBImpl(const string       & db_name_list,
     
     SetIterationRange(oid_begin, oid_end);
     
+    if (m_Atlas.GetMapMode() != eSeqDBMapSlices) {
+        CSeqDBLockHold locked(m_Atlas);
+        x_PinVolumes(locked);
+    }
+    
     CHECK_MARKER();
 }
 
@@ -182,7 +188,8 @@ CSeqDBImpl::CSeqDBImpl()
       m_NeedTotalsScan  (false),
       m_UseGiMask       (false),
       m_MaskDataColumn  (kUnknownTitle),
-      m_NumThreads      (0)
+      m_NumThreads      (0),
+      m_LockFree        (false)
 {
     INIT_CLASS_MARK();
     
@@ -235,6 +242,8 @@ CSeqDBImpl::~CSeqDBImpl()
     
     m_FlushCB.SetImpl(0);
     
+    x_UnpinVolumes(locked);
+    
     m_TaxInfo.Reset();
     
     m_VolSet.UnLease();
@@ -406,6 +415,18 @@ void CSeqDBImpl::ResetInternalChunkBookmark()
 int CSeqDBImpl::GetSeqLength(int oid) const
 {
     CHECK_MARKER();
+    
+    if (m_LockFree) {
+        int vol_oid = 0;
+        const char * buffer = 0;
+        
+        if (const CSeqDBVol * vol = x_FindPinnedVol(oid, vol_oid)) {
+            return vol->GetPinnedSequence(vol_oid, & buffer);
+        }
+        
+        NCBI_THROW(CSeqDBException, eArgErr, CSeqDB::kOidNotFound);
+    }
+    
     CSeqDBLockHold locked(m_Atlas);
     m_Atlas.MentionOid(oid, m_NumOIDs, locked);
     
@@ -543,6 +564,13 @@ CSeqDBImpl::GetBioseq(int oid, int target_gi, const CSeq_id * target_seq_id, boo
 void CSeqDBImpl::RetSequence(const char ** buffer) const
 {
     CHECK_MARKER();
+    
+    // Pinned data was handed out without a reference.
+    
+    if (x_IsPinned(*buffer)) {
+        *buffer = 0;
+        return;
+    }
 
     CSeqDBLockHold locked(m_Atlas);
 
@@ -650,6 +678,19 @@ void CSeqDBImpl::x_FillSeqBuffer(SSeqResBuffer  *buffer,
 int CSeqDBImpl::GetSequence(int oid, const char ** buffer) const
 {
     CHECK_MARKER();
+    
+    // Pinned volumes are read without the atlas lock; this also makes
+    // the per-thread sequence caches unnecessary.
+    
+    if (m_LockFree) {
+        int vol_oid = 0;
+        
+        if (const CSeqDBVol * vol = x_FindPinnedVol(oid, vol_oid)) {
+            return vol->GetPinnedSequence(vol_oid, buffer);
+        }
+        
+        NCBI_THROW(CSeqDBException, eArgErr, CSeqDB::kOidNotFound);
+    }
 
     CSeqDBLockHold locked(m_Atlas);
 
@@ -1100,6 +1141,23 @@ bool CSeqDBImpl::GiToOid(int gi, int & oid) const
     return false;
 }
 
+void CSeqDBImpl::IdsToOids(CSeqDBGiList & ids) const
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    
+    // Volumes are searched in order, so each GI gets the OID that
+    // GiToOid() would return; as there, the OID mask is not applied.
+    
+    vector<int> vol_order;
+    
+    for(int i = 0; i < m_VolSet.GetNumVols(); i++) {
+        vol_order.push_back(i);
+    }
+    
+    CSeqDBGiListSet::TranslateIds(m_Atlas, m_VolSet, vol_order, ids, locked);
+}
+
 bool CSeqDBImpl::OidToGi(int oid, int & gi)
 {
     CHECK_MARKER();
@@ -1295,6 +1353,20 @@ CSeqDBImpl::FindVolumePaths(vector<string> & paths, bool recursive) const
     m_Aliases.FindVolumePaths(paths, NULL, recursive);
 }
 
+void
+CSeqDBImpl::GetVolumeOidStarts(vector<string> & paths,
+                               vector<int>    & oid_starts) const
+{
+    CHECK_MARKER();
+    paths.clear();
+    oid_starts.clear();
+    
+    for(int i = 0; i < m_VolSet.GetNumVols(); i++) {
+        paths.push_back(m_VolSet.GetVol(i)->GetVolName());
+        oid_starts.push_back(m_VolSet.GetVolOIDStart(i));
+    }
+}
+
 void CSeqDBImpl::GetAliasFileValues(TAliasFileValues & afv)
 {
     CHECK_MARKER();
@@ -1627,6 +1699,144 @@ void CSeqDBImpl::SetDefaultMemoryBound(Uint8 bytes)
     CSeqDBAtlas::SetDefaultMemoryBound(bytes);
 }
 
+void CSeqDBImpl::SetDefaultMapMode(ESeqDBMapMode mode)
+{
+    CSeqDBAtlas::SetDefaultMapMode(mode);
+}
+
+void CSeqDBImpl::PrefetchOidRange(int first_oid, int end_oid)
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    
+    for(int i = 0; i < m_VolSet.GetNumVols(); i++) {
+        const CSeqDBVol * vol = m_VolSet.GetVol(i);
+        
+        int vol_start = m_VolSet.GetVolOIDStart(i);
+        int vol_end   = vol_start + vol->GetNumOIDs();
+        
+        int first = max(first_oid, vol_start);
+        int end   = min(end_oid, vol_end);
+        
+        if (first < end) {
+            vol->PrefetchOidRange(first - vol_start, end - vol_start, locked);
+        }
+    }
+}
+
+SSeqDBAtlasStats CSeqDBImpl::GetAtlasStats()
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    return m_Atlas.GetStats(locked);
+}
+
+void CSeqDBImpl::x_PinVolumes(CSeqDBLockHold & locked)
+{
+    m_Atlas.Lock(locked);
+    
+    bool pinned = true;
+    
+    try {
+        for(int i = 0; pinned && i < m_VolSet.GetNumVols(); i++) {
+            pinned = m_VolSet.GetVol(i)->PinSequenceData(locked);
+        }
+    }
+    catch(CSeqDBException &) {
+        pinned = false;
+    }
+    
+    if (! pinned) {
+        // The locked path handles the missing or unmappable files.
+        x_UnpinVolumes(locked);
+        return;
+    }
+    
+    for(int i = 0; i < m_VolSet.GetNumVols(); i++) {
+        const CSeqDBVol * vol = m_VolSet.GetVol(i);
+        
+        m_PinnedVolStarts.push_back(m_VolSet.GetVolOIDStart(i));
+        m_PinnedVols.push_back(vol);
+        
+        const char * begin(0), * end(0);
+        vol->GetPinnedRange(begin, end);
+        
+        if (begin) {
+            m_PinnedRanges.push_back(make_pair(begin, end));
+        }
+    }
+    
+    sort(m_PinnedRanges.begin(), m_PinnedRanges.end());
+    
+    m_LockFree = true;
+}
+
+void CSeqDBImpl::x_UnpinVolumes(CSeqDBLockHold & locked)
+{
+    m_Atlas.Lock(locked);
+    
+    m_LockFree = false;
+    m_PinnedVolStarts.clear();
+    m_PinnedVols.clear();
+    m_PinnedRanges.clear();
+    
+    for(int i = 0; i < m_VolSet.GetNumVols(); i++) {
+        m_VolSet.GetVol(i)->UnpinSequenceData(locked);
+    }
+}
+
+const CSeqDBVol * CSeqDBImpl::x_FindPinnedVol(int oid, int & vol_oid) const
+{
+    // Empty volumes share their first OID with the next volume, so
+    // take the last volume starting at or before the OID.
+    
+    vector<int>::const_iterator iter =
+        upper_bound(m_PinnedVolStarts.begin(), m_PinnedVolStarts.end(), oid);
+    
+    if (iter == m_PinnedVolStarts.begin()) {
+        return 0;
+    }
+    
+    int index = int(iter - m_PinnedVolStarts.begin()) - 1;
+    
+    const CSeqDBVol * vol = m_PinnedVols[index];
+    vol_oid = oid - m_PinnedVolStarts[index];
+    
+    return (vol_oid < vol->GetNumOIDs()) ? vol : 0;
+}
+
+/// Compare an address to the start of a pinned range.
+/// @param data The address. [in]
+/// @param range The pinned range. [in]
+/// @return True if the address is before the range.
+static bool
+s_SeqDBBeforePinnedRange(const char                            * data,
+                         const pair<const char *, const char *> & range)
+{
+    return data < range.first;
+}
+
+bool CSeqDBImpl::x_IsPinned(const char * data) const
+{
+    if (m_PinnedRanges.empty() || ! data) {
+        return false;
+    }
+    
+    vector< pair<const char *, const char *> >::const_iterator iter =
+        upper_bound(m_PinnedRanges.begin(),
+                    m_PinnedRanges.end(),
+                    data,
+                    s_SeqDBBeforePinnedRange);
+    
+    if (iter == m_PinnedRanges.begin()) {
+        return false;
+    }
+    
+    --iter;
+    
+    return data < iter->second;
+}
+
 unsigned CSeqDBImpl::GetSequenceHash(int oid)
 {
     char * datap(0);
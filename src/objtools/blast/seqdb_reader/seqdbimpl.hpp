@@ -620,6 +620,9 @@ public:
     /// Translate a GI to an OID.
     bool GiToOid(int gi, int & oid) const;
     
+    /// Translate the GIs, TIs and Seq-ids of a list to OIDs.
+    void IdsToOids(CSeqDBGiList & ids) const;
+    
     /// Translate a GI to an OID.
     bool OidToGi(int oid, int & gi);
     
@@ -673,6 +676,15 @@ public:
     ///   If true the search will traverse the full alias node tree
     void FindVolumePaths(vector<string> & paths, bool recursive) const;
     
+    /// Get the volumes in OID order
+    ///
+    /// @param paths
+    ///   The returned volume base names
+    /// @param oid_starts
+    ///   The returned first OID of each volume
+    void GetVolumeOidStarts(vector<string> & paths,
+                            vector<int>    & oid_starts) const;
+    
     /// Set Iteration Range
     ///
     /// This method sets the iteration range as a pair of OIDs.
@@ -889,6 +901,33 @@ public:
     /// will be selected based on system information.
     static void SetDefaultMemoryBound(Uint8 bytes);
     
+    /// Set the global default mapping mode for SeqDB.
+    ///
+    /// This only affects the memory management layer if it is
+    /// constructed after this call, i.e. while no SeqDB object exists.
+    static void SetDefaultMapMode(ESeqDBMapMode mode);
+    
+    /// Start reading the data of a range of OIDs.
+    ///
+    /// The sequence and header data of the OIDs is mapped ahead of use,
+    /// and the kernel is asked to read it in.
+    ///
+    /// @param first_oid The first OID of the range. [in]
+    /// @param end_oid The OID after the range. [in]
+    void PrefetchOidRange(int first_oid, int end_oid);
+    
+    /// Get the mapping counters of the memory management layer.
+    SSeqDBAtlasStats GetAtlasStats();
+    
+    /// Check whether sequences are retrieved without locking.
+    ///
+    /// This is true if the database files are mapped whole and all
+    /// volumes could be pinned when the database was opened.
+    bool IsLockFree() const
+    {
+        return m_LockFree;
+    }
+    
     /// Get the sequence hash for a given OID.
     ///
     /// The sequence data is fetched and the sequence hash is
@@ -1401,7 +1440,51 @@ private:
 
     /// Return sequence to buffer
     void x_RetSeqBuffer(SSeqResBuffer * buffer, CSeqDBLockHold & locked) const;
-
+    
+    /// Pin the sequence data of all volumes.
+    ///
+    /// In the whole-file mapping modes, the index and sequence files
+    /// of each volume are pinned, and the tables used to find volumes
+    /// and pinned data without the atlas lock are built.  If any
+    /// volume can not be pinned, nothing stays pinned.  This is only
+    /// called from the constructor, so the tables never change while
+    /// other threads read them.
+    ///
+    /// @param locked The lock holder object for this thread. [in]
+    void x_PinVolumes(CSeqDBLockHold & locked);
+    
+    /// Release the data pinned by x_PinVolumes().
+    ///
+    /// @param locked The lock holder object for this thread. [in]
+    void x_UnpinVolumes(CSeqDBLockHold & locked);
+    
+    /// Find a pinned volume by OID, without locking.
+    ///
+    /// @param oid The global OID to search for. [in]
+    /// @param vol_oid The returned OID within the volume. [out]
+    /// @return The volume containing the OID, or NULL.
+    const CSeqDBVol * x_FindPinnedVol(int oid, int & vol_oid) const;
+    
+    /// Check whether data lies in a pinned sequence file.
+    ///
+    /// Such data was returned without a region reference, so it must
+    /// not be returned to the atlas.
+    ///
+    /// @param data The data to check. [in]
+    /// @return True if the data is pinned.
+    bool x_IsPinned(const char * data) const;
+    
+    /// True if sequences are retrieved without locking.
+    bool m_LockFree;
+    
+    /// First OID of each pinned volume, in increasing order.
+    vector<int> m_PinnedVolStarts;
+    
+    /// Pinned volumes, in the order of m_PinnedVolStarts.
+    vector<const CSeqDBVol *> m_PinnedVols;
+    
+    /// Address ranges of the pinned sequence files, sorted by start.
+    vector< pair<const char *, const char *> > m_PinnedRanges;
 };
 
 END_NCBI_SCOPE
@@ -1079,6 +1079,8 @@ CSeqDBIsam::CSeqDBIsam(CSeqDBAtlas  & atlas,
       m_IdentType      (ident_type),
       m_IndexLease     (atlas),
       m_DataLease      (atlas),
+      m_BatchIndexLease(atlas),
+      m_BatchDataLease (atlas),
       m_Type           (eNumeric),
       m_NumTerms       (0),
       m_NumSamples     (0),
@@ -1176,6 +1178,13 @@ bool CSeqDBIsam::IndexExists(const string & dbname,
 CSeqDBIsam::~CSeqDBIsam()
 {
     UnLease();
+    
+    if (! m_BatchIndexLease.Empty()) {
+        m_Atlas.RetRegion(m_BatchIndexLease);
+    }
+    if (! m_BatchDataLease.Empty()) {
+        m_Atlas.RetRegion(m_BatchDataLease);
+    }
 }
 
 void CSeqDBIsam::UnLease()
@@ -1387,6 +1396,80 @@ void CSeqDBIsam::IdsToOids(int              vol_start,
     }
 }
 
+bool CSeqDBIsam::BeginBatch(CSeqDBLockHold & locked)
+{
+    m_Atlas.Lock(locked);
+    
+    if(m_Initialized == false) {
+        EErrorCode error = x_InitSearch(locked);
+        
+        if(error != eNoError) {
+            NCBI_THROW(CSeqDBException,
+                       eArgErr,
+                       "Error: Unable to use ISAM index in batch mode.");
+        }
+    }
+    
+    // Memory-only indices have no data file to hold.
+    
+    if (m_PageSize == MEMORY_ONLY_PAGE_SIZE || m_DataFileLength == 0) {
+        return false;
+    }
+    
+    if (m_BatchIndexLease.Empty()) {
+        m_Atlas.GetRegion(m_BatchIndexLease,
+                          m_IndexFname,
+                          0,
+                          m_IndexFileLength);
+    }
+    if (m_BatchDataLease.Empty()) {
+        m_Atlas.GetRegion(m_BatchDataLease,
+                          m_DataFname,
+                          0,
+                          m_DataFileLength);
+    }
+    
+    return true;
+}
+
+void CSeqDBIsam::BatchIdsToOids(int              vol_start,
+                                CSeqDBGiList   & ids,
+                                TBatchResult   & found)
+{
+    _ASSERT(! m_BatchIndexLease.Empty() && ! m_BatchDataLease.Empty());
+    
+    switch (m_IdentType) {
+    case eGiId:
+        x_BatchTranslateGiList<int>(vol_start, ids, found);
+        break;
+
+    case eTiId:
+        x_BatchTranslateGiList<Int8>(vol_start, ids, found);
+        break;
+
+    case eStringId:
+        x_BatchTranslateGiList<string>(vol_start, ids, found);
+        break;
+
+    default: 
+        NCBI_THROW(CSeqDBException,
+                       eArgErr,
+                       "Error: Wrong type of idlist specified.");
+    }
+}
+
+void CSeqDBIsam::EndBatch(CSeqDBLockHold & locked)
+{
+    m_Atlas.Lock(locked);
+    
+    if (! m_BatchIndexLease.Empty()) {
+        m_Atlas.RetRegion(m_BatchIndexLease);
+    }
+    if (! m_BatchDataLease.Empty()) {
+        m_Atlas.RetRegion(m_BatchDataLease);
+    }
+}
+
 void CSeqDBIsam::IdsToOids(int                  vol_start,
                            int                  vol_end,
                            CSeqDBNegativeList & ids,
@@ -98,7 +98,12 @@ CSeqDBVol::CSeqDBVol(CSeqDBAtlas        & atlas,
       m_StrFileOpened(false),
       m_TiFileOpened (false),
       m_HashFileOpened(false),
-      m_OidFileOpened(false)
+      m_OidFileOpened(false),
+      m_PinnedIdx    (0),
+      m_PinnedSeq    (0),
+      m_PinnedSeqLength(0),
+      m_PinnedSeqOffsets(0),
+      m_PinnedAmbOffsets(0)
 {
     if (user_list) {
         m_UserGiList.Reset(user_list);
@@ -1662,6 +1667,13 @@ int CSeqDBVol::x_GetSequence(int              oid,
     if (!m_SeqFileOpened) x_OpenSeqFile(locked);
     
     if (oid >= m_Idx->GetNumOIDs()) return -1;
+    
+    // Pinned data needs no region reference, whether or not the
+    // caller keeps the sequence.
+    
+    if (m_PinnedSeq) {
+        return GetPinnedSequence(oid, buffer);
+    }
 
     m_Idx->GetSeqStartEnd(oid, start_offset, end_offset);
 
@@ -2163,6 +2175,79 @@ void CSeqDBVol::IdsToOids(CSeqDBGiList   & ids,
     }
 }
 
+bool CSeqDBVol::BeginIdsToOidsBatch(CSeqDBGiList   & ids,
+                                    CSeqDBLockHold & locked) const
+{
+    bool batch = true;
+    
+    if (ids.GetNumGis()) {
+        if (!m_GiFileOpened) x_OpenGiFile(locked);
+        if (m_IsamGi.NotEmpty()) {
+            batch = m_IsamGi->BeginBatch(locked) && batch;
+        } else {
+            NCBI_THROW(CSeqDBException,
+                       eArgErr,
+                       "GI list specified but no ISAM file found for GI.");
+        }
+    }
+    
+    if (ids.GetNumTis()) {
+        if (!m_TiFileOpened) x_OpenTiFile(locked);
+        if (m_IsamTi.NotEmpty()) {
+            batch = m_IsamTi->BeginBatch(locked) && batch;
+        } else {
+            NCBI_THROW(CSeqDBException,
+                       eArgErr,
+                       "TI list specified but no ISAM file found for TI.");
+        }
+    }
+    
+    if (ids.GetNumSis()) {
+        if (!m_StrFileOpened) x_OpenStrFile(locked);
+        if (m_IsamStr.NotEmpty()) {
+            batch = m_IsamStr->BeginBatch(locked) && batch;
+        } else {
+            NCBI_THROW(CSeqDBException,
+                       eArgErr,
+                       "SI list specified but no ISAM file found for SI.");
+        }
+    }
+    
+    return batch;
+}
+
+void CSeqDBVol::BatchIdsToOids(CSeqDBGiList   & ids,
+                               SIdBatchResult & result) const
+{
+    // BeginIdsToOidsBatch() has opened the ISAM files and thrown if
+    // any of them was missing.
+    
+    if (ids.GetNumGis()) {
+        m_IsamGi->BatchIdsToOids(m_VolStart, ids, result.gis);
+    }
+    
+    if (ids.GetNumTis()) {
+        m_IsamTi->BatchIdsToOids(m_VolStart, ids, result.tis);
+    }
+    
+    if (ids.GetNumSis()) {
+        m_IsamStr->BatchIdsToOids(m_VolStart, ids, result.sis);
+    }
+}
+
+void CSeqDBVol::EndIdsToOidsBatch(CSeqDBLockHold & locked) const
+{
+    if (m_IsamGi.NotEmpty()) {
+        m_IsamGi->EndBatch(locked);
+    }
+    if (m_IsamTi.NotEmpty()) {
+        m_IsamTi->EndBatch(locked);
+    }
+    if (m_IsamStr.NotEmpty()) {
+        m_IsamStr->EndBatch(locked);
+    }
+}
+
 void CSeqDBVol::IdsToOids(CSeqDBNegativeList & ids,
                           CSeqDBLockHold     & locked) const
 {
@@ -2432,6 +2517,132 @@ void CSeqDBVol::UnLease()
     }
 }
 
+void CSeqDBVol::PrefetchOidRange(int              first_oid,
+                                 int              end_oid,
+                                 CSeqDBLockHold & locked) const
+{
+    end_oid = min(end_oid, m_Idx->GetNumOIDs());
+    
+    if (first_oid < 0 || first_oid >= end_oid) {
+        return;
+    }
+    
+    m_Atlas.Lock(locked);
+    
+    if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+    if (!m_HdrFileOpened) x_OpenHdrFile(locked);
+    
+    TIndx begin(0), end(0), unused(0);
+    
+    // Nucleotide sequences are followed by their ambiguity data, which
+    // ends where the next sequence starts.
+    if (m_Seq.NotEmpty()) {
+        m_Idx->GetSeqStart(first_oid, begin);
+        m_Idx->GetSeqStart(end_oid, end);
+        m_Seq->Prefetch(begin, end, locked);
+    }
+    
+    if (m_Hdr.NotEmpty()) {
+        m_Idx->GetHdrStartEnd(first_oid, begin, unused);
+        m_Idx->GetHdrStartEnd(end_oid - 1, unused, end);
+        m_Hdr->Prefetch(begin, end, locked);
+    }
+}
+
+bool CSeqDBVol::PinSequenceData(CSeqDBLockHold & locked) const
+{
+    m_Atlas.Lock(locked);
+    
+    if (m_PinnedSeq) {
+        return true;
+    }
+    
+    if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+    
+    if (m_Seq.Empty()) {
+        // Empty volumes have no sequence file, and no OIDs to read.
+        return m_Idx->GetNumOIDs() == 0;
+    }
+    
+    TIndx idx_length(0), seq_length(0);
+    
+    const char * idx_data = m_Idx->PinWholeFile(idx_length, locked);
+    
+    if (! idx_data) {
+        return false;
+    }
+    
+    const char * seq_data = m_Seq->PinWholeFile(seq_length, locked);
+    
+    if (! seq_data) {
+        m_Atlas.RetRegion(idx_data);
+        return false;
+    }
+    
+    TIndx seq_table(0), amb_table(0);
+    m_Idx->GetOffsetTables(seq_table, amb_table);
+    
+    m_PinnedIdx        = idx_data;
+    m_PinnedSeq        = seq_data;
+    m_PinnedSeqLength  = seq_length;
+    m_PinnedSeqOffsets = (const Uint4 *) (idx_data + seq_table);
+    m_PinnedAmbOffsets = m_IsAA ? 0 : (const Uint4 *) (idx_data + amb_table);
+    
+    return true;
+}
+
+void CSeqDBVol::UnpinSequenceData(CSeqDBLockHold & locked) const
+{
+    m_Atlas.Lock(locked);
+    
+    if (m_PinnedSeq) {
+        m_Atlas.RetRegion(m_PinnedSeq);
+        m_Atlas.RetRegion(m_PinnedIdx);
+        
+        m_PinnedIdx        = 0;
+        m_PinnedSeq        = 0;
+        m_PinnedSeqLength  = 0;
+        m_PinnedSeqOffsets = 0;
+        m_PinnedAmbOffsets = 0;
+    }
+}
+
+int CSeqDBVol::GetPinnedSequence(int oid, const char ** buffer) const
+{
+    _ASSERT(m_PinnedSeq);
+    
+    if (oid < 0 || oid >= m_Idx->GetNumOIDs()) return -1;
+    
+    TIndx start_offset = SeqDB_GetStdOrd(& m_PinnedSeqOffsets[oid]);
+    TIndx end_offset   = 0;
+    
+    // Nucleotide sequences end where their ambiguity data starts.
+    
+    if (m_IsAA) {
+        end_offset = SeqDB_GetStdOrd(& m_PinnedSeqOffsets[oid+1]);
+    } else {
+        end_offset = SeqDB_GetStdOrd(& m_PinnedAmbOffsets[oid]);
+    }
+    
+    if (start_offset >= end_offset || end_offset > m_PinnedSeqLength) {
+        return -1;
+    }
+    
+    *buffer = m_PinnedSeq + start_offset;
+    
+    // Protein sequences are followed by a null byte; the last byte of
+    // nucleotide data holds the number of bases it has in its low bits.
+    
+    int whole_bytes = int(end_offset - start_offset - 1);
+    
+    if (m_IsAA) {
+        return whole_bytes;
+    }
+    
+    int remainder = (*buffer)[whole_bytes] & 3;
+    return (whole_bytes * 4) + remainder;
+}
+
 int CSeqDBVol::GetOidAtOffset(int              first_seq,
                               Uint8            residue,
                               CSeqDBLockHold & locked) const
@@ -2652,8 +2863,12 @@ CSeqDBVol::GetRawSeqAndAmbig(int              oid,
     }
     
     if (buffer) {
-        *buffer = m_Seq->GetRegion(map_begin, map_end, true, false, locked);
-        *buffer += (start_S - map_begin);
+        if (m_PinnedSeq) {
+            *buffer = m_PinnedSeq + start_S;
+        } else {
+            *buffer = m_Seq->GetRegion(map_begin, map_end, true, false, locked);
+            *buffer += (start_S - map_begin);
+        }
     }
     
     if (buffer && *buffer) {
@@ -460,6 +460,69 @@ public:
     /// reacquired (but not, for example, the index file data).
     void UnLease();
     
+    /// Start reading the sequence and header data of a range of OIDs.
+    ///
+    /// The data is mapped ahead of use, and the kernel is asked to
+    /// read it in.  This is only a hint.
+    ///
+    /// @param first_oid
+    ///   The first OID of the range, within this volume.
+    /// @param end_oid
+    ///   The OID after the range, within this volume.
+    /// @param locked
+    ///   The lock holder object for this thread.
+    void PrefetchOidRange(int              first_oid,
+                          int              end_oid,
+                          CSeqDBLockHold & locked) const;
+    
+    /// Keep the index and sequence files of this volume mapped.
+    ///
+    /// In the whole-file mapping modes, this pins mappings of the
+    /// whole index and sequence files.  From then on, this volume
+    /// finds sequence data in those mappings, without taking
+    /// references on atlas regions, and GetPinnedSequence() may be
+    /// called without the atlas lock.
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread. [in]
+    /// @return
+    ///   True if the files are pinned or the volume is empty.
+    bool PinSequenceData(CSeqDBLockHold & locked) const;
+    
+    /// Release the mappings kept by PinSequenceData().
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread. [in]
+    void UnpinSequenceData(CSeqDBLockHold & locked) const;
+    
+    /// Get the address range of the pinned sequence file.
+    ///
+    /// @param begin
+    ///   The start of the file data, or NULL if nothing is pinned. [out]
+    /// @param end
+    ///   The end of the file data. [out]
+    void GetPinnedRange(const char *& begin, const char *& end) const
+    {
+        begin = m_PinnedSeq;
+        end   = m_PinnedSeq ? (m_PinnedSeq + m_PinnedSeqLength) : 0;
+    }
+    
+    /// Get sequence data from the pinned mappings.
+    ///
+    /// This is GetSequence() for a volume pinned by PinSequenceData().
+    /// It reads the index and sequence files through the pinned
+    /// pointers, so it does not need the atlas lock, and the returned
+    /// data does not need to be returned to the atlas.
+    ///
+    /// @param oid
+    ///   The OID of the sequence. [in]
+    /// @param buffer
+    ///   The returned sequence data. [out]
+    /// @return
+    ///   The length of this sequence in bases, or -1 if the OID is not
+    ///   in this volume.
+    int GetPinnedSequence(int oid, const char ** buffer) const;
+    
     /// Find the OID given a PIG.
     ///
     /// A lookup is done for the PIG, and if found, the corresponding
@@ -611,6 +674,53 @@ public:
     void IdsToOids(CSeqDBGiList   & gis,
                    CSeqDBLockHold & locked) const;
     
+    /// Translations found by BatchIdsToOids().
+    struct SIdBatchResult {
+        /// Translations of the GIs of the list.
+        CSeqDBIsam::TBatchResult gis;
+        
+        /// Translations of the TIs of the list.
+        CSeqDBIsam::TBatchResult tis;
+        
+        /// Translations of the Seq-ids of the list.
+        CSeqDBIsam::TBatchResult sis;
+    };
+    
+    /// Prepare a batch translation of an ID list.
+    ///
+    /// The ISAM files needed to translate the ID list are opened and
+    /// mapped, so that BatchIdsToOids() can be called without the
+    /// atlas lock.  EndIdsToOidsBatch() must be called afterwards,
+    /// even if this method returns false.
+    ///
+    /// @param gis
+    ///   The sorted set of GI/OID, TI/OID, and Seq-id/OID pairs. [in]
+    /// @param locked
+    ///   The lock holder object for this thread. [in]
+    /// @return
+    ///   False if the list must be translated with IdsToOids().
+    bool BeginIdsToOidsBatch(CSeqDBGiList   & gis,
+                             CSeqDBLockHold & locked) const;
+    
+    /// Find the OIDs of the untranslated IDs of a list.
+    ///
+    /// The ID list is not modified; the translations found in this
+    /// volume are returned instead, so that several volumes can be
+    /// searched at once.  The atlas lock is not needed.
+    ///
+    /// @param gis
+    ///   The sorted set of GI/OID, TI/OID, and Seq-id/OID pairs. [in]
+    /// @param result
+    ///   The translations found in this volume. [out]
+    void BatchIdsToOids(CSeqDBGiList   & gis,
+                        SIdBatchResult & result) const;
+    
+    /// Release the files held by BeginIdsToOidsBatch().
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread. [in]
+    void EndIdsToOidsBatch(CSeqDBLockHold & locked) const;
+    
     /// Add OIDs for this volume, filtered by negative ID lists.
     ///
     /// This method iterates over a vector of Gis or Tis.  For each
@@ -1424,6 +1534,21 @@ private:
     mutable bool m_HashFileOpened;
     mutable bool m_OidFileOpened;
     
+    /// Index file data pinned by PinSequenceData(), or NULL.
+    mutable const char * m_PinnedIdx;
+    
+    /// Sequence file data pinned by PinSequenceData(), or NULL.
+    mutable const char * m_PinnedSeq;
+    
+    /// Length of the pinned sequence file.
+    mutable TIndx m_PinnedSeqLength;
+    
+    /// Sequence offset table within the pinned index file.
+    mutable const Uint4 * m_PinnedSeqOffsets;
+    
+    /// Ambiguity offset table within the pinned index file.
+    mutable const Uint4 * m_PinnedAmbOffsets;
+    
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     /// Set of columns defined for this volume.
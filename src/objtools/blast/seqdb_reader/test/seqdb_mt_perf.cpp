@@ -0,0 +1,255 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file seqdb_mt_perf.cpp
+ * Command line tool to measure how CSeqDB sequence retrieval scales with
+ * the number of threads.
+ */
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+static char const rcsid[] =
+    "$Id$";
+#endif /* SKIP_DOXYGEN_PROCESSING */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbithr.hpp>
+#include <objtools/blast/seqdb_reader/seqdb.hpp>
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+USING_NCBI_SCOPE;
+#endif
+
+/// Thread retrieving the sequences of a range of OIDs
+class CSeqDBRetrievalThread : public CThread
+{
+public:
+    /// Constructor
+    /// @param db BLAST database to read [in]
+    /// @param first_oid First OID to retrieve [in]
+    /// @param end_oid OID after the last one to retrieve [in]
+    /// @param passes Number of times to retrieve the range [in]
+    CSeqDBRetrievalThread(const CSeqDB & db, int first_oid, int end_oid,
+                          int passes)
+        : m_BlastDb(db), m_FirstOid(first_oid), m_EndOid(end_oid),
+          m_Passes(passes), m_NumSeqs(0), m_Checksum(0)
+    {}
+
+    /// Number of sequences retrieved
+    Uint8 GetNumSeqs() const { return m_NumSeqs; }
+
+    /// Sum of the first byte of each sequence, so that the data is read
+    Uint8 GetChecksum() const { return m_Checksum; }
+
+protected:
+    /** @inheritDoc */
+    virtual void* Main()
+    {
+        for (int pass = 0; pass < m_Passes; pass++) {
+            for (int oid = m_FirstOid; oid < m_EndOid; oid++) {
+                const char* buffer = NULL;
+                int seqlen = m_BlastDb.GetSequence(oid, &buffer);
+                if (seqlen > 0 && m_BlastDb.GetSeqLength(oid) == seqlen) {
+                    m_Checksum += (unsigned char) buffer[0];
+                }
+                m_BlastDb.RetSequence(&buffer);
+                m_NumSeqs++;
+            }
+        }
+        return NULL;
+    }
+
+private:
+    /// BLAST database to read
+    const CSeqDB& m_BlastDb;
+    /// First OID to retrieve
+    int m_FirstOid;
+    /// OID after the last one to retrieve
+    int m_EndOid;
+    /// Number of times to retrieve the range
+    int m_Passes;
+    /// Number of sequences retrieved
+    Uint8 m_NumSeqs;
+    /// Checksum of the data read
+    Uint8 m_Checksum;
+};
+
+/// The application class
+class CSeqDBMTPerfApp : public CNcbiApplication
+{
+public:
+    /** @inheritDoc */
+    CSeqDBMTPerfApp() {}
+private:
+    /** @inheritDoc */
+    virtual void Init();
+    /** @inheritDoc */
+    virtual int Run();
+
+    /// Retrieve all sequences of the database with a number of threads
+    /// @param num_threads Number of threads to use [in]
+    /// @return Sequences retrieved per second
+    double x_RetrieveSequences(int num_threads);
+
+    /// Handle to BLAST database
+    CRef<CSeqDB> m_BlastDb;
+};
+
+double
+CSeqDBMTPerfApp::x_RetrieveSequences(int num_threads)
+{
+    const int kNumOids = m_BlastDb->GetNumOIDs();
+    const int kPasses = GetArgs()["passes"].AsInteger();
+
+    // Each thread reads a contiguous range of OIDs, as the threads of a
+    // BLAST search do with the chunks they take
+    vector< CRef<CSeqDBRetrievalThread> > threads;
+    for (int i = 0; i < num_threads; i++) {
+        int first_oid = int((Int8) kNumOids * i / num_threads);
+        int end_oid = int((Int8) kNumOids * (i + 1) / num_threads);
+        threads.push_back(CRef<CSeqDBRetrievalThread>
+            (new CSeqDBRetrievalThread(*m_BlastDb, first_oid, end_oid,
+                                       kPasses)));
+    }
+
+    CStopWatch sw;
+    sw.Start();
+    NON_CONST_ITERATE(vector< CRef<CSeqDBRetrievalThread> >, thread, threads) {
+        (*thread)->Run();
+    }
+    Uint8 num_seqs = 0;
+    NON_CONST_ITERATE(vector< CRef<CSeqDBRetrievalThread> >, thread, threads) {
+        (*thread)->Join();
+        num_seqs += (*thread)->GetNumSeqs();
+    }
+    sw.Stop();
+
+    return sw.Elapsed() > 0.0 ? num_seqs / sw.Elapsed() : 0.0;
+}
+
+void CSeqDBMTPerfApp::Init()
+{
+    HideStdArgs(fHideConffile | fHideFullVersion | fHideXmlHelp | fHideDryRun);
+
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+
+    // Specify USAGE context
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                  "CSeqDB multi-threaded sequence retrieval benchmark");
+
+    arg_desc->SetCurrentGroup("BLAST database options");
+    arg_desc->AddDefaultKey("db", "dbname", "BLAST database name",
+                            CArgDescriptions::eString, "nr");
+
+    arg_desc->AddDefaultKey("dbtype", "molecule_type",
+                            "Molecule type stored in BLAST database",
+                            CArgDescriptions::eString, "guess");
+    arg_desc->SetConstraint("dbtype", &(*new CArgAllow_Strings,
+                                        "nucl", "prot", "guess"));
+
+    arg_desc->AddDefaultKey("map_mode", "mode",
+                            "How to memory map the database files",
+                            CArgDescriptions::eString, "whole");
+    arg_desc->SetConstraint("map_mode", &(*new CArgAllow_Strings,
+                                          "slices", "whole", "whole_huge"));
+
+    arg_desc->SetCurrentGroup("Benchmark options");
+    arg_desc->AddDefaultKey("max_threads", "num_threads",
+                            "Largest number of threads to use; the thread "
+                            "count doubles from 1 up to this number",
+                            CArgDescriptions::eInteger, "32");
+    arg_desc->SetConstraint("max_threads", new CArgAllow_Integers(1, 1024));
+    arg_desc->AddDefaultKey("passes", "num_passes",
+                            "Number of times each thread retrieves its "
+                            "sequences",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->SetConstraint("passes", new CArgAllow_Integers(1, kMax_Int));
+
+    arg_desc->SetCurrentGroup("Output configuration options");
+    arg_desc->AddDefaultKey("out", "output_file", "Output file name",
+                            CArgDescriptions::eOutputFile, "-");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+int CSeqDBMTPerfApp::Run(void)
+{
+    int status = 0;
+
+    try {
+        const CArgs& args = GetArgs();
+        const string& map_mode = args["map_mode"].AsString();
+        if (map_mode == "whole") {
+            CSeqDB::SetDefaultMapMode(eSeqDBMapWholeFiles);
+        } else if (map_mode == "whole_huge") {
+            CSeqDB::SetDefaultMapMode(eSeqDBMapWholeFilesHugePages);
+        }
+        CSeqDB::ESeqType seqtype =
+            ParseMoleculeTypeString(args["dbtype"].AsString());
+        m_BlastDb.Reset(new CSeqDB(args["db"].AsString(), seqtype));
+
+        CNcbiOstream& out = args["out"].AsOutputFile();
+        out << "Lock-free retrieval: "
+            << (m_BlastDb->IsLockFree() ? "yes" : "no") << endl
+            << "threads\tsequences/second\tspeedup" << endl;
+
+        // The first run also pages the data in; do not count it
+        x_RetrieveSequences(1);
+
+        double base_rate = 0.0;
+        const int kMaxThreads = args["max_threads"].AsInteger();
+        for (int num_threads = 1; num_threads <= kMaxThreads;
+             num_threads *= 2) {
+            double rate = x_RetrieveSequences(num_threads);
+            if (num_threads == 1) {
+                base_rate = rate;
+            }
+            out << num_threads << "\t" << setiosflags(ios::fixed)
+                << setprecision(2) << rate << "\t"
+                << (base_rate > 0.0 ? rate / base_rate : 0.0) << endl;
+        }
+        out << m_BlastDb->GetAtlasStats() << endl;
+    } catch (const CSeqDBException& e) {
+        LOG_POST(Error << "BLAST Database error: " << e.GetMsg());
+        status = 1;
+    } catch (const exception& e) {
+        LOG_POST(Error << "Error: " << e.what());
+        status = 1;
+    } catch (...) {
+        cerr << "Unknown exception!" << endl;
+        status = 1;
+    }
+    return status;
+}
+
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+int main(int argc, const char* argv[] /*, const char* envp[]*/)
+{
+    return CSeqDBMTPerfApp().AppMain(argc, argv, 0, eDS_Default, 0);
+}
+#endif /* SKIP_DOXYGEN_PROCESSING */
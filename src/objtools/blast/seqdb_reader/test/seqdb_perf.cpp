@@ -71,8 +71,21 @@ private:
     /// Processes all requests except printing the BLAST database information
     /// @return 0 on success; 1 if some sequences were not retrieved
     int x_ScanDatabase();
+
+    /// Issue readahead for the next chunk of OIDs every prefetch_chunk OIDs
+    /// @param oid OID about to be scanned [in]
+    void x_Prefetch(int oid);
 };
 
+void
+CSeqDBPerfApp::x_Prefetch(int oid)
+{
+    const int kChunk = GetArgs()["prefetch_chunk"].AsInteger();
+    if (kChunk > 0 && (oid % kChunk) == 0) {
+        m_BlastDb->PrefetchOidRange(oid + kChunk, oid + 2 * kChunk);
+    }
+}
+
 int
 CSeqDBPerfApp::x_ScanDatabase()
 {
@@ -82,6 +95,7 @@ CSeqDBPerfApp::x_ScanDatabase()
 
     if (m_DbIsProtein || GetArgs()["scan_uncompressed"]) {
         for (int oid = 0; m_BlastDb->CheckOrFindOID(oid); oid++) {
+            x_Prefetch(oid);
             const char* buffer = NULL;
             int encoding = m_DbIsProtein ? 0 : kSeqDBNuclBlastNA8;
             m_BlastDb->GetAmbigSeq(oid, &buffer, encoding);
@@ -95,6 +109,7 @@ CSeqDBPerfApp::x_ScanDatabase()
     } else {
         _ASSERT(GetArgs()["scan_compressed"]);
         for (int oid = 0; m_BlastDb->CheckOrFindOID(oid); oid++) {
+            x_Prefetch(oid);
             const char* buffer = NULL;
             m_BlastDb->GetSequence(oid, &buffer);
             int seqlen = m_BlastDb->GetSeqLength(oid);
@@ -108,6 +123,7 @@ CSeqDBPerfApp::x_ScanDatabase()
     sw.Stop();
     cout << setiosflags(ios::fixed) << setprecision(2) 
          << num_letters / sw.Elapsed() << " bases/second" << endl;
+    cout << m_BlastDb->GetAtlasStats() << endl;
     return 0;
 }
 
@@ -117,6 +133,12 @@ CSeqDBPerfApp::x_InitApplicationData()
     CStopWatch sw;
     sw.Start();
     const CArgs& args = GetArgs();
+    const string& map_mode = args["map_mode"].AsString();
+    if (map_mode == "whole") {
+        CSeqDB::SetDefaultMapMode(eSeqDBMapWholeFiles);
+    } else if (map_mode == "whole_huge") {
+        CSeqDB::SetDefaultMapMode(eSeqDBMapWholeFilesHugePages);
+    }
     CSeqDB::ESeqType seqtype = ParseMoleculeTypeString(args["dbtype"].AsString());
     m_BlastDb.Reset(new CSeqDBExpert(args["db"].AsString(), seqtype));
     m_DbIsProtein = static_cast<bool>(m_BlastDb->GetSequenceType() == CSeqDB::eProtein);
@@ -185,6 +207,12 @@ void CSeqDBPerfApp::Init()
     arg_desc->SetConstraint("dbtype", &(*new CArgAllow_Strings,
                                         "nucl", "prot", "guess"));
 
+    arg_desc->AddDefaultKey("map_mode", "mode",
+                            "How to memory map the database files",
+                            CArgDescriptions::eString, "slices");
+    arg_desc->SetConstraint("map_mode", &(*new CArgAllow_Strings,
+                                          "slices", "whole", "whole_huge"));
+
     arg_desc->SetCurrentGroup("Retrieval options");
     arg_desc->AddFlag("scan_uncompressed", 
                       "Do a full database scan of uncompressed sequence data", true);
@@ -192,6 +220,12 @@ void CSeqDBPerfApp::Init()
                       "Do a full database scan of compressed sequence data", true);
     arg_desc->AddFlag("get_metadata", 
                       "Retrieve BLAST database metadata", true);
+    arg_desc->AddDefaultKey("prefetch_chunk", "num_oids",
+                            "Prefetch the next this many OIDs while scanning "
+                            "(0 disables prefetching)",
+                            CArgDescriptions::eInteger, "0");
+    arg_desc->SetConstraint("prefetch_chunk",
+                            new CArgAllow_Integers(0, kMax_Int));
     
     arg_desc->SetDependency("scan_compressed", CArgDescriptions::eExcludes, 
                             "scan_uncompressed");
@@ -1295,6 +1295,21 @@ bool CBuildDatabase::EndBuild(bool erase)
     }
 }
 
+bool CBuildDatabase::CloseVolumes()
+{
+    vector<string> vols;
+    
+    m_OutputDb->Close();
+    m_OutputDb->ListVolumes(vols);
+    
+    return ! vols.empty();
+}
+
+void CBuildDatabase::AddExtraFile(const string & fname)
+{
+    m_ExtraFiles.push_back(fname);
+}
+
 bool CBuildDatabase::x_EndBuild(bool erase, const CException * close_exception)
 {
     bool success = false;
@@ -1309,6 +1324,10 @@ bool CBuildDatabase::x_EndBuild(bool erase, const CException * close_exception)
     
     _ASSERT(vols.empty() == files.empty());
     
+    if (! vols.empty()) {
+        files.insert(files.end(), m_ExtraFiles.begin(), m_ExtraFiles.end());
+    }
+    
     if (vols.empty()) {
         m_LogFile << "No volumes were created because no sequences were found."
                   << endl;
@@ -1405,6 +1424,11 @@ void CBuildDatabase::SetMaxFileSize(Uint8 max_file_size)
     m_OutputDb->SetMaxFileSize(max_file_size);
 }
 
+void CBuildDatabase::SetNumThreads(int num_threads)
+{
+    m_OutputDb->SetNumThreads(num_threads);
+}
+
 int
 CBuildDatabase::RegisterMaskingAlgorithm(EBlast_filter_program program, 
                                          const string        & options,
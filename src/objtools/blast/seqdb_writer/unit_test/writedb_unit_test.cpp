@@ -1308,6 +1308,93 @@ BOOST_AUTO_TEST_CASE(MultiVolume)
     s_WrapUpFiles(f);
 }
 
+static void s_BuildMultiVolume(const string & dbname, int num_threads,
+                               Uint8 max_letters, vector<string> & files)
+{
+    CSeqDB nr("nr", CSeqDB::eProtein);
+    
+    CWriteDB db(dbname,
+                CWriteDB::eProtein,
+                "title",
+                CWriteDB::eFullIndex);
+    
+    db.SetMaxVolumeLetters(max_letters);
+    db.SetNumThreads(num_threads);
+    
+    int gis[] = { 129295, 129296, 129297, 129299, 0 };
+    
+    for(int i = 0; gis[i]; i++) {
+        int oid(0);
+        nr.GiToOid(gis[i], oid);
+        
+        db.AddSequence(*nr.GetBioseq(oid));
+    }
+    
+    db.Close();
+    db.ListFiles(files);
+}
+
+static string s_ReadFile(const string & fname)
+{
+    CNcbiIfstream file(fname.c_str(), IOS_BASE::binary);
+    CNcbiOstrstream data;
+    data << file.rdbuf();
+    return CNcbiOstrstreamToString(data);
+}
+
+/// Lowers the size of the ISAM tables sorted with several threads while
+/// in scope, so that the small test databases use the threaded sort.
+class CParallelSortSizeGuard {
+public:
+    CParallelSortSizeGuard(size_t size)
+        : m_Saved(CWriteDB_IsamIndex::GetMinParallelSortSize())
+    {
+        CWriteDB_IsamIndex::SetMinParallelSortSize(size);
+    }
+    
+    ~CParallelSortSizeGuard()
+    {
+        CWriteDB_IsamIndex::SetMinParallelSortSize(m_Saved);
+    }
+    
+private:
+    size_t m_Saved;
+};
+
+BOOST_AUTO_TEST_CASE(MultiVolumeThreaded)
+{
+    CParallelSortSizeGuard guard(1);
+    
+    // Several small volumes, and one volume holding all the sequences so
+    // that the sorted chunks are merged.
+    Uint8 max_letters[] = { 500, 1000000 };
+    
+    for(size_t v = 0; v < ArraySize(max_letters); v++) {
+        vector<string> serial_files, mt_files;
+        
+        s_BuildMultiVolume("multivol-st", 1, max_letters[v], serial_files);
+        s_BuildMultiVolume("multivol-mt", 4, max_letters[v], mt_files);
+        
+        BOOST_REQUIRE_EQUAL(serial_files.size(), mt_files.size());
+        
+        for(size_t i = 0; i < serial_files.size(); i++) {
+            string ext = s_ExtractLast(serial_files[i], ".");
+            
+            // Index and alias files hold the name and date of the database.
+            if (ext == "pin" || ext == "pal") {
+                continue;
+            }
+            
+            BOOST_REQUIRE_EQUAL(ext, s_ExtractLast(mt_files[i], "."));
+            BOOST_REQUIRE(s_ReadFile(serial_files[i]) ==
+                          s_ReadFile(mt_files[i]));
+        }
+        
+        s_WrapUpFiles(serial_files);
+        s_WrapUpFiles(mt_files);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(UsPatId)
 {
         
@@ -36,14 +36,83 @@ static char const rcsid[] = "$Id: writedb_general.cpp 214595 2010-12-06 20:24:17
 
 #include <ncbi_pch.hpp>
 #include <objtools/blast/seqdb_writer/writedb_general.hpp>
+#include <corelib/ncbithr.hpp>
 
 BEGIN_NCBI_SCOPE
 
 /// Use standard C++ definitions.
 USING_SCOPE(std);
 
-void CWriteDB_PackedSemiTree::Sort()
+/// Thread sorting every n-th packed string list of a semi-tree.
+class CWriteDB_PackedSortThread : public CThread {
+public:
+    /// Type of the lists to sort.
+    typedef CWriteDB_PackedSemiTree::TPacked TPacked;
+    
+    /// Constructor.
+    /// @param lists All lists of the semi-tree. [in]
+    /// @param first Index of the first list to sort. [in]
+    /// @param step Distance between the lists to sort. [in]
+    CWriteDB_PackedSortThread(const vector<TPacked *> & lists,
+                              int                       first,
+                              int                       step)
+        : m_Lists(lists), m_First(first), m_Step(step)
+    {
+    }
+    
+protected:
+    /// Sort the lists.
+    virtual void * Main()
+    {
+        for(size_t i = m_First; i < m_Lists.size(); i += m_Step) {
+            m_Lists[i]->Sort();
+        }
+        return NULL;
+    }
+    
+private:
+    /// All lists of the semi-tree.
+    const vector<TPacked *> & m_Lists;
+    
+    /// Index of the first list to sort.
+    int m_First;
+    
+    /// Distance between the lists to sort.
+    int m_Step;
+};
+
+void CWriteDB_PackedSemiTree::Sort(int num_threads)
 {
+#if defined(NCBI_THREADS)
+    if (num_threads > 1 && m_Packed.size() > 1) {
+        // Each prefix has its own list, and lists never share strings,
+        // so they can be sorted at the same time.
+        
+        vector<TPacked *> lists;
+        lists.reserve(m_Packed.size());
+        
+        NON_CONST_ITERATE(TPackedMap, iter, m_Packed) {
+            lists.push_back(iter->second.GetPointer());
+        }
+        
+        num_threads = min(num_threads, (int) lists.size());
+        
+        vector< CRef<CWriteDB_PackedSortThread> > threads;
+        
+        for(int i = 0; i < num_threads; i++) {
+            threads.push_back(CRef<CWriteDB_PackedSortThread>
+                 (new CWriteDB_PackedSortThread(lists, i, num_threads)));
+            threads.back()->Run();
+        }
+        
+        NON_CONST_ITERATE(vector< CRef<CWriteDB_PackedSortThread> >,
+                          thr, threads) {
+            (*thr)->Join();
+        }
+        return;
+    }
+#endif
+    
     NON_CONST_ITERATE(TPackedMap, iter, m_Packed) {
         iter->second->Sort();
     }
@@ -48,6 +48,7 @@ static char const rcsid[] = "$Id: writedb_impl.cpp 390400 2013-02-27 15:52:25Z m
 
 #include "writedb_impl.hpp"
 #include <objtools/blast/seqdb_writer/writedb_convert.hpp>
+#include <corelib/ncbithr.hpp>
 
 #include <iostream>
 #include <sstream>
@@ -57,6 +58,49 @@ BEGIN_NCBI_SCOPE
 /// Import C++ std namespace.
 USING_SCOPE(std);
 
+/// Thread closing a full volume.
+///
+/// Closing a volume sorts and writes its ISAM indices, which can take
+/// a while for large volumes; meanwhile the next volume is filled.
+class CWriteDB_VolumeCloser : public CThread {
+public:
+    /// Constructor.
+    /// @param volume The volume to close.
+    CWriteDB_VolumeCloser(CRef<CWriteDB_Volume> volume)
+        : m_Volume(volume)
+    {
+    }
+    
+    /// Get the message of the exception thrown by Close(), if any.
+    const string & GetError() const
+    {
+        return m_Error;
+    }
+    
+protected:
+    /// Close the volume.
+    virtual void * Main()
+    {
+        try {
+            m_Volume->Close();
+        }
+        catch(CException & e) {
+            m_Error = e.GetMsg();
+        }
+        catch(exception & e) {
+            m_Error = e.what();
+        }
+        return NULL;
+    }
+    
+private:
+    /// The volume to close.
+    CRef<CWriteDB_Volume> m_Volume;
+    
+    /// Message of the exception thrown by Close().
+    string m_Error;
+};
+
 CWriteDB_Impl::CWriteDB_Impl(const string & dbname,
                              bool           protein,
                              const string & title,
@@ -70,6 +114,7 @@ CWriteDB_Impl::CWriteDB_Impl(const string & dbname,
       m_MaxVolumeLetters (0),
       m_Indices          (indices),
       m_Closed           (false),
+      m_NumThreads       (1),
       m_MaskDataColumn   (-1),
       m_ParseIDs         (parse_ids),
       m_UseGiMask        (use_gi_mask),
@@ -93,6 +138,11 @@ CWriteDB_Impl::CWriteDB_Impl(const string & dbname,
 CWriteDB_Impl::~CWriteDB_Impl()
 {
     Close();
+    
+    // Only left running if an earlier Close() failed.
+    if (m_VolumeCloser.NotEmpty()) {
+        m_VolumeCloser->Join();
+    }
 }
 
 void CWriteDB_Impl::x_ResetSequenceData()
@@ -311,6 +361,8 @@ void CWriteDB_Impl::Close()
     m_Sequence.erase();
     m_Ambig.erase();
     
+    x_WaitForVolumeClose();
+    
     if (! m_Volume.Empty()) {
         m_Volume->Close();
         
@@ -1018,7 +1070,7 @@ void CWriteDB_Impl::x_Publish()
         int index = (int) m_VolumeList.size();
         
         if (m_Volume.NotEmpty()) {
-            m_Volume->Close();
+            x_CloseVolume(m_Volume);
         }
         
         {
@@ -1032,6 +1084,7 @@ void CWriteDB_Impl::x_Publish()
                                                m_Indices));
             
             m_VolumeList.push_back(m_Volume);
+            m_Volume->SetNumThreads(m_NumThreads);
             
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
@@ -1403,6 +1456,48 @@ void CWriteDB_Impl::SetMaxVolumeLetters(Uint8 sz)
     m_MaxVolumeLetters = sz;
 }
 
+void CWriteDB_Impl::SetNumThreads(int num_threads)
+{
+    m_NumThreads = max(num_threads, 1);
+    
+    if (m_Volume.NotEmpty()) {
+        m_Volume->SetNumThreads(m_NumThreads);
+    }
+}
+
+void CWriteDB_Impl::x_CloseVolume(CRef<CWriteDB_Volume> volume)
+{
+    // Only one volume is closed at a time, so that the memory used by
+    // ISAM indices is at most doubled.
+    
+    x_WaitForVolumeClose();
+    
+#if defined(NCBI_THREADS)
+    if (m_NumThreads > 1) {
+        m_VolumeCloser.Reset(new CWriteDB_VolumeCloser(volume));
+        m_VolumeCloser->Run();
+        return;
+    }
+#endif
+    
+    volume->Close();
+}
+
+void CWriteDB_Impl::x_WaitForVolumeClose()
+{
+    if (m_VolumeCloser.Empty()) {
+        return;
+    }
+    
+    CRef<CWriteDB_VolumeCloser> closer(m_VolumeCloser);
+    m_VolumeCloser.Reset();
+    closer->Join();
+    
+    if (! closer->GetError().empty()) {
+        NCBI_THROW(CWriteDBException, eFileErr, closer->GetError());
+    }
+}
+
 CRef<CBlast_def_line_set>
 CWriteDB_Impl::ExtractBioseqDeflines(const CBioseq & bs, bool parse_ids)
 {
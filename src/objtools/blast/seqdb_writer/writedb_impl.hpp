@@ -55,6 +55,8 @@ BEGIN_NCBI_SCOPE
 /// Import definitions from the objects namespace.
 USING_SCOPE(objects);
 
+class CWriteDB_VolumeCloser;
+
 /// CWriteDB_Impl class
 /// 
 /// This manufactures blast database header files from input data.
@@ -200,6 +202,18 @@ public:
     /// @param sz Maximum sequence letters per volume.
     void SetMaxVolumeLetters(Uint8 sz);
     
+    /// Set the number of threads used to build the database.
+    ///
+    /// With more than one thread, the ISAM indices are sorted with
+    /// several threads, and each full volume is finished in the
+    /// background while the next volume is filled.  At most one
+    /// volume is finished at a time, which bounds the extra memory
+    /// used to the indices of that volume.  The files written do not
+    /// depend on the number of threads.
+    ///
+    /// @param num_threads Number of threads.
+    void SetNumThreads(int num_threads);
+    
     /// Extract deflines from a CBioseq.
     ///
     /// Given a CBioseq, this method extracts and returns header info
@@ -366,6 +380,7 @@ private:
     Uint8         m_MaxVolumeLetters; ///< Max letters per volume.
     EIndexType    m_Indices;          ///< Indexing mode.
     bool          m_Closed;           ///< True if database has been closed.
+    int           m_NumThreads;       ///< Threads used to build the database.
     string        m_MaskedLetters;    ///< Masked protein letters (IUPAC).
     string        m_MaskByte;         ///< Byte that replaced masked letters.
     vector<char>  m_MaskLookup;       ///< Is (blast-aa) byte masked?
@@ -394,6 +409,14 @@ private:
     /// Flush accumulated sequence data to volume.
     void x_Publish();
     
+    /// Close a full volume, in the background if threads are used.
+    /// @param volume The volume to close.
+    void x_CloseVolume(CRef<CWriteDB_Volume> volume);
+    
+    /// Wait until the volume being closed in the background (if any)
+    /// is closed.
+    void x_WaitForVolumeClose();
+    
     /// Compute name of alias file produced.
     string x_MakeAliasName();
     
@@ -604,6 +627,9 @@ private:
     /// List of all volumes so far, up to and including m_Volume.
     vector< CRef<CWriteDB_Volume> > m_VolumeList;
     
+    /// Thread closing the previous volume, if any.
+    CRef<CWriteDB_VolumeCloser> m_VolumeCloser;
+    
     /// Blob data for the current sequence, indexed by letter.
     vector< CRef<CBlastDbBlob> > m_Blobs;
     
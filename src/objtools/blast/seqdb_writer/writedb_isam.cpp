@@ -36,6 +36,7 @@ static char const rcsid[] = "$Id: writedb_isam.cpp 290538 2011-05-20 15:06:54Z c
 
 #include <ncbi_pch.hpp>
 #include <corelib/tempstr.hpp>
+#include <corelib/ncbithr.hpp>
 #include <objtools/blast/seqdb_writer/writedb_error.hpp>
 #include <objtools/blast/seqdb_writer/writedb_isam.hpp>
 #include <objtools/blast/seqdb_writer/writedb_convert.hpp>
@@ -100,6 +101,67 @@ s_IsamExtension(EWriteDBIsamType itype,
     return extn;
 }
 
+/// Smallest numeric table sorted with several threads by default.
+static const size_t kMinParallelSortSize = 1024 * 1024;
+
+/// Smallest numeric table sorted with several threads.
+static size_t s_MinParallelSortSize = kMinParallelSortSize;
+
+/// Thread sorting a range of a table, or merging two sorted ranges.
+template<class TIter>
+class CWriteDB_SortThread : public CThread {
+public:
+    /// Constructor.
+    ///
+    /// If mid is equal to end, [begin, end) is sorted; otherwise the
+    /// sorted ranges [begin, mid) and [mid, end) are merged.
+    ///
+    /// @param begin Start of the range. [in]
+    /// @param mid End of the first sorted range. [in]
+    /// @param end End of the range. [in]
+    CWriteDB_SortThread(TIter begin, TIter mid, TIter end)
+        : m_Begin(begin), m_Mid(mid), m_End(end)
+    {
+    }
+    
+protected:
+    /// Sort or merge the range.
+    virtual void * Main()
+    {
+        if (m_Mid == m_End) {
+            std::sort(m_Begin, m_End);
+        } else {
+            std::inplace_merge(m_Begin, m_Mid, m_End);
+        }
+        return NULL;
+    }
+    
+private:
+    /// Start of the range.
+    TIter m_Begin;
+    
+    /// End of the first sorted range.
+    TIter m_Mid;
+    
+    /// End of the range.
+    TIter m_End;
+};
+
+/// Run sort threads and wait until all are done.
+/// @param threads The threads to run. [in]
+template<class TIter>
+static void s_RunSortThreads(vector< CRef< CWriteDB_SortThread<TIter> > > & threads)
+{
+    typedef CRef< CWriteDB_SortThread<TIter> > TThreadRef;
+    
+    NON_CONST_ITERATE(typename vector<TThreadRef>, thr, threads) {
+        (*thr)->Run();
+    }
+    NON_CONST_ITERATE(typename vector<TThreadRef>, thr, threads) {
+        (*thr)->Join();
+    }
+}
+
 CWriteDB_Isam::CWriteDB_Isam(EIsamType      itype,
                              const string & dbname,
                              bool           protein,
@@ -145,6 +207,11 @@ void CWriteDB_Isam::AddHash(int oid, int hash)
     m_IFile->AddHash(oid, hash);
 }
 
+void CWriteDB_Isam::SetNumThreads(int num_threads)
+{
+    m_IFile->SetNumThreads(num_threads);
+}
+
 void CWriteDB_Isam::Close()
 {
     // Index must be closed first, because ISAM indices are built in
@@ -177,6 +244,7 @@ CWriteDB_IsamIndex::CWriteDB_IsamIndex(EWriteDBIsamType        itype,
       m_PageSize     (0),
       m_BytesPerElem (0),
       m_DataFileSize (0),
+      m_NumThreads   (1),
       m_UseInt8      (false),
       m_DataFile     (datafile),
       m_Oid          (-1)
@@ -300,7 +368,7 @@ void CWriteDB_IsamIndex::x_FlushStringIndex()
     int output_count = 0;
     int index = 0;
     
-    m_StringSort.Sort();
+    m_StringSort.Sort(m_NumThreads);
 
     CWriteDB_PackedSemiTree::Iterator iter = m_StringSort.Begin();
     CWriteDB_PackedSemiTree::Iterator end_iter = m_StringSort.End();
@@ -383,7 +451,7 @@ void CWriteDB_IsamIndex::x_FlushNumericIndex()
     
     int row_index = 0;
     
-    sort(m_NumberTable.begin(), m_NumberTable.end());
+    x_SortNumberTable();
     
     int count = (int) m_NumberTable.size();
     
@@ -451,6 +519,72 @@ void CWriteDB_IsamIndex::x_FlushNumericIndex()
     }
 }
 
+void CWriteDB_IsamIndex::SetMinParallelSortSize(size_t size)
+{
+    s_MinParallelSortSize = max(size, (size_t) 1);
+}
+
+size_t CWriteDB_IsamIndex::GetMinParallelSortSize()
+{
+    return s_MinParallelSortSize;
+}
+
+void CWriteDB_IsamIndex::x_SortNumberTable()
+{
+    typedef vector<SIdOid>::iterator TIter;
+    typedef CWriteDB_SortThread<TIter> TThread;
+    
+    size_t size = m_NumberTable.size();
+    
+#if defined(NCBI_THREADS)
+    if (m_NumThreads > 1 && size >= s_MinParallelSortSize) {
+        // Sort one chunk of the table per thread, then merge pairs of
+        // adjacent chunks until the whole table is sorted.  Equal
+        // elements are identical, so this gives the same table as a
+        // single sort.
+        
+        TIter begin = m_NumberTable.begin();
+        vector<TIter> bounds;
+        
+        for(int i = 0; i <= m_NumThreads; i++) {
+            bounds.push_back(begin + size * i / m_NumThreads);
+        }
+        
+        vector< CRef<TThread> > threads;
+        
+        for(int i = 0; i < m_NumThreads; i++) {
+            threads.push_back(CRef<TThread>
+                (new TThread(bounds[i], bounds[i+1], bounds[i+1])));
+        }
+        s_RunSortThreads(threads);
+        
+        while(bounds.size() > 2) {
+            vector<TIter> merged;
+            threads.clear();
+            
+            size_t i = 0;
+            for(; i + 2 < bounds.size(); i += 2) {
+                threads.push_back(CRef<TThread>
+                    (new TThread(bounds[i], bounds[i+1], bounds[i+2])));
+                merged.push_back(bounds[i]);
+            }
+            
+            // An odd chunk out waits for the next round.
+            if (i + 2 == bounds.size()) {
+                merged.push_back(bounds[i]);
+            }
+            merged.push_back(bounds.back());
+            
+            s_RunSortThreads(threads);
+            bounds.swap(merged);
+        }
+        return;
+    }
+#endif
+    
+    sort(m_NumberTable.begin(), m_NumberTable.end());
+}
+
 void CWriteDB_IsamIndex::x_Flush()
 {
     if (m_NumberTable.size() || m_StringSort.Size()) {
@@ -338,6 +338,25 @@ void CWriteDB_Volume::Close()
 #endif
 }
 
+void CWriteDB_Volume::SetNumThreads(int num_threads)
+{
+    if (m_Indices != CWriteDB::eNoIndex) {
+        if (m_Protein) {
+            m_PigIsam->SetNumThreads(num_threads);
+        }
+        m_GiIsam->SetNumThreads(num_threads);
+        m_AccIsam->SetNumThreads(num_threads);
+        
+        if (m_TraceIsam.NotEmpty()) {
+            m_TraceIsam->SetNumThreads(num_threads);
+        }
+        
+        if (m_HashIsam.NotEmpty()) {
+            m_HashIsam->SetNumThreads(num_threads);
+        }
+    }
+}
+
 void CWriteDB_Volume::RenameSingle()
 {
     _ASSERT(! m_Open);
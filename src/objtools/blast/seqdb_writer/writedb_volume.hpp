@@ -176,6 +176,13 @@ public:
     /// until all of the data has been seen.)
     void Close();
     
+    /// Set the number of threads used to sort the ISAM indices.
+    ///
+    /// The files written do not depend on the number of threads.
+    ///
+    /// @param num_threads Number of threads. [in]
+    void SetNumThreads(int num_threads);
+    
     /// Get the name of the volume.
     /// 
     /// The volume name includes the path and version (if a version is
@@ -0,0 +1,111 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Type-specific ASN.1 binary I/O of class members
+*/
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbistd.hpp>
+#include <corelib/ncbi_param.hpp>
+#include <serial/impl/asnbdirect.hpp>
+#include <serial/impl/classinfo.hpp>
+#include <serial/impl/member.hpp>
+
+BEGIN_NCBI_SCOPE
+
+// Allows turning off the generated I/O functions,
+// e.g. to compare the speed with the generic one
+NCBI_PARAM_DECL(bool, SERIAL, ASN_BINARY_DIRECT_IO);
+NCBI_PARAM_DEF_EX(bool, SERIAL, ASN_BINARY_DIRECT_IO, true,
+                  eParam_NoThread, SERIAL_ASN_BINARY_DIRECT_IO);
+
+
+void CAsnBinaryMemberReader::x_PeekTag(void)
+{
+    if ( !m_HaveTag ) {
+        CObjectIStreamAsnBinary::TByte first_tag_byte = m_In.PeekTagByte();
+        m_End = first_tag_byte == CAsnBinaryDefs::eEndOfContentsByte;
+        if ( !m_End ) {
+            m_Tag = m_In.PeekTag(first_tag_byte,
+                                 CAsnBinaryDefs::eContextSpecific,
+                                 CAsnBinaryDefs::eConstructed);
+        }
+        m_HaveTag = true;
+    }
+}
+
+
+bool CAsnBinaryMemberReader::x_BeginMember(TMemberIndex index,
+                                           const CMemberInfo* memberInfo)
+{
+    m_In.SetTopMemberId(memberInfo->GetId());
+    x_PeekTag();
+    if ( m_End ) {
+        return false;
+    }
+    if ( m_Tag != memberInfo->GetId().GetTag() ) {
+        // the member is missing, unless the tag does not belong
+        // to any of the following members
+        if ( m_ClassType->GetMembers().Find(m_Tag, index) == kInvalidMember ) {
+            m_In.UnexpectedMember(m_Tag, m_ClassType->GetItems());
+        }
+        return false;
+    }
+    m_In.ExpectIndefiniteLength();
+    m_HaveTag = false;
+    return true;
+}
+
+
+void CAsnBinaryMemberReader::x_End(void)
+{
+    x_PeekTag();
+    if ( !m_End ) {
+        m_In.UnexpectedMember(m_Tag, m_ClassType->GetItems());
+    }
+}
+
+
+void CAsnBinaryMemberReader::Read(TMemberIndex index)
+{
+    const CMemberInfo* memberInfo = m_ClassType->GetMemberInfo(index);
+    if ( x_BeginMember(index, memberInfo) ) {
+        memberInfo->ReadMember(m_In, m_ClassPtr);
+        m_In.ExpectEndOfContent();
+    }
+    else {
+        memberInfo->ReadMissingMember(m_In, m_ClassPtr);
+    }
+}
+
+
+void CAsnBinaryMemberWriter::Write(TMemberIndex index)
+{
+    m_ClassType->GetMemberInfo(index)->WriteMember(m_Out, m_ClassPtr);
+}
+
+
+END_NCBI_SCOPE
@@ -0,0 +1,313 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Index of the elements of a container in ASN binary data
+*/
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbistd.hpp>
+#include <serial/asnindex.hpp>
+#include <serial/objistr.hpp>
+#include <serial/objectiter.hpp>
+#include <serial/objhook.hpp>
+#include <serial/impl/classinfob.hpp>
+#include <serial/exception.hpp>
+
+BEGIN_NCBI_SCOPE
+
+
+/// First line of saved indexes
+static const char* const kIndexHeader = "ASN.1 binary index 1";
+
+
+CAsnBinaryIndex::CAsnBinaryIndex(void)
+{
+}
+
+size_t CAsnBinaryIndex::AddElement(TOffset offset, TOffset size)
+{
+    SElement element;
+    element.m_Offset = offset;
+    element.m_Size = size;
+    m_Elements.push_back(element);
+    return m_Elements.size() - 1;
+}
+
+void CAsnBinaryIndex::AddKey(size_t index, const string& key)
+{
+    _ASSERT(index < m_Elements.size());
+    // keys are written as tab-separated fields of a line
+    if ( key.empty()  ||  key.find_first_of("\t\r\n") != NPOS ) {
+        NCBI_THROW(CSerialException, eInvalidData,
+                   "CAsnBinaryIndex: key is empty or contains a tab or "
+                   "a line break: " + NStr::PrintableString(key));
+    }
+    m_Keys.insert(TKeys::value_type(key, index));
+}
+
+const CAsnBinaryIndex::SElement&
+CAsnBinaryIndex::GetElement(size_t index) const
+{
+    if ( index >= m_Elements.size() ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryIndex: element index out of range: " +
+                   NStr::SizetToString(index));
+    }
+    return m_Elements[index];
+}
+
+size_t CAsnBinaryIndex::FindElement(const string& key) const
+{
+    TKeys::const_iterator it = m_Keys.find(key);
+    return it == m_Keys.end() ? NPOS : it->second;
+}
+
+void CAsnBinaryIndex::Write(CNcbiOstream& out) const
+{
+    // element keys, in the order of the elements
+    vector< vector<const string*> > keys(m_Elements.size());
+    ITERATE ( TKeys, it, m_Keys ) {
+        keys[it->second].push_back(&it->first);
+    }
+    out << kIndexHeader << '\n'
+        << m_ElementTypeName << '\n'
+        << m_Elements.size() << '\n';
+    for ( size_t i = 0; i < m_Elements.size(); ++i ) {
+        out << m_Elements[i].m_Offset << '\t' << m_Elements[i].m_Size;
+        ITERATE ( vector<const string*>, key, keys[i] ) {
+            out << '\t' << **key;
+        }
+        out << '\n';
+    }
+    out.flush();
+    if ( !out ) {
+        NCBI_THROW(CSerialException, eIoError,
+                   "CAsnBinaryIndex: cannot write index");
+    }
+}
+
+void CAsnBinaryIndex::Read(CNcbiIstream& in)
+{
+    m_ElementTypeName.erase();
+    m_Elements.clear();
+    m_Keys.clear();
+
+    string line;
+    NcbiGetlineEOL(in, line);
+    if ( !in || line != kIndexHeader ) {
+        NCBI_THROW(CSerialException, eFormatError,
+                   "CAsnBinaryIndex: not an index");
+    }
+    NcbiGetlineEOL(in, m_ElementTypeName);
+    NcbiGetlineEOL(in, line);
+    if ( !in ) {
+        NCBI_THROW(CSerialException, eEOF,
+                   "CAsnBinaryIndex: truncated index");
+    }
+    size_t count = NStr::StringToSizet(line);
+    m_Elements.reserve(count);
+    vector<string> fields;
+    for ( size_t i = 0; i < count; ++i ) {
+        NcbiGetlineEOL(in, line);
+        if ( !in ) {
+            NCBI_THROW(CSerialException, eEOF,
+                       "CAsnBinaryIndex: truncated index");
+        }
+        fields.clear();
+        NStr::Tokenize(line, "\t", fields);
+        if ( fields.size() < 2 ) {
+            NCBI_THROW(CSerialException, eFormatError,
+                       "CAsnBinaryIndex: bad element line: " + line);
+        }
+        size_t index = AddElement(NStr::StringToInt8(fields[0]),
+                                  NStr::StringToInt8(fields[1]));
+        for ( size_t f = 2; f < fields.size(); ++f ) {
+            AddKey(index, fields[f]);
+        }
+    }
+}
+
+
+CAsnBinaryIndexer::IKeySource::~IKeySource(void)
+{
+}
+
+
+/// Container element hook adding the elements to the index
+class CAsnBinaryIndexElementHook : public CReadContainerElementHook
+{
+public:
+    CAsnBinaryIndexElementHook(CAsnBinaryIndexer& indexer)
+        : m_Indexer(indexer)
+    {
+    }
+
+    virtual void ReadContainerElement(CObjectIStream& in,
+                                      const CObjectInfo& /*container*/)
+    {
+        m_Indexer.x_AddElement(in);
+    }
+
+private:
+    CAsnBinaryIndexer& m_Indexer;
+};
+
+/// Class member hook indexing the elements of the container member
+class CAsnBinaryIndexMemberHook : public CReadClassMemberHook
+{
+public:
+    CAsnBinaryIndexMemberHook(CAsnBinaryIndexer& indexer)
+        : m_Indexer(indexer)
+    {
+    }
+
+    virtual void ReadClassMember(CObjectIStream& in,
+                                 const CObjectInfoMI& member)
+    {
+        CAsnBinaryIndexElementHook hook(m_Indexer);
+        member.GetMember().ReadContainer(in, hook);
+    }
+
+private:
+    CAsnBinaryIndexer& m_Indexer;
+};
+
+
+CAsnBinaryIndexer::CAsnBinaryIndexer(const CObjectTypeInfo& root,
+                                     const string& container_member,
+                                     IKeySource* keys)
+    : m_Root(root), m_ContainerMember(container_member),
+      m_ElementType(0), m_Keys(keys)
+{
+    if ( root.GetTypeFamily() != eTypeFamilyClass ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryIndexer: root object is not a class");
+    }
+    CObjectTypeInfoMI member = root.FindMember(container_member);
+    if ( !member.Valid() ||
+         member.GetMemberType().GetTypeFamily() != eTypeFamilyContainer ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryIndexer: " + container_member +
+                   " is not a container member of " +
+                   root.GetTypeInfo()->GetName());
+    }
+    CObjectTypeInfo element = member.GetMemberType().GetElementType();
+    if ( element.GetTypeFamily() == eTypeFamilyPointer ) {
+        element = element.GetPointedType();
+    }
+    if ( keys && !element.GetTypeInfo()->IsCObject() ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryIndexer: elements of " +
+                   container_member + " are not CObjects");
+    }
+    m_ElementType = element.GetTypeInfo();
+}
+
+CRef<CAsnBinaryIndex> CAsnBinaryIndexer::Index(CObjectIStream& in)
+{
+    if ( in.GetDataFormat() != eSerial_AsnBinary ) {
+        NCBI_THROW(CSerialException, eNotImplemented,
+                   "CAsnBinaryIndexer: ASN binary input expected");
+    }
+    m_Index.Reset(new CAsnBinaryIndex);
+    m_Index->SetElementTypeName(m_ElementType->GetName());
+
+    CObjectTypeInfoMI member = m_Root.FindMember(m_ContainerMember);
+    member.SetLocalReadHook(in, new CAsnBinaryIndexMemberHook(*this));
+    try {
+        CObjectInfo root(m_Root.GetTypeInfo());
+        in.Read(root);
+    }
+    catch ( ... ) {
+        member.ResetLocalReadHook(in);
+        m_Index.Reset();
+        throw;
+    }
+    member.ResetLocalReadHook(in);
+
+    CRef<CAsnBinaryIndex> index = m_Index;
+    m_Index.Reset();
+    return index;
+}
+
+void CAsnBinaryIndexer::x_AddElement(CObjectIStream& in)
+{
+    Int8 offset = NcbiStreamposToInt8(in.GetStreamPos());
+    vector<string> keys;
+    if ( m_Keys ) {
+        CObjectInfo element(m_ElementType);
+        in.ReadObject(element);
+        m_Keys->GetKeys(element, keys);
+    }
+    else {
+        in.SkipObject(m_ElementType);
+    }
+    Int8 size = NcbiStreamposToInt8(in.GetStreamPos()) - offset;
+    size_t index = m_Index->AddElement(offset, size);
+    ITERATE ( vector<string>, key, keys ) {
+        m_Index->AddKey(index, *key);
+    }
+}
+
+
+CAsnBinaryIndexedReader::CAsnBinaryIndexedReader(CObjectIStream& in,
+                                                 const CAsnBinaryIndex& index,
+                                                 TTypeInfo element_type)
+    : m_In(in), m_Index(index), m_ElementType(element_type)
+{
+    if ( in.GetDataFormat() != eSerial_AsnBinary ) {
+        NCBI_THROW(CSerialException, eNotImplemented,
+                   "CAsnBinaryIndexedReader: ASN binary input expected");
+    }
+    if ( !m_ElementType ) {
+        m_ElementType =
+            CClassTypeInfoBase::GetClassInfoByName(index.GetElementTypeName());
+    }
+    else if ( m_ElementType->GetName() != index.GetElementTypeName() ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryIndexedReader: index of " +
+                   index.GetElementTypeName() + " elements, not " +
+                   m_ElementType->GetName());
+    }
+}
+
+void CAsnBinaryIndexedReader::ReadElement(size_t index,
+                                          const CObjectInfo& element)
+{
+    const CAsnBinaryIndex::SElement& pos = m_Index.GetElement(index);
+    m_In.SetStreamPos(NcbiInt8ToStreampos(pos.m_Offset));
+    m_In.Read(element, CObjectIStream::eNoFileHeader);
+}
+
+CObjectInfo CAsnBinaryIndexedReader::ReadElement(size_t index)
+{
+    CObjectInfo element(m_ElementType);
+    ReadElement(index, element);
+    return element;
+}
+
+
+END_NCBI_SCOPE
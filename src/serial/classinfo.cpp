@@ -84,6 +84,8 @@ void CClassTypeInfo::InitClassTypeInfo(void)
 {
     m_ClassType = eSequential;
     m_ParentClassInfo = 0;
+    m_AsnBinaryReadFunction = 0;
+    m_AsnBinaryWriteFunction = 0;
 
     UpdateFunctions();
 }
@@ -103,6 +105,14 @@ CClassTypeInfo* CClassTypeInfo::SetImplicit(void)
     return this;
 }
 
+void CClassTypeInfo::SetAsnBinaryFunctions(TAsnBinaryReadFunction readFunc,
+                                           TAsnBinaryWriteFunction writeFunc)
+{
+    _ASSERT(!Implicit());
+    m_AsnBinaryReadFunction = readFunc;
+    m_AsnBinaryWriteFunction = writeFunc;
+}
+
 bool CClassTypeInfo::IsImplicitNonEmpty(void) const
 {
     _ASSERT(Implicit());
@@ -1228,6 +1228,65 @@ void CClassTypeStrings::GenerateClassCode(CClassCode& code,
         }
     }
 
+    // generate direct ASN.1 binary I/O functions
+    bool asnBinaryIO = DataType() && DataType()->GetBoolVar("_asn_binary_io") &&
+        !isSet && !wrapperClass && m_ParentClassName.empty() &&
+        !m_Members.empty();
+    ITERATE ( TMembers, i, m_Members ) {
+        if ( i->attlist || i->noTag || x_IsAnyContentType(i) ) {
+            asnBinaryIO = false;
+        }
+    }
+    if ( asnBinaryIO ) {
+        code.CPPIncludes().insert("serial/impl/asnbdirect");
+        code.ClassPrivate() <<
+            "\n"
+            "    // ASN.1 binary I/O\n"
+            "    static void x_ReadAsnBinary(NCBI_NS_NCBI::CAsnBinaryMemberReader& reader, NCBI_NS_NCBI::TObjectPtr classPtr);\n"
+            "    static void x_WriteAsnBinary(NCBI_NS_NCBI::CAsnBinaryMemberWriter& writer, NCBI_NS_NCBI::TConstObjectPtr classPtr);\n";
+        string className = classPrefix + GetClassNameDT();
+        string baseName = code.GetClassNameDT();
+        string readCode, writeCode;
+        size_t member_index = 0;
+        ITERATE ( TMembers, i, m_Members ) {
+            ++member_index;
+            string index = NStr::SizetToString(member_index);
+            bool isStd = false;
+            switch ( i->type->GetKind() ) {
+            case eKindStd:
+            case eKindString:
+                isStd = !i->ref && !i->delayed && !x_IsNullType(i) &&
+                    !i->type->HaveSpecialRef() && i->defaultValue.empty() &&
+                    i->type->GetStorageType(code.GetNamespace()) ==
+                    i->type->GetCType(code.GetNamespace());
+                break;
+            default:
+                break;
+            }
+            if ( isStd ) {
+                readCode += "    reader.ReadStd("+index+", obj."+i->mName+");\n";
+                writeCode += "    writer.WriteStd("+index+", obj."+i->mName+");\n";
+            }
+            else {
+                readCode += "    reader.Read("+index+");\n";
+                writeCode += "    writer.Write("+index+");\n";
+            }
+        }
+        methods <<
+            "void "<<methodPrefix<<"x_ReadAsnBinary(NCBI_NS_NCBI::CAsnBinaryMemberReader& reader, NCBI_NS_NCBI::TObjectPtr classPtr)\n"
+            "{\n"
+            "    "<<baseName<<"& obj = *static_cast<"<<className<<"*>(classPtr);\n"
+            <<readCode<<
+            "}\n"
+            "\n"
+            "void "<<methodPrefix<<"x_WriteAsnBinary(NCBI_NS_NCBI::CAsnBinaryMemberWriter& writer, NCBI_NS_NCBI::TConstObjectPtr classPtr)\n"
+            "{\n"
+            "    const "<<baseName<<"& obj = *static_cast<const "<<className<<"*>(classPtr);\n"
+            <<writeCode<<
+            "}\n"
+            "\n";
+    }
+
     // generate type info
     methods << "BEGIN_NAMED_";
     if ( haveUserClass )
@@ -1464,6 +1523,10 @@ void CClassTypeStrings::GenerateClassCode(CClassCode& code,
             methods << "    info->RandomOrder();\n";
         }
     }
+    if ( asnBinaryIO ) {
+        methods <<
+            "    info->SetAsnBinaryFunctions(&x_ReadAsnBinary, &x_WriteAsnBinary);\n";
+    }
     methods <<
         "}\n"
         "END_CLASS_INFO\n"
@@ -744,9 +744,9 @@ bool CObjectIStream::x_HavePathHooks() const
             !m_PathSkipVariantHooks.IsEmpty());
 }
 
-void CObjectIStream::UseMemoryPool(void)
+void CObjectIStream::UseMemoryPool(size_t chunk_size)
 {
-    SetMemoryPool(new CObjectMemoryPool);
+    SetMemoryPool(new CObjectMemoryPool(chunk_size));
 }
 
 string CObjectIStream::GetStackTrace(void) const
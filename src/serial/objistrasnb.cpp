@@ -45,6 +45,7 @@
 #include <serial/impl/choice.hpp>
 #include <serial/impl/continfo.hpp>
 #include <serial/impl/objistrimpl.hpp>
+#include <serial/impl/asnbdirect.hpp>
 #include <serial/pack_string.hpp>
 #include <serial/error_codes.hpp>
 #include <math.h>
@@ -957,10 +958,29 @@ void CObjectIStreamAsnBinary::ReadClassRandom(const CClassTypeInfo* classType,
     END_OBJECT_FRAME();
 }
 
+NCBI_PARAM_DECL(bool, SERIAL, ASN_BINARY_DIRECT_IO);
+
 void
 CObjectIStreamAsnBinary::ReadClassSequential(const CClassTypeInfo* classType,
                                              TObjectPtr classPtr)
 {
+    static const bool sx_DirectIO =
+        NCBI_PARAM_TYPE(SERIAL, ASN_BINARY_DIRECT_IO)::GetDefault();
+    CClassTypeInfo::TAsnBinaryReadFunction read_func =
+        classType->GetAsnBinaryReadFunction();
+    if ( read_func && sx_DirectIO && !CanSkipUnknownMembers() ) {
+        BEGIN_OBJECT_FRAME3(eFrameClass, classType, classPtr);
+        ExpectContainer(classType->RandomOrder());
+        BEGIN_OBJECT_FRAME(eFrameClassMember);
+        CAsnBinaryMemberReader reader(*this, classType, classPtr);
+        read_func(reader, classPtr);
+        reader.x_End();
+        END_OBJECT_FRAME();
+        ExpectEndOfContent();
+        END_OBJECT_FRAME();
+        return;
+    }
+
     BEGIN_OBJECT_FRAME3(eFrameClass, classType, classPtr);
     ExpectContainer(classType->RandomOrder());
     ReadClassSequentialContentsBegin(classType);
@@ -239,7 +239,12 @@ string CObjectIStreamJson::x_ReadString(EStringType type)
     m_ExpectValue = false;
     Expect('\"',true);
     string str;
+    // ASCII chars are the same in all encodings
+    EEncoding enc_out( type == eStringTypeUTF8 ? eEncoding_UTF8 : m_StringEncoding);
+    bool ascii_only = enc_out != eEncoding_UTF8 && enc_out != eEncoding_Unknown;
     for (;;) {
+        // copy chars which need no processing directly from the buffer
+        m_Input.GetPlainChars(str, '\"', '\\', ascii_only);
         bool encoded;
         char c = ReadEncodedChar(type, &encoded);
         if (!encoded) {
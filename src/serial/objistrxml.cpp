@@ -379,7 +379,12 @@ CTempString CObjectIStreamXml::ReadName(char c)
 
     // find end of tag name
     size_t i = 1, iColon = 0;
-    while ( IsNameChar(c = m_Input.PeekChar(i)) ) {
+    for ( ;; ) {
+        // skip ASCII name chars in buffer, check the rest one by one
+        i = m_Input.PeekNameChars(i);
+        if ( !IsNameChar(c = m_Input.PeekChar(i)) ) {
+            break;
+        }
         if (!m_Doctype_found && c == ':') {
             iColon = i+1;
         }
@@ -1207,9 +1212,19 @@ void CObjectIStreamXml::ReadTagData(string& str, EStringType type)
     BeginData();
     bool encoded = false;
     bool CR = false;
+    char endingChar = m_Attlist ? '\"' : '<';
+    // ASCII chars are the same in all encodings
+    EEncoding enc_out( type == eStringTypeUTF8 ? eEncoding_UTF8 : m_StringEncoding);
+    EEncoding enc_in(m_Encoding == eEncoding_Unknown ? eEncoding_UTF8 : m_Encoding);
+    bool ascii_only = enc_in != enc_out && enc_out != eEncoding_Unknown;
     try {
         for ( ;; ) {
-            int c = ReadEncodedChar(m_Attlist ? '\"' : '<', type, &encoded);
+            // copy chars which need no processing directly from the buffer;
+            // control chars (CR, LF, tab) are handled below
+            if ( m_Utf8Buf.empty() ) {
+                m_Input.GetPlainChars(str, endingChar, '&', ascii_only);
+            }
+            int c = ReadEncodedChar(endingChar, type, &encoded);
             if ( c < 0 ) {
                 if (m_Attlist || !ReadCDSection(str)) {
                     break;
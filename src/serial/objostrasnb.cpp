@@ -45,6 +45,7 @@
 #include <serial/impl/classinfo.hpp>
 #include <serial/impl/choice.hpp>
 #include <serial/impl/continfo.hpp>
+#include <serial/impl/asnbdirect.hpp>
 #include <serial/delaybuf.hpp>
 #include <serial/error_codes.hpp>
 
@@ -1024,14 +1025,26 @@ void CObjectOStreamAsnBinary::EndClassMember(void)
 }
 
 #ifdef VIRTUAL_MID_LEVEL_IO
+NCBI_PARAM_DECL(bool, SERIAL, ASN_BINARY_DIRECT_IO);
+
 void CObjectOStreamAsnBinary::WriteClass(const CClassTypeInfo* classType,
                                          TConstObjectPtr classPtr)
 {
+    static const bool sx_DirectIO =
+        NCBI_PARAM_TYPE(SERIAL, ASN_BINARY_DIRECT_IO)::GetDefault();
     WriteByte(MakeContainerTagByte(classType->RandomOrder()));
     WriteIndefiniteLength();
     
-    for ( CClassTypeInfo::CIterator i(classType); i.Valid(); ++i ) {
-        classType->GetMemberInfo(i)->WriteMember(*this, classPtr);
+    CClassTypeInfo::TAsnBinaryWriteFunction write_func =
+        classType->GetAsnBinaryWriteFunction();
+    if ( write_func && sx_DirectIO ) {
+        CAsnBinaryMemberWriter writer(*this, classType, classPtr);
+        write_func(writer, classPtr);
+    }
+    else {
+        for ( CClassTypeInfo::CIterator i(classType); i.Valid(); ++i ) {
+            classType->GetMemberInfo(i)->WriteMember(*this, classPtr);
+        }
     }
     
     WriteEndOfContent();
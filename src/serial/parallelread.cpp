@@ -0,0 +1,336 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Decode the elements of a container in ASN binary input on several
+*   threads
+*/
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbistd.hpp>
+#include <corelib/ncbi_system.hpp>
+#include <serial/parallelread.hpp>
+#include <serial/objistrasnb.hpp>
+#include <serial/objectiter.hpp>
+#include <serial/objhook.hpp>
+#include <serial/exception.hpp>
+#include <util/bytesrc.hpp>
+
+#if defined(NCBI_THREADS)
+
+BEGIN_NCBI_SCOPE
+
+/// Thread running one of the loops of CAsnBinaryParallelReader
+class CAsnBinaryParallelReaderThread : public CThread
+{
+public:
+    typedef void (CAsnBinaryParallelReader::*TLoop)(void);
+
+    CAsnBinaryParallelReaderThread(CAsnBinaryParallelReader& reader,
+                                   TLoop loop)
+        : m_Reader(reader), m_Loop(loop)
+    {
+    }
+
+protected:
+    virtual ~CAsnBinaryParallelReaderThread(void)
+    {
+    }
+
+    virtual void* Main(void)
+    {
+        (m_Reader.*m_Loop)();
+        return 0;
+    }
+
+private:
+    CAsnBinaryParallelReader& m_Reader;
+    TLoop m_Loop;
+};
+
+/// Container element hook: collect the encoded bytes of each element,
+/// skipping them by their lengths, instead of decoding it
+class CAsnBinaryElementSplitter : public CReadContainerElementHook
+{
+public:
+    CAsnBinaryElementSplitter(CAsnBinaryParallelReader& reader)
+        : m_Reader(reader)
+    {
+    }
+
+    virtual void ReadContainerElement(CObjectIStream& in,
+                                      const CObjectInfo& /*container*/)
+    {
+        CRef<CByteSource> data;
+        {{
+            CStreamDelayBufferGuard guard(in);
+            static_cast<CObjectIStreamAsnBinary&>(in).SkipAnyContent();
+            data = guard.EndDelayBuffer();
+        }}
+        m_Reader.x_AddElement(*data);
+    }
+
+private:
+    CAsnBinaryParallelReader& m_Reader;
+};
+
+/// Class member hook splitting the elements of the container member
+class CAsnBinaryElementSplitHook : public CReadClassMemberHook
+{
+public:
+    CAsnBinaryElementSplitHook(CAsnBinaryParallelReader& reader)
+        : m_Reader(reader)
+    {
+    }
+
+    virtual void ReadClassMember(CObjectIStream& in,
+                                 const CObjectInfoMI& member)
+    {
+        CAsnBinaryElementSplitter splitter(m_Reader);
+        member.GetMember().ReadContainer(in, splitter);
+    }
+
+private:
+    CAsnBinaryParallelReader& m_Reader;
+};
+
+
+CAsnBinaryParallelReader::CAsnBinaryParallelReader(CObjectIStream& in,
+                                                   const CObjectInfo& root,
+                                                   const string& container_member,
+                                                   unsigned int num_threads,
+                                                   size_t max_queued)
+    : m_In(in), m_Root(root), m_ContainerMember(container_member),
+      m_ElementType(0), m_MaxQueued(max_queued),
+      m_InputDone(false), m_Stop(false)
+{
+    if ( in.GetDataFormat() != eSerial_AsnBinary ) {
+        NCBI_THROW(CSerialException, eNotImplemented,
+                   "CAsnBinaryParallelReader: ASN binary input expected");
+    }
+    if ( root.GetTypeFamily() != eTypeFamilyClass ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryParallelReader: root object is not a class");
+    }
+    CObjectTypeInfoMI member =
+        CObjectTypeInfo(root.GetTypeInfo()).FindMember(container_member);
+    if ( !member.Valid() ||
+         member.GetMemberType().GetTypeFamily() != eTypeFamilyContainer ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryParallelReader: " + container_member +
+                   " is not a container member of " +
+                   root.GetTypeInfo()->GetName());
+    }
+    CObjectTypeInfo element = member.GetMemberType().GetElementType();
+    if ( element.GetTypeFamily() == eTypeFamilyPointer ) {
+        element = element.GetPointedType();
+    }
+    if ( !element.GetTypeInfo()->IsCObject() ) {
+        NCBI_THROW(CSerialException, eIllegalCall,
+                   "CAsnBinaryParallelReader: elements of " +
+                   container_member + " are not CObjects");
+    }
+    m_ElementType = element.GetTypeInfo();
+
+    if ( num_threads == 0 ) {
+        num_threads = GetCpuCount();
+    }
+    if ( m_MaxQueued == 0 ) {
+        m_MaxQueued = 4 * num_threads;
+    }
+
+    member.SetLocalReadHook(m_In, new CAsnBinaryElementSplitHook(*this));
+    m_Splitter.Reset(new CAsnBinaryParallelReaderThread(*this,
+                         &CAsnBinaryParallelReader::x_Split));
+    m_Splitter->Run();
+    for ( unsigned int i = 0; i < num_threads; ++i ) {
+        CRef<CThread> decoder(new CAsnBinaryParallelReaderThread(*this,
+                                  &CAsnBinaryParallelReader::x_Decode));
+        decoder->Run();
+        m_Decoders.push_back(decoder);
+    }
+}
+
+CAsnBinaryParallelReader::~CAsnBinaryParallelReader(void)
+{
+    x_StopThreads();
+    CObjectTypeInfo(m_Root.GetTypeInfo()).FindMember(m_ContainerMember)
+        .ResetLocalReadHook(m_In);
+}
+
+void CAsnBinaryParallelReader::x_StopThreads(void)
+{
+    {{
+        CFastMutexGuard guard(m_Lock);
+        m_Stop = true;
+        m_Changed.SignalAll();
+    }}
+    if ( m_Splitter ) {
+        m_Splitter->Join();
+        m_Splitter.Reset();
+    }
+    NON_CONST_ITERATE ( vector< CRef<CThread> >, it, m_Decoders ) {
+        (*it)->Join();
+    }
+    m_Decoders.clear();
+}
+
+void CAsnBinaryParallelReader::x_Split(void)
+{
+    auto_ptr<CException> error;
+    try {
+        m_In.Read(m_Root);
+    }
+    catch ( CException& e ) {
+        error.reset(new CException(DIAG_COMPILE_INFO, &e,
+                                   CException::eUnknown,
+                                   "CAsnBinaryParallelReader: "
+                                   "cannot split the input"));
+    }
+    catch ( exception& e ) {
+        CException wrapped(DIAG_COMPILE_INFO, 0, CException::eUnknown,
+                           e.what());
+        error.reset(new CException(DIAG_COMPILE_INFO, &wrapped,
+                                   CException::eUnknown,
+                                   "CAsnBinaryParallelReader: "
+                                   "cannot split the input"));
+    }
+
+    CFastMutexGuard guard(m_Lock);
+    if ( !m_Stop ) {
+        // when stopping, the error is the one thrown to stop reading
+        m_Error = error;
+    }
+    m_InputDone = true;
+    m_Changed.SignalAll();
+}
+
+void CAsnBinaryParallelReader::x_AddElement(CByteSource& data)
+{
+    CFastMutexGuard guard(m_Lock);
+    while ( !m_Stop && m_Queued.size() >= m_MaxQueued ) {
+        m_Changed.WaitForSignal(m_Lock);
+    }
+    if ( m_Stop ) {
+        NCBI_THROW(CSerialException, eFail,
+                   "CAsnBinaryParallelReader: reading stopped");
+    }
+    CRef<CElement> element(new CElement(data));
+    m_Queued.push_back(element);
+    m_ToDecode.push_back(element);
+    m_Changed.SignalAll();
+}
+
+void CAsnBinaryParallelReader::x_Decode(void)
+{
+    const CObjectIStream::TFlags kFlags = m_In.GetFlags();
+    // with a memory pool on the input, each element gets its own pool, so
+    // that its memory is released at once when it is deleted
+    const CObjectMemoryPool* pool = m_In.GetMemoryPool();
+    const size_t kPoolChunkSize = pool ? pool->GetChunkSize() : 0;
+    for ( ;; ) {
+        CRef<CElement> element;
+        {{
+            CFastMutexGuard guard(m_Lock);
+            while ( !m_Stop && !m_InputDone && m_ToDecode.empty() ) {
+                m_Changed.WaitForSignal(m_Lock);
+            }
+            if ( m_Stop || m_ToDecode.empty() ) {
+                break;
+            }
+            element = m_ToDecode.front();
+            m_ToDecode.pop_front();
+        }}
+
+        CRef<CObject> object;
+        auto_ptr<CException> error;
+        try {
+            auto_ptr<CObjectIStream> in(
+                CObjectIStream::Create(eSerial_AsnBinary, *element->m_Data));
+            in->SetFlags(kFlags);
+            if ( pool ) {
+                in->UseMemoryPool(kPoolChunkSize);
+            }
+            TObjectPtr objectPtr = m_ElementType->Create(in->GetMemoryPool());
+            object.Reset(const_cast<CObject*>(
+                             m_ElementType->GetCObjectPtr(objectPtr)));
+            in->Read(objectPtr, m_ElementType, CObjectIStream::eNoFileHeader);
+        }
+        catch ( CException& e ) {
+            error.reset(new CException(DIAG_COMPILE_INFO, &e,
+                                       CException::eUnknown,
+                                       "CAsnBinaryParallelReader: "
+                                       "cannot decode an element"));
+        }
+        catch ( exception& e ) {
+            CException wrapped(DIAG_COMPILE_INFO, 0, CException::eUnknown,
+                               e.what());
+            error.reset(new CException(DIAG_COMPILE_INFO, &wrapped,
+                                       CException::eUnknown,
+                                       "CAsnBinaryParallelReader: "
+                                       "cannot decode an element"));
+        }
+
+        CFastMutexGuard guard(m_Lock);
+        element->m_Data.Reset();
+        if ( error.get() ) {
+            element->m_Error = error;
+        }
+        else {
+            element->m_Object = object;
+        }
+        element->m_Done = true;
+        m_Changed.SignalAll();
+    }
+}
+
+CRef<CObject> CAsnBinaryParallelReader::ReadNextObject(void)
+{
+    CRef<CElement> element;
+    {{
+        CFastMutexGuard guard(m_Lock);
+        while ( m_Queued.empty() ? !m_InputDone : !m_Queued.front()->m_Done ) {
+            m_Changed.WaitForSignal(m_Lock);
+        }
+        if ( m_Queued.empty() ) {
+            if ( m_Error.get() ) {
+                // rethrow the original exception, preserving its type
+                m_Error->GetPredecessor()->Throw();
+            }
+            return CRef<CObject>();
+        }
+        element = m_Queued.front();
+        m_Queued.pop_front();
+        m_Changed.SignalAll();
+    }}
+    if ( element->m_Error.get() ) {
+        element->m_Error->GetPredecessor()->Throw();
+    }
+    return element->m_Object;
+}
+
+END_NCBI_SCOPE
+
+#endif // NCBI_THREADS
@@ -0,0 +1,172 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Measure the throughput of XML and JSON object streams on a data file
+ *   (e.g. BLAST XML output or a GBSeq set), with and without SIMD scanning
+ *   of the input buffer
+ *
+ */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbiargs.hpp>
+#include <corelib/ncbifile.hpp>
+#include <corelib/ncbitime.hpp>
+#include <util/strbuffer.hpp>
+#include <serial/serial.hpp>
+#include <serial/objistr.hpp>
+#include <serial/objostr.hpp>
+#include <serial/impl/classinfob.hpp>
+
+#include <objects/blastxml/BlastOutput.hpp>
+#include <objects/gbseq/GBSet.hpp>
+
+USING_NCBI_SCOPE;
+USING_SCOPE(objects);
+
+
+class CSerialScanPerfApp : public CNcbiApplication
+{
+private:
+    virtual void Init(void);
+    virtual int  Run(void);
+
+    void x_Measure(ESerialDataFormat format, const string& data,
+                   TTypeInfo type, const CConstObjectInfo& expected,
+                   int count);
+};
+
+
+void CSerialScanPerfApp::Init(void)
+{
+    auto_ptr<CArgDescriptions> d(new CArgDescriptions);
+    d->SetUsageContext(GetArguments().GetProgramBasename(),
+                       "Measure XML and JSON input throughput");
+
+    d->AddKey("i", "InputFile", "Data file",
+              CArgDescriptions::eInputFile);
+    d->AddDefaultKey("type", "TypeName",
+                     "Type of the data, e.g. BlastOutput or GBSet",
+                     CArgDescriptions::eString, "BlastOutput");
+    d->AddDefaultKey("ifmt", "Format", "Format of the data file",
+                     CArgDescriptions::eString, "xml");
+    d->SetConstraint("ifmt", &(*new CArgAllow_Strings,
+                               "asn", "asnb", "xml", "json"));
+    d->AddDefaultKey("n", "Count", "Number of reads in each measurement",
+                     CArgDescriptions::eInteger, "5");
+    d->SetConstraint("n", new CArgAllow_Integers(1, kMax_Int));
+
+    SetupArgDescriptions(d.release());
+}
+
+
+static ESerialDataFormat s_GetFormat(const string& name)
+{
+    if ( name == "asn" ) {
+        return eSerial_AsnText;
+    }
+    if ( name == "asnb" ) {
+        return eSerial_AsnBinary;
+    }
+    if ( name == "json" ) {
+        return eSerial_Json;
+    }
+    return eSerial_Xml;
+}
+
+
+int CSerialScanPerfApp::Run(void)
+{
+    const CArgs& args = GetArgs();
+
+    // register the known types for lookup by name
+    CBlastOutput::GetTypeInfo();
+    CGBSet::GetTypeInfo();
+    TTypeInfo type = CClassTypeInfoBase::GetClassInfoByName(args["type"].AsString());
+
+    // read the data once, and keep it in memory in both formats
+    CObjectInfo object(type);
+    {{
+        auto_ptr<CObjectIStream> in
+            (CObjectIStream::Open(s_GetFormat(args["ifmt"].AsString()),
+                                  args["i"].AsInputFile()));
+        in->Read(object);
+    }}
+    ESerialDataFormat formats[] = { eSerial_Xml, eSerial_Json };
+    for ( size_t f = 0; f < ArraySize(formats); ++f ) {
+        CNcbiOstrstream buffer;
+        {{
+            auto_ptr<CObjectOStream> out
+                (CObjectOStream::Open(formats[f], buffer));
+            out->Write(object);
+        }}
+        x_Measure(formats[f], CNcbiOstrstreamToString(buffer), type, object,
+                  args["n"].AsInteger());
+    }
+    return 0;
+}
+
+
+void CSerialScanPerfApp::x_Measure(ESerialDataFormat format,
+                                   const string& data,
+                                   TTypeInfo type,
+                                   const CConstObjectInfo& expected,
+                                   int count)
+{
+    const char* format_name = format == eSerial_Xml ? "XML" : "JSON";
+    double seconds[2];
+    for ( int vector = 0; vector < 2; ++vector ) {
+        CIStreamBuffer::SetVectorScan(vector != 0);
+        CStopWatch sw;
+        for ( int i = 0; i < count; ++i ) {
+            CObjectInfo object(type);
+            auto_ptr<CObjectIStream> in
+                (CObjectIStream::CreateFromBuffer(format,
+                                                  data.data(), data.size()));
+            sw.Start();
+            in->Read(object);
+            sw.Stop();
+            if ( !type->Equals(object.GetObjectPtr(),
+                               expected.GetObjectPtr()) ) {
+                NCBI_THROW(CException, eUnknown,
+                           string(format_name) + " data read incorrectly");
+            }
+        }
+        seconds[vector] = sw.Elapsed();
+        NcbiCout << format_name << (vector ? " vector: " : " scalar: ")
+                 << double(data.size()) * count / seconds[vector] / 1e6
+                 << " MB/s" << NcbiEndl;
+    }
+    CIStreamBuffer::SetVectorScan(true);
+    NcbiCout << format_name << " " << data.size() << " bytes, speedup: "
+             << seconds[0] / seconds[1] << NcbiEndl;
+}
+
+
+int main(int argc, const char* argv[])
+{
+    return CSerialScanPerfApp().AppMain(argc, argv);
+}
@@ -103,6 +103,339 @@ BOOST_AUTO_TEST_CASE(s_TestAsnSerialization)
         BOOST_CHECK( CFile( bin_in).Compare( bin_out) );
     }
 }
+
+/////////////////////////////////////////////////////////////////////////////
+// Test reading into a memory pool
+
+BOOST_AUTO_TEST_CASE(s_TestMemoryPoolRead)
+{
+    CRef<CWeb_Env> env(new CWeb_Env);
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open("webenv.bin", eSerial_AsnBinary));
+        *in >> *env;
+    }
+    CRef<CWeb_Env> env_pool(new CWeb_Env);
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open("webenv.bin", eSerial_AsnBinary));
+        in->UseMemoryPool(65536);
+        *in >> *env_pool;
+        const CObjectMemoryPool* pool = in->GetMemoryPool();
+        BOOST_REQUIRE(pool);
+        BOOST_CHECK_EQUAL(pool->GetChunkSize(), 65536u);
+        BOOST_CHECK(pool->GetAllocatedCount() > 0);
+        BOOST_CHECK(pool->GetAllocatedSize() >= pool->GetAllocatedCount());
+        BOOST_CHECK_EQUAL(pool->GetChunkCount(), 1u);
+    }
+    // the objects outlive the stream and its pool
+    BOOST_CHECK(SerialEquals<CWeb_Env>(*env, *env_pool));
+    env_pool.Reset();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test generated ASN.1 binary I/O functions
+
+class CCountSeqNumberReadHook : public CReadClassMemberHook
+{
+public:
+    CCountSeqNumberReadHook(void) : m_Count(0) {}
+
+    virtual void ReadClassMember(CObjectIStream& in,
+                                 const CObjectInfoMI& member)
+    {
+        ++m_Count;
+        DefaultRead(in, member);
+    }
+
+    size_t m_Count;
+};
+
+BOOST_AUTO_TEST_CASE(s_TestAsnBinaryDirectIO)
+{
+    const CClassTypeInfo* info =
+        dynamic_cast<const CClassTypeInfo*>(CQuery_History::GetTypeInfo());
+    BOOST_REQUIRE(info);
+    BOOST_CHECK(info->GetAsnBinaryReadFunction());
+    BOOST_CHECK(info->GetAsnBinaryWriteFunction());
+
+    CRef<CWeb_Env> env(new CWeb_Env);
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open("webenv.bin", eSerial_AsnBinary));
+        *in >> *env;
+    }
+    string data;
+    {
+        CNcbiOstrstream ostrs;
+        auto_ptr<CObjectOStream> out(
+            CObjectOStream::Open(eSerial_AsnBinary, ostrs));
+        *out << *env;
+        out->FlushBuffer();
+        data = CNcbiOstrstreamToString(ostrs);
+    }
+    {
+        CNcbiIstrstream istrs(data.data(), data.size());
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open(eSerial_AsnBinary, istrs));
+        CWeb_Env env_copy;
+        *in >> env_copy;
+        BOOST_CHECK(SerialEquals<CWeb_Env>(*env, env_copy));
+    }
+    {
+        // members with hooks are still read through the hooks
+        CNcbiIstrstream istrs(data.data(), data.size());
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open(eSerial_AsnBinary, istrs));
+        CRef<CCountSeqNumberReadHook> hook(new CCountSeqNumberReadHook);
+        CObjectTypeInfo type = CType<CQuery_History>();
+        type.FindMember("seqNumber").SetLocalReadHook(*in, hook);
+        CWeb_Env env_copy;
+        *in >> env_copy;
+        BOOST_CHECK_EQUAL(hook->m_Count, env->GetQueries().size());
+        BOOST_CHECK(SerialEquals<CWeb_Env>(*env, env_copy));
+    }
+}
+#endif
+
+#if !defined(HAVE_NCBI_C) && defined(NCBI_THREADS)
+/////////////////////////////////////////////////////////////////////////////
+// Test parallel decoding of container elements
+
+BOOST_AUTO_TEST_CASE(s_TestAsnBinaryParallelReader)
+{
+    CRef<CWeb_Env> env(new CWeb_Env);
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open("webenv.ent", eSerial_AsnText));
+        *in >> *env;
+    }
+    // make enough elements to fill the queue of the reader many times
+    CWeb_Env::TQueries queries = env->GetQueries();
+    for ( int i = 0; i < 100; ++i ) {
+        ITERATE ( CWeb_Env::TQueries, it, queries ) {
+            CRef<CQuery_History> query(new CQuery_History);
+            query->Assign(**it);
+            query->SetSeqNumber(i);
+            env->SetQueries().push_back(query);
+        }
+    }
+
+    string data;
+    {
+        CNcbiOstrstream ostrs;
+        {
+            auto_ptr<CObjectOStream> out(
+                CObjectOStream::Open(eSerial_AsnBinary, ostrs));
+            *out << *env;
+        }
+        data = CNcbiOstrstreamToString(ostrs);
+    }
+
+    {
+        // elements are returned in order, identical to those read
+        // sequentially
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::CreateFromBuffer(eSerial_AsnBinary,
+                                             data.data(), data.size()));
+        CWeb_Env env_read;
+        CAsnBinaryParallelReader reader(*in, ObjectInfo(env_read),
+                                        "queries", 4, 3);
+        BOOST_CHECK_EQUAL(reader.GetNumThreads(), 4u);
+        CWeb_Env::TQueries::const_iterator expected =
+            env->GetQueries().begin();
+        size_t count = 0;
+        for ( CRef<CQuery_History> query; reader.ReadNext(query); ) {
+            BOOST_REQUIRE(expected != env->GetQueries().end());
+            BOOST_CHECK(SerialEquals<CQuery_History>(*query, **expected));
+            ++expected;
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, env->GetQueries().size());
+        BOOST_CHECK(env_read.GetQueries().empty());
+        BOOST_CHECK(in->EndOfData());
+    }
+    {
+        // the reader may be destroyed before the end of the input
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::CreateFromBuffer(eSerial_AsnBinary,
+                                             data.data(), data.size()));
+        CWeb_Env env_read;
+        CAsnBinaryParallelReader reader(*in, ObjectInfo(env_read),
+                                        "queries", 2, 1);
+        CRef<CQuery_History> query;
+        BOOST_CHECK(reader.ReadNext(query));
+        BOOST_CHECK(SerialEquals<CQuery_History>(*query,
+                                                 *env->GetQueries().front()));
+    }
+    {
+        // truncated input: the elements before the error are returned
+        const size_t kSize = data.size() / 2;
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::CreateFromBuffer(eSerial_AsnBinary,
+                                             data.data(), kSize));
+        CWeb_Env env_read;
+        CAsnBinaryParallelReader reader(*in, ObjectInfo(env_read),
+                                        "queries", 2);
+        size_t count = 0;
+        CRef<CQuery_History> query;
+        BOOST_CHECK_THROW({
+            while ( reader.ReadNext(query) ) {
+                ++count;
+            }
+        }, CException);
+        BOOST_CHECK(count > 0);
+        BOOST_CHECK(count < env->GetQueries().size());
+    }
+}
+#endif
+
+#ifndef HAVE_NCBI_C
+/////////////////////////////////////////////////////////////////////////////
+// Test indexed reading of container elements
+
+class CQuerySeqNumberKeys : public CAsnBinaryIndexer::IKeySource
+{
+public:
+    virtual void GetKeys(const CConstObjectInfo& element,
+                         vector<string>& keys)
+    {
+        const CQuery_History* query =
+            static_cast<const CQuery_History*>(element.GetObjectPtr());
+        keys.push_back(NStr::IntToString(query->GetSeqNumber()));
+    }
+};
+
+BOOST_AUTO_TEST_CASE(s_TestAsnBinaryIndex)
+{
+    CRef<CWeb_Env> env(new CWeb_Env);
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open("webenv.ent", eSerial_AsnText));
+        *in >> *env;
+    }
+    CWeb_Env::TQueries queries = env->GetQueries();
+    env->SetQueries().clear();
+    for ( int i = 0; i < 20; ++i ) {
+        ITERATE ( CWeb_Env::TQueries, it, queries ) {
+            CRef<CQuery_History> query(new CQuery_History);
+            query->Assign(**it);
+            query->SetSeqNumber(int(env->GetQueries().size()));
+            env->SetQueries().push_back(query);
+        }
+    }
+
+    string data;
+    {
+        CNcbiOstrstream ostrs;
+        auto_ptr<CObjectOStream> out(
+            CObjectOStream::Open(eSerial_AsnBinary, ostrs));
+        *out << *env;
+        out->FlushBuffer();
+        data = CNcbiOstrstreamToString(ostrs);
+    }
+
+    CRef<CAsnBinaryIndex> index;
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::CreateFromBuffer(eSerial_AsnBinary,
+                                             data.data(), data.size()));
+        CQuerySeqNumberKeys keys;
+        CAsnBinaryIndexer indexer(CType<CWeb_Env>(), "queries", &keys);
+        index = indexer.Index(*in);
+    }
+    BOOST_REQUIRE_EQUAL(index->GetElementCount(), env->GetQueries().size());
+    BOOST_CHECK_EQUAL(index->GetElementTypeName(), "Query-History");
+    BOOST_CHECK_EQUAL(index->GetKeys().size(), env->GetQueries().size());
+
+    // the index survives saving and loading
+    {
+        CNcbiOstrstream ostrs;
+        index->Write(ostrs);
+        string text = CNcbiOstrstreamToString(ostrs);
+        CNcbiIstrstream istrs(text.data(), text.size());
+        CRef<CAsnBinaryIndex> loaded(new CAsnBinaryIndex);
+        loaded->Read(istrs);
+        BOOST_REQUIRE_EQUAL(loaded->GetElementCount(),
+                            index->GetElementCount());
+        for ( size_t i = 0; i < index->GetElementCount(); ++i ) {
+            BOOST_CHECK_EQUAL(loaded->GetElement(i).m_Offset,
+                              index->GetElement(i).m_Offset);
+            BOOST_CHECK_EQUAL(loaded->GetElement(i).m_Size,
+                              index->GetElement(i).m_Size);
+        }
+        BOOST_CHECK(loaded->GetKeys() == index->GetKeys());
+        index = loaded;
+    }
+
+    auto_ptr<CObjectIStream> in(
+        CObjectIStream::CreateFromBuffer(eSerial_AsnBinary,
+                                         data.data(), data.size()));
+    CAsnBinaryIndexedReader reader(*in, *index);
+    // read the elements backwards, each one by its key
+    for ( size_t i = env->GetQueries().size(); i-- > 0; ) {
+        size_t found = reader.FindElement(NStr::SizetToString(i));
+        BOOST_REQUIRE_EQUAL(found, i);
+        CQuery_History query;
+        reader.ReadElement(found, ObjectInfo(query));
+        BOOST_CHECK_EQUAL(query.GetSeqNumber(), int(i));
+    }
+    CObjectInfo last = reader.ReadElement(index->GetElementCount() - 1);
+    BOOST_CHECK(SerialEquals<CQuery_History>(
+        *CType<CQuery_History>::Get(last), *env->GetQueries().back()));
+    BOOST_CHECK_EQUAL(reader.FindElement("no such key"), NPOS);
+
+    // keys that would break the lines of the index file are rejected
+    BOOST_CHECK_THROW(index->AddKey(0, "a\tb"), CSerialException);
+    BOOST_CHECK_THROW(index->AddKey(0, "a\nb"), CSerialException);
+    BOOST_CHECK_THROW(index->AddKey(0, ""), CSerialException);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test scalar and SIMD scanning of XML and JSON input
+
+BOOST_AUTO_TEST_CASE(s_TestTextScan)
+{
+    CRef<CWeb_Env> env(new CWeb_Env);
+    {
+        auto_ptr<CObjectIStream> in(
+            CObjectIStream::Open("webenv.ent", eSerial_AsnText));
+        *in >> *env;
+    }
+    // long values with chars to escape at different positions
+    string special = "<&>\"\\'";
+    for ( size_t i = 0; i < 40; ++i ) {
+        CRef<CArgument> arg(new CArgument);
+        arg->SetName(string(i, 'n') + "-name_" + NStr::SizetToString(i));
+        string value(i * 7, 'v');
+        value.insert(value.size() / 2, special.substr(i % special.size()));
+        arg->SetValue(value + special.substr(0, i % special.size()));
+        env->SetArguments().push_back(arg);
+    }
+
+    ESerialDataFormat formats[] = { eSerial_Xml, eSerial_Json };
+    for ( size_t f = 0; f < ArraySize(formats); ++f ) {
+        string data;
+        {
+            CNcbiOstrstream ostrs;
+            auto_ptr<CObjectOStream> out(
+                CObjectOStream::Open(formats[f], ostrs));
+            *out << *env;
+            out->FlushBuffer();
+            data = CNcbiOstrstreamToString(ostrs);
+        }
+        for ( int vector = 0; vector < 2; ++vector ) {
+            CIStreamBuffer::SetVectorScan(vector != 0);
+            CWeb_Env env2;
+            auto_ptr<CObjectIStream> in(
+                CObjectIStream::CreateFromBuffer(formats[f],
+                                                 data.data(), data.size()));
+            *in >> env2;
+            BOOST_CHECK(SerialEquals<CWeb_Env>(*env, env2));
+        }
+    }
+    CIStreamBuffer::SetVectorScan(true);
+}
 #endif
 
 /////////////////////////////////////////////////////////////////////////////
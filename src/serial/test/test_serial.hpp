@@ -15,12 +15,16 @@
 #include "cppwebenv.hpp"
 #include <serial/serialimpl.hpp>
 #include <serial/streamiter.hpp>
+#include <serial/parallelread.hpp>
+#include <serial/asnindex.hpp>
 
 #ifdef HAVE_NCBI_C
 # include <asn.h>
 # include "twebenv.h"
 #else
 # include <serial/test/Web_Env.hpp>
+# include <serial/test/Query_History.hpp>
+# include <serial/test/Argument.hpp>
 #endif
 
 #include <corelib/ncbifile.hpp>
@@ -32,11 +32,23 @@
 #include <ncbi_pch.hpp>
 #include <corelib/ncbistre.hpp>
 #include <corelib/ncbi_limits.hpp>
+#include <corelib/ncbi_param.hpp>
 #include <util/strbuffer.hpp>
 #include <util/bytesrc.hpp>
 #include <util/error_codes.hpp>
 #include <algorithm>
 
+// SSE2 is a part of the base x86-64 instruction set,
+// so no run-time CPU check is necessary
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define NCBI_STRBUFFER_SSE2 1
+#  include <emmintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
+
 
 #define NCBI_USE_ERRCODE_X   Util_Stream
 
@@ -44,6 +56,153 @@ BEGIN_NCBI_SCOPE
 
 static const size_t KInitialBufferSize = 4096;
 
+NCBI_PARAM_DECL(bool, UTIL, STREAM_BUFFER_VECTOR_SCAN);
+NCBI_PARAM_DEF_EX(bool, UTIL, STREAM_BUFFER_VECTOR_SCAN, true,
+                  eParam_NoThread, UTIL_STREAM_BUFFER_VECTOR_SCAN);
+typedef NCBI_PARAM_TYPE(UTIL, STREAM_BUFFER_VECTOR_SCAN) TVectorScanParam;
+
+void CIStreamBuffer::SetVectorScan(bool enable)
+{
+    TVectorScanParam::SetDefault(enable);
+}
+
+bool CIStreamBuffer::GetVectorScan(void)
+{
+    return TVectorScanParam::GetDefault();
+}
+
+
+#ifdef NCBI_STRBUFFER_SSE2
+// index of the lowest set bit, mask != 0
+static inline
+unsigned s_LowestBit(unsigned mask)
+{
+#  ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#  else
+    return __builtin_ctz(mask);
+#  endif
+}
+
+static inline
+__m128i s_Load16(const char* pos)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+}
+
+// mask of chars in range [lo, hi], both bounds are in ASCII range
+static inline
+__m128i s_InRange(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(lo - 1))),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(char(hi + 1))));
+}
+#endif
+
+// return: first char in [pos, end) which is not space, or end
+static inline
+const char* s_FindNonSpace(const char* pos, const char* end, bool vector)
+{
+#ifdef NCBI_STRBUFFER_SSE2
+    // short indents are common, check the first char before loading
+    if ( vector  &&  pos < end  &&  *pos == ' ' ) {
+        const __m128i spaces = _mm_set1_epi8(' ');
+        for ( ; end - pos >= 16; pos += 16 ) {
+            unsigned mask = _mm_movemask_epi8(
+                _mm_cmpeq_epi8(s_Load16(pos), spaces)) ^ 0xffff;
+            if ( mask ) {
+                return pos + s_LowestBit(mask);
+            }
+        }
+    }
+#endif
+    while ( pos < end  &&  *pos == ' ' ) {
+        ++pos;
+    }
+    return pos;
+}
+
+// return: first char in [pos, end) which is a control char, stop1, stop2,
+//         or non-ASCII char if ascii_only is set; or end
+static inline
+const char* s_FindSpecialChar(const char* pos, const char* end,
+                              char stop1, char stop2, bool ascii_only,
+                              bool vector)
+{
+#ifdef NCBI_STRBUFFER_SSE2
+    if ( vector ) {
+        const __m128i s1 = _mm_set1_epi8(stop1);
+        const __m128i s2 = _mm_set1_epi8(stop2);
+        const __m128i ctrl = _mm_set1_epi8(' ' - 1);
+        const __m128i space = _mm_set1_epi8(' ');
+        for ( ; end - pos >= 16; pos += 16 ) {
+            __m128i v = s_Load16(pos);
+            __m128i special = ascii_only ?
+                // signed compare: bytes >= 0x80 are negative
+                _mm_cmplt_epi8(v, space) :
+                _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v);
+            special = _mm_or_si128(special,
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, s1),
+                                                _mm_cmpeq_epi8(v, s2)));
+            unsigned mask = _mm_movemask_epi8(special);
+            if ( mask ) {
+                return pos + s_LowestBit(mask);
+            }
+        }
+    }
+#endif
+    for ( ; pos < end; ++pos ) {
+        char c = *pos;
+        if ( (unsigned char)c < ' '  ||  c == stop1  ||  c == stop2  ||
+             (ascii_only  &&  (c & 0x80)) ) {
+            break;
+        }
+    }
+    return pos;
+}
+
+static inline
+bool s_IsNameChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '-';
+}
+
+// return: first char in [pos, end) which is not a name char, or end
+static inline
+const char* s_FindNonNameChar(const char* pos, const char* end, bool vector)
+{
+#ifdef NCBI_STRBUFFER_SSE2
+    if ( vector ) {
+        const __m128i lower = _mm_set1_epi8(0x20);
+        const __m128i underscore = _mm_set1_epi8('_');
+        const __m128i dot = _mm_set1_epi8('.');
+        const __m128i dash = _mm_set1_epi8('-');
+        for ( ; end - pos >= 16; pos += 16 ) {
+            __m128i v = s_Load16(pos);
+            __m128i name =
+                _mm_or_si128(s_InRange(_mm_or_si128(v, lower), 'a', 'z'),
+                             s_InRange(v, '0', '9'));
+            name = _mm_or_si128(name,
+                                _mm_or_si128(_mm_cmpeq_epi8(v, underscore),
+                                             _mm_or_si128(
+                                                 _mm_cmpeq_epi8(v, dot),
+                                                 _mm_cmpeq_epi8(v, dash))));
+            unsigned mask = _mm_movemask_epi8(name) ^ 0xffff;
+            if ( mask ) {
+                return pos + s_LowestBit(mask);
+            }
+        }
+    }
+#endif
+    while ( pos < end  &&  s_IsNameChar(*pos) ) {
+        ++pos;
+    }
+    return pos;
+}
+
 static inline
 size_t BiggerBufferSize(size_t size) THROWS1_NONE
 {
@@ -58,7 +217,8 @@ CIStreamBuffer::CIStreamBuffer(void)
       m_Line(1),
       m_CollectPos(0),
       m_CanceledCallback(0),
-      m_BufferLockSize(0)
+      m_BufferLockSize(0),
+      m_VectorScan(TVectorScanParam::GetDefault())
 {
 }
 
@@ -69,7 +229,8 @@ CIStreamBuffer::CIStreamBuffer(const char* buffer, size_t size)
       m_Line(1),
       m_CollectPos(0),
       m_CanceledCallback(0),
-      m_BufferLockSize(0)
+      m_BufferLockSize(0),
+      m_VectorScan(TVectorScanParam::GetDefault())
 {
 }
 
@@ -212,19 +373,13 @@ char CIStreamBuffer::SkipSpaces(void)
     //     end == m_DataEndPos
     //     pos < end
     for (;;) {
-        // we use do{}while() cycle because
-        // condition is true at the beginning ( pos < end )
-        do {
-            // cache current char
-            char c = *pos;
-            if ( c != ' ' ) { // it's not space (' ')
-                // point m_CurrentPos to first non space char
-                m_CurrentPos = pos;
-                // return char value
-                return c;
-            }
-            // skip space char
-        } while ( ++pos < end );
+        pos = s_FindNonSpace(pos, end, m_VectorScan);
+        if ( pos < end ) {
+            // point m_CurrentPos to first non space char
+            m_CurrentPos = pos;
+            // return char value
+            return *pos;
+        }
         // here pos == end == m_DataEndPos
         // point m_CurrentPos to end of buffer
         m_CurrentPos = pos;
@@ -286,6 +441,31 @@ size_t CIStreamBuffer::PeekFindChar(char c, size_t limit)
     return limit;
 }
 
+size_t CIStreamBuffer::GetPlainChars(string& str, char stop1, char stop2,
+                                     bool ascii_only)
+    THROWS1_NONE
+{
+    const char* pos = m_CurrentPos;
+    const char* found = s_FindSpecialChar(pos, m_DataEndPos, stop1, stop2,
+                                          ascii_only, m_VectorScan);
+    size_t count = found - pos;
+    if ( count ) {
+        str.append(pos, count);
+        m_CurrentPos = found;
+    }
+    return count;
+}
+
+size_t CIStreamBuffer::PeekNameChars(size_t offset) const
+    THROWS1_NONE
+{
+    const char* pos = m_CurrentPos + offset;
+    if ( pos >= m_DataEndPos ) {
+        return offset;
+    }
+    return s_FindNonNameChar(pos, m_DataEndPos, m_VectorScan) - m_CurrentPos;
+}
+
 bool CIStreamBuffer::TrySetCurrentPos(const char* pos)
 {
     if (m_BufferPos == 0 && pos >= m_Buffer && pos <= m_DataEndPos) {